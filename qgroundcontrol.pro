@@ -484,6 +484,8 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/MissionManagerTest.h \
         src/MissionManager/MissionSettingsTest.h \
         src/MissionManager/PlanMasterControllerTest.h \
+        src/MissionManager/PolygonClipperBenchmark.h \
+        src/MissionManager/PolygonClipperTest.h \
         src/MissionManager/QGCMapPolygonTest.h \
         src/MissionManager/QGCMapPolylineTest.h \
         src/MissionManager/SectionTest.h \
@@ -494,18 +496,38 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/TransectStyleComplexItemTest.h \
         src/MissionManager/TransectStyleComplexItemTestBase.h \
         src/MissionManager/VisualMissionItemTest.h \
+        src/qgcunittest/ADSBConflictEngineBenchmark.h \
+        src/qgcunittest/ADSBConflictEngineTest.h \
+        src/qgcunittest/ADSBVehicleManagerTest.h \
         src/qgcunittest/GeoTest.h \
         src/qgcunittest/LinkManagerTest.h \
+        src/qgcunittest/LinkSendQueueTest.h \
+        src/qgcunittest/JoystickTest.h \
+        src/qgcunittest/TimingHistogramTest.h \
+        src/qgcunittest/LogReplayIndexTest.h \
+        src/qgcunittest/MAVLinkDecodeWorkerTest.h \
+        src/qgcunittest/MAVLinkMessageRouterTest.h \
         src/qgcunittest/MavlinkLogTest.h \
+        src/qgcunittest/QGCTileDownloaderTest.h \
+        src/qgcunittest/QGCTileCacheWorkerTest.h \
+        src/qgcunittest/QGCTileMemoryCacheTest.h \
         src/qgcunittest/MultiSignalSpy.h \
         src/qgcunittest/TCPLinkTest.h \
+        src/qgcunittest/TelemetryLogWriterTest.h \
         src/qgcunittest/TCPLoopBackServer.h \
+        src/qgcunittest/TerrainDEMTest.h \
+        src/qgcunittest/TerrainQueryTest.h \
+        src/qgcunittest/TerrainTileBenchmark.h \
+        src/qgcunittest/TerrainTileStoreTest.h \
+        src/qgcunittest/TerrainTileTest.h \
         src/qgcunittest/UnitTest.h \
         src/Vehicle/SendMavCommandTest.h \
         #src/qgcunittest/RadioConfigTest.h \
-        #src/AnalyzeView/LogDownloadTest.h \
+        src/AnalyzeView/LogDownloadTest.h \
+        src/AnalyzeView/GeoTagTest.h \
+        src/AnalyzeView/ULogReaderTest.h \
         #src/qgcunittest/FileDialogTest.h \
-        #src/qgcunittest/FileManagerTest.h \
+        src/qgcunittest/FileManagerTest.h \
         #src/qgcunittest/FlightGearTest.h \
         #src/qgcunittest/MainWindowTest.h \
         #src/qgcunittest/MessageBoxTest.h \
@@ -527,6 +549,8 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/MissionManagerTest.cc \
         src/MissionManager/MissionSettingsTest.cc \
         src/MissionManager/PlanMasterControllerTest.cc \
+        src/MissionManager/PolygonClipperBenchmark.cc \
+        src/MissionManager/PolygonClipperTest.cc \
         src/MissionManager/QGCMapPolygonTest.cc \
         src/MissionManager/QGCMapPolylineTest.cc \
         src/MissionManager/SectionTest.cc \
@@ -537,19 +561,40 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
         src/MissionManager/TransectStyleComplexItemTest.cc \
         src/MissionManager/TransectStyleComplexItemTestBase.cc \
         src/MissionManager/VisualMissionItemTest.cc \
+        src/qgcunittest/ADSBConflictEngineBenchmark.cc \
+        src/qgcunittest/ADSBConflictEngineTest.cc \
+        src/qgcunittest/ADSBVehicleManagerTest.cc \
         src/qgcunittest/GeoTest.cc \
         src/qgcunittest/LinkManagerTest.cc \
+        src/qgcunittest/LinkSendQueueTest.cc \
+        src/qgcunittest/JoystickTest.cc \
+        src/qgcunittest/TimingHistogramTest.cc \
+        src/qgcunittest/LogReplayIndexTest.cc \
+        src/qgcunittest/MAVLinkDecodeWorkerTest.cc \
+        src/qgcunittest/MAVLinkMessageRouterTest.cc \
         src/qgcunittest/MavlinkLogTest.cc \
+        src/qgcunittest/QGCTileDownloaderTest.cc \
+        src/qgcunittest/QGCTileCacheWorkerTest.cc \
+        src/qgcunittest/QGCTileMemoryCacheTest.cc \
         src/qgcunittest/MultiSignalSpy.cc \
         src/qgcunittest/TCPLinkTest.cc \
+        src/qgcunittest/TelemetryLogWriterTest.cc \
         src/qgcunittest/TCPLoopBackServer.cc \
+        src/qgcunittest/TerrainDEMTest.cc \
+        src/qgcunittest/TerrainQueryTest.cc \
+        src/qgcunittest/TerrainTileBenchmark.cc \
+        src/qgcunittest/TerrainTileStoreTest.cc \
+        src/qgcunittest/TerrainTileTest.cc \
+        src/qgcunittest/UnitBenchmarkList.cc \
         src/qgcunittest/UnitTest.cc \
         src/qgcunittest/UnitTestList.cc \
         src/Vehicle/SendMavCommandTest.cc \
         #src/qgcunittest/RadioConfigTest.cc \
-        #src/AnalyzeView/LogDownloadTest.cc \
+        src/AnalyzeView/LogDownloadTest.cc \
+        src/AnalyzeView/GeoTagTest.cc \
+        src/AnalyzeView/ULogReaderTest.cc \
         #src/qgcunittest/FileDialogTest.cc \
-        #src/qgcunittest/FileManagerTest.cc \
+        src/qgcunittest/FileManagerTest.cc \
         #src/qgcunittest/FlightGearTest.cc \
         #src/qgcunittest/MainWindowTest.cc \
         #src/qgcunittest/MessageBoxTest.cc \
@@ -559,12 +604,17 @@ DebugBuild { PX4FirmwarePlugin { PX4FirmwarePluginFactory { APMFirmwarePlugin {
 # Main QGC Headers and Source files
 
 HEADERS += \
+    src/ADSB/ADSBConflictEngine.h \
+    src/ADSB/ADSBSpatialIndex.h \
+    src/ADSB/ADSBTrafficGenerator.h \
     src/ADSB/ADSBVehicle.h \
     src/ADSB/ADSBVehicleManager.h \
     src/AnalyzeView/LogDownloadController.h \
     src/AnalyzeView/PX4LogParser.h \
     src/AnalyzeView/ULogParser.h \
+    src/AnalyzeView/ULogReader.h \
     src/AnalyzeView/MavlinkConsoleController.h \
+    src/AnalyzeView/VehicleLogDownloader.h \
     src/Audio/AudioOutput.h \
     src/Camera/QGCCameraControl.h \
     src/Camera/QGCCameraIO.h \
@@ -574,6 +624,7 @@ HEADERS += \
     src/FollowMe/FollowMe.h \
     src/Joystick/Joystick.h \
     src/Joystick/JoystickManager.h \
+    src/Joystick/TimingHistogram.h \
     src/JsonHelper.h \
     src/KMLDomDocument.h \
     src/KMLHelper.h \
@@ -600,6 +651,7 @@ HEADERS += \
     src/MissionManager/PlanCreator.h \
     src/MissionManager/PlanManager.h \
     src/MissionManager/PlanMasterController.h \
+    src/MissionManager/PolygonClipper.h \
     src/MissionManager/QGCFenceCircle.h \
     src/MissionManager/QGCFencePolygon.h \
     src/MissionManager/QGCMapCircle.h \
@@ -671,7 +723,9 @@ HEADERS += \
     src/Settings/VideoSettings.h \
     src/ShapeFileHelper.h \
     src/SHPFileHelper.h \
+    src/Terrain/TerrainDEM.h \
     src/Terrain/TerrainQuery.h \
+    src/Terrain/TerrainTileStore.h \
     src/TerrainTile.h \
     src/Vehicle/GPSRTKFactGroup.h \
     src/Vehicle/MAVLinkLogManager.h \
@@ -684,11 +738,16 @@ HEADERS += \
     src/VehicleSetup/JoystickConfigController.h \
     src/comm/LinkConfiguration.h \
     src/comm/LinkInterface.h \
+    src/comm/LinkSendQueue.h \
     src/comm/LinkManager.h \
+    src/comm/LogReplayIndex.h \
     src/comm/LogReplayLink.h \
+    src/comm/MAVLinkDecodeWorker.h \
+    src/comm/MAVLinkMessageRouter.h \
     src/comm/MAVLinkProtocol.h \
     src/comm/QGCMAVLink.h \
     src/comm/TCPLink.h \
+    src/comm/TelemetryLogWriter.h \
     src/comm/UDPLink.h \
     src/comm/UdpIODevice.h \
     src/uas/UAS.h \
@@ -769,12 +828,17 @@ AndroidBuild {
 }
 
 SOURCES += \
+    src/ADSB/ADSBConflictEngine.cc \
+    src/ADSB/ADSBSpatialIndex.cc \
+    src/ADSB/ADSBTrafficGenerator.cc \
     src/ADSB/ADSBVehicle.cc \
     src/ADSB/ADSBVehicleManager.cc \
     src/AnalyzeView/LogDownloadController.cc \
     src/AnalyzeView/PX4LogParser.cc \
     src/AnalyzeView/ULogParser.cc \
+    src/AnalyzeView/ULogReader.cc \
     src/AnalyzeView/MavlinkConsoleController.cc \
+    src/AnalyzeView/VehicleLogDownloader.cc \
     src/Audio/AudioOutput.cc \
     src/Camera/QGCCameraControl.cc \
     src/Camera/QGCCameraIO.cc \
@@ -783,6 +847,7 @@ SOURCES += \
     src/FollowMe/FollowMe.cc \
     src/Joystick/Joystick.cc \
     src/Joystick/JoystickManager.cc \
+    src/Joystick/TimingHistogram.cc \
     src/JsonHelper.cc \
     src/KMLDomDocument.cc \
     src/KMLHelper.cc \
@@ -809,6 +874,7 @@ SOURCES += \
     src/MissionManager/PlanCreator.cc \
     src/MissionManager/PlanManager.cc \
     src/MissionManager/PlanMasterController.cc \
+    src/MissionManager/PolygonClipper.cc \
     src/MissionManager/QGCFenceCircle.cc \
     src/MissionManager/QGCFencePolygon.cc \
     src/MissionManager/QGCMapCircle.cc \
@@ -877,7 +943,9 @@ SOURCES += \
     src/Settings/VideoSettings.cc \
     src/ShapeFileHelper.cc \
     src/SHPFileHelper.cc \
+    src/Terrain/TerrainDEM.cc \
     src/Terrain/TerrainQuery.cc \
+    src/Terrain/TerrainTileStore.cc \
     src/TerrainTile.cc\
     src/Vehicle/GPSRTKFactGroup.cc \
     src/Vehicle/MAVLinkLogManager.cc \
@@ -890,11 +958,16 @@ SOURCES += \
     src/VehicleSetup/JoystickConfigController.cc \
     src/comm/LinkConfiguration.cc \
     src/comm/LinkInterface.cc \
+    src/comm/LinkSendQueue.cc \
     src/comm/LinkManager.cc \
+    src/comm/LogReplayIndex.cc \
     src/comm/LogReplayLink.cc \
+    src/comm/MAVLinkDecodeWorker.cc \
+    src/comm/MAVLinkMessageRouter.cc \
     src/comm/MAVLinkProtocol.cc \
     src/comm/QGCMAVLink.cc \
     src/comm/TCPLink.cc \
+    src/comm/TelemetryLogWriter.cc \
     src/comm/UDPLink.cc \
     src/comm/UdpIODevice.cc \
     src/main.cc \
@@ -0,0 +1,194 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBConflictEngine.h"
+
+#include <QHash>
+#include <QtMath>
+
+static constexpr double _metersPerDegree = 111320.0;
+
+typedef struct {
+    double minX;
+    double minY;
+    double maxX;
+    double maxY;
+} SweptBox_t;
+
+static double _wrapLongitudeDelta(double delta)
+{
+    while (delta >= 180.0) {
+        delta -= 360.0;
+    }
+    while (delta < -180.0) {
+        delta += 360.0;
+    }
+    return delta;
+}
+
+/// Velocity in east/north/up m/s, unknown components are treated as stationary
+static void _trackVelocity(const ADSBConflictEngine::Track_t& track, double& east, double& north, double& up)
+{
+    if (qIsNaN(track.velocity) || qIsNaN(track.heading)) {
+        east    = 0;
+        north   = 0;
+    } else {
+        double headingRadians = qDegreesToRadians(track.heading);
+        east    = track.velocity * qSin(headingRadians);
+        north   = track.velocity * qCos(headingRadians);
+    }
+    up = qIsNaN(track.verticalVelocity) ? 0 : track.verticalVelocity;
+}
+
+static quint64 _cellKey(int x, int y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+ADSBConflictEngine::Thresholds_t ADSBConflictEngine::defaultThresholds(void)
+{
+    Thresholds_t thresholds;
+
+    thresholds.lookaheadSecs        = 60;
+    thresholds.horizontalSeparation = 926;
+    thresholds.verticalSeparation   = 152;
+    thresholds.cellSize             = 5000;
+
+    return thresholds;
+}
+
+bool ADSBConflictEngine::closestApproach(const Track_t& target, const Track_t& vehicle, const Thresholds_t& thresholds, Conflict_t& conflict)
+{
+    // Local tangent plane at the vehicle, target relative to vehicle
+    double relativeX = _wrapLongitudeDelta(target.longitude - vehicle.longitude) * _metersPerDegree * qCos(qDegreesToRadians(vehicle.latitude));
+    double relativeY = (target.latitude - vehicle.latitude) * _metersPerDegree;
+
+    double targetEast, targetNorth, targetUp;
+    double vehicleEast, vehicleNorth, vehicleUp;
+    _trackVelocity(target, targetEast, targetNorth, targetUp);
+    _trackVelocity(vehicle, vehicleEast, vehicleNorth, vehicleUp);
+
+    double relativeVelocityX = targetEast - vehicleEast;
+    double relativeVelocityY = targetNorth - vehicleNorth;
+    double relativeSpeedSquared = (relativeVelocityX * relativeVelocityX) + (relativeVelocityY * relativeVelocityY);
+
+    double timeToClosest = 0;
+    if (relativeSpeedSquared > 1e-9) {
+        timeToClosest = -((relativeX * relativeVelocityX) + (relativeY * relativeVelocityY)) / relativeSpeedSquared;
+        timeToClosest = qBound(0.0, timeToClosest, thresholds.lookaheadSecs);
+    }
+
+    double closestDistance = qSqrt(qPow(relativeX + (relativeVelocityX * timeToClosest), 2) + qPow(relativeY + (relativeVelocityY * timeToClosest), 2));
+    if (closestDistance >= thresholds.horizontalSeparation) {
+        return false;
+    }
+
+    // Unknown altitude can't rule out a conflict
+    double altitudeDifference = qQNaN();
+    if (!qIsNaN(target.altitude) && !qIsNaN(vehicle.altitude)) {
+        altitudeDifference = (target.altitude + (targetUp * timeToClosest)) - (vehicle.altitude + (vehicleUp * timeToClosest));
+        if (qAbs(altitudeDifference) >= thresholds.verticalSeparation) {
+            return false;
+        }
+    }
+
+    conflict.icaoAddress        = target.id;
+    conflict.vehicleId          = static_cast<int>(vehicle.id);
+    conflict.timeToClosest      = timeToClosest;
+    conflict.closestDistance    = closestDistance;
+    conflict.altitudeDifference = altitudeDifference;
+
+    return true;
+}
+
+QList<ADSBConflictEngine::Conflict_t> ADSBConflictEngine::findConflicts(const QVector<Track_t>& targets, const QVector<Track_t>& vehicles, const Thresholds_t& thresholds, int* pairsChecked)
+{
+    QList<Conflict_t> conflicts;
+
+    if (pairsChecked) {
+        *pairsChecked = 0;
+    }
+    if (targets.isEmpty() || vehicles.isEmpty()) {
+        return conflicts;
+    }
+
+    // Pruning uses a single plane centered on the first vehicle. Scale error across the few hundred km of an ADSB
+    // receiver's range is well inside the separation padding, and surviving pairs are checked in their own plane.
+    double referenceLatitude    = vehicles[0].latitude;
+    double referenceLongitude   = vehicles[0].longitude;
+    double metersPerLonDegree   = _metersPerDegree * qMax(qCos(qDegreesToRadians(referenceLatitude)), 0.01);
+    double padding              = thresholds.horizontalSeparation;
+
+    auto sweptBox = [&](const Track_t& track) {
+        double x = _wrapLongitudeDelta(track.longitude - referenceLongitude) * metersPerLonDegree;
+        double y = (track.latitude - referenceLatitude) * _metersPerDegree;
+        double east, north, up;
+        _trackVelocity(track, east, north, up);
+        double endX = x + (east * thresholds.lookaheadSecs);
+        double endY = y + (north * thresholds.lookaheadSecs);
+
+        SweptBox_t box;
+        box.minX = qMin(x, endX) - padding;
+        box.maxX = qMax(x, endX) + padding;
+        box.minY = qMin(y, endY) - padding;
+        box.maxY = qMax(y, endY) + padding;
+        return box;
+    };
+    auto cell = [&](double coordinate) {
+        return qFloor(coordinate / thresholds.cellSize);
+    };
+
+    QVector<SweptBox_t>                 targetBoxes(targets.count());
+    QHash<quint64, QVector<int>>        grid;
+    for (int i = 0; i < targets.count(); i++) {
+        const SweptBox_t& box = targetBoxes[i] = sweptBox(targets[i]);
+        for (int x = cell(box.minX); x <= cell(box.maxX); x++) {
+            for (int y = cell(box.minY); y <= cell(box.maxY); y++) {
+                grid[_cellKey(x, y)].append(i);
+            }
+        }
+    }
+
+    // Last vehicle each target was checked against, targets span several cells
+    QVector<int> checkedBy(targets.count(), -1);
+    for (int vehicleIndex = 0; vehicleIndex < vehicles.count(); vehicleIndex++) {
+        const Track_t&  vehicle     = vehicles[vehicleIndex];
+        SweptBox_t      vehicleBox  = sweptBox(vehicle);
+
+        for (int x = cell(vehicleBox.minX); x <= cell(vehicleBox.maxX); x++) {
+            for (int y = cell(vehicleBox.minY); y <= cell(vehicleBox.maxY); y++) {
+                auto gridCell = grid.constFind(_cellKey(x, y));
+                if (gridCell == grid.constEnd()) {
+                    continue;
+                }
+                for (int targetIndex: gridCell.value()) {
+                    if (checkedBy[targetIndex] == vehicleIndex) {
+                        continue;
+                    }
+                    checkedBy[targetIndex] = vehicleIndex;
+
+                    const SweptBox_t& targetBox = targetBoxes[targetIndex];
+                    if (targetBox.maxX < vehicleBox.minX || targetBox.minX > vehicleBox.maxX || targetBox.maxY < vehicleBox.minY || targetBox.minY > vehicleBox.maxY) {
+                        continue;
+                    }
+
+                    if (pairsChecked) {
+                        (*pairsChecked)++;
+                    }
+                    Conflict_t conflict;
+                    if (closestApproach(targets[targetIndex], vehicle, thresholds, conflict)) {
+                        conflicts.append(conflict);
+                    }
+                }
+            }
+        }
+    }
+
+    return conflicts;
+}
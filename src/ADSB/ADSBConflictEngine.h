@@ -0,0 +1,59 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QList>
+#include <QVector>
+
+/// Closest point of approach prediction between ADSB traffic and our own vehicles. Everything is projected forward
+/// along a straight line at its current velocity. Pairs are pruned through a uniform grid over the area each track
+/// sweeps during the lookahead, so the cost grows with the number of tracks which are actually near each other
+/// rather than with targets * vehicles.
+///
+/// All methods are static and work on snapshots, so they can run on a worker thread.
+class ADSBConflictEngine
+{
+public:
+    typedef struct {
+        uint32_t    id;                 ///< ICAO address for targets, vehicle id for our vehicles
+        double      latitude;
+        double      longitude;
+        double      altitude;           ///< Meters AMSL, NaN if not known
+        double      heading;            ///< Degrees, NaN if not known
+        double      velocity;           ///< Horizontal m/s, NaN if not known
+        double      verticalVelocity;   ///< m/s positive up, NaN if not known
+    } Track_t;
+
+    typedef struct {
+        uint32_t    icaoAddress;
+        int         vehicleId;
+        double      timeToClosest;      ///< Seconds from the snapshot
+        double      closestDistance;    ///< Horizontal meters at closest approach
+        double      altitudeDifference; ///< Meters at closest approach, NaN if either altitude isn't known
+    } Conflict_t;
+
+    typedef struct {
+        double lookaheadSecs;           ///< How far ahead to project
+        double horizontalSeparation;    ///< Meters, closer than this is a conflict
+        double verticalSeparation;      ///< Meters, closer than this is a conflict
+        double cellSize;                ///< Meters, grid cell size used for pruning
+    } Thresholds_t;
+
+    /// Roughly 1/2 nm and 500ft over the next minute
+    static Thresholds_t defaultThresholds(void);
+
+    /// Finds every target/vehicle pair predicted to lose separation within the lookahead
+    ///     @param[out] pairsChecked Number of pairs which got past pruning, nullptr to ignore
+    static QList<Conflict_t> findConflicts(const QVector<Track_t>& targets, const QVector<Track_t>& vehicles, const Thresholds_t& thresholds, int* pairsChecked = nullptr);
+
+    /// Checks a single pair without pruning
+    /// @return true: pair is predicted to lose separation, conflict filled in
+    static bool closestApproach(const Track_t& target, const Track_t& vehicle, const Thresholds_t& thresholds, Conflict_t& conflict);
+};
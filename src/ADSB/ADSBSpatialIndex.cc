@@ -0,0 +1,119 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBSpatialIndex.h"
+
+#include <QtMath>
+
+// Meters per degree of latitude, close enough for picking cells. Candidates are checked with an exact distance.
+static constexpr double _metersPerDegree = 111320.0;
+
+ADSBSpatialIndex::ADSBSpatialIndex(double cellSizeDegrees)
+    : _cellSizeDegrees  (cellSizeDegrees)
+    , _lonCellCount     (qCeil(360.0 / cellSizeDegrees))
+{
+
+}
+
+int ADSBSpatialIndex::_latCell(double latitude) const
+{
+    return qFloor((latitude + 90.0) / _cellSizeDegrees);
+}
+
+int ADSBSpatialIndex::_lonCell(double longitude) const
+{
+    // Wrap so cells either side of the antimeridian are neighbours
+    int cell = qFloor((longitude + 180.0) / _cellSizeDegrees) % _lonCellCount;
+    return cell < 0 ? cell + _lonCellCount : cell;
+}
+
+quint64 ADSBSpatialIndex::_cellKey(int latCell, int lonCell) const
+{
+    return (static_cast<quint64>(static_cast<quint32>(latCell)) << 32) | static_cast<quint32>(lonCell);
+}
+
+void ADSBSpatialIndex::insert(uint32_t icaoAddress, const QGeoCoordinate& coordinate)
+{
+    quint64 cellKey = _cellKey(_latCell(coordinate.latitude()), _lonCell(coordinate.longitude()));
+
+    auto it = _entries.find(icaoAddress);
+    if (it != _entries.end()) {
+        it->coordinate = coordinate;
+        if (it->cellKey == cellKey) {
+            return;
+        }
+        QVector<uint32_t>& oldCell = _cells[it->cellKey];
+        oldCell.removeOne(icaoAddress);
+        if (oldCell.isEmpty()) {
+            _cells.remove(it->cellKey);
+        }
+        it->cellKey = cellKey;
+    } else {
+        _entries.insert(icaoAddress, { coordinate, cellKey });
+    }
+    _cells[cellKey].append(icaoAddress);
+}
+
+void ADSBSpatialIndex::remove(uint32_t icaoAddress)
+{
+    auto it = _entries.find(icaoAddress);
+    if (it == _entries.end()) {
+        return;
+    }
+
+    QVector<uint32_t>& cell = _cells[it->cellKey];
+    cell.removeOne(icaoAddress);
+    if (cell.isEmpty()) {
+        _cells.remove(it->cellKey);
+    }
+    _entries.erase(it);
+}
+
+void ADSBSpatialIndex::clear(void)
+{
+    _entries.clear();
+    _cells.clear();
+}
+
+QList<uint32_t> ADSBSpatialIndex::query(const QGeoCoordinate& coordinate, double radiusMeters) const
+{
+    QList<uint32_t> result;
+
+    if (!coordinate.isValid() || _entries.isEmpty()) {
+        return result;
+    }
+
+    double latSpan = radiusMeters / _metersPerDegree;
+    double cosLat = qCos(qDegreesToRadians(qMin(qAbs(coordinate.latitude()) + latSpan, 90.0)));
+    double lonSpan = cosLat > 1e-6 ? radiusMeters / (_metersPerDegree * cosLat) : 360.0;
+
+    int minLatCell = _latCell(qMax(coordinate.latitude() - latSpan, -90.0));
+    int maxLatCell = _latCell(qMin(coordinate.latitude() + latSpan, 90.0));
+    // Near the poles the span can cover every longitude cell, don't visit any cell twice
+    int lonCellSpan = lonSpan >= 180.0 ? _lonCellCount : qCeil(lonSpan / _cellSizeDegrees);
+    int lonCellCount = qMin((2 * lonCellSpan) + 1, _lonCellCount);
+    int firstLonCell = _lonCell(coordinate.longitude()) - lonCellSpan;
+
+    for (int latCell = minLatCell; latCell <= maxLatCell; latCell++) {
+        for (int i = 0; i < lonCellCount; i++) {
+            int lonCell = (((firstLonCell + i) % _lonCellCount) + _lonCellCount) % _lonCellCount;
+            auto cell = _cells.constFind(_cellKey(latCell, lonCell));
+            if (cell == _cells.constEnd()) {
+                continue;
+            }
+            for (uint32_t icaoAddress: cell.value()) {
+                if (_entries[icaoAddress].coordinate.distanceTo(coordinate) <= radiusMeters) {
+                    result.append(icaoAddress);
+                }
+            }
+        }
+    }
+
+    return result;
+}
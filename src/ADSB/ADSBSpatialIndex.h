@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QGeoCoordinate>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+/// Uniform lat/lon grid over ADSB targets, keyed by ICAO address. Proximity queries only look at the cells which
+/// overlap the search radius instead of every target in range of the receiver.
+class ADSBSpatialIndex
+{
+public:
+    /// @param cellSizeDegrees Cell size in latitude degrees, longitude cells are the same size
+    ADSBSpatialIndex(double cellSizeDegrees = _defaultCellSizeDegrees);
+
+    /// Adds the target, or moves it if it is already indexed
+    void insert (uint32_t icaoAddress, const QGeoCoordinate& coordinate);
+    void remove (uint32_t icaoAddress);
+    void clear  (void);
+
+    int  count  (void) const { return _entries.count(); }
+
+    /// @return ICAO addresses of all targets within radiusMeters of coordinate, ignoring altitude
+    QList<uint32_t> query(const QGeoCoordinate& coordinate, double radiusMeters) const;
+
+private:
+    typedef struct {
+        QGeoCoordinate  coordinate;
+        quint64         cellKey;
+    } Entry_t;
+
+    int     _latCell    (double latitude) const;
+    int     _lonCell    (double longitude) const;
+    quint64 _cellKey    (int latCell, int lonCell) const;
+
+    double                              _cellSizeDegrees;
+    int                                 _lonCellCount;
+    QHash<uint32_t, Entry_t>            _entries;
+    QHash<quint64, QVector<uint32_t>>   _cells;
+
+    static constexpr double _defaultCellSizeDegrees = 0.1;  ///< ~11km, a few cells cover a typical alert radius
+};
@@ -0,0 +1,111 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBTrafficGenerator.h"
+
+#include <QtMath>
+
+ADSBTrafficGenerator::ADSBTrafficGenerator(const QGeoCoordinate& center, double radiusMeters, int targetCount, quint32 seed)
+    : _center           (center)
+    , _radiusMeters     (radiusMeters)
+    , _random           (seed)
+    , _nextIcaoAddress  (0xA00000)
+{
+    _targets.resize(targetCount);
+    for (Target_t& target: _targets) {
+        _spawn(target, false);
+    }
+}
+
+void ADSBTrafficGenerator::_spawn(Target_t& target, bool onEdge)
+{
+    double azimuth = _random.bounded(360.0);
+    // sqrt gives an even spread over the area of the circle
+    double distance = onEdge ? _radiusMeters : _radiusMeters * qSqrt(_random.generateDouble());
+
+    target.icaoAddress      = _nextIcaoAddress++;
+    target.callsign         = QStringLiteral("SYN%1").arg(target.icaoAddress & 0xFFFF, 4, 16, QLatin1Char('0')).toUpper();
+    target.coordinate       = _center.atDistanceAndAzimuth(distance, azimuth);
+    target.altitude         = 150.0 + _random.bounded(12000.0);
+    target.velocity         = 30.0 + _random.bounded(220.0);
+    target.verticalVelocity = _random.bounded(20.0) - 10.0;
+    // Entering targets head roughly across the circle
+    target.heading          = onEdge ? fmod(azimuth + 180.0 + _random.bounded(90.0) - 45.0, 360.0) : _random.bounded(360.0);
+}
+
+void ADSBTrafficGenerator::step(double seconds)
+{
+    for (Target_t& target: _targets) {
+        target.coordinate   = target.coordinate.atDistanceAndAzimuth(target.velocity * seconds, target.heading);
+        target.altitude     = qBound(0.0, target.altitude + (target.verticalVelocity * seconds), 13000.0);
+        if (target.coordinate.distanceTo(_center) > _radiusMeters) {
+            _spawn(target, true);
+        }
+    }
+}
+
+QList<ADSBVehicle::VehicleInfo_t> ADSBTrafficGenerator::vehicleInfos(void) const
+{
+    QList<ADSBVehicle::VehicleInfo_t> vehicleInfos;
+
+    for (const Target_t& target: _targets) {
+        ADSBVehicle::VehicleInfo_t vehicleInfo;
+        vehicleInfo.icaoAddress         = target.icaoAddress;
+        vehicleInfo.callsign            = target.callsign;
+        vehicleInfo.location            = target.coordinate;
+        vehicleInfo.altitude            = target.altitude;
+        vehicleInfo.heading             = target.heading;
+        vehicleInfo.velocity            = target.velocity;
+        vehicleInfo.verticalVelocity    = target.verticalVelocity;
+        vehicleInfo.alert               = false;
+        vehicleInfo.availableFlags      = ADSBVehicle::CallsignAvailable | ADSBVehicle::LocationAvailable | ADSBVehicle::AltitudeAvailable | ADSBVehicle::HeadingAvailable | ADSBVehicle::VelocityAvailable;
+        vehicleInfos.append(vehicleInfo);
+    }
+
+    return vehicleInfos;
+}
+
+QVector<ADSBConflictEngine::Track_t> ADSBTrafficGenerator::tracks(void) const
+{
+    QVector<ADSBConflictEngine::Track_t> tracks;
+
+    tracks.reserve(_targets.count());
+    for (const Target_t& target: _targets) {
+        tracks.append({ target.icaoAddress, target.coordinate.latitude(), target.coordinate.longitude(), target.altitude, target.heading, target.velocity, target.verticalVelocity });
+    }
+
+    return tracks;
+}
+
+QByteArray ADSBTrafficGenerator::sbsMessages(void) const
+{
+    static const char* timestamp = "2020/01/01,00:00:00.000,2020/01/01,00:00:00.000";
+
+    QByteArray messages;
+    for (const Target_t& target: _targets) {
+        QByteArray icaoAddress = QByteArray::number(target.icaoAddress, 16).toUpper();
+        messages += QStringLiteral("MSG,3,1,1,%1,1,%2,%3,%4,,,%5,%6,,,0,0,0,0\r\n")
+                .arg(QString::fromLatin1(icaoAddress))
+                .arg(QLatin1String(timestamp))
+                .arg(target.callsign)
+                .arg(qRound(target.altitude / 0.3048))
+                .arg(target.coordinate.latitude(), 0, 'f', 5)
+                .arg(target.coordinate.longitude(), 0, 'f', 5)
+                .toLatin1();
+        messages += QStringLiteral("MSG,4,1,1,%1,1,%2,,,%3,%4,,,%5,,0,0,0,0\r\n")
+                .arg(QString::fromLatin1(icaoAddress))
+                .arg(QLatin1String(timestamp))
+                .arg(target.velocity / 0.514444, 0, 'f', 0)
+                .arg(target.heading, 0, 'f', 0)
+                .arg(qRound(target.verticalVelocity / 0.00508))
+                .toLatin1();
+    }
+
+    return messages;
+}
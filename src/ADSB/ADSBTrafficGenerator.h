@@ -0,0 +1,60 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "ADSBVehicle.h"
+#include "ADSBConflictEngine.h"
+
+#include <QGeoCoordinate>
+#include <QRandomGenerator>
+#include <QVector>
+
+/// Synthetic ADSB traffic for load testing. Targets fly straight lines at airliner to light aircraft speeds and
+/// altitudes within a circle. Targets which leave the circle are replaced by new ones entering it. The same seed
+/// always produces the same traffic.
+class ADSBTrafficGenerator
+{
+public:
+    ADSBTrafficGenerator(const QGeoCoordinate& center, double radiusMeters, int targetCount, quint32 seed = 1);
+
+    /// Moves all targets forward
+    void step(double seconds);
+
+    int count(void) const { return _targets.count(); }
+
+    /// Current state of all targets as ADSBVehicleManager updates
+    QList<ADSBVehicle::VehicleInfo_t> vehicleInfos(void) const;
+
+    /// Current state of all targets as conflict prediction input
+    QVector<ADSBConflictEngine::Track_t> tracks(void) const;
+
+    /// Current state of all targets as a SBS-1 feed, one MSG,3 (position) and one MSG,4 (velocity) line each
+    QByteArray sbsMessages(void) const;
+
+private:
+    typedef struct {
+        uint32_t        icaoAddress;
+        QString         callsign;
+        QGeoCoordinate  coordinate;
+        double          altitude;           ///< Meters AMSL
+        double          heading;            ///< Degrees
+        double          velocity;           ///< Horizontal m/s
+        double          verticalVelocity;   ///< m/s positive up
+    } Target_t;
+
+    /// @param onEdge true: start on the edge of the circle flying inwards, false: anywhere in the circle
+    void _spawn(Target_t& target, bool onEdge);
+
+    QGeoCoordinate      _center;
+    double              _radiusMeters;
+    QRandomGenerator    _random;
+    uint32_t            _nextIcaoAddress;
+    QVector<Target_t>   _targets;
+};
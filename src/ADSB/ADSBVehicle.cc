@@ -18,7 +18,10 @@ ADSBVehicle::ADSBVehicle(const VehicleInfo_t& vehicleInfo, QObject* parent)
     , _icaoAddress  (vehicleInfo.icaoAddress)
     , _altitude     (qQNaN())
     , _heading      (qQNaN())
-    , _alert        (false)
+    , _velocity     (qQNaN())
+    , _verticalVelocity(qQNaN())
+    , _sourceAlert  (false)
+    , _predictedAlert(false)
 {
     update(vehicleInfo);
 }
@@ -53,15 +56,31 @@ void ADSBVehicle::update(const VehicleInfo_t& vehicleInfo)
             emit headingChanged();
         }
     }
-    if (vehicleInfo.availableFlags & AlertAvailable) {
-        if (vehicleInfo.alert != _alert) {
-            _alert = vehicleInfo.alert;
+    if (vehicleInfo.availableFlags & VelocityAvailable) {
+        _velocity           = vehicleInfo.velocity;
+        _verticalVelocity   = vehicleInfo.verticalVelocity;
+    }
+    if (vehicleInfo.availableFlags & AlertAvailable && vehicleInfo.alert != _sourceAlert) {
+        bool oldAlert = alert();
+        _sourceAlert = vehicleInfo.alert;
+        if (alert() != oldAlert) {
             emit alertChanged();
         }
     }
     _lastUpdateTimer.restart();
 }
 
+void ADSBVehicle::setPredictedAlert(bool predictedAlert)
+{
+    if (predictedAlert != _predictedAlert) {
+        bool oldAlert = alert();
+        _predictedAlert = predictedAlert;
+        if (alert() != oldAlert) {
+            emit alertChanged();
+        }
+    }
+}
+
 bool ADSBVehicle::expired()
 {
     return _lastUpdateTimer.hasExpired(expirationTimeoutMs);
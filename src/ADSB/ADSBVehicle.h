@@ -26,6 +26,7 @@ public:
         AltitudeAvailable =     1 << 3,
         HeadingAvailable =      1 << 4,
         AlertAvailable =        1 << 5,
+        VelocityAvailable =     1 << 6,
     };
 
     typedef struct {
@@ -34,6 +35,8 @@ public:
         QGeoCoordinate  location;
         double          altitude;
         double          heading;
+        double          velocity;           // Horizontal, m/s
+        double          verticalVelocity;   // m/s, positive up
         bool            alert;
         uint32_t        availableFlags;
     } VehicleInfo_t;
@@ -52,10 +55,17 @@ public:
     QGeoCoordinate  coordinate  (void) const { return _coordinate; }
     double          altitude    (void) const { return _altitude; }
     double          heading     (void) const { return _heading; }
-    bool            alert       (void) const { return _alert; }
+    bool            alert       (void) const { return _sourceAlert || _predictedAlert; }
+
+    double          velocity        (void) const { return _velocity; }          ///< NaN for not available
+    double          verticalVelocity(void) const { return _verticalVelocity; }  ///< NaN for not available
 
     void update(const VehicleInfo_t& vehicleInfo);
 
+    /// Alerts raised by our own conflict prediction. Kept apart from the alert the source reports so clearing one
+    /// doesn't clear the other. Doesn't count as hearing from the vehicle.
+    void setPredictedAlert(bool predictedAlert);
+
     /// check if the vehicle is expired and should be removed
     bool expired();
 
@@ -72,7 +82,10 @@ private:
     QGeoCoordinate  _coordinate;
     double          _altitude;
     double          _heading;
-    bool            _alert;
+    double          _velocity;
+    double          _verticalVelocity;
+    bool            _sourceAlert;       ///< Reported by the ADSB source
+    bool            _predictedAlert;    ///< Raised by ADSBConflictEngine
 
     QElapsedTimer   _lastUpdateTimer;
 
@@ -12,8 +12,13 @@
 #include "QGCApplication.h"
 #include "SettingsManager.h"
 #include "ADSBVehicleManagerSettings.h"
+#include "MultiVehicleManager.h"
+#include "Vehicle.h"
 
 #include <QDebug>
+#include <QtConcurrent>
+
+#include <cstring>
 
 ADSBVehicleManager::ADSBVehicleManager(QGCApplication* app, QGCToolbox* toolbox)
     : QGCTool(app, toolbox)
@@ -28,10 +33,19 @@ void ADSBVehicleManager::setToolbox(QGCToolbox* toolbox)
     _adsbVehicleCleanupTimer.setSingleShot(false);
     _adsbVehicleCleanupTimer.start(1000);
 
+    connect(&_pendingUpdatesTimer, &QTimer::timeout, this, &ADSBVehicleManager::_flushPendingUpdates);
+    _pendingUpdatesTimer.setSingleShot(true);
+    _pendingUpdatesTimer.setInterval(_pendingUpdatesFlushMSecs);
+
+    connect(&_conflictCheckTimer, &QTimer::timeout, this, &ADSBVehicleManager::_checkConflicts);
+    connect(&_conflictWatcher, &QFutureWatcher<QList<ADSBConflictEngine::Conflict_t>>::finished, this, &ADSBVehicleManager::_conflictCheckComplete);
+    _conflictCheckTimer.setSingleShot(false);
+    _conflictCheckTimer.start(_conflictCheckMSecs);
+
     ADSBVehicleManagerSettings* settings = qgcApp()->toolbox()->settingsManager()->adsbVehicleManagerSettings();
     if (settings->adsbServerConnectEnabled()->rawValue().toBool()) {
         _tcpLink = new ADSBTCPLink(settings->adsbServerHostAddress()->rawValue().toString(), settings->adsbServerPort()->rawValue().toInt(), this);
-        connect(_tcpLink, &ADSBTCPLink::adsbVehicleUpdate,  this, &ADSBVehicleManager::adsbVehicleUpdate,   Qt::QueuedConnection);
+        connect(_tcpLink, &ADSBTCPLink::adsbVehicleUpdates, this, &ADSBVehicleManager::_adsbVehicleUpdates,  Qt::QueuedConnection);
         connect(_tcpLink, &ADSBTCPLink::error,              this, &ADSBVehicleManager::_tcpError,           Qt::QueuedConnection);
     }
 }
@@ -43,6 +57,9 @@ void ADSBVehicleManager::_cleanupStaleVehicles()
         ADSBVehicle* adsbVehicle = _adsbVehicles.value<ADSBVehicle*>(i);
         if (adsbVehicle->expired()) {
             qCDebug(ADSBVehicleManagerLog) << "Expired" << QStringLiteral("%1").arg(adsbVehicle->icaoAddress(), 0, 16);
+            uint32_t icaoAddress = static_cast<uint32_t>(adsbVehicle->icaoAddress());
+            _adsbICAOMap.remove(icaoAddress);
+            _spatialIndex.remove(icaoAddress);
             _adsbVehicles.removeAt(i);
             adsbVehicle->deleteLater();
         }
@@ -51,17 +68,149 @@ void ADSBVehicleManager::_cleanupStaleVehicles()
 
 void ADSBVehicleManager::adsbVehicleUpdate(const ADSBVehicle::VehicleInfo_t vehicleInfo)
 {
-    uint32_t icaoAddress = vehicleInfo.icaoAddress;
-
-    if (_adsbICAOMap.contains(icaoAddress)) {
-        _adsbICAOMap[icaoAddress]->update(vehicleInfo);
+    auto it = _pendingUpdates.find(vehicleInfo.icaoAddress);
+    if (it == _pendingUpdates.end()) {
+        _pendingUpdates.insert(vehicleInfo.icaoAddress, vehicleInfo);
     } else {
+        // Merge into the queued update, newest value wins for each piece of information
+        ADSBVehicle::VehicleInfo_t& pending = it.value();
+        if (vehicleInfo.availableFlags & ADSBVehicle::CallsignAvailable) {
+            pending.callsign = vehicleInfo.callsign;
+        }
         if (vehicleInfo.availableFlags & ADSBVehicle::LocationAvailable) {
-            ADSBVehicle* adsbVehicle = new ADSBVehicle(vehicleInfo, this);
+            pending.location = vehicleInfo.location;
+        }
+        if (vehicleInfo.availableFlags & ADSBVehicle::AltitudeAvailable) {
+            pending.altitude = vehicleInfo.altitude;
+        }
+        if (vehicleInfo.availableFlags & ADSBVehicle::HeadingAvailable) {
+            pending.heading = vehicleInfo.heading;
+        }
+        if (vehicleInfo.availableFlags & ADSBVehicle::VelocityAvailable) {
+            pending.velocity            = vehicleInfo.velocity;
+            pending.verticalVelocity    = vehicleInfo.verticalVelocity;
+        }
+        if (vehicleInfo.availableFlags & ADSBVehicle::AlertAvailable) {
+            pending.alert = vehicleInfo.alert;
+        }
+        pending.availableFlags |= vehicleInfo.availableFlags;
+    }
+
+    if (!_pendingUpdatesTimer.isActive()) {
+        _pendingUpdatesTimer.start();
+    }
+}
+
+void ADSBVehicleManager::_adsbVehicleUpdates(const QList<ADSBVehicle::VehicleInfo_t> vehicleInfos)
+{
+    for (const ADSBVehicle::VehicleInfo_t& vehicleInfo: vehicleInfos) {
+        adsbVehicleUpdate(vehicleInfo);
+    }
+}
+
+void ADSBVehicleManager::_flushPendingUpdates(void)
+{
+    for (const ADSBVehicle::VehicleInfo_t& vehicleInfo: _pendingUpdates) {
+        uint32_t icaoAddress = vehicleInfo.icaoAddress;
+
+        ADSBVehicle* adsbVehicle = _adsbICAOMap.value(icaoAddress, nullptr);
+        if (adsbVehicle) {
+            adsbVehicle->update(vehicleInfo);
+        } else if (vehicleInfo.availableFlags & ADSBVehicle::LocationAvailable) {
+            adsbVehicle = new ADSBVehicle(vehicleInfo, this);
             _adsbICAOMap[icaoAddress] = adsbVehicle;
             _adsbVehicles.append(adsbVehicle);
+        } else {
+            continue;
+        }
+
+        if (vehicleInfo.availableFlags & ADSBVehicle::LocationAvailable) {
+            _spatialIndex.insert(icaoAddress, vehicleInfo.location);
         }
     }
+    _pendingUpdates.clear();
+}
+
+void ADSBVehicleManager::_checkConflicts(void)
+{
+    if (_conflictWatcher.isRunning()) {
+        // Previous check hasn't finished, skip rather than queue up behind it
+        qCDebug(ADSBVehicleManagerLog) << "Conflict check still running, skipping";
+        return;
+    }
+
+    QVector<ADSBConflictEngine::Track_t> vehicles;
+    QmlObjectListModel* vehicleList = _toolbox->multiVehicleManager()->vehicles();
+    for (int i = 0; i < vehicleList->count(); i++) {
+        Vehicle* vehicle = vehicleList->value<Vehicle*>(i);
+        QGeoCoordinate coordinate = vehicle->coordinate();
+        if (coordinate.isValid()) {
+            vehicles.append({ static_cast<uint32_t>(vehicle->id()),
+                              coordinate.latitude(),
+                              coordinate.longitude(),
+                              vehicle->altitudeAMSL()->rawValue().toDouble(),
+                              vehicle->heading()->rawValue().toDouble(),
+                              vehicle->groundSpeed()->rawValue().toDouble(),
+                              vehicle->climbRate()->rawValue().toDouble() });
+        }
+    }
+
+    if (vehicles.isEmpty() || _adsbICAOMap.isEmpty()) {
+        _applyConflicts(QList<ADSBConflictEngine::Conflict_t>());
+        return;
+    }
+
+    QVector<ADSBConflictEngine::Track_t> targets;
+    targets.reserve(_adsbICAOMap.count());
+    for (ADSBVehicle* adsbVehicle: _adsbICAOMap) {
+        QGeoCoordinate coordinate = adsbVehicle->coordinate();
+        targets.append({ static_cast<uint32_t>(adsbVehicle->icaoAddress()),
+                         coordinate.latitude(),
+                         coordinate.longitude(),
+                         adsbVehicle->altitude(),
+                         adsbVehicle->heading(),
+                         adsbVehicle->velocity(),
+                         adsbVehicle->verticalVelocity() });
+    }
+
+    _conflictWatcher.setFuture(QtConcurrent::run(&ADSBConflictEngine::findConflicts, targets, vehicles, ADSBConflictEngine::defaultThresholds(), static_cast<int*>(nullptr)));
+}
+
+void ADSBVehicleManager::_conflictCheckComplete(void)
+{
+    _applyConflicts(_conflictWatcher.result());
+}
+
+void ADSBVehicleManager::_applyConflicts(const QList<ADSBConflictEngine::Conflict_t>& conflicts)
+{
+    QSet<QPair<int, uint32_t>>  currentConflicts;
+    QSet<uint32_t>              alertAddresses;
+
+    for (const ADSBConflictEngine::Conflict_t& conflict: conflicts) {
+        QPair<int, uint32_t> pair(conflict.vehicleId, conflict.icaoAddress);
+        currentConflicts.insert(pair);
+        alertAddresses.insert(conflict.icaoAddress);
+        if (!_conflicts.contains(pair)) {
+            qCDebug(ADSBVehicleManagerLog) << "Conflict vehicle:icao" << conflict.vehicleId << QStringLiteral("%1").arg(conflict.icaoAddress, 0, 16)
+                                           << "time" << conflict.timeToClosest << "distance" << conflict.closestDistance << "altitude difference" << conflict.altitudeDifference;
+            emit trafficConflict(conflict.vehicleId, static_cast<int>(conflict.icaoAddress), conflict.timeToClosest, conflict.closestDistance);
+        }
+    }
+    _conflicts = currentConflicts;
+
+    // Targets may have expired while the check ran, only touch ones which are still around
+    for (auto it = _adsbICAOMap.constBegin(); it != _adsbICAOMap.constEnd(); it++) {
+        it.value()->setPredictedAlert(alertAddresses.contains(it.key()));
+    }
+}
+
+QList<ADSBVehicle*> ADSBVehicleManager::vehiclesNear(const QGeoCoordinate& coordinate, double radiusMeters) const
+{
+    QList<ADSBVehicle*> vehicles;
+    for (uint32_t icaoAddress: _spatialIndex.query(coordinate, radiusMeters)) {
+        vehicles.append(_adsbICAOMap.value(icaoAddress));
+    }
+    return vehicles;
 }
 
 void ADSBVehicleManager::_tcpError(const QString errorMsg)
@@ -118,73 +267,131 @@ void ADSBTCPLink::_hardwareConnect()
 
 void ADSBTCPLink::_readBytes(void)
 {
-    if (_socket) {
-        QByteArray bytes = _socket->readLine();
-        _parseLine(QString::fromLocal8Bit(bytes));
+    if (!_socket) {
+        return;
+    }
+
+    // Drain every complete line, a busy feed delivers many per readyRead. A partial line stays buffered in the socket.
+    QList<ADSBVehicle::VehicleInfo_t> vehicleInfos;
+    char line[_maxLineLength];
+    while (_socket->canReadLine()) {
+        qint64 length = _socket->readLine(line, sizeof(line));
+        if (length <= 0) {
+            break;
+        }
+        ADSBVehicle::VehicleInfo_t vehicleInfo;
+        if (parseLine(line, static_cast<int>(length), vehicleInfo)) {
+            vehicleInfos.append(vehicleInfo);
+        }
+    }
+
+    if (!vehicleInfos.isEmpty()) {
+        emit adsbVehicleUpdates(vehicleInfos);
     }
 }
 
-void ADSBTCPLink::_parseLine(const QString& line)
+bool ADSBTCPLink::parseLine(const char* line, int length, ADSBVehicle::VehicleInfo_t& vehicleInfo)
 {
-    if (line.startsWith(QStringLiteral("MSG"))) {
-        qCDebug(ADSBVehicleManagerLog) << "ADSB SBS-1" << line;
+    // MSG,type,session,aircraft,icao,flight,date,time,date,time,callsign,altitude,speed,track,lat,lon,verticalRate,...
+    static const int    fieldCount = 17;
+    const char*         fields[fieldCount];
+    int                 fieldLengths[fieldCount];
 
-        QStringList values = line.split(QStringLiteral(","));
+    if (length < 4 || strncmp(line, "MSG,", 4) != 0) {
+        return false;
+    }
+
+    // Strip the line ending
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        length--;
+    }
+
+    int field = 0;
+    const char* fieldStart = line;
+    const char* end = line + length;
+    for (const char* p = line; p <= end && field < fieldCount; p++) {
+        if (p == end || *p == ',') {
+            fields[field]       = fieldStart;
+            fieldLengths[field] = static_cast<int>(p - fieldStart);
+            field++;
+            fieldStart = p + 1;
+        }
+    }
+    if (field < 5 || fieldLengths[1] != 1) {
+        return false;
+    }
 
-        if (values[1] == QStringLiteral("3")) {
-            bool icaoOk, altOk, latOk, lonOk;
+    auto fieldBytes = [&](int index) {
+        return index < field ? QByteArray::fromRawData(fields[index], fieldLengths[index]) : QByteArray();
+    };
 
-            uint32_t    icaoAddress =   values[4].toUInt(&icaoOk, 16);
-            int         modeCAltitude = values[11].toInt(&altOk);
-            double      lat =           values[14].toDouble(&latOk);
-            double      lon =           values[15].toDouble(&lonOk);
-            QString     callsign =      values[10];
+    bool icaoOk;
+    vehicleInfo.icaoAddress     = fieldBytes(4).toUInt(&icaoOk, 16);
+    vehicleInfo.availableFlags  = 0;
+    if (!icaoOk) {
+        return false;
+    }
 
-            if (!icaoOk || !altOk || !latOk || !lonOk) {
-                return;
-            }
-            if (lat == 0 && lon == 0) {
-                return;
-            }
+    switch (fields[1][0]) {
+    case '1':
+        if (field <= 10) {
+            return false;
+        }
+        vehicleInfo.callsign        = QString::fromLatin1(fields[10], fieldLengths[10]);
+        vehicleInfo.availableFlags  = ADSBVehicle::CallsignAvailable;
+        return true;
 
-            double altitude = modeCAltitude / 3.048;
-            QGeoCoordinate location(lat, lon);
+    case '3':
+    {
+        bool altOk, latOk, lonOk;
 
-            ADSBVehicle::VehicleInfo_t adsbInfo;
-            adsbInfo.icaoAddress = icaoAddress;
-            adsbInfo.callsign = callsign;
-            adsbInfo.location = location;
-            adsbInfo.altitude = altitude;
-            adsbInfo.availableFlags = ADSBVehicle::CallsignAvailable | ADSBVehicle::LocationAvailable | ADSBVehicle::AltitudeAvailable;
-            emit adsbVehicleUpdate(adsbInfo);
-        } else if (values[1] == QStringLiteral("4")) {
-            bool icaoOk, headingOk;
+        int     modeCAltitude = fieldBytes(11).toInt(&altOk);
+        double  lat =           fieldBytes(14).toDouble(&latOk);
+        double  lon =           fieldBytes(15).toDouble(&lonOk);
 
-            uint32_t    icaoAddress =   values[4].toUInt(&icaoOk, 16);
-            double      heading =       values[13].toDouble(&headingOk);
+        if (!altOk || !latOk || !lonOk) {
+            return false;
+        }
+        if (lat == 0 && lon == 0) {
+            return false;
+        }
 
-            if (!icaoOk || !headingOk) {
-                return;
-            }
+        vehicleInfo.location        = QGeoCoordinate(lat, lon);
+        vehicleInfo.altitude        = modeCAltitude * 0.3048;  // feet
+        vehicleInfo.availableFlags  = ADSBVehicle::LocationAvailable | ADSBVehicle::AltitudeAvailable;
+        // Most feeds leave the callsign empty here, don't let that wipe out the one from MSG,1
+        if (fieldLengths[10] > 0) {
+            vehicleInfo.callsign        = QString::fromLatin1(fields[10], fieldLengths[10]);
+            vehicleInfo.availableFlags  |= ADSBVehicle::CallsignAvailable;
+        }
+        return true;
+    }
 
-            ADSBVehicle::VehicleInfo_t adsbInfo;
-            adsbInfo.icaoAddress = icaoAddress;
-            adsbInfo.heading = heading;
-            adsbInfo.availableFlags = ADSBVehicle::HeadingAvailable;
-            emit adsbVehicleUpdate(adsbInfo);
-        } else if (values[1] == QStringLiteral("1")) {
-            bool icaoOk;
+    case '4':
+    {
+        bool headingOk;
 
-            uint32_t icaoAddress = values[4].toUInt(&icaoOk, 16);
-            if (!icaoOk) {
-                return;
-            }
+        double heading = fieldBytes(13).toDouble(&headingOk);
+        if (!headingOk) {
+            return false;
+        }
 
-            ADSBVehicle::VehicleInfo_t adsbInfo;
-            adsbInfo.icaoAddress = icaoAddress;
-            adsbInfo.callsign = values[10];
-            adsbInfo.availableFlags = ADSBVehicle::CallsignAvailable;
-            emit adsbVehicleUpdate(adsbInfo);
+        vehicleInfo.heading         = heading;
+        vehicleInfo.availableFlags  = ADSBVehicle::HeadingAvailable;
+
+        // Ground speed in knots, vertical rate in feet/minute
+        bool speedOk, verticalRateOk;
+        double speed        = fieldBytes(12).toDouble(&speedOk);
+        double verticalRate = fieldBytes(16).toDouble(&verticalRateOk);
+        if (speedOk) {
+            vehicleInfo.velocity            = speed * 0.514444;
+            vehicleInfo.verticalVelocity    = verticalRateOk ? verticalRate * 0.00508 : 0;
+            vehicleInfo.availableFlags      |= ADSBVehicle::VelocityAvailable;
         }
+        return true;
+    }
+
+    default:
+        return false;
     }
 }
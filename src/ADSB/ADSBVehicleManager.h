@@ -12,11 +12,15 @@
 #include "QGCToolbox.h"
 #include "QmlObjectListModel.h"
 #include "ADSBVehicle.h"
+#include "ADSBSpatialIndex.h"
+#include "ADSBConflictEngine.h"
 
 #include <QThread>
 #include <QTcpSocket>
 #include <QTimer>
 #include <QGeoCoordinate>
+#include <QFutureWatcher>
+#include <QSet>
 
 class ADSBVehicleManagerSettings;
 
@@ -28,8 +32,13 @@ public:
     ADSBTCPLink(const QString& hostAddress, int port, QObject* parent);
     ~ADSBTCPLink();
 
+    /// Parses a single SBS-1 (BaseStation) line in place, without splitting it into strings
+    /// @return false: not a message type which carries vehicle information, or malformed
+    static bool parseLine(const char* line, int length, ADSBVehicle::VehicleInfo_t& vehicleInfo);
+
 signals:
-    void adsbVehicleUpdate(const ADSBVehicle::VehicleInfo_t vehicleInfo);
+    /// All the updates from one read of the socket
+    void adsbVehicleUpdates(const QList<ADSBVehicle::VehicleInfo_t> vehicleInfos);
     void error(const QString errorMsg);
 
 protected:
@@ -40,11 +49,12 @@ private slots:
 
 private:
     void _hardwareConnect(void);
-    void _parseLine(const QString& line);
 
     QString         _hostAddress;
     int             _port;
     QTcpSocket*     _socket =   nullptr;
+
+    static const int _maxLineLength = 512;  ///< SBS-1 lines are around 120 characters
 };
 
 class ADSBVehicleManager : public QGCTool {
@@ -57,19 +67,44 @@ public:
 
     QmlObjectListModel* adsbVehicles(void) { return &_adsbVehicles; }
 
+    /// @return Targets within radiusMeters of coordinate, ignoring altitude
+    QList<ADSBVehicle*> vehiclesNear(const QGeoCoordinate& coordinate, double radiusMeters) const;
+
     // QGCTool overrides
     void setToolbox(QGCToolbox* toolbox) final;
 
+signals:
+    /// A target is newly predicted to lose separation with one of our vehicles
+    void trafficConflict(int vehicleId, int icaoAddress, double timeToClosest, double closestDistance);
+
 public slots:
+    /// Updates are queued, coalesced per vehicle and applied on the next flush
     void adsbVehicleUpdate  (const ADSBVehicle::VehicleInfo_t vehicleInfo);
     void _tcpError          (const QString errorMsg);
 
 private slots:
-    void _cleanupStaleVehicles(void);
+    void _cleanupStaleVehicles  (void);
+    void _adsbVehicleUpdates    (const QList<ADSBVehicle::VehicleInfo_t> vehicleInfos);
+    void _flushPendingUpdates   (void);
+    void _checkConflicts        (void);
+    void _conflictCheckComplete (void);
 
 private:
-    QmlObjectListModel              _adsbVehicles;
-    QMap<uint32_t, ADSBVehicle*>    _adsbICAOMap;
-    QTimer                          _adsbVehicleCleanupTimer;
-    ADSBTCPLink*                    _tcpLink = nullptr;
+    friend class ADSBVehicleManagerTest;
+
+    void _applyConflicts(const QList<ADSBConflictEngine::Conflict_t>& conflicts);
+
+    QmlObjectListModel                          _adsbVehicles;
+    QMap<uint32_t, ADSBVehicle*>                _adsbICAOMap;
+    QHash<uint32_t, ADSBVehicle::VehicleInfo_t> _pendingUpdates;
+    ADSBSpatialIndex                            _spatialIndex;
+    QTimer                                      _adsbVehicleCleanupTimer;
+    QTimer                                      _pendingUpdatesTimer;
+    ADSBTCPLink*                                _tcpLink = nullptr;
+    QTimer                                      _conflictCheckTimer;
+    QFutureWatcher<QList<ADSBConflictEngine::Conflict_t>> _conflictWatcher;
+    QSet<QPair<int, uint32_t>>                  _conflicts;             ///< vehicle id, ICAO address
+
+    static const int _pendingUpdatesFlushMSecs = 100;   ///< Targets update at a few Hz, the map doesn't need more
+    static const int _conflictCheckMSecs = 1000;        ///< Alert latency is at most this plus one check
 };
@@ -13,6 +13,38 @@ ExifParser::~ExifParser()
 
 }
 
+bool ExifParser::readHeader(QIODevice& file, QByteArray& header)
+{
+    header = file.read(2);
+    if (header != QByteArray("\xff\xd8", 2)) {
+        return false;
+    }
+
+    // Walk the marker segments. APP1 normally follows SOI, or APP0 for JFIF files.
+    while (true) {
+        QByteArray marker = file.read(4);
+        if (marker.size() != 4 || static_cast<uchar>(marker[0]) != 0xff) {
+            return false;
+        }
+        uchar markerType = static_cast<uchar>(marker[1]);
+        if (markerType == 0xda) {
+            // Start of scan, no EXIF
+            return false;
+        }
+        // Segment length includes the length bytes
+        int segmentLength = qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(marker.constData() + 2)) - 2;
+        QByteArray segment = file.read(segmentLength);
+        if (segmentLength < 0 || segment.size() != segmentLength) {
+            return false;
+        }
+        header.append(marker);
+        header.append(segment);
+        if (markerType == 0xe1) {
+            return true;
+        }
+    }
+}
+
 double ExifParser::readTime(QByteArray& buf)
 {
     QByteArray tiffHeader("\x49\x49\x2A", 3);
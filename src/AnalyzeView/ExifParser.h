@@ -3,6 +3,7 @@
 
 #include <QGeoCoordinate>
 #include <QDebug>
+#include <QIODevice>
 
 #include "GeoTagController.h"
 
@@ -11,6 +12,12 @@ class ExifParser
 public:
     ExifParser();
     ~ExifParser();
+
+    /// Reads the start of a JPEG up to the end of the APP1 (EXIF) segment, leaving the file positioned on the image
+    /// data which follows it. readTime and write only need this part of the file.
+    /// @return false: not a JPEG, or no APP1 segment ahead of the image data
+    static bool readHeader(QIODevice& file, QByteArray& header);
+
     double readTime(QByteArray& buf);
     bool write(QByteArray& buf, GeoTagWorker::cameraFeedbackPacket& geotag);
 };
@@ -15,19 +15,24 @@
 #include <cfloat>
 #include <QDir>
 #include <QUrl>
+#include <QtConcurrent>
 
 #include "ExifParser.h"
 #include "ULogParser.h"
+#include "ULogReader.h"
 #include "PX4LogParser.h"
 
 static const char* kTagged = "/TAGGED";
 
+Q_GLOBAL_STATIC(QThreadPool, _geoTagPool)
+
 GeoTagController::GeoTagController()
     : _progress(0)
     , _inProgress(false)
 {
     connect(&_worker, &GeoTagWorker::progressChanged,   this, &GeoTagController::_workerProgressChanged);
     connect(&_worker, &GeoTagWorker::error,             this, &GeoTagController::_workerError);
+    connect(&_worker, &GeoTagWorker::imagesSkipped,     this, &GeoTagController::_workerImagesSkipped);
     connect(&_worker, &GeoTagWorker::started,           this, &GeoTagController::inProgressChanged);
     connect(&_worker, &GeoTagWorker::finished,          this, &GeoTagController::inProgressChanged);
 }
@@ -126,6 +131,10 @@ void GeoTagController::_workerError(QString errorMessage)
     emit errorMessageChanged(errorMessage);
 }
 
+void GeoTagController::_workerImagesSkipped(QStringList fileNames)
+{
+    _setErrorMessage(tr("Images without EXIF data were not tagged: %1").arg(fileNames.join(QStringLiteral(", "))));
+}
 
 void GeoTagController::_setErrorMessage(const QString& error)
 {
@@ -134,14 +143,14 @@ void GeoTagController::_setErrorMessage(const QString& error)
 }
 
 GeoTagWorker::GeoTagWorker()
-    : _cancel(false)
+    : _cancel(0)
 {
 
 }
 
 void GeoTagWorker::run()
 {
-    _cancel = false;
+    _cancel.storeRelease(0);
     emit progressChanged(1);
     double nSteps = 5;
 
@@ -160,55 +169,69 @@ void GeoTagWorker::run()
     }
     emit progressChanged((100/nSteps));
 
-    // Parse EXIF
-    ExifParser exifParser;
-    _imageTime.clear();
-    for (int i = 0; i < _imageList.size(); ++i) {
-        QFile file(_imageList.at(i).absoluteFilePath());
+    // Parse EXIF. Images without an EXIF header are skipped rather than failing the run, they keep their slot in
+    // the image list so the trigger image sequence numbers still line up.
+    QVector<double> imageTime(_imageList.count());
+    QVector<bool>   imageSkipped(_imageList.count(), false);
+    double*         imageTimeData = imageTime.data();
+    bool*           imageSkippedData = imageSkipped.data();
+    QString         errorString;
+    bool            parsed = _runParallel(_imageList.count(), [this, imageTimeData, imageSkippedData](int index, QString& taskError) {
+        QFile file(_imageList.at(index).absoluteFilePath());
+        QByteArray header;
         if (!file.open(QIODevice::ReadOnly)) {
-            emit error(tr("Geotagging failed. Couldn't open an image."));
-            return;
+            taskError = tr("Geotagging failed. Couldn't open an image.");
+            return false;
         }
-        QByteArray imageBuffer = file.readAll();
-        file.close();
-
-        _imageTime.append(exifParser.readTime(imageBuffer));
-
-        emit progressChanged((100/nSteps) + ((100/nSteps) / _imageList.size())*i);
-
-        if (_cancel) {
-            qCDebug(GeotaggingLog) << "Tagging cancelled";
-            emit error(tr("Tagging cancelled"));
-            return;
+        if (!ExifParser::readHeader(file, header)) {
+            qCWarning(GeotaggingLog) << "No EXIF header, skipping" << file.fileName();
+            imageSkippedData[index] = true;
+            imageTimeData[index] = qQNaN();
+            return true;
         }
-    }
+        imageTimeData[index] = ExifParser().readTime(header);
+        return true;
+    }, (100/nSteps), (100/nSteps), errorString);
 
-    // Load log
-    bool isULog = _logFile.endsWith(".ulg", Qt::CaseSensitive);
-    QFile file(_logFile);
-    if (!file.open(QIODevice::ReadOnly)) {
-        emit error(tr("Geotagging failed. Couldn't open log file."));
+    if (_cancel.loadAcquire()) {
+        qCDebug(GeotaggingLog) << "Tagging cancelled";
+        emit error(tr("Tagging cancelled"));
+        return;
+    }
+    if (!parsed) {
+        emit error(errorString);
         return;
     }
-    QByteArray log = file.readAll();
-    file.close();
+    _imageTime = imageTime.toList();
 
-    // Instantiate appropriate parser
+    // Load log and instantiate appropriate parser
+    bool isULog = _logFile.endsWith(".ulg", Qt::CaseSensitive);
     _triggerList.clear();
     bool parseComplete = false;
-    QString errorString;
     if (isULog) {
-        ULogParser parser;
-        parseComplete = parser.getTagsFromLog(log, _triggerList, errorString);
+        // ULogs of long flights run into gigabytes, they are mapped and indexed rather than loaded
+        ULogReader reader;
+        if (reader.open(_logFile, errorString)) {
+            ULogParser parser;
+            parseComplete = parser.getTagsFromLog(reader, _triggerList, errorString);
+        }
 
     } else {
+        QFile file(_logFile);
+        if (!file.open(QIODevice::ReadOnly)) {
+            emit error(tr("Geotagging failed. Couldn't open log file."));
+            return;
+        }
+        QByteArray log = file.readAll();
+        file.close();
+
         PX4LogParser parser;
         parseComplete = parser.getTagsFromLog(log, _triggerList);
 
     }
 
     if (!parseComplete) {
-        if (_cancel) {
+        if (_cancel.loadAcquire()) {
             qCDebug(GeotaggingLog) << "Tagging cancelled";
             emit error(tr("Tagging cancelled"));
             return;
@@ -223,7 +246,7 @@ void GeoTagWorker::run()
 
     qCDebug(GeotaggingLog) << "Found " << _triggerList.count() << " trigger logs.";
 
-    if (_cancel) {
+    if (_cancel.loadAcquire()) {
         qCDebug(GeotaggingLog) << "Tagging cancelled";
         emit error(tr("Tagging cancelled"));
         return;
@@ -237,7 +260,7 @@ void GeoTagWorker::run()
     }
     emit progressChanged(4*(100/nSteps));
 
-    if (_cancel) {
+    if (_cancel.loadAcquire()) {
         qCDebug(GeotaggingLog) << "Tagging cancelled";
         emit error(tr("Tagging cancelled"));
         return;
@@ -246,55 +269,113 @@ void GeoTagWorker::run()
     // Tag images
     int maxIndex = std::min(_imageIndices.count(), _triggerIndices.count());
     maxIndex = std::min(maxIndex, _imageList.count());
-    for(int i = 0; i < maxIndex; i++) {
-        int imageIndex = _imageIndices[i];
+    bool tagged = _runParallel(maxIndex, [this, imageSkippedData](int index, QString& taskError) {
+        int imageIndex = _imageIndices.at(index);
         if (imageIndex >= _imageList.count()) {
-            emit error(tr("Geotagging failed. Requesting image #%1, but only %2 images present.").arg(imageIndex).arg(_imageList.count()));
-            return;
+            taskError = tr("Geotagging failed. Requesting image #%1, but only %2 images present.").arg(imageIndex).arg(_imageList.count());
+            return false;
         }
-        QFile fileRead(_imageList.at(_imageIndices[i]).absoluteFilePath());
+        if (imageSkippedData[imageIndex]) {
+            return true;
+        }
+        QFile fileRead(_imageList.at(imageIndex).absoluteFilePath());
+        QByteArray header;
         if (!fileRead.open(QIODevice::ReadOnly)) {
-            emit error(tr("Geotagging failed. Couldn't open an image."));
-            return;
+            taskError = tr("Geotagging failed. Couldn't open an image.");
+            return false;
+        }
+        if (!ExifParser::readHeader(fileRead, header)) {
+            qCWarning(GeotaggingLog) << "No EXIF header, skipping" << fileRead.fileName();
+            imageSkippedData[imageIndex] = true;
+            return true;
         }
-        QByteArray imageBuffer = fileRead.readAll();
-        fileRead.close();
 
-        if (!exifParser.write(imageBuffer, _triggerList[_triggerIndices[i]])) {
-            emit error(tr("Geotagging failed. Couldn't write to image."));
-            return;
+        // Only the EXIF header is rewritten, the image data which follows is streamed across unchanged
+        cameraFeedbackPacket geotag = _triggerList.at(_triggerIndices.at(index));
+        if (!ExifParser().write(header, geotag)) {
+            taskError = tr("Geotagging failed. Couldn't write to image.");
+            return false;
+        }
+        QFile fileWrite;
+        if(_saveDirectory == "") {
+            fileWrite.setFileName(_imageDirectory + "/TAGGED/" + _imageList.at(imageIndex).fileName());
         } else {
-            QFile fileWrite;
-            if(_saveDirectory == "") {
-                fileWrite.setFileName(_imageDirectory + "/TAGGED/" + _imageList.at(_imageIndices[i]).fileName());
-            } else {
-                fileWrite.setFileName(_saveDirectory + "/" + _imageList.at(_imageIndices[i]).fileName());
-            }
-            if (!fileWrite.open(QFile::WriteOnly)) {
-                emit error(tr("Geotagging failed. Couldn't write to an image."));
-                return;
+            fileWrite.setFileName(_saveDirectory + "/" + _imageList.at(imageIndex).fileName());
+        }
+        if (!fileWrite.open(QFile::WriteOnly) || fileWrite.write(header) != header.size()) {
+            taskError = tr("Geotagging failed. Couldn't write to an image.");
+            return false;
+        }
+        while (!fileRead.atEnd()) {
+            QByteArray chunk = fileRead.read(_copyChunkSize);
+            if (chunk.isEmpty() || fileWrite.write(chunk) != chunk.size()) {
+                taskError = tr("Geotagging failed. Couldn't write to an image.");
+                return false;
             }
-            fileWrite.write(imageBuffer);
-            fileWrite.close();
         }
-        emit progressChanged(4*(100/nSteps) + ((100/nSteps) / maxIndex)*i);
+        return true;
+    }, 4*(100/nSteps), (100/nSteps), errorString);
 
-        if (_cancel) {
-            qCDebug(GeotaggingLog) << "Tagging cancelled";
-            emit error(tr("Tagging cancelled"));
-            return;
-        }
+    if (!tagged && !_cancel.loadAcquire()) {
+        emit error(errorString);
+        return;
     }
 
-    if (_cancel) {
+    if (_cancel.loadAcquire()) {
         qCDebug(GeotaggingLog) << "Tagging cancelled";
         emit error(tr("Tagging cancelled"));
         return;
     }
 
+    QStringList skippedImages;
+    for (int i = 0; i < imageSkipped.count(); i++) {
+        if (imageSkipped[i]) {
+            skippedImages.append(_imageList.at(i).fileName());
+        }
+    }
+    if (!skippedImages.isEmpty()) {
+        emit imagesSkipped(skippedImages);
+    }
+
     emit progressChanged(100);
 }
 
+bool GeoTagWorker::_runParallel(int count, const std::function<bool(int, QString&)>& task, double progressStart, double progressSpan, QString& errorString)
+{
+    // Each pool thread pulls the next index until the work runs out, so at most one image per thread is in flight
+    QAtomicInt  nextIndex(0);
+    QAtomicInt  completed(0);
+    QAtomicInt  failed(0);
+
+    auto worker = [&]() {
+        while (!failed.loadAcquire() && !_cancel.loadAcquire()) {
+            int index = nextIndex.fetchAndAddRelaxed(1);
+            if (index >= count) {
+                return;
+            }
+            QString taskError;
+            if (!task(index, taskError)) {
+                if (failed.testAndSetOrdered(0, 1)) {
+                    errorString = taskError;
+                }
+                return;
+            }
+            emit progressChanged(progressStart + ((progressSpan / count) * completed.fetchAndAddRelaxed(1)));
+        }
+    };
+
+    QList<QFuture<void>> futures;
+    int threadCount = std::min(count, _geoTagPool()->maxThreadCount());
+    for (int i = 0; i < threadCount; i++) {
+        futures.append(QtConcurrent::run(_geoTagPool(), worker));
+    }
+    for (QFuture<void>& future: futures) {
+        future.waitForFinished();
+    }
+
+    return !failed.loadAcquire() && !_cancel.loadAcquire();
+}
+
 bool GeoTagWorker::triggerFiltering()
 {
     _imageIndices.clear();
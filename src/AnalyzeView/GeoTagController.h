@@ -20,11 +20,16 @@
 #include <QElapsedTimer>
 #include <QDebug>
 #include <QGeoCoordinate>
+#include <QAtomicInt>
+
+#include <functional>
 
 class GeoTagWorker : public QThread
 {
     Q_OBJECT
 
+    friend class GeoTagTest;
+
 public:
     GeoTagWorker();
 
@@ -36,7 +41,7 @@ public:
     QString imageDirectory  () const { return _imageDirectory; }
     QString saveDirectory   () const { return _saveDirectory; }
 
-    void cancelTagging      () { _cancel = true; }
+    void cancelTagging      () { _cancel.storeRelease(1); }
 
     struct cameraFeedbackPacket {
         double timestamp;
@@ -55,13 +60,19 @@ protected:
 
 signals:
     void error              (QString errorMsg);
+    void imagesSkipped      (QStringList fileNames);    ///< Images without an EXIF header, the rest were tagged
     void taggingComplete    ();
     void progressChanged    (double progress);
 
 private:
     bool triggerFiltering();
 
-    bool                    _cancel;
+    /// Runs task on the geotag thread pool for each index in [0, count), stopping at the first failure
+    ///     @param task Returns false with errorString set on failure
+    /// @return false: a task failed (errorString set) or tagging was cancelled
+    bool _runParallel(int count, const std::function<bool(int index, QString& errorString)>& task, double progressStart, double progressSpan, QString& errorString);
+
+    QAtomicInt              _cancel;
     QString                 _logFile;
     QString                 _imageDirectory;
     QString                 _saveDirectory;
@@ -71,6 +82,8 @@ private:
     QList<int>              _imageIndices;
     QList<int>              _triggerIndices;
 
+    static const qint64 _copyChunkSize = 1024 * 1024;
+
 };
 
 /// Controller for GeoTagPage.qml. Supports geotagging images based on logfile camera tags.
@@ -119,6 +132,7 @@ signals:
 private slots:
     void _workerProgressChanged (double progress);
     void _workerError           (QString errorMsg);
+    void _workerImagesSkipped   (QStringList fileNames);
     void _setErrorMessage       (const QString& error);
 
 private:
@@ -0,0 +1,261 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "GeoTagTest.h"
+#include "ExifParser.h"
+#include "ULogReaderTest.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+static const QByteArray _soi("\xff\xd8", 2);
+
+QByteArray GeoTagTest::_segment(uchar marker, const QByteArray& payload)
+{
+    QByteArray segment;
+    uchar length[2];
+    qToBigEndian<quint16>(static_cast<quint16>(payload.size() + 2), length);
+    segment.append(static_cast<char>(0xff));
+    segment.append(static_cast<char>(marker));
+    segment.append(reinterpret_cast<const char*>(length), 2);
+    segment.append(payload);
+    return segment;
+}
+
+QByteArray GeoTagTest::_exifSegment(void)
+{
+    // Offsets are from the start of the TIFF header
+    QByteArray tiff("II*\x00" "\x08\x00\x00\x00", 8);
+    tiff.append("\x01\x00", 2);                                     // IFD0 entry count
+    tiff.append("\x04\x90" "\x02\x00" "\x14\x00\x00\x00", 8);       // DateTimeDigitized, ASCII, 20 characters
+    tiff.append("\x26\x00\x00\x00", 4);                             //      at 38
+    tiff.append("\x3a\x00\x00\x00", 4);                             // Next IFD at 58, where the GPS IFD goes
+    tiff.append(QByteArray(12, ' '));                               // Image description space ExifParser::write reuses
+    tiff.append("2020:01:02 03:04:05", 20);
+
+    return _segment(0xe1, QByteArray("Exif\x00\x00", 6) + tiff);
+}
+
+QByteArray GeoTagTest::_jfifSegment(void)
+{
+    return _segment(0xe0, QByteArray("JFIF\x00" "\x01\x01" "\x00" "\x00\x01\x00\x01" "\x00\x00", 14));
+}
+
+QByteArray GeoTagTest::_imageData(int seed)
+{
+    QByteArray imageData;
+
+    QByteArray quantizationTable(65, static_cast<char>(seed + 1));
+    quantizationTable[0] = 0;
+    imageData.append(_segment(0xdb, quantizationTable));
+    imageData.append(_segment(0xda, QByteArray("\x01\x01\x00\x00\x3f\x00", 6)));
+
+    // Entropy coded data, 0xff is always stuffed with 0x00. Big enough to take more than one copy chunk.
+    for (int i = 0; i < 3 * 1024 * 1024; i++) {
+        char value = static_cast<char>((i * 31) + seed);
+        imageData.append(value);
+        if (static_cast<uchar>(value) == 0xff) {
+            imageData.append(static_cast<char>(0));
+        }
+    }
+    imageData.append("\xff\xd9", 2);
+
+    return imageData;
+}
+
+bool GeoTagTest::_writeFile(const QString& path, const QByteArray& bytes)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+void GeoTagTest::_readHeader_test(void)
+{
+    QByteArray exifHeader   = _soi + _exifSegment();
+    QByteArray imageData    = _imageData(0);
+    QByteArray jpeg         = exifHeader + imageData;
+
+    QBuffer buffer(&jpeg);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QByteArray header;
+    QVERIFY(ExifParser::readHeader(buffer, header));
+
+    // Stops at the end of APP1, the image data is left to be streamed
+    QCOMPARE(header, exifHeader);
+    QCOMPARE(buffer.pos(), static_cast<qint64>(exifHeader.size()));
+    QCOMPARE(buffer.readAll(), imageData);
+
+    double expectedTime = QDateTime(QDate(2020, 1, 2), QTime(3, 4, 5)).toMSecsSinceEpoch() / 1000.0;
+    QCOMPARE(ExifParser().readTime(header), expectedTime);
+}
+
+void GeoTagTest::_readHeaderJFIF_test(void)
+{
+    // JFIF files put APP0 ahead of APP1
+    QByteArray exifHeader   = _soi + _jfifSegment() + _exifSegment();
+    QByteArray imageData    = _imageData(1);
+    QByteArray jpeg         = exifHeader + imageData;
+
+    QBuffer buffer(&jpeg);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QByteArray header;
+    QVERIFY(ExifParser::readHeader(buffer, header));
+    QCOMPARE(header, exifHeader);
+    QCOMPARE(buffer.pos(), static_cast<qint64>(exifHeader.size()));
+}
+
+void GeoTagTest::_readHeaderNoExif_test(void)
+{
+    QByteArray header;
+
+    // Image data follows APP0 without an APP1
+    QByteArray jfifOnly = _soi + _jfifSegment() + _imageData(2);
+    QBuffer jfifBuffer(&jfifOnly);
+    QVERIFY(jfifBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(!ExifParser::readHeader(jfifBuffer, header));
+
+    // Not a JPEG
+    QByteArray notJpeg("\x89PNG\r\n\x1a\n", 8);
+    QBuffer notJpegBuffer(&notJpeg);
+    QVERIFY(notJpegBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(!ExifParser::readHeader(notJpegBuffer, header));
+
+    // APP1 cut short
+    QByteArray truncated = _soi + _exifSegment().left(20);
+    QBuffer truncatedBuffer(&truncated);
+    QVERIFY(truncatedBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(!ExifParser::readHeader(truncatedBuffer, header));
+
+    // Garbage where a marker should be
+    QByteArray badMarker = _soi + QByteArray("\x12\x34\x00\x04\x00\x00", 6);
+    QBuffer badMarkerBuffer(&badMarker);
+    QVERIFY(badMarkerBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(!ExifParser::readHeader(badMarkerBuffer, header));
+}
+
+void GeoTagTest::_runParallel_test(void)
+{
+    GeoTagWorker    worker;
+    QString         errorString;
+
+    // Every index is handed out exactly once
+    const int count = 500;
+    QVector<QAtomicInt> runCounts(count);
+    QVERIFY(worker._runParallel(count, [&runCounts](int index, QString&) {
+        runCounts[index].fetchAndAddRelaxed(1);
+        return true;
+    }, 0, 100, errorString));
+    for (int i = 0; i < count; i++) {
+        QCOMPARE(runCounts[i].loadAcquire(), 1);
+    }
+
+    QVERIFY(worker._runParallel(0, [](int, QString&) { return true; }, 0, 100, errorString));
+
+    // A failure stops the run and reports its error
+    QAtomicInt runCount(0);
+    QVERIFY(!worker._runParallel(count, [&runCount](int index, QString& taskError) {
+        runCount.fetchAndAddRelaxed(1);
+        if (index == 50) {
+            taskError = QStringLiteral("failed at 50");
+            return false;
+        }
+        return true;
+    }, 0, 100, errorString));
+    QCOMPARE(errorString, QStringLiteral("failed at 50"));
+    QVERIFY(runCount.loadAcquire() < count);
+
+    // Nothing runs once cancelled
+    runCount.storeRelease(0);
+    worker.cancelTagging();
+    QVERIFY(!worker._runParallel(count, [&runCount](int, QString&) {
+        runCount.fetchAndAddRelaxed(1);
+        return true;
+    }, 0, 100, errorString));
+    QCOMPARE(runCount.loadAcquire(), 0);
+}
+
+void GeoTagTest::_tagging_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QDir dir(tempDir.path());
+    QVERIFY(dir.mkpath(QStringLiteral("images")));
+    QVERIFY(dir.mkpath(QStringLiteral("tagged")));
+    QString imagePath   = dir.filePath(QStringLiteral("images"));
+    QString taggedPath  = dir.filePath(QStringLiteral("tagged"));
+
+    // Image 2 has no EXIF header and is skipped, the others keep their trigger
+    const QStringList imageNames = { QStringLiteral("a.jpg"), QStringLiteral("b.jpg"), QStringLiteral("c.jpg"), QStringLiteral("d.jpg") };
+    QList<QByteArray> headers;
+    QList<QByteArray> imageData;
+    for (int i = 0; i < imageNames.count(); i++) {
+        QByteArray header;
+        if (i == 1) {
+            header = _soi + _jfifSegment() + _exifSegment();
+        } else if (i == 2) {
+            header = _soi + _jfifSegment();
+        } else {
+            header = _soi + _exifSegment();
+        }
+        headers.append(header);
+        imageData.append(_imageData(i));
+        QVERIFY(_writeFile(QDir(imagePath).filePath(imageNames[i]), header + imageData[i]));
+    }
+
+    QList<GeoTagWorker::cameraFeedbackPacket> captures;
+    for (int i = 0; i < imageNames.count(); i++) {
+        GeoTagWorker::cameraFeedbackPacket capture;
+        memset(&capture, 0, sizeof(capture));
+        capture.timestamp       = 100.0 + i;
+        capture.imageSequence   = static_cast<uint32_t>(i);
+        capture.latitude        = 47.125 + (i * 0.001);
+        capture.longitude       = i == 3 ? -8.5 : 8.5 + (i * 0.25);
+        capture.altitude        = 400.25f + i;
+        captures.append(capture);
+    }
+    QString logPath = dir.filePath(QStringLiteral("flight.ulg"));
+    QVERIFY(_writeFile(logPath, ULogReaderTest::cameraCaptureLog(captures)));
+
+    GeoTagWorker worker;
+    worker.setImageDirectory(imagePath);
+    worker.setSaveDirectory(taggedPath);
+    worker.setLogFile(logPath);
+
+    QSignalSpy spyError(&worker, &GeoTagWorker::error);
+    QSignalSpy spySkipped(&worker, &GeoTagWorker::imagesSkipped);
+    worker.run();
+
+    QCOMPARE(spyError.count(), 0);
+    QCOMPARE(spySkipped.count(), 1);
+    QCOMPARE(spySkipped[0][0].toStringList(), QStringList(QStringLiteral("c.jpg")));
+    QVERIFY(!QFile::exists(QDir(taggedPath).filePath(QStringLiteral("c.jpg"))));
+
+    // Tagged images are the patched header followed by the untouched image data
+    for (int i = 0; i < imageNames.count(); i++) {
+        if (i == 2) {
+            continue;
+        }
+        GeoTagWorker::cameraFeedbackPacket trigger = worker._triggerList[i];
+        QCOMPARE(trigger.latitude, captures[i].latitude);
+        QCOMPARE(trigger.longitude, captures[i].longitude);
+
+        QByteArray expectedHeader = headers[i];
+        QVERIFY(ExifParser().write(expectedHeader, trigger));
+        QVERIFY(expectedHeader != headers[i]);
+
+        QFile tagged(QDir(taggedPath).filePath(imageNames[i]));
+        QVERIFY(tagged.open(QIODevice::ReadOnly));
+        QByteArray taggedBytes = tagged.readAll();
+        QCOMPARE(taggedBytes.size(), expectedHeader.size() + imageData[i].size());
+        QVERIFY(taggedBytes.startsWith(expectedHeader));
+        QVERIFY(taggedBytes.mid(expectedHeader.size()) == imageData[i]);
+    }
+}
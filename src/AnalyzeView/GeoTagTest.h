@@ -0,0 +1,40 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "GeoTagController.h"
+
+/// Unit test for ExifParser header reading and GeoTagWorker, against generated JPEG fixtures
+class GeoTagTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _readHeader_test       (void);
+    void _readHeaderJFIF_test   (void);
+    void _readHeaderNoExif_test (void);
+    void _runParallel_test      (void);
+    void _tagging_test          (void);
+
+private:
+    /// Marker segment, length includes the two length bytes
+    static QByteArray _segment(uchar marker, const QByteArray& payload);
+
+    /// APP1 segment holding a TIFF header with a DateTimeDigitized entry, laid out the way ExifParser::write expects
+    static QByteArray _exifSegment(void);
+
+    static QByteArray _jfifSegment(void);
+
+    /// Everything following the headers: tables, start of scan, entropy coded data and end of image
+    static QByteArray _imageData(int seed);
+
+    static bool _writeFile(const QString& path, const QByteArray& bytes);
+};
@@ -18,6 +18,7 @@
 #include "ParameterManager.h"
 #include "Vehicle.h"
 #include "SettingsManager.h"
+#include "VehicleLogDownloader.h"
 
 #include <QDebug>
 #include <QSettings>
@@ -26,64 +27,9 @@
 #include <QtCore/qmath.h>
 
 #define kTimeOutMilliseconds 500
-#define kGUIRateMilliseconds 17
-#define kTableBins           512
-#define kChunkSize           (kTableBins * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN)
 
 QGC_LOGGING_CATEGORY(LogDownloadLog, "LogDownloadLog")
 
-//-----------------------------------------------------------------------------
-struct LogDownloadData {
-    LogDownloadData(QGCLogEntry* entry);
-    QBitArray     chunk_table;
-    uint32_t      current_chunk;
-    QFile         file;
-    QString       filename;
-    uint          ID;
-    QGCLogEntry*  entry;
-    uint          written;
-    size_t        rate_bytes;
-    qreal         rate_avg;
-    QElapsedTimer elapsed;
-
-    void advanceChunk()
-    {
-           current_chunk++;
-           chunk_table = QBitArray(chunkBins(), false);
-    }
-
-    // The number of MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN bins in the current chunk
-    uint32_t chunkBins() const
-    {
-        return qMin(qCeil((entry->size() - current_chunk*kChunkSize)/static_cast<qreal>(MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN)),
-                    kTableBins);
-    }
-
-    // The number of kChunkSize chunks in the file
-    uint32_t numChunks() const
-    {
-        return qCeil(entry->size() / static_cast<qreal>(kChunkSize));
-    }
-
-    // True if all bins in the chunk have been set to val
-    bool chunkEquals(const bool val) const
-    {
-        return chunk_table == QBitArray(chunk_table.size(), val);
-    }
-
-};
-
-//----------------------------------------------------------------------------------------
-LogDownloadData::LogDownloadData(QGCLogEntry* entry_)
-    : ID(entry_->id())
-    , entry(entry_)
-    , written(0)
-    , rate_bytes(0)
-    , rate_avg(0)
-{
-
-}
-
 //----------------------------------------------------------------------------------------
 QGCLogEntry::QGCLogEntry(uint logId, const QDateTime& dateTime, uint logSize, bool received)
     : _logID(logId)
@@ -105,7 +51,6 @@ QGCLogEntry::sizeStr() const
 //----------------------------------------------------------------------------------------
 LogDownloadController::LogDownloadController(void)
     : _uas(nullptr)
-    , _downloadData(nullptr)
     , _vehicle(nullptr)
     , _requestingLogEntries(false)
     , _downloadingLogs(false)
@@ -114,6 +59,7 @@ LogDownloadController::LogDownloadController(void)
 {
     MultiVehicleManager *manager = qgcApp()->toolbox()->multiVehicleManager();
     connect(manager, &MultiVehicleManager::activeVehicleChanged, this, &LogDownloadController::_setActiveVehicle);
+    connect(manager, &MultiVehicleManager::vehicleRemoved,       this, &LogDownloadController::_vehicleRemoved);
     connect(&_timer, &QTimer::timeout, this, &LogDownloadController::_processDownload);
     _setActiveVehicle(manager->activeVehicle());
 }
@@ -124,8 +70,6 @@ LogDownloadController::_processDownload()
 {
     if(_requestingLogEntries) {
         _findMissingEntries();
-    } else if(_downloadingLogs) {
-        _findMissingData();
     }
 }
 
@@ -136,14 +80,74 @@ LogDownloadController::_setActiveVehicle(Vehicle* vehicle)
     if(_uas) {
         _logEntriesModel.clear();
         disconnect(_uas, &UASInterface::logEntry, this, &LogDownloadController::_logEntry);
-        disconnect(_uas, &UASInterface::logData,  this, &LogDownloadController::_logData);
         _uas = nullptr;
     }
     _vehicle = vehicle;
     if(_vehicle) {
         _uas = vehicle->uas();
         connect(_uas, &UASInterface::logEntry, this, &LogDownloadController::_logEntry);
-        connect(_uas, &UASInterface::logData,  this, &LogDownloadController::_logData);
+    }
+    //-- Downloads on other vehicles carry on in the background
+    VehicleLogDownloader* downloader = _downloaderForVehicle(_vehicle, false);
+    _setDownloading(downloader && downloader->downloading());
+}
+
+//----------------------------------------------------------------------------------------
+void
+LogDownloadController::_vehicleRemoved(Vehicle* vehicle)
+{
+    VehicleLogDownloader* downloader = _downloaderForVehicle(vehicle, false);
+    if (downloader) {
+        _vehicleDownloaders.removeOne(downloader);
+        //-- Partial data is kept for when the vehicle comes back
+        delete downloader;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+VehicleLogDownloader*
+LogDownloadController::_downloaderForVehicle(Vehicle* vehicle, bool create)
+{
+    if (!vehicle) {
+        return nullptr;
+    }
+    for (int i = 0; i < _vehicleDownloaders.count(); i++) {
+        VehicleLogDownloader* downloader = _vehicleDownloaders.value<VehicleLogDownloader*>(i);
+        if (downloader->vehicle() == vehicle) {
+            return downloader;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+
+    VehicleLogDownloader* downloader = new VehicleLogDownloader(vehicle, this);
+    connect(downloader, &VehicleLogDownloader::logStatusChanged, this, &LogDownloadController::_logStatusChanged);
+    connect(downloader, &VehicleLogDownloader::downloadingChanged, this, &LogDownloadController::_downloaderDownloadingChanged);
+    _vehicleDownloaders.append(downloader);
+    return downloader;
+}
+
+//----------------------------------------------------------------------------------------
+void
+LogDownloadController::_logStatusChanged(uint id, const QString& status)
+{
+    VehicleLogDownloader* downloader = qobject_cast<VehicleLogDownloader*>(sender());
+    if (downloader && downloader->vehicle() == _vehicle && static_cast<int>(id) < _logEntriesModel.count()) {
+        _logEntriesModel[static_cast<int>(id)]->setStatus(status);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void
+LogDownloadController::_downloaderDownloadingChanged(bool downloading)
+{
+    VehicleLogDownloader* downloader = qobject_cast<VehicleLogDownloader*>(sender());
+    if (downloader && downloader->vehicle() == _vehicle) {
+        if (!downloading) {
+            _resetSelection();
+        }
+        _setDownloading(downloading);
     }
 }
 
@@ -293,195 +297,6 @@ LogDownloadController::_findMissingEntries()
     }
 }
 
-void LogDownloadController::_updateDataRate(void)
-{
-    if (_downloadData->elapsed.elapsed() >= kGUIRateMilliseconds) {
-        //-- Update download rate
-        qreal rrate = _downloadData->rate_bytes / (_downloadData->elapsed.elapsed() / 1000.0);
-        _downloadData->rate_avg = (_downloadData->rate_avg * 0.95) + (rrate * 0.05);
-        _downloadData->rate_bytes = 0;
-
-        //-- Update status
-        const QString status = QString("%1 (%2/s)").arg(QGCMapEngine::bigSizeToString(_downloadData->written),
-                                                        QGCMapEngine::bigSizeToString(_downloadData->rate_avg));
-
-        _downloadData->entry->setStatus(status);
-        _downloadData->elapsed.start();
-    }
-}
-
-
-//----------------------------------------------------------------------------------------
-void
-LogDownloadController::_logData(UASInterface* uas, uint32_t ofs, uint16_t id, uint8_t count, const uint8_t* data)
-{
-    if(!_uas || uas != _uas || !_downloadData) {
-        return;
-    }
-    //-- APM "Fix"
-    id -= _apmOneBased;
-    if(_downloadData->ID != id) {
-        qWarning() << "Received log data for wrong log";
-        return;
-    }
-
-    if ((ofs % MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) != 0) {
-        qWarning() << "Ignored misaligned incoming packet @" << ofs;
-        return;
-    }
-
-    bool result = false;
-    uint32_t timeout_time = kTimeOutMilliseconds;
-    if(ofs <= _downloadData->entry->size()) {
-        const uint32_t chunk = ofs / kChunkSize;
-        if (chunk != _downloadData->current_chunk) {
-            qWarning() << "Ignored packet for out of order chunk actual:expected" << chunk << _downloadData->current_chunk;
-            return;
-        }
-        const uint16_t bin = (ofs - chunk*kChunkSize) / MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
-        if (bin >= _downloadData->chunk_table.size()) {
-            qWarning() << "Out of range bin received";
-        } else
-            _downloadData->chunk_table.setBit(bin);
-        if (_downloadData->file.pos() != ofs) {
-            // Seek to correct position
-            if (!_downloadData->file.seek(ofs)) {
-                qWarning() << "Error while seeking log file offset";
-                return;
-            }
-        }
-
-        //-- Write chunk to file
-        if(_downloadData->file.write((const char*)data, count)) {
-            _downloadData->written += count;
-            _downloadData->rate_bytes += count;
-            _updateDataRate();
-            result = true;
-            //-- reset retries
-            _retries = 0;
-            //-- Reset timer
-            _timer.start(timeout_time);
-            //-- Do we have it all?
-            if(_logComplete()) {
-                _downloadData->entry->setStatus(tr("Downloaded"));
-                //-- Check for more
-                _receivedAllData();
-            } else if (_chunkComplete()) {
-                _downloadData->advanceChunk();
-                _requestLogData(_downloadData->ID,
-                                _downloadData->current_chunk*kChunkSize,
-                                _downloadData->chunk_table.size()*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
-            } else if (bin < _downloadData->chunk_table.size() - 1 && _downloadData->chunk_table.at(bin+1)) {
-                // Likely to be grabbing fragments and got to the end of a gap
-                _findMissingData();
-            }
-        } else {
-            qWarning() << "Error while writing log file chunk";
-        }
-    } else {
-        qWarning() << "Received log offset greater than expected";
-    }
-    if(!result) {
-        _downloadData->entry->setStatus(tr("Error"));
-    }
-}
-
-
-//----------------------------------------------------------------------------------------
-bool
-LogDownloadController::_chunkComplete() const
-{
-    return _downloadData->chunkEquals(true);
-}
-
-//----------------------------------------------------------------------------------------
-bool
-LogDownloadController::_logComplete() const
-{
-    return _chunkComplete() && (_downloadData->current_chunk+1) == _downloadData->numChunks();
-}
-
-//----------------------------------------------------------------------------------------
-void
-LogDownloadController::_receivedAllData()
-{
-    _timer.stop();
-    //-- Anything queued up for download?
-    if(_prepareLogDownload()) {
-        //-- Request Log
-        _requestLogData(_downloadData->ID, 0, _downloadData->chunk_table.size()*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
-        _timer.start(kTimeOutMilliseconds);
-    } else {
-        _resetSelection();
-        _setDownloading(false);
-    }
-}
-
-//----------------------------------------------------------------------------------------
-void
-LogDownloadController::_findMissingData()
-{
-    if (_logComplete()) {
-         _receivedAllData();
-         return;
-    } else if (_chunkComplete()) {
-        _downloadData->advanceChunk();
-    }
-
-    _retries++;
-#if 0
-    // Trying the change to infinite log download. This way if retries hit 100% failure the data rate will
-    // slowly fall to 0 and the user can Cancel. This should work better on really crappy links.
-    if(_retries > 5) {
-        _downloadData->entry->setStatus(tr("Timed Out"));
-        //-- Give up
-        qWarning() << "Too many errors retreiving log data. Giving up.";
-        _receivedAllData();
-        return;
-    }
-#endif
-
-    _updateDataRate();
-
-    uint16_t start = 0, end = 0;
-    const int size = _downloadData->chunk_table.size();
-    for (; start < size; start++) {
-        if (!_downloadData->chunk_table.testBit(start)) {
-            break;
-        }
-    }
-
-    for (end = start; end < size; end++) {
-        if (_downloadData->chunk_table.testBit(end)) {
-            break;
-        }
-    }
-
-    const uint32_t pos = _downloadData->current_chunk*kChunkSize + start*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN,
-                   len = (end - start)*MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
-    _requestLogData(_downloadData->ID, pos, len, _retries);
-}
-
-//----------------------------------------------------------------------------------------
-void
-LogDownloadController::_requestLogData(uint16_t id, uint32_t offset, uint32_t count, int retryCount)
-{
-    if(_vehicle) {
-        //-- APM "Fix"
-        id += _apmOneBased;
-        qCDebug(LogDownloadLog) << "Request log data (id:" << id << "offset:" << offset << "size:" << count << "retryCount" << retryCount << ")";
-        mavlink_message_t msg;
-        mavlink_msg_log_request_data_pack_chan(
-                    qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
-                    qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
-                    _vehicle->priorityLink()->mavlinkChannel(),
-                    &msg,
-                    qgcApp()->toolbox()->multiVehicleManager()->activeVehicle()->id(), qgcApp()->toolbox()->multiVehicleManager()->activeVehicle()->defaultComponentId(),
-                    id, offset, count);
-        _vehicle->sendMessageOnLink(_vehicle->priorityLink(), msg);
-    }
-}
-
 //----------------------------------------------------------------------------------------
 void
 LogDownloadController::refresh(void)
@@ -529,115 +344,22 @@ void LogDownloadController::downloadToDirectory(const QString& dir)
 {
     //-- Stop listing just in case
     _receivedAllEntries();
-    //-- Reset downloads, again just in case
-    delete _downloadData;
-    _downloadData = nullptr;
-
-    _downloadPath = dir;
-    if(!_downloadPath.isEmpty()) {
-        if(!_downloadPath.endsWith(QDir::separator()))
-            _downloadPath += QDir::separator();
-        //-- Iterate selected entries and shown them as waiting
-        int num_logs = _logEntriesModel.count();
-        for(int i = 0; i < num_logs; i++) {
-            QGCLogEntry* entry = _logEntriesModel[i];
-            if(entry) {
-                if(entry->selected()) {
-                   entry->setStatus(tr("Waiting"));
-                }
-            }
-        }
-        //-- Start download process
-        _setDownloading(true);
-        _receivedAllData();
-    }
-}
 
-
-//----------------------------------------------------------------------------------------
-QGCLogEntry*
-LogDownloadController::_getNextSelected()
-{
-    //-- Iterate entries and look for a selected file
+    if(!_vehicle || dir.isEmpty()) {
+        return;
+    }
+    VehicleLogDownloader* downloader = _downloaderForVehicle(_vehicle, true);
+    //-- Queue up selected entries, the downloader shows them as waiting
     int num_logs = _logEntriesModel.count();
     for(int i = 0; i < num_logs; i++) {
         QGCLogEntry* entry = _logEntriesModel[i];
-        if(entry) {
-            if(entry->selected()) {
-               return entry;
-            }
+        if(entry && entry->selected()) {
+            entry->setSelected(false);
+            downloader->queue({ entry->id(), entry->size(), entry->time() }, dir, _apmOneBased);
         }
     }
-    return nullptr;
-}
-
-//----------------------------------------------------------------------------------------
-bool
-LogDownloadController::_prepareLogDownload()
-{
-    delete _downloadData;
-    _downloadData = nullptr;
-
-    QGCLogEntry* entry = _getNextSelected();
-    if(!entry) {
-        return false;
-    }
-    //-- Deselect file
-    entry->setSelected(false);
     emit selectionChanged();
-    bool result = false;
-    QString ftime;
-    if(entry->time().date().year() < 2010) {
-        ftime = tr("UnknownDate");
-    } else {
-        ftime = entry->time().toString(QStringLiteral("yyyy-M-d-hh-mm-ss"));
-    }
-    _downloadData = new LogDownloadData(entry);
-    _downloadData->filename = QString("log_") + QString::number(entry->id()) + "_" + ftime;
-    if (_vehicle->firmwareType() == MAV_AUTOPILOT_PX4) {
-        QString loggerParam = QStringLiteral("SYS_LOGGER");
-        if (_vehicle->parameterManager()->parameterExists(FactSystem::defaultComponentId, loggerParam) &&
-                _vehicle->parameterManager()->getParameter(FactSystem::defaultComponentId, loggerParam)->rawValue().toInt() == 0) {
-            _downloadData->filename += ".px4log";
-        } else {
-            _downloadData->filename += ".ulg";
-        }
-    } else {
-        _downloadData->filename += ".bin";
-    }
-    _downloadData->file.setFileName(_downloadPath + _downloadData->filename);
-    //-- Append a number to the end if the filename already exists
-    if (_downloadData->file.exists()){
-        uint num_dups = 0;
-        QStringList filename_spl = _downloadData->filename.split('.');
-        do {
-            num_dups +=1;
-            _downloadData->file.setFileName(filename_spl[0] + '_' + QString::number(num_dups) + '.' + filename_spl[1]);
-        } while( _downloadData->file.exists());
-    }
-    //-- Create file
-    if (!_downloadData->file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Failed to create log file:" <<  _downloadData->filename;
-    } else {
-        //-- Preallocate file
-        if(!_downloadData->file.resize(entry->size())) {
-            qWarning() << "Failed to allocate space for log file:" <<  _downloadData->filename;
-        } else {
-            _downloadData->current_chunk = 0;
-            _downloadData->chunk_table = QBitArray(_downloadData->chunkBins(), false);
-            _downloadData->elapsed.start();
-            result = true;
-        }
-    }
-    if(!result) {
-        if (_downloadData->file.exists()) {
-            _downloadData->file.remove();
-        }
-        _downloadData->entry->setStatus(tr("Error"));
-        delete _downloadData;
-        _downloadData = nullptr;
-    }
-    return result;
+    _setDownloading(downloader->downloading());
 }
 
 //----------------------------------------------------------------------------------------
@@ -646,7 +368,6 @@ LogDownloadController::_setDownloading(bool active)
 {
     if (_downloadingLogs != active) {
         _downloadingLogs = active;
-        _vehicle->setConnectionLostEnabled(!active);
         emit downloadingLogsChanged();
     }
 }
@@ -686,13 +407,9 @@ LogDownloadController::cancel(void)
     if(_uas){
         _receivedAllEntries();
     }
-    if(_downloadData) {
-        _downloadData->entry->setStatus(tr("Canceled"));
-        if (_downloadData->file.exists()) {
-            _downloadData->file.remove();
-        }
-        delete _downloadData;
-        _downloadData = 0;
+    VehicleLogDownloader* downloader = _downloaderForVehicle(_vehicle, false);
+    if(downloader) {
+        downloader->cancel();
     }
     _resetSelection(true);
     _setDownloading(false);
@@ -21,12 +21,13 @@
 
 #include "UASInterface.h"
 #include "AutoPilotPlugin.h"
+#include "QmlObjectListModel.h"
 
 class  MultiVehicleManager;
 class  UASInterface;
 class  Vehicle;
 class  QGCLogEntry;
-struct LogDownloadData;
+class  VehicleLogDownloader;
 
 Q_DECLARE_LOGGING_CATEGORY(LogDownloadLog)
 
@@ -119,8 +120,10 @@ public:
     Q_PROPERTY(QGCLogModel* model           READ model              NOTIFY modelChanged)
     Q_PROPERTY(bool         requestingList  READ requestingList     NOTIFY requestingListChanged)
     Q_PROPERTY(bool         downloadingLogs READ downloadingLogs    NOTIFY downloadingLogsChanged)
+    Q_PROPERTY(QmlObjectListModel* vehicleDownloaders READ vehicleDownloaders CONSTANT)  ///< VehicleLogDownloader per vehicle with downloads, for progress and rate
 
     QGCLogModel*    model                   () { return &_logEntriesModel; }
+    QmlObjectListModel* vehicleDownloaders  () { return &_vehicleDownloaders; }
     bool            requestingList          () { return _requestingLogEntries; }
     bool            downloadingLogs         () { return _downloadingLogs; }
 
@@ -140,37 +143,31 @@ signals:
 private slots:
     void _setActiveVehicle  (Vehicle* vehicle);
     void _logEntry          (UASInterface *uas, uint32_t time_utc, uint32_t size, uint16_t id, uint16_t num_logs, uint16_t last_log_num);
-    void _logData           (UASInterface *uas, uint32_t ofs, uint16_t id, uint8_t count, const uint8_t *data);
     void _processDownload   ();
+    void _vehicleRemoved    (Vehicle* vehicle);
+    void _logStatusChanged  (uint id, const QString& status);
+    void _downloaderDownloadingChanged(bool downloading);
 
 private:
     bool _entriesComplete   ();
-    bool _chunkComplete     () const;
-    bool _logComplete       () const;
     void _findMissingEntries();
     void _receivedAllEntries();
-    void _receivedAllData   ();
     void _resetSelection    (bool canceled = false);
-    void _findMissingData   ();
     void _requestLogList    (uint32_t start, uint32_t end);
-    void _requestLogData    (uint16_t id, uint32_t offset, uint32_t count, int retryCount = 0);
-    bool _prepareLogDownload();
     void _setDownloading    (bool active);
     void _setListing        (bool active);
-    void _updateDataRate    ();
 
-    QGCLogEntry* _getNextSelected();
+    VehicleLogDownloader* _downloaderForVehicle(Vehicle* vehicle, bool create);
 
     UASInterface*       _uas;
-    LogDownloadData*    _downloadData;
     QTimer              _timer;
+    QmlObjectListModel  _vehicleDownloaders;
     QGCLogModel         _logEntriesModel;
     Vehicle*            _vehicle;
     bool                _requestingLogEntries;
     bool                _downloadingLogs;
     int                 _retries;
     int                 _apmOneBased;
-    QString             _downloadPath;
 };
 
 #endif
@@ -25,8 +25,13 @@ private slots:
     //void cleanup(void) { _cleanup(); }
 
     void downloadTest(void);
+    void resumeTest(void);
+    void downloadThroughputBenchmark(void);
 
 private:
+    /// Downloads the single MockLink log and verifies it against the original
+    void _downloadLog(int timeoutMsecs);
+
     // LogDownloadController signals
 
     enum {
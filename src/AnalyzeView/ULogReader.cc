@@ -0,0 +1,442 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ULogReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+QGC_LOGGING_CATEGORY(ULogReaderLog, "ULogReaderLog")
+
+static const char _ulogMagic[] = { 'U', 'L', 'o', 'g', 0x01, 0x12, 0x35 };
+
+// Nested formats deeper than this are assumed to be recursive
+static const int _maxFormatDepth = 16;
+
+enum ULogMessageType {
+    ULogMessageFormat       = 'F',
+    ULogMessageData         = 'D',
+    ULogMessageAddLogged    = 'A',
+    ULogMessageRemoveLogged = 'R',
+};
+
+//-----------------------------------------------------------------------------
+int ULogReader::Message::_typeSize(FieldType type)
+{
+    switch (type) {
+    case FieldTypeInt8:
+    case FieldTypeUInt8:
+    case FieldTypeBool:
+    case FieldTypeChar:
+        return 1;
+    case FieldTypeInt16:
+    case FieldTypeUInt16:
+        return 2;
+    case FieldTypeInt32:
+    case FieldTypeUInt32:
+    case FieldTypeFloat:
+        return 4;
+    case FieldTypeInt64:
+    case FieldTypeUInt64:
+    case FieldTypeDouble:
+        return 8;
+    }
+    return 0;
+}
+
+bool ULogReader::Message::contains(const Field_t& field, int index) const
+{
+    return _data && index >= 0 && index < field.arraySize && field.offset + ((index + 1) * _typeSize(field.type)) <= _size;
+}
+
+double ULogReader::Message::toDouble(const Field_t& field, int index) const
+{
+    if (!contains(field, index)) {
+        return 0;
+    }
+
+    int offset = field.offset + (index * _typeSize(field.type));
+    switch (field.type) {
+    case FieldTypeFloat:
+    {
+        quint32 bits = value<quint32>(offset);
+        float   result;
+        memcpy(&result, &bits, sizeof(result));
+        return static_cast<double>(result);
+    }
+    case FieldTypeDouble:
+    {
+        quint64 bits = value<quint64>(offset);
+        double  result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+    case FieldTypeUInt64:
+        return static_cast<double>(toUInt64(field, index));
+    default:
+        return static_cast<double>(toInt64(field, index));
+    }
+}
+
+qint64 ULogReader::Message::toInt64(const Field_t& field, int index) const
+{
+    if (!contains(field, index)) {
+        return 0;
+    }
+
+    int offset = field.offset + (index * _typeSize(field.type));
+    switch (field.type) {
+    case FieldTypeInt8:
+        return static_cast<qint8>(_data[offset]);
+    case FieldTypeUInt8:
+    case FieldTypeBool:
+    case FieldTypeChar:
+        return _data[offset];
+    case FieldTypeInt16:
+        return value<qint16>(offset);
+    case FieldTypeUInt16:
+        return value<quint16>(offset);
+    case FieldTypeInt32:
+        return value<qint32>(offset);
+    case FieldTypeUInt32:
+        return value<quint32>(offset);
+    case FieldTypeInt64:
+        return value<qint64>(offset);
+    case FieldTypeUInt64:
+        return static_cast<qint64>(value<quint64>(offset));
+    case FieldTypeFloat:
+    case FieldTypeDouble:
+        return static_cast<qint64>(toDouble(field, index));
+    }
+    return 0;
+}
+
+quint64 ULogReader::Message::toUInt64(const Field_t& field, int index) const
+{
+    if (field.type == FieldTypeUInt64 && contains(field, index)) {
+        return value<quint64>(field.offset + (index * 8));
+    }
+    return static_cast<quint64>(toInt64(field, index));
+}
+
+QString ULogReader::Message::toString(const Field_t& field) const
+{
+    if (!contains(field, 0)) {
+        return QString();
+    }
+
+    int length = qMin(field.arraySize, _size - field.offset);
+    const uchar* start = _data + field.offset;
+    const uchar* end = static_cast<const uchar*>(memchr(start, 0, static_cast<size_t>(length)));
+    return QString::fromUtf8(reinterpret_cast<const char*>(start), end ? static_cast<int>(end - start) : length);
+}
+
+//-----------------------------------------------------------------------------
+void ULogReader::OffsetIndex::append(qint64 offset)
+{
+    int high = static_cast<int>(offset >> 32);
+    while (_highStarts.count() < high) {
+        _highStarts.append(_low.count());
+    }
+    _low.append(static_cast<quint32>(offset));
+}
+
+qint64 ULogReader::OffsetIndex::at(int index) const
+{
+    // Number of high word steps at or before this message
+    qint64 high = std::upper_bound(_highStarts.constBegin(), _highStarts.constEnd(), index) - _highStarts.constBegin();
+    return (high << 32) | _low[index];
+}
+
+//-----------------------------------------------------------------------------
+ULogReader::ULogReader(void)
+{
+
+}
+
+ULogReader::~ULogReader()
+{
+    close();
+}
+
+bool ULogReader::open(const QString& path, QString& errorString)
+{
+    close();
+
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        errorString = tr("Couldn't open log file: %1").arg(_file.errorString());
+        return false;
+    }
+    _size = _file.size();
+    if (_size < _fileHeaderLength || !(_data = _file.map(0, _size))) {
+        errorString = _size < _fileHeaderLength ? tr("Log file is too short") : tr("Couldn't map log file: %1").arg(_file.errorString());
+        close();
+        return false;
+    }
+    if (memcmp(_data, _ulogMagic, sizeof(_ulogMagic)) != 0) {
+        errorString = tr("Could not detect ULog file header magic");
+        close();
+        return false;
+    }
+    _startTime = qFromLittleEndian<quint64>(_data + 8);
+
+    _index();
+
+    return true;
+}
+
+void ULogReader::close(void)
+{
+    if (_data) {
+        _file.unmap(const_cast<uchar*>(_data));
+        _data = nullptr;
+    }
+    _file.close();
+    _size       = 0;
+    _truncated  = false;
+    _startTime  = 0;
+    _formats.clear();
+    _subscriptions.clear();
+    _msgIdSubscriptions.clear();
+}
+
+void ULogReader::_index(void)
+{
+    _msgIdSubscriptions.fill(-1, 0x10000);
+
+    int     dataMessageCount    = 0;
+    qint64  position            = _fileHeaderLength;
+    while (position + _messageHeaderLength <= _size) {
+        quint16 payloadSize     = qFromLittleEndian<quint16>(_data + position);
+        quint8  messageType     = _data[position + 2];
+        qint64  payloadOffset   = position + _messageHeaderLength;
+
+        if (payloadOffset + payloadSize > _size) {
+            // Logger was stopped mid write
+            _truncated = true;
+            break;
+        }
+        const uchar* payload = _data + payloadOffset;
+
+        switch (messageType) {
+        case ULogMessageFormat:
+            _parseFormat(QString::fromLatin1(reinterpret_cast<const char*>(payload), payloadSize));
+            break;
+        case ULogMessageAddLogged:
+            if (payloadSize > 3) {
+                Subscription_t subscription;
+                int nameLength = payloadSize - 3;
+                const char* name = reinterpret_cast<const char*>(payload + 3);
+                const char* nul = static_cast<const char*>(memchr(name, 0, static_cast<size_t>(nameLength)));
+                subscription.topic      = QString::fromLatin1(name, nul ? static_cast<int>(nul - name) : nameLength);
+                subscription.multiId    = payload[0];
+                _msgIdSubscriptions[qFromLittleEndian<quint16>(payload + 1)] = _subscriptions.count();
+                _subscriptions.append(subscription);
+            }
+            break;
+        case ULogMessageRemoveLogged:
+            if (payloadSize >= 2) {
+                _msgIdSubscriptions[qFromLittleEndian<quint16>(payload)] = -1;
+            }
+            break;
+        case ULogMessageData:
+            if (payloadSize >= 2) {
+                int subscription = _msgIdSubscriptions[qFromLittleEndian<quint16>(payload)];
+                if (subscription != -1) {
+                    _subscriptions[subscription].offsets.append(payloadOffset + 2);
+                    dataMessageCount++;
+                }
+            }
+            break;
+        default:
+            // Info, parameters, logging, sync and dropout messages aren't indexed
+            break;
+        }
+
+        position = payloadOffset + payloadSize;
+    }
+
+    _msgIdSubscriptions.clear();
+    _msgIdSubscriptions.squeeze();
+
+    for (const QString& name: _formats.keys()) {
+        _resolveFormat(name, 0);
+    }
+
+    qCDebug(ULogReaderLog) << "Indexed" << _file.fileName() << "formats" << _formats.count() << "subscriptions" << _subscriptions.count() << "data messages" << dataMessageCount << "truncated" << _truncated;
+}
+
+void ULogReader::_parseFormat(const QString& format)
+{
+    // message_name:type field;type field;...
+    int nameEnd = format.indexOf(QLatin1Char(':'));
+    if (nameEnd <= 0) {
+        qCWarning(ULogReaderLog) << "Bad format message" << format;
+        return;
+    }
+
+    Format_t parsedFormat;
+    parsedFormat.size = -1;
+
+    const QStringList fields = format.mid(nameEnd + 1).split(QLatin1Char(';'), QString::SkipEmptyParts);
+    for (const QString& field: fields) {
+        int spacePos = field.indexOf(QLatin1Char(' '));
+        if (spacePos == -1) {
+            continue;
+        }
+
+        RawField_t rawField;
+        QString typeNameFull = field.left(spacePos);
+        rawField.name = field.mid(spacePos + 1).trimmed();
+
+        int arrayStart = typeNameFull.indexOf(QLatin1Char('['));
+        int arrayEnd = typeNameFull.indexOf(QLatin1Char(']'));
+        if (arrayStart != -1 && arrayEnd > arrayStart) {
+            rawField.typeName   = typeNameFull.left(arrayStart);
+            rawField.arraySize  = typeNameFull.midRef(arrayStart + 1, arrayEnd - arrayStart - 1).toInt();
+        } else {
+            rawField.typeName   = typeNameFull;
+            rawField.arraySize  = 1;
+        }
+        parsedFormat.rawFields.append(rawField);
+    }
+
+    _formats.insert(format.left(nameEnd), parsedFormat);
+}
+
+bool ULogReader::_basicType(const QString& typeName, FieldType& type, int& size)
+{
+    static const QHash<QString, QPair<FieldType, int>> basicTypes = {
+        { QStringLiteral("int8_t"),     { FieldTypeInt8,    1 } },
+        { QStringLiteral("uint8_t"),    { FieldTypeUInt8,   1 } },
+        { QStringLiteral("int16_t"),    { FieldTypeInt16,   2 } },
+        { QStringLiteral("uint16_t"),   { FieldTypeUInt16,  2 } },
+        { QStringLiteral("int32_t"),    { FieldTypeInt32,   4 } },
+        { QStringLiteral("uint32_t"),   { FieldTypeUInt32,  4 } },
+        { QStringLiteral("int64_t"),    { FieldTypeInt64,   8 } },
+        { QStringLiteral("uint64_t"),   { FieldTypeUInt64,  8 } },
+        { QStringLiteral("float"),      { FieldTypeFloat,   4 } },
+        { QStringLiteral("double"),     { FieldTypeDouble,  8 } },
+        { QStringLiteral("bool"),       { FieldTypeBool,    1 } },
+        { QStringLiteral("char"),       { FieldTypeChar,    1 } },
+    };
+
+    auto it = basicTypes.constFind(typeName);
+    if (it == basicTypes.constEnd()) {
+        return false;
+    }
+    type = it.value().first;
+    size = it.value().second;
+    return true;
+}
+
+/// Computes field offsets, which requires the size of any nested formats
+/// @return Size of the format in bytes, -2 if it can't be resolved
+int ULogReader::_resolveFormat(const QString& name, int depth)
+{
+    auto it = _formats.find(name);
+    if (it == _formats.end() || depth > _maxFormatDepth) {
+        return -2;
+    }
+    if (it->size != -1) {
+        return it->size;
+    }
+
+    QList<RawField_t>       rawFields = it->rawFields;
+    QHash<QString, Field_t> fields;
+    int                     offset = 0;
+
+    for (const RawField_t& rawField: rawFields) {
+        FieldType   type;
+        int         typeSize;
+        bool        padding = rawField.name.startsWith(QLatin1String("_padding"));
+
+        if (_basicType(rawField.typeName, type, typeSize)) {
+            if (!padding) {
+                fields.insert(rawField.name, { type, offset, rawField.arraySize });
+            }
+        } else {
+            typeSize = _resolveFormat(rawField.typeName, depth + 1);
+            if (typeSize < 0) {
+                qCWarning(ULogReaderLog) << "Unknown type" << rawField.typeName << "in format" << name;
+                _formats[name].size = -2;
+                return -2;
+            }
+            const QHash<QString, Field_t> nestedFields = _formats[rawField.typeName].fields;
+            for (int i = 0; i < rawField.arraySize; i++) {
+                QString prefix = rawField.arraySize == 1 ? rawField.name : QStringLiteral("%1[%2]").arg(rawField.name).arg(i);
+                for (auto nested = nestedFields.constBegin(); nested != nestedFields.constEnd(); nested++) {
+                    Field_t field = nested.value();
+                    field.offset += offset + (i * typeSize);
+                    fields.insert(prefix + QLatin1Char('.') + nested.key(), field);
+                }
+            }
+        }
+        offset += typeSize * rawField.arraySize;
+    }
+
+    Format_t& format = _formats[name];
+    format.fields   = fields;
+    format.size     = offset;
+    return offset;
+}
+
+QStringList ULogReader::topics(void) const
+{
+    QStringList names;
+    for (const Subscription_t& subscription: _subscriptions) {
+        if (!names.contains(subscription.topic)) {
+            names.append(subscription.topic);
+        }
+    }
+    return names;
+}
+
+QList<int> ULogReader::subscriptions(const QString& topic) const
+{
+    QList<int> result;
+    for (int i = 0; i < _subscriptions.count(); i++) {
+        if (_subscriptions[i].topic == topic) {
+            result.append(i);
+        }
+    }
+    return result;
+}
+
+bool ULogReader::field(int subscription, const QString& name, Field_t& field) const
+{
+    auto format = _formats.constFind(_subscriptions[subscription].topic);
+    if (format == _formats.constEnd() || format->size < 0) {
+        return false;
+    }
+    auto it = format->fields.constFind(name);
+    if (it == format->fields.constEnd()) {
+        return false;
+    }
+    field = it.value();
+    return true;
+}
+
+QStringList ULogReader::fieldNames(int subscription) const
+{
+    auto format = _formats.constFind(_subscriptions[subscription].topic);
+    if (format == _formats.constEnd() || format->size < 0) {
+        return QStringList();
+    }
+    return format->fields.keys();
+}
+
+ULogReader::Message ULogReader::message(int subscription, int index) const
+{
+    qint64 payloadOffset = _subscriptions[subscription].offsets.at(index);
+    // The message header precedes the msg_id
+    quint16 payloadSize = qFromLittleEndian<quint16>(_data + payloadOffset - 2 - _messageHeaderLength);
+    return Message(_data + payloadOffset, payloadSize - 2);
+}
@@ -0,0 +1,190 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGCLoggingCategory.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtEndian>
+
+Q_DECLARE_LOGGING_CATEGORY(ULogReaderLog)
+
+class ULogReaderTest;
+
+/// Memory mapped ULog reader. A single pass over the file collects the message formats and an index of where the
+/// data messages of each logged topic are. Message contents are read straight out of the mapping on demand, so
+/// memory use doesn't grow with the size of the log beyond the index (4 bytes per data message).
+///
+/// Usage:
+///     ULogReader reader;
+///     reader.open(path, errorString);
+///     for (int subscription: reader.subscriptions("vehicle_gps_position")) {
+///         ULogReader::Field_t lat;
+///         reader.field(subscription, "lat", lat);
+///         for (int i = 0; i < reader.messageCount(subscription); i++) {
+///             double value = reader.message(subscription, i).toDouble(lat);
+///         }
+///     }
+class ULogReader
+{
+    Q_DECLARE_TR_FUNCTIONS(ULogReader)
+
+    friend class ULogReaderTest;
+
+public:
+    enum FieldType {
+        FieldTypeInt8,
+        FieldTypeUInt8,
+        FieldTypeInt16,
+        FieldTypeUInt16,
+        FieldTypeInt32,
+        FieldTypeUInt32,
+        FieldTypeInt64,
+        FieldTypeUInt64,
+        FieldTypeFloat,
+        FieldTypeDouble,
+        FieldTypeBool,
+        FieldTypeChar,
+    };
+
+    /// Location of a field within the data messages of a topic. Fields of nested types are flattened to
+    /// "parent.child", or "parent[index].child" for arrays of nested types.
+    typedef struct {
+        FieldType   type;
+        int         offset;     ///< Byte offset in the message payload
+        int         arraySize;  ///< 1 for scalars
+    } Field_t;
+
+    /// One data message, read in place from the mapped file. Only valid while the reader is open.
+    class Message
+    {
+    public:
+        Message(const uchar* data = nullptr, int size = 0)
+            : _data (data)
+            , _size (size)
+        { }
+
+        bool            isValid (void) const { return _data != nullptr; }
+        const uchar*    data    (void) const { return _data; }
+        int             size    (void) const { return _size; }
+
+        /// @return false: field element lies outside this message (truncated message or wrong topic)
+        bool contains(const Field_t& field, int index = 0) const;
+
+        /// Field element converted to the requested type, 0 if not contained in the message
+        double  toDouble    (const Field_t& field, int index = 0) const;
+        qint64  toInt64     (const Field_t& field, int index = 0) const;
+        quint64 toUInt64    (const Field_t& field, int index = 0) const;
+
+        /// Character array field as a string, stops at the first nul
+        QString toString    (const Field_t& field) const;
+
+        /// Raw little endian value at a payload offset, no bounds or type checking
+        template<typename T>
+        T value(int offset) const { return qFromLittleEndian<T>(_data + offset); }
+
+    private:
+        static int _typeSize(FieldType type);
+
+        const uchar*    _data;
+        int             _size;
+    };
+
+    ULogReader(void);
+    ~ULogReader();
+
+    /// Maps the file and indexes it
+    ///     @param[out] errorString Reason the file can't be read
+    /// @return false: Not a readable ULog file
+    bool open   (const QString& path, QString& errorString);
+    void close  (void);
+
+    bool    isOpen      (void) const { return _data != nullptr; }
+    bool    truncated   (void) const { return _truncated; } ///< Indexing stopped at a damaged or incomplete message
+    quint64 startTime   (void) const { return _startTime; } ///< Microseconds, from the file header
+
+    /// Names of all topics which have been logged
+    QStringList topics(void) const;
+
+    /// Subscriptions for a topic, one per multi instance. Subscriptions are identified by index.
+    QList<int> subscriptions(const QString& topic) const;
+
+    QString subscriptionTopic   (int subscription) const { return _subscriptions[subscription].topic; }
+    int     subscriptionMultiId (int subscription) const { return _subscriptions[subscription].multiId; }
+
+    /// Looks up a field of a subscription's topic
+    /// @return false: no such field, or the format can't be resolved
+    bool field(int subscription, const QString& name, Field_t& field) const;
+
+    /// Names of all fields of a subscription's topic
+    QStringList fieldNames(int subscription) const;
+
+    int     messageCount    (int subscription) const { return _subscriptions[subscription].offsets.count(); }
+    Message message         (int subscription, int index) const;
+
+private:
+    typedef struct {
+        QString typeName;
+        int     arraySize;
+        QString name;
+    } RawField_t;
+
+    typedef struct {
+        QList<RawField_t>           rawFields;
+        QHash<QString, Field_t>     fields;
+        int                         size;       ///< -1: not resolved yet, -2: can't be resolved
+    } Format_t;
+
+    /// Data message payload offsets. File offsets above 4GB are split into a shared high word, which only changes
+    /// a handful of times even in the largest logs, and a per message low word.
+    class OffsetIndex
+    {
+        friend class ::ULogReaderTest;
+
+    public:
+        void    append  (qint64 offset);
+        qint64  at      (int index) const;
+        int     count   (void) const { return _low.count(); }
+
+    private:
+        QVector<quint32>    _low;
+        QVector<int>        _highStarts;    ///< Message index at which each successive high word starts
+    };
+
+    typedef struct {
+        QString     topic;
+        int         multiId;
+        OffsetIndex offsets;
+    } Subscription_t;
+
+    void    _index          (void);
+    void    _parseFormat    (const QString& format);
+    int     _resolveFormat  (const QString& name, int depth);
+
+    static bool _basicType(const QString& typeName, FieldType& type, int& size);
+
+    QFile                           _file;
+    const uchar*                    _data       = nullptr;
+    qint64                          _size       = 0;
+    bool                            _truncated  = false;
+    quint64                         _startTime  = 0;
+    QHash<QString, Format_t>        _formats;
+    QVector<Subscription_t>         _subscriptions;
+    QVector<int>                    _msgIdSubscriptions;    ///< Indexed by msg_id, -1 for none
+
+    static const int _fileHeaderLength      = 16;
+    static const int _messageHeaderLength   = 3;
+};
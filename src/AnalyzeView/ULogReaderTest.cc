@@ -0,0 +1,419 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ULogReaderTest.h"
+#include "ULogReader.h"
+#include "ULogParser.h"
+
+#include <QtEndian>
+#include <cstring>
+
+static const quint64    _startTime      = 123456789;
+static const int        _sensorSize     = 52;
+
+static const char* _vec3Format      = "vec3:float x;float y;float z;";
+static const char* _sensorFormat    = "sensor:uint64_t timestamp;vec3 accel;vec3[2] mag;uint8_t flags;uint8_t[3] _padding0;int32_t count;";
+static const char* _captureFormat   = "camera_capture:uint64_t timestamp;uint64_t timestamp_utc;uint32_t seq;double lat;double lon;"
+                                      "float alt;float ground_distance;float[4] q;int8_t result;uint8_t[3] _padding0;";
+
+template<typename T>
+static void _appendValue(QByteArray& bytes, T value)
+{
+    uchar buffer[sizeof(T)];
+    qToLittleEndian<T>(value, buffer);
+    bytes.append(reinterpret_cast<const char*>(buffer), sizeof(T));
+}
+
+static void _appendFloat(QByteArray& bytes, float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    _appendValue<quint32>(bytes, bits);
+}
+
+static void _appendDouble(QByteArray& bytes, double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    _appendValue<quint64>(bytes, bits);
+}
+
+void ULogReaderTest::_appendHeader(QByteArray& log, quint64 startTime)
+{
+    const char magic[] = { 'U', 'L', 'o', 'g', 0x01, 0x12, 0x35 };
+    log.append(magic, sizeof(magic));
+    log.append(static_cast<char>(1));   // Version
+    _appendValue<quint64>(log, startTime);
+}
+
+void ULogReaderTest::_appendMessage(QByteArray& log, char type, const QByteArray& payload)
+{
+    _appendValue<quint16>(log, static_cast<quint16>(payload.size()));
+    log.append(type);
+    log.append(payload);
+}
+
+void ULogReaderTest::_appendFormat(QByteArray& log, const char* format)
+{
+    _appendMessage(log, 'F', QByteArray(format));
+}
+
+void ULogReaderTest::_appendAddLogged(QByteArray& log, quint8 multiId, quint16 msgId, const char* topic)
+{
+    QByteArray payload;
+    _appendValue<quint8>(payload, multiId);
+    _appendValue<quint16>(payload, msgId);
+    payload.append(topic);
+    _appendMessage(log, 'A', payload);
+}
+
+void ULogReaderTest::_appendData(QByteArray& log, quint16 msgId, const QByteArray& data)
+{
+    QByteArray payload;
+    _appendValue<quint16>(payload, msgId);
+    payload.append(data);
+    _appendMessage(log, 'D', payload);
+}
+
+QByteArray ULogReaderTest::_sensorData(quint64 timestamp, float base, qint32 count)
+{
+    QByteArray data;
+    _appendValue<quint64>(data, timestamp);
+    for (int i = 0; i < 3; i++) {
+        _appendFloat(data, base + i);           // accel
+    }
+    for (int i = 0; i < 3; i++) {
+        _appendFloat(data, base + 10 + i);      // mag[0]
+    }
+    for (int i = 0; i < 3; i++) {
+        _appendFloat(data, base + 20 + i);      // mag[1]
+    }
+    _appendValue<quint8>(data, 0xA5);           // flags
+    data.append(3, static_cast<char>(0xFF));    // _padding0
+    _appendValue<qint32>(data, count);
+    return data;
+}
+
+QByteArray ULogReaderTest::_sensorLog(void)
+{
+    QByteArray log;
+
+    _appendHeader(log, _startTime);
+    // Nested formats can come after the formats using them
+    _appendFormat(log, _sensorFormat);
+    _appendFormat(log, _vec3Format);
+    _appendFormat(log, "broken:uint64_t timestamp;missing_t value;");
+    _appendMessage(log, 'I', QByteArray("\x0B" "char[3] ver" "abc", 15));
+
+    _appendAddLogged(log, 0, 1, "sensor");
+    _appendAddLogged(log, 1, 7, "sensor");
+    _appendAddLogged(log, 0, 9, "broken");
+
+    for (int i = 0; i < 3; i++) {
+        _appendData(log, 1, _sensorData(1000 * (i + 1), 100.0f * i, -i));
+        if (i < 2) {
+            _appendData(log, 7, _sensorData((1000 * (i + 1)) + 500, (100.0f * i) + 50, 1000 + i));
+        }
+    }
+    _appendData(log, 9, QByteArray(8, 0));
+
+    // Data for an unsubscribed id is skipped, as is data after a subscription is removed
+    _appendData(log, 4, _sensorData(9999, 0, 0));
+    QByteArray removePayload;
+    _appendValue<quint16>(removePayload, 7);
+    _appendMessage(log, 'R', removePayload);
+    _appendData(log, 7, _sensorData(9999, 0, 0));
+
+    return log;
+}
+
+QString ULogReaderTest::_writeLog(const QByteArray& log)
+{
+    static int fileIndex = 0;
+
+    QString path = _tempDir.filePath(QStringLiteral("test%1.ulg").arg(fileIndex++));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(log) != log.size()) {
+        return QString();
+    }
+    return path;
+}
+
+void ULogReaderTest::_formats_test(void)
+{
+    QVERIFY(_tempDir.isValid());
+    QString path = _writeLog(_sensorLog());
+    QVERIFY(!path.isEmpty());
+
+    ULogReader  reader;
+    QString     errorString;
+    QVERIFY2(reader.open(path, errorString), qPrintable(errorString));
+    QCOMPARE(reader.startTime(), _startTime);
+    QVERIFY(!reader.truncated());
+
+    QCOMPARE(reader._formats[QStringLiteral("vec3")].size, 12);
+    QCOMPARE(reader._formats[QStringLiteral("sensor")].size, _sensorSize);
+    QCOMPARE(reader._formats[QStringLiteral("broken")].size, -2);
+
+    QList<int> sensors = reader.subscriptions(QStringLiteral("sensor"));
+    QCOMPARE(sensors.count(), 2);
+
+    // Nested fields are flattened, arrays of nested types are indexed
+    QStringList expectedNames = {
+        QStringLiteral("timestamp"),
+        QStringLiteral("accel.x"), QStringLiteral("accel.y"), QStringLiteral("accel.z"),
+        QStringLiteral("mag[0].x"), QStringLiteral("mag[0].y"), QStringLiteral("mag[0].z"),
+        QStringLiteral("mag[1].x"), QStringLiteral("mag[1].y"), QStringLiteral("mag[1].z"),
+        QStringLiteral("flags"), QStringLiteral("count"),
+    };
+    QStringList fieldNames = reader.fieldNames(sensors[0]);
+    fieldNames.sort();
+    expectedNames.sort();
+    QCOMPARE(fieldNames, expectedNames);
+
+    struct {
+        const char*             name;
+        ULogReader::FieldType   type;
+        int                     offset;
+    } rgExpectedFields[] = {
+        { "timestamp",  ULogReader::FieldTypeUInt64,    0 },
+        { "accel.x",    ULogReader::FieldTypeFloat,     8 },
+        { "accel.z",    ULogReader::FieldTypeFloat,     16 },
+        { "mag[0].x",   ULogReader::FieldTypeFloat,     20 },
+        { "mag[1].x",   ULogReader::FieldTypeFloat,     32 },
+        { "mag[1].z",   ULogReader::FieldTypeFloat,     40 },
+        { "flags",      ULogReader::FieldTypeUInt8,     44 },
+        // Follows the padding
+        { "count",      ULogReader::FieldTypeInt32,     48 },
+    };
+    for (const auto& expectedField: rgExpectedFields) {
+        ULogReader::Field_t field;
+        QVERIFY2(reader.field(sensors[0], QString(expectedField.name), field), expectedField.name);
+        QCOMPARE(field.type, expectedField.type);
+        QCOMPARE(field.offset, expectedField.offset);
+        QCOMPARE(field.arraySize, 1);
+    }
+
+    // Padding isn't a field
+    ULogReader::Field_t field;
+    QVERIFY(!reader.field(sensors[0], QStringLiteral("_padding0"), field));
+    QVERIFY(!reader.field(sensors[0], QStringLiteral("mag"), field));
+
+    // A format with an unknown nested type has no fields, but the topic is still indexed
+    QList<int> broken = reader.subscriptions(QStringLiteral("broken"));
+    QCOMPARE(broken.count(), 1);
+    QVERIFY(!reader.field(broken[0], QStringLiteral("timestamp"), field));
+    QVERIFY(reader.fieldNames(broken[0]).isEmpty());
+    QCOMPARE(reader.messageCount(broken[0]), 1);
+}
+
+void ULogReaderTest::_subscriptions_test(void)
+{
+    QVERIFY(_tempDir.isValid());
+    QString path = _writeLog(_sensorLog());
+
+    ULogReader  reader;
+    QString     errorString;
+    QVERIFY2(reader.open(path, errorString), qPrintable(errorString));
+
+    QCOMPARE(reader.topics(), QStringList({ QStringLiteral("sensor"), QStringLiteral("broken") }));
+    QVERIFY(reader.subscriptions(QStringLiteral("camera_capture")).isEmpty());
+
+    QList<int> sensors = reader.subscriptions(QStringLiteral("sensor"));
+    QCOMPARE(sensors.count(), 2);
+    QCOMPARE(reader.subscriptionTopic(sensors[0]), QStringLiteral("sensor"));
+    QCOMPARE(reader.subscriptionMultiId(sensors[0]), 0);
+    QCOMPARE(reader.subscriptionMultiId(sensors[1]), 1);
+
+    // Interleaved data lands on the right instance, the data logged after the remove is dropped
+    QCOMPARE(reader.messageCount(sensors[0]), 3);
+    QCOMPARE(reader.messageCount(sensors[1]), 2);
+
+    ULogReader::Field_t timestamp, accelY, mag1Z, flags, count;
+    QVERIFY(reader.field(sensors[0], QStringLiteral("timestamp"),   timestamp));
+    QVERIFY(reader.field(sensors[0], QStringLiteral("accel.y"),     accelY));
+    QVERIFY(reader.field(sensors[0], QStringLiteral("mag[1].z"),    mag1Z));
+    QVERIFY(reader.field(sensors[0], QStringLiteral("flags"),       flags));
+    QVERIFY(reader.field(sensors[0], QStringLiteral("count"),       count));
+
+    for (int instance = 0; instance < 2; instance++) {
+        for (int i = 0; i < reader.messageCount(sensors[instance]); i++) {
+            ULogReader::Message message = reader.message(sensors[instance], i);
+            float base = (100.0f * i) + (instance * 50);
+
+            QVERIFY(message.isValid());
+            QCOMPARE(message.size(), _sensorSize);
+            QCOMPARE(message.toUInt64(timestamp), static_cast<quint64>((1000 * (i + 1)) + (instance * 500)));
+            QCOMPARE(message.toDouble(accelY), static_cast<double>(base + 1));
+            QCOMPARE(message.toDouble(mag1Z), static_cast<double>(base + 22));
+            QCOMPARE(message.toInt64(flags), static_cast<qint64>(0xA5));
+            QCOMPARE(message.toInt64(count), static_cast<qint64>(instance ? 1000 + i : -i));
+        }
+    }
+
+    // Reading past the end of a field array or the message reads as 0
+    ULogReader::Message message = reader.message(sensors[0], 1);
+    QVERIFY(!message.contains(accelY, 1));
+    QCOMPARE(message.toDouble(accelY, 1), 0.0);
+    ULogReader::Field_t pastEnd = { ULogReader::FieldTypeUInt64, _sensorSize - 4, 1 };
+    QVERIFY(!message.contains(pastEnd));
+    QCOMPARE(message.toUInt64(pastEnd), static_cast<quint64>(0));
+}
+
+void ULogReaderTest::_truncated_test(void)
+{
+    QVERIFY(_tempDir.isValid());
+
+    // Logger stopped in the middle of writing a data message
+    QByteArray log = _sensorLog();
+    QByteArray partial;
+    _appendData(partial, 1, _sensorData(4000, 300, 3));
+    log.append(partial.left(partial.size() / 2));
+
+    ULogReader  reader;
+    QString     errorString;
+    QVERIFY2(reader.open(_writeLog(log), errorString), qPrintable(errorString));
+    QVERIFY(reader.truncated());
+    QCOMPARE(reader.messageCount(reader.subscriptions(QStringLiteral("sensor"))[0]), 3);
+
+    reader.close();
+    QVERIFY(!reader.isOpen());
+    QVERIFY(!reader.truncated());
+    QVERIFY(reader.topics().isEmpty());
+}
+
+void ULogReaderTest::_badFile_test(void)
+{
+    QVERIFY(_tempDir.isValid());
+
+    ULogReader  reader;
+    QString     errorString;
+
+    QVERIFY(!reader.open(_tempDir.filePath(QStringLiteral("missing.ulg")), errorString));
+    QVERIFY(!errorString.isEmpty());
+
+    errorString.clear();
+    QVERIFY(!reader.open(_writeLog(QByteArray("ULog")), errorString));
+    QVERIFY(!errorString.isEmpty());
+
+    QByteArray log = _sensorLog();
+    log[0] = 'X';
+    errorString.clear();
+    QVERIFY(!reader.open(_writeLog(log), errorString));
+    QVERIFY(!errorString.isEmpty());
+    QVERIFY(!reader.isOpen());
+}
+
+void ULogReaderTest::_offsetIndex_test(void)
+{
+    // Offsets walking past 4GB, including a jump over a whole high word
+    const qint64 fourGB = Q_INT64_C(1) << 32;
+    const QList<qint64> offsets = {
+        16,
+        fourGB - 100,
+        fourGB + 2,
+        fourGB + 5000,
+        (3 * fourGB) + 7,
+        (3 * fourGB) + 0xFFFFFFF0,
+    };
+
+    ULogReader::OffsetIndex index;
+    for (qint64 offset: offsets) {
+        index.append(offset);
+    }
+
+    QCOMPARE(index.count(), offsets.count());
+    for (int i = 0; i < offsets.count(); i++) {
+        QCOMPARE(index.at(i), offsets[i]);
+    }
+
+    // Each high word step records the first message past it, a skipped high word shares the start
+    QCOMPARE(index._highStarts, QVector<int>({ 2, 4, 4 }));
+    QCOMPARE(index._low.count(), offsets.count());
+}
+
+QByteArray ULogReaderTest::cameraCaptureLog(const QList<GeoTagWorker::cameraFeedbackPacket>& captures)
+{
+    QByteArray log;
+    _appendHeader(log, _startTime);
+    _appendFormat(log, _captureFormat);
+    _appendAddLogged(log, 0, 3, "camera_capture");
+
+    for (const GeoTagWorker::cameraFeedbackPacket& capture: captures) {
+        QByteArray data;
+        _appendValue<quint64>(data, static_cast<quint64>(capture.timestamp * 1.0e6));
+        _appendValue<quint64>(data, static_cast<quint64>(capture.timestampUTC * 1.0e6));
+        _appendValue<quint32>(data, capture.imageSequence);
+        _appendDouble(data, capture.latitude);
+        _appendDouble(data, capture.longitude);
+        _appendFloat(data, capture.altitude);
+        _appendFloat(data, capture.groundDistance);
+        for (int i = 0; i < 4; i++) {
+            _appendFloat(data, capture.attitudeQuaternion[i]);
+        }
+        _appendValue<quint8>(data, capture.captureResult);
+        data.append(3, 0);  // _padding0
+        _appendData(log, 3, data);
+    }
+
+    return log;
+}
+
+void ULogReaderTest::_cameraCapture_test(void)
+{
+    QVERIFY(_tempDir.isValid());
+
+    QList<GeoTagWorker::cameraFeedbackPacket> captures;
+    for (int i = 0; i < 2; i++) {
+        GeoTagWorker::cameraFeedbackPacket capture;
+        memset(&capture, 0, sizeof(capture));
+        capture.timestamp       = 5.0 * (i + 1);
+        capture.timestampUTC    = 1600000000.0 + i;
+        capture.imageSequence   = static_cast<uint32_t>(10 + i);
+        capture.latitude        = 47.5 + i;
+        capture.longitude       = i ? 190.0 : 8.25;     // The second one wraps to -170
+        capture.altitude        = 500.5f;
+        capture.groundDistance  = 30.25f;
+        for (int j = 0; j < 4; j++) {
+            capture.attitudeQuaternion[j] = 0.5f * j;
+        }
+        capture.captureResult   = 1;
+        captures.append(capture);
+    }
+
+    ULogReader  reader;
+    QString     errorString;
+    QVERIFY2(reader.open(_writeLog(cameraCaptureLog(captures)), errorString), qPrintable(errorString));
+
+    ULogParser                                  parser;
+    QList<GeoTagWorker::cameraFeedbackPacket>   feedback;
+    QVERIFY2(parser.getTagsFromLog(reader, feedback, errorString), qPrintable(errorString));
+    QCOMPARE(feedback.count(), captures.count());
+
+    for (int i = 0; i < captures.count(); i++) {
+        QCOMPARE(feedback[i].timestamp,         captures[i].timestamp);
+        QCOMPARE(feedback[i].timestampUTC,      captures[i].timestampUTC);
+        QCOMPARE(feedback[i].imageSequence,     captures[i].imageSequence);
+        QCOMPARE(feedback[i].latitude,          captures[i].latitude);
+        QCOMPARE(feedback[i].longitude,         i ? -170.0 : 8.25);
+        QCOMPARE(feedback[i].altitude,          captures[i].altitude);
+        QCOMPARE(feedback[i].groundDistance,    captures[i].groundDistance);
+        for (int j = 0; j < 4; j++) {
+            QCOMPARE(feedback[i].attitudeQuaternion[j], captures[i].attitudeQuaternion[j]);
+        }
+        QCOMPARE(feedback[i].captureResult,     captures[i].captureResult);
+    }
+
+    // No camera_capture topic at all
+    QVERIFY2(reader.open(_writeLog(_sensorLog()), errorString), qPrintable(errorString));
+    feedback.clear();
+    QVERIFY(!parser.getTagsFromLog(reader, feedback, errorString));
+    QVERIFY(!errorString.isEmpty());
+    QVERIFY(feedback.isEmpty());
+}
@@ -0,0 +1,51 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "GeoTagController.h"
+
+#include <QTemporaryDir>
+
+/// Unit test for ULogReader and ULogParser, against small logs generated by the test
+class ULogReaderTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    /// Log with a camera_capture message for each capture
+    static QByteArray cameraCaptureLog(const QList<GeoTagWorker::cameraFeedbackPacket>& captures);
+
+private slots:
+    void _formats_test          (void);
+    void _subscriptions_test    (void);
+    void _truncated_test        (void);
+    void _badFile_test          (void);
+    void _offsetIndex_test      (void);
+    void _cameraCapture_test    (void);
+
+private:
+    /// File header, formats and subscriptions, followed by interleaved data from two sensor instances
+    QByteArray _sensorLog(void);
+
+    /// Writes the log to a file in _tempDir
+    QString _writeLog(const QByteArray& log);
+
+    static void _appendHeader       (QByteArray& log, quint64 startTime);
+    static void _appendMessage      (QByteArray& log, char type, const QByteArray& payload);
+    static void _appendFormat       (QByteArray& log, const char* format);
+    static void _appendAddLogged    (QByteArray& log, quint8 multiId, quint16 msgId, const char* topic);
+    static void _appendData         (QByteArray& log, quint16 msgId, const QByteArray& data);
+
+    /// Data for the sensor format. Every float is based off base so fields can be told apart.
+    static QByteArray _sensorData(quint64 timestamp, float base, qint32 count);
+
+    QTemporaryDir _tempDir;
+};
@@ -0,0 +1,645 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "VehicleLogDownloader.h"
+#include "LogDownloadController.h"
+#include "QGCMAVLink.h"
+#include "UAS.h"
+#include "QGCApplication.h"
+#include "QGCToolbox.h"
+#include "QGCMapEngine.h"
+#include "ParameterManager.h"
+#include "Vehicle.h"
+
+#include <QBitArray>
+#include <QDataStream>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QtCore/qmath.h>
+
+#define kTimeOutMilliseconds    500
+#define kStatusMilliseconds     250
+#define kResumeSaveMilliseconds 5000
+#define kTableBins              512
+#define kWindowChunks           4
+#define kWindowBins             (kWindowChunks * kTableBins)
+#define kWriteBufferSize        (64 * 1024)
+#define kResumeMagic            0x51474c52
+#define kResumeVersion          1
+
+const char* VehicleLogDownloader::resumeFileExtension = "resume";
+
+//-----------------------------------------------------------------------------
+struct LogDownloadData {
+    LogDownloadData(const VehicleLogDownloader::LogInfo_t& log);
+    QBitArray     bins;                 ///< One bit per MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN bin of the whole file, set once received
+    uint32_t      numBins;
+    uint32_t      receivedBins;
+    uint32_t      requestStart;         ///< First bin of the outstanding request
+    uint32_t      requestEnd;           ///< One past the last bin of the outstanding request
+    uint32_t      frontier;             ///< First bin which has never been requested
+    uint32_t      repairCursor;         ///< Where the search for lost bins resumes once the frontier reaches the end
+    QByteArray    writeBuffer;          ///< Contiguous data which has not been written to the file yet
+    uint32_t      writeBufferOffset;    ///< File offset of the start of writeBuffer
+    QFile         file;
+    QString       filename;
+    VehicleLogDownloader::LogInfo_t log;
+    uint          written;
+    size_t        rate_bytes;
+    qreal         rate_avg;
+    QElapsedTimer elapsed;
+    QElapsedTimer resumeSaved;          ///< Time since the received bins were last saved
+
+    bool complete() const
+    {
+        return receivedBins == numBins;
+    }
+
+    // First bin at or after from which hasn't been received, wrapping around to the start. numBins if there are none.
+    uint32_t nextMissingBin(uint32_t from) const
+    {
+        for (uint32_t i = 0; i < numBins; i++) {
+            const uint32_t bin = (from + i) % numBins;
+            if (!bins.testBit(bin)) {
+                return bin;
+            }
+        }
+        return numBins;
+    }
+
+    QString resumeFilename() const
+    {
+        return file.fileName() + QStringLiteral(".") + VehicleLogDownloader::resumeFileExtension;
+    }
+};
+
+//----------------------------------------------------------------------------------------
+LogDownloadData::LogDownloadData(const VehicleLogDownloader::LogInfo_t& log_)
+    : numBins(qCeil(log_.size / static_cast<qreal>(MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN)))
+    , receivedBins(0)
+    , requestStart(0)
+    , requestEnd(0)
+    , frontier(0)
+    , repairCursor(0)
+    , writeBufferOffset(0)
+    , log(log_)
+    , written(0)
+    , rate_bytes(0)
+    , rate_avg(0)
+{
+    bins = QBitArray(static_cast<int>(numBins), false);
+}
+
+//----------------------------------------------------------------------------------------
+VehicleLogDownloader::VehicleLogDownloader(Vehicle* vehicle, QObject* parent)
+    : QObject(parent)
+    , _vehicle(vehicle)
+    , _downloadData(nullptr)
+    , _retries(0)
+    , _apmOneBased(0)
+    , _bytesTotal(0)
+    , _bytesCompleted(0)
+    , _downloading(false)
+{
+    connect(_vehicle->uas(), &UASInterface::logData, this, &VehicleLogDownloader::_logData);
+    connect(&_timer, &QTimer::timeout, this, &VehicleLogDownloader::_findMissingData);
+    _statusTimer.setInterval(kStatusMilliseconds);
+    connect(&_statusTimer, &QTimer::timeout, this, &VehicleLogDownloader::_updateDataRate);
+}
+
+//----------------------------------------------------------------------------------------
+VehicleLogDownloader::~VehicleLogDownloader()
+{
+    if (_downloadData) {
+        //-- Keep what we have so the next attempt can pick up from here
+        _saveResumeState();
+        delete _downloadData;
+        _downloadData = nullptr;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+int
+VehicleLogDownloader::vehicleId(void) const
+{
+    return _vehicle->id();
+}
+
+//----------------------------------------------------------------------------------------
+quint64
+VehicleLogDownloader::bytesReceived(void) const
+{
+    return _bytesCompleted + (_downloadData ? _downloadData->written : 0);
+}
+
+//----------------------------------------------------------------------------------------
+double
+VehicleLogDownloader::progress(void) const
+{
+    return _bytesTotal ? static_cast<double>(bytesReceived()) / _bytesTotal : 0;
+}
+
+//----------------------------------------------------------------------------------------
+double
+VehicleLogDownloader::rate(void) const
+{
+    return _downloadData ? _downloadData->rate_avg : 0;
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::queue(const LogInfo_t& log, const QString& directory, int apmOneBased)
+{
+    if (_downloadData && _downloadData->log.id == log.id) {
+        return;
+    }
+    for (const QueuedLog_t& queuedLog: _queue) {
+        if (queuedLog.log.id == log.id) {
+            return;
+        }
+    }
+
+    _apmOneBased = apmOneBased;
+    _queue.append({ log, directory });
+    _bytesTotal += log.size;
+    emit logStatusChanged(log.id, tr("Waiting"));
+
+    if (!_downloadData) {
+        _startNextDownload();
+    }
+    emit progressChanged();
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::cancel(void)
+{
+    _timer.stop();
+    for (const QueuedLog_t& queuedLog: _queue) {
+        emit logStatusChanged(queuedLog.log.id, tr("Canceled"));
+    }
+    _queue.clear();
+    if (_downloadData) {
+        _finishDownload();
+    }
+    _bytesTotal = 0;
+    _bytesCompleted = 0;
+    _setDownloading(false);
+    emit progressChanged();
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_setDownloading(bool downloading)
+{
+    if (_downloading != downloading) {
+        _downloading = downloading;
+        _vehicle->setConnectionLostEnabled(!downloading);
+        if (downloading) {
+            _statusTimer.start();
+        } else {
+            _statusTimer.stop();
+        }
+        emit downloadingChanged(downloading);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_startNextDownload(void)
+{
+    _timer.stop();
+    while (!_queue.isEmpty()) {
+        if (_prepareLogDownload(_queue.takeFirst())) {
+            if (_downloadData->complete()) {
+                //-- Everything was already received by an earlier attempt
+                _finishDownload();
+                continue;
+            }
+            _setDownloading(true);
+            _requestNextWindow();
+            _timer.start(kTimeOutMilliseconds);
+            return;
+        }
+    }
+
+    _bytesTotal = 0;
+    _bytesCompleted = 0;
+    _setDownloading(false);
+    emit progressChanged();
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_finishDownload(void)
+{
+    const uint id = _downloadData->log.id;
+
+    if (_downloadData->complete()) {
+        if (_flushWriteBuffer()) {
+            QFile::remove(_downloadData->resumeFilename());
+            emit logStatusChanged(id, tr("Downloaded"));
+        } else {
+            emit logStatusChanged(id, tr("Error"));
+        }
+    } else {
+        _saveResumeState();
+        emit logStatusChanged(id, tr("Canceled"));
+    }
+
+    _bytesCompleted += _downloadData->log.size;
+    delete _downloadData;
+    _downloadData = nullptr;
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_failDownload(void)
+{
+    const uint id = _downloadData->log.id;
+
+    //-- Only bins which made it to the file are kept for a later attempt
+    _saveResumeState();
+    emit logStatusChanged(id, tr("Error"));
+
+    _bytesCompleted += _downloadData->log.size;
+    delete _downloadData;
+    _downloadData = nullptr;
+
+    _startNextDownload();
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_updateDataRate(void)
+{
+    if (!_downloadData) {
+        return;
+    }
+
+    //-- Update download rate
+    const qint64 elapsed = _downloadData->elapsed.restart();
+    if (elapsed > 0) {
+        qreal rrate = _downloadData->rate_bytes / (elapsed / 1000.0);
+        _downloadData->rate_avg = (_downloadData->rate_avg * 0.8) + (rrate * 0.2);
+        _downloadData->rate_bytes = 0;
+    }
+
+    //-- Update status
+    const QString status = QString("%1 (%2/s)").arg(QGCMapEngine::bigSizeToString(_downloadData->written),
+                                                    QGCMapEngine::bigSizeToString(_downloadData->rate_avg));
+    emit logStatusChanged(_downloadData->log.id, status);
+    emit progressChanged();
+
+    if (_downloadData->resumeSaved.elapsed() >= kResumeSaveMilliseconds) {
+        _saveResumeState();
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_logData(UASInterface* /*uas*/, uint32_t ofs, uint16_t id, uint8_t count, const uint8_t* data)
+{
+    if(!_downloadData) {
+        return;
+    }
+    //-- APM "Fix"
+    id -= _apmOneBased;
+    if(_downloadData->log.id != id) {
+        qWarning() << "Received log data for wrong log";
+        return;
+    }
+
+    if ((ofs % MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) != 0) {
+        qWarning() << "Ignored misaligned incoming packet @" << ofs;
+        return;
+    }
+
+    const uint32_t bin = ofs / MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
+    if (bin >= _downloadData->numBins) {
+        qWarning() << "Received log offset greater than expected";
+        emit logStatusChanged(id, tr("Error"));
+        return;
+    }
+
+    //-- reset retries
+    _retries = 0;
+    //-- Reset timer
+    _timer.start(kTimeOutMilliseconds);
+
+    //-- Packets from an earlier request may still be arriving, anything new is kept wherever it lands in the file
+    if (!_downloadData->bins.testBit(bin)) {
+        if (!_bufferLogData(ofs, data, count)) {
+            //-- Most likely the disk is full, retrying won't help
+            _failDownload();
+            return;
+        }
+        _downloadData->bins.setBit(bin);
+        _downloadData->receivedBins++;
+        _downloadData->written += count;
+        _downloadData->rate_bytes += count;
+    }
+
+    //-- Do we have it all?
+    if (_downloadData->complete()) {
+        _finishDownload();
+        //-- Check for more
+        _startNextDownload();
+    } else if (bin + 1 == _downloadData->requestEnd) {
+        //-- Vehicle has sent the whole request, keep it streaming without waiting for the gaps
+        _requestNextWindow();
+    }
+}
+
+//----------------------------------------------------------------------------------------
+bool
+VehicleLogDownloader::_bufferLogData(uint32_t ofs, const uint8_t* data, uint8_t count)
+{
+    QByteArray& buffer = _downloadData->writeBuffer;
+
+    if (!buffer.isEmpty() && ofs != _downloadData->writeBufferOffset + static_cast<uint32_t>(buffer.size())) {
+        if (!_flushWriteBuffer()) {
+            return false;
+        }
+    }
+    if (buffer.isEmpty()) {
+        _downloadData->writeBufferOffset = ofs;
+    }
+    buffer.append(reinterpret_cast<const char*>(data), count);
+    if (buffer.size() >= kWriteBufferSize) {
+        return _flushWriteBuffer();
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+VehicleLogDownloader::_flushWriteBuffer(void)
+{
+    QByteArray& buffer = _downloadData->writeBuffer;
+
+    if (buffer.isEmpty()) {
+        return true;
+    }
+    bool result = true;
+    if (!_downloadData->file.seek(_downloadData->writeBufferOffset)) {
+        qWarning() << "Error while seeking log file offset" << _downloadData->file.errorString();
+        result = false;
+    } else if (_downloadData->file.write(buffer) != buffer.size()) {
+        qWarning() << "Error while writing log file" << _downloadData->file.errorString();
+        result = false;
+    }
+    if (!result) {
+        //-- The data is gone, so are the bins it held. Otherwise they would never be asked for again.
+        const uint32_t bufferEnd = _downloadData->writeBufferOffset + static_cast<uint32_t>(buffer.size());
+        for (uint32_t binOffset = _downloadData->writeBufferOffset; binOffset < bufferEnd; binOffset += MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) {
+            const uint32_t bin = binOffset / MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
+            if (_downloadData->bins.testBit(bin)) {
+                _downloadData->bins.clearBit(bin);
+                _downloadData->receivedBins--;
+                _downloadData->written -= qMin(bufferEnd - binOffset, static_cast<uint32_t>(MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN));
+            }
+        }
+    }
+    // Capacity is reserved up front so this doesn't free the buffer
+    buffer.resize(0);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_saveResumeState(void)
+{
+    //-- Only bins which have made it to the file can be recorded as received
+    if (!_flushWriteBuffer() || !_downloadData->file.flush()) {
+        return;
+    }
+
+    QSaveFile resumeFile(_downloadData->resumeFilename());
+    if (!resumeFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to save log download state" << resumeFile.fileName() << resumeFile.errorString();
+        return;
+    }
+
+    QDataStream stream(&resumeFile);
+    stream << static_cast<quint32>(kResumeMagic) << static_cast<quint32>(kResumeVersion);
+    stream << static_cast<quint32>(_downloadData->log.id) << static_cast<quint32>(_downloadData->log.size) << _downloadData->log.time;
+    stream << _downloadData->bins;
+    if (!resumeFile.commit()) {
+        qWarning() << "Unable to save log download state" << resumeFile.fileName() << resumeFile.errorString();
+    }
+    _downloadData->resumeSaved.start();
+}
+
+//----------------------------------------------------------------------------------------
+bool
+VehicleLogDownloader::_loadResumeState(void)
+{
+    QFile resumeFile(_downloadData->resumeFilename());
+    if (!resumeFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    quint32     magic;
+    quint32     version;
+    quint32     id;
+    quint32     size;
+    QDateTime   time;
+    QBitArray   bins;
+
+    QDataStream stream(&resumeFile);
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != kResumeMagic || version != kResumeVersion) {
+        return false;
+    }
+    stream >> id >> size >> time >> bins;
+    if (stream.status() != QDataStream::Ok || id != _downloadData->log.id || size != _downloadData->log.size ||
+            time != _downloadData->log.time || bins.size() != _downloadData->bins.size()) {
+        //-- Same file name but a different log
+        return false;
+    }
+
+    _downloadData->bins         = bins;
+    _downloadData->receivedBins = static_cast<uint32_t>(bins.count(true));
+    _downloadData->written      = _downloadData->receivedBins * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
+    if (_downloadData->numBins && bins.testBit(_downloadData->numBins - 1)) {
+        //-- Last bin is short
+        _downloadData->written -= (_downloadData->numBins * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN) - size;
+    }
+    //-- Nothing left to sweep, only the missing runs are requested
+    _downloadData->frontier     = _downloadData->numBins;
+    _downloadData->repairCursor = 0;
+
+    qCDebug(LogDownloadLog) << "Resuming log download" << _downloadData->file.fileName() << "received bins" << _downloadData->receivedBins << "of" << _downloadData->numBins;
+    return true;
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_requestNextWindow(void)
+{
+    LogDownloadData* data = _downloadData;
+    uint32_t start;
+    uint32_t end;
+
+    if (data->frontier < data->numBins) {
+        //-- First pass sweeps the file one window at a time
+        start = data->frontier;
+        end = qMin(start + kWindowBins, data->numBins);
+        data->frontier = end;
+    } else {
+        //-- After that only what was lost is asked for again, one contiguous run at a time
+        start = data->nextMissingBin(data->repairCursor);
+        if (start == data->numBins) {
+            return;
+        }
+        end = start + 1;
+        while (end < data->numBins && end - start < static_cast<uint32_t>(kWindowBins) && !data->bins.testBit(end)) {
+            end++;
+        }
+        data->repairCursor = end;
+    }
+
+    data->requestStart = start;
+    data->requestEnd = end;
+    _requestLogData(start * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN, (end - start) * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_findMissingData(void)
+{
+    if (!_downloadData) {
+        return;
+    }
+    if (_downloadData->complete()) {
+        _finishDownload();
+        _startNextDownload();
+        return;
+    }
+
+    // Retries are infinite. If the link is gone the data rate slowly falls to 0 and the user can Cancel.
+    _retries++;
+
+    //-- Nothing is arriving, a good time to get buffered data onto disk
+    if (_retries == 1) {
+        _saveResumeState();
+    }
+
+    //-- The stream stalled, pick up again from the first bin of the outstanding request which didn't arrive
+    uint32_t start = _downloadData->requestStart;
+    while (start < _downloadData->requestEnd && _downloadData->bins.testBit(start)) {
+        start++;
+    }
+    if (start < _downloadData->requestEnd) {
+        _downloadData->requestStart = start;
+        _requestLogData(start * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN, (_downloadData->requestEnd - start) * MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
+    } else {
+        _requestNextWindow();
+    }
+}
+
+//----------------------------------------------------------------------------------------
+void
+VehicleLogDownloader::_requestLogData(uint32_t offset, uint32_t count)
+{
+    //-- APM "Fix"
+    uint16_t id = static_cast<uint16_t>(_downloadData->log.id + _apmOneBased);
+    qCDebug(LogDownloadLog) << "Request log data (vehicle:" << _vehicle->id() << "id:" << id << "offset:" << offset << "size:" << count << "retryCount" << _retries << ")";
+    mavlink_message_t msg;
+    mavlink_msg_log_request_data_pack_chan(
+                qgcApp()->toolbox()->mavlinkProtocol()->getSystemId(),
+                qgcApp()->toolbox()->mavlinkProtocol()->getComponentId(),
+                _vehicle->priorityLink()->mavlinkChannel(),
+                &msg,
+                _vehicle->id(), _vehicle->defaultComponentId(),
+                id, offset, count);
+    _vehicle->sendMessageOnLink(_vehicle->priorityLink(), msg);
+}
+
+//----------------------------------------------------------------------------------------
+QString
+VehicleLogDownloader::_logFilename(const LogInfo_t& log) const
+{
+    QString ftime;
+    if(log.time.date().year() < 2010) {
+        ftime = tr("UnknownDate");
+    } else {
+        ftime = log.time.toString(QStringLiteral("yyyy-M-d-hh-mm-ss"));
+    }
+    QString filename = QString("log_") + QString::number(log.id) + "_" + ftime;
+    if (_vehicle->firmwareType() == MAV_AUTOPILOT_PX4) {
+        QString loggerParam = QStringLiteral("SYS_LOGGER");
+        if (_vehicle->parameterManager()->parameterExists(FactSystem::defaultComponentId, loggerParam) &&
+                _vehicle->parameterManager()->getParameter(FactSystem::defaultComponentId, loggerParam)->rawValue().toInt() == 0) {
+            filename += ".px4log";
+        } else {
+            filename += ".ulg";
+        }
+    } else {
+        filename += ".bin";
+    }
+    return filename;
+}
+
+//----------------------------------------------------------------------------------------
+bool
+VehicleLogDownloader::_prepareLogDownload(const QueuedLog_t& queuedLog)
+{
+    _retries = 0;
+    _downloadData = new LogDownloadData(queuedLog.log);
+    _downloadData->filename = _logFilename(queuedLog.log);
+
+    QString directory = queuedLog.directory;
+    if (!directory.endsWith(QDir::separator())) {
+        directory += QDir::separator();
+    }
+
+    //-- Pick up a partial download of the same log, otherwise append a number to the end if the filename already exists
+    bool resume = false;
+    uint num_dups = 0;
+    QStringList filename_spl = _downloadData->filename.split('.');
+    _downloadData->file.setFileName(directory + _downloadData->filename);
+    while (_downloadData->file.exists()) {
+        if (_loadResumeState()) {
+            resume = true;
+            break;
+        }
+        num_dups += 1;
+        _downloadData->file.setFileName(directory + filename_spl[0] + '_' + QString::number(num_dups) + '.' + filename_spl[1]);
+    }
+
+    bool result = false;
+    //-- Create file
+    if (!_downloadData->file.open(resume ? QIODevice::ReadWrite : QIODevice::WriteOnly)) {
+        qWarning() << "Failed to create log file:" <<  _downloadData->file.fileName();
+    } else {
+        //-- Preallocate file
+        if(!_downloadData->file.resize(queuedLog.log.size)) {
+            qWarning() << "Failed to allocate space for log file:" <<  _downloadData->file.fileName();
+        } else {
+            _downloadData->writeBuffer.reserve(kWriteBufferSize);
+            _downloadData->elapsed.start();
+            _downloadData->resumeSaved.start();
+            result = true;
+        }
+    }
+    if(!result) {
+        //-- Never throw away a partial download
+        if (!resume && _downloadData->file.exists()) {
+            _downloadData->file.remove();
+        }
+        emit logStatusChanged(queuedLog.log.id, tr("Error"));
+        delete _downloadData;
+        _downloadData = nullptr;
+    }
+    return result;
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QDateTime>
+#include <QList>
+
+class Vehicle;
+class UASInterface;
+struct LogDownloadData;
+
+/// Downloads a queue of logs from a single vehicle. A vehicle serves one LOG_REQUEST_DATA stream at a time so logs
+/// from the same vehicle are fetched one after another, while each vehicle has its own downloader running in parallel.
+///
+/// The bins received so far are saved next to the partial log file. If a download is canceled, stalls or the vehicle
+/// goes away the partial file is kept, and the next attempt at the same log only requests what is still missing.
+class VehicleLogDownloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    VehicleLogDownloader(Vehicle* vehicle, QObject* parent = nullptr);
+    ~VehicleLogDownloader();
+
+    Q_PROPERTY(int      vehicleId       READ vehicleId                                  CONSTANT)
+    Q_PROPERTY(bool     downloading     READ downloading                                NOTIFY downloadingChanged)
+    Q_PROPERTY(int      logsRemaining   READ logsRemaining                              NOTIFY progressChanged)
+    Q_PROPERTY(quint64  bytesReceived   READ bytesReceived                              NOTIFY progressChanged)
+    Q_PROPERTY(quint64  bytesTotal      READ bytesTotal                                 NOTIFY progressChanged)
+    Q_PROPERTY(double   progress        READ progress                                   NOTIFY progressChanged)
+    Q_PROPERTY(double   rate            READ rate                                       NOTIFY progressChanged)     ///< Bytes per second
+
+    typedef struct {
+        uint        id;         ///< Zero based log id
+        uint        size;
+        QDateTime   time;
+    } LogInfo_t;
+
+    Vehicle*    vehicle         (void) { return _vehicle; }
+    int         vehicleId       (void) const;
+    bool        downloading     (void) const { return _downloading; }
+    int         logsRemaining   (void) const { return _queue.count() + (_downloadData ? 1 : 0); }
+    quint64     bytesReceived   (void) const;
+    quint64     bytesTotal      (void) const { return _bytesTotal; }
+    double      progress        (void) const;
+    double      rate            (void) const;
+
+    /// Adds a log to the download queue, starting the download if nothing else is in progress
+    ///     @param apmOneBased 1 if the vehicle numbers logs from 1
+    void queue(const LogInfo_t& log, const QString& directory, int apmOneBased);
+
+    /// Stops the current download and drops the queue. Partial data is kept for a later attempt.
+    void cancel(void);
+
+    /// Extension of the file which holds the received bins of a partial download
+    static const char* resumeFileExtension;
+
+signals:
+    void downloadingChanged (bool downloading);
+    void progressChanged    (void);
+    void logStatusChanged   (uint id, const QString& status);
+
+private slots:
+    void _logData           (UASInterface* uas, uint32_t ofs, uint16_t id, uint8_t count, const uint8_t* data);
+    void _findMissingData   (void);
+    void _updateDataRate    (void);
+
+private:
+    typedef struct {
+        LogInfo_t   log;
+        QString     directory;
+    } QueuedLog_t;
+
+    void _setDownloading    (bool downloading);
+    void _startNextDownload (void);
+    bool _prepareLogDownload(const QueuedLog_t& queuedLog);
+    void _finishDownload    (void);
+    void _failDownload      (void);
+    void _requestNextWindow (void);
+    void _requestLogData    (uint32_t offset, uint32_t count);
+    bool _bufferLogData     (uint32_t ofs, const uint8_t* data, uint8_t count);
+    bool _flushWriteBuffer  (void);
+    bool _loadResumeState   (void);
+    void _saveResumeState   (void);
+    QString _logFilename    (const LogInfo_t& log) const;
+
+    Vehicle*            _vehicle;
+    LogDownloadData*    _downloadData;
+    QList<QueuedLog_t>  _queue;
+    QTimer              _timer;
+    QTimer              _statusTimer;
+    int                 _retries;
+    int                 _apmOneBased;
+    quint64             _bytesTotal;        ///< Size of every log queued since the downloader was last idle
+    quint64             _bytesCompleted;    ///< Size of every finished log since the downloader was last idle
+    bool                _downloading;
+};
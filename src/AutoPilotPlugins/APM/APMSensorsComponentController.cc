@@ -77,7 +77,15 @@ APMSensorsComponentController::APMSensorsComponentController(void)
         qWarning() << "Sensors component is missing";
     }
 
-    connect(qgcApp()->toolbox()->mavlinkProtocol(), &MAVLinkProtocol::messageReceived, this, &APMSensorsComponentController::_mavlinkMessageReceived);
+    QList<MAVLinkMessageFilter> messageFilters;
+    messageFilters << MAVLinkMessageFilter(_vehicle->id(), MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_COMMAND_ACK)
+                   << MAVLinkMessageFilter(_vehicle->id(), MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_MAG_CAL_PROGRESS)
+                   << MAVLinkMessageFilter(_vehicle->id(), MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_MAG_CAL_REPORT);
+    qgcApp()->toolbox()->mavlinkProtocol()->messageRouter()->subscribe(this, messageFilters, [this](LinkInterface* link, const MAVLinkMessageBatch& messages) {
+        for (const mavlink_message_t* message: messages) {
+            _mavlinkMessageReceived(link, *message);
+        }
+    });
 }
 
 APMSensorsComponentController::~APMSensorsComponentController()
@@ -845,10 +853,6 @@ void APMSensorsComponentController::_mavlinkMessageReceived(LinkInterface* link,
 {
     Q_UNUSED(link);
 
-    if (message.sysid != _vehicle->id()) {
-        return;
-    }
-
     switch (message.msgid) {
     case MAVLINK_MSG_ID_COMMAND_ACK:
         _handleCommandAck(message);
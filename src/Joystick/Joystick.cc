@@ -16,6 +16,8 @@
 #include "VideoManager.h"
 #include "QGCCameraManager.h"
 #include "QGCCameraControl.h"
+#include "MAVLinkProtocol.h"
+#include "LinkManager.h"
 
 #include <QSettings>
 
@@ -461,21 +463,52 @@ void Joystick::run()
     //-- Joystick thread
     _open();
     //-- Reset timers
-    _axisTime.start();
+    _loopClock.start();
     for (int buttonIndex = 0; buttonIndex < _totalButtonCount; buttonIndex++) {
         if(_buttonActionArray[buttonIndex]) {
             _buttonActionArray[buttonIndex]->buttonTime.start();
         }
     }
+    resetTimingStats();
+    qint64 nextAxisNsecs = 0;
+    qint64 nextPollNsecs = 0;
     while (!_exitThread) {
+        //-- Axis messages go out at the axis frequency, buttons are polled at least every 20 msecs regardless
+        qint64 axisPeriodNsecs = static_cast<qint64>(1e9 / _axisFrequency);
+        qint64 pollPeriodNsecs = axisPeriodNsecs < _maxPollPeriodNsecs ? axisPeriodNsecs : _maxPollPeriodNsecs;
+        qint64 sampledNsecs    = _loopClock.nsecsElapsed();
         _update();
         _handleButtons();
-        _handleAxis();
-        QGC::SLEEP::msleep(20);
+        if (sampledNsecs >= nextAxisNsecs) {
+            _handleAxis(sampledNsecs);
+            //-- Step from the previous deadline so the rate doesn't drift, unless we fell a whole period behind
+            nextAxisNsecs += axisPeriodNsecs;
+            if (nextAxisNsecs <= sampledNsecs) {
+                nextAxisNsecs = sampledNsecs + axisPeriodNsecs;
+            }
+        }
+        nextPollNsecs += pollPeriodNsecs;
+        if (nextPollNsecs <= sampledNsecs) {
+            nextPollNsecs = sampledNsecs + pollPeriodNsecs;
+        }
+        _updateTimingStats();
+        _sleepUntil(qMin(nextAxisNsecs, nextPollNsecs));
     }
     _close();
 }
 
+void Joystick::_sleepUntil(qint64 deadlineNsecs)
+{
+    //-- Sleeps overshoot by up to a scheduler tick. Wake up a little early and yield through the rest.
+    qint64 remainingUsecs = (deadlineNsecs - _loopClock.nsecsElapsed()) / 1000;
+    if (remainingUsecs > _spinUsecs) {
+        QGC::SLEEP::usleep(static_cast<unsigned long>(remainingUsecs - _spinUsecs));
+    }
+    while (!_exitThread && _loopClock.nsecsElapsed() < deadlineNsecs) {
+        QThread::yieldCurrentThread();
+    }
+}
+
 void Joystick::_handleButtons()
 {
     int lastBbuttonValues[256];
@@ -572,103 +605,229 @@ void Joystick::_handleButtons()
     }
 }
 
-void Joystick::_handleAxis()
+void Joystick::_handleAxis(qint64 sampledNsecs)
 {
-    //-- Get frequency
-    int axisDelay = static_cast<int>(1000.0f / _axisFrequency);
-    //-- Check elapsed time since last run
-    if(_axisTime.elapsed() > axisDelay) {
-        _axisTime.start();
-        //-- Update axis
-        for (int axisIndex = 0; axisIndex < _axisCount; axisIndex++) {
-            int newAxisValue = _getAxis(axisIndex);
-            // Calibration code requires signal to be emitted even if value hasn't changed
-            _rgAxisValues[axisIndex] = newAxisValue;
-            emit rawAxisValueChanged(axisIndex, newAxisValue);
-        }
-        if (_activeVehicle->joystickEnabled() && !_calibrationMode && _calibrated) {
-            int     axis = _rgFunctionAxis[rollFunction];
-            float   roll = _adjustRange(_rgAxisValues[axis],    _rgCalibration[axis], _deadband);
+    //-- Update axis
+    for (int axisIndex = 0; axisIndex < _axisCount; axisIndex++) {
+        int newAxisValue = _getAxis(axisIndex);
+        // Calibration code requires signal to be emitted even if value hasn't changed
+        _rgAxisValues[axisIndex] = newAxisValue;
+        emit rawAxisValueChanged(axisIndex, newAxisValue);
+    }
+    if (_activeVehicle->joystickEnabled() && !_calibrationMode && _calibrated) {
+        int     axis = _rgFunctionAxis[rollFunction];
+        float   roll = _adjustRange(_rgAxisValues[axis],    _rgCalibration[axis], _deadband);
 
-                    axis = _rgFunctionAxis[pitchFunction];
-            float   pitch = _adjustRange(_rgAxisValues[axis],   _rgCalibration[axis], _deadband);
+                axis = _rgFunctionAxis[pitchFunction];
+        float   pitch = _adjustRange(_rgAxisValues[axis],   _rgCalibration[axis], _deadband);
 
-                    axis = _rgFunctionAxis[yawFunction];
-            float   yaw = _adjustRange(_rgAxisValues[axis],     _rgCalibration[axis],_deadband);
+                axis = _rgFunctionAxis[yawFunction];
+        float   yaw = _adjustRange(_rgAxisValues[axis],     _rgCalibration[axis],_deadband);
 
-                    axis = _rgFunctionAxis[throttleFunction];
-            float   throttle = _adjustRange(_rgAxisValues[axis],_rgCalibration[axis], _throttleMode==ThrottleModeDownZero?false:_deadband);
+                axis = _rgFunctionAxis[throttleFunction];
+        float   throttle = _adjustRange(_rgAxisValues[axis],_rgCalibration[axis], _throttleMode==ThrottleModeDownZero?false:_deadband);
 
-            float   gimbalPitch = 0.0f;
-            float   gimbalYaw   = 0.0f;
+        float   gimbalPitch = 0.0f;
+        float   gimbalYaw   = 0.0f;
 
-            if(_axisCount > 4) {
-                axis = _rgFunctionAxis[gimbalPitchFunction];
-                gimbalPitch = _adjustRange(_rgAxisValues[axis], _rgCalibration[axis],_deadband);
-            }
+        if(_axisCount > 4) {
+            axis = _rgFunctionAxis[gimbalPitchFunction];
+            gimbalPitch = _adjustRange(_rgAxisValues[axis], _rgCalibration[axis],_deadband);
+        }
 
-            if(_axisCount > 5) {
-                axis = _rgFunctionAxis[gimbalYawFunction];
-                gimbalYaw = _adjustRange(_rgAxisValues[axis],   _rgCalibration[axis],_deadband);
-            }
+        if(_axisCount > 5) {
+            axis = _rgFunctionAxis[gimbalYawFunction];
+            gimbalYaw = _adjustRange(_rgAxisValues[axis],   _rgCalibration[axis],_deadband);
+        }
 
-            if (_accumulator) {
-                static float throttle_accu = 0.f;
-                throttle_accu += throttle * (40 / 1000.f); //for throttle to change from min to max it will take 1000ms (40ms is a loop time)
-                throttle_accu = std::max(static_cast<float>(-1.f), std::min(throttle_accu, static_cast<float>(1.f)));
-                throttle = throttle_accu;
-            }
+        if (_accumulator) {
+            static float throttle_accu = 0.f;
+            throttle_accu += throttle / _axisFrequency; //for throttle to change from min to max it will take 1000ms
+            throttle_accu = std::max(static_cast<float>(-1.f), std::min(throttle_accu, static_cast<float>(1.f)));
+            throttle = throttle_accu;
+        }
 
-            if (_circleCorrection) {
-                float roll_limited      = std::max(static_cast<float>(-M_PI_4), std::min(roll,      static_cast<float>(M_PI_4)));
-                float pitch_limited     = std::max(static_cast<float>(-M_PI_4), std::min(pitch,     static_cast<float>(M_PI_4)));
-                float yaw_limited       = std::max(static_cast<float>(-M_PI_4), std::min(yaw,       static_cast<float>(M_PI_4)));
-                float throttle_limited  = std::max(static_cast<float>(-M_PI_4), std::min(throttle,  static_cast<float>(M_PI_4)));
-
-                // Map from unit circle to linear range and limit
-                roll =      std::max(-1.0f, std::min(tanf(asinf(roll_limited)),     1.0f));
-                pitch =     std::max(-1.0f, std::min(tanf(asinf(pitch_limited)),    1.0f));
-                yaw =       std::max(-1.0f, std::min(tanf(asinf(yaw_limited)),      1.0f));
-                throttle =  std::max(-1.0f, std::min(tanf(asinf(throttle_limited)), 1.0f));
-            }
+        if (_circleCorrection) {
+            float roll_limited      = std::max(static_cast<float>(-M_PI_4), std::min(roll,      static_cast<float>(M_PI_4)));
+            float pitch_limited     = std::max(static_cast<float>(-M_PI_4), std::min(pitch,     static_cast<float>(M_PI_4)));
+            float yaw_limited       = std::max(static_cast<float>(-M_PI_4), std::min(yaw,       static_cast<float>(M_PI_4)));
+            float throttle_limited  = std::max(static_cast<float>(-M_PI_4), std::min(throttle,  static_cast<float>(M_PI_4)));
+
+            // Map from unit circle to linear range and limit
+            roll =      std::max(-1.0f, std::min(tanf(asinf(roll_limited)),     1.0f));
+            pitch =     std::max(-1.0f, std::min(tanf(asinf(pitch_limited)),    1.0f));
+            yaw =       std::max(-1.0f, std::min(tanf(asinf(yaw_limited)),      1.0f));
+            throttle =  std::max(-1.0f, std::min(tanf(asinf(throttle_limited)), 1.0f));
+        }
 
-            if ( _exponential < -0.01f) {
-                // Exponential (0% to -50% range like most RC radios)
-                // _exponential is set by a slider in joystickConfigAdvanced.qml
-                // Calculate new RPY with exponential applied
-                roll =      -_exponential*powf(roll, 3) + (1+_exponential)*roll;
-                pitch =     -_exponential*powf(pitch,3) + (1+_exponential)*pitch;
-                yaw =       -_exponential*powf(yaw,  3) + (1+_exponential)*yaw;
-            }
+        if ( _exponential < -0.01f) {
+            // Exponential (0% to -50% range like most RC radios)
+            // _exponential is set by a slider in joystickConfigAdvanced.qml
+            // Calculate new RPY with exponential applied
+            roll =      -_exponential*powf(roll, 3) + (1+_exponential)*roll;
+            pitch =     -_exponential*powf(pitch,3) + (1+_exponential)*pitch;
+            yaw =       -_exponential*powf(yaw,  3) + (1+_exponential)*yaw;
+        }
 
-            // Adjust throttle to 0:1 range
-            if (_throttleMode == ThrottleModeCenterZero && _activeVehicle->supportsThrottleModeCenterZero()) {
-                if (!_activeVehicle->supportsNegativeThrust() || !_negativeThrust) {
-                    throttle = std::max(0.0f, throttle);
-                }
-            } else {
-                throttle = (throttle + 1.0f) / 2.0f;
-            }
-            qCDebug(JoystickValuesLog) << "name:roll:pitch:yaw:throttle:gimbalPitch:gimbalYaw" << name() << roll << -pitch << yaw << throttle << gimbalPitch << gimbalYaw;
-            // NOTE: The buttonPressedBits going to MANUAL_CONTROL are currently used by ArduSub (and it only handles 16 bits)
-            // Set up button bitmap
-            quint64 buttonPressedBits = 0;  // Buttons pressed for manualControl signal
-            for (int buttonIndex = 0; buttonIndex < _totalButtonCount; buttonIndex++) {
-                quint64 buttonBit = static_cast<quint64>(1LL << buttonIndex);
-                if (_rgButtonValues[buttonIndex] != BUTTON_UP) {
-                    // Mark the button as pressed as long as its pressed
-                    buttonPressedBits |= buttonBit;
-                }
+        // Adjust throttle to 0:1 range
+        if (_throttleMode == ThrottleModeCenterZero && _activeVehicle->supportsThrottleModeCenterZero()) {
+            if (!_activeVehicle->supportsNegativeThrust() || !_negativeThrust) {
+                throttle = std::max(0.0f, throttle);
             }
-            uint16_t shortButtons = static_cast<uint16_t>(buttonPressedBits & 0xFFFF);
-            emit manualControl(roll, -pitch, yaw, throttle, shortButtons, _activeVehicle->joystickMode());
-            if(_activeVehicle && _axisCount > 4 && _gimbalEnabled) {
-                //-- TODO: There is nothing consuming this as there are no messages to handle gimbal
-                //   the way MANUAL_CONTROL handles the other channels.
-                emit manualControlGimbal((gimbalPitch + 1.0f) / 2.0f * 90.0f, gimbalYaw * 180.0f);
+        } else {
+            throttle = (throttle + 1.0f) / 2.0f;
+        }
+        qCDebug(JoystickValuesLog) << "name:roll:pitch:yaw:throttle:gimbalPitch:gimbalYaw" << name() << roll << -pitch << yaw << throttle << gimbalPitch << gimbalYaw;
+        // NOTE: The buttonPressedBits going to MANUAL_CONTROL are currently used by ArduSub (and it only handles 16 bits)
+        // Set up button bitmap
+        quint64 buttonPressedBits = 0;  // Buttons pressed for manualControl signal
+        for (int buttonIndex = 0; buttonIndex < _totalButtonCount; buttonIndex++) {
+            quint64 buttonBit = static_cast<quint64>(1LL << buttonIndex);
+            if (_rgButtonValues[buttonIndex] != BUTTON_UP) {
+                // Mark the button as pressed as long as its pressed
+                buttonPressedBits |= buttonBit;
             }
         }
+        uint16_t shortButtons = static_cast<uint16_t>(buttonPressedBits & 0xFFFF);
+        int joystickMode = _activeVehicle->joystickMode();
+        //-- MANUAL_CONTROL is queued from here, other modes are packed by UAS on the main thread
+        if (joystickMode != Vehicle::JoystickModeRC || !_sendManualControl(roll, -pitch, yaw, throttle, shortButtons)) {
+            emit manualControl(roll, -pitch, yaw, throttle, shortButtons, joystickMode);
+        }
+        _recordSend(sampledNsecs);
+        if(_activeVehicle && _axisCount > 4 && _gimbalEnabled) {
+            //-- TODO: There is nothing consuming this as there are no messages to handle gimbal
+            //   the way MANUAL_CONTROL handles the other channels.
+            emit manualControlGimbal((gimbalPitch + 1.0f) / 2.0f * 90.0f, gimbalYaw * 180.0f);
+        }
+    } else {
+        //-- Don't count the gap until sending resumes as jitter
+        QMutexLocker locker(&_timingMutex);
+        _lastSendNsecs = -1;
+    }
+}
+
+bool Joystick::_sendManualControl(float roll, float pitch, float yaw, float throttle, quint16 buttons)
+{
+    QMutexLocker locker(&_manualControlMutex);
+
+    LinkInterface* link = _manualControlLink.data();
+    if (!link || !link->isConnected()) {
+        return false;
+    }
+
+    //-- Same scaling as UAS::setExternalControlSetpoint. Pitch is negated since it is negative for pitching forward.
+    mavlink_manual_control_t manualControl;
+    memset(&manualControl, 0, sizeof(manualControl));
+    manualControl.target    = _manualControlTarget;
+    manualControl.x         = static_cast<int16_t>(-pitch * 1000.0f);
+    manualControl.y         = static_cast<int16_t>(roll * 1000.0f);
+    manualControl.z         = static_cast<int16_t>(throttle * 1000.0f);
+    manualControl.r         = static_cast<int16_t>(yaw * 1000.0f);
+    manualControl.buttons   = buttons;
+
+    //-- The link channel status is owned by the main thread, so the header is left to the send queue which numbers
+    //   and finalizes every message on the link as it is written.
+    mavlink_message_t message;
+    memset(&message, 0, sizeof(message));
+    memcpy(_MAV_PAYLOAD_NON_CONST(&message), &manualControl, MAVLINK_MSG_ID_MANUAL_CONTROL_LEN);
+    message.msgid   = MAVLINK_MSG_ID_MANUAL_CONTROL;
+    message.len     = MAVLINK_MSG_ID_MANUAL_CONTROL_LEN;
+    message.sysid   = _manualControlSystemId;
+    message.compid  = _manualControlComponentId;
+
+    return link->sendQueue()->enqueue(message, LinkSendQueue::PriorityControl);
+}
+
+void Joystick::_updateManualControlLink(void)
+{
+    _setManualControlLink(_activeVehicle);
+}
+
+void Joystick::_setManualControlLink(Vehicle* vehicle)
+{
+    //-- Released outside the lock since it may be the last reference to the link
+    SharedLinkInterfacePointer oldLink;
+
+    QMutexLocker locker(&_manualControlMutex);
+    oldLink = _manualControlLink;
+    _manualControlLink.clear();
+    if (vehicle && vehicle->priorityLink()) {
+        MAVLinkProtocol* mavlinkProtocol = qgcApp()->toolbox()->mavlinkProtocol();
+        _manualControlLink          = qgcApp()->toolbox()->linkManager()->sharedLinkInterfacePointerForLink(vehicle->priorityLink());
+        _manualControlSystemId      = static_cast<uint8_t>(mavlinkProtocol->getSystemId());
+        _manualControlComponentId   = static_cast<uint8_t>(mavlinkProtocol->getComponentId());
+        _manualControlTarget        = static_cast<uint8_t>(vehicle->id());
+    }
+    locker.unlock();
+}
+
+void Joystick::_recordSend(qint64 sampledNsecs)
+{
+    qint64 now = _loopClock.nsecsElapsed();
+
+    QMutexLocker locker(&_timingMutex);
+    _latencyHistogram.add((now - sampledNsecs) / 1000);
+    if (_lastSendNsecs >= 0) {
+        qint64 targetNsecs = static_cast<qint64>(1e9 / _axisFrequency);
+        _jitterHistogram.add(qAbs(now - _lastSendNsecs - targetNsecs) / 1000);
+    }
+    _lastSendNsecs = now;
+    _timingPeriodSends++;
+}
+
+void Joystick::_updateTimingStats()
+{
+    qint64 now = _loopClock.nsecsElapsed();
+    {
+        QMutexLocker locker(&_timingMutex);
+        if (_timingPeriodStartNsecs < 0) {
+            _timingPeriodStartNsecs = now;
+            _timingPeriodSends      = 0;
+            return;
+        }
+        if (now - _timingPeriodStartNsecs < 1000000000) {
+            return;
+        }
+        _sendRate               = _timingPeriodSends * 1e9 / (now - _timingPeriodStartNsecs);
+        _timingPeriodStartNsecs = now;
+        _timingPeriodSends      = 0;
+        qCDebug(JoystickLog) << "Send rate" << _sendRate
+                             << "latency p50/p99/max usecs" << _latencyHistogram.percentile(0.5) << _latencyHistogram.percentile(0.99) << _latencyHistogram.max()
+                             << "jitter p50/p99/max usecs" << _jitterHistogram.percentile(0.5) << _jitterHistogram.percentile(0.99) << _jitterHistogram.max();
     }
+    emit timingStatsChanged();
+}
+
+void Joystick::resetTimingStats()
+{
+    {
+        QMutexLocker locker(&_timingMutex);
+        _latencyHistogram.reset();
+        _jitterHistogram.reset();
+        _lastSendNsecs          = -1;
+        _timingPeriodStartNsecs = -1;
+        _sendRate               = 0;
+    }
+    emit timingStatsChanged();
+}
+
+double Joystick::sendRate()
+{
+    QMutexLocker locker(&_timingMutex);
+    return _sendRate;
+}
+
+QVariantList Joystick::latencyHistogram()
+{
+    QMutexLocker locker(&_timingMutex);
+    return _latencyHistogram.counts();
+}
+
+QVariantList Joystick::jitterHistogram()
+{
+    QMutexLocker locker(&_timingMutex);
+    return _jitterHistogram.counts();
 }
 
 void Joystick::startPolling(Vehicle* vehicle)
@@ -677,6 +836,7 @@ void Joystick::startPolling(Vehicle* vehicle)
         // If a vehicle is connected, disconnect it
         if (_activeVehicle) {
             UAS* uas = _activeVehicle->uas();
+            disconnect(_activeVehicle, &Vehicle::priorityLinkNameChanged, this, &Joystick::_updateManualControlLink);
             disconnect(this, &Joystick::manualControl, uas, &UAS::setExternalControlSetpoint);
             disconnect(this, &Joystick::setArmed,           _activeVehicle, &Vehicle::setArmed);
             disconnect(this, &Joystick::setVtolInFwdFlight, _activeVehicle, &Vehicle::setVtolInFwdFlight);
@@ -689,6 +849,8 @@ void Joystick::startPolling(Vehicle* vehicle)
         }
         // Always set up the new vehicle
         _activeVehicle = vehicle;
+        connect(_activeVehicle, &Vehicle::priorityLinkNameChanged, this, &Joystick::_updateManualControlLink);
+        _updateManualControlLink();
         // If joystick is not calibrated, disable it
         if ( !_calibrated ) {
             vehicle->setJoystickEnabled(false);
@@ -716,7 +878,8 @@ void Joystick::startPolling(Vehicle* vehicle)
     }
     if (!isRunning()) {
         _exitThread = false;
-        start();
+        //-- Control timing suffers if the polling thread waits behind everything else for a core
+        start(QThread::TimeCriticalPriority);
     }
 }
 
@@ -740,6 +903,11 @@ void Joystick::stopPolling(void)
         //disconnect(this, &Joystick::buttonActionTriggered,  uas, &UAS::triggerAction);
         _exitThread = true;
     }
+    if (_activeVehicle) {
+        disconnect(_activeVehicle, &Vehicle::priorityLinkNameChanged, this, &Joystick::_updateManualControlLink);
+    }
+    //-- Stop direct sends right away, the polling thread may run on for one more pass
+    _setManualControlLink(nullptr);
 }
 
 void Joystick::setCalibration(int axis, Calibration_t& calibration)
@@ -951,7 +1119,7 @@ void Joystick::setAxisFrequency(float val)
 {
     //-- Arbitrary limits
     if(val < 0.25f) val = 0.25f;
-    if(val > 50.0f) val = 50.0f;
+    if(val > maxAxisFrequency) val = maxAxisFrequency;
     _axisFrequency = val;
     _saveSettings();
     emit axisFrequencyChanged();
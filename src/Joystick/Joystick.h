@@ -14,10 +14,14 @@
 
 #include <QObject>
 #include <QThread>
+#include <QMutex>
+#include <QElapsedTimer>
 
 #include "QGCLoggingCategory.h"
 #include "Vehicle.h"
 #include "MultiVehicleManager.h"
+#include "LinkInterface.h"
+#include "TimingHistogram.h"
 
 Q_DECLARE_LOGGING_CATEGORY(JoystickLog)
 Q_DECLARE_LOGGING_CATEGORY(JoystickValuesLog)
@@ -50,6 +54,9 @@ private:
 class Joystick : public QThread
 {
     Q_OBJECT
+
+    friend class JoystickTest;
+
 public:
     Joystick(const QString& name, int axisCount, int buttonCount, int hatCount, MultiVehicleManager* multiVehicleManager);
 
@@ -108,10 +115,17 @@ public:
     Q_PROPERTY(bool     accumulator             READ accumulator            WRITE setAccumulator        NOTIFY accumulatorChanged)
     Q_PROPERTY(bool     circleCorrection        READ circleCorrection       WRITE setCircleCorrection   NOTIFY circleCorrectionChanged)
 
+    //-- Manual control timing, updated once a second while polling
+    Q_PROPERTY(double       sendRate                READ sendRate               NOTIFY timingStatsChanged)  ///< Measured axis messages per second
+    Q_PROPERTY(QVariantList latencyHistogram        READ latencyHistogram       NOTIFY timingStatsChanged)  ///< Axis sampled to message queued
+    Q_PROPERTY(QVariantList jitterHistogram         READ jitterHistogram        NOTIFY timingStatsChanged)  ///< Deviation of send interval from the target
+    Q_PROPERTY(QVariantList histogramBucketLimits   READ histogramBucketLimits  CONSTANT)                   ///< usecs
+
     Q_INVOKABLE void    setButtonRepeat     (int button, bool repeat);
     Q_INVOKABLE bool    getButtonRepeat     (int button);
     Q_INVOKABLE void    setButtonAction     (int button, const QString& action);
     Q_INVOKABLE QString getButtonAction     (int button);
+    Q_INVOKABLE void    resetTimingStats    ();
 
     // Property accessors
 
@@ -180,6 +194,13 @@ public:
     /// Set joystick button repeat rate (in Hz)
     void  setButtonFrequency(float val);
 
+    double          sendRate                ();
+    QVariantList    latencyHistogram        ();
+    QVariantList    jitterHistogram         ();
+    QVariantList    histogramBucketLimits   () { return TimingHistogram::bucketLimits(); }
+
+    static constexpr float maxAxisFrequency = 250.0f;
+
 signals:
     // The raw signals are only meant for use by calibration
     void rawAxisValueChanged        (int index, int value);
@@ -209,6 +230,7 @@ signals:
     void gimbalEnabledChanged       ();
     void axisFrequencyChanged       ();
     void buttonFrequencyChanged     ();
+    void timingStatsChanged         ();
     void startContinuousZoom        (int direction);
     void stopContinuousZoom         ();
     void stepZoom                   (int direction);
@@ -237,7 +259,7 @@ protected:
     int     _findAssignableButtonAction(const QString& action);
     bool    _validAxis              (int axis);
     bool    _validButton            (int button);
-    void    _handleAxis             ();
+    void    _handleAxis             (qint64 sampledNsecs);
     void    _handleButtons          ();
     void    _buildActionList        (Vehicle* activeVehicle);
 
@@ -259,6 +281,12 @@ private:
     int _mapFunctionMode(int mode, int function);
     void _remapAxes(int currentMode, int newMode, int (&newMapping)[maxFunction]);
 
+    bool _sendManualControl         (float roll, float pitch, float yaw, float throttle, quint16 buttons);
+    void _setManualControlLink      (Vehicle* vehicle);
+    void _recordSend                (qint64 sampledNsecs);
+    void _updateTimingStats         ();
+    void _sleepUntil                (qint64 deadlineNsecs);
+
     // Override from QThread
     virtual void run();
 
@@ -299,7 +327,23 @@ protected:
 
     static int          _transmitterMode;
     int                 _rgFunctionAxis[maxFunction] = {};
-    QTime               _axisTime;
+    QElapsedTimer       _loopClock;                 ///< Time base of the polling thread
+
+    // MANUAL_CONTROL goes straight to the priority link's send queue from the polling thread. The link is set from
+    // the main thread and held for as long as it is in use so it can't go away underneath a send.
+    QMutex                      _manualControlMutex;
+    SharedLinkInterfacePointer  _manualControlLink;
+    uint8_t                     _manualControlSystemId      = 0;
+    uint8_t                     _manualControlComponentId   = 0;
+    uint8_t                     _manualControlTarget        = 0;
+
+    QMutex              _timingMutex;
+    TimingHistogram     _latencyHistogram;
+    TimingHistogram     _jitterHistogram;
+    qint64              _lastSendNsecs          = -1;
+    qint64              _timingPeriodStartNsecs = -1;
+    quint64             _timingPeriodSends      = 0;
+    double              _sendRate               = 0;
 
     QmlObjectListModel              _assignableButtonActions;
     QList<AssignedButtonAction*>    _buttonActionArray;
@@ -310,6 +354,9 @@ protected:
 private:
     static const char*  _rgFunctionSettingsKey[maxFunction];
 
+    static const qint64 _maxPollPeriodNsecs = 20000000;     ///< Buttons are polled at least this often
+    static const qint64 _spinUsecs          = 250;          ///< Final stretch before a deadline which is not slept through
+
     static const char* _settingsGroup;
     static const char* _calibratedSettingsKey;
     static const char* _buttonActionNameKey;
@@ -356,4 +403,5 @@ private:
 
 private slots:
     void _activeVehicleChanged(Vehicle* activeVehicle);
+    void _updateManualControlLink(void);
 };
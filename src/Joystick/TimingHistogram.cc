@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TimingHistogram.h"
+
+#include <QtMath>
+
+const qint64 TimingHistogram::_bucketLimits[TimingHistogram::bucketCount - 1] = {
+    100, 250, 500, 1000, 2000, 3000, 4000, 6000, 10000, 20000, 50000
+};
+
+TimingHistogram::TimingHistogram(void)
+{
+    reset();
+}
+
+void TimingHistogram::add(qint64 usecs)
+{
+    int bucket = 0;
+    while (bucket < bucketCount - 1 && usecs > _bucketLimits[bucket]) {
+        bucket++;
+    }
+    _counts[bucket]++;
+    _count++;
+    _max = qMax(_max, usecs);
+}
+
+void TimingHistogram::reset(void)
+{
+    for (quint64& count: _counts) {
+        count = 0;
+    }
+    _count  = 0;
+    _max    = 0;
+}
+
+qint64 TimingHistogram::percentile(double fraction) const
+{
+    if (_count == 0) {
+        return 0;
+    }
+
+    quint64 target  = static_cast<quint64>(qCeil(fraction * _count));
+    quint64 seen    = 0;
+    for (int bucket = 0; bucket < bucketCount - 1; bucket++) {
+        seen += _counts[bucket];
+        if (seen >= target) {
+            return qMin(_bucketLimits[bucket], _max);
+        }
+    }
+
+    return _max;
+}
+
+QVariantList TimingHistogram::counts(void) const
+{
+    QVariantList counts;
+    for (quint64 count: _counts) {
+        counts.append(count);
+    }
+    return counts;
+}
+
+QVariantList TimingHistogram::bucketLimits(void)
+{
+    QVariantList limits;
+    for (qint64 limit: _bucketLimits) {
+        limits.append(limit);
+    }
+    return limits;
+}
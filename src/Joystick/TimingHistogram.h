@@ -0,0 +1,44 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QVariantList>
+
+/// Fixed bucket histogram of durations in microseconds. Buckets are finer around the 1-10 msec range which control
+/// loops run at. Not thread safe.
+class TimingHistogram
+{
+public:
+    TimingHistogram(void);
+
+    void add    (qint64 usecs);
+    void reset  (void);
+
+    quint64 count   (void) const { return _count; }
+    qint64  max     (void) const { return _max; }
+
+    /// @return Upper limit of the bucket the fraction of samples falls in, or the largest sample if that is the last bucket
+    qint64 percentile(double fraction) const;
+
+    /// @return Sample count of each bucket
+    QVariantList counts(void) const;
+
+    /// @return Upper limit in usecs of each bucket but the last, which is open ended
+    static QVariantList bucketLimits(void);
+
+    static const int bucketCount = 12;
+
+private:
+    static const qint64 _bucketLimits[bucketCount - 1];
+
+    quint64 _counts[bucketCount];
+    quint64 _count;
+    qint64  _max;
+};
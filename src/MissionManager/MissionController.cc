@@ -34,6 +34,7 @@
 #include "PlanViewSettings.h"
 
 #define UPDATE_TIMEOUT 5000 ///< How often we check for bounding box changes
+#define FLIGHT_STATUS_TIMEOUT 16 ///< Flight status recalc requests are coalesced to at most one pass per frame
 
 QGC_LOGGING_CATEGORY(MissionControllerLog, "MissionControllerLog")
 
@@ -72,6 +73,10 @@ MissionController::MissionController(PlanMasterController* masterController, QOb
     _updateTimer.setSingleShot(true);
     connect(&_updateTimer, &QTimer::timeout, this, &MissionController::_updateTimeout);
 
+    _flightStatusTimer.setSingleShot(true);
+    _flightStatusTimer.setInterval(FLIGHT_STATUS_TIMEOUT);
+    connect(&_flightStatusTimer, &QTimer::timeout, this, &MissionController::_flightStatusTimeout);
+
     connect(_planViewSettings->takeoffItemNotRequired(), &Fact::rawValueChanged, this, &MissionController::_takeoffItemNotRequiredChanged);
 }
 
@@ -585,6 +590,7 @@ void MissionController::removeAll(void)
         _initAllVisualItems();
         setDirty(true);
         _resetMissionFlightStatus();
+        _flightStatusCheckpoints.clear();
     }
 }
 
@@ -1362,7 +1368,7 @@ void MissionController::_recalcWaypointLines(void)
     // Anything left in the old table is an obsolete line object that can go
     qDeleteAll(old_table);
 
-    _recalcMissionFlightStatus();
+    _requestMissionFlightStatusRecalc(0);
 
     if (_waypointPath.count() == 0) {
         // MapPolyLine has a bug where if you change from a path which has elements to an empty path the line drawn
@@ -1435,45 +1441,126 @@ void MissionController::_addTimeDistance(bool vtolInHover, double hoverTime, dou
     }
 }
 
+/// Requests a flight status recalc for a change to the sending item. Requests are coalesced into a single pass
+/// which starts at the earliest item which changed.
 void MissionController::_recalcMissionFlightStatus()
 {
-    if (!_visualItems->count()) {
+    int startIndex = 0;
+    if (_visualItems) {
+        // Vehicle speed changes and the like don't come from an item, they need the whole walk
+        startIndex = qMax(0, _visualItems->indexOf(sender()));
+    }
+    _requestMissionFlightStatusRecalc(startIndex);
+}
+
+void MissionController::_requestMissionFlightStatusRecalc(int startIndex)
+{
+    if (_flightStatusDirtyIndex == -1 || startIndex < _flightStatusDirtyIndex) {
+        _flightStatusDirtyIndex = startIndex;
+    }
+    if (!_flightStatusTimer.isActive()) {
+        _flightStatusTimer.start();
+    }
+}
+
+void MissionController::_flightStatusTimeout(void)
+{
+    int startIndex = _flightStatusDirtyIndex;
+    _flightStatusDirtyIndex = -1;
+    if (startIndex != -1) {
+        _calcMissionFlightStatus(startIndex);
+    }
+}
+
+void MissionController::flushFlightStatus(void)
+{
+    if (_flightStatusTimer.isActive()) {
+        _flightStatusTimer.stop();
+        _flightStatusTimeout();
+    }
+}
+
+void MissionController::_calcMissionFlightStatus(int startIndex)
+{
+    if (!_visualItems || !_visualItems->count()) {
         return;
     }
 
-    bool                firstCoordinateItem =           true;
-    VisualMissionItem*  lastCoordinateItemBeforeRTL =   qobject_cast<VisualMissionItem*>(_visualItems->get(0));
+    // Only restart part way through if the checkpoint is still for the same item. Anything else means the
+    // list changed under us, which should have asked for a full walk anyway.
+    if (startIndex >= _flightStatusCheckpoints.count() || startIndex >= _visualItems->count() ||
+            _flightStatusCheckpoints[startIndex].item != _visualItems->get(startIndex)) {
+        startIndex = 0;
+    }
+    _flightStatusCheckpoints.resize(_visualItems->count());
 
     bool homePositionValid = _settingsItem->coordinate().isValid();
 
-    qCDebug(MissionControllerLog) << "_recalcMissionFlightStatus";
+    qCDebug(MissionControllerLog) << "_calcMissionFlightStatus startIndex:count" << startIndex << _visualItems->count();
 
     // If home position is valid we can calculate distances between all waypoints.
     // If home position is not valid we can only calculate distances between waypoints which are
     // both relative altitude.
 
-    // No values for first item
-    lastCoordinateItemBeforeRTL->setAltDifference(0.0);
-    lastCoordinateItemBeforeRTL->setAzimuth(0.0);
-    lastCoordinateItemBeforeRTL->setDistance(0.0);
-
-    double minAltSeen = 0.0;
-    double maxAltSeen = 0.0;
     const double homePositionAltitude = _settingsItem->coordinate().altitude();
-    minAltSeen = maxAltSeen = _settingsItem->coordinate().altitude();
 
-    _resetMissionFlightStatus();
+    bool                firstCoordinateItem;
+    VisualMissionItem*  lastCoordinateItemBeforeRTL;
+    double              minAltSeen;
+    double              maxAltSeen;
+    bool                vtolInHover;
+    bool                linkStartToHome;
+    bool                foundRTL;
+    bool                vehicleYawSpecificallySet;
 
-    bool vtolInHover = true;
-    bool linkStartToHome = false;
-    bool foundRTL = false;
-    bool vehicleYawSpecificallySet = false;
+    if (startIndex == 0) {
+        firstCoordinateItem =           true;
+        lastCoordinateItemBeforeRTL =   qobject_cast<VisualMissionItem*>(_visualItems->get(0));
 
-    for (int i=0; i<_visualItems->count(); i++) {
+        // No values for first item
+        lastCoordinateItemBeforeRTL->setAltDifference(0.0);
+        lastCoordinateItemBeforeRTL->setAzimuth(0.0);
+        lastCoordinateItemBeforeRTL->setDistance(0.0);
+
+        minAltSeen = maxAltSeen = _settingsItem->coordinate().altitude();
+
+        _resetMissionFlightStatus();
+
+        vtolInHover = true;
+        linkStartToHome = false;
+        foundRTL = false;
+        vehicleYawSpecificallySet = false;
+    } else {
+        // Pick up the running totals from where the first changed item starts
+        const FlightStatusCheckpoint_t& checkpoint = _flightStatusCheckpoints[startIndex];
+        _missionFlightStatus =          checkpoint.flightStatus;
+        firstCoordinateItem =           checkpoint.firstCoordinateItem;
+        lastCoordinateItemBeforeRTL =   checkpoint.lastCoordinateItemBeforeRTL;
+        minAltSeen =                    checkpoint.minAltSeen;
+        maxAltSeen =                    checkpoint.maxAltSeen;
+        vtolInHover =                   checkpoint.vtolInHover;
+        linkStartToHome =               checkpoint.linkStartToHome;
+        foundRTL =                      checkpoint.foundRTL;
+        vehicleYawSpecificallySet =     checkpoint.vehicleYawSpecificallySet;
+    }
+
+    for (int i=startIndex; i<_visualItems->count(); i++) {
         VisualMissionItem*  item =          qobject_cast<VisualMissionItem*>(_visualItems->get(i));
         SimpleMissionItem*  simpleItem =    qobject_cast<SimpleMissionItem*>(item);
         ComplexMissionItem* complexItem =   qobject_cast<ComplexMissionItem*>(item);
 
+        FlightStatusCheckpoint_t& checkpoint = _flightStatusCheckpoints[i];
+        checkpoint.item =                           item;
+        checkpoint.flightStatus =                   _missionFlightStatus;
+        checkpoint.lastCoordinateItemBeforeRTL =    lastCoordinateItemBeforeRTL;
+        checkpoint.minAltSeen =                     minAltSeen;
+        checkpoint.maxAltSeen =                     maxAltSeen;
+        checkpoint.firstCoordinateItem =            firstCoordinateItem;
+        checkpoint.vtolInHover =                    vtolInHover;
+        checkpoint.linkStartToHome =                linkStartToHome;
+        checkpoint.foundRTL =                       foundRTL;
+        checkpoint.vehicleYawSpecificallySet =      vehicleYawSpecificallySet;
+
         if (simpleItem && simpleItem->mavCommand() == MAV_CMD_NAV_RETURN_TO_LAUNCH) {
             foundRTL = true;
         }
@@ -1670,9 +1757,16 @@ void MissionController::_recalcMissionFlightStatus()
     emit batteryChangePointChanged(_missionFlightStatus.batteryChangePoint);
     emit batteriesRequiredChanged(_missionFlightStatus.batteriesRequired);
 
-    // Walk the list again calculating altitude percentages
+    // Walk the list again calculating altitude percentages. Items before the restart point only need it when the
+    // altitude range moved.
+    int altPercentStartIndex = startIndex;
+    if (minAltSeen != _flightStatusMinAlt || maxAltSeen != _flightStatusMaxAlt) {
+        altPercentStartIndex = 0;
+    }
+    _flightStatusMinAlt = minAltSeen;
+    _flightStatusMaxAlt = maxAltSeen;
     double altRange = maxAltSeen - minAltSeen;
-    for (int i=0; i<_visualItems->count(); i++) {
+    for (int i=altPercentStartIndex; i<_visualItems->count(); i++) {
         VisualMissionItem* item = qobject_cast<VisualMissionItem*>(_visualItems->get(i));
 
         if (item->specifiesCoordinate()) {
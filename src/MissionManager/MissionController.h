@@ -17,6 +17,7 @@
 #include "QGCGeoBoundingCube.h"
 
 #include <QHash>
+#include <QVector>
 
 class CoordinateVector;
 class VisualMissionItem;
@@ -232,6 +233,10 @@ public:
 
     bool isEmpty                    (void) const;
 
+    /// Flight status recalcs are coalesced on a timer. This runs a pending one right away, so the totals above
+    /// and the flight status values on the items can be read back straight after a change.
+    void flushFlightStatus          (void);
+
     // These are the names shown in the UI for the pattern items. They are public so custom builds can remove the ones
     // they don't want through the QGCCorePlugin.
     static const QString patternFWLandingName;
@@ -281,6 +286,7 @@ private slots:
     void _currentMissionIndexChanged            (int sequenceNumber);
     void _recalcWaypointLines                   (void);
     void _recalcMissionFlightStatus             (void);
+    void _flightStatusTimeout                   (void);
     void _updateContainsItems                   (void);
     void _progressPctChanged                    (double progressPct);
     void _visualItemsDirtyChanged               (bool dirty);
@@ -326,13 +332,32 @@ private:
     void _initLoadedVisualItems(QmlObjectListModel* loadedVisualItems);
     CoordinateVector* _addWaypointLineSegment(CoordVectHashTable& prevItemPairHashTable, VisualItemPair& pair);
     void _addTimeDistance(bool vtolInHover, double hoverTime, double cruiseTime, double extraTime, double distance, int seqNum);
+    void _requestMissionFlightStatusRecalc(int startIndex);
+    void _calcMissionFlightStatus(int startIndex);
     VisualMissionItem* _insertSimpleMissionItemWorker(QGeoCoordinate coordinate, MAV_CMD command, int visualItemIndex, bool makeCurrentItem);
     void _insertComplexMissionItemWorker(const QGeoCoordinate& mapCenterCoordinate, ComplexMissionItem* complexItem, int visualItemIndex, bool makeCurrentItem);
     bool _isROIBeginItem(SimpleMissionItem* simpleItem);
     bool _isROICancelItem(SimpleMissionItem* simpleItem);
     CoordinateVector* _createCoordinateVectorWorker(VisualItemPair& pair);
 
+    /// State of the flight status walk before an item is processed. Everything an item contributes only affects
+    /// the items after it, so a change to one item restarts the walk from its checkpoint instead of from the top.
+    typedef struct {
+        VisualMissionItem*      item;                           ///< Item the checkpoint was taken at, a mismatch means the list changed
+        MissionFlightStatus_t   flightStatus;                   ///< Running totals up to the item
+        VisualMissionItem*      lastCoordinateItemBeforeRTL;
+        double                  minAltSeen;
+        double                  maxAltSeen;
+        bool                    firstCoordinateItem;
+        bool                    vtolInHover;
+        bool                    linkStartToHome;
+        bool                    foundRTL;
+        bool                    vehicleYawSpecificallySet;
+    } FlightStatusCheckpoint_t;
+
 private:
+    friend class MissionControllerTest;
+
     Vehicle*                _controllerVehicle =            nullptr;
     Vehicle*                _managerVehicle =               nullptr;
     MissionManager*         _missionManager =               nullptr;
@@ -355,6 +380,11 @@ private:
     int                     _currentPlanViewVIIndex =       -1;
     VisualMissionItem*      _currentPlanViewItem =          nullptr;
     QTimer                  _updateTimer;
+    QTimer                  _flightStatusTimer;
+    int                     _flightStatusDirtyIndex =       -1;     ///< First item whose flight status needs recalc, -1 for none
+    QVector<FlightStatusCheckpoint_t> _flightStatusCheckpoints;
+    double                  _flightStatusMinAlt =           qQNaN();
+    double                  _flightStatusMaxAlt =           qQNaN();
     QGCGeoBoundingCube      _travelBoundingCube;
     QGeoCoordinate          _takeoffCoordinate;
     QGeoCoordinate          _previousCoordinate;
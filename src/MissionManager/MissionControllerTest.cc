@@ -159,6 +159,7 @@ void MissionControllerTest::_testGimbalRecalc(void)
     _missionController->insertSimpleMissionItem(QGeoCoordinate(0, 0), 2);
     _missionController->insertSimpleMissionItem(QGeoCoordinate(0, 0), 3);
     _missionController->insertSimpleMissionItem(QGeoCoordinate(0, 0), 4);
+    _missionController->flushFlightStatus();
 
     // No specific gimbal yaw set yet
     for (int i=1; i<_missionController->visualItems()->count(); i++) {
@@ -170,12 +171,134 @@ void MissionControllerTest::_testGimbalRecalc(void)
     MissionSettingsItem* settingsItem = _missionController->visualItems()->value<MissionSettingsItem*>(0);
     settingsItem->cameraSection()->setSpecifyGimbal(true);
     settingsItem->cameraSection()->gimbalYaw()->setRawValue(0.0);
+    _missionController->flushFlightStatus();
     for (int i=1; i<_missionController->visualItems()->count(); i++) {
         VisualMissionItem* visualItem = _missionController->visualItems()->value<VisualMissionItem*>(i);
         QCOMPARE(visualItem->missionGimbalYaw(), 0.0);
     }
 }
 
+QList<double> MissionControllerTest::_flightStatusSnapshot(void)
+{
+    QList<double> snapshot = {
+        _missionController->missionDistance(),
+        _missionController->missionTime(),
+        _missionController->missionHoverDistance(),
+        _missionController->missionHoverTime(),
+        _missionController->missionCruiseDistance(),
+        _missionController->missionCruiseTime(),
+        _missionController->missionMaxTelemetry(),
+    };
+
+    QmlObjectListModel* visualItems = _missionController->visualItems();
+    for (int i=0; i<visualItems->count(); i++) {
+        VisualMissionItem* visualItem = visualItems->value<VisualMissionItem*>(i);
+        snapshot << visualItem->distance() << visualItem->azimuth() << visualItem->altDifference() << visualItem->missionVehicleYaw();
+    }
+
+    return snapshot;
+}
+
+void MissionControllerTest::_compareFlightStatus(const QList<double>& actual, const QList<double>& expected)
+{
+    QCOMPARE(actual.count(), expected.count());
+    for (int i=0; i<actual.count(); i++) {
+        if (qIsNaN(expected[i])) {
+            QVERIFY(qIsNaN(actual[i]));
+        } else {
+            QCOMPARE(actual[i], expected[i]);
+        }
+    }
+}
+
+void MissionControllerTest::_testIncrementalFlightStatus(void)
+{
+    _initForFirmwareType(MAV_AUTOPILOT_PX4);
+    for (int i=1; i<=6; i++) {
+        _missionController->insertSimpleMissionItem(QGeoCoordinate(47.0 + (i * 0.001), 8.0 + ((i % 2) * 0.002)), i);
+    }
+    _missionController->_calcMissionFlightStatus(0);
+
+    QmlObjectListModel* visualItems = _missionController->visualItems();
+
+    // Moving an item restarts the walk at its checkpoint
+    VisualMissionItem* movedItem = visualItems->value<VisualMissionItem*>(3);
+    movedItem->setCoordinate(QGeoCoordinate(47.01, 8.01, movedItem->coordinate().altitude()));
+    _missionController->_calcMissionFlightStatus(3);
+    QList<double> incremental = _flightStatusSnapshot();
+    _missionController->_calcMissionFlightStatus(0);
+    _compareFlightStatus(incremental, _flightStatusSnapshot());
+
+    // A speed change carries through to the items after it
+    SimpleMissionItem* speedItem = visualItems->value<SimpleMissionItem*>(2);
+    QVERIFY(speedItem);
+    speedItem->speedSection()->setSpecifyFlightSpeed(true);
+    speedItem->speedSection()->flightSpeed()->setRawValue(2.5);
+    _missionController->_calcMissionFlightStatus(2);
+    incremental = _flightStatusSnapshot();
+    _missionController->_calcMissionFlightStatus(0);
+    _compareFlightStatus(incremental, _flightStatusSnapshot());
+
+    // Restarting from the last item only redoes the final leg
+    VisualMissionItem* lastItem = visualItems->value<VisualMissionItem*>(visualItems->count() - 1);
+    lastItem->setCoordinate(QGeoCoordinate(46.99, 7.99, lastItem->coordinate().altitude()));
+    _missionController->_calcMissionFlightStatus(visualItems->count() - 1);
+    incremental = _flightStatusSnapshot();
+    _missionController->_calcMissionFlightStatus(0);
+    _compareFlightStatus(incremental, _flightStatusSnapshot());
+}
+
+void MissionControllerTest::_testFlightStatusCoalescing(void)
+{
+    _initForFirmwareType(MAV_AUTOPILOT_PX4);
+    for (int i=1; i<=6; i++) {
+        _missionController->insertSimpleMissionItem(QGeoCoordinate(47.0 + (i * 0.001), 8.0 + ((i % 2) * 0.002)), i);
+    }
+    _missionController->flushFlightStatus();
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, -1);
+    QVERIFY(!_missionController->_flightStatusTimer.isActive());
+
+    QmlObjectListModel* visualItems = _missionController->visualItems();
+    SimpleMissionItem*  item2       = visualItems->value<SimpleMissionItem*>(2);
+    SimpleMissionItem*  item4       = visualItems->value<SimpleMissionItem*>(4);
+    SimpleMissionItem*  item5       = visualItems->value<SimpleMissionItem*>(5);
+    QVERIFY(item2 && item4 && item5);
+
+    // Item signals in any order start the pass at the earliest item which changed
+    item4->speedSection()->setSpecifyFlightSpeed(true);
+    item4->speedSection()->flightSpeed()->setRawValue(3.5);
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, 4);
+    item2->cameraSection()->setSpecifyGimbal(true);
+    item2->cameraSection()->gimbalYaw()->setRawValue(45.0);
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, 2);
+    item5->speedSection()->setSpecifyFlightSpeed(true);
+    item5->speedSection()->flightSpeed()->setRawValue(7.0);
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, 2);
+    QVERIFY(_missionController->_flightStatusTimer.isActive());
+
+    // All of them are handled by a single pass
+    QSignalSpy spyTimeout(&_missionController->_flightStatusTimer, SIGNAL(timeout()));
+    QVERIFY(spyTimeout.wait(1000));
+    // Leave room for a second pass to show up if the requests weren't coalesced
+    QTest::qWait(100);
+    QCOMPARE(spyTimeout.count(), 1);
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, -1);
+    QVERIFY(!_missionController->_flightStatusTimer.isActive());
+    QCOMPARE(item4->missionGimbalYaw(), 45.0);
+
+    QList<double> coalesced = _flightStatusSnapshot();
+    _missionController->_calcMissionFlightStatus(0);
+    _compareFlightStatus(coalesced, _flightStatusSnapshot());
+
+    // Changes which don't come from an item need the whole walk
+    item5->speedSection()->flightSpeed()->setRawValue(8.0);
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, 5);
+    _missionController->_recalcMissionFlightStatus();
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, 0);
+    _missionController->flushFlightStatus();
+    QCOMPARE(_missionController->_flightStatusDirtyIndex, -1);
+}
+
 void MissionControllerTest::_testLoadJsonSectionAvailable(void)
 {
     _initForFirmwareType(MAV_AUTOPILOT_PX4);
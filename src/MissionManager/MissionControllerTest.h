@@ -36,6 +36,8 @@ private slots:
     void _testLoadJsonSectionAvailable(void);
     void _testEmptyVehicleAPM(void);
     void _testEmptyVehiclePX4(void);
+    void _testIncrementalFlightStatus(void);
+    void _testFlightStatusCoalescing(void);
 
 private:
 #if 0
@@ -52,6 +54,10 @@ private:
 #endif
     void _setupVisualItemSignals(VisualMissionItem* visualItem);
 
+    /// @return Mission totals followed by the values flight status calculation sets on each item
+    QList<double> _flightStatusSnapshot(void);
+    void _compareFlightStatus(const QList<double>& actual, const QList<double>& expected);
+
     // MissiomItems signals
 
     enum {
@@ -0,0 +1,590 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "PolygonClipper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static inline double _cross(const QPointF& o, const QPointF& a, const QPointF& b)
+{
+    return ((a.x() - o.x()) * (b.y() - o.y())) - ((a.y() - o.y()) * (b.x() - o.x()));
+}
+
+static inline double _dot(const QPointF& a, const QPointF& b)
+{
+    return (a.x() * b.x()) + (a.y() * b.y());
+}
+
+PolygonClipper::PolygonClipper(const QPolygonF& polygon)
+    : _polygon  (polygon)
+    , _edgeCount(polygon.count())
+    , _epsilon  (0)
+{
+    double scale = 1.0;
+    for (const QPointF& point: _polygon) {
+        scale = qMax(scale, qMax(qAbs(point.x()), qAbs(point.y())));
+    }
+    _epsilon = scale * 1e-9;
+
+    for (int firstEdge = 0; firstEdge < _edgeCount; firstEdge += _edgeBlockSize) {
+        EdgeBlock_t block;
+        block.firstEdge = firstEdge;
+        int lastEdge = qMin(firstEdge + _edgeBlockSize, _edgeCount) - 1;
+        QPolygonF blockPoints;
+        for (int i = firstEdge; i <= lastEdge + 1; i++) {
+            blockPoints << _polygon[i % _edgeCount];
+        }
+        block.bounds = blockPoints.boundingRect().adjusted(-_epsilon, -_epsilon, _epsilon, _epsilon);
+        _edgeBlocks.append(block);
+    }
+}
+
+QLineF PolygonClipper::_edge(int edgeIndex) const
+{
+    return QLineF(_polygon[edgeIndex], _polygon[edgeIndex + 1 == _edgeCount ? 0 : edgeIndex + 1]);
+}
+
+bool PolygonClipper::_linesParallel(const QList<QLineF>& lines)
+{
+    QLineF      first       = lines.first();
+    double      firstLength = first.length();
+    if (firstLength <= 0) {
+        return false;
+    }
+    QPointF     direction   = (first.p2() - first.p1()) / firstLength;
+
+    for (const QLineF& line: lines) {
+        double length = line.length();
+        if (length <= 0) {
+            return false;
+        }
+        QPointF lineDirection = (line.p2() - line.p1()) / length;
+        if (qAbs(_cross(QPointF(), direction, lineDirection)) > 1e-9) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PolygonClipper::_clipLine(const QLineF& line, const QVector<int>& edges, QList<QLineF>& resultLines) const
+{
+    QList<QPointF> intersections;
+
+    // Intersect the line with the candidate polygon edges. Edges are visited in polygon order, which decides which
+    // end the resulting transect starts from.
+    for (int edgeIndex: edges) {
+        QPointF intersectPoint;
+        if (line.intersect(_edge(edgeIndex), &intersectPoint) == QLineF::BoundedIntersection) {
+            if (!intersections.contains(intersectPoint)) {
+                intersections.append(intersectPoint);
+            }
+        }
+    }
+
+    // We now have one or more intersection points all along the same line. Find the two
+    // which are furthest away from each other to form the transect.
+    if (intersections.count() > 1) {
+        QPointF firstPoint;
+        QPointF secondPoint;
+        double currentMaxDistance = 0;
+
+        for (int i=0; i<intersections.count(); i++) {
+            for (int j=0; j<intersections.count(); j++) {
+                QLineF lineTest(intersections[i], intersections[j]);
+                double newMaxDistance = lineTest.length();
+                if (newMaxDistance > currentMaxDistance) {
+                    firstPoint = intersections[i];
+                    secondPoint = intersections[j];
+                    currentMaxDistance = newMaxDistance;
+                }
+            }
+        }
+
+        resultLines += QLineF(firstPoint, secondPoint);
+    }
+}
+
+void PolygonClipper::clipLines(const QList<QLineF>& lines, QList<QLineF>& resultLines, const QAtomicInt* cancelled) const
+{
+    resultLines.clear();
+
+    if (lines.isEmpty() || _edgeCount < 2) {
+        return;
+    }
+
+    QVector<int> allEdges(_edgeCount);
+    for (int i = 0; i < _edgeCount; i++) {
+        allEdges[i] = i;
+    }
+
+    if (!_linesParallel(lines)) {
+        for (const QLineF& line: lines) {
+            if (_timeToStop(cancelled)) {
+                return;
+            }
+            _clipLine(line, allEdges, resultLines);
+        }
+        return;
+    }
+
+    // Sweep along the normal of the lines. Each edge covers an interval of the sweep axis and can only intersect
+    // lines whose position lies within that interval.
+    QPointF direction   = (lines.first().p2() - lines.first().p1()) / lines.first().length();
+    QPointF normal      = QPointF(-direction.y(), direction.x());
+
+    double epsilon = _epsilon;
+    for (const QLineF& line: lines) {
+        epsilon = qMax(epsilon, qMax(qMax(qAbs(line.x1()), qAbs(line.y1())), qMax(qAbs(line.x2()), qAbs(line.y2()))) * 1e-9);
+    }
+
+    QVector<double> edgeLow(_edgeCount);
+    QVector<double> edgeHigh(_edgeCount);
+    for (int i = 0; i < _edgeCount; i++) {
+        QLineF edge = _edge(i);
+        double p1 = _dot(edge.p1(), normal);
+        double p2 = _dot(edge.p2(), normal);
+        edgeLow[i]  = qMin(p1, p2) - epsilon;
+        edgeHigh[i] = qMax(p1, p2) + epsilon;
+    }
+    QVector<int> edgesByLow = allEdges;
+    std::sort(edgesByLow.begin(), edgesByLow.end(), [&edgeLow](int a, int b) { return edgeLow[a] < edgeLow[b]; });
+
+    QVector<double> lineLow(lines.count());
+    QVector<double> lineHigh(lines.count());
+    QVector<int>    linesByLow(lines.count());
+    for (int i = 0; i < lines.count(); i++) {
+        double p1 = _dot(lines[i].p1(), normal);
+        double p2 = _dot(lines[i].p2(), normal);
+        lineLow[i]      = qMin(p1, p2);
+        lineHigh[i]     = qMax(p1, p2);
+        linesByLow[i]   = i;
+    }
+    std::stable_sort(linesByLow.begin(), linesByLow.end(), [&lineLow](int a, int b) { return lineLow[a] < lineLow[b]; });
+
+    QVector<QList<QLineF>>  clippedLines(lines.count());
+    QVector<int>            activeEdges;
+    QVector<int>            candidateEdges;
+    int                     nextEdge = 0;
+
+    for (int lineIndex: linesByLow) {
+        if (_timeToStop(cancelled)) {
+            return;
+        }
+
+        while (nextEdge < _edgeCount && edgeLow[edgesByLow[nextEdge]] <= lineHigh[lineIndex]) {
+            activeEdges.append(edgesByLow[nextEdge++]);
+        }
+        // Lines are visited in increasing order, an edge which ends before this line is done for good
+        for (int i = activeEdges.count() - 1; i >= 0; i--) {
+            if (edgeHigh[activeEdges[i]] < lineLow[lineIndex]) {
+                activeEdges[i] = activeEdges.last();
+                activeEdges.removeLast();
+            }
+        }
+
+        candidateEdges = activeEdges;
+        std::sort(candidateEdges.begin(), candidateEdges.end());
+        _clipLine(lines[lineIndex], candidateEdges, clippedLines[lineIndex]);
+    }
+
+    for (const QList<QLineF>& clippedLine: clippedLines) {
+        resultLines += clippedLine;
+    }
+}
+
+bool PolygonClipper::vertexCanSeeOther(int a, int b) const
+{
+    if (a == b) return false;
+    int aAfter  = a + 1 == _edgeCount ? 0 : a + 1;
+    int aBefore = a == 0 ? _edgeCount - 1 : a - 1;
+    if (aAfter == b) return false;
+    if (aBefore == b) return false;
+
+    QLineF  lineAB      { _polygon[a], _polygon[b] };
+    double  distanceAB  = lineAB.length();
+    QRectF  boundsAB    = QRectF(lineAB.p1(), lineAB.p2()).normalized().adjusted(-_epsilon, -_epsilon, _epsilon, _epsilon);
+
+    for (const EdgeBlock_t& block: _edgeBlocks) {
+        if (!block.bounds.intersects(boundsAB)) {
+            continue;
+        }
+        int lastEdge = qMin(block.firstEdge + _edgeBlockSize, _edgeCount);
+        for (int c = block.firstEdge; c < lastEdge; c++) {
+            if (c == a) continue;
+            if (c == b) continue;
+            int d = c + 1 == _edgeCount ? 0 : c + 1;
+            if (d == a) continue;
+            if (d == b) continue;
+            QPointF intersection;
+            if (lineAB.intersect(QLineF(_polygon[c], _polygon[d]), &intersection) == QLineF::BoundedIntersection) {
+                if (QLineF(lineAB.p1(), intersection).length() < distanceAB) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool PolygonClipper::_isReflex(const QPolygonF& polygon, int vertex)
+{
+    const QPointF& before   = polygon[vertex == 0 ? polygon.count() - 1 : vertex - 1];
+    const QPointF& after    = polygon[vertex == polygon.count() - 1 ? 0 : vertex + 1];
+    return _cross(before, polygon[vertex], after) > 0;
+}
+
+void PolygonClipper::decomposeConvex(const QPolygonF& polygon, QList<QPolygonF>& decomposedPolygons, const QAtomicInt* cancelled)
+{
+    if (polygon.count() < 3) {
+        return;
+    }
+
+    // The reflex test expects clockwise winding
+    bool        reversed = _twiceSignedArea(polygon) > 0;
+    QPolygonF   clockwise;
+    for (int i = 0; i < polygon.count(); i++) {
+        clockwise << polygon[reversed ? polygon.count() - 1 - i : i];
+    }
+
+    int reflexCount = 0;
+    for (int i = 0; i < clockwise.count(); i++) {
+        if (_isReflex(clockwise, i)) {
+            reflexCount++;
+        }
+    }
+
+    QList<QPolygonF> pieces;
+    if (reflexCount > keilMaxReflexVertices) {
+        if (!_hertelMehlhorn(clockwise, pieces, cancelled)) {
+            pieces = { clockwise };
+        }
+    } else {
+        IndexPolygon_t indices(clockwise.count());
+        for (int i = 0; i < clockwise.count(); i++) {
+            indices[i] = i;
+        }
+        QHash<IndexPolygon_t, QList<IndexPolygon_t>>    memo;
+        QList<IndexPolygon_t>                           decomposed;
+        _keil(clockwise, indices, memo, decomposed, cancelled);
+        for (const IndexPolygon_t& piece: decomposed) {
+            QPolygonF piecePolygon;
+            for (int index: piece) {
+                piecePolygon << clockwise[index];
+            }
+            pieces << piecePolygon;
+        }
+    }
+
+    // Hand back pieces with the same winding as the input
+    for (const QPolygonF& piece: pieces) {
+        QPolygonF piecePolygon;
+        for (int i = 0; i < piece.count(); i++) {
+            piecePolygon << piece[reversed ? piece.count() - 1 - i : i];
+        }
+        decomposedPolygons << piecePolygon;
+    }
+}
+
+double PolygonClipper::_twiceSignedArea(const QPolygonF& polygon)
+{
+    double twiceArea = 0;
+    for (int i = 0; i < polygon.count(); i++) {
+        const QPointF& p1 = polygon[i];
+        const QPointF& p2 = polygon[i + 1 == polygon.count() ? 0 : i + 1];
+        twiceArea += (p1.x() * p2.y()) - (p2.x() * p1.y());
+    }
+    return twiceArea;
+}
+
+/// This follows "Mark Keil's Algorithm" https://mpen.ca/406/keil. Sub polygons are identified by their vertex
+/// indices into points, the same sub polygon is reached through many different splits so results are memoized.
+void PolygonClipper::_keil(const QPolygonF& points, const IndexPolygon_t& polygon, QHash<IndexPolygon_t, QList<IndexPolygon_t>>& memo, QList<IndexPolygon_t>& decomposed, const QAtomicInt* cancelled)
+{
+    int vertexCount = polygon.count();
+    if (vertexCount < 3) return;
+    if (vertexCount == 3) {
+        decomposed << polygon;
+        return;
+    }
+
+    auto memoIt = memo.constFind(polygon);
+    if (memoIt != memo.constEnd()) {
+        decomposed << memoIt.value();
+        return;
+    }
+
+    QPolygonF subPolygon;
+    for (int index: polygon) {
+        subPolygon << points[index];
+    }
+    PolygonClipper  clipper(subPolygon);
+    QVector<bool>   reflex(vertexCount);
+    for (int i = 0; i < vertexCount; i++) {
+        reflex[i] = _isReflex(subPolygon, i);
+    }
+
+    int                     decompSize = std::numeric_limits<int>::max();
+    QList<IndexPolygon_t>   decomposedMin;
+
+    for (int vertex = 0; vertex < vertexCount; vertex++) {
+        if (!reflex[vertex]) continue;
+
+        if (_timeToStop(cancelled)) {
+            // Result is going to be thrown away, don't bother finishing
+            break;
+        }
+
+        int vertexBefore    = vertex == 0 ? vertexCount - 1 : vertex - 1;
+        int vertexAfter     = vertex == vertexCount - 1 ? 0 : vertex + 1;
+
+        for (int vertexOther = 0; vertexOther < vertexCount; vertexOther++) {
+            if (vertexOther == vertex) continue;
+            if (vertexAfter == vertexOther) continue;
+            if (vertexBefore == vertexOther) continue;
+            if (!clipper.vertexCanSeeOther(vertex, vertexOther)) continue;
+
+            IndexPolygon_t polyLeft;
+            bool polyLeftContainsReflex = false;
+            for (int v = vertex; v != vertexOther; v = v + 1 == vertexCount ? 0 : v + 1) {
+                if (v != vertex && reflex[v]) {
+                    polyLeftContainsReflex = true;
+                }
+                polyLeft << polygon[v];
+            }
+            polyLeft << polygon[vertexOther];
+            bool polyLeftValid = !(polyLeftContainsReflex && polyLeft.count() == 3);
+
+            IndexPolygon_t polyRight;
+            bool polyRightContainsReflex = false;
+            for (int v = vertexOther; v != vertex; v = v + 1 == vertexCount ? 0 : v + 1) {
+                if (reflex[v]) {
+                    polyRightContainsReflex = true;
+                }
+                polyRight << polygon[v];
+            }
+            polyRight << polygon[vertex];
+            bool polyRightValid = !(polyRightContainsReflex && polyRight.count() == 3);
+
+            if (!polyLeftValid || !polyRightValid) {
+                continue;
+            }
+
+            // recursion
+            QList<IndexPolygon_t> polyLeftDecomposed;
+            _keil(points, polyLeft, memo, polyLeftDecomposed, cancelled);
+
+            QList<IndexPolygon_t> polyRightDecomposed;
+            _keil(points, polyRight, memo, polyRightDecomposed, cancelled);
+
+            // composition
+            int subSize = polyLeftDecomposed.count() + polyRightDecomposed.count();
+            if ((polyLeftContainsReflex && polyLeftDecomposed.count() == 1)
+                    || (polyRightContainsReflex && polyRightDecomposed.count() == 1)) {
+                // don't accept polygons that contain reflex vertices and were not split
+                subSize = std::numeric_limits<int>::max();
+            }
+            if (subSize < decompSize) {
+                decompSize = subSize;
+                decomposedMin = polyLeftDecomposed + polyRightDecomposed;
+            }
+        }
+    }
+
+    QList<IndexPolygon_t> result;
+    if (decomposedMin.count() > 0) {
+        result = decomposedMin;
+    } else {
+        result << polygon;
+    }
+    if (!_timeToStop(cancelled)) {
+        memo.insert(polygon, result);
+    }
+    decomposed << result;
+}
+
+/// Ear clipping triangulation followed by removal of every diagonal that isn't needed to keep the pieces convex
+bool PolygonClipper::_hertelMehlhorn(const QPolygonF& polygon, QList<QPolygonF>& decomposedPolygons, const QAtomicInt* cancelled)
+{
+    int vertexCount = polygon.count();
+
+    // Work in counter-clockwise order, convex vertices then turn left
+    bool reversed = _twiceSignedArea(polygon) < 0;
+    QPolygonF points;
+    for (int i = 0; i < vertexCount; i++) {
+        points << polygon[reversed ? vertexCount - 1 - i : i];
+    }
+
+    QVector<int>    prev(vertexCount);
+    QVector<int>    next(vertexCount);
+    QVector<bool>   reflex(vertexCount);
+    QVector<int>    reflexVertices;
+    for (int i = 0; i < vertexCount; i++) {
+        prev[i] = i == 0 ? vertexCount - 1 : i - 1;
+        next[i] = i == vertexCount - 1 ? 0 : i + 1;
+    }
+    for (int i = 0; i < vertexCount; i++) {
+        reflex[i] = _cross(points[prev[i]], points[i], points[next[i]]) < 0;
+        if (reflex[i]) {
+            reflexVertices.append(i);
+        }
+    }
+
+    auto isEar = [&](int vertex) {
+        int p = prev[vertex];
+        int n = next[vertex];
+        if (_cross(points[p], points[vertex], points[n]) <= 0) {
+            return false;
+        }
+        // Only reflex vertices can be inside the triangle. Vertices only ever become more convex as ears are
+        // removed, so the list is never added to.
+        for (int r: reflexVertices) {
+            if (!reflex[r] || r == p || r == vertex || r == n) {
+                continue;
+            }
+            const QPointF& point = points[r];
+            if (_cross(points[p], points[vertex], point) >= 0 &&
+                    _cross(points[vertex], points[n], point) >= 0 &&
+                    _cross(points[n], points[p], point) >= 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    QVector<IndexPolygon_t> pieces;
+    int remaining   = vertexCount;
+    int vertex      = 0;
+    int misses      = 0;
+    while (remaining > 3) {
+        if (_timeToStop(cancelled)) {
+            return true;
+        }
+
+        int     p           = prev[vertex];
+        int     n           = next[vertex];
+        double  turn        = _cross(points[p], points[vertex], points[n]);
+        bool    collinear   = turn == 0;
+
+        if (collinear || isEar(vertex)) {
+            if (!collinear) {
+                pieces.append(IndexPolygon_t({ p, vertex, n }));
+            }
+            next[p] = n;
+            prev[n] = p;
+            remaining--;
+            reflex[vertex] = false;
+            if (reflex[p]) {
+                reflex[p] = _cross(points[prev[p]], points[p], points[n]) < 0;
+            }
+            if (reflex[n]) {
+                reflex[n] = _cross(points[p], points[n], points[next[n]]) < 0;
+            }
+            vertex = n;
+            misses = 0;
+        } else {
+            vertex = n;
+            if (++misses > remaining) {
+                // Self intersecting or otherwise degenerate, no ear left
+                return false;
+            }
+        }
+    }
+    if (_cross(points[prev[vertex]], points[vertex], points[next[vertex]]) != 0) {
+        pieces.append(IndexPolygon_t({ prev[vertex], vertex, next[vertex] }));
+    }
+
+    // Merge pieces across diagonals as long as both ends of the diagonal stay convex
+    auto edgeKey = [](int from, int to) { return (static_cast<quint64>(from) << 32) | static_cast<quint32>(to); };
+    QHash<quint64, int> edgeOwner;
+    for (int i = 0; i < pieces.count(); i++) {
+        const IndexPolygon_t& piece = pieces[i];
+        for (int j = 0; j < piece.count(); j++) {
+            edgeOwner.insert(edgeKey(piece[j], piece[(j + 1) % piece.count()]), i);
+        }
+    }
+
+    // Diagonals are the triangle edges which aren't polygon edges and have a triangle on both sides
+    QVector<QPair<int, int>> diagonals;
+    for (const IndexPolygon_t& triangle: pieces) {
+        for (int j = 0; j < triangle.count(); j++) {
+            int u = triangle[j];
+            int v = triangle[(j + 1) % triangle.count()];
+            if (u < v && v != (u + 1) % vertexCount && u != (v + 1) % vertexCount && edgeOwner.contains(edgeKey(v, u))) {
+                diagonals.append(qMakePair(u, v));
+            }
+        }
+    }
+
+    for (const QPair<int, int>& diagonal: diagonals) {
+        if (_timeToStop(cancelled)) {
+            return true;
+        }
+
+        int u = diagonal.first;
+        int v = diagonal.second;
+        int pieceA = edgeOwner.value(edgeKey(u, v), -1);
+        int pieceB = edgeOwner.value(edgeKey(v, u), -1);
+        if (pieceA < 0 || pieceB < 0 || pieceA == pieceB) {
+            continue;
+        }
+
+        const IndexPolygon_t& a = pieces[pieceA];
+        const IndexPolygon_t& b = pieces[pieceB];
+        int aCount      = a.count();
+        int bCount      = b.count();
+        int aU          = a.indexOf(u);
+        int bV          = b.indexOf(v);
+        int aBeforeU    = a[(aU + aCount - 1) % aCount];
+        int aAfterV     = a[(aU + 2) % aCount];
+        int bAfterU     = b[(bV + 2) % bCount];
+        int bBeforeV    = b[(bV + bCount - 1) % bCount];
+        if (_cross(points[aBeforeU], points[u], points[bAfterU]) < 0 || _cross(points[bBeforeV], points[v], points[aAfterV]) < 0) {
+            continue;
+        }
+
+        IndexPolygon_t merged;
+        merged << u;
+        for (int k = 2; k < bCount; k++) {
+            merged << b[(bV + k) % bCount];
+        }
+        merged << v;
+        for (int k = 2; k < aCount; k++) {
+            merged << a[(aU + k) % aCount];
+        }
+
+        int mergedPiece = qMin(pieceA, pieceB);
+        int deadPiece   = qMax(pieceA, pieceB);
+        edgeOwner.remove(edgeKey(u, v));
+        edgeOwner.remove(edgeKey(v, u));
+        for (int k = 0; k < merged.count(); k++) {
+            edgeOwner.insert(edgeKey(merged[k], merged[(k + 1) % merged.count()]), mergedPiece);
+        }
+        pieces[mergedPiece] = merged;
+        pieces[deadPiece].clear();
+    }
+
+    for (const IndexPolygon_t& piece: pieces) {
+        if (piece.isEmpty()) {
+            continue;
+        }
+        QPolygonF piecePolygon;
+        for (int k = 0; k < piece.count(); k++) {
+            // Hand back pieces with the same winding as the input
+            int index = piece[reversed ? piece.count() - 1 - k : k];
+            piecePolygon << points[index];
+        }
+        decomposedPolygons << piecePolygon;
+    }
+
+    return true;
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QLineF>
+#include <QList>
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector>
+
+/// Clips transect lines to a polygon and splits polygons into convex pieces, for the transect style complex items.
+/// The polygon edges are indexed once up front so that clipping a full set of transects or testing many diagonals
+/// doesn't rescan every edge each time. This keeps imported KML/SHP boundaries with thousands of vertices usable.
+///
+/// Clipping results match the original brute force implementation exactly. Safe to use from any thread.
+class PolygonClipper
+{
+public:
+    /// @param polygon Edges run from each vertex to the next and from the last vertex back to the first. Repeating
+    ///                the first vertex at the end is fine, the closing edge is then empty and never intersects.
+    PolygonClipper(const QPolygonF& polygon);
+
+    /// Clips each line to the polygon. The result for a line is the segment between the two intersections with
+    /// the polygon which are furthest apart, lines with less than two intersections are dropped. The edges are
+    /// swept in the direction across the lines, so for the parallel lines of a transect pattern each line is only
+    /// intersected with the edges that actually span it. Non-parallel lines fall back to testing all edges.
+    ///     @param cancelled Optional, polled between lines. Clipping stops early once it is non-zero.
+    void clipLines(const QList<QLineF>& lines, QList<QLineF>& resultLines, const QAtomicInt* cancelled = nullptr) const;
+
+    /// @return true: Vertex a can see vertex b through the inside or outside of the polygon, meaning the segment
+    ///               between them doesn't cross any edge not attached to either. Adjacent vertices can't see each
+    ///               other.
+    bool vertexCanSeeOther(int a, int b) const;
+
+    /// Decomposes a polygon of either winding into convex sub polygons with the same winding. Polygons with few
+    /// reflex vertices are decomposed into the minimum number of pieces (Keil's algorithm). Above that the search
+    /// is exponential, so ear clipping triangulation followed by Hertel-Mehlhorn merging is used instead, which
+    /// gives at most four times the optimal number of pieces in O(n * r) time.
+    ///     @param cancelled Optional, polled periodically. Output is incomplete once it is non-zero.
+    static void decomposeConvex(const QPolygonF& polygon, QList<QPolygonF>& decomposedPolygons, const QAtomicInt* cancelled = nullptr);
+
+    /// Decomposition is done using Keil's algorithm up to this many reflex vertices
+    static const int keilMaxReflexVertices = 10;
+
+private:
+    typedef struct {
+        int     firstEdge;
+        QRectF  bounds;
+    } EdgeBlock_t;
+
+    typedef QVector<int> IndexPolygon_t;
+
+    QLineF  _edge               (int edgeIndex) const;
+    void    _clipLine           (const QLineF& line, const QVector<int>& edges, QList<QLineF>& resultLines) const;
+
+    static bool _linesParallel  (const QList<QLineF>& lines);
+    static bool _isReflex       (const QPolygonF& polygon, int vertex); ///< Expects clockwise winding
+    static double _twiceSignedArea(const QPolygonF& polygon);           ///< Positive for counter-clockwise winding
+    static bool _timeToStop     (const QAtomicInt* cancelled) { return cancelled && cancelled->loadAcquire(); }
+    static void _keil           (const QPolygonF& points, const IndexPolygon_t& polygon, QHash<IndexPolygon_t, QList<IndexPolygon_t>>& memo, QList<IndexPolygon_t>& decomposed, const QAtomicInt* cancelled);
+    static bool _hertelMehlhorn (const QPolygonF& polygon, QList<QPolygonF>& decomposedPolygons, const QAtomicInt* cancelled);
+
+    QPolygonF               _polygon;
+    int                     _edgeCount;
+    double                  _epsilon;       ///< Slack for conservative culling, exact decisions are made by QLineF::intersect
+    QVector<EdgeBlock_t>    _edgeBlocks;    ///< Bounding boxes of runs of consecutive edges
+
+    static const int _edgeBlockSize = 16;
+};
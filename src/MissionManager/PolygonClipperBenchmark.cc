@@ -0,0 +1,74 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "PolygonClipperBenchmark.h"
+#include "PolygonClipperTest.h"
+#include "PolygonClipper.h"
+
+void PolygonClipperBenchmark::_vertexCountData(const QList<int>& vertexCounts)
+{
+    QTest::addColumn<int>("vertexCount");
+    for (int vertexCount: vertexCounts) {
+        QTest::newRow(qPrintable(QStringLiteral("%1 vertices").arg(vertexCount))) << vertexCount;
+    }
+}
+
+void PolygonClipperBenchmark::_clipLines_benchmark_data(void)
+{
+    _vertexCountData({ 10, 100, 1000, 10000 });
+}
+
+void PolygonClipperBenchmark::_clipLines_benchmark(void)
+{
+    QFETCH(int, vertexCount);
+
+    QPolygonF       polygon = PolygonClipperTest::fieldBoundary(vertexCount, vertexCount);
+    QList<QLineF>   lines   = PolygonClipperTest::transectLines(polygon, 30, 5);
+    QList<QLineF>   clipped;
+
+    QBENCHMARK {
+        PolygonClipper(polygon).clipLines(lines, clipped);
+    }
+}
+
+void PolygonClipperBenchmark::_bruteForceClip_benchmark_data(void)
+{
+    _vertexCountData({ 10, 100, 1000, 10000 });
+}
+
+void PolygonClipperBenchmark::_bruteForceClip_benchmark(void)
+{
+    QFETCH(int, vertexCount);
+
+    QPolygonF       polygon = PolygonClipperTest::fieldBoundary(vertexCount, vertexCount);
+    QList<QLineF>   lines   = PolygonClipperTest::transectLines(polygon, 30, 5);
+    QList<QLineF>   clipped;
+
+    QBENCHMARK {
+        PolygonClipperTest::bruteForceClip(lines, polygon, clipped);
+    }
+}
+
+void PolygonClipperBenchmark::_decomposeConvex_benchmark_data(void)
+{
+    _vertexCountData({ 100, 1000, 10000 });
+}
+
+void PolygonClipperBenchmark::_decomposeConvex_benchmark(void)
+{
+    QFETCH(int, vertexCount);
+
+    QPolygonF polygon = PolygonClipperTest::fieldBoundary(vertexCount, vertexCount);
+    polygon.removeLast();
+
+    QBENCHMARK {
+        QList<QPolygonF> decomposed;
+        PolygonClipper::decomposeConvex(polygon, decomposed);
+    }
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+/// PolygonClipper against the brute force clip it replaced, over hand drawn up to GIS sized polygons
+class PolygonClipperBenchmark : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _clipLines_benchmark_data          (void);
+    void _clipLines_benchmark               (void);
+    void _bruteForceClip_benchmark_data     (void);
+    void _bruteForceClip_benchmark          (void);
+    void _decomposeConvex_benchmark_data    (void);
+    void _decomposeConvex_benchmark         (void);
+
+private:
+    void _vertexCountData(const QList<int>& vertexCounts);
+};
@@ -0,0 +1,273 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "PolygonClipperTest.h"
+
+#include <QRandomGenerator>
+#include <QtMath>
+
+QPolygonF PolygonClipperTest::fieldBoundary(int vertexCount, int seed)
+{
+    // Digitized field edges wander in and out around an overall shape, model that as a noisy star polygon
+    QRandomGenerator    random(static_cast<quint32>(seed));
+    QPolygonF           polygon;
+
+    for (int i = 0; i < vertexCount; i++) {
+        double angle    = (2.0 * M_PI * i) / vertexCount;
+        double radius   = 350.0 + (100.0 * qSin(angle * 3)) + (random.generateDouble() * 100.0);
+        polygon << QPointF(radius * qCos(angle), radius * qSin(angle));
+    }
+    polygon << polygon.first();
+
+    return polygon;
+}
+
+QPolygonF PolygonClipperTest::_comb(int teeth)
+{
+    QPolygonF polygon;
+
+    polygon << QPointF(0, 0) << QPointF((teeth * 20.0) - 10, 0);
+    for (int i = teeth - 1; i >= 0; i--) {
+        double x = i * 20.0;
+        polygon << QPointF(x + 10, 100) << QPointF(x, 100);
+        if (i > 0) {
+            polygon << QPointF(x, 20) << QPointF(x - 10, 20);
+        }
+    }
+
+    return polygon;
+}
+
+QList<QLineF> PolygonClipperTest::transectLines(const QPolygonF& polygon, double angle, double spacing)
+{
+    QList<QLineF>   lines;
+    QRectF          boundingRect    = polygon.boundingRect();
+    QPointF         center          = boundingRect.center();
+    double          halfWidth       = (qMax(boundingRect.width(), boundingRect.height()) + 2000.0) / 2.0;
+    double          radians         = qDegreesToRadians(angle);
+
+    auto rotate = [&](const QPointF& point) {
+        QPointF offset = point - center;
+        return QPointF((offset.x() * qCos(radians)) - (offset.y() * qSin(radians)), (offset.x() * qSin(radians)) + (offset.y() * qCos(radians))) + center;
+    };
+
+    for (double x = center.x() - halfWidth; x < center.x() + halfWidth; x += spacing) {
+        lines += QLineF(rotate(QPointF(x, center.y() - halfWidth)), rotate(QPointF(x, center.y() + halfWidth)));
+    }
+
+    return lines;
+}
+
+void PolygonClipperTest::bruteForceClip(const QList<QLineF>& lines, const QPolygonF& polygon, QList<QLineF>& resultLines)
+{
+    resultLines.clear();
+
+    for (const QLineF& line: lines) {
+        QList<QPointF> intersections;
+
+        for (int j=0; j<polygon.count()-1; j++) {
+            QPointF intersectPoint;
+            if (line.intersect(QLineF(polygon[j], polygon[j+1]), &intersectPoint) == QLineF::BoundedIntersection) {
+                if (!intersections.contains(intersectPoint)) {
+                    intersections.append(intersectPoint);
+                }
+            }
+        }
+
+        if (intersections.count() > 1) {
+            QPointF firstPoint;
+            QPointF secondPoint;
+            double currentMaxDistance = 0;
+
+            for (int i=0; i<intersections.count(); i++) {
+                for (int j=0; j<intersections.count(); j++) {
+                    double newMaxDistance = QLineF(intersections[i], intersections[j]).length();
+                    if (newMaxDistance > currentMaxDistance) {
+                        firstPoint = intersections[i];
+                        secondPoint = intersections[j];
+                        currentMaxDistance = newMaxDistance;
+                    }
+                }
+            }
+
+            resultLines += QLineF(firstPoint, secondPoint);
+        }
+    }
+}
+
+double PolygonClipperTest::_area(const QPolygonF& polygon)
+{
+    double twiceArea = 0;
+    for (int i = 0; i < polygon.count(); i++) {
+        const QPointF& p1 = polygon[i];
+        const QPointF& p2 = polygon[(i + 1) % polygon.count()];
+        twiceArea += (p1.x() * p2.y()) - (p2.x() * p1.y());
+    }
+    return qAbs(twiceArea) / 2.0;
+}
+
+bool PolygonClipperTest::_isConvex(const QPolygonF& polygon)
+{
+    int count = polygon.count();
+    if (count < 3) {
+        return false;
+    }
+
+    bool positive = false;
+    bool negative = false;
+    for (int i = 0; i < count; i++) {
+        const QPointF& o = polygon[i];
+        const QPointF& a = polygon[(i + 1) % count];
+        const QPointF& b = polygon[(i + 2) % count];
+        double cross = ((a.x() - o.x()) * (b.y() - o.y())) - ((a.y() - o.y()) * (b.x() - o.x()));
+        if (cross > 1e-6) {
+            positive = true;
+        } else if (cross < -1e-6) {
+            negative = true;
+        }
+    }
+    return !(positive && negative);
+}
+
+void PolygonClipperTest::_verifyDecomposition(const QPolygonF& polygon, const QList<QPolygonF>& decomposed)
+{
+    double area = 0;
+    for (const QPolygonF& piece: decomposed) {
+        QVERIFY(_isConvex(piece));
+        area += _area(piece);
+    }
+    QVERIFY(qAbs(area - _area(polygon)) < _area(polygon) * 1e-9);
+}
+
+void PolygonClipperTest::_clipLines_test(void)
+{
+    // Results must be identical to the original implementation, including which end each transect starts from
+    const QList<int> vertexCounts = { 4, 25, 300 };
+
+    for (int vertexCount: vertexCounts) {
+        QPolygonF polygon = fieldBoundary(vertexCount, vertexCount);
+        for (double angle = 0; angle < 180; angle += 22.5) {
+            QList<QLineF> lines = transectLines(polygon, angle, 15);
+            QList<QLineF> expected;
+            QList<QLineF> clipped;
+
+            bruteForceClip(lines, polygon, expected);
+            PolygonClipper(polygon).clipLines(lines, clipped);
+            QVERIFY(expected.count() > 0);
+            QCOMPARE(clipped, expected);
+        }
+    }
+
+    // Concave polygon, transects cross several edges
+    QPolygonF comb = _comb(10);
+    comb << comb.first();
+    QList<QLineF> expected;
+    QList<QLineF> clipped;
+    QList<QLineF> lines = transectLines(comb, 90, 7);
+    bruteForceClip(lines, comb, expected);
+    PolygonClipper(comb).clipLines(lines, clipped);
+    QCOMPARE(clipped, expected);
+}
+
+void PolygonClipperTest::_clipLargePolygon_test(void)
+{
+    // Parcel boundaries imported from GIS run to thousands of vertices
+    QPolygonF       polygon = fieldBoundary(10000, 10000);
+    QList<QLineF>   lines   = transectLines(polygon, 30, 5);
+    QList<QLineF>   expected;
+    QList<QLineF>   clipped;
+
+    bruteForceClip(lines, polygon, expected);
+    PolygonClipper(polygon).clipLines(lines, clipped);
+    QVERIFY(expected.count() > 0);
+    QCOMPARE(clipped, expected);
+}
+
+void PolygonClipperTest::_clipNonParallelLines_test(void)
+{
+    QPolygonF       polygon = fieldBoundary(50, 1);
+    QList<QLineF>   lines;
+    QList<QLineF>   expected;
+    QList<QLineF>   clipped;
+
+    for (double angle = 0; angle < 180; angle += 10) {
+        double radians = qDegreesToRadians(angle);
+        lines += QLineF(QPointF(-1000 * qCos(radians), -1000 * qSin(radians)), QPointF(1000 * qCos(radians), 1000 * qSin(radians)));
+    }
+
+    bruteForceClip(lines, polygon, expected);
+    PolygonClipper(polygon).clipLines(lines, clipped);
+    QCOMPARE(clipped.count(), lines.count());
+    QCOMPARE(clipped, expected);
+}
+
+void PolygonClipperTest::_decomposeConvex_test(void)
+{
+    QList<QPolygonF> decomposed;
+
+    // Convex polygons are left alone
+    QPolygonF square({ QPointF(0, 0), QPointF(0, 10), QPointF(10, 10), QPointF(10, 0) });
+    PolygonClipper::decomposeConvex(square, decomposed);
+    QCOMPARE(decomposed.count(), 1);
+
+    // L shape, single reflex vertex, split in two
+    QPolygonF lShape({ QPointF(0, 0), QPointF(0, 20), QPointF(10, 20), QPointF(10, 10), QPointF(20, 10), QPointF(20, 0) });
+    decomposed.clear();
+    PolygonClipper::decomposeConvex(lShape, decomposed);
+    QCOMPARE(decomposed.count(), 2);
+    _verifyDecomposition(lShape, decomposed);
+
+    // Few reflex vertices, exhaustive search. Winding must not matter.
+    QPolygonF smallComb = _comb(4);
+    decomposed.clear();
+    PolygonClipper::decomposeConvex(smallComb, decomposed);
+    QVERIFY(decomposed.count() >= 4);
+    _verifyDecomposition(smallComb, decomposed);
+    int smallCombPieces = decomposed.count();
+
+    QPolygonF reversedSmallComb;
+    for (int i = smallComb.count() - 1; i >= 0; i--) {
+        reversedSmallComb << smallComb[i];
+    }
+    decomposed.clear();
+    PolygonClipper::decomposeConvex(reversedSmallComb, decomposed);
+    QCOMPARE(decomposed.count(), smallCombPieces);
+    _verifyDecomposition(reversedSmallComb, decomposed);
+
+    // Too many reflex vertices for an exhaustive search, both windings
+    QPolygonF largeComb = _comb(50);
+    decomposed.clear();
+    PolygonClipper::decomposeConvex(largeComb, decomposed);
+    QVERIFY(decomposed.count() >= 50);
+    _verifyDecomposition(largeComb, decomposed);
+
+    QPolygonF reversedComb;
+    for (int i = largeComb.count() - 1; i >= 0; i--) {
+        reversedComb << largeComb[i];
+    }
+    decomposed.clear();
+    PolygonClipper::decomposeConvex(reversedComb, decomposed);
+    QVERIFY(decomposed.count() >= 50);
+    _verifyDecomposition(reversedComb, decomposed);
+}
+
+void PolygonClipperTest::_decomposeLargePolygon_test(void)
+{
+    const QList<int> vertexCounts = { 100, 1000, 10000 };
+
+    for (int vertexCount: vertexCounts) {
+        QPolygonF polygon = fieldBoundary(vertexCount, vertexCount);
+        polygon.removeLast();
+
+        QList<QPolygonF> decomposed;
+        PolygonClipper::decomposeConvex(polygon, decomposed);
+        QVERIFY(decomposed.count() > 1);
+        _verifyDecomposition(polygon, decomposed);
+    }
+}
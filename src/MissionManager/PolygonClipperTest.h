@@ -0,0 +1,44 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "PolygonClipper.h"
+
+/// Unit test for PolygonClipper, against fixtures the size of hand drawn polygons up to imported GIS boundaries
+class PolygonClipperTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    /// Irregular field boundary roughly 1km across in NED meters, closed by repeating the first vertex
+    static QPolygonF fieldBoundary(int vertexCount, int seed);
+
+    /// Parallel transect lines covering the polygon at the given angle, the way the survey generates them
+    static QList<QLineF> transectLines(const QPolygonF& polygon, double angle, double spacing);
+
+    /// The original clipping implementation, tests every line against every edge
+    static void bruteForceClip(const QList<QLineF>& lines, const QPolygonF& polygon, QList<QLineF>& resultLines);
+
+private slots:
+    void _clipLines_test                (void);
+    void _clipLargePolygon_test         (void);
+    void _clipNonParallelLines_test     (void);
+    void _decomposeConvex_test          (void);
+    void _decomposeLargePolygon_test    (void);
+
+private:
+    /// Comb shaped polygon, every tooth adds a reflex vertex
+    QPolygonF _comb(int teeth);
+
+    double  _area       (const QPolygonF& polygon);
+    bool    _isConvex   (const QPolygonF& polygon);
+    void    _verifyDecomposition(const QPolygonF& polygon, const QList<QPolygonF>& decomposed);
+};
@@ -14,6 +14,9 @@
 #include "SettingsFact.h"
 #include "QGCLoggingCategory.h"
 
+#include <QAtomicInt>
+#include <QSharedPointer>
+
 Q_DECLARE_LOGGING_CATEGORY(SurveyComplexItemLog)
 
 class PlanMasterController;
@@ -26,6 +29,7 @@ public:
     /// @param flyView true: Created for use in the Fly View, false: Created for use in the Plan View
     /// @param kmlOrShpFile Polygon comes from this file, empty for default polygon
     SurveyComplexItem(PlanMasterController* masterController, bool flyView, const QString& kmlOrShpFile, QObject* parent);
+    ~SurveyComplexItem();
 
     Q_PROPERTY(Fact* gridAngle              READ gridAngle              CONSTANT)
     Q_PROPERTY(Fact* flyAlternateTransects  READ flyAlternateTransects  CONSTANT)
@@ -88,6 +92,8 @@ private slots:
     void _recalcCameraShots             (void) final;
 
 private:
+    friend class SurveyComplexItemTest;
+
     enum CameraTriggerCode {
         CameraTriggerNone,
         CameraTriggerOn,
@@ -95,21 +101,40 @@ private:
         CameraTriggerHoverAndCapture
     };
 
-    QPointF _rotatePoint(const QPointF& point, const QPointF& origin, double angle);
-    void _intersectLinesWithRect(const QList<QLineF>& lineList, const QRectF& boundRect, QList<QLineF>& resultLines);
-    void _intersectLinesWithPolygon(const QList<QLineF>& lineList, const QPolygonF& polygon, QList<QLineF>& resultLines);
-    void _adjustLineDirection(const QList<QLineF>& lineList, QList<QLineF>& resultLines);
+    typedef QList<QList<CoordInfo_t>> Transects_t;
+
+    /// Copy of everything transect generation reads from the item. The build runs on a worker thread against this
+    /// snapshot while the user keeps editing.
+    typedef struct {
+        QList<QGeoCoordinate>       polygon;
+        double                      gridAngle;
+        double                      gridSpacing;
+        int                         entryPoint;
+        bool                        flyAlternateTransects;
+        bool                        splitConcavePolygons;
+        bool                        refly90Degrees;
+        bool                        hoverAndCapture;        ///< Camera triggering with hover and capture, needs interior hover points
+        double                      triggerDistance;
+        bool                        hasTurnaround;
+        double                      turnAroundDistance;
+        QSharedPointer<QAtomicInt>  cancelled;              ///< Set once a newer build makes this one stale
+    } TransectBuildInputs_t;
+
+    static QPointF _rotatePoint(const QPointF& point, const QPointF& origin, double angle);
+    static void _intersectLinesWithRect(const QList<QLineF>& lineList, const QRectF& boundRect, QList<QLineF>& resultLines);
+    static void _intersectLinesWithPolygon(const TransectBuildInputs_t& inputs, const QList<QLineF>& lineList, const QPolygonF& polygon, QList<QLineF>& resultLines);
+    static void _adjustLineDirection(const QList<QLineF>& lineList, QList<QLineF>& resultLines);
     bool _nextTransectCoord(const QList<QGeoCoordinate>& transectPoints, int pointIndex, QGeoCoordinate& coord);
     bool _appendMissionItemsWorker(QList<MissionItem*>& items, QObject* missionItemParent, int& seqNum, bool hasRefly, bool buildRefly);
-    void _optimizeTransectsForShortestDistance(const QGeoCoordinate& distanceCoord, QList<QList<QGeoCoordinate>>& transects);
-    qreal _ccw(QPointF pt1, QPointF pt2, QPointF pt3);
-    qreal _dp(QPointF pt1, QPointF pt2);
-    void _swapPoints(QList<QPointF>& points, int index1, int index2);
-    void _reverseTransectOrder(QList<QList<QGeoCoordinate>>& transects);
-    void _reverseInternalTransectPoints(QList<QList<QGeoCoordinate>>& transects);
-    void _adjustTransectsToEntryPointLocation(QList<QList<QGeoCoordinate>>& transects);
+    static void _optimizeTransectsForShortestDistance(const QGeoCoordinate& distanceCoord, QList<QList<QGeoCoordinate>>& transects);
+    static qreal _ccw(QPointF pt1, QPointF pt2, QPointF pt3);
+    static qreal _dp(QPointF pt1, QPointF pt2);
+    static void _swapPoints(QList<QPointF>& points, int index1, int index2);
+    static void _reverseTransectOrder(QList<QList<QGeoCoordinate>>& transects);
+    static void _reverseInternalTransectPoints(QList<QList<QGeoCoordinate>>& transects);
+    static void _adjustTransectsToEntryPointLocation(int entryPoint, QList<QList<QGeoCoordinate>>& transects);
     bool _gridAngleIsNorthSouthTransects();
-    double _clampGridAngle90(double gridAngle);
+    static double _clampGridAngle90(double gridAngle);
     bool _imagesEverywhere(void) const;
     bool _triggerCamera(void) const;
     bool _hasTurnaround(void) const;
@@ -118,16 +143,19 @@ private:
     bool _loadV3(const QJsonObject& complexObject, int sequenceNumber, QString& errorString);
     bool _loadV4V5(const QJsonObject& complexObject, int sequenceNumber, QString& errorString, int version, bool forPresets);
     void _saveWorker(QJsonObject& complexObject);
-    void _rebuildTransectsPhase1Worker(bool refly);
-    void _rebuildTransectsPhase1WorkerSinglePolygon(bool refly);
-    void _rebuildTransectsPhase1WorkerSplitPolygons(bool refly);
-    /// Adds to the _transects array from one polygon
-    void _rebuildTransectsFromPolygon(bool refly, const QPolygonF& polygon, const QGeoCoordinate& tangentOrigin, const QPointF* const transitionPoint);
-    // Decompose polygon into list of convex sub polygons
-    void _PolygonDecomposeConvex(const QPolygonF& polygon, QList<QPolygonF>& decomposedPolygons);
-    // return true if vertex a can see vertex b
-    bool _VertexCanSeeOther(const QPolygonF& polygon, const QPointF* vertexA, const QPointF* vertexB);
-    bool _VertexIsReflex(const QPolygonF& polygon, const QPointF* vertex);
+    void _completePendingTransects(void) final;
+    TransectBuildInputs_t _transectBuildInputs(void) const;
+    void _cancelTransectBuild(void);
+    void _transectBuildFinished(int generation, const Transects_t& transects);
+    /// Builds the full set of transects (including refly) from the snapshot. Safe to call from any thread.
+    static Transects_t _buildTransects(const TransectBuildInputs_t& inputs);
+    static bool _buildCancelled(const TransectBuildInputs_t& inputs) { return inputs.cancelled && inputs.cancelled->loadAcquire(); }
+    static void _rebuildTransectsPhase1WorkerSinglePolygon(const TransectBuildInputs_t& inputs, bool refly, Transects_t& transects);
+    static void _rebuildTransectsPhase1WorkerSplitPolygons(const TransectBuildInputs_t& inputs, bool refly, Transects_t& transects);
+    /// Adds to the transects array from one polygon
+    static void _rebuildTransectsFromPolygon(const TransectBuildInputs_t& inputs, bool refly, const QPolygonF& polygon, const QGeoCoordinate& tangentOrigin, const QPointF* const transitionPoint, Transects_t& transects);
+    /// Converts transects to CoordInfo transects, adding hover and turnaround points, and appends them
+    static void _appendCoordInfoTransects(const TransectBuildInputs_t& inputs, const QList<QList<QGeoCoordinate>>& transects, Transects_t& coordInfoTransects);
 
     QMap<QString, FactMetaData*> _metaDataMap;
 
@@ -136,6 +164,9 @@ private:
     SettingsFact    _splitConcavePolygonsFact;
     int             _entryPoint;
 
+    int                         _transectBuildGeneration = 0;   ///< Results from any other generation are stale
+    QSharedPointer<QAtomicInt>  _transectBuildCancelled;        ///< Cancel flag of the build in flight
+
     static const char* _jsonGridAngleKey;
     static const char* _jsonEntryPointKey;
     static const char* _jsonFlyAlternateTransectsKey;
@@ -45,6 +45,7 @@ void SurveyComplexItemTest::init(void)
     _surveyItem->cameraCalc()->adjustedFootprintFrontal()->setRawValue(polyHeightDistance * 0.25);
 
     _surveyItem->gridAngle()->setRawValue(0);
+    _surveyItem->_completePendingTransects();
     int expectedTransectCount = _expectedTransectCount;
     QCOMPARE(_surveyItem->_transectCount(), expectedTransectCount);
 
@@ -96,6 +97,7 @@ void SurveyComplexItemTest::_testDirty(void)
         } else {
             fact->setRawValue(fact->rawValue().toDouble() + 1);
         }
+        _surveyItem->_completePendingTransects();
         QVERIFY(_multiSpy->checkSignalByMask(surveyDirtyChangedMask));
         QVERIFY(_multiSpy->pullBoolFromSignalIndex(surveyDirtyChangedIndex));
         _surveyItem->setDirty(false);
@@ -127,6 +129,7 @@ void SurveyComplexItemTest::_testGridAngle(void)
 {
     for (double gridAngle=-360.0; gridAngle<=360.0; gridAngle++) {
         _surveyItem->gridAngle()->setRawValue(gridAngle);
+        _surveyItem->_completePendingTransects();
 
         QVariantList gridPoints = _surveyItem->visualTransectPoints();
         QGeoCoordinate firstTransectEntry = gridPoints[0].value<QGeoCoordinate>();
@@ -148,6 +151,7 @@ void SurveyComplexItemTest::_testEntryLocation(void)
         QList<QGeoCoordinate> rgSeenEntryCoords;
         for (int rotateCount=0; rotateCount<3; rotateCount++) {
             _surveyItem->rotateEntryPoint();
+            _surveyItem->_completePendingTransects();
             QVERIFY(!rgSeenEntryCoords.contains(_surveyItem->coordinate()));
             rgSeenEntryCoords << _surveyItem->coordinate();
         }
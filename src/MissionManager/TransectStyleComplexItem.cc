@@ -42,6 +42,7 @@ TransectStyleComplexItem::TransectStyleComplexItem(PlanMasterController* masterC
     , _sequenceNumber                   (0)
     , _terrainPolyPathQuery             (nullptr)
     , _ignoreRecalc                     (false)
+    , _transectsPending                 (false)
     , _complexDistance                  (0)
     , _cameraShots                      (0)
     , _cameraCalc                       (masterController, settingsGroup)
@@ -134,6 +135,9 @@ void TransectStyleComplexItem::setDirty(bool dirty)
 
 void TransectStyleComplexItem::_save(QJsonObject& complexObject)
 {
+    // Visual transect points and mission items must match the current settings
+    _completePendingTransects();
+
     QJsonObject innerObject;
 
     innerObject[JsonHelper::jsonVersionKey] =       1;
@@ -356,6 +360,13 @@ void TransectStyleComplexItem::_rebuildTransects(void)
 
     _rebuildTransectsPhase1();
 
+    if (!_transectsPending) {
+        _rebuildTransectsPhase2();
+    }
+}
+
+void TransectStyleComplexItem::_rebuildTransectsPhase2(void)
+{
     if (_followTerrain) {
         // Query the terrain data. Once available terrain heights will be calculated
         _queryTransectsPathHeightInfo();
@@ -819,6 +830,8 @@ void TransectStyleComplexItem::_handleHoverAndCaptureEnabled(QVariant enabled)
 
 void TransectStyleComplexItem::appendMissionItems(QList<MissionItem*>& items, QObject* missionItemParent)
 {
+    _completePendingTransects();
+
     if (_loadedMissionItems.count()) {
         // We have mission items from the loaded plan, use those
         _appendLoadedMissionItems(items, missionItemParent);
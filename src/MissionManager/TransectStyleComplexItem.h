@@ -144,6 +144,9 @@ protected:
     virtual void _rebuildTransectsPhase1    (void) = 0; ///< Rebuilds the _transects array
     virtual void _recalcComplexDistance     (void) = 0;
     virtual void _recalcCameraShots         (void) = 0;
+    virtual void _completePendingTransects  (void) { } ///< Derived classes which build _transects in the background must finish the build here
+
+    void    _rebuildTransectsPhase2         (void); ///< Updates altitudes, visuals and stats from a new _transects array
 
     void    _save                           (QJsonObject& saveObject);
     bool    _load                           (const QJsonObject& complexObject, bool forPresets, QString& errorString);
@@ -186,6 +189,7 @@ protected:
     QTimer                                              _terrainQueryTimer;
 
     bool            _ignoreRecalc;
+    bool            _transectsPending;  ///< _transects is out of date, a new set is being built
     double          _complexDistance;
     int             _cameraShots;
     double          _timeBetweenShots;
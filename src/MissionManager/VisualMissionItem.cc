@@ -184,7 +184,7 @@ void VisualMissionItem::_reallyUpdateTerrainAltitude(void)
         connect(terrain, &TerrainAtCoordinateQuery::terrainDataReceived, this, &VisualMissionItem::_terrainDataReceived);
         QList<QGeoCoordinate> rgCoord;
         rgCoord.append(coordinate());
-        terrain->requestData(rgCoord);
+        terrain->requestData(rgCoord, isCurrentItem());
     }
 }
 
@@ -67,6 +67,7 @@ Rectangle {
                 ListElement { text: "1x";   value: 1 }
                 ListElement { text: "2x";   value: 2 }
                 ListElement { text: "5x";   value: 5 }
+                ListElement { text: qsTr("Max"); value: 0 }
             }
 
             onActivated: controller.playbackSpeed = model.get(currentIndex).value
@@ -98,6 +99,25 @@ Rectangle {
 
         QGCLabel { text: controller.totalTime }
 
+        QGCComboBox {
+            id:             eventCombo
+            textRole:       "text"
+            enabled:        controller.link
+
+            model: ListModel {
+                ListElement { text: qsTr("Arm/Disarm");     value: LogReplayLinkController.EventArmDisarm }
+                ListElement { text: qsTr("Mode Change");    value: LogReplayLinkController.EventModeChange }
+                ListElement { text: qsTr("Status Text");    value: LogReplayLinkController.EventStatusText }
+                ListElement { text: qsTr("Any Event");      value: LogReplayLinkController.EventAny }
+            }
+        }
+
+        QGCButton {
+            text:       qsTr("Next")
+            enabled:    controller.link
+            onClicked:  controller.jumpToNextEvent(eventCombo.model.get(eventCombo.currentIndex).value)
+        }
+
         QGCButton {
             text:       qsTr("Load Telemetry Log")
             onClicked:  pickLogFile()
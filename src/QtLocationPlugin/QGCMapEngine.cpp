@@ -44,6 +44,7 @@ struct stQGeoTileCacheQGCMapTypes {
 
 static const char* kMaxDiskCacheKey = "MaxDiskCache";
 static const char* kMaxMemCacheKey  = "MaxMemoryCache";
+static const char* kMaxTileMemCacheKey = "MaxTileMemoryCache";
 
 //-----------------------------------------------------------------------------
 // Singleton
@@ -66,7 +67,8 @@ destroyMapEngine()
 
 //-----------------------------------------------------------------------------
 QGCMapEngine::QGCMapEngine()
-    : _urlFactory(new UrlFactory())
+    : _memoryCache(0)
+    , _urlFactory(new UrlFactory())
 #ifdef WE_ARE_KOSHER
     //-- TODO: Get proper version
     #if defined Q_OS_MAC
@@ -87,6 +89,7 @@ QGCMapEngine::QGCMapEngine()
 #endif
     , _maxDiskCache(0)
     , _maxMemCache(0)
+    , _maxTileMemCache(0)
     , _prunning(false)
     , _cacheWasReset(false)
     , _isInternetActive(false)
@@ -165,6 +168,8 @@ QGCMapEngine::init()
     } else {
         qCritical() << "Could not find suitable map cache directory.";
     }
+    //-- Value saved in MB
+    _memoryCache.setMaxSize(static_cast<quint64>(getMaxTileMemCache()) * 1024 * 1024);
     QGCMapTask* task = new QGCMapTask(QGCMapTask::taskInit);
     _worker.enqueueTask(task);
 }
@@ -195,6 +200,10 @@ QGCMapEngine::_wipeDirectory(const QString& dirPath)
 void
 QGCMapEngine::addTask(QGCMapTask* task)
 {
+    //-- Resetting the cache must not leave tiles behind in memory
+    if(task->type() == QGCMapTask::taskReset) {
+        _memoryCache.clear();
+    }
     _worker.enqueueTask(task);
 }
 
@@ -210,6 +219,10 @@ QGCMapEngine::cacheTile(QString type, int x, int y, int z, const QByteArray& ima
 void
 QGCMapEngine::cacheTile(QString type, const QString& hash, const QByteArray& image, const QString& format, qulonglong set)
 {
+    //-- Tiles being downloaded for an offline set are not being looked at, keep them out of the memory cache
+    if(set == UINT64_MAX) {
+        _memoryCache.insert(hash, image, format);
+    }
     AppSettings* appSettings = qgcApp()->toolbox()->settingsManager()->appSettings();
     //-- If we are allowed to persist data, save tile to cache
     if(!appSettings->disableAllPersistence()->rawValue().toBool()) {
@@ -310,6 +323,37 @@ QGCMapEngine::setMaxMemCache(quint32 size)
     _maxMemCache = size;
 }
 
+//-----------------------------------------------------------------------------
+quint32
+QGCMapEngine::getMaxTileMemCache()
+{
+    if(!_maxTileMemCache) {
+        QSettings settings;
+#ifdef __mobile__
+        _maxTileMemCache = settings.value(kMaxTileMemCacheKey, 16).toUInt();
+#else
+        _maxTileMemCache = settings.value(kMaxTileMemCacheKey, 64).toUInt();
+#endif
+    }
+    //-- Size in MB
+    if(_maxTileMemCache > 1024)
+        _maxTileMemCache = 1024;
+    return _maxTileMemCache;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMapEngine::setMaxTileMemCache(quint32 size)
+{
+    //-- Size in MB
+    if(size > 1024)
+        size = 1024;
+    QSettings settings;
+    settings.setValue(kMaxTileMemCacheKey, size);
+    _maxTileMemCache = size;
+    _memoryCache.setMaxSize(static_cast<quint64>(size) * 1024 * 1024);
+}
+
 //-----------------------------------------------------------------------------
 QString
 QGCMapEngine::bigSizeToString(quint64 size)
@@ -24,6 +24,7 @@
 #include "QGCMapUrlEngine.h"
 #include "QGCMapEngineData.h"
 #include "QGCTileCacheWorker.h"
+#include "QGCTileMemoryCache.h"
 
 
 //-----------------------------------------------------------------------------
@@ -47,6 +48,8 @@ public:
     void                        setMaxDiskCache     (quint32 size);
     quint32                     getMaxMemCache      ();
     void                        setMaxMemCache      (quint32 size);
+    quint32                     getMaxTileMemCache  ();
+    void                        setMaxTileMemCache  (quint32 size);
     const QString               getCachePath        () { return _cachePath; }
     const QString               getCacheFilename    () { return _cacheFile; }
     void                        testInternet        ();
@@ -54,6 +57,7 @@ public:
     bool                        isInternetActive    () { return _isInternetActive; }
 
     UrlFactory*                 urlFactory          () { return _urlFactory; }
+    QGCTileMemoryCache*         memoryCache         () { return &_memoryCache; }
 
     //-- Tile Math
     static QGCTileSet           getTileCount        (int zoom, double topleftLon, double topleftLat, double bottomRightLon, double bottomRightLat, QString mapType);
@@ -80,12 +84,14 @@ private:
 
 private:
     QGCCacheWorker          _worker;
+    QGCTileMemoryCache      _memoryCache;
     QString                 _cachePath;
     QString                 _cacheFile;
     UrlFactory*             _urlFactory;
     QString                 _userAgent;
     quint32                 _maxDiskCache;
     quint32                 _maxMemCache;
+    quint32                 _maxTileMemCache;
     bool                    _prunning;
     bool                    _cacheWasReset;
     bool                    _isInternetActive;
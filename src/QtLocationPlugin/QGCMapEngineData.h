@@ -122,7 +122,8 @@ public:
         taskPruneCache,
         taskReset,
         taskExport,
-        taskImport
+        taskImport,
+        taskSaveDownloadedTiles
     };
 
     QGCMapTask(TaskType type)
@@ -253,31 +254,61 @@ private:
     QGCCacheTile*   _tile;
 };
 
+//-----------------------------------------------------------------------------
+// Tiles downloaded for a tile set. Saved and removed from the download list in one go.
+class QGCSaveDownloadedTilesTask : public QGCMapTask
+{
+    Q_OBJECT
+public:
+    QGCSaveDownloadedTilesTask(qulonglong setID, const QList<QGCCacheTile*>& tiles)
+        : QGCMapTask(QGCMapTask::taskSaveDownloadedTiles)
+        , _setID(setID)
+        , _tiles(tiles)
+    {}
+
+    ~QGCSaveDownloadedTilesTask()
+    {
+        qDeleteAll(_tiles);
+    }
+
+    qulonglong                  setID   () { return _setID; }
+    const QList<QGCCacheTile*>& tiles   () { return _tiles; }
+
+private:
+    qulonglong              _setID;
+    QList<QGCCacheTile*>    _tiles;
+};
+
 //-----------------------------------------------------------------------------
 class QGCGetTileDownloadListTask : public QGCMapTask
 {
     Q_OBJECT
 public:
-    QGCGetTileDownloadListTask(qulonglong setID, int count)
+    //-- Only tiles queued after fromRowID are returned, pass back the last row ID of the previous batch
+    //   to walk the download list without rescanning it.
+    QGCGetTileDownloadListTask(qulonglong setID, int count, qulonglong fromRowID = 0)
         : QGCMapTask(QGCMapTask::taskGetTileDownloadList)
         , _setID(setID)
         , _count(count)
+        , _fromRowID(fromRowID)
     {}
 
-    qulonglong  setID() { return _setID; }
-    int         count() { return _count; }
+    qulonglong  setID    () { return _setID; }
+    int         count    () { return _count; }
+    qulonglong  fromRowID() { return _fromRowID; }
 
-    void setTileListFetched(QList<QGCTile*> tiles)
+    void setTileListFetched(QList<QGCTile*> tiles, qulonglong lastRowID)
     {
-        emit tileListFetched(tiles);
+        emit tileListFetched(tiles, lastRowID);
     }
 
 signals:
-    void            tileListFetched  (QList<QGCTile*> tiles);
+    void            tileListFetched  (QList<QGCTile*> tiles, qulonglong lastRowID);
 
 private:
     qulonglong  _setID;
     int         _count;
+    qulonglong  _fromRowID;
 };
 
 //-----------------------------------------------------------------------------
@@ -19,14 +19,24 @@
 #include "QGCMapEngine.h"
 #include "QGCMapTileSet.h"
 #include "QGCMapEngineManager.h"
+#include "QGCTileDownloader.h"
 #include "TerrainTile.h"
+#include "QGCApplication.h"
+#include "AppSettings.h"
+#include "SettingsManager.h"
 
 #include <QSettings>
+#include <QtConcurrent>
 #include <math.h>
 
 QGC_LOGGING_CATEGORY(QGCCachedTileSetLog, "QGCCachedTileSetLog")
 
 #define TILE_BATCH_SIZE      256
+//-- Downloaded tiles are written out in batches of this size, or after this long
+#define SAVE_BATCH_SIZE      64
+#define SAVE_INTERVAL_MSECS  500
+//-- Validation is light work, keep it from taking over the global pool's worth of cores
+#define VALIDATION_THREADS   2
 
 //-----------------------------------------------------------------------------
 QGCCachedTileSet::QGCCachedTileSet(const QString& name)
@@ -50,17 +60,30 @@ QGCCachedTileSet::QGCCachedTileSet(const QString& name)
     , _type("Invalid")
     , _networkManager(nullptr)
     , _errorCount(0)
+    , _downloader(nullptr)
+    , _validating(0)
+    , _downloadGeneration(0)
+    , _downloadCursor(0)
     , _noMoreTiles(false)
     , _batchRequested(false)
     , _manager(nullptr)
     , _selected(false)
 {
-
+    _validationPool.setMaxThreadCount(VALIDATION_THREADS);
+    _saveTimer.setSingleShot(true);
+    _saveTimer.setInterval(SAVE_INTERVAL_MSECS);
+    connect(&_saveTimer, &QTimer::timeout, this, &QGCCachedTileSet::_flushSaves);
 }
 
 //-----------------------------------------------------------------------------
 QGCCachedTileSet::~QGCCachedTileSet()
 {
+    //-- Replies must go before their manager
+    delete _downloader;
+    _downloader = nullptr;
+    //-- Validation jobs post back to us
+    _validationPool.waitForDone();
+    qDeleteAll(_pendingSaves);
     delete _networkManager;
     _networkManager = nullptr;
 }
@@ -133,19 +156,30 @@ void
 QGCCachedTileSet::createDownloadTask()
 {
     if(!_downloading) {
-        _errorCount   = 0;
-        _downloading  = true;
-        _noMoreTiles  = false;
+        _errorCount     = 0;
+        _downloading    = true;
+        _noMoreTiles    = false;
+        //-- Completed tiles are gone from the download list, start from the top
+        _downloadCursor = 0;
         emit downloadingChanged();
         emit errorCountChanged();
     }
-    QGCGetTileDownloadListTask* task = new QGCGetTileDownloadListTask(_id, TILE_BATCH_SIZE);
+    emit totalTileCountChanged();
+    emit totalTilesSizeChanged();
+    if(!_batchRequested) {
+        _requestTileBatch();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCachedTileSet::_requestTileBatch()
+{
+    QGCGetTileDownloadListTask* task = new QGCGetTileDownloadListTask(_id, TILE_BATCH_SIZE, _downloadCursor);
     connect(task, &QGCGetTileDownloadListTask::tileListFetched, this, &QGCCachedTileSet::_tileListFetched);
     if(_manager)
         connect(task, &QGCMapTask::error, _manager, &QGCMapEngineManager::taskError);
     getQGCMapEngine()->addTask(task);
-    emit totalTileCountChanged();
-    emit totalTilesSizeChanged();
     _batchRequested = true;
 }
 
@@ -166,191 +200,198 @@ QGCCachedTileSet::cancelDownloadTask()
 {
     if(_downloading) {
         _downloading = false;
+        //-- Validations still running belong to the cancelled download, their tiles must not be saved
+        _downloadGeneration++;
+        //-- Tiles not yet saved are still pending in the download list and will be picked up on resume
+        if(_downloader) {
+            _downloader->cancel();
+        }
+        _flushSaves();
         emit downloadingChanged();
     }
 }
 
 //-----------------------------------------------------------------------------
 void
-QGCCachedTileSet::_tileListFetched(QList<QGCTile *> tiles)
+QGCCachedTileSet::_tileListFetched(QList<QGCTile *> tiles, qulonglong lastRowID)
 {
     _batchRequested = false;
+    if(!_downloading) {
+        qDeleteAll(tiles);
+        return;
+    }
+    _downloadCursor = lastRowID;
     //-- Done?
     if(tiles.size() < TILE_BATCH_SIZE) {
         _noMoreTiles = true;
     }
     if(!tiles.size()) {
-        _doneWithDownload();
+        _checkDone();
         return;
     }
     //-- If this is the first time, create Network Manager
     if (!_networkManager) {
         _networkManager = new QNetworkAccessManager(this);
     }
-    //-- Add tiles to the list
-    _tilesToDownload += tiles;
+    if(!_downloader) {
+        int concurrency = QGCMapEngine::concurrentDownloads(_type);
+        _downloader = new QGCTileDownloader(_type, concurrency, concurrency * 2, _networkManager,
+            [this](const QGCTile& tile) {
+                return getQGCMapEngine()->urlFactory()->getTileURL(tile.type(), tile.x(), tile.y(), tile.z(), _networkManager);
+            }, this);
+        connect(_downloader, &QGCTileDownloader::tileDownloaded,   this, &QGCCachedTileSet::_tileDownloaded);
+        connect(_downloader, &QGCTileDownloader::tileFailed,       this, &QGCCachedTileSet::_tileFailed);
+        connect(_downloader, &QGCTileDownloader::queueLow,         this, &QGCCachedTileSet::_downloadQueueLow);
+    }
     //-- Kick downloads
-    _prepareDownload();
+    _downloader->enqueue(tiles);
 }
 
 //-----------------------------------------------------------------------------
-void QGCCachedTileSet::_doneWithDownload()
+void
+QGCCachedTileSet::_downloadQueueLow()
 {
-    if(!_errorCount) {
-        _totalTileCount = _savedTileCount;
-        _totalTileSize  = _savedTileSize;
-        //-- Too expensive to compute the real size now. Estimate it for the time being.
-        quint32 avg;
-        if(_savedTileSize != 0){
-            avg = _savedTileSize / _savedTileCount;
-        }
-        else{
-            qWarning() << "QGCMapEngineManager::_doneWithDownload _savedTileSize=0 !";
-            avg = 0;
-        }
-
-        _uniqueTileSize = _uniqueTileCount * avg;
+    //-- Fetch the next batch while the current one is still downloading
+    if(_downloading && !_batchRequested && !_noMoreTiles) {
+        _requestTileBatch();
     }
-    emit totalTileCountChanged();
-    emit totalTilesSizeChanged();
-    emit savedTileSizeChanged();
-    emit savedTileCountChanged();
-    emit uniqueTileSizeChanged();
-    _downloading = false;
-    emit downloadingChanged();
-    emit completeChanged();
 }
 
 //-----------------------------------------------------------------------------
-void QGCCachedTileSet::_prepareDownload()
+void
+QGCCachedTileSet::_tileDownloaded(const QString& hash, const QByteArray& data)
 {
-    if(!_tilesToDownload.count()) {
-        //-- Are we done?
-        if(_noMoreTiles) {
-            _doneWithDownload();
-        } else {
-            if(!_batchRequested)
-                createDownloadTask();
-        }
+    qCDebug(QGCCachedTileSetLog) << "Tile fetched" << hash;
+    if(!_downloading) {
         return;
     }
-    //-- Prepare queue (QNetworkAccessManager has a limit for concurrent downloads)
-    for(int i = _replies.count(); i < QGCMapEngine::concurrentDownloads(_type); i++) {
-        if(_tilesToDownload.count()) {
-            QGCTile* tile = _tilesToDownload.first();
-            _tilesToDownload.removeFirst();
-            QNetworkRequest request = getQGCMapEngine()->urlFactory()->getTileURL(tile->type(), tile->x(), tile->y(), tile->z(), _networkManager);
-            request.setAttribute(QNetworkRequest::User, tile->hash());
-#if !defined(__mobile__)
-            QNetworkProxy proxy = _networkManager->proxy();
-            QNetworkProxy tProxy;
-            tProxy.setType(QNetworkProxy::DefaultProxy);
-            _networkManager->setProxy(tProxy);
-#endif
-            QNetworkReply* reply = _networkManager->get(request);
-            reply->setParent(0);
-            connect(reply, &QNetworkReply::finished, this, &QGCCachedTileSet::_networkReplyFinished);
-            connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error), this, &QGCCachedTileSet::_networkReplyError);
-            _replies.insert(tile->hash(), reply);
-#if !defined(__mobile__)
-            _networkManager->setProxy(proxy);
-#endif
-            delete tile;
-            //-- Refill queue if running low
-            if(!_batchRequested && !_noMoreTiles && _tilesToDownload.count() < (QGCMapEngine::concurrentDownloads(_type) * 10)) {
-                //-- Request new batch of tiles
-                createDownloadTask();
-            }
+    QString type = getQGCMapEngine()->hashToType(hash);
+    MapProvider* provider = getQGCMapEngine()->urlFactory()->getProviderTable().value(type, nullptr);
+    //-- Decoding elevation data and checking the image format run on the pool while the next tiles download
+    _validating++;
+    quint32 generation = _downloadGeneration;
+    QtConcurrent::run(&_validationPool, [this, provider, type, hash, data, generation]() {
+        QByteArray image = data;
+        if (type == "Airmap Elevation" ) {
+            image = TerrainTile::serialize(image);
         }
-    }
+        QString format = provider ? provider->getImageFormat(image) : QString();
+        QMetaObject::invokeMethod(this, [this, hash, type, image, format, generation]() {
+            _tileValidated(hash, type, image, format, generation);
+        }, Qt::QueuedConnection);
+    });
 }
 
 //-----------------------------------------------------------------------------
 void
-QGCCachedTileSet::_networkReplyFinished()
+QGCCachedTileSet::_tileValidated(const QString& hash, const QString& type, const QByteArray& image, const QString& format, quint32 generation)
 {
-    //-- Figure out which reply this is
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
-    if(!reply) {
-        qWarning() << "QGCMapEngineManager::networkReplyFinished() NULL Reply";
+    _validating--;
+    if(generation != _downloadGeneration) {
+        //-- Download was cancelled since, the tile is still pending in the download list
+        _checkDone();
         return;
     }
-    if (reply->error() == QNetworkReply::NoError) {
-        //-- Get tile hash
-        const QString hash = reply->request().attribute(QNetworkRequest::User).toString();
-        if(!hash.isEmpty()) {
-            if(_replies.contains(hash)) {
-                _replies.remove(hash);
-            } else {
-                qWarning() << "QGCMapEngineManager::networkReplyFinished() Reply not in list: " << hash;
-            }
-            qCDebug(QGCCachedTileSetLog) << "Tile fetched" << hash;
-            QByteArray image = reply->readAll();
-            QString type = getQGCMapEngine()->hashToType(hash);
-            if (type == "Airmap Elevation" ) {
-                image = TerrainTile::serialize(image);
-            }
-            QString format = getQGCMapEngine()->urlFactory()->getImageFormat(type, image);
-            if(!format.isEmpty()) {
-                //-- Cache tile
-                getQGCMapEngine()->cacheTile(type, hash, image, format, _id);
-                QGCUpdateTileDownloadStateTask* task = new QGCUpdateTileDownloadStateTask(_id, QGCTile::StateComplete, hash);
-                getQGCMapEngine()->addTask(task);
-                //-- Updated cached (downloaded) data
-                _savedTileSize += image.size();
-                _savedTileCount++;
-                emit savedTileSizeChanged();
-                emit savedTileCountChanged();
-                //-- Update estimate
-                if(_savedTileCount % 10 == 0) {
-                    quint32 avg = _savedTileSize / _savedTileCount;
-                    _totalTileSize  = avg * _totalTileCount;
-                    _uniqueTileSize = avg * _uniqueTileCount;
-                    emit totalTilesSizeChanged();
-                    emit uniqueTileSizeChanged();
-                }
-            }
-            //-- Setup a new download
-            _prepareDownload();
-        } else {
-            qWarning() << "QGCMapEngineManager::networkReplyFinished() Empty Hash";
-        }
+    if(format.isEmpty()) {
+        //-- Not something we can display (an error page for instance)
+        _tileFailed(hash, tr("Unknown tile format"));
+        return;
+    }
+    _pendingSaves.append(new QGCCacheTile(hash, image, format, type, _id));
+    if(_pendingSaves.count() >= SAVE_BATCH_SIZE) {
+        _flushSaves();
+    } else if(!_saveTimer.isActive()) {
+        _saveTimer.start();
+    }
+    //-- Updated cached (downloaded) data
+    _savedTileSize += image.size();
+    _savedTileCount++;
+    emit savedTileSizeChanged();
+    emit savedTileCountChanged();
+    //-- Update estimate
+    if(_savedTileCount % 10 == 0) {
+        quint32 avg = _savedTileSize / _savedTileCount;
+        _totalTileSize  = avg * _totalTileCount;
+        _uniqueTileSize = avg * _uniqueTileCount;
+        emit totalTilesSizeChanged();
+        emit uniqueTileSizeChanged();
     }
-    reply->deleteLater();
+    _checkDone();
 }
 
 //-----------------------------------------------------------------------------
 void
-QGCCachedTileSet::_networkReplyError(QNetworkReply::NetworkError error)
+QGCCachedTileSet::_tileFailed(const QString& hash, const QString& errorString)
 {
-    //-- Figure out which reply this is
-    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
-    if (!reply) {
-        return;
-    }
+    qWarning() << "QGCCachedTileSet::_tileFailed() Error:" << hash << errorString;
     //-- Update error count
     _errorCount++;
     emit errorCountChanged();
-    //-- Get tile hash
-    QString hash = reply->request().attribute(QNetworkRequest::User).toString();
-    qCDebug(QGCCachedTileSetLog) << "Error fetching tile" << reply->errorString();
-    if(!hash.isEmpty()) {
-        if(_replies.contains(hash)) {
-            _replies.remove(hash);
-        } else {
-            qWarning() << "QGCMapEngineManager::networkReplyError() Reply not in list: " << hash;
+    QGCUpdateTileDownloadStateTask* task = new QGCUpdateTileDownloadStateTask(_id, QGCTile::StateError, hash);
+    getQGCMapEngine()->addTask(task);
+    _checkDone();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCachedTileSet::_flushSaves()
+{
+    _saveTimer.stop();
+    if(_pendingSaves.isEmpty()) {
+        return;
+    }
+    AppSettings* appSettings = qgcApp()->toolbox()->settingsManager()->appSettings();
+    if(appSettings->disableAllPersistence()->rawValue().toBool()) {
+        //-- Not allowed to keep the tiles, only mark them done in the download list
+        for(QGCCacheTile* tile : _pendingSaves) {
+            getQGCMapEngine()->addTask(new QGCUpdateTileDownloadStateTask(_id, QGCTile::StateComplete, tile->hash()));
         }
-        if (error != QNetworkReply::OperationCanceledError) {
-            qWarning() << "QGCMapEngineManager::networkReplyError() Error:" << reply->errorString();
+        qDeleteAll(_pendingSaves);
+        _pendingSaves.clear();
+        return;
+    }
+    //-- One task saves the whole batch and removes it from the download list in a single transaction
+    QGCSaveDownloadedTilesTask* task = new QGCSaveDownloadedTilesTask(_id, _pendingSaves);
+    _pendingSaves.clear();
+    getQGCMapEngine()->addTask(task);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCachedTileSet::_checkDone()
+{
+    if(_downloading && _noMoreTiles && !_batchRequested && !_validating && (!_downloader || _downloader->idle())) {
+        _flushSaves();
+        _doneWithDownload();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void QGCCachedTileSet::_doneWithDownload()
+{
+    if(!_errorCount) {
+        _totalTileCount = _savedTileCount;
+        _totalTileSize  = _savedTileSize;
+        //-- Too expensive to compute the real size now. Estimate it for the time being.
+        quint32 avg;
+        if(_savedTileSize != 0){
+            avg = _savedTileSize / _savedTileCount;
         }
-        QGCUpdateTileDownloadStateTask* task = new QGCUpdateTileDownloadStateTask(_id, QGCTile::StateError, hash);
-        getQGCMapEngine()->addTask(task);
-    } else {
-        qWarning() << "QGCMapEngineManager::networkReplyError() Empty Hash";
+        else{
+            qWarning() << "QGCMapEngineManager::_doneWithDownload _savedTileSize=0 !";
+            avg = 0;
+        }
+
+        _uniqueTileSize = _uniqueTileCount * avg;
     }
-    //-- Setup a new download
-    _prepareDownload();
-    reply->deleteLater();
+    emit totalTileCountChanged();
+    emit totalTilesSizeChanged();
+    emit savedTileSizeChanged();
+    emit savedTileCountChanged();
+    emit uniqueTileSizeChanged();
+    _downloading = false;
+    emit downloadingChanged();
+    emit completeChanged();
 }
 
 //-----------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 #include <QHash>
 #include <QDateTime>
 #include <QImage>
+#include <QTimer>
+#include <QThreadPool>
 
 #include "QGCLoggingCategory.h"
 #include "QGCMapEngineData.h"
@@ -32,7 +34,9 @@
 Q_DECLARE_LOGGING_CATEGORY(QGCCachedTileSetLog)
 
 class QGCTile;
+class QGCCacheTile;
 class QGCMapEngineManager;
+class QGCTileDownloader;
 
 //-----------------------------------------------------------------------------
 class QGCCachedTileSet : public QObject
@@ -150,12 +154,16 @@ signals:
     void        nameChanged             ();
 
 private slots:
-    void _tileListFetched               (QList<QGCTile*> tiles);
-    void _networkReplyFinished          ();
-    void _networkReplyError             (QNetworkReply::NetworkError error);
+    void _tileListFetched               (QList<QGCTile*> tiles, qulonglong lastRowID);
+    void _tileDownloaded                (const QString& hash, const QByteArray& data);
+    void _tileFailed                    (const QString& hash, const QString& errorString);
+    void _downloadQueueLow              ();
+    void _flushSaves                    ();
 
 private:
-    void        _prepareDownload        ();
+    void        _requestTileBatch       ();
+    void        _tileValidated          (const QString& hash, const QString& type, const QByteArray& image, const QString& format, quint32 generation);
+    void        _checkDone              ();
     void        _doneWithDownload       ();
 
 private:
@@ -180,10 +188,15 @@ private:
     quint64     _id;
     QString _type;
     QNetworkAccessManager*  _networkManager;
-    QHash<QString, QNetworkReply*> _replies;
     quint32     _errorCount;
-    //-- Tile download
-    QList<QGCTile *> _tilesToDownload;
+    //-- Tile download pipeline: download list -> network -> validation -> batched save
+    QGCTileDownloader*      _downloader;
+    QThreadPool             _validationPool;
+    int                     _validating;            ///< Tiles handed to the validation pool
+    quint32                 _downloadGeneration;    ///< Bumped on cancel so validations of the cancelled download are dropped
+    QList<QGCCacheTile*>    _pendingSaves;
+    QTimer                  _saveTimer;
+    qulonglong              _downloadCursor;        ///< Last TilesDownload row handed out
     bool        _noMoreTiles;
     bool        _batchRequested;
     QGCMapEngineManager* _manager;
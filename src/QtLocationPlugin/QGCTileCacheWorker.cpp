@@ -26,11 +26,13 @@
 #include <QDateTime>
 #include <QApplication>
 #include <QFile>
+#include <QFileInfo>
+
+#include <climits>
 
 #include "time.h"
 
 static const char*      kDefaultSet     = "Default Tile Set";
-static const QString    kSession        = QStringLiteral("QGeoTileWorkerSession");
 static const QString    kExportSession  = QStringLiteral("QGeoTileExportSession");
 
 QGC_LOGGING_CATEGORY(QGCTileCacheLog, "QGCTileCacheLog")
@@ -40,9 +42,16 @@ QGC_LOGGING_CATEGORY(QGCTileCacheLog, "QGCTileCacheLog")
 #define LONG_TIMEOUT        5
 #define SHORT_TIMEOUT       2
 
+//-- Maximum number of tasks coalesced into a single write transaction
+#define MAX_BATCH_TASKS     512
+//-- Import/export copies tiles in ranges of this many tile IDs, one transaction each
+#define BULK_CHUNK_SIZE     4096
+
 //-----------------------------------------------------------------------------
 QGCCacheWorker::QGCCacheWorker()
-    : _db(nullptr)
+    //-- One connection per worker so a second worker (a test for instance) can't take over ours
+    : _session(QStringLiteral("QGeoTileWorkerSession_%1").arg(reinterpret_cast<quintptr>(this), 0, 16))
+    , _db(nullptr)
     , _valid(false)
     , _failed(false)
     , _defaultSet(UINT64_MAX)
@@ -53,6 +62,9 @@ QGCCacheWorker::QGCCacheWorker()
     , _lastUpdate(0)
     , _updateTimeout(SHORT_TIMEOUT)
     , _hostLookupID(0)
+    , _totalsValid(false)
+    , _inBatch(false)
+    , _batchTasks(0)
 {
 }
 
@@ -115,10 +127,7 @@ QGCCacheWorker::run()
         _init();
     }
     if(_valid) {
-        _db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kSession));
-        _db->setDatabaseName(_databasePath);
-        _db->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        _valid = _db->open();
+        _valid = _openDB();
     }
     while(true) {
         QGCMapTask* task;
@@ -126,12 +135,33 @@ QGCCacheWorker::run()
             _mutex.lock();
             task = _taskQueue.dequeue();
             _mutex.unlock();
+            //-- Tile saves and download state updates come in bursts while downloading. Coalesce them
+            //   into a single transaction instead of paying for a journal sync on each one.
+            switch(task->type()) {
+                case QGCMapTask::taskCacheTile:
+                case QGCMapTask::taskSaveDownloadedTiles:
+                case QGCMapTask::taskUpdateTileDownloadState:
+                case QGCMapTask::taskGetTileDownloadList:
+                    _beginBatch();
+                    break;
+                case QGCMapTask::taskInit:
+                case QGCMapTask::taskFetchTile:
+                case QGCMapTask::taskTestInternet:
+                    //-- Reads see the batch's uncommitted writes on this connection, no need to break it up
+                    break;
+                default:
+                    _commitBatch();
+                    break;
+            }
             switch(task->type()) {
                 case QGCMapTask::taskInit:
                     break;
                 case QGCMapTask::taskCacheTile:
                     _saveTile(task);
                     break;
+                case QGCMapTask::taskSaveDownloadedTiles:
+                    _saveDownloadedTiles(task);
+                    break;
                 case QGCMapTask::taskFetchTile:
                     _getTile(task);
                     break;
@@ -172,6 +202,9 @@ QGCCacheWorker::run()
             task->deleteLater();
             //-- Check for update timeout
             size_t count = static_cast<size_t>(_taskQueue.count());
+            if(_inBatch && (!count || ++_batchTasks >= MAX_BATCH_TASKS)) {
+                _commitBatch();
+            }
             if(count > 100) {
                 _updateTimeout = LONG_TIMEOUT;
             } else if(count < 25) {
@@ -197,12 +230,95 @@ QGCCacheWorker::run()
             _mutex.unlock();
         }
     }
+    _closeDB();
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::_openDB()
+{
+    _db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", _session));
+    _db->setDatabaseName(_databasePath);
+    _db->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
+    if(!_db->open()) {
+        qCritical() << "Map Cache SQL error (open db):" << _db->lastError();
+        return false;
+    }
+    //-- WAL lets readers proceed while we write and turns each commit into a sequential append
+    QSqlQuery query(*_db);
+    if(!query.exec("PRAGMA journal_mode=WAL")) {
+        qWarning() << "Map Cache SQL error (enable WAL):" << query.lastError().text();
+    }
+    //-- With WAL, NORMAL only risks losing the last commits on power loss, never corruption
+    query.exec("PRAGMA synchronous=NORMAL");
+    _totalsValid = false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_closeDB()
+{
     if(_db) {
+        _commitBatch();
+        //-- Prepared statements hold on to the connection
+        _clearStatements();
         delete _db;
         _db = nullptr;
-        QSqlDatabase::removeDatabase(kSession);
+        QSqlDatabase::removeDatabase(_session);
     }
 }
+
+//-----------------------------------------------------------------------------
+// Returns a prepared statement for the given SQL, preparing it on first use. Statements are keyed by
+// their SQL text so identical SQL shares one statement regardless of where the string lives.
+QSqlQuery*
+QGCCacheWorker::_prepared(const char* sql)
+{
+    //-- Look up without copying the SQL, only a new statement needs its own key
+    QByteArray key = QByteArray::fromRawData(sql, static_cast<int>(qstrlen(sql)));
+    QSqlQuery* query = _statements.value(key, nullptr);
+    if(!query) {
+        query = new QSqlQuery(*_db);
+        if(!query->prepare(sql)) {
+            qWarning() << "Map Cache SQL error (prepare):" << sql << query->lastError().text();
+        }
+        _statements.insert(QByteArray(sql), query);
+    }
+    return query;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_clearStatements()
+{
+    qDeleteAll(_statements);
+    _statements.clear();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_beginBatch()
+{
+    if(!_inBatch && _valid && _db) {
+        _inBatch = _db->transaction();
+        _batchTasks = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_commitBatch()
+{
+    if(_inBatch) {
+        _inBatch = false;
+        if(!_db->commit()) {
+            qWarning() << "Map Cache SQL error (commit batch):" << _db->lastError().text();
+        }
+        qCDebug(QGCTileCacheLog) << "_commitBatch() tasks:" << _batchTasks;
+    }
+}
+
 //-----------------------------------------------------------------------------
 bool
 QGCCacheWorker::_findTileSetID(const QString name, quint64& setID)
@@ -241,21 +357,29 @@ QGCCacheWorker::_saveTile(QGCMapTask *mtask)
 {
     if(_valid) {
         QGCSaveTileTask* task = static_cast<QGCSaveTileTask*>(mtask);
-        QSqlQuery query(*_db);
-        query.prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
-        query.addBindValue(task->tile()->hash());
-        query.addBindValue(task->tile()->format());
-        query.addBindValue(task->tile()->img());
-        query.addBindValue(task->tile()->img().size());
-        query.addBindValue(task->tile()->type());
-        query.addBindValue(QDateTime::currentDateTime().toTime_t());
-        if(query.exec()) {
-            quint64 tileID = query.lastInsertId().toULongLong();
+        QSqlQuery* query = _prepared("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
+        query->addBindValue(task->tile()->hash());
+        query->addBindValue(task->tile()->format());
+        query->addBindValue(task->tile()->img());
+        query->addBindValue(task->tile()->img().size());
+        query->addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(task->tile()->type()));
+        query->addBindValue(QDateTime::currentDateTime().toTime_t());
+        if(query->exec()) {
+            quint64 tileID = query->lastInsertId().toULongLong();
             quint64 setID = task->tile()->set() == UINT64_MAX ? _getDefaultTileSet() : task->tile()->set();
-            QString s = QString("INSERT INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(tileID).arg(setID);
-            query.prepare(s);
-            if(!query.exec()) {
-                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << query.lastError().text();
+            QSqlQuery* setQuery = _prepared("INSERT INTO SetTiles(tileID, setID) VALUES(?, ?)");
+            setQuery->addBindValue(tileID);
+            setQuery->addBindValue(setID);
+            if(!setQuery->exec()) {
+                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << setQuery->lastError().text();
+            }
+            //-- A new tile only belongs to the set it was saved in
+            quint64 size = static_cast<quint64>(task->tile()->img().size());
+            _totalCount++;
+            _totalSize += size;
+            if(setID == _getDefaultTileSet()) {
+                _defaultCount++;
+                _defaultSize += size;
             }
             qCDebug(QGCTileCacheLog) << "_saveTile() HASH:" << task->tile()->hash();
         } else {
@@ -267,6 +391,54 @@ QGCCacheWorker::_saveTile(QGCMapTask *mtask)
     }
 }
 
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_saveDownloadedTiles(QGCMapTask* mtask)
+{
+    if(!_valid) {
+        qWarning() << "Map Cache SQL error (saveDownloadedTiles() open db):" << _db->lastError();
+        return;
+    }
+    QGCSaveDownloadedTilesTask* task = static_cast<QGCSaveDownloadedTilesTask*>(mtask);
+    QSqlQuery* tileQuery     = _prepared("INSERT OR IGNORE INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
+    QSqlQuery* setQuery      = _prepared("INSERT INTO SetTiles(tileID, setID) VALUES(?, ?)");
+    QSqlQuery* downloadQuery = _prepared("DELETE FROM TilesDownload WHERE setID = ? AND hash = ?");
+    uint now = QDateTime::currentDateTime().toTime_t();
+    for(QGCCacheTile* tile: task->tiles()) {
+        tileQuery->addBindValue(tile->hash());
+        tileQuery->addBindValue(tile->format());
+        tileQuery->addBindValue(tile->img());
+        tileQuery->addBindValue(tile->img().size());
+        tileQuery->addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(tile->type()));
+        tileQuery->addBindValue(now);
+        if(!tileQuery->exec()) {
+            qWarning() << "Map Cache SQL error (saveDownloadedTiles() Insert):" << tileQuery->lastError().text();
+            continue;
+        }
+        quint64 tileID;
+        if(tileQuery->numRowsAffected() > 0) {
+            tileID = tileQuery->lastInsertId().toULongLong();
+            _totalCount++;
+            _totalSize += static_cast<quint64>(tile->img().size());
+        } else {
+            //-- Someone else got it in the meantime (browsing the map for instance)
+            _totalsValid = false;
+            tileID = _findTile(tile->hash());
+        }
+        setQuery->addBindValue(tileID);
+        setQuery->addBindValue(task->setID());
+        if(!setQuery->exec()) {
+            qWarning() << "Map Cache SQL error (add tile into SetTiles):" << setQuery->lastError().text();
+        }
+        downloadQuery->addBindValue(task->setID());
+        downloadQuery->addBindValue(tile->hash());
+        if(!downloadQuery->exec()) {
+            qWarning() << "Map Cache SQL error (remove tile from TilesDownload):" << downloadQuery->lastError().text();
+        }
+    }
+    qCDebug(QGCTileCacheLog) << "_saveDownloadedTiles() count:" << task->tiles().count();
+}
+
 //-----------------------------------------------------------------------------
 void
 QGCCacheWorker::_getTile(QGCMapTask* mtask)
@@ -276,18 +448,20 @@ QGCCacheWorker::_getTile(QGCMapTask* mtask)
     }
     bool found = false;
     QGCFetchTileTask* task = static_cast<QGCFetchTileTask*>(mtask);
-    QSqlQuery query(*_db);
-    QString s = QString("SELECT tile, format, type FROM Tiles WHERE hash = \"%1\"").arg(task->hash());
-    if(query.exec(s)) {
-        if(query.next()) {
-            QByteArray ar   = query.value(0).toByteArray();
-            QString format  = query.value(1).toString();
-            QString type = getQGCMapEngine()->urlFactory()->getTypeFromId(query.value(2).toInt());
+    QSqlQuery* query = _prepared("SELECT tile, format, type FROM Tiles WHERE hash = ?");
+    query->addBindValue(task->hash());
+    if(query->exec()) {
+        if(query->next()) {
+            QByteArray ar   = query->value(0).toByteArray();
+            QString format  = query->value(1).toString();
+            QString type = getQGCMapEngine()->urlFactory()->getTypeFromId(query->value(2).toInt());
             qCDebug(QGCTileCacheLog) << "_getTile() (Found in DB) HASH:" << task->hash();
             QGCCacheTile* tile = new QGCCacheTile(task->hash(), ar, format, type);
             task->setTileFetched(tile);
             found = true;
         }
+        //-- Reset the statement so it doesn't hold a read lock until its next use
+        query->finish();
     }
     if(!found) {
         qCDebug(QGCTileCacheLog) << "_getTile() (NOT in DB) HASH:" << task->hash();
@@ -391,6 +565,18 @@ QGCCacheWorker::_updateSetTotals(QGCCachedTileSet* set)
 //-----------------------------------------------------------------------------
 void
 QGCCacheWorker::_updateTotals()
+{
+    //-- Totals are maintained incrementally, only operations which touch many sets at once force a recompute
+    if(!_totalsValid) {
+        _computeTotals();
+    }
+    emit updateTotals(_totalCount, _totalSize, _defaultCount, _defaultSize);
+    _lastUpdate = time(nullptr);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_computeTotals()
 {
     QSqlQuery query(*_db);
     QString s;
@@ -410,20 +596,20 @@ QGCCacheWorker::_updateTotals()
             _defaultSize  = query.value(1).toULongLong();
         }
     }
-    emit updateTotals(_totalCount, _totalSize, _defaultCount, _defaultSize);
-    _lastUpdate = time(nullptr);
+    _totalsValid = true;
 }
 
 //-----------------------------------------------------------------------------
 quint64 QGCCacheWorker::_findTile(const QString hash)
 {
     quint64 tileID = 0;
-    QSqlQuery query(*_db);
-    QString s = QString("SELECT tileID FROM Tiles WHERE hash = \"%1\"").arg(hash);
-    if(query.exec(s)) {
-        if(query.next()) {
-            tileID = query.value(0).toULongLong();
+    QSqlQuery* query = _prepared("SELECT tileID FROM Tiles WHERE hash = ?");
+    query->addBindValue(hash);
+    if(query->exec()) {
+        if(query->next()) {
+            tileID = query->value(0).toULongLong();
         }
+        query->finish();
     }
     return tileID;
 }
@@ -473,26 +659,28 @@ QGCCacheWorker::_createTileSet(QGCMapTask *mtask)
                         quint64 tileID = _findTile(hash);
                         if(!tileID) {
                             //-- Set to download
-                            query.prepare("INSERT OR IGNORE INTO TilesDownload(setID, hash, type, x, y, z, state) VALUES(?, ?, ?, ?, ? ,? ,?)");
-                            query.addBindValue(setID);
-                            query.addBindValue(hash);
-                            query.addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(type));
-                            query.addBindValue(x);
-                            query.addBindValue(y);
-                            query.addBindValue(z);
-                            query.addBindValue(0);
-                            if(!query.exec()) {
-                                qWarning() << "Map Cache SQL error (add tile into TilesDownload):" << query.lastError().text();
+                            QSqlQuery* downloadQuery = _prepared("INSERT OR IGNORE INTO TilesDownload(setID, hash, type, x, y, z, state) VALUES(?, ?, ?, ?, ? ,? ,?)");
+                            downloadQuery->addBindValue(setID);
+                            downloadQuery->addBindValue(hash);
+                            downloadQuery->addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(type));
+                            downloadQuery->addBindValue(x);
+                            downloadQuery->addBindValue(y);
+                            downloadQuery->addBindValue(z);
+                            downloadQuery->addBindValue(0);
+                            if(!downloadQuery->exec()) {
+                                qWarning() << "Map Cache SQL error (add tile into TilesDownload):" << downloadQuery->lastError().text();
+                                _db->rollback();
                                 mtask->setError("Error creating tile set download list");
                                 return;
                             } else
                                 actual_count++;
                         } else {
                             //-- Tile already in the database. No need to dowload.
-                            QString s = QString("INSERT OR IGNORE INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(tileID).arg(setID);
-                            query.prepare(s);
-                            if(!query.exec()) {
-                                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << query.lastError().text();
+                            QSqlQuery* setQuery = _prepared("INSERT OR IGNORE INTO SetTiles(tileID, setID) VALUES(?, ?)");
+                            setQuery->addBindValue(tileID);
+                            setQuery->addBindValue(setID);
+                            if(!setQuery->exec()) {
+                                qWarning() << "Map Cache SQL error (add tile into SetTiles):" << setQuery->lastError().text();
                             }
                             qCDebug(QGCTileCacheLog) << "_createTileSet() Already Cached HASH:" << hash;
                         }
@@ -500,6 +688,8 @@ QGCCacheWorker::_createTileSet(QGCMapTask *mtask)
                 }
             }
             _db->commit();
+            //-- Tiles shared with the new set are no longer unique to the default set
+            _totalsValid = false;
             //-- Done
             _updateSetTotals(task->tileSet());
             task->setTileSetSaved();
@@ -518,26 +708,27 @@ QGCCacheWorker::_getTileDownloadList(QGCMapTask* mtask)
     }
     QList<QGCTile*> tiles;
     QGCGetTileDownloadListTask* task = static_cast<QGCGetTileDownloadListTask*>(mtask);
-    QSqlQuery query(*_db);
-    QString s = QString("SELECT hash, type, x, y, z FROM TilesDownload WHERE setID = %1 AND state = 0 LIMIT %2").arg(task->setID()).arg(task->count());
-    if(query.exec(s)) {
-        while(query.next()) {
+    qulonglong lastRowID = task->fromRowID();
+    //-- Walk the list by row ID. Tiles handed out stay pending until saved, so an interrupted download
+    //   picks them up again without having to reset their state.
+    QSqlQuery* query = _prepared("SELECT rowid, hash, type, x, y, z FROM TilesDownload WHERE setID = ? AND state = 0 AND rowid > ? ORDER BY rowid LIMIT ?");
+    query->addBindValue(task->setID());
+    query->addBindValue(task->fromRowID());
+    query->addBindValue(task->count());
+    if(query->exec()) {
+        while(query->next()) {
             QGCTile* tile = new QGCTile;
-            tile->setHash(query.value("hash").toString());
-            tile->setType(getQGCMapEngine()->urlFactory()->getTypeFromId(query.value("type").toInt()));
-            tile->setX(query.value("x").toInt());
-            tile->setY(query.value("y").toInt());
-            tile->setZ(query.value("z").toInt());
+            lastRowID = query->value(0).toULongLong();
+            tile->setHash(query->value(1).toString());
+            tile->setType(getQGCMapEngine()->urlFactory()->getTypeFromId(query->value(2).toInt()));
+            tile->setX(query->value(3).toInt());
+            tile->setY(query->value(4).toInt());
+            tile->setZ(query->value(5).toInt());
             tiles.append(tile);
         }
-        for(int i = 0; i < tiles.size(); i++) {
-            s = QString("UPDATE TilesDownload SET state = %1 WHERE setID = %2 and hash = \"%3\"").arg(static_cast<int>(QGCTile::StateDownloading)).arg(task->setID()).arg(tiles[i]->hash());
-            if(!query.exec(s)) {
-                qWarning() << "Map Cache SQL error (set TilesDownload state):" << query.lastError().text();
-            }
-        }
+        query->finish();
     }
-    task->setTileListFetched(tiles);
+    task->setTileListFetched(tiles, lastRowID);
 }
 
 //-----------------------------------------------------------------------------
@@ -548,19 +739,27 @@ QGCCacheWorker::_updateTileDownloadState(QGCMapTask* mtask)
         return;
     }
     QGCUpdateTileDownloadStateTask* task = static_cast<QGCUpdateTileDownloadStateTask*>(mtask);
-    QSqlQuery query(*_db);
-    QString s;
+    QSqlQuery* query;
     if(task->state() == QGCTile::StateComplete) {
-        s = QString("DELETE FROM TilesDownload WHERE setID = %1 AND hash = \"%2\"").arg(task->setID()).arg(task->hash());
+        query = _prepared("DELETE FROM TilesDownload WHERE setID = ? AND hash = ?");
+        query->addBindValue(task->setID());
+        query->addBindValue(task->hash());
     } else {
         if(task->hash() == "*") {
-            s = QString("UPDATE TilesDownload SET state = %1 WHERE setID = %2").arg(static_cast<int>(task->state())).arg(task->setID());
+            //-- Only touch the rows that change, this runs on every resume
+            query = _prepared("UPDATE TilesDownload SET state = ? WHERE setID = ? AND state <> ?");
+            query->addBindValue(static_cast<int>(task->state()));
+            query->addBindValue(task->setID());
+            query->addBindValue(static_cast<int>(task->state()));
         } else {
-            s = QString("UPDATE TilesDownload SET state = %1 WHERE setID = %2 AND hash = \"%3\"").arg(static_cast<int>(task->state())).arg(task->setID()).arg(task->hash());
+            query = _prepared("UPDATE TilesDownload SET state = ? WHERE setID = ? AND hash = ?");
+            query->addBindValue(static_cast<int>(task->state()));
+            query->addBindValue(task->setID());
+            query->addBindValue(task->hash());
         }
     }
-    if(!query.exec(s)) {
-        qWarning() << "QGCCacheWorker::_updateTileDownloadState() Error:" << query.lastError().text();
+    if(!query->exec()) {
+        qWarning() << "QGCCacheWorker::_updateTileDownloadState() Error:" << query->lastError().text();
     }
 }
 
@@ -578,18 +777,32 @@ QGCCacheWorker::_pruneCache(QGCMapTask* mtask)
     s = QString("SELECT tileID, size, hash FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A join SetTiles B on A.tileID = B.tileID WHERE B.setID = %1 GROUP by A.tileID HAVING COUNT(A.tileID) = 1) ORDER BY DATE ASC LIMIT 128").arg(_getDefaultTileSet());
     qint64 amount = (qint64)task->amount();
     QList<quint64> tlist;
+    QList<quint64> slist;
+    QStringList    hlist;
     if(query.exec(s)) {
         while(query.next() && amount >= 0) {
             tlist << query.value(0).toULongLong();
+            slist << query.value(1).toULongLong();
+            hlist << query.value(2).toString();
             amount -= query.value(1).toULongLong();
             qCDebug(QGCTileCacheLog) << "_pruneCache() HASH:" << query.value(2).toString();
         }
+        query.finish();
+        QSqlQuery* deleteQuery = _prepared("DELETE FROM Tiles WHERE tileID = ?");
+        _db->transaction();
         while(tlist.count()) {
-            s = QString("DELETE FROM Tiles WHERE tileID = %1").arg(tlist[0]);
-            tlist.removeFirst();
-            if(!query.exec(s))
+            deleteQuery->addBindValue(tlist.takeFirst());
+            quint64 size = slist.takeFirst();
+            if(!deleteQuery->exec())
                 break;
+            getQGCMapEngine()->memoryCache()->remove(hlist.takeFirst());
+            //-- Pruned tiles are unique to the default set
+            _totalCount--;
+            _totalSize -= size;
+            _defaultCount--;
+            _defaultSize -= size;
         }
+        _db->commit();
         task->setPruned();
     }
 }
@@ -612,15 +825,30 @@ QGCCacheWorker::_deleteTileSet(qulonglong id)
 {
     QSqlQuery query(*_db);
     QString s;
-    //-- Only delete tiles unique to this set
-    s = QString("DELETE FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A JOIN SetTiles B ON A.tileID = B.tileID WHERE B.setID = %1 GROUP BY A.tileID HAVING COUNT(A.tileID) = 1)").arg(id);
-    query.exec(s);
+    //-- Only delete tiles unique to this set. They have to go from the memory cache as well or the map keeps
+    //   showing them.
+    QString uniqueTiles = QString("SELECT A.tileID FROM SetTiles A JOIN SetTiles B ON A.tileID = B.tileID WHERE B.setID = %1 GROUP BY A.tileID HAVING COUNT(A.tileID) = 1").arg(id);
+    QStringList hashes;
+    s = QString("SELECT hash FROM Tiles WHERE tileID IN (%1)").arg(uniqueTiles);
+    if(query.exec(s)) {
+        while(query.next()) {
+            hashes << query.value(0).toString();
+        }
+        query.finish();
+    }
+    s = QString("DELETE FROM Tiles WHERE tileID IN (%1)").arg(uniqueTiles);
+    if(query.exec(s)) {
+        for(const QString& hash: hashes) {
+            getQGCMapEngine()->memoryCache()->remove(hash);
+        }
+    }
     s = QString("DELETE FROM TilesDownload WHERE setID = %1").arg(id);
     query.exec(s);
     s = QString("DELETE FROM TileSets WHERE setID = %1").arg(id);
     query.exec(s);
     s = QString("DELETE FROM SetTiles WHERE setID = %1").arg(id);
     query.exec(s);
+    _totalsValid = false;
     _updateTotals();
 }
 
@@ -648,6 +876,8 @@ QGCCacheWorker::_resetCacheDatabase(QGCMapTask* mtask)
         return;
     }
     QGCResetTask* task = static_cast<QGCResetTask*>(mtask);
+    //-- Statements on dropped tables can't be reused
+    _clearStatements();
     QSqlQuery query(*_db);
     QString s;
     s = QString("DROP TABLE Tiles");
@@ -659,6 +889,10 @@ QGCCacheWorker::_resetCacheDatabase(QGCMapTask* mtask)
     s = QString("DROP TABLE TilesDownload");
     query.exec(s);
     _valid = _createDB(_db);
+    _defaultSet = UINT64_MAX;
+    _totalsValid = false;
+    //-- Clear once the tables are gone as well, a fetch may have put tiles back since the reset was queued
+    getQGCMapEngine()->memoryCache()->clear();
     task->setResetCompleted();
 }
 
@@ -670,183 +904,291 @@ QGCCacheWorker::_importSets(QGCMapTask* mtask)
         return;
     }
     QGCImportTileTask* task = static_cast<QGCImportTileTask*>(mtask);
-    //-- If replacing, simply copy over it
-    if(task->replace()) {
+    //-- If replacing, simply copy over it. MBTiles files are always merged, they are not a cache database.
+    if(task->replace() && !task->path().endsWith(".mbtiles", Qt::CaseInsensitive)) {
         //-- Close and delete old database
-        if(_db) {
-            delete _db;
-            _db = nullptr;
-            QSqlDatabase::removeDatabase(kSession);
-        }
+        _closeDB();
         QFile file(_databasePath);
         file.remove();
+        QFile::remove(_databasePath + "-wal");
+        QFile::remove(_databasePath + "-shm");
         //-- Copy given database
         QFile::copy(task->path(), _databasePath);
         task->setProgress(25);
         _init();
         if(_valid) {
             task->setProgress(50);
-            _db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kSession));
-            _db->setDatabaseName(_databasePath);
-            _db->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            _valid = _db->open();
+            _valid = _openDB();
         }
+        _defaultSet = UINT64_MAX;
         task->setProgress(100);
     } else {
-        //-- Open imported set
-        QSqlDatabase* dbImport = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kExportSession));
-        dbImport->setDatabaseName(task->path());
-        dbImport->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-        if (dbImport->open()) {
-            QSqlQuery query(*dbImport);
-            //-- Prepare progress report
-            quint64 tileCount = 0;
-            quint64 currentCount = 0;
-            int lastProgress = -1;
-            QString s;
-            s = QString("SELECT COUNT(tileID) FROM Tiles");
-            if(query.exec(s)) {
-                if(query.next()) {
-                    //-- Total number of tiles in imported database
-                    tileCount  = query.value(0).toULongLong();
-                }
+        //-- ATTACH would quietly create an empty database
+        if(!QFile::exists(task->path()) || !_attachDatabase(task->path(), "importDB")) {
+            task->setError("Error opening import database");
+        } else {
+            if(_tableExists("importDB", "TileSets")) {
+                _importQGCSets(task);
+            } else if(_tableExists("importDB", "tiles") && _tableExists("importDB", "metadata")) {
+                _importMBTiles(task);
+            } else {
+                task->setError("Unknown tile database format");
             }
-            if(tileCount) {
-                //-- Iterate Tile Sets
-                s = QString("SELECT * FROM TileSets ORDER BY defaultSet DESC, name ASC");
-                if(query.exec(s)) {
-                    while(query.next()) {
-                        QString name            = query.value("name").toString();
-                        quint64 setID           = query.value("setID").toULongLong();
-                        QString mapType         = query.value("typeStr").toString();
-                        double  topleftLat      = query.value("topleftLat").toDouble();
-                        double  topleftLon      = query.value("topleftLon").toDouble();
-                        double  bottomRightLat  = query.value("bottomRightLat").toDouble();
-                        double  bottomRightLon  = query.value("bottomRightLon").toDouble();
-                        int     minZoom         = query.value("minZoom").toInt();
-                        int     maxZoom         = query.value("maxZoom").toInt();
-                        int     type            = query.value("type").toInt();
-                        quint32 numTiles        = query.value("numTiles").toUInt();
-                        int     defaultSet      = query.value("defaultSet").toInt();
-                        quint64 insertSetID     = _getDefaultTileSet();
-                        //-- If not default set, create new one
-                        if(!defaultSet) {
-                            //-- Check if we have this tile set already
-                            if(_findTileSetID(name, insertSetID)) {
-                                int testCount = 0;
-                                //-- Set with this name already exists. Make name unique.
-                                while (true) {
-                                    QString testName;
-                                    testName.sprintf("%s %02d", name.toLatin1().data(), ++testCount);
-                                    if(!_findTileSetID(testName, insertSetID) || testCount > 99) {
-                                        name = testName;
-                                        break;
-                                    }
-                                }
-                            }
-                            //-- Create new set
-                            QSqlQuery cQuery(*_db);
-                            cQuery.prepare("INSERT INTO TileSets("
-                                "name, typeStr, topleftLat, topleftLon, bottomRightLat, bottomRightLon, minZoom, maxZoom, type, numTiles, defaultSet, date"
-                                ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-                            cQuery.addBindValue(name);
-                            cQuery.addBindValue(mapType);
-                            cQuery.addBindValue(topleftLat);
-                            cQuery.addBindValue(topleftLon);
-                            cQuery.addBindValue(bottomRightLat);
-                            cQuery.addBindValue(bottomRightLon);
-                            cQuery.addBindValue(minZoom);
-                            cQuery.addBindValue(maxZoom);
-                            cQuery.addBindValue(type);
-                            cQuery.addBindValue(numTiles);
-                            cQuery.addBindValue(defaultSet);
-                            cQuery.addBindValue(QDateTime::currentDateTime().toTime_t());
-                            if(!cQuery.exec()) {
-                                task->setError("Error adding imported tile set to database");
-                                break;
-                            } else {
-                                //-- Get just created (auto-incremented) setID
-                                insertSetID = cQuery.lastInsertId().toULongLong();
-                            }
-                        }
-                        //-- Find set tiles
-                        QSqlQuery cQuery(*_db);
-                        QSqlQuery subQuery(*dbImport);
-                        QString sb = QString("SELECT * FROM Tiles WHERE tileID IN (SELECT A.tileID FROM SetTiles A JOIN SetTiles B ON A.tileID = B.tileID WHERE B.setID = %1 GROUP BY A.tileID HAVING COUNT(A.tileID) = 1)").arg(setID);
-                        if(subQuery.exec(sb)) {
-                            quint64 tilesFound = 0;
-                            quint64 tilesSaved = 0;
-                            _db->transaction();
-                            while(subQuery.next()) {
-                                tilesFound++;
-                                QString hash    = subQuery.value("hash").toString();
-                                QString format  = subQuery.value("format").toString();
-                                QByteArray img  = subQuery.value("tile").toByteArray();
-                                int type        = subQuery.value("type").toInt();
-                                //-- Save tile
-                                cQuery.prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
-                                cQuery.addBindValue(hash);
-                                cQuery.addBindValue(format);
-                                cQuery.addBindValue(img);
-                                cQuery.addBindValue(img.size());
-                                cQuery.addBindValue(type);
-                                cQuery.addBindValue(QDateTime::currentDateTime().toTime_t());
-                                if(cQuery.exec()) {
-                                    tilesSaved++;
-                                    quint64 importTileID = cQuery.lastInsertId().toULongLong();
-                                    QString s = QString("INSERT INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(importTileID).arg(insertSetID);
-                                    cQuery.prepare(s);
-                                    cQuery.exec();
-                                    currentCount++;
-                                    if(tileCount) {
-                                        int progress = (int)((double)currentCount / (double)tileCount * 100.0);
-                                        //-- Avoid calling this if (int) progress hasn't changed.
-                                        if(lastProgress != progress) {
-                                            lastProgress = progress;
-                                            task->setProgress(progress);
-                                        }
-                                    }
-                                }
-                            }
-                            _db->commit();
-                            if(tilesSaved) {
-                                //-- Update tile count (if any added)
-                                s = QString("SELECT COUNT(size) FROM Tiles A INNER JOIN SetTiles B on A.tileID = B.tileID WHERE B.setID = %1").arg(insertSetID);
-                                if(cQuery.exec(s)) {
-                                    if(cQuery.next()) {
-                                        quint64 count  = cQuery.value(0).toULongLong();
-                                        s = QString("UPDATE TileSets SET numTiles = %1 WHERE setID = %2").arg(count).arg(insertSetID);
-                                        cQuery.exec(s);
-                                    }
-                                }
-                            }
-                            qint64 uniqueTiles = tilesFound - tilesSaved;
-                            if((quint64)uniqueTiles < tileCount) {
-                                tileCount -= uniqueTiles;
-                            } else {
-                                tileCount = 0;
-                            }
-                            //-- If there was nothing new in this set, remove it.
-                            if(!tilesSaved && !defaultSet) {
-                                qCDebug(QGCTileCacheLog) << "No unique tiles in" << name << "Removing it.";
-                                _deleteTileSet(insertSetID);
-                            }
-                        }
-                    }
-                } else {
-                    task->setError("No tile set in database");
-                }
+            _detachDatabase("importDB");
+            _totalsValid = false;
+        }
+    }
+    task->setImportCompleted();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_importQGCSets(QGCImportTileTask* task)
+{
+    QSqlQuery query(*_db);
+    quint64 minTileID = 0;
+    quint64 maxTileID = 0;
+    quint64 tileCount = 0;
+    if(query.exec("SELECT MIN(tileID), MAX(tileID), COUNT(tileID) FROM importDB.Tiles") && query.next()) {
+        minTileID = query.value(0).toULongLong();
+        maxTileID = query.value(1).toULongLong();
+        tileCount = query.value(2).toULongLong();
+    }
+    if(!tileCount) {
+        task->setError("No unique tiles in imported database");
+        return;
+    }
+    //-- Anything above this was added by the import
+    quint64 lastTileID = 0;
+    if(query.exec("SELECT MAX(tileID) FROM Tiles") && query.next()) {
+        lastTileID = query.value(0).toULongLong();
+    }
+    query.finish();
+    //-- Copy the tiles we don't have yet, SQLite to SQLite without going through Qt. Duplicates are dropped by
+    //   joining against the hash index instead of a lookup per tile, and each chunk goes in sorted by hash.
+    QSqlQuery copyQuery(*_db);
+    copyQuery.prepare(
+        "INSERT INTO Tiles(hash, format, tile, size, type, date) "
+        "SELECT I.hash, I.format, I.tile, I.size, I.type, ? FROM importDB.Tiles I "
+        "WHERE I.tileID BETWEEN ? AND ? AND NOT EXISTS (SELECT 1 FROM Tiles T WHERE T.hash = I.hash) "
+        "ORDER BY I.hash");
+    uint    now         = QDateTime::currentDateTime().toTime_t();
+    quint64 tilesAdded  = 0;
+    int     lastProgress = -1;
+    for(quint64 first = minTileID; first <= maxTileID; first += BULK_CHUNK_SIZE) {
+        copyQuery.addBindValue(now);
+        copyQuery.addBindValue(first);
+        copyQuery.addBindValue(first + BULK_CHUNK_SIZE - 1);
+        _db->transaction();
+        if(!copyQuery.exec()) {
+            qWarning() << "Map Cache SQL error (import tiles):" << copyQuery.lastError().text();
+            _db->rollback();
+            task->setError("Error importing tiles");
+            return;
+        }
+        _db->commit();
+        tilesAdded += static_cast<quint64>(qMax(0, copyQuery.numRowsAffected()));
+        //-- Copying tiles is the bulk of the work, linking sets gets the last 10%
+        int progress = qMin(90, (int)((double)(first + BULK_CHUNK_SIZE - minTileID) / (double)(maxTileID - minTileID + 1) * 90.0));
+        if(lastProgress != progress) {
+            lastProgress = progress;
+            task->setProgress(progress);
+        }
+    }
+    qCDebug(QGCTileCacheLog) << "_importQGCSets() tiles:" << tileCount << "new:" << tilesAdded;
+    if(!tilesAdded) {
+        task->setError("No unique tiles in imported database");
+        return;
+    }
+    //-- Link sets through the hash as well. Imported sets get all their tiles, the default set only the new ones.
+    QSqlQuery linkQuery(*_db);
+    linkQuery.prepare(
+        "INSERT INTO SetTiles(tileID, setID) "
+        "SELECT T.tileID, ? FROM importDB.SetTiles S "
+        "JOIN importDB.Tiles I ON I.tileID = S.tileID "
+        "JOIN Tiles T ON T.hash = I.hash "
+        "WHERE S.setID = ? AND T.tileID > ?");
+    QSqlQuery setQuery(*_db);
+    if(!setQuery.exec("SELECT * FROM importDB.TileSets ORDER BY defaultSet DESC, name ASC")) {
+        task->setError("No tile set in database");
+        return;
+    }
+    while(setQuery.next()) {
+        QString name            = setQuery.value("name").toString();
+        quint64 importSetID     = setQuery.value("setID").toULongLong();
+        int     defaultSet      = setQuery.value("defaultSet").toInt();
+        quint64 insertSetID     = _getDefaultTileSet();
+        //-- If not default set, create new one
+        if(!defaultSet) {
+            insertSetID = _insertTileSet(name,
+                                         setQuery.value("typeStr").toString(),
+                                         setQuery.value("topleftLat").toDouble(),
+                                         setQuery.value("topleftLon").toDouble(),
+                                         setQuery.value("bottomRightLat").toDouble(),
+                                         setQuery.value("bottomRightLon").toDouble(),
+                                         setQuery.value("minZoom").toInt(),
+                                         setQuery.value("maxZoom").toInt(),
+                                         setQuery.value("type").toInt(),
+                                         setQuery.value("numTiles").toUInt());
+            if(!insertSetID) {
+                task->setError("Error adding imported tile set to database");
+                break;
             }
-            delete dbImport;
-            QSqlDatabase::removeDatabase(kExportSession);
-            if(!tileCount) {
-                task->setError("No unique tiles in imported database");
+        }
+        linkQuery.addBindValue(insertSetID);
+        linkQuery.addBindValue(importSetID);
+        linkQuery.addBindValue(defaultSet ? lastTileID : 0);
+        _db->transaction();
+        if(!linkQuery.exec()) {
+            qWarning() << "Map Cache SQL error (import set tiles):" << linkQuery.lastError().text();
+        }
+        _db->commit();
+        if(!defaultSet) {
+            //-- If there was nothing new in this set, remove it.
+            QSqlQuery countQuery(*_db);
+            countQuery.prepare("SELECT COUNT(tileID) FROM SetTiles WHERE setID = ? AND tileID > ?");
+            countQuery.addBindValue(insertSetID);
+            countQuery.addBindValue(lastTileID);
+            if(countQuery.exec() && countQuery.next() && !countQuery.value(0).toULongLong()) {
+                countQuery.finish();
+                qCDebug(QGCTileCacheLog) << "No unique tiles in" << name << "Removing it.";
+                _deleteTileSet(insertSetID);
+            } else {
+                countQuery.finish();
+                _updateTileSetCount(insertSetID);
             }
-        } else {
-            task->setError("Error opening import database");
         }
     }
-    task->setImportCompleted();
+    task->setProgress(100);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_importMBTiles(QGCImportTileTask* task)
+{
+    QHash<QString, QString> metadata;
+    QSqlQuery query(*_db);
+    if(query.exec("SELECT name, value FROM importDB.metadata")) {
+        while(query.next()) {
+            metadata[query.value(0).toString()] = query.value(1).toString();
+        }
+    }
+    //-- Our tiles are keyed by map type. Files we exported record it, for anything else the name has to be a map type.
+    QString mapType = metadata.value("qgc_type", metadata.value("name"));
+    if(!getQGCMapEngine()->urlFactory()->getProviderTable().contains(mapType)) {
+        task->setError(QString("Unknown map type in MBTiles file: %1").arg(mapType));
+        return;
+    }
+    int typeID = getQGCMapEngine()->urlFactory()->getIdFromType(mapType);
+    quint64 tileCount = 0;
+    if(query.exec("SELECT COUNT(*) FROM importDB.tiles") && query.next()) {
+        tileCount = query.value(0).toULongLong();
+    }
+    query.finish();
+    if(!tileCount) {
+        task->setError("No unique tiles in imported database");
+        return;
+    }
+    //-- MBTiles holds a single tile set
+    QString name = metadata.value("name");
+    if(name.isEmpty() || name == mapType) {
+        name = QFileInfo(task->path()).completeBaseName();
+    }
+    //-- bounds is "left,bottom,right,top"
+    QStringList bounds = metadata.value("bounds").split(',');
+    double left = -180.0, bottom = -85.0511, right = 180.0, top = 85.0511;
+    if(bounds.count() == 4) {
+        left    = bounds[0].toDouble();
+        bottom  = bounds[1].toDouble();
+        right   = bounds[2].toDouble();
+        top     = bounds[3].toDouble();
+    }
+    quint64 setID = _insertTileSet(name, mapType, top, left, bottom, right,
+                                   metadata.value("minzoom", "0").toInt(), metadata.value("maxzoom", QString::number(static_cast<int>(MAX_MAP_ZOOM))).toInt(),
+                                   typeID, static_cast<quint32>(tileCount));
+    if(!setID) {
+        task->setError("Error adding imported tile set to database");
+        return;
+    }
+    task->setProgress(10);
+    //-- The tiles table may be a view, which can't be walked by row ID. Walk it in chunks by its (zoom_level,
+    //   tile_column, tile_row) key instead, each chunk finding where the next one starts.
+    QSqlQuery chunkQuery(*_db);
+    chunkQuery.prepare(
+        "SELECT zoom_level, tile_column, tile_row FROM importDB.tiles WHERE (zoom_level, tile_column, tile_row) > (?, ?, ?) "
+        "ORDER BY zoom_level, tile_column, tile_row LIMIT 1 OFFSET ?");
+    //-- MBTiles rows are TMS, flip y back while building the tile hash (see QGCMapEngine::getTileHash)
+    QSqlQuery copyQuery(*_db);
+    copyQuery.prepare(
+        "INSERT INTO Tiles(hash, format, tile, size, type, date) "
+        "SELECT H.hash, ?, H.tile_data, length(H.tile_data), ?, ? FROM "
+        "(SELECT printf('%010d%08d%08d%03d', ?, tile_column, (1 << zoom_level) - 1 - tile_row, zoom_level) AS hash, tile_data FROM importDB.tiles "
+        "WHERE (zoom_level, tile_column, tile_row) > (?, ?, ?) AND (zoom_level, tile_column, tile_row) <= (?, ?, ?)) H "
+        "WHERE NOT EXISTS (SELECT 1 FROM Tiles T WHERE T.hash = H.hash) "
+        "ORDER BY H.hash");
+    QSqlQuery linkQuery(*_db);
+    linkQuery.prepare(
+        "INSERT INTO SetTiles(tileID, setID) "
+        "SELECT T.tileID, ? FROM importDB.tiles I "
+        "JOIN Tiles T ON T.hash = printf('%010d%08d%08d%03d', ?, I.tile_column, (1 << I.zoom_level) - 1 - I.tile_row, I.zoom_level) "
+        "WHERE (I.zoom_level, I.tile_column, I.tile_row) > (?, ?, ?) AND (I.zoom_level, I.tile_column, I.tile_row) <= (?, ?, ?)");
+    //-- MBTiles uses the same format names we do (png, jpg)
+    QString format      = metadata.value("format", "png");
+    uint    now         = QDateTime::currentDateTime().toTime_t();
+    QVariantList from   = { -1, -1, -1 };
+    quint64 tilesAdded  = 0;
+    quint64 tilesCopied = 0;
+    int     lastProgress = -1;
+    while(true) {
+        //-- The last chunk runs to the end of the table
+        QVariantList to = { INT_MAX, INT_MAX, INT_MAX };
+        for(const QVariant& key: from) {
+            chunkQuery.addBindValue(key);
+        }
+        chunkQuery.addBindValue(BULK_CHUNK_SIZE - 1);
+        if(chunkQuery.exec() && chunkQuery.next()) {
+            to = { chunkQuery.value(0), chunkQuery.value(1), chunkQuery.value(2) };
+        }
+        chunkQuery.finish();
+        copyQuery.addBindValue(format);
+        copyQuery.addBindValue(typeID);
+        copyQuery.addBindValue(now);
+        copyQuery.addBindValue(typeID);
+        linkQuery.addBindValue(setID);
+        linkQuery.addBindValue(typeID);
+        for(const QVariant& key: from + to) {
+            copyQuery.addBindValue(key);
+            linkQuery.addBindValue(key);
+        }
+        _db->transaction();
+        if(!copyQuery.exec() || !linkQuery.exec()) {
+            qWarning() << "Map Cache SQL error (import MBTiles):" << copyQuery.lastError().text() << linkQuery.lastError().text();
+            _db->rollback();
+            _deleteTileSet(setID);
+            task->setError("Error importing tiles");
+            return;
+        }
+        _db->commit();
+        tilesAdded  += static_cast<quint64>(qMax(0, copyQuery.numRowsAffected()));
+        tilesCopied += static_cast<quint64>(qMax(0, linkQuery.numRowsAffected()));
+        if(to[0].toInt() == INT_MAX) {
+            break;
+        }
+        from = to;
+        int progress = qMin(90, 10 + (int)((double)tilesCopied / (double)tileCount * 80.0));
+        if(lastProgress != progress) {
+            lastProgress = progress;
+            task->setProgress(progress);
+        }
+    }
+    qCDebug(QGCTileCacheLog) << "_importMBTiles() tiles:" << tileCount << "new:" << tilesAdded;
+    if(!tilesAdded) {
+        _deleteTileSet(setID);
+        task->setError("No unique tiles in imported database");
+        return;
+    }
+    _updateTileSetCount(setID);
+    task->setProgress(100);
 }
 
 //-----------------------------------------------------------------------------
@@ -860,93 +1202,15 @@ QGCCacheWorker::_exportSets(QGCMapTask* mtask)
     //-- Delete target if it exists
     QFile file(task->path());
     file.remove();
-    //-- Create exported database
+    bool mbtiles = task->path().endsWith(".mbtiles", Qt::CaseInsensitive);
+    //-- Create the schema through its own connection, then attach it to ours so SQLite copies the tiles directly
+    bool created = false;
     QSqlDatabase *dbExport = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kExportSession));
     dbExport->setDatabaseName(task->path());
     dbExport->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
     if (dbExport->open()) {
-        if(_createDB(dbExport, false)) {
-            //-- Prepare progress report
-            quint64 tileCount = 0;
-            quint64 currentCount = 0;
-            for(int i = 0; i < task->sets().count(); i++) {
-                QGCCachedTileSet* set = task->sets()[i];
-                //-- Default set has no unique tiles
-                if(set->defaultSet()) {
-                    tileCount += set->totalTileCount();
-                } else {
-                    tileCount += set->uniqueTileCount();
-                }
-            }
-            if(!tileCount) {
-                tileCount = 1;
-            }
-            //-- Iterate sets to save
-            for(int i = 0; i < task->sets().count(); i++) {
-                QGCCachedTileSet* set = task->sets()[i];
-                //-- Create Tile Exported Set
-                QSqlQuery exportQuery(*dbExport);
-                exportQuery.prepare("INSERT INTO TileSets("
-                    "name, typeStr, topleftLat, topleftLon, bottomRightLat, bottomRightLon, minZoom, maxZoom, type, numTiles, defaultSet, date"
-                    ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-                exportQuery.addBindValue(set->name());
-                exportQuery.addBindValue(set->mapTypeStr());
-                exportQuery.addBindValue(set->topleftLat());
-                exportQuery.addBindValue(set->topleftLon());
-                exportQuery.addBindValue(set->bottomRightLat());
-                exportQuery.addBindValue(set->bottomRightLon());
-                exportQuery.addBindValue(set->minZoom());
-                exportQuery.addBindValue(set->maxZoom());
-                exportQuery.addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(set->type()));
-                exportQuery.addBindValue(set->totalTileCount());
-                exportQuery.addBindValue(set->defaultSet());
-                exportQuery.addBindValue(QDateTime::currentDateTime().toTime_t());
-                if(!exportQuery.exec()) {
-                    task->setError("Error adding tile set to exported database");
-                    break;
-                } else {
-                    //-- Get just created (auto-incremented) setID
-                    quint64 exportSetID = exportQuery.lastInsertId().toULongLong();
-                    //-- Find set tiles
-                    QString s = QString("SELECT * FROM SetTiles WHERE setID = %1").arg(set->id());
-                    QSqlQuery query(*_db);
-                    if(query.exec(s)) {
-                        dbExport->transaction();
-                        while(query.next()) {
-                            quint64 tileID = query.value("tileID").toULongLong();
-                            //-- Get tile
-                            QString s = QString("SELECT * FROM Tiles WHERE tileID = \"%1\"").arg(tileID);
-                            QSqlQuery subQuery(*_db);
-                            if(subQuery.exec(s)) {
-                                if(subQuery.next()) {
-                                    QString hash    = subQuery.value("hash").toString();
-                                    QString format  = subQuery.value("format").toString();
-                                    QByteArray img  = subQuery.value("tile").toByteArray();
-                                    int type        = subQuery.value("type").toInt();
-                                    //-- Save tile
-                                    exportQuery.prepare("INSERT INTO Tiles(hash, format, tile, size, type, date) VALUES(?, ?, ?, ?, ?, ?)");
-                                    exportQuery.addBindValue(hash);
-                                    exportQuery.addBindValue(format);
-                                    exportQuery.addBindValue(img);
-                                    exportQuery.addBindValue(img.size());
-                                    exportQuery.addBindValue(type);
-                                    exportQuery.addBindValue(QDateTime::currentDateTime().toTime_t());
-                                    if(exportQuery.exec()) {
-                                        quint64 exportTileID = exportQuery.lastInsertId().toULongLong();
-                                        QString s = QString("INSERT INTO SetTiles(tileID, setID) VALUES(%1, %2)").arg(exportTileID).arg(exportSetID);
-                                        exportQuery.prepare(s);
-                                        exportQuery.exec();
-                                        currentCount++;
-                                        task->setProgress((int)((double)currentCount / (double)tileCount * 100.0));
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    dbExport->commit();
-                }
-            }
-        } else {
+        created = mbtiles ? _createMBTilesDB(dbExport) : _createDB(dbExport, false);
+        if(!created) {
             task->setError("Error creating export database");
         }
     } else {
@@ -955,9 +1219,333 @@ QGCCacheWorker::_exportSets(QGCMapTask* mtask)
     }
     delete dbExport;
     QSqlDatabase::removeDatabase(kExportSession);
+    if(created) {
+        if(_attachDatabase(task->path(), "exportDB")) {
+            if(mbtiles) {
+                _exportMBTiles(task);
+            } else {
+                _exportQGCSets(task);
+            }
+            _detachDatabase("exportDB");
+        } else {
+            task->setError("Error opening export database");
+        }
+    }
     task->setExportCompleted();
 }
 
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_exportQGCSets(QGCExportTileTask* task)
+{
+    quint64 tileCount = _exportTileCount(task);
+    quint64 currentCount = 0;
+    int lastProgress = -1;
+    uint now = QDateTime::currentDateTime().toTime_t();
+    //-- Tiles shared between exported sets are only copied once
+    QSqlQuery copyQuery(*_db);
+    copyQuery.prepare(
+        "INSERT INTO exportDB.Tiles(hash, format, tile, size, type, date) "
+        "SELECT T.hash, T.format, T.tile, T.size, T.type, ? FROM SetTiles S JOIN Tiles T ON T.tileID = S.tileID "
+        "WHERE S.setID = ? AND S.tileID BETWEEN ? AND ? AND NOT EXISTS (SELECT 1 FROM exportDB.Tiles E WHERE E.hash = T.hash) "
+        "ORDER BY T.hash");
+    QSqlQuery linkQuery(*_db);
+    linkQuery.prepare(
+        "INSERT INTO exportDB.SetTiles(tileID, setID) "
+        "SELECT E.tileID, ? FROM SetTiles S JOIN Tiles T ON T.tileID = S.tileID JOIN exportDB.Tiles E ON E.hash = T.hash "
+        "WHERE S.setID = ? AND S.tileID BETWEEN ? AND ?");
+    //-- Iterate sets to save
+    for(int i = 0; i < task->sets().count(); i++) {
+        QGCCachedTileSet* set = task->sets()[i];
+        //-- Create Tile Exported Set
+        QSqlQuery exportQuery(*_db);
+        exportQuery.prepare("INSERT INTO exportDB.TileSets("
+            "name, typeStr, topleftLat, topleftLon, bottomRightLat, bottomRightLon, minZoom, maxZoom, type, numTiles, defaultSet, date"
+            ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        exportQuery.addBindValue(set->name());
+        exportQuery.addBindValue(set->mapTypeStr());
+        exportQuery.addBindValue(set->topleftLat());
+        exportQuery.addBindValue(set->topleftLon());
+        exportQuery.addBindValue(set->bottomRightLat());
+        exportQuery.addBindValue(set->bottomRightLon());
+        exportQuery.addBindValue(set->minZoom());
+        exportQuery.addBindValue(set->maxZoom());
+        exportQuery.addBindValue(getQGCMapEngine()->urlFactory()->getIdFromType(set->type()));
+        exportQuery.addBindValue(set->totalTileCount());
+        exportQuery.addBindValue(set->defaultSet());
+        exportQuery.addBindValue(now);
+        if(!exportQuery.exec()) {
+            task->setError("Error adding tile set to exported database");
+            break;
+        }
+        //-- Get just created (auto-incremented) setID
+        quint64 exportSetID = exportQuery.lastInsertId().toULongLong();
+        quint64 firstTileID, lastTileID;
+        if(!_setTileIDRange(set->id(), firstTileID, lastTileID)) {
+            continue;
+        }
+        for(quint64 first = firstTileID; first <= lastTileID; first += BULK_CHUNK_SIZE) {
+            quint64 last = first + BULK_CHUNK_SIZE - 1;
+            copyQuery.addBindValue(now);
+            copyQuery.addBindValue(set->id());
+            copyQuery.addBindValue(first);
+            copyQuery.addBindValue(last);
+            linkQuery.addBindValue(exportSetID);
+            linkQuery.addBindValue(set->id());
+            linkQuery.addBindValue(first);
+            linkQuery.addBindValue(last);
+            _db->transaction();
+            if(!copyQuery.exec() || !linkQuery.exec()) {
+                qWarning() << "Map Cache SQL error (export tiles):" << copyQuery.lastError().text() << linkQuery.lastError().text();
+                _db->rollback();
+                task->setError("Error exporting tiles");
+                return;
+            }
+            _db->commit();
+            currentCount += static_cast<quint64>(qMax(0, linkQuery.numRowsAffected()));
+            int progress = qMin(100, (int)((double)currentCount / (double)tileCount * 100.0));
+            if(lastProgress != progress) {
+                lastProgress = progress;
+                task->setProgress(progress);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_exportMBTiles(QGCExportTileTask* task)
+{
+    //-- An MBTiles file is a single layer
+    QString mapType;
+    double  left = 180.0, bottom = 90.0, right = -180.0, top = -90.0;
+    int     minZoom = static_cast<int>(MAX_MAP_ZOOM), maxZoom = 0;
+    QStringList names;
+    for(QGCCachedTileSet* set: task->sets()) {
+        //-- The default set holds tiles of every map type, it only defines which ones by the other sets
+        if(set->defaultSet()) {
+            continue;
+        }
+        if(!mapType.isEmpty() && set->type() != mapType) {
+            task->setError("MBTiles export requires tile sets of a single map type");
+            return;
+        }
+        mapType = set->type();
+        names   << set->name();
+        left    = qMin(left,    set->topleftLon());
+        top     = qMax(top,     set->topleftLat());
+        right   = qMax(right,   set->bottomRightLon());
+        bottom  = qMin(bottom,  set->bottomRightLat());
+        minZoom = qMin(minZoom, set->minZoom());
+        maxZoom = qMax(maxZoom, set->maxZoom());
+    }
+    if(mapType.isEmpty()) {
+        task->setError("MBTiles export requires at least one tile set other than the default set");
+        return;
+    }
+    //-- Tiles of other map types can be in the selected sets (the default set), filter on the hash type prefix
+    QString typePrefix = QString::asprintf("%010d", getQGCMapEngine()->urlFactory()->getIdFromType(mapType));
+    QString format = "png";
+    QSqlQuery query(*_db);
+    query.prepare("SELECT format FROM Tiles WHERE substr(hash, 1, 10) = ? LIMIT 1");
+    query.addBindValue(typePrefix);
+    if(query.exec() && query.next()) {
+        format = query.value(0).toString();
+    }
+    query.finish();
+    QList<QPair<QString, QString>> metadata;
+    metadata << qMakePair(QString("name"),          names.join(", "));
+    metadata << qMakePair(QString("type"),          QString("baselayer"));
+    metadata << qMakePair(QString("version"),       QString("1.1"));
+    metadata << qMakePair(QString("description"),   QString("%1 tiles exported from QGroundControl").arg(mapType));
+    metadata << qMakePair(QString("format"),        format);
+    metadata << qMakePair(QString("bounds"),        QString("%1,%2,%3,%4").arg(left).arg(bottom).arg(right).arg(top));
+    metadata << qMakePair(QString("minzoom"),       QString::number(minZoom));
+    metadata << qMakePair(QString("maxzoom"),       QString::number(maxZoom));
+    //-- Lets us import the file back under the right map type
+    metadata << qMakePair(QString("qgc_type"),      mapType);
+    query.prepare("INSERT INTO exportDB.metadata(name, value) VALUES(?, ?)");
+    for(const QPair<QString, QString>& item: metadata) {
+        query.addBindValue(item.first);
+        query.addBindValue(item.second);
+        query.exec();
+    }
+    //-- x, y and z come out of the tile hash (see QGCMapEngine::getTileHash), y is flipped to TMS. Tiles shared
+    //   between sets are dropped by the unique tile index.
+    QSqlQuery copyQuery(*_db);
+    copyQuery.prepare(
+        "INSERT OR IGNORE INTO exportDB.tiles(zoom_level, tile_column, tile_row, tile_data) "
+        "SELECT Z, X, (1 << Z) - 1 - Y, D FROM "
+        "(SELECT CAST(substr(T.hash, 27, 3) AS INTEGER) AS Z, CAST(substr(T.hash, 11, 8) AS INTEGER) AS X, CAST(substr(T.hash, 19, 8) AS INTEGER) AS Y, T.tile AS D "
+        "FROM SetTiles S JOIN Tiles T ON T.tileID = S.tileID "
+        "WHERE S.setID = ? AND S.tileID BETWEEN ? AND ? AND substr(T.hash, 1, 10) = ?) "
+        "ORDER BY Z, X, Y");
+    quint64 tileCount = _exportTileCount(task);
+    quint64 currentCount = 0;
+    int lastProgress = -1;
+    for(QGCCachedTileSet* set: task->sets()) {
+        quint64 firstTileID, lastTileID;
+        if(!_setTileIDRange(set->id(), firstTileID, lastTileID)) {
+            continue;
+        }
+        for(quint64 first = firstTileID; first <= lastTileID; first += BULK_CHUNK_SIZE) {
+            copyQuery.addBindValue(set->id());
+            copyQuery.addBindValue(first);
+            copyQuery.addBindValue(first + BULK_CHUNK_SIZE - 1);
+            copyQuery.addBindValue(typePrefix);
+            _db->transaction();
+            if(!copyQuery.exec()) {
+                qWarning() << "Map Cache SQL error (export MBTiles):" << copyQuery.lastError().text();
+                _db->rollback();
+                task->setError("Error exporting tiles");
+                return;
+            }
+            _db->commit();
+            currentCount += static_cast<quint64>(qMax(0, copyQuery.numRowsAffected()));
+            int progress = qMin(100, (int)((double)currentCount / (double)tileCount * 100.0));
+            if(lastProgress != progress) {
+                lastProgress = progress;
+                task->setProgress(progress);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+quint64
+QGCCacheWorker::_exportTileCount(QGCExportTileTask* task)
+{
+    quint64 tileCount = 0;
+    for(int i = 0; i < task->sets().count(); i++) {
+        QGCCachedTileSet* set = task->sets()[i];
+        //-- Default set has no unique tiles
+        if(set->defaultSet()) {
+            tileCount += set->totalTileCount();
+        } else {
+            tileCount += set->uniqueTileCount();
+        }
+    }
+    return tileCount ? tileCount : 1;
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::_setTileIDRange(quint64 setID, quint64& first, quint64& last)
+{
+    QSqlQuery query(*_db);
+    query.prepare("SELECT MIN(tileID), MAX(tileID) FROM SetTiles WHERE setID = ?");
+    query.addBindValue(setID);
+    if(query.exec() && query.next() && !query.value(0).isNull()) {
+        first = query.value(0).toULongLong();
+        last  = query.value(1).toULongLong();
+        return true;
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+quint64
+QGCCacheWorker::_insertTileSet(QString name, const QString& mapType, double topleftLat, double topleftLon, double bottomRightLat, double bottomRightLon, int minZoom, int maxZoom, int type, quint32 numTiles)
+{
+    quint64 setID;
+    //-- Check if we have this tile set already
+    if(_findTileSetID(name, setID)) {
+        int testCount = 0;
+        //-- Set with this name already exists. Make name unique.
+        while (true) {
+            QString testName;
+            testName.sprintf("%s %02d", name.toLatin1().data(), ++testCount);
+            if(!_findTileSetID(testName, setID) || testCount > 99) {
+                name = testName;
+                break;
+            }
+        }
+    }
+    QSqlQuery query(*_db);
+    query.prepare("INSERT INTO TileSets("
+        "name, typeStr, topleftLat, topleftLon, bottomRightLat, bottomRightLon, minZoom, maxZoom, type, numTiles, defaultSet, date"
+        ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    query.addBindValue(name);
+    query.addBindValue(mapType);
+    query.addBindValue(topleftLat);
+    query.addBindValue(topleftLon);
+    query.addBindValue(bottomRightLat);
+    query.addBindValue(bottomRightLon);
+    query.addBindValue(minZoom);
+    query.addBindValue(maxZoom);
+    query.addBindValue(type);
+    query.addBindValue(numTiles);
+    query.addBindValue(0);
+    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+    if(!query.exec()) {
+        qWarning() << "Map Cache SQL error (add tile set):" << query.lastError().text();
+        return 0;
+    }
+    //-- Get just created (auto-incremented) setID
+    return query.lastInsertId().toULongLong();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_updateTileSetCount(quint64 setID)
+{
+    QSqlQuery query(*_db);
+    query.prepare("UPDATE TileSets SET numTiles = (SELECT COUNT(tileID) FROM SetTiles WHERE setID = ?) WHERE setID = ?");
+    query.addBindValue(setID);
+    query.addBindValue(setID);
+    query.exec();
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::_attachDatabase(const QString& path, const QString& name)
+{
+    //-- Can't attach while a transaction is open
+    _commitBatch();
+    QSqlQuery query(*_db);
+    query.prepare(QString("ATTACH DATABASE ? AS %1").arg(name));
+    query.addBindValue(path);
+    if(!query.exec()) {
+        qWarning() << "Map Cache SQL error (attach):" << path << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCCacheWorker::_detachDatabase(const QString& name)
+{
+    QSqlQuery query(*_db);
+    if(!query.exec(QString("DETACH DATABASE %1").arg(name))) {
+        qWarning() << "Map Cache SQL error (detach):" << name << query.lastError().text();
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::_tableExists(const QString& dbName, const QString& table)
+{
+    QSqlQuery query(*_db);
+    query.prepare(QString("SELECT COUNT(*) FROM %1.sqlite_master WHERE type IN ('table', 'view') AND name = ?").arg(dbName));
+    query.addBindValue(table);
+    return query.exec() && query.next() && query.value(0).toInt() > 0;
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCCacheWorker::_createMBTilesDB(QSqlDatabase* db)
+{
+    QSqlQuery query(*db);
+    if(!query.exec("CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT)") ||
+       !query.exec("CREATE TABLE IF NOT EXISTS tiles (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_data BLOB)") ||
+       !query.exec("CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles (zoom_level, tile_column, tile_row)")) {
+        qWarning() << "Map Cache SQL error (create MBTiles db):" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 bool QGCCacheWorker::_testTask(QGCMapTask* mtask)
 {
@@ -976,7 +1564,7 @@ QGCCacheWorker::_init()
     if(!_databasePath.isEmpty()) {
         qCDebug(QGCTileCacheLog) << "Mapping cache directory:" << _databasePath;
         //-- Initialize Database
-        _db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", kSession));
+        _db = new QSqlDatabase(QSqlDatabase::addDatabase("QSQLITE", _session));
         _db->setDatabaseName(_databasePath);
         _db->setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
         if (_db->open()) {
@@ -990,7 +1578,7 @@ QGCCacheWorker::_init()
         }
         delete _db;
         _db = nullptr;
-        QSqlDatabase::removeDatabase(kSession);
+        QSqlDatabase::removeDatabase(_session);
     } else {
         qCritical() << "Could not find suitable cache directory.";
         _failed = true;
@@ -1042,6 +1630,10 @@ QGCCacheWorker::_createDB(QSqlDatabase* db, bool createDefault)
             {
                 qWarning() << "Map Cache SQL error (create SetTiles db):" << query.lastError().text();
             } else {
+                //-- Set membership is looked up and walked by set
+                if(!query.exec("CREATE INDEX IF NOT EXISTS SetTilesSetID ON SetTiles(setID, tileID)")) {
+                    qWarning() << "Map Cache SQL error (create SetTiles index):" << query.lastError().text();
+                }
                 if(!query.exec(
                     "CREATE TABLE IF NOT EXISTS TilesDownload ("
                     "setID INTEGER, "
@@ -1054,6 +1646,10 @@ QGCCacheWorker::_createDB(QSqlDatabase* db, bool createDefault)
                 {
                     qWarning() << "Map Cache SQL error (create TilesDownload db):" << query.lastError().text();
                 } else {
+                    //-- The download list is walked per set in row ID order
+                    if(!query.exec("CREATE INDEX IF NOT EXISTS TilesDownloadSetState ON TilesDownload(setID, state)")) {
+                        qWarning() << "Map Cache SQL error (create TilesDownload index):" << query.lastError().text();
+                    }
                     //-- Database it ready for use
                     res = true;
                 }
@@ -26,6 +26,7 @@
 #include <QWaitCondition>
 #include <QMutexLocker>
 #include <QtSql/QSqlDatabase>
+#include <QHash>
 #include <QHostInfo>
 
 #include "QGCLoggingCategory.h"
@@ -34,11 +35,17 @@ Q_DECLARE_LOGGING_CATEGORY(QGCTileCacheLog)
 
 class QGCMapTask;
 class QGCCachedTileSet;
+class QGCImportTileTask;
+class QGCExportTileTask;
+class QSqlQuery;
 
 //-----------------------------------------------------------------------------
 class QGCCacheWorker : public QThread
 {
     Q_OBJECT
+
+    friend class QGCTileCacheWorkerTest;
+
 public:
     QGCCacheWorker  ();
     ~QGCCacheWorker ();
@@ -55,6 +62,7 @@ private slots:
 
 private:
     void        _saveTile               (QGCMapTask* mtask);
+    void        _saveDownloadedTiles    (QGCMapTask* mtask);
     void        _getTile                (QGCMapTask* mtask);
     void        _getTileSets            (QGCMapTask* mtask);
     void        _createTileSet          (QGCMapTask* mtask);
@@ -66,6 +74,10 @@ private:
     void        _pruneCache             (QGCMapTask* mtask);
     void        _exportSets             (QGCMapTask* mtask);
     void        _importSets             (QGCMapTask* mtask);
+    void        _importQGCSets          (QGCImportTileTask* task);
+    void        _importMBTiles          (QGCImportTileTask* task);
+    void        _exportQGCSets          (QGCExportTileTask* task);
+    void        _exportMBTiles          (QGCExportTileTask* task);
     bool        _testTask               (QGCMapTask* mtask);
     void        _testInternet           ();
 
@@ -74,9 +86,24 @@ private:
     void        _updateSetTotals        (QGCCachedTileSet* set);
     bool        _init                   ();
     bool        _createDB               (QSqlDatabase *db, bool createDefault = true);
+    bool        _createMBTilesDB        (QSqlDatabase* db);
     quint64     _getDefaultTileSet      ();
     void        _updateTotals           ();
+    void        _computeTotals          ();
     void        _deleteTileSet          (qulonglong id);
+    quint64     _insertTileSet          (QString name, const QString& mapType, double topleftLat, double topleftLon, double bottomRightLat, double bottomRightLon, int minZoom, int maxZoom, int type, quint32 numTiles);
+    void        _updateTileSetCount     (quint64 setID);
+    bool        _setTileIDRange         (quint64 setID, quint64& first, quint64& last);
+    quint64     _exportTileCount        (QGCExportTileTask* task);
+    bool        _attachDatabase         (const QString& path, const QString& name);
+    void        _detachDatabase         (const QString& name);
+    bool        _tableExists            (const QString& dbName, const QString& table);
+    bool        _openDB                 ();
+    void        _closeDB                ();
+    QSqlQuery*  _prepared               (const char* sql);
+    void        _clearStatements        ();
+    void        _beginBatch             ();
+    void        _commitBatch            ();
 
 signals:
     void        updateTotals            (quint32 totaltiles, quint64 totalsize, quint32 defaulttiles, quint64 defaultsize);
@@ -88,6 +115,7 @@ private:
     QMutex                  _waitmutex;
     QWaitCondition          _waitc;
     QString                 _databasePath;
+    QString                 _session;               ///< Database connection name
     QSqlDatabase*           _db;
     bool                    _valid;
     bool                    _failed;
@@ -99,6 +127,10 @@ private:
     time_t                  _lastUpdate;
     int                     _updateTimeout;
     int                     _hostLookupID;
+    QHash<QByteArray, QSqlQuery*> _statements;      ///< Prepared statements keyed by their SQL text
+    bool                    _totalsValid;           ///< false: totals must be recomputed from the database
+    bool                    _inBatch;               ///< A batch transaction is open
+    int                     _batchTasks;            ///< Tasks handled within the open batch transaction
 };
 
 #endif // QGC_TILE_CACHE_WORKER_H
@@ -0,0 +1,193 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Network stage of the offline tile set download pipeline
+ *
+ */
+
+#include "QGCTileDownloader.h"
+
+#include <QNetworkProxy>
+
+QGC_LOGGING_CATEGORY(QGCTileDownloaderLog, "QGCTileDownloaderLog")
+
+//-- Latency above best * factor + slack means requests are queueing (in QNetworkAccessManager or at the server)
+#define LATENCY_CONGESTION_FACTOR   2.0
+#define LATENCY_CONGESTION_SLACK    50.0
+#define LATENCY_BACKOFF             0.75
+#define ERROR_BACKOFF               0.5
+
+QHash<QString, double> QGCTileDownloader::_learnedConcurrency;
+
+//-----------------------------------------------------------------------------
+QGCTileDownloader::QGCTileDownloader(const QString& provider, int initialConcurrency, int maxConcurrency, QNetworkAccessManager* networkManager, RequestFactory requestFactory, QObject* parent)
+    : QObject(parent)
+    , _provider(provider)
+    , _networkManager(networkManager)
+    , _requestFactory(requestFactory)
+    , _concurrency(initialConcurrency)
+    , _maxConcurrency(qMax(1, maxConcurrency))
+    , _latencyAvg(-1)
+    , _bestLatency(-1)
+    , _completedSinceBackoff(0)
+{
+    if(_learnedConcurrency.contains(_provider)) {
+        _concurrency = _learnedConcurrency[_provider];
+    }
+    _concurrency = qBound(1.0, _concurrency, static_cast<double>(_maxConcurrency));
+    _clock.start();
+}
+
+//-----------------------------------------------------------------------------
+QGCTileDownloader::~QGCTileDownloader()
+{
+    cancel();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileDownloader::enqueue(const QList<QGCTile*>& tiles)
+{
+    for(QGCTile* tile: tiles) {
+        _queue.enqueue(tile);
+    }
+    _startDownloads();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileDownloader::cancel()
+{
+    qDeleteAll(_queue);
+    _queue.clear();
+    //-- Take the list first, abort() emits finished() synchronously
+    QHash<QNetworkReply*, Request_t> replies = _replies;
+    _replies.clear();
+    for(QNetworkReply* reply: replies.keys()) {
+        disconnect(reply, &QNetworkReply::finished, this, &QGCTileDownloader::_replyFinished);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileDownloader::_startDownloads()
+{
+    while(_replies.count() < concurrency() && !_queue.isEmpty()) {
+        QGCTile* tile = _queue.dequeue();
+        QNetworkRequest request = _requestFactory(*tile);
+        request.setAttribute(QNetworkRequest::User, tile->hash());
+#if !defined(__mobile__)
+        QNetworkProxy proxy = _networkManager->proxy();
+        QNetworkProxy tProxy;
+        tProxy.setType(QNetworkProxy::DefaultProxy);
+        _networkManager->setProxy(tProxy);
+#endif
+        QNetworkReply* reply = _networkManager->get(request);
+        reply->setParent(nullptr);
+        connect(reply, &QNetworkReply::finished, this, &QGCTileDownloader::_replyFinished);
+#if !defined(__mobile__)
+        _networkManager->setProxy(proxy);
+#endif
+        Request_t pending;
+        pending.hash        = tile->hash();
+        pending.startMSecs  = _clock.elapsed();
+        _replies.insert(reply, pending);
+        delete tile;
+    }
+    if(_queue.count() < lowWaterMark()) {
+        emit queueLow();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileDownloader::_replyFinished()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(QObject::sender());
+    if(!reply) {
+        return;
+    }
+    reply->deleteLater();
+    auto it = _replies.find(reply);
+    if(it == _replies.end()) {
+        qWarning() << "QGCTileDownloader::_replyFinished() Reply not in list";
+        return;
+    }
+    Request_t pending = it.value();
+    _replies.erase(it);
+    qint64 latency = _clock.elapsed() - pending.startMSecs;
+    if(reply->error() == QNetworkReply::NoError) {
+        _adapt(false, latency);
+        emit tileDownloaded(pending.hash, reply->readAll());
+    } else {
+        //-- A missing tile says nothing about how loaded the server is
+        if(_isCongestion(reply)) {
+            _adapt(true, latency);
+        }
+        qCDebug(QGCTileDownloaderLog) << "Error fetching tile" << pending.hash << reply->errorString();
+        emit tileFailed(pending.hash, reply->errorString());
+    }
+    _startDownloads();
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCTileDownloader::_isCongestion(QNetworkReply* reply)
+{
+    switch(reply->error()) {
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::ServiceUnavailableError:
+        case QNetworkReply::InternalServerError:
+        case QNetworkReply::UnknownServerError:
+            return true;
+        default:
+            break;
+    }
+    //-- Too Many Requests
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 429;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileDownloader::_adapt(bool congested, qint64 latencyMSecs)
+{
+    double backoff = ERROR_BACKOFF;
+    if(!congested) {
+        double latency = static_cast<double>(latencyMSecs);
+        _latencyAvg = _latencyAvg < 0 ? latency : (_latencyAvg * 0.8) + (latency * 0.2);
+        if(_bestLatency < 0 || _latencyAvg < _bestLatency) {
+            _bestLatency = _latencyAvg;
+        } else {
+            //-- Let the baseline drift up slowly so a permanently slower network isn't treated as congestion forever
+            _bestLatency += (_latencyAvg - _bestLatency) * 0.01;
+        }
+        congested = _latencyAvg > (_bestLatency * LATENCY_CONGESTION_FACTOR) + LATENCY_CONGESTION_SLACK;
+        backoff = LATENCY_BACKOFF;
+    }
+    _completedSinceBackoff++;
+    if(congested) {
+        //-- Back off at most once per round trip, the rest of the replies of that window saw the same conditions
+        if(_completedSinceBackoff >= concurrency()) {
+            _concurrency = qMax(1.0, _concurrency * backoff);
+            _completedSinceBackoff = 0;
+            qCDebug(QGCTileDownloaderLog) << _provider << "backing off to" << concurrency() << "latency" << _latencyAvg << "best" << _bestLatency;
+        }
+    } else {
+        //-- One more request in flight per round trip
+        _concurrency = qMin(static_cast<double>(_maxConcurrency), _concurrency + (1.0 / _concurrency));
+    }
+    _learnedConcurrency[_provider] = _concurrency;
+}
@@ -0,0 +1,98 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief Network stage of the offline tile set download pipeline
+ *
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QNetworkAccessManager>
+
+#include <functional>
+
+#include "QGCLoggingCategory.h"
+#include "QGCMapEngineData.h"
+
+Q_DECLARE_LOGGING_CATEGORY(QGCTileDownloaderLog)
+
+//-----------------------------------------------------------------------------
+// Keeps a queue of tiles flowing through a QNetworkAccessManager. The number of requests in flight
+// adapts to the provider: it grows by one per round trip while latency stays close to the best seen
+// and backs off when latency climbs (requests are queueing somewhere) or the server reports overload.
+// What was learned is remembered per provider for the next download.
+class QGCTileDownloader : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<QNetworkRequest(const QGCTile& tile)> RequestFactory;
+
+    QGCTileDownloader   (const QString& provider, int initialConcurrency, int maxConcurrency, QNetworkAccessManager* networkManager, RequestFactory requestFactory, QObject* parent = nullptr);
+    ~QGCTileDownloader  ();
+
+    //-- Takes ownership of the tiles
+    void        enqueue             (const QList<QGCTile*>& tiles);
+    //-- Drops queued tiles and aborts requests in flight. Aborted tiles are not reported.
+    void        cancel              ();
+
+    int         queued              () const { return _queue.count(); }
+    int         inFlight            () const { return _replies.count(); }
+    bool        idle                () const { return _queue.isEmpty() && _replies.isEmpty(); }
+    int         concurrency         () const { return static_cast<int>(_concurrency); }
+    double      averageLatencyMSecs () const { return _latencyAvg; }
+    //-- Queue depth below which queueLow() is emitted
+    int         lowWaterMark        () const { return concurrency() * 4; }
+
+    static void resetLearnedConcurrency () { _learnedConcurrency.clear(); }
+
+signals:
+    void        tileDownloaded      (const QString& hash, const QByteArray& data);
+    void        tileFailed          (const QString& hash, const QString& errorString);
+    void        queueLow            ();
+
+private slots:
+    void        _replyFinished      ();
+
+private:
+    void        _startDownloads     ();
+    void        _adapt              (bool congested, qint64 latencyMSecs);
+    static bool _isCongestion       (QNetworkReply* reply);
+
+private:
+    class Request_t
+    {
+    public:
+        QString hash;
+        qint64  startMSecs;
+    };
+
+    QString                             _provider;
+    QNetworkAccessManager*              _networkManager;
+    RequestFactory                      _requestFactory;
+    QQueue<QGCTile*>                    _queue;
+    QHash<QNetworkReply*, Request_t>    _replies;
+    QElapsedTimer                       _clock;
+    double                              _concurrency;
+    int                                 _maxConcurrency;
+    double                              _latencyAvg;            ///< Exponential moving average, -1 until the first reply
+    double                              _bestLatency;           ///< Lowest average seen, our estimate of an unloaded round trip
+    int                                 _completedSinceBackoff;
+
+    static QHash<QString, double>       _learnedConcurrency;    ///< Provider to concurrency at the end of the last download
+};
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief In memory tile cache tier in front of the SQLite tile database
+ *
+ */
+
+#include "QGCTileMemoryCache.h"
+
+#include <QMutexLocker>
+
+//-----------------------------------------------------------------------------
+QGCTileMemoryCache::QGCTileMemoryCache(quint64 maxSize)
+    : _hits(0)
+    , _misses(0)
+    , _evictions(0)
+{
+    setMaxSize(maxSize);
+}
+
+//-----------------------------------------------------------------------------
+int
+QGCTileMemoryCache::_cost(const QByteArray& img, const QString& format)
+{
+    //-- Account for the key and bookkeeping as well so tiny tiles can't blow the budget
+    return img.size() + format.size() * static_cast<int>(sizeof(QChar)) + 128;
+}
+
+//-----------------------------------------------------------------------------
+bool
+QGCTileMemoryCache::find(const QString& hash, QByteArray& img, QString& format)
+{
+    QMutexLocker lock(&_mutex);
+    //-- QCache::object() also moves the entry to the front of the LRU list
+    Entry* entry = _cache.object(hash);
+    if(!entry) {
+        _misses++;
+        return false;
+    }
+    _hits++;
+    //-- Implicitly shared, no deep copy
+    img     = entry->img;
+    format  = entry->format;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileMemoryCache::insert(const QString& hash, const QByteArray& img, const QString& format)
+{
+    if(img.isEmpty()) {
+        return;
+    }
+    Entry* entry  = new Entry;
+    entry->img    = img;
+    entry->format = format;
+    QMutexLocker lock(&_mutex);
+    int  before   = _cache.count();
+    bool replaced = _cache.contains(hash);
+    //-- QCache takes ownership of entry even if the insert fails
+    bool inserted = _cache.insert(hash, entry, _cost(img, format));
+    int  evicted  = before - (replaced ? 1 : 0) + (inserted ? 1 : 0) - _cache.count();
+    if(evicted > 0) {
+        _evictions += static_cast<quint64>(evicted);
+    }
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileMemoryCache::remove(const QString& hash)
+{
+    QMutexLocker lock(&_mutex);
+    _cache.remove(hash);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileMemoryCache::clear()
+{
+    QMutexLocker lock(&_mutex);
+    _cache.clear();
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCTileMemoryCache::setMaxSize(quint64 maxSize)
+{
+    //-- QCache uses a signed int for costs
+    if(maxSize > 1024 * 1024 * 1024) {
+        maxSize = 1024 * 1024 * 1024;
+    }
+    QMutexLocker lock(&_mutex);
+    int before = _cache.count();
+    _cache.setMaxCost(static_cast<int>(maxSize));
+    _evictions += static_cast<quint64>(before - _cache.count());
+}
+
+//-----------------------------------------------------------------------------
+QGCTileMemoryCacheStats
+QGCTileMemoryCache::stats() const
+{
+    QMutexLocker lock(&_mutex);
+    QGCTileMemoryCacheStats stats;
+    stats.hits      = _hits;
+    stats.misses    = _misses;
+    stats.evictions = _evictions;
+    stats.size      = static_cast<quint64>(_cache.totalCost());
+    stats.maxSize   = static_cast<quint64>(_cache.maxCost());
+    stats.count     = _cache.count();
+    return stats;
+}
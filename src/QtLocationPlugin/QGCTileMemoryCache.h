@@ -0,0 +1,67 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file
+ *   @brief In memory tile cache tier in front of the SQLite tile database
+ *
+ */
+
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+//-----------------------------------------------------------------------------
+class QGCTileMemoryCacheStats
+{
+public:
+    quint64     hits        = 0;
+    quint64     misses      = 0;
+    quint64     evictions   = 0;
+    quint64     size        = 0;    ///< Bytes currently held
+    quint64     maxSize     = 0;    ///< Byte budget
+    int         count       = 0;    ///< Tiles currently held
+};
+
+//-----------------------------------------------------------------------------
+// Byte budgeted LRU of raw (still encoded) tile images keyed by tile hash.
+// All methods are thread safe.
+class QGCTileMemoryCache
+{
+public:
+    QGCTileMemoryCache          (quint64 maxSize);
+
+    //-- Returns false on a miss, leaving img/format untouched
+    bool                        find            (const QString& hash, QByteArray& img, QString& format);
+    void                        insert          (const QString& hash, const QByteArray& img, const QString& format);
+    void                        remove          (const QString& hash);
+    void                        clear           ();
+    void                        setMaxSize      (quint64 maxSize);
+    QGCTileMemoryCacheStats     stats           () const;
+
+private:
+    class Entry
+    {
+    public:
+        QByteArray  img;
+        QString     format;
+    };
+
+    static int                  _cost           (const QByteArray& img, const QString& format);
+
+    mutable QMutex              _mutex;
+    QCache<QString, Entry>      _cache;         ///< Cost is in bytes
+    quint64                     _hits;
+    quint64                     _misses;
+    quint64                     _evictions;
+};
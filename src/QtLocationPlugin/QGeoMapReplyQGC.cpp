@@ -72,7 +72,7 @@ QGeoTiledMapReplyQGC::QGeoTiledMapReplyQGC(QNetworkAccessManager *networkManager
         setMapImageFormat("png");
         setFinished(true);
         setCached(false);
-    } else {
+    } else if(!_fetchFromMemoryCache(spec)) {
         QGCFetchTileTask* task = getQGCMapEngine()->createFetchTileTask(getQGCMapEngine()->urlFactory()->getTypeFromId(spec.mapId()), spec.x(), spec.y(), spec.zoom());
         connect(task, &QGCFetchTileTask::tileFetched, this, &QGeoTiledMapReplyQGC::cacheReply);
         connect(task, &QGCMapTask::error, this, &QGeoTiledMapReplyQGC::cacheError);
@@ -80,6 +80,32 @@ QGeoTiledMapReplyQGC::QGeoTiledMapReplyQGC(QNetworkAccessManager *networkManager
     }
 }
 
+//-----------------------------------------------------------------------------
+bool
+QGeoTiledMapReplyQGC::_fetchFromMemoryCache(const QGeoTileSpec &spec)
+{
+    QString type = getQGCMapEngine()->urlFactory()->getTypeFromId(spec.mapId());
+    QString hash = QGCMapEngine::getTileHash(type, spec.x(), spec.y(), spec.zoom());
+    QByteArray img;
+    QString format;
+    if(!getQGCMapEngine()->memoryCache()->find(hash, img, format)) {
+        return false;
+    }
+    //-- Served straight from memory, the cache worker thread is never involved
+    if(getQGCMapEngine()->urlFactory()->isElevation(spec.mapId())) {
+        //-- Nobody is connected to terrainDone yet, deliver it once we are back in the event loop
+        QMetaObject::invokeMethod(this, [this, img]() {
+            emit terrainDone(img, QNetworkReply::NoError);
+        }, Qt::QueuedConnection);
+    } else {
+        setMapImageData(img);
+        setMapImageFormat(format);
+        setFinished(true);
+        setCached(true);
+    }
+    return true;
+}
+
 //-----------------------------------------------------------------------------
 QGeoTiledMapReplyQGC::~QGeoTiledMapReplyQGC()
 {
@@ -209,6 +235,8 @@ QGeoTiledMapReplyQGC::cacheError(QGCMapTask::TaskType type, QString /*errorStrin
 void
 QGeoTiledMapReplyQGC::cacheReply(QGCCacheTile* tile)
 {
+    //-- Keep it in memory so the next request for this tile doesn't go back to the database
+    getQGCMapEngine()->memoryCache()->insert(tile->hash(), tile->img(), tile->format());
     //-- Test for a specialized, elevation data (not map tile)
     if( getQGCMapEngine()->urlFactory()->isElevation(tileSpec().mapId())){
         emit terrainDone(tile->img(), QNetworkReply::NoError);
@@ -73,6 +73,7 @@ private slots:
 
 private:
     void _clearReply            ();
+    bool _fetchFromMemoryCache  (const QGeoTileSpec &spec);
 
 private:
     QNetworkReply*          _reply;
@@ -209,8 +209,9 @@ Item {
     QGCFileDialog {
         id:             fileDialog
         folder:         QGroundControl.settingsManager.appSettings.missionSavePath
-        nameFilters:    ["Tile Sets (*.qgctiledb)"]
+        nameFilters:    ["Tile Sets (*.qgctiledb)", "MBTiles (*.mbtiles)"]
         fileExtension:  "qgctiledb"
+        fileExtension2: "mbtiles"
 
         onAcceptedForSave: {
             if (QGroundControl.mapEngineManager.exportSets(file)) {
@@ -63,6 +63,37 @@ QGCMapEngineManager::setToolbox(QGCToolbox *toolbox)
    qmlRegisterUncreatableType<QGCMapEngineManager>("QGroundControl.QGCMapEngineManager", 1, 0, "QGCMapEngineManager", "Reference only");
    connect(getQGCMapEngine(), &QGCMapEngine::updateTotals, this, &QGCMapEngineManager::_updateTotals);
    _updateDiskFreeSpace();
+   //-- Memory cache statistics change with every tile request, only publish them periodically
+   connect(&_memoryCacheStatsTimer, &QTimer::timeout, this, &QGCMapEngineManager::_updateMemoryCacheStats);
+   _memoryCacheStatsTimer.start(1000);
+}
+
+//-----------------------------------------------------------------------------
+void
+QGCMapEngineManager::_updateMemoryCacheStats()
+{
+    QGCTileMemoryCacheStats stats = getQGCMapEngine()->memoryCache()->stats();
+    if(stats.hits != _memoryCacheStats.hits || stats.misses != _memoryCacheStats.misses ||
+            stats.evictions != _memoryCacheStats.evictions || stats.size != _memoryCacheStats.size) {
+        _memoryCacheStats = stats;
+        emit memoryCacheStatsChanged();
+        qCDebug(QGCMapEngineManagerLog) << "Memory cache hits" << stats.hits << "misses" << stats.misses << "evictions" << stats.evictions << "tiles" << stats.count << "bytes" << stats.size;
+    }
+}
+
+//-----------------------------------------------------------------------------
+QString
+QGCMapEngineManager::memoryCacheSizeStr()
+{
+    return QGCMapEngine::bigSizeToString(_memoryCacheStats.size);
+}
+
+//-----------------------------------------------------------------------------
+double
+QGCMapEngineManager::memoryCacheHitRate()
+{
+    quint64 requests = _memoryCacheStats.hits + _memoryCacheStats.misses;
+    return requests ? static_cast<double>(_memoryCacheStats.hits) / static_cast<double>(requests) : 0.0;
 }
 
 //-----------------------------------------------------------------------------
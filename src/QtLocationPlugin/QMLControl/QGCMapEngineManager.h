@@ -20,6 +20,8 @@
 #include "QGCMapEngine.h"
 #include "QGCMapTileSet.h"
 
+#include <QTimer>
+
 Q_DECLARE_LOGGING_CATEGORY(QGCMapEngineManagerLog)
 
 class QGCMapEngineManager : public QGCTool
@@ -57,6 +59,13 @@ public:
     Q_PROPERTY(ImportAction         importAction    READ    importAction    WRITE  setImportAction   NOTIFY importActionChanged)
 
     Q_PROPERTY(bool                 importReplace   READ    importReplace   WRITE   setImportReplace   NOTIFY importReplaceChanged)
+    //-- In memory tile cache statistics
+    Q_PROPERTY(quint64              memoryCacheHits         READ memoryCacheHits        NOTIFY memoryCacheStatsChanged)
+    Q_PROPERTY(quint64              memoryCacheMisses       READ memoryCacheMisses      NOTIFY memoryCacheStatsChanged)
+    Q_PROPERTY(quint64              memoryCacheEvictions    READ memoryCacheEvictions   NOTIFY memoryCacheStatsChanged)
+    Q_PROPERTY(int                  memoryCacheCount        READ memoryCacheCount       NOTIFY memoryCacheStatsChanged)
+    Q_PROPERTY(QString              memoryCacheSizeStr      READ memoryCacheSizeStr     NOTIFY memoryCacheStatsChanged)
+    Q_PROPERTY(double               memoryCacheHitRate      READ memoryCacheHitRate     NOTIFY memoryCacheStatsChanged)
 
     Q_INVOKABLE void                loadTileSets            ();
     Q_INVOKABLE void                updateForCurrentView    (double lon0, double lat0, double lon1, double lat1, int minZoom, int maxZoom, const QString& mapName);
@@ -91,6 +100,12 @@ public:
     int                             actionProgress          () { return _actionProgress; }
     ImportAction                    importAction            () { return _importAction; }
     bool                            importReplace           () { return _importReplace; }
+    quint64                         memoryCacheHits         () { return _memoryCacheStats.hits; }
+    quint64                         memoryCacheMisses       () { return _memoryCacheStats.misses; }
+    quint64                         memoryCacheEvictions    () { return _memoryCacheStats.evictions; }
+    int                             memoryCacheCount        () { return _memoryCacheStats.count; }
+    QString                         memoryCacheSizeStr      ();
+    double                          memoryCacheHitRate      ();
 
     void                            setMaxMemCache          (quint32 size);
     void                            setMaxDiskCache         (quint32 size);
@@ -115,6 +130,7 @@ signals:
     void actionProgressChanged  ();
     void importActionChanged    ();
     void importReplaceChanged   ();
+    void memoryCacheStatsChanged();
 
 public slots:
     void taskError              (QGCMapTask::TaskType type, QString error);
@@ -127,6 +143,7 @@ private slots:
     void _resetCompleted        ();
     void _actionCompleted       ();
     void _actionProgressHandler (int percentage);
+    void _updateMemoryCacheStats();
 
 private:
     void _updateDiskFreeSpace   ();
@@ -149,6 +166,8 @@ private:
     int         _actionProgress;
     ImportAction _importAction;
     bool        _importReplace;
+    QTimer      _memoryCacheStatsTimer;
+    QGCTileMemoryCacheStats _memoryCacheStats;
 };
 
 #endif
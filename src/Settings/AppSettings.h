@@ -60,6 +60,8 @@ public:
     DEFINE_SETTINGFACT(usePairing)
     DEFINE_SETTINGFACT(saveCsvTelemetry)
     DEFINE_SETTINGFACT(firstTimeStart)
+    DEFINE_SETTINGFACT(terrainSource)
+    DEFINE_SETTINGFACT(terrainDEMPath)
 
 
     // Although this is a global setting it only affects ArduPilot vehicle since PX4 automatically starts the stream from the vehicle side
@@ -111,6 +113,10 @@ public:
     static const char* videoDirectory;
     static const char* crashDirectory;
 
+    // Values for terrainSource
+    static const int terrainSourceAirMap    = 0;
+    static const int terrainSourceLocalDEM  = 1;
+
 signals:
     void savePathsChanged();
 
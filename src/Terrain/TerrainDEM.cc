@@ -0,0 +1,560 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainDEM.h"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+QGC_LOGGING_CATEGORY(TerrainDEMLog, "TerrainDEMLog")
+
+// TIFF tags we need
+static const quint16 _tiffImageWidth        = 256;
+static const quint16 _tiffImageLength       = 257;
+static const quint16 _tiffBitsPerSample     = 258;
+static const quint16 _tiffCompression       = 259;
+static const quint16 _tiffStripOffsets      = 273;
+static const quint16 _tiffSamplesPerPixel   = 277;
+static const quint16 _tiffRowsPerStrip      = 278;
+static const quint16 _tiffSampleFormat      = 339;
+static const quint16 _tiffModelPixelScale   = 33550;
+static const quint16 _tiffModelTiepoint     = 33922;
+static const quint16 _tiffGeoKeyDirectory   = 34735;
+static const quint16 _tiffGdalNoData        = 42113;
+
+// GeoTIFF keys
+static const int _geoKeyModelType           = 1024;
+static const int _geoKeyRasterType          = 1025;
+static const int _geoModelTypeGeographic    = 2;
+static const int _geoRasterPixelIsPoint     = 2;
+
+TerrainDEMFile::TerrainDEMFile(const QString& path)
+    : _file     (path)
+    , _noData   (qQNaN())
+{
+
+}
+
+TerrainDEMFile::~TerrainDEMFile()
+{
+    if (_data) {
+        _file.unmap(const_cast<uchar*>(_data));
+    }
+}
+
+TerrainDEMFile* TerrainDEMFile::open(const QString& path, QString& errorString)
+{
+    TerrainDEMFile* demFile = new TerrainDEMFile(path);
+
+    if (!demFile->_file.open(QIODevice::ReadOnly)) {
+        errorString = demFile->_file.errorString();
+        delete demFile;
+        return nullptr;
+    }
+    demFile->_size = demFile->_file.size();
+    demFile->_data = demFile->_file.map(0, demFile->_size);
+    if (!demFile->_data) {
+        errorString = QStringLiteral("Unable to map file: %1").arg(demFile->_file.errorString());
+        delete demFile;
+        return nullptr;
+    }
+
+    QString suffix = QFileInfo(path).suffix().toLower();
+    bool success = suffix == QStringLiteral("hgt") ? demFile->_openHGT(errorString) : demFile->_openTIFF(errorString);
+    if (!success) {
+        delete demFile;
+        return nullptr;
+    }
+
+    qCDebug(TerrainDEMLog) << "Opened" << path << demFile->_rows << "x" << demFile->_cols << "n:s:w:e" << demFile->north() << demFile->south() << demFile->west() << demFile->east();
+    return demFile;
+}
+
+/// SRTM: square grid of big endian int16, north row first, named after the south west corner (N37W122.hgt)
+bool TerrainDEMFile::_openHGT(QString& errorString)
+{
+    static const QRegularExpression nameRegExp(QStringLiteral("^([NS])(\\d{2})([EW])(\\d{3})"), QRegularExpression::CaseInsensitiveOption);
+
+    QRegularExpressionMatch match = nameRegExp.match(QFileInfo(_file.fileName()).fileName());
+    if (!match.hasMatch()) {
+        errorString = QStringLiteral("HGT file name does not give its location");
+        return false;
+    }
+    double lat = match.captured(2).toDouble() * (match.captured(1).toUpper() == QStringLiteral("S") ? -1 : 1);
+    double lon = match.captured(4).toDouble() * (match.captured(3).toUpper() == QStringLiteral("W") ? -1 : 1);
+
+    int samples = static_cast<int>(std::lround(std::sqrt(static_cast<double>(_size / 2))));
+    if (samples < 2 || static_cast<qint64>(samples) * samples * 2 != _size) {
+        errorString = QStringLiteral("HGT file is not a square grid");
+        return false;
+    }
+
+    _sampleType = SampleInt16;
+    _bigEndian  = true;
+    _rows       = samples;
+    _cols       = samples;
+    _north      = lat + 1;
+    _west       = lon;
+    _latStep    = 1.0 / (samples - 1);
+    _lonStep    = 1.0 / (samples - 1);
+    _noData     = -32768;
+    _rowOffsets.resize(_rows);
+    for (int row = 0; row < _rows; row++) {
+        _rowOffsets[row] = static_cast<qint64>(row) * _cols * 2;
+    }
+
+    return true;
+}
+
+/// Baseline GeoTIFF: one band, uncompressed strips, int16/uint16/float32, geographic coordinates
+bool TerrainDEMFile::_openTIFF(QString& errorString)
+{
+    if (_size < 8 || (memcmp(_data, "II", 2) != 0 && memcmp(_data, "MM", 2) != 0)) {
+        errorString = QStringLiteral("Not a TIFF file");
+        return false;
+    }
+    _bigEndian = _data[0] == 'M';
+
+    auto inFile = [this](qint64 offset, qint64 bytes) {
+        return offset >= 0 && bytes >= 0 && offset + bytes <= _size;
+    };
+    auto u16 = [this](qint64 offset) -> quint16 {
+        return _bigEndian ? qFromBigEndian<quint16>(_data + offset) : qFromLittleEndian<quint16>(_data + offset);
+    };
+    auto u32 = [this](qint64 offset) -> quint32 {
+        return _bigEndian ? qFromBigEndian<quint32>(_data + offset) : qFromLittleEndian<quint32>(_data + offset);
+    };
+    auto u64 = [this](qint64 offset) -> quint64 {
+        return _bigEndian ? qFromBigEndian<quint64>(_data + offset) : qFromLittleEndian<quint64>(_data + offset);
+    };
+
+    if (u16(2) != 42) {
+        errorString = QStringLiteral("Unsupported TIFF version (BigTIFF?)");
+        return false;
+    }
+
+    // Read every IFD entry we care about into a list of numbers (or a string for ASCII)
+    QHash<quint16, QVector<double>> numbers;
+    QString                         noDataString;
+
+    qint64 ifdOffset = u32(4);
+    if (!inFile(ifdOffset, 2)) {
+        errorString = QStringLiteral("Bad TIFF directory offset");
+        return false;
+    }
+    int entryCount = u16(ifdOffset);
+    if (!inFile(ifdOffset + 2, entryCount * 12)) {
+        errorString = QStringLiteral("Truncated TIFF directory");
+        return false;
+    }
+    for (int i = 0; i < entryCount; i++) {
+        qint64  entry   = ifdOffset + 2 + (i * 12);
+        quint16 tag     = u16(entry);
+        quint16 type    = u16(entry + 2);
+        quint32 count   = u32(entry + 4);
+
+        int typeSize;
+        switch (type) {
+        case 1: case 2: case 6: case 7:
+            typeSize = 1;
+            break;
+        case 3: case 8:
+            typeSize = 2;
+            break;
+        case 4: case 9: case 11:
+            typeSize = 4;
+            break;
+        case 5: case 10: case 12:
+            typeSize = 8;
+            break;
+        default:
+            continue;
+        }
+        qint64 bytes = static_cast<qint64>(count) * typeSize;
+        qint64 valueOffset = bytes <= 4 ? entry + 8 : u32(entry + 8);
+        if (!inFile(valueOffset, bytes)) {
+            errorString = QStringLiteral("TIFF tag %1 points outside the file").arg(tag);
+            return false;
+        }
+
+        if (tag == _tiffGdalNoData && type == 2) {
+            // The count includes the terminating nul
+            const char* ascii = reinterpret_cast<const char*>(_data + valueOffset);
+            noDataString = QString::fromLatin1(ascii, static_cast<int>(qstrnlen(ascii, count))).trimmed();
+            continue;
+        }
+
+        QVector<double>& values = numbers[tag];
+        values.reserve(static_cast<int>(count));
+        for (quint32 j = 0; j < count; j++) {
+            qint64 offset = valueOffset + (j * typeSize);
+            switch (type) {
+            case 1: case 7:
+                values.append(_data[offset]);
+                break;
+            case 3:
+                values.append(u16(offset));
+                break;
+            case 8:
+                values.append(static_cast<qint16>(u16(offset)));
+                break;
+            case 4:
+                values.append(u32(offset));
+                break;
+            case 9:
+                values.append(static_cast<qint32>(u32(offset)));
+                break;
+            case 11: {
+                quint32 bits = u32(offset);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                values.append(static_cast<double>(value));
+                break;
+            }
+            case 12: {
+                quint64 bits = u64(offset);
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                values.append(value);
+                break;
+            }
+            default:
+                values.append(qQNaN());
+                break;
+            }
+        }
+    }
+
+    auto first = [&numbers](quint16 tag, double defaultValue) {
+        return numbers.contains(tag) && !numbers[tag].isEmpty() ? numbers[tag][0] : defaultValue;
+    };
+
+    _cols = static_cast<int>(first(_tiffImageWidth, 0));
+    _rows = static_cast<int>(first(_tiffImageLength, 0));
+    int bitsPerSample   = static_cast<int>(first(_tiffBitsPerSample, 1));
+    int sampleFormat    = static_cast<int>(first(_tiffSampleFormat, 1));
+    int rowsPerStrip    = static_cast<int>(first(_tiffRowsPerStrip, _rows));
+
+    if (_rows < 2 || _cols < 2) {
+        errorString = QStringLiteral("TIFF image too small");
+        return false;
+    }
+    if (first(_tiffCompression, 1) != 1) {
+        errorString = QStringLiteral("Compressed TIFF files are not supported");
+        return false;
+    }
+    if (first(_tiffSamplesPerPixel, 1) != 1) {
+        errorString = QStringLiteral("TIFF file has more than one band");
+        return false;
+    }
+    if (!numbers.contains(_tiffStripOffsets)) {
+        errorString = QStringLiteral("Tiled TIFF files are not supported");
+        return false;
+    }
+    if (bitsPerSample == 16 && sampleFormat == 2) {
+        _sampleType = SampleInt16;
+    } else if (bitsPerSample == 16 && sampleFormat == 1) {
+        _sampleType = SampleUInt16;
+    } else if (bitsPerSample == 32 && sampleFormat == 3) {
+        _sampleType = SampleFloat32;
+    } else {
+        errorString = QStringLiteral("Unsupported TIFF sample format %1 bits %2").arg(sampleFormat).arg(bitsPerSample);
+        return false;
+    }
+
+    // Georeferencing
+    const QVector<double>& scale    = numbers.value(_tiffModelPixelScale);
+    const QVector<double>& tiepoint = numbers.value(_tiffModelTiepoint);
+    if (scale.count() < 2 || tiepoint.count() < 6 || scale[0] <= 0 || scale[1] <= 0) {
+        errorString = QStringLiteral("TIFF file is not georeferenced");
+        return false;
+    }
+    int rasterType = 1;
+    const QVector<double>& geoKeys = numbers.value(_tiffGeoKeyDirectory);
+    for (int i = 4; i + 3 < geoKeys.count(); i += 4) {
+        int key = static_cast<int>(geoKeys[i]);
+        int value = static_cast<int>(geoKeys[i + 3]);
+        if (key == _geoKeyModelType && value != _geoModelTypeGeographic) {
+            errorString = QStringLiteral("Only geographic (lat/lon) GeoTIFF files are supported");
+            return false;
+        } else if (key == _geoKeyRasterType) {
+            rasterType = value;
+        }
+    }
+    // Sample positions are pixel centers unless the file says its pixels are points
+    double pixelOffset = rasterType == _geoRasterPixelIsPoint ? 0.0 : 0.5;
+    _lonStep    = scale[0];
+    _latStep    = scale[1];
+    _west       = tiepoint[3] + ((pixelOffset - tiepoint[0]) * _lonStep);
+    _north      = tiepoint[4] - ((pixelOffset - tiepoint[1]) * _latStep);
+
+    if (!noDataString.isEmpty()) {
+        bool ok;
+        double noData = noDataString.toDouble(&ok);
+        if (ok) {
+            _noData = noData;
+        }
+    }
+
+    // Row offsets through the strips
+    const QVector<double>& stripOffsets = numbers[_tiffStripOffsets];
+    int bytesPerSample = bitsPerSample / 8;
+    qint64 rowBytes = static_cast<qint64>(_cols) * bytesPerSample;
+    if (rowsPerStrip <= 0) {
+        rowsPerStrip = _rows;
+    }
+    _rowOffsets.resize(_rows);
+    for (int row = 0; row < _rows; row++) {
+        int strip = row / rowsPerStrip;
+        if (strip >= stripOffsets.count()) {
+            errorString = QStringLiteral("TIFF file is missing strips");
+            return false;
+        }
+        qint64 offset = static_cast<qint64>(stripOffsets[strip]) + ((row % rowsPerStrip) * rowBytes);
+        if (!inFile(offset, rowBytes)) {
+            errorString = QStringLiteral("TIFF strip extends past the end of the file");
+            return false;
+        }
+        _rowOffsets[row] = offset;
+    }
+
+    return true;
+}
+
+bool TerrainDEMFile::contains(double latitude, double longitude) const
+{
+    return latitude <= _north && latitude >= south() && longitude >= _west && longitude <= east();
+}
+
+double TerrainDEMFile::_value(int row, int col) const
+{
+    const uchar* p = _data + _rowOffsets[row];
+    double value;
+
+    switch (_sampleType) {
+    case SampleInt16:
+        p += col * 2;
+        value = _bigEndian ? qFromBigEndian<qint16>(p) : qFromLittleEndian<qint16>(p);
+        break;
+    case SampleUInt16:
+        p += col * 2;
+        value = _bigEndian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+        break;
+    case SampleFloat32: {
+        p += col * 4;
+        quint32 bits = _bigEndian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+        float floatValue;
+        memcpy(&floatValue, &bits, sizeof(floatValue));
+        value = static_cast<double>(floatValue);
+        break;
+    }
+    default:
+        value = qQNaN();
+        break;
+    }
+
+    return value == _noData ? qQNaN() : value;
+}
+
+void TerrainDEMFile::sample(const double* latitudes, const double* longitudes, double* heights, int count) const
+{
+    // Grid positions and weights first, in a plain loop over arrays the compiler can vectorize. The corner
+    // fetches that follow are gathers from the mapping.
+    QVector<int>    rows(count);
+    QVector<int>    cols(count);
+    QVector<double> rowWeights(count);
+    QVector<double> colWeights(count);
+
+    const double maxRow = _rows - 2;
+    const double maxCol = _cols - 2;
+    for (int i = 0; i < count; i++) {
+        double row = (_north - latitudes[i]) / _latStep;
+        double col = (longitudes[i] - _west) / _lonStep;
+        double row0 = std::fmin(std::fmax(std::floor(row), 0.0), maxRow);
+        double col0 = std::fmin(std::fmax(std::floor(col), 0.0), maxCol);
+        rows[i]         = static_cast<int>(row0);
+        cols[i]         = static_cast<int>(col0);
+        rowWeights[i]   = row - row0;
+        colWeights[i]   = col - col0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int     row = rows[i];
+        int     col = cols[i];
+        double  tr  = rowWeights[i];
+        double  tc  = colWeights[i];
+        double  v00 = _value(row,     col);
+        double  v01 = _value(row,     col + 1);
+        double  v10 = _value(row + 1, col);
+        double  v11 = _value(row + 1, col + 1);
+
+        if (qIsNaN(v00) || qIsNaN(v01) || qIsNaN(v10) || qIsNaN(v11)) {
+            // Void in the neighborhood, use the nearest corner that has data
+            double corners[4] = { v00, v01, v10, v11 };
+            double distances[4] = { tr + tc, tr + (1 - tc), (1 - tr) + tc, (1 - tr) + (1 - tc) };
+            double best = qQNaN();
+            double bestDistance = 3;
+            for (int j = 0; j < 4; j++) {
+                if (!qIsNaN(corners[j]) && distances[j] < bestDistance) {
+                    best = corners[j];
+                    bestDistance = distances[j];
+                }
+            }
+            heights[i] = best;
+        } else {
+            double top      = v00 + ((v01 - v00) * tc);
+            double bottom   = v10 + ((v11 - v10) * tc);
+            heights[i] = top + ((bottom - top) * tr);
+        }
+    }
+}
+
+TerrainDEMStore::TerrainDEMStore(void)
+{
+
+}
+
+TerrainDEMStore::~TerrainDEMStore()
+{
+    _clear();
+}
+
+void TerrainDEMStore::setPath(const QString& path)
+{
+    QWriteLocker locker(&_lock);
+
+    if (path == _path) {
+        return;
+    }
+    _path = path;
+    _clear();
+    _scan();
+}
+
+QString TerrainDEMStore::path(void) const
+{
+    QReadLocker locker(&_lock);
+    return _path;
+}
+
+int TerrainDEMStore::fileCount(void) const
+{
+    QReadLocker locker(&_lock);
+    return _files.count();
+}
+
+void TerrainDEMStore::_clear(void)
+{
+    _cells.clear();
+    qDeleteAll(_files);
+    _files.clear();
+}
+
+int TerrainDEMStore::_cellKey(double latitude, double longitude)
+{
+    int lat = qBound(-90, static_cast<int>(std::floor(latitude)), 90);
+    int lon = qBound(-180, static_cast<int>(std::floor(longitude)), 180);
+    return ((lat + 90) * 361) + (lon + 180);
+}
+
+void TerrainDEMStore::_scan(void)
+{
+    if (_path.isEmpty()) {
+        return;
+    }
+
+    QDirIterator it(_path, QStringList() << QStringLiteral("*.hgt") << QStringLiteral("*.HGT") << QStringLiteral("*.tif") << QStringLiteral("*.TIF") << QStringLiteral("*.tiff") << QStringLiteral("*.TIFF"),
+                    QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString fileName = it.next();
+        QString errorString;
+        TerrainDEMFile* demFile = TerrainDEMFile::open(fileName, errorString);
+        if (!demFile) {
+            qCWarning(TerrainDEMLog) << "Skipping elevation file" << fileName << errorString;
+            continue;
+        }
+        _files.append(demFile);
+
+        // A file only ever needs to be looked for in the cells it overlaps
+        int south = static_cast<int>(std::floor(demFile->south()));
+        int north = static_cast<int>(std::floor(demFile->north()));
+        int west  = static_cast<int>(std::floor(demFile->west()));
+        int east  = static_cast<int>(std::floor(demFile->east()));
+        for (int lat = south; lat <= north; lat++) {
+            for (int lon = west; lon <= east; lon++) {
+                _cells[_cellKey(lat, lon)].append(demFile);
+            }
+        }
+    }
+
+    qCDebug(TerrainDEMLog) << "Elevation files in" << _path << _files.count();
+}
+
+const TerrainDEMFile* TerrainDEMStore::_fileFor(double latitude, double longitude) const
+{
+    auto it = _cells.constFind(_cellKey(latitude, longitude));
+    if (it == _cells.constEnd()) {
+        return nullptr;
+    }
+    for (const TerrainDEMFile* demFile: it.value()) {
+        if (demFile->contains(latitude, longitude)) {
+            return demFile;
+        }
+    }
+    return nullptr;
+}
+
+bool TerrainDEMStore::heights(const QList<QGeoCoordinate>& coordinates, QList<double>& heights) const
+{
+    int count = coordinates.count();
+    QVector<double> latitudes(count);
+    QVector<double> longitudes(count);
+    QVector<double> results(count);
+
+    for (int i = 0; i < count; i++) {
+        latitudes[i]  = coordinates[i].latitude();
+        longitudes[i] = coordinates[i].longitude();
+    }
+
+    QReadLocker locker(&_lock);
+
+    // Sample runs of coordinates that fall in the same file together
+    int runStart = 0;
+    while (runStart < count) {
+        const TerrainDEMFile* demFile = _fileFor(latitudes[runStart], longitudes[runStart]);
+        if (!demFile) {
+            qCDebug(TerrainDEMLog) << "No elevation file for" << coordinates[runStart];
+            return false;
+        }
+        int runEnd = runStart + 1;
+        while (runEnd < count && demFile->contains(latitudes[runEnd], longitudes[runEnd])) {
+            runEnd++;
+        }
+        demFile->sample(&latitudes[runStart], &longitudes[runStart], &results[runStart], runEnd - runStart);
+        runStart = runEnd;
+    }
+
+    heights.clear();
+    heights.reserve(count);
+    for (int i = 0; i < count; i++) {
+        if (qIsNaN(results[i])) {
+            qCDebug(TerrainDEMLog) << "Void in elevation data at" << coordinates[i];
+            heights.clear();
+            return false;
+        }
+        heights.append(results[i]);
+    }
+
+    return true;
+}
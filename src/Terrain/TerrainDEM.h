@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "QGCLoggingCategory.h"
+
+#include <QFile>
+#include <QGeoCoordinate>
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(TerrainDEMLog)
+
+/// A single elevation grid file (SRTM .hgt or uncompressed GeoTIFF), memory mapped. Heights are read straight
+/// out of the mapping, nothing is decoded up front.
+class TerrainDEMFile
+{
+public:
+    ~TerrainDEMFile();
+
+    /// Maps the file and reads its geometry
+    ///     @param[out] errorString Reason the file can't be used
+    /// @return nullptr on error
+    static TerrainDEMFile* open(const QString& path, QString& errorString);
+
+    QString path        (void) const { return _file.fileName(); }
+    double  north       (void) const { return _north; }
+    double  south       (void) const { return _north - (_rows - 1) * _latStep; }
+    double  west        (void) const { return _west; }
+    double  east        (void) const { return _west + (_cols - 1) * _lonStep; }
+    double  latSpacing  (void) const { return _latStep; }
+    double  lonSpacing  (void) const { return _lonStep; }
+
+    bool contains(double latitude, double longitude) const;
+
+    /// Bilinear interpolation of count coordinates, which must all be inside the file. Voids are skipped in favor
+    /// of the nearest valid corner, NaN if all four are void.
+    void sample(const double* latitudes, const double* longitudes, double* heights, int count) const;
+
+private:
+    enum SampleType {
+        SampleInt16,
+        SampleUInt16,
+        SampleFloat32,
+    };
+
+    TerrainDEMFile(const QString& path);
+
+    bool    _openHGT    (QString& errorString);
+    bool    _openTIFF   (QString& errorString);
+    double  _value      (int row, int col) const;
+
+    QFile               _file;
+    const uchar*        _data           = nullptr;
+    qint64              _size           = 0;
+    SampleType          _sampleType     = SampleInt16;
+    bool                _bigEndian      = false;
+    int                 _rows           = 0;
+    int                 _cols           = 0;
+    QVector<qint64>     _rowOffsets;                ///< Byte offset of each row in the mapping
+    double              _north          = 0;        ///< Latitude of the first row of samples
+    double              _west           = 0;        ///< Longitude of the first column of samples
+    double              _latStep        = 0;        ///< Degrees between rows, going south
+    double              _lonStep        = 0;        ///< Degrees between columns, going east
+    double              _noData;                    ///< Void marker, NaN if the file has none
+};
+
+/// Directory of elevation files, indexed by one degree cell. Thread safe, lookups can run in parallel with
+/// each other but not with a rescan.
+class TerrainDEMStore
+{
+public:
+    TerrainDEMStore(void);
+    ~TerrainDEMStore();
+
+    /// Rescans if the directory changed
+    void setPath(const QString& path);
+
+    QString path        (void) const;
+    int     fileCount   (void) const;
+
+    /// Heights for all coordinates
+    /// @return false: some coordinate is not covered by any file, heights is left empty
+    bool heights(const QList<QGeoCoordinate>& coordinates, QList<double>& heights) const;
+
+private:
+    static int _cellKey(double latitude, double longitude);
+
+    // Callers must hold _lock
+    const TerrainDEMFile* _fileFor(double latitude, double longitude) const;
+    void _clear(void);
+    void _scan(void);
+
+    mutable QReadWriteLock                      _lock;
+    QString                                     _path;
+    QList<TerrainDEMFile*>                      _files;
+    QHash<int, QVector<TerrainDEMFile*>>        _cells;     ///< One degree cell to the files overlapping it
+};
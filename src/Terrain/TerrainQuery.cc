@@ -11,6 +11,10 @@
 #include "QGCMapEngine.h"
 #include "QGeoMapReplyQGC.h"
 #include "QGCApplication.h"
+#include "SettingsManager.h"
+#include "AppSettings.h"
+#include "TerrainDEM.h"
+#include "QGroundControlQmlGlobal.h"
 
 #include <QUrl>
 #include <QUrlQuery>
@@ -22,6 +26,8 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QTimer>
+#include <QVector>
+#include <QtMath>
 #include <QtLocation/private/qgeotilespec_p.h>
 
 #include <cmath>
@@ -29,8 +35,62 @@
 QGC_LOGGING_CATEGORY(TerrainQueryLog, "TerrainQueryLog")
 QGC_LOGGING_CATEGORY(TerrainQueryVerboseLog, "TerrainQueryVerboseLog")
 
-Q_GLOBAL_STATIC(TerrainAtCoordinateBatchManager, _TerrainAtCoordinateBatchManager)
+Q_GLOBAL_STATIC(TerrainAtCoordinateScheduler, _terrainAtCoordinateScheduler)
 Q_GLOBAL_STATIC(TerrainTileManager, _terrainTileManager)
+Q_GLOBAL_STATIC(TerrainDEMStore, _terrainDEMStore)
+
+/// Local elevation files are checked for on every terrain query. Whether they are in use is cached here and only
+/// worked out again when one of the settings changes.
+class TerrainLocalDEMState
+{
+public:
+    TerrainLocalDEMState(void)
+        : _enabled(0)
+    {
+        AppSettings* appSettings = qgcApp()->toolbox()->settingsManager()->appSettings();
+        QObject::connect(appSettings->terrainSource(),  &Fact::rawValueChanged, appSettings, [this]() { _update(); });
+        QObject::connect(appSettings->terrainDEMPath(), &Fact::rawValueChanged, appSettings, [this]() { _update(); });
+        _update();
+    }
+
+    bool enabled(void) const { return _enabled.loadAcquire(); }
+
+private:
+    void _update(void)
+    {
+        AppSettings* appSettings = qgcApp()->toolbox()->settingsManager()->appSettings();
+        bool enabled = false;
+        if (appSettings->terrainSource()->rawValue().toInt() == AppSettings::terrainSourceLocalDEM) {
+            // Only rescans when the directory changed
+            _terrainDEMStore->setPath(appSettings->terrainDEMPath()->rawValue().toString());
+            enabled = _terrainDEMStore->fileCount() > 0;
+        }
+        _enabled.storeRelease(enabled ? 1 : 0);
+    }
+
+    QAtomicInt _enabled;
+};
+
+Q_GLOBAL_STATIC(TerrainLocalDEMState, _terrainLocalDEMState)
+
+/// Coordinates every TerrainTile::terrainAltitudeSpacing meters along a path, ending exactly on toCoord
+static QList<QGeoCoordinate> _pathCoordinates(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, double& latStep, double& lonStep)
+{
+    QList<QGeoCoordinate> coordinates;
+    double lat = fromCoord.latitude();
+    double lon = fromCoord.longitude();
+    double steps = ceil(toCoord.distanceTo(fromCoord) / TerrainTile::terrainAltitudeSpacing);
+    double latDiff = toCoord.latitude() - lat;
+    double lonDiff = toCoord.longitude() - lon;
+    for (double i = 0.0; i <= steps; i = i + 1) {
+        coordinates.append(QGeoCoordinate(lat + latDiff * i / steps, lon + lonDiff * i / steps));
+    }
+    // We always have one too many and we always want the last one to be the endpoint
+    coordinates.last() = toCoord;
+    latStep = coordinates[1].latitude() - coordinates[0].latitude();
+    lonStep = coordinates[1].longitude() - coordinates[0].longitude();
+    return coordinates;
+}
 
 TerrainAirMapQuery::TerrainAirMapQuery(QObject* parent)
     : TerrainQueryInterface(parent)
@@ -286,7 +346,7 @@ void TerrainOfflineAirMapQuery::requestCoordinateHeights(const QList<QGeoCoordin
         return;
     }
 
-    _terrainTileManager->addCoordinateQuery(this, coordinates);
+    _terrainTileManager->addCoordinateQuery(this, coordinates, _highPriority);
 }
 
 void TerrainOfflineAirMapQuery::requestPathHeights(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord)
@@ -296,7 +356,7 @@ void TerrainOfflineAirMapQuery::requestPathHeights(const QGeoCoordinate& fromCoo
         return;
     }
 
-    _terrainTileManager->addPathQuery(this, fromCoord, toCoord);
+    _terrainTileManager->addPathQuery(this, fromCoord, toCoord, _highPriority);
 }
 
 void TerrainOfflineAirMapQuery::requestCarpetHeights(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly)
@@ -328,72 +388,161 @@ void TerrainOfflineAirMapQuery::_signalCarpetHeights(bool success, double minHei
     emit carpetHeightsReceived(success, minHeight, maxHeight, carpet);
 }
 
-TerrainTileManager::TerrainTileManager(void)
+TerrainLocalDEMQuery::TerrainLocalDEMQuery(QObject* parent)
+    : TerrainQueryInterface(parent)
 {
 
 }
 
-void TerrainTileManager::addCoordinateQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates)
+bool TerrainLocalDEMQuery::enabled(void)
 {
-    qCDebug(TerrainQueryLog) << "TerrainTileManager::addCoordinateQuery count" << coordinates.count();
+    return _terrainLocalDEMState->enabled();
+}
 
-    if (coordinates.length() > 0) {
-        bool error;
-        QList<double> altitudes;
+bool TerrainLocalDEMQuery::coordinateHeights(const QList<QGeoCoordinate>& coordinates, QList<double>& heights)
+{
+    return enabled() && _terrainDEMStore->heights(coordinates, heights);
+}
 
-        if (!getAltitudesForCoordinates(coordinates, altitudes, error)) {
-            qCDebug(TerrainQueryLog) << "TerrainTileManager::addPathQuery queue count" << _requestQueue.count();
-            QueuedRequestInfo_t queuedRequestInfo = { terrainQueryInterface, QueryMode::QueryModeCoordinates, 0, 0, coordinates };
-            _requestQueue.append(queuedRequestInfo);
-            return;
-        }
+bool TerrainLocalDEMQuery::pathHeights(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, double& latStep, double& lonStep, QList<double>& heights)
+{
+    if (!enabled()) {
+        return false;
+    }
+    QList<QGeoCoordinate> coordinates = _pathCoordinates(fromCoord, toCoord, latStep, lonStep);
+    return _terrainDEMStore->heights(coordinates, heights);
+}
 
-        if (error) {
-            QList<double> noAltitudes;
-            qCWarning(TerrainQueryLog) << "addCoordinateQuery: signalling failure due to internal error";
-            terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-        } else {
-            qCDebug(TerrainQueryLog) << "addCoordinateQuery: All altitudes taken from cached data";
-            terrainQueryInterface->_signalCoordinateHeights(coordinates.count() == altitudes.count(), altitudes);
+bool TerrainLocalDEMQuery::carpetHeights(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly, double& minHeight, double& maxHeight, QList<QList<double>>& carpet)
+{
+    if (!enabled()) {
+        return false;
+    }
+
+    // Grid at roughly the same spacing as the AirMap carpet, rows go south to north
+    const int   maxGridSize = 1000;
+    double      metersPerDegreeLat = 111320.0;
+    double      metersPerDegreeLon = qMax(1.0, metersPerDegreeLat * cos(qDegreesToRadians(swCoord.latitude())));
+    double      latSpan = neCoord.latitude() - swCoord.latitude();
+    double      lonSpan = neCoord.longitude() - swCoord.longitude();
+    int         gridSizeLat = qBound(2, static_cast<int>(ceil(latSpan * metersPerDegreeLat / TerrainTile::terrainAltitudeSpacing)) + 1, maxGridSize);
+    int         gridSizeLon = qBound(2, static_cast<int>(ceil(lonSpan * metersPerDegreeLon / TerrainTile::terrainAltitudeSpacing)) + 1, maxGridSize);
+
+    minHeight = qQNaN();
+    maxHeight = qQNaN();
+    carpet.clear();
+
+    QList<QGeoCoordinate> row;
+    QList<double> rowHeights;
+    for (int i = 0; i < gridSizeLat; i++) {
+        double lat = swCoord.latitude() + (latSpan * i / (gridSizeLat - 1));
+        row.clear();
+        for (int j = 0; j < gridSizeLon; j++) {
+            row.append(QGeoCoordinate(lat, swCoord.longitude() + (lonSpan * j / (gridSizeLon - 1))));
+        }
+        if (!_terrainDEMStore->heights(row, rowHeights)) {
+            carpet.clear();
+            return false;
+        }
+        for (double height: rowHeights) {
+            if (qIsNaN(minHeight) || height < minHeight) {
+                minHeight = height;
+            }
+            if (qIsNaN(maxHeight) || height > maxHeight) {
+                maxHeight = height;
+            }
+        }
+        if (!statsOnly) {
+            carpet.append(rowHeights);
         }
     }
+
+    return true;
 }
 
-void TerrainTileManager::addPathQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate &startPoint, const QGeoCoordinate &endPoint)
+void TerrainLocalDEMQuery::requestCoordinateHeights(const QList<QGeoCoordinate>& coordinates)
 {
-    // Convert to individual coordinate queries
-    QList<QGeoCoordinate> coordinates;
-    double lat = startPoint.latitude();
-    double lon = startPoint.longitude();
-    double steps = ceil(endPoint.distanceTo(startPoint) / TerrainTile::terrainAltitudeSpacing);
-    double latDiff = endPoint.latitude() - lat;
-    double lonDiff = endPoint.longitude() - lon;
-    for (double i = 0.0; i <= steps; i = i + 1) {
-        coordinates.append(QGeoCoordinate(lat + latDiff * i / steps, lon + lonDiff * i / steps));
+    QList<double> heights;
+    bool success = coordinateHeights(coordinates, heights);
+    emit coordinateHeightsReceived(success, heights);
+}
+
+void TerrainLocalDEMQuery::requestPathHeights(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord)
+{
+    double latStep = qQNaN();
+    double lonStep = qQNaN();
+    QList<double> heights;
+    bool success = pathHeights(fromCoord, toCoord, latStep, lonStep, heights);
+    emit pathHeightsReceived(success, latStep, lonStep, heights);
+}
+
+void TerrainLocalDEMQuery::requestCarpetHeights(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly)
+{
+    double minHeight, maxHeight;
+    QList<QList<double>> carpet;
+    bool success = carpetHeights(swCoord, neCoord, statsOnly, minHeight, maxHeight, carpet);
+    emit carpetHeightsReceived(success, minHeight, maxHeight, carpet);
+}
+
+TerrainTileManager::TerrainTileManager(void)
+{
+    connect(&_tileStore, &TerrainTileStore::diskLoadComplete, this, &TerrainTileManager::_diskLoadComplete);
+}
+
+void TerrainTileManager::addCoordinateQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates, bool highPriority)
+{
+    qCDebug(TerrainQueryLog) << "TerrainTileManager::addCoordinateQuery count" << coordinates.count();
+
+    if (coordinates.length() > 0) {
+        _queueRequest(terrainQueryInterface, QueryMode::QueryModeCoordinates, 0, 0, coordinates, highPriority);
     }
-    // We always have one too many and we always want the last one to be the endpoint
-    coordinates.last() = endPoint;
-    double latStep = coordinates[1].latitude() - coordinates[0].latitude();
-    double lonStep = coordinates[1].longitude() - coordinates[0].longitude();
+}
+
+void TerrainTileManager::addPathQuery(TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate &startPoint, const QGeoCoordinate &endPoint, bool highPriority)
+{
+    // Convert to individual coordinate queries
+    double latStep, lonStep;
+    QList<QGeoCoordinate> coordinates = _pathCoordinates(startPoint, endPoint, latStep, lonStep);
 
     qCDebug(TerrainQueryLog) << "TerrainTileManager::addPathQuery start:end:coordCount" << startPoint << endPoint << coordinates.count();
 
-    bool error;
-    QList<double> altitudes;
-    if (!getAltitudesForCoordinates(coordinates, altitudes, error)) {
-        qCDebug(TerrainQueryLog) << "TerrainTileManager::addPathQuery queue count" << _requestQueue.count();
-        QueuedRequestInfo_t queuedRequestInfo = { terrainQueryInterface, QueryMode::QueryModePath, latStep, lonStep, coordinates };
-        _requestQueue.append(queuedRequestInfo);
+    _queueRequest(terrainQueryInterface, QueryMode::QueryModePath, latStep, lonStep, coordinates, highPriority);
+}
+
+void TerrainTileManager::_queueRequest(TerrainOfflineAirMapQuery* terrainQueryInterface, QueryMode queryMode, double latStep, double lonStep, const QList<QGeoCoordinate>& coordinates, bool highPriority)
+{
+    bool                            error;
+    QList<double>                   altitudes;
+    QHash<QString, QGeoCoordinate>  missingTiles;
+
+    QueuedRequestInfo_t requestInfo = { terrainQueryInterface, queryMode, latStep, lonStep, coordinates, QSet<QString>() };
+
+    if (!_lookupAltitudes(coordinates, altitudes, error, &missingTiles)) {
+        requestInfo.missingTiles = QSet<QString>::fromList(missingTiles.keys());
+        _requestQueue.append(requestInfo);
+        qCDebug(TerrainQueryLog) << "TerrainTileManager::_queueRequest waiting for tiles:queue count" << missingTiles.count() << _requestQueue.count();
+        _requestTiles(missingTiles, highPriority);
         return;
     }
 
     if (error) {
-        QList<double> noAltitudes;
-        qCWarning(TerrainQueryLog) << "addPathQuery: signalling failure due to internal error";
-        terrainQueryInterface->_signalPathHeights(false, latStep, lonStep, noAltitudes);
+        qCWarning(TerrainQueryLog) << "_queueRequest: signalling failure due to internal error";
     } else {
-        qCDebug(TerrainQueryLog) << "addPathQuery: All altitudes taken from cached data";
-        terrainQueryInterface->_signalPathHeights(coordinates.count() == altitudes.count(), latStep, lonStep, altitudes);
+        qCDebug(TerrainQueryLog) << "_queueRequest: All altitudes taken from cached data";
+    }
+    _signalRequest(requestInfo, !error && coordinates.count() == altitudes.count(), error ? QList<double>() : altitudes);
+}
+
+void TerrainTileManager::_signalRequest(const QueuedRequestInfo_t& requestInfo, bool success, const QList<double>& altitudes)
+{
+    if (!requestInfo.terrainQueryInterface) {
+        // Query object went away while we were waiting for tiles
+        return;
+    }
+    if (requestInfo.queryMode == QueryMode::QueryModeCoordinates) {
+        requestInfo.terrainQueryInterface->_signalCoordinateHeights(success, altitudes);
+    } else if (requestInfo.queryMode == QueryMode::QueryModePath) {
+        requestInfo.terrainQueryInterface->_signalPathHeights(success, requestInfo.latStep, requestInfo.lonStep, altitudes);
     }
 }
 
@@ -401,143 +550,243 @@ void TerrainTileManager::addPathQuery(TerrainOfflineAirMapQuery* terrainQueryInt
 ///     @param[out] error true: altitude not returned due to error, false: altitudes returned
 /// @return true: altitude returned (check error as well), false: database query queued (altitudes not returned)
 bool TerrainTileManager::getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error)
+{
+    QHash<QString, QGeoCoordinate> missingTiles;
+
+    if (!_lookupAltitudes(coordinates, altitudes, error, &missingTiles)) {
+        altitudes.clear();
+        _requestTiles(missingTiles, false /* highPriority */);
+        return false;
+    }
+    return true;
+}
+
+bool TerrainTileManager::cachedAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error)
+{
+    if (!_lookupAltitudes(coordinates, altitudes, error, nullptr)) {
+        altitudes.clear();
+        return false;
+    }
+    return true;
+}
+
+/// Looks up all coordinates in cached tiles
+///     @param[out] missingTiles Tiles which are not cached, with a coordinate in each. nullptr: stop at the first one.
+/// @return true: all tiles were available
+bool TerrainTileManager::_lookupAltitudes(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error, QHash<QString, QGeoCoordinate>* missingTiles)
 {
     error = false;
 
-    for (const QGeoCoordinate& coordinate: coordinates) {
-        QString tileHash = _getTileHash(coordinate);
-        qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates hash:coordinate" << tileHash << coordinate;
-
-        _tilesMutex.lock();
-        if (_tiles.contains(tileHash)) {
-            if (_tiles[tileHash].isIn(coordinate)) {
-                double elevation = _tiles[tileHash].elevation(coordinate);
-                if (qIsNaN(elevation)) {
-                    error = true;
-                    qCWarning(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates Internal Error: missing elevation in tile cache";
-                } else {
-                    qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates returning elevation from tile cache" << elevation;
-                }
-                altitudes.push_back(elevation);
-            } else {
-                qCWarning(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates Internal Error: coordinate not in tile region";
-                altitudes.push_back(qQNaN());
-                error = true;
-            }
-        } else {
-            if (_state != State::Downloading) {
-                QNetworkRequest request = getQGCMapEngine()->urlFactory()->getTileURL("Airmap Elevation", getQGCMapEngine()->urlFactory()->long2tileX("Airmap Elevation",coordinate.longitude(), 1), getQGCMapEngine()->urlFactory()->lat2tileY("Airmap Elevation", coordinate.latitude(), 1), 1, &_networkManager);
-                qCDebug(TerrainQueryLog) << "TerrainTileManager::getAltitudesForCoordinates query from database" << request.url();
-                QGeoTileSpec spec;
-                spec.setX(getQGCMapEngine()->urlFactory()->long2tileX("Airmap Elevation", coordinate.longitude(), 1));
-                spec.setY(getQGCMapEngine()->urlFactory()->lat2tileY("Airmap Elevation", coordinate.latitude(), 1));
-                spec.setZoom(1);
-                spec.setMapId(getQGCMapEngine()->urlFactory()->getIdFromType("Airmap Elevation"));
-                QGeoTiledMapReplyQGC* reply = new QGeoTiledMapReplyQGC(&_networkManager, request, spec);
-                connect(reply, &QGeoTiledMapReplyQGC::terrainDone, this, &TerrainTileManager::_terrainDone);
-                _state = State::Downloading;
+    // Split the coordinates into flat arrays once, tiles sample whole runs out of them
+    const int       count = coordinates.count();
+    QVector<double> latitudes(count);
+    QVector<double> longitudes(count);
+    QVector<double> heights(count);
+    for (int i = 0; i < count; i++) {
+        latitudes[i]    = coordinates[i].latitude();
+        longitudes[i]   = coordinates[i].longitude();
+    }
+
+    // Consecutive coordinates almost always fall in the same tile. Only go to the store (and build a tile hash) when
+    // a coordinate leaves the current tile, then sample the whole run in one batch.
+    int i = 0;
+    while (i < count) {
+        const QGeoCoordinate&   coordinate  = coordinates[i];
+        QString                 hash        = tileHash(coordinate);
+        TerrainTile             tile;
+
+        // Only look a missing tile up once, the coordinates following it are likely in it as well
+        if (missingTiles && missingTiles->contains(hash)) {
+            i++;
+            continue;
+        }
+        if (!_tileStore.find(hash, tile)) {
+            if (!missingTiles) {
+                return false;
             }
-            _tilesMutex.unlock();
+            missingTiles->insert(hash, coordinate);
+            i++;
+            continue;
+        }
 
-            return false;
+        int runEnd = i + 1;
+        while (runEnd < count && tile.contains(latitudes[runEnd], longitudes[runEnd])) {
+            runEnd++;
         }
-        _tilesMutex.unlock();
+        qCDebug(TerrainQueryVerboseLog) << "TerrainTileManager::_lookupAltitudes hash:first coordinate:run length" << hash << coordinate << runEnd - i;
+        tile.elevations(latitudes.constData() + i, longitudes.constData() + i, heights.data() + i, runEnd - i);
+        i = runEnd;
+    }
+
+    if (missingTiles && !missingTiles->isEmpty()) {
+        return false;
+    }
+
+    altitudes.reserve(altitudes.count() + count);
+    for (double height: heights) {
+        if (qIsNaN(height)) {
+            error = true;
+        }
+        altitudes.push_back(height);
+    }
+    if (error) {
+        qCWarning(TerrainQueryLog) << "TerrainTileManager::_lookupAltitudes Internal Error: coordinate not in tile region or missing elevation in tile cache";
     }
 
     return true;
 }
 
-void TerrainTileManager::_tileFailed(void)
+void TerrainTileManager::_requestTiles(const QHash<QString, QGeoCoordinate>& tiles, bool highPriority)
+{
+    for (auto it = tiles.constBegin(); it != tiles.constEnd(); ++it) {
+        auto download = _tileDownloads.find(it.key());
+        if (download == _tileDownloads.end()) {
+            // Tiles which were saved earlier only need to come back from disk
+            TileDownload_t tileDownload = { it.value(), highPriority, false, true };
+            _tileDownloads.insert(it.key(), tileDownload);
+            _tileStore.load(it.key());
+        } else if (highPriority) {
+            download->highPriority = true;
+        }
+    }
+    _startDownloads();
+}
+
+void TerrainTileManager::_diskLoadComplete(QString hash, bool found)
 {
-    QList<double>    noAltitudes;
+    auto download = _tileDownloads.find(hash);
+    if (download == _tileDownloads.end() || !download->checkingDisk) {
+        return;
+    }
+    if (found) {
+        _tileDownloads.erase(download);
+        _tileAvailable(hash, false /* tileFailed */);
+    } else {
+        download->checkingDisk = false;
+        _startDownloads();
+    }
+}
 
-    for (const QueuedRequestInfo_t& requestInfo: _requestQueue) {
-        if (requestInfo.queryMode == QueryMode::QueryModeCoordinates) {
-            requestInfo.terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-        } else if (requestInfo.queryMode == QueryMode::QueryModePath) {
-            requestInfo.terrainQueryInterface->_signalPathHeights(false, requestInfo.latStep, requestInfo.lonStep, noAltitudes);
+void TerrainTileManager::_startDownloads(void)
+{
+    // The map center stands in for what the user is looking at
+    QGeoCoordinate mapCenter = QGroundControlQmlGlobal::flightMapPosition();
+
+    while (_downloadsInFlight < _maxDownloadsInFlight) {
+        QString nextHash;
+        bool    nextHighPriority = false;
+        double  nextDistance = 0;
+        for (auto it = _tileDownloads.constBegin(); it != _tileDownloads.constEnd(); ++it) {
+            if (it->downloading || it->checkingDisk) {
+                continue;
+            }
+            double distance = mapCenter.isValid() ? mapCenter.distanceTo(it->coordinate) : 0;
+            if (nextHash.isEmpty() || (it->highPriority && !nextHighPriority) || (it->highPriority == nextHighPriority && distance < nextDistance)) {
+                nextHash            = it.key();
+                nextHighPriority    = it->highPriority;
+                nextDistance        = distance;
+            }
         }
+        if (nextHash.isEmpty()) {
+            break;
+        }
+
+        TileDownload_t& tileDownload = _tileDownloads[nextHash];
+        const QGeoCoordinate& coordinate = tileDownload.coordinate;
+        int x = getQGCMapEngine()->urlFactory()->long2tileX("Airmap Elevation", coordinate.longitude(), 1);
+        int y = getQGCMapEngine()->urlFactory()->lat2tileY("Airmap Elevation", coordinate.latitude(), 1);
+        QNetworkRequest request = getQGCMapEngine()->urlFactory()->getTileURL("Airmap Elevation", x, y, 1, &_networkManager);
+        qCDebug(TerrainQueryLog) << "TerrainTileManager::_startDownloads query from database" << request.url() << "in flight" << _downloadsInFlight + 1;
+        QGeoTileSpec spec;
+        spec.setX(x);
+        spec.setY(y);
+        spec.setZoom(1);
+        spec.setMapId(getQGCMapEngine()->urlFactory()->getIdFromType("Airmap Elevation"));
+        QGeoTiledMapReplyQGC* reply = new QGeoTiledMapReplyQGC(&_networkManager, request, spec);
+        connect(reply, &QGeoTiledMapReplyQGC::terrainDone, this, &TerrainTileManager::_terrainDone);
+        tileDownload.downloading = true;
+        _downloadsInFlight++;
     }
-    _requestQueue.clear();
 }
 
 void TerrainTileManager::_terrainDone(QByteArray responseBytes, QNetworkReply::NetworkError error)
 {
     QGeoTiledMapReplyQGC* reply = qobject_cast<QGeoTiledMapReplyQGC*>(QObject::sender());
-    _state = State::Idle;
 
     if (!reply) {
         qCWarning(TerrainQueryLog) << "Elevation tile fetched but invalid reply data type.";
         return;
     }
+    reply->deleteLater();
+    _downloadsInFlight--;
 
     // remove from download queue
     QGeoTileSpec spec = reply->tileSpec();
     QString hash = QGCMapEngine::getTileHash("Airmap Elevation", spec.x(), spec.y(), spec.zoom());
+    _tileDownloads.remove(hash);
 
     // handle potential errors
+    bool tileFailed = true;
     if (error != QNetworkReply::NoError) {
         qCWarning(TerrainQueryLog) << "Elevation tile fetching returned error (" << error << ")";
-        _tileFailed();
-        reply->deleteLater();
-        return;
-    }
-    if (responseBytes.isEmpty()) {
+    } else if (responseBytes.isEmpty()) {
         qCWarning(TerrainQueryLog) << "Error in fetching elevation tile. Empty response.";
-        _tileFailed();
-        reply->deleteLater();
-        return;
-    }
-
-    qCDebug(TerrainQueryLog) << "Received some bytes of terrain data: " << responseBytes.size();
-
-    TerrainTile* terrainTile = new TerrainTile(responseBytes);
-    if (terrainTile->isValid()) {
-        _tilesMutex.lock();
-        if (!_tiles.contains(hash)) {
-            _tiles.insert(hash, *terrainTile);
+    } else {
+        qCDebug(TerrainQueryLog) << "Received some bytes of terrain data: " << responseBytes.size();
+        TerrainTile terrainTile(responseBytes);
+        if (terrainTile.isValid()) {
+            _tileStore.insert(hash, terrainTile, responseBytes);
+            tileFailed = false;
         } else {
-            delete terrainTile;
+            qCWarning(TerrainQueryLog) << "Received invalid tile";
         }
-        _tilesMutex.unlock();
-    } else {
-        delete terrainTile;
-        qCWarning(TerrainQueryLog) << "Received invalid tile";
     }
-    reply->deleteLater();
 
-    // now try to query the data again
+    _tileAvailable(hash, tileFailed);
+}
+
+/// Completes the requests which were waiting on a tile that has arrived, or fails them if the tile couldn't be had
+void TerrainTileManager::_tileAvailable(const QString& hash, bool tileFailed)
+{
+    // Pull out the requests which were waiting on this tile and are now complete (or failed). Signalling can
+    // queue new requests so don't do it while walking the queue.
+    QList<QueuedRequestInfo_t> completedRequests;
     for (int i = _requestQueue.count() - 1; i >= 0; i--) {
-        bool error;
-        QList<double> altitudes;
         QueuedRequestInfo_t& requestInfo = _requestQueue[i];
+        if (requestInfo.missingTiles.remove(hash) && (tileFailed || requestInfo.missingTiles.isEmpty())) {
+            completedRequests.prepend(requestInfo);
+            _requestQueue.removeAt(i);
+        }
+    }
 
-        if (getAltitudesForCoordinates(requestInfo.coordinates, altitudes, error)) {
-            if (requestInfo.queryMode == QueryMode::QueryModeCoordinates) {
-                if (error) {
-                    QList<double> noAltitudes;
-                    qCWarning(TerrainQueryLog) << "_terrainDone(coordinateQuery): signalling failure due to internal error";
-                    requestInfo.terrainQueryInterface->_signalCoordinateHeights(false, noAltitudes);
-                } else {
-                    qCDebug(TerrainQueryLog) << "_terrainDone(coordinateQuery): All altitudes taken from cached data";
-                    requestInfo.terrainQueryInterface->_signalCoordinateHeights(requestInfo.coordinates.count() == altitudes.count(), altitudes);
-                }
-            } else if (requestInfo.queryMode == QueryMode::QueryModePath) {
-                if (error) {
-                    QList<double> noAltitudes;
-                    qCWarning(TerrainQueryLog) << "_terrainDone(coordinateQuery): signalling failure due to internal error";
-                    requestInfo.terrainQueryInterface->_signalPathHeights(false, requestInfo.latStep, requestInfo.lonStep, noAltitudes);
-                } else {
-                    qCDebug(TerrainQueryLog) << "_terrainDone(coordinateQuery): All altitudes taken from cached data";
-                    requestInfo.terrainQueryInterface->_signalPathHeights(requestInfo.coordinates.count() == altitudes.count(), requestInfo.latStep, requestInfo.lonStep, altitudes);
-                }
+    for (const QueuedRequestInfo_t& requestInfo: completedRequests) {
+        if (tileFailed) {
+            _signalRequest(requestInfo, false, QList<double>());
+            continue;
+        }
+        bool lookupError;
+        QList<double> altitudes;
+        QHash<QString, QGeoCoordinate> missingTiles;
+        if (_lookupAltitudes(requestInfo.coordinates, altitudes, lookupError, &missingTiles)) {
+            if (lookupError) {
+                qCWarning(TerrainQueryLog) << "_terrainDone: signalling failure due to internal error";
+            } else {
+                qCDebug(TerrainQueryLog) << "_terrainDone: All altitudes taken from cached data";
             }
-            _requestQueue.removeAt(i);
+            _signalRequest(requestInfo, !lookupError && requestInfo.coordinates.count() == altitudes.count(), lookupError ? QList<double>() : altitudes);
+        } else {
+            // A tile was evicted from memory while we waited, ask again
+            QueuedRequestInfo_t retryInfo = requestInfo;
+            retryInfo.missingTiles = QSet<QString>::fromList(missingTiles.keys());
+            _requestQueue.append(retryInfo);
+            _requestTiles(missingTiles, false /* highPriority */);
         }
     }
+
+    _startDownloads();
 }
 
-QString TerrainTileManager::_getTileHash(const QGeoCoordinate& coordinate)
+QString TerrainTileManager::tileHash(const QGeoCoordinate& coordinate)
 {
     QString ret = QGCMapEngine::getTileHash(
         "Airmap Elevation",
@@ -549,138 +798,126 @@ QString TerrainTileManager::_getTileHash(const QGeoCoordinate& coordinate)
     return ret;
 }
 
-TerrainAtCoordinateBatchManager::TerrainAtCoordinateBatchManager(void)
+TerrainAtCoordinateScheduler::TerrainAtCoordinateScheduler(void)
+    : _stats({ 0, 0, 0, 0, 0, 0, 0 })
 {
-    _batchTimer.setSingleShot(true);
-    _batchTimer.setInterval(_batchTimeout);
-    connect(&_batchTimer, &QTimer::timeout, this, &TerrainAtCoordinateBatchManager::_sendNextBatch);
-    connect(&_terrainQuery, &TerrainQueryInterface::coordinateHeightsReceived, this, &TerrainAtCoordinateBatchManager::_coordinateHeights);
+    _dispatchTimer.setSingleShot(true);
+    _dispatchTimer.setInterval(_coalesceMSecs);
+    connect(&_dispatchTimer, &QTimer::timeout, this, &TerrainAtCoordinateScheduler::_dispatch);
+    _clock.start();
 }
 
-void TerrainAtCoordinateBatchManager::addQuery(TerrainAtCoordinateQuery* terrainAtCoordinateQuery, const QList<QGeoCoordinate>& coordinates)
+void TerrainAtCoordinateScheduler::addQuery(TerrainAtCoordinateQuery* terrainAtCoordinateQuery, const QList<QGeoCoordinate>& coordinates, bool highPriority)
 {
-    if (coordinates.length() > 0) {
-        connect(terrainAtCoordinateQuery, &TerrainAtCoordinateQuery::destroyed, this, &TerrainAtCoordinateBatchManager::_queryObjectDestroyed);
-        QueuedRequestInfo_t queuedRequestInfo = { terrainAtCoordinateQuery, coordinates };
-        _requestQueue.append(queuedRequestInfo);
-        if (!_batchTimer.isActive()) {
-            _batchTimer.start();
-        }
-    }
-}
-
-void TerrainAtCoordinateBatchManager::_sendNextBatch(void)
-{
-    qCDebug(TerrainQueryLog) << "TerrainAtCoordinateBatchManager::_sendNextBatch _state:_requestQueue.count:_sentRequests.count" << _stateToString(_state) << _requestQueue.count() << _sentRequests.count();
-
-    if (_state != State::Idle) {
-        // Waiting for last download the complete, wait some more
-        qCDebug(TerrainQueryLog) << "TerrainAtCoordinateBatchManager::_sendNextBatch waiting for current batch, restarting timer";
-        _batchTimer.start();
-        return;
-    }
-
-    if (_requestQueue.count() == 0) {
+    _stats.queries++;
+
+    // Local files and cached tiles answer right away, no point queueing
+    bool            error;
+    QList<double>   heights;
+    if (TerrainLocalDEMQuery::coordinateHeights(coordinates, heights) ||
+            (_terrainTileManager->cachedAltitudesForCoordinates(coordinates, heights, error) && !error)) {
+        _stats.answeredImmediately++;
+        terrainAtCoordinateQuery->_signalTerrainData(true, heights);
         return;
     }
 
-    _sentRequests.clear();
+    QueuedQuery_t queuedQuery = { terrainAtCoordinateQuery, coordinates, _clock.elapsed() };
 
-    // Convert coordinates to point strings for json query
-    QList<QGeoCoordinate> coords;
-    int requestQueueAdded = 0;
-    for (const QueuedRequestInfo_t& requestInfo: _requestQueue) {
-        SentRequestInfo_t sentRequestInfo = { requestInfo.terrainAtCoordinateQuery, false, requestInfo.coordinates.count() };
-        _sentRequests.append(sentRequestInfo);
-        coords += requestInfo.coordinates;
-        requestQueueAdded++;
-        if (coords.count() > 50) {
-            break;
+    // Coalesce with a group waiting on any of the same tiles
+    QSet<QString> tileHashes;
+    for (const QGeoCoordinate& coordinate: coordinates) {
+        tileHashes.insert(TerrainTileManager::tileHash(coordinate));
+    }
+    for (RequestGroup_t& group: _queuedGroups) {
+        if (group.tileHashes.intersects(tileHashes)) {
+            group.tileHashes.unite(tileHashes);
+            group.queries.append(queuedQuery);
+            group.highPriority |= highPriority;
+            _stats.coalesced++;
+            return;
         }
     }
-    _requestQueue = _requestQueue.mid(requestQueueAdded);
-    qCDebug(TerrainQueryLog) << "TerrainAtCoordinateBatchManager::_sendNextBatch requesting next batch _state:_requestQueue.count:_sentRequests.count" << _stateToString(_state) << _requestQueue.count() << _sentRequests.count();
 
-    _state = State::Downloading;
-    _terrainQuery.requestCoordinateHeights(coords);
+    RequestGroup_t group = { tileHashes, coordinates.first(), highPriority, { queuedQuery } };
+    _queuedGroups.append(group);
+    if (!_dispatchTimer.isActive()) {
+        _dispatchTimer.start();
+    }
 }
 
-void TerrainAtCoordinateBatchManager::_batchFailed(void)
+TerrainQueryInterface* TerrainAtCoordinateScheduler::_createGroupQuery(bool highPriority)
 {
-    QList<double> noHeights;
-
-    for (const SentRequestInfo_t& sentRequestInfo: _sentRequests) {
-        if (!sentRequestInfo.queryObjectDestroyed) {
-            disconnect(sentRequestInfo.terrainAtCoordinateQuery, &TerrainAtCoordinateQuery::destroyed, this, &TerrainAtCoordinateBatchManager::_queryObjectDestroyed);
-            sentRequestInfo.terrainAtCoordinateQuery->_signalTerrainData(false, noHeights);
-        }
-    }
-    _sentRequests.clear();
+    TerrainOfflineAirMapQuery* terrainQuery = new TerrainOfflineAirMapQuery(this);
+    terrainQuery->setHighPriority(highPriority);
+    return terrainQuery;
 }
 
-void TerrainAtCoordinateBatchManager::_queryObjectDestroyed(QObject* terrainAtCoordinateQuery)
+void TerrainAtCoordinateScheduler::_dispatch(void)
 {
-    // Remove/Mark deleted objects queries from queues
-
-    qCDebug(TerrainQueryLog) << "_TerrainAtCoordinateQueryDestroyed TerrainAtCoordinateQuery" << terrainAtCoordinateQuery;
-
-    int i = 0;
-    while (i < _requestQueue.count()) {
-        const QueuedRequestInfo_t& requestInfo = _requestQueue[i];
-        if (requestInfo.terrainAtCoordinateQuery == terrainAtCoordinateQuery) {
-            qCDebug(TerrainQueryLog) << "Removing deleted provider from _requestQueue index:terrainAtCoordinateQuery" << i << requestInfo.terrainAtCoordinateQuery;
-            _requestQueue.removeAt(i);
-        } else {
-            i++;
+    QGeoCoordinate mapCenter = QGroundControlQmlGlobal::flightMapPosition();
+
+    qCDebug(TerrainQueryLog) << "TerrainAtCoordinateScheduler::_dispatch queued:inFlight" << _queuedGroups.count() << _groupsInFlight;
+
+    while (_groupsInFlight < maxGroupsInFlight && !_queuedGroups.isEmpty()) {
+        // High priority first, then closest to what is on screen
+        int     nextIndex = 0;
+        double  nextDistance = mapCenter.isValid() ? mapCenter.distanceTo(_queuedGroups[0].coordinate) : 0;
+        for (int i = 1; i < _queuedGroups.count(); i++) {
+            const RequestGroup_t& group = _queuedGroups[i];
+            double distance = mapCenter.isValid() ? mapCenter.distanceTo(group.coordinate) : 0;
+            bool nextHighPriority = _queuedGroups[nextIndex].highPriority;
+            if ((group.highPriority && !nextHighPriority) || (group.highPriority == nextHighPriority && distance < nextDistance)) {
+                nextIndex       = i;
+                nextDistance    = distance;
+            }
         }
-    }
+        RequestGroup_t group = _queuedGroups.takeAt(nextIndex);
 
-    for (int i=0; i<_sentRequests.count(); i++) {
-        SentRequestInfo_t& sentRequestInfo = _sentRequests[i];
-        if (sentRequestInfo.terrainAtCoordinateQuery == terrainAtCoordinateQuery) {
-            qCDebug(TerrainQueryLog) << "Zombieing deleted provider from _sentRequests index:terrainAtCoordinateQuery" << sentRequestInfo.terrainAtCoordinateQuery;
-            sentRequestInfo.queryObjectDestroyed = true;
+        QList<QGeoCoordinate> coordinates;
+        for (const QueuedQuery_t& queuedQuery: group.queries) {
+            coordinates += queuedQuery.coordinates;
         }
-    }
-}
 
-QString TerrainAtCoordinateBatchManager::_stateToString(State state)
-{
-    switch (state) {
-    case State::Idle:
-        return QStringLiteral("Idle");
-    case State::Downloading:
-        return QStringLiteral("Downloading");
+        // One query object per group so replies can't be confused with one another
+        TerrainQueryInterface* terrainQuery = _createGroupQuery(group.highPriority);
+        connect(terrainQuery, &TerrainQueryInterface::coordinateHeightsReceived, this, [this, terrainQuery, group](bool success, QList<double> heights) {
+            terrainQuery->deleteLater();
+            _groupDone(group, success, heights);
+        });
+        _groupsInFlight++;
+        _stats.groupsSent++;
+        terrainQuery->requestCoordinateHeights(coordinates);
     }
-
-    return QStringLiteral("State unknown");
 }
 
-void TerrainAtCoordinateBatchManager::_coordinateHeights(bool success, QList<double> heights)
+void TerrainAtCoordinateScheduler::_groupDone(const RequestGroup_t& group, bool success, const QList<double>& heights)
 {
-    _state = State::Idle;
-
-    qCDebug(TerrainQueryLog) << "TerrainAtCoordinateBatchManager::_coordinateHeights signalled success:count" << success << heights.count();
-
-    if (!success) {
-        _batchFailed();
-        return;
-    }
+    _groupsInFlight--;
 
+    qint64 now = _clock.elapsed();
     int currentIndex = 0;
-    for (const SentRequestInfo_t& sentRequestInfo: _sentRequests) {
-        if (!sentRequestInfo.queryObjectDestroyed) {
-            qCDebug(TerrainQueryVerboseLog) << "TerrainAtCoordinateBatchManager::_coordinateHeights returned TerrainCoordinateQuery:count" <<  sentRequestInfo.terrainAtCoordinateQuery << sentRequestInfo.cCoord;
-            disconnect(sentRequestInfo.terrainAtCoordinateQuery, &TerrainAtCoordinateQuery::destroyed, this, &TerrainAtCoordinateBatchManager::_queryObjectDestroyed);
-            QList<double> requestAltitudes = heights.mid(currentIndex, sentRequestInfo.cCoord);
-            sentRequestInfo.terrainAtCoordinateQuery->_signalTerrainData(true, requestAltitudes);
-            currentIndex += sentRequestInfo.cCoord;
+    for (const QueuedQuery_t& queuedQuery: group.queries) {
+        qint64 latency = now - queuedQuery.queuedMSecs;
+        _stats.maxQueueLatencyMSecs = qMax(_stats.maxQueueLatencyMSecs, latency);
+        _stats.avgQueueLatencyMSecs = _stats.avgQueueLatencyMSecs == 0 ? latency : (_stats.avgQueueLatencyMSecs * 0.9) + (latency * 0.1);
+
+        QList<double> queryHeights;
+        if (success) {
+            queryHeights = heights.mid(currentIndex, queuedQuery.coordinates.count());
+        } else {
+            _stats.failed++;
+        }
+        currentIndex += queuedQuery.coordinates.count();
+        if (queuedQuery.terrainAtCoordinateQuery) {
+            queuedQuery.terrainAtCoordinateQuery->_signalTerrainData(success, queryHeights);
         }
     }
-    _sentRequests.clear();
 
-    if (_requestQueue.count()) {
-        _batchTimer.start();
+    qCDebug(TerrainQueryLog) << "TerrainAtCoordinateScheduler queries:immediate:coalesced:sent:failed" << _stats.queries << _stats.answeredImmediately << _stats.coalesced << _stats.groupsSent << _stats.failed
+                             << "queue latency avg:max" << _stats.avgQueueLatencyMSecs << _stats.maxQueueLatencyMSecs;
+
+    if (!_queuedGroups.isEmpty() && !_dispatchTimer.isActive()) {
+        _dispatchTimer.start();
     }
 }
 
@@ -689,17 +926,26 @@ TerrainAtCoordinateQuery::TerrainAtCoordinateQuery(QObject* parent)
 {
 
 }
-void TerrainAtCoordinateQuery::requestData(const QList<QGeoCoordinate>& coordinates)
+void TerrainAtCoordinateQuery::requestData(const QList<QGeoCoordinate>& coordinates, bool highPriority)
 {
     if (coordinates.length() == 0) {
         return;
     }
 
-    _TerrainAtCoordinateBatchManager->addQuery(this, coordinates);
+    _terrainAtCoordinateScheduler->addQuery(this, coordinates, highPriority);
+}
+
+TerrainAtCoordinateScheduler::Stats_t TerrainAtCoordinateQuery::schedulerStats(void)
+{
+    return _terrainAtCoordinateScheduler->stats();
 }
 
 bool TerrainAtCoordinateQuery::getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error)
 {
+    if (TerrainLocalDEMQuery::coordinateHeights(coordinates, altitudes)) {
+        error = false;
+        return true;
+    }
     return _terrainTileManager->getAltitudesForCoordinates(coordinates, altitudes, error);
 }
 
@@ -717,6 +963,12 @@ TerrainPathQuery::TerrainPathQuery(QObject* parent)
 
 void TerrainPathQuery::requestData(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord)
 {
+    double latStep, lonStep;
+    QList<double> heights;
+    if (TerrainLocalDEMQuery::pathHeights(fromCoord, toCoord, latStep, lonStep, heights)) {
+        _pathHeights(true, latStep, lonStep, heights);
+        return;
+    }
     _terrainQuery.requestPathHeights(fromCoord, toCoord);
 }
 
@@ -786,5 +1038,11 @@ TerrainCarpetQuery::TerrainCarpetQuery(QObject* parent)
 
 void TerrainCarpetQuery::requestData(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly)
 {
+    double minHeight, maxHeight;
+    QList<QList<double>> carpet;
+    if (TerrainLocalDEMQuery::carpetHeights(swCoord, neCoord, statsOnly, minHeight, maxHeight, carpet)) {
+        emit terrainDataReceived(true, minHeight, maxHeight, carpet);
+        return;
+    }
     _terrainQuery.requestCarpetHeights(swCoord, neCoord, statsOnly);
 }
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "TerrainTile.h"
+#include "TerrainTileStore.h"
 #include "QGCMapEngineData.h"
 #include "QGCLoggingCategory.h"
 
@@ -18,6 +19,9 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSet>
 #include <QtLocation/private/qgeotiledmapreply_p.h>
 
 Q_DECLARE_LOGGING_CATEGORY(TerrainQueryLog)
@@ -102,32 +106,64 @@ public:
     void requestPathHeights(const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord) final;
     void requestCarpetHeights(const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly) final;
 
+    /// Tiles needed by this query are downloaded ahead of others
+    void setHighPriority(bool highPriority) { _highPriority = highPriority; }
+
     // Internal methods
     void _signalCoordinateHeights(bool success, QList<double> heights);
     void _signalPathHeights(bool success, double latStep, double lonStep, const QList<double>& heights);
     void _signalCarpetHeights(bool success, double minHeight, double maxHeight, const QList<QList<double>>& carpet);
+
+private:
+    bool _highPriority = false;
+};
+
+/// Terrain queries answered from local elevation files (SRTM .hgt, GeoTIFF), no network involved. Results are
+/// signalled before the request call returns. Requests for areas the files don't cover fail.
+class TerrainLocalDEMQuery : public TerrainQueryInterface {
+    Q_OBJECT
+
+public:
+    TerrainLocalDEMQuery(QObject* parent = nullptr);
+
+    // Overrides from TerrainQueryInterface
+    void requestCoordinateHeights   (const QList<QGeoCoordinate>& coordinates) final;
+    void requestPathHeights         (const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord) final;
+    void requestCarpetHeights       (const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly) final;
+
+    /// @return true: Local elevation files are selected in settings and some were found
+    static bool enabled(void);
+
+    /// Synchronous versions of the queries, used to try local files before going to the network
+    /// @return false: Local files not enabled or not covering the request
+    static bool coordinateHeights   (const QList<QGeoCoordinate>& coordinates, QList<double>& heights);
+    static bool pathHeights         (const QGeoCoordinate& fromCoord, const QGeoCoordinate& toCoord, double& latStep, double& lonStep, QList<double>& heights);
+    static bool carpetHeights       (const QGeoCoordinate& swCoord, const QGeoCoordinate& neCoord, bool statsOnly, double& minHeight, double& maxHeight, QList<QList<double>>& carpet);
 };
 
-/// Used internally by TerrainOfflineAirMapQuery to manage terrain tiles
+/// Used internally by TerrainOfflineAirMapQuery to manage terrain tiles. Missing tiles are downloaded several at
+/// a time, each tile only once no matter how many requests are waiting on it. High priority tiles go first, then
+/// the ones closest to the map center.
 class TerrainTileManager : public QObject {
     Q_OBJECT
 
 public:
     TerrainTileManager(void);
 
-    void addCoordinateQuery         (TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates);
-    void addPathQuery               (TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate& startPoint, const QGeoCoordinate& endPoint);
+    void addCoordinateQuery         (TerrainOfflineAirMapQuery* terrainQueryInterface, const QList<QGeoCoordinate>& coordinates, bool highPriority = false);
+    void addPathQuery               (TerrainOfflineAirMapQuery* terrainQueryInterface, const QGeoCoordinate& startPoint, const QGeoCoordinate& endPoint, bool highPriority = false);
     bool getAltitudesForCoordinates (const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error);
 
+    /// Same as getAltitudesForCoordinates but only uses tiles already in memory and never starts a download
+    bool cachedAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error);
+
+    static QString tileHash(const QGeoCoordinate& coordinate);
+
 private slots:
     void _terrainDone       (QByteArray responseBytes, QNetworkReply::NetworkError error);
+    void _diskLoadComplete  (QString hash, bool found);
 
 private:
-    enum class State {
-        Idle,
-        Downloading,
-    };
-
     enum QueryMode {
         QueryModeCoordinates,
         QueryModePath,
@@ -135,64 +171,91 @@ private:
     };
 
     typedef struct {
-        TerrainOfflineAirMapQuery*  terrainQueryInterface;
-        QueryMode                   queryMode;
-        double                      latStep, lonStep;
-        QList<QGeoCoordinate>       coordinates;
+        QPointer<TerrainOfflineAirMapQuery> terrainQueryInterface;
+        QueryMode                           queryMode;
+        double                              latStep, lonStep;
+        QList<QGeoCoordinate>               coordinates;
+        QSet<QString>                       missingTiles;   ///< Tiles still being downloaded for this request
     } QueuedRequestInfo_t;
 
-    void    _tileFailed                         (void);
-    QString _getTileHash                        (const QGeoCoordinate& coordinate);
-
-    QList<QueuedRequestInfo_t>  _requestQueue;
-    State                       _state = State::Idle;
-    QNetworkAccessManager       _networkManager;
-
-    QMutex                      _tilesMutex;
-    QHash<QString, TerrainTile> _tiles;
+    typedef struct {
+        QGeoCoordinate  coordinate;     ///< Any coordinate in the tile
+        bool            highPriority;
+        bool            downloading;
+        bool            checkingDisk;   ///< Waiting on the tile store to load the tile from disk
+    } TileDownload_t;
+
+    bool _lookupAltitudes   (const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error, QHash<QString, QGeoCoordinate>* missingTiles);
+    void _queueRequest      (TerrainOfflineAirMapQuery* terrainQueryInterface, QueryMode queryMode, double latStep, double lonStep, const QList<QGeoCoordinate>& coordinates, bool highPriority);
+    void _requestTiles      (const QHash<QString, QGeoCoordinate>& tiles, bool highPriority);
+    void _startDownloads    (void);
+    void _tileAvailable     (const QString& hash, bool tileFailed);
+    void _signalRequest     (const QueuedRequestInfo_t& requestInfo, bool success, const QList<double>& altitudes);
+
+    QList<QueuedRequestInfo_t>      _requestQueue;
+    QHash<QString, TileDownload_t>  _tileDownloads;         ///< Tiles requested, keyed by tile hash
+    int                             _downloadsInFlight = 0;
+    QNetworkAccessManager           _networkManager;
+    TerrainTileStore                _tileStore;
+
+    static const int                _maxDownloadsInFlight = 4;
 };
 
-/// Used internally by TerrainAtCoordinateQuery to batch coordinate requests together
-class TerrainAtCoordinateBatchManager : public QObject {
+/// Used internally by TerrainAtCoordinateQuery to schedule coordinate requests. Queries already covered by local
+/// elevation files or cached tiles are answered right away. The rest are coalesced by terrain tile and handed to
+/// the tile manager several groups at a time: the current item first, then whatever is closest to the map center.
+class TerrainAtCoordinateScheduler : public QObject {
     Q_OBJECT
 
 public:
-    TerrainAtCoordinateBatchManager(void);
+    TerrainAtCoordinateScheduler(void);
 
-    void addQuery(TerrainAtCoordinateQuery* terrainAtCoordinateQuery, const QList<QGeoCoordinate>& coordinates);
+    void addQuery(TerrainAtCoordinateQuery* terrainAtCoordinateQuery, const QList<QGeoCoordinate>& coordinates, bool highPriority);
+
+    typedef struct {
+        quint64 queries;                ///< Total queries
+        quint64 answeredImmediately;    ///< Answered from local files or cached tiles without queueing
+        quint64 coalesced;              ///< Queued onto a group already waiting for the same tile
+        quint64 groupsSent;             ///< Requests handed to the tile manager
+        quint64 failed;
+        double  avgQueueLatencyMSecs;   ///< Time from a query being queued to it being answered
+        qint64  maxQueueLatencyMSecs;
+    } Stats_t;
+
+    const Stats_t& stats(void) const { return _stats; }
+
+    static const int        maxGroupsInFlight   = 4;
+
+protected:
+    /// Creates the query a group of coordinates is sent through, the scheduler takes ownership
+    virtual TerrainQueryInterface* _createGroupQuery(bool highPriority);
 
 private slots:
-    void _sendNextBatch         (void);
-    void _queryObjectDestroyed  (QObject* elevationProvider);
-    void _coordinateHeights     (bool success, QList<double> heights);
+    void _dispatch(void);
 
 private:
     typedef struct {
-        TerrainAtCoordinateQuery*   terrainAtCoordinateQuery;
-        QList<QGeoCoordinate>       coordinates;
-    } QueuedRequestInfo_t;
+        QPointer<TerrainAtCoordinateQuery>  terrainAtCoordinateQuery;
+        QList<QGeoCoordinate>               coordinates;
+        qint64                              queuedMSecs;
+    } QueuedQuery_t;
 
     typedef struct {
-        TerrainAtCoordinateQuery*   terrainAtCoordinateQuery;
-        bool                        queryObjectDestroyed;
-        int                         cCoord;
-    } SentRequestInfo_t;
+        QSet<QString>           tileHashes;     ///< Every tile the queries in the group touch
+        QGeoCoordinate          coordinate;
+        bool                    highPriority;
+        QList<QueuedQuery_t>    queries;
+    } RequestGroup_t;
 
+    void _groupDone(const RequestGroup_t& group, bool success, const QList<double>& heights);
 
-    enum class State {
-        Idle,
-        Downloading,
-    };
-
-    void _batchFailed(void);
-    QString _stateToString(State state);
+    QList<RequestGroup_t>   _queuedGroups;
+    int                     _groupsInFlight = 0;
+    QTimer                  _dispatchTimer;
+    QElapsedTimer           _clock;
+    Stats_t                 _stats;
 
-    QList<QueuedRequestInfo_t>  _requestQueue;
-    QList<SentRequestInfo_t>    _sentRequests;
-    State                       _state = State::Idle;
-    const int                   _batchTimeout = 500;
-    QTimer                      _batchTimer;
-    TerrainOfflineAirMapQuery   _terrainQuery;
+    static const int        _coalesceMSecs      = 20;   ///< Gives a burst of queries for the same tile a chance to merge
 };
 
 /// NOTE: TerrainAtCoordinateQuery is not thread safe. All instances/calls to ElevationProvider must be on main thread.
@@ -205,13 +268,17 @@ public:
     /// Async terrain query for a list of lon,lat coordinates. When the query is done, the terrainData() signal
     /// is emitted.
     ///     @param coordinates to query
-    void requestData(const QList<QGeoCoordinate>& coordinates);
+    ///     @param highPriority true: Jump ahead of other queued queries (the item being edited for example)
+    void requestData(const QList<QGeoCoordinate>& coordinates, bool highPriority = false);
 
     /// Either returns altitudes from cache or queues database request
     ///     @param[out] error true: altitude not returned due to error, false: altitudes returned
     /// @return true: altitude returned (check error as well), false: database query queued (altitudes not returned)
     static bool getAltitudesForCoordinates(const QList<QGeoCoordinate>& coordinates, QList<double>& altitudes, bool& error);
 
+    /// Queue latency and request counts of the shared scheduler
+    static TerrainAtCoordinateScheduler::Stats_t schedulerStats(void);
+
     // Internal method
     void _signalTerrainData(bool success, QList<double>& heights);
 
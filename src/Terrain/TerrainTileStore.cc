@@ -0,0 +1,219 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileStore.h"
+#include "QGCMapEngine.h"
+#include "QGCApplication.h"
+#include "SettingsManager.h"
+#include "AppSettings.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QMutexLocker>
+#include <QtConcurrent>
+
+QGC_LOGGING_CATEGORY(TerrainTileStoreLog, "TerrainTileStoreLog")
+
+TerrainTileStore::TerrainTileStore(int maxMemoryBytes, qint64 maxDiskBytes, const QString& diskPath)
+    : _diskPath     (diskPath)
+    , _maxDiskBytes (maxDiskBytes)
+{
+    _memory.setMaxCost(maxMemoryBytes);
+    _diskPool.setMaxThreadCount(1);
+}
+
+TerrainTileStore::~TerrainTileStore()
+{
+    // Disk jobs post back to us
+    _diskPool.waitForDone();
+}
+
+bool TerrainTileStore::find(const QString& hash, TerrainTile& tile)
+{
+    QMutexLocker lock(&_mutex);
+
+    // QCache::object also makes this the most recently used tile
+    TerrainTile* cachedTile = _memory.object(hash);
+    if (!cachedTile) {
+        return false;
+    }
+    tile = *cachedTile;
+    return true;
+}
+
+void TerrainTileStore::load(const QString& hash)
+{
+    TerrainTile tile;
+    if (_notOnDisk.contains(hash) || find(hash, tile)) {
+        QMetaObject::invokeMethod(this, [this, hash, tile]() { _loaded(hash, tile); }, Qt::QueuedConnection);
+        return;
+    }
+    if (_loading.contains(hash)) {
+        return;
+    }
+    _loading.insert(hash);
+
+    QtConcurrent::run(&_diskPool, [this, hash]() {
+        TerrainTile diskTile;
+        QString fileName = _tileFile(hash);
+        QFile file(fileName);
+        if (!fileName.isEmpty() && file.open(QIODevice::ReadOnly)) {
+            diskTile = TerrainTile(file.readAll());
+            file.close();
+            if (diskTile.isValid()) {
+                qCDebug(TerrainTileStoreLog) << "Loaded terrain tile from disk" << hash;
+            } else {
+                qCWarning(TerrainTileStoreLog) << "Removing invalid terrain tile from disk" << fileName;
+                file.remove();
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, hash, diskTile]() { _loaded(hash, diskTile); }, Qt::QueuedConnection);
+    });
+}
+
+/// Disk load results come back through here on the store's thread
+void TerrainTileStore::_loaded(const QString& hash, const TerrainTile& tile)
+{
+    _loading.remove(hash);
+
+    bool found = tile.isValid();
+    if (found) {
+        QMutexLocker lock(&_mutex);
+        if (!_memory.contains(hash)) {
+            _memory.insert(hash, new TerrainTile(tile), tile.memorySize());
+        }
+    } else {
+        // An insert may have raced the load
+        TerrainTile memoryTile;
+        found = find(hash, memoryTile);
+        if (!found) {
+            _notOnDisk.insert(hash);
+        }
+    }
+
+    emit diskLoadComplete(hash, found);
+}
+
+void TerrainTileStore::insert(const QString& hash, const TerrainTile& tile, const QByteArray& serialized)
+{
+    if (!tile.isValid()) {
+        return;
+    }
+
+    {
+        QMutexLocker lock(&_mutex);
+        _memory.insert(hash, new TerrainTile(tile), tile.memorySize());
+    }
+
+    if (qgcApp()->toolbox()->settingsManager()->appSettings()->disableAllPersistence()->rawValue().toBool()) {
+        return;
+    }
+    _notOnDisk.remove(hash);
+    QtConcurrent::run(&_diskPool, [this, hash, serialized]() { _write(hash, serialized); });
+}
+
+void TerrainTileStore::clearMemory(void)
+{
+    QMutexLocker lock(&_mutex);
+    _memory.clear();
+}
+
+void TerrainTileStore::waitForDisk(void)
+{
+    _diskPool.waitForDone();
+}
+
+int TerrainTileStore::memoryBytes(void) const
+{
+    QMutexLocker lock(&_mutex);
+    return _memory.totalCost();
+}
+
+int TerrainTileStore::memoryTiles(void) const
+{
+    QMutexLocker lock(&_mutex);
+    return _memory.count();
+}
+
+QString TerrainTileStore::_tileFile(const QString& hash)
+{
+    if (!_diskPathChecked) {
+        // The map engine has settled on a writable cache location by the time terrain is queried
+        _diskPathChecked = true;
+        QString path = _diskPath;
+        _diskPath.clear();
+        if (path.isEmpty()) {
+            QString cachePath = getQGCMapEngine()->getCachePath();
+            if (!cachePath.isEmpty()) {
+                path = cachePath + QStringLiteral("/TerrainTiles");
+            }
+        }
+        if (!path.isEmpty()) {
+            if (QDir::root().mkpath(path)) {
+                _diskPath = path;
+            } else {
+                qCWarning(TerrainTileStoreLog) << "Could not create terrain tile directory" << path;
+            }
+        }
+    }
+    if (_diskPath.isEmpty() || hash.isEmpty()) {
+        return QString();
+    }
+    return _diskPath + QStringLiteral("/") + hash + QStringLiteral(".bin");
+}
+
+void TerrainTileStore::_write(const QString& hash, const QByteArray& serialized)
+{
+    QString fileName = _tileFile(hash);
+    if (fileName.isEmpty() || QFile::exists(fileName)) {
+        return;
+    }
+    // Write through a temporary so a crash can't leave a truncated tile behind
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(serialized) != serialized.size() || !file.commit()) {
+        qCWarning(TerrainTileStoreLog) << "Unable to save terrain tile" << fileName << file.errorString();
+        return;
+    }
+    if (_diskBytes < 0) {
+        _pruneDisk();
+    } else {
+        _diskBytes += serialized.size();
+        if (_diskBytes > _maxDiskBytes) {
+            _pruneDisk();
+        }
+    }
+}
+
+/// Removes the least recently written tiles until the store is back under 3/4 of its budget
+void TerrainTileStore::_pruneDisk(void)
+{
+    QDir dir(_diskPath);
+    QFileInfoList files = dir.entryInfoList(QStringList(QStringLiteral("*.bin")), QDir::Files, QDir::Time | QDir::Reversed);
+    _diskBytes = 0;
+    for (const QFileInfo& info: files) {
+        _diskBytes += info.size();
+    }
+    if (_diskBytes <= _maxDiskBytes) {
+        return;
+    }
+    qint64 target = (_maxDiskBytes / 4) * 3;
+    int removed = 0;
+    for (const QFileInfo& info: files) {
+        if (_diskBytes <= target) {
+            break;
+        }
+        if (QFile::remove(info.filePath())) {
+            _diskBytes -= info.size();
+            removed++;
+        }
+    }
+    qCDebug(TerrainTileStoreLog) << "Pruned terrain tiles from disk" << removed << "remaining bytes" << _diskBytes;
+}
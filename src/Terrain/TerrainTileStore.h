@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "TerrainTile.h"
+#include "QGCLoggingCategory.h"
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+Q_DECLARE_LOGGING_CATEGORY(TerrainTileStoreLog)
+
+/// Decoded terrain tiles, kept in a byte budgeted LRU in memory and persisted to disk so terrain heights survive
+/// a restart without going back to the network. Lookups only ever touch memory. Disk reads, writes and pruning run
+/// one at a time on a worker thread, with the results of reads signalled back on the store's thread.
+class TerrainTileStore : public QObject
+{
+    Q_OBJECT
+
+    friend class TerrainTileStoreTest;
+
+public:
+    /// @param diskPath Directory to keep tiles in, empty to use the map engine's cache location
+    TerrainTileStore(int maxMemoryBytes = defaultMaxMemoryBytes, qint64 maxDiskBytes = defaultMaxDiskBytes, const QString& diskPath = QString());
+    ~TerrainTileStore();
+
+    /// Looks for the tile in memory. Thread safe.
+    ///     @param[out] tile Tile found (implicitly shared, cheap to copy)
+    /// @return true: tile found
+    bool find(const QString& hash, TerrainTile& tile);
+
+    /// Starts loading a tile from disk into memory. diskLoadComplete is always signalled, right away (queued) for
+    /// tiles already in memory or already known not to be on disk.
+    void load(const QString& hash);
+
+    /// Adds a tile to memory and queues writing it to disk, unless persistence is disabled
+    ///     @param serialized Tile in TerrainTile::serialize format, what gets written to disk
+    void insert(const QString& hash, const TerrainTile& tile, const QByteArray& serialized);
+
+    /// Drops everything in memory. Disk is left alone.
+    void clearMemory(void);
+
+    /// Blocks until queued disk work is done
+    void waitForDisk(void);
+
+    int     memoryBytes (void) const;
+    int     memoryTiles (void) const;
+
+    static constexpr int    defaultMaxMemoryBytes   = 32 * 1024 * 1024;
+    static constexpr qint64 defaultMaxDiskBytes     = 256 * 1024 * 1024;
+
+signals:
+    /// @param found false: the tile is not on disk, it needs to be downloaded
+    void diskLoadComplete(QString hash, bool found);
+
+private:
+    void    _loaded     (const QString& hash, const TerrainTile& tile);
+    // These run on the disk thread only
+    QString _tileFile   (const QString& hash);
+    void    _write      (const QString& hash, const QByteArray& serialized);
+    void    _pruneDisk  (void);
+
+    mutable QMutex                  _mutex;             ///< Protects _memory
+    QCache<QString, TerrainTile>    _memory;            ///< Cost is TerrainTile::memorySize()
+    QSet<QString>                   _notOnDisk;         ///< Negative lookups, so a missing tile is only looked for once
+    QSet<QString>                   _loading;           ///< Disk loads in flight
+
+    // Disk state, only touched on the disk thread
+    QString                         _diskPath;
+    bool                            _diskPathChecked    = false;
+    qint64                          _maxDiskBytes;
+    qint64                          _diskBytes          = -1;   ///< -1 until the directory has been scanned
+
+    QThreadPool                     _diskPool;          ///< Single thread so disk operations run in order
+};
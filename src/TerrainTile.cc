@@ -16,6 +16,10 @@
 #include <QJsonArray>
 #include <QDataStream>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 QGC_LOGGING_CATEGORY(TerrainTileLog, "TerrainTileLog");
 
 const char*  TerrainTile::_jsonStatusKey        = "status";
@@ -33,7 +37,6 @@ TerrainTile::TerrainTile()
     : _minElevation(-1.0)
     , _maxElevation(-1.0)
     , _avgElevation(-1.0)
-    , _data(nullptr)
     , _gridSizeLat(-1)
     , _gridSizeLon(-1)
     , _isValid(false)
@@ -41,22 +44,10 @@ TerrainTile::TerrainTile()
 
 }
 
-TerrainTile::~TerrainTile()
-{
-    if (_data) {
-        for (int i = 0; i < _gridSizeLat; i++) {
-            delete _data[i];
-        }
-        delete _data;
-        _data = nullptr;
-    }
-}
-
 TerrainTile::TerrainTile(QByteArray byteArray)
     : _minElevation(-1.0)
     , _maxElevation(-1.0)
     , _avgElevation(-1.0)
-    , _data(nullptr)
     , _gridSizeLat(-1)
     , _gridSizeLon(-1)
     , _isValid(false)
@@ -83,24 +74,20 @@ TerrainTile::TerrainTile(QByteArray byteArray)
     qCDebug(TerrainTileLog) << "Loading terrain tile: " << _southWest << " - " << _northEast;
     qCDebug(TerrainTileLog) << "min:max:avg:sizeLat:sizeLon" << _minElevation << _maxElevation << _avgElevation << _gridSizeLat << _gridSizeLon;
 
+    if (_gridSizeLat <= 0 || _gridSizeLon <= 0) {
+        qWarning() << "Terrain tile binary data has invalid grid size" << _gridSizeLat << _gridSizeLon;
+        return;
+    }
+
     int cTileDataBytes = static_cast<int>(sizeof(int16_t)) * _gridSizeLat * _gridSizeLon;
     if (cTileBytesAvailable < cTileHeaderBytes + cTileDataBytes) {
         qWarning() << "Terrain tile binary data too small for tile data";
         return;
     }
 
-    _data = new int16_t*[_gridSizeLat];
-    for (int k = 0; k < _gridSizeLat; k++) {
-        _data[k] = new int16_t[_gridSizeLon];
-    }
-
-    int valueIndex = 0;
-    const int16_t* pTileData = reinterpret_cast<const int16_t*>(&reinterpret_cast<const uint8_t*>(byteArray.constData())[cTileHeaderBytes]);
-    for (int i = 0; i < _gridSizeLat; i++) {
-        for (int j = 0; j < _gridSizeLon; j++) {
-            _data[i][j] = pTileData[valueIndex++];
-        }
-    }
+    // The serialized grid is already row major, copy it in one go
+    _data.resize(_gridSizeLat * _gridSizeLon);
+    memcpy(_data.data(), &reinterpret_cast<const uint8_t*>(byteArray.constData())[cTileHeaderBytes], static_cast<size_t>(cTileDataBytes));
 
     _isValid = true;
 
@@ -127,18 +114,49 @@ double TerrainTile::elevation(const QGeoCoordinate& coordinate) const
         // Get the index at resolution of 1 arc second
         int indexLat = _latToDataIndex(coordinate.latitude());
         int indexLon = _lonToDataIndex(coordinate.longitude());
-        if (indexLat == -1 || indexLon == -1) {
-            qCWarning(TerrainTileLog) << "Internal error indexLat:indexLon == -1" << indexLat << indexLon;
+        if (indexLat < 0 || indexLon < 0 || indexLat >= _gridSizeLat || indexLon >= _gridSizeLon) {
+            qCWarning(TerrainTileLog) << "Internal error indexLat:indexLon out of range" << indexLat << indexLon;
             return qQNaN();
         }
-        qCDebug(TerrainTileLog) << "indexLat:indexLon" << indexLat << indexLon << "elevation" << _data[indexLat][indexLon];
-        return static_cast<double>(_data[indexLat][indexLon]);
+        int16_t elevation = _data[indexLat * _gridSizeLon + indexLon];
+        qCDebug(TerrainTileLog) << "indexLat:indexLon" << indexLat << indexLon << "elevation" << elevation;
+        return static_cast<double>(elevation);
     } else {
         qCWarning(TerrainTileLog) << "Asking for elevation, but no valid data.";
         return qQNaN();
     }
 }
 
+void TerrainTile::elevations(const double* latitudes, const double* longitudes, double* elevations, int count) const
+{
+    if (!_isValid) {
+        qCWarning(TerrainTileLog) << "Asking for elevations, but no valid data.";
+        std::fill(elevations, elevations + count, qQNaN());
+        return;
+    }
+
+    // Hoist everything _latToDataIndex/_lonToDataIndex look up per call so the loop below is nothing but
+    // arithmetic, selects and a gather. Kept free of branches so the compiler can vectorize it.
+    const double    swLat       = _southWest.latitude();
+    const double    swLon       = _southWest.longitude();
+    const double    neLat       = _northEast.latitude();
+    const double    neLon       = _northEast.longitude();
+    const double    gridSizeLat = _gridSizeLat;
+    const double    gridSizeLon = _gridSizeLon;
+    const int       rowStride   = _gridSizeLon;
+    const int16_t*  data        = _data.constData();
+    const double    noElevation = qQNaN();
+
+    for (int i = 0; i < count; i++) {
+        // NaN coordinates fail both range checks
+        const double    rowIndex    = _gridIndex(latitudes[i], swLat, neLat, _gridSizeLat);
+        const double    colIndex    = _gridIndex(longitudes[i], swLon, neLon, _gridSizeLon);
+        const bool      inRange     = rowIndex >= 0 && rowIndex < gridSizeLat && colIndex >= 0 && colIndex < gridSizeLon;
+        const int       dataIndex   = inRange ? static_cast<int>(rowIndex) * rowStride + static_cast<int>(colIndex) : 0;
+        elevations[i] = inRange ? static_cast<double>(data[dataIndex]) : noElevation;
+    }
+}
+
 QGeoCoordinate TerrainTile::centerCoordinate(void) const
 {
     return _southWest.atDistanceAndAzimuth(_southWest.distanceTo(_northEast) / 2.0, _southWest.azimuthTo(_northEast));
@@ -266,10 +284,16 @@ QByteArray TerrainTile::serialize(QByteArray input)
 }
 
 
+/// Nearest grid index along one axis. Shared by the single and batch paths so both pick the same sample.
+double TerrainTile::_gridIndex(double value, double sw, double ne, int gridSize)
+{
+    return std::floor((value - sw) / (ne - sw) * (gridSize - 1) + 0.5);
+}
+
 int TerrainTile::_latToDataIndex(double latitude) const
 {
     if (isValid() && _southWest.isValid() && _northEast.isValid()) {
-        return qRound((latitude - _southWest.latitude()) / (_northEast.latitude() - _southWest.latitude()) * (_gridSizeLat - 1));
+        return static_cast<int>(_gridIndex(latitude, _southWest.latitude(), _northEast.latitude(), _gridSizeLat));
     } else {
         qCWarning(TerrainTileLog) << "TerrainTile::_latToDataIndex internal error" << isValid() << _southWest.isValid() << _northEast.isValid();
         return -1;
@@ -279,7 +303,7 @@ int TerrainTile::_latToDataIndex(double latitude) const
 int TerrainTile::_lonToDataIndex(double longitude) const
 {
     if (isValid() && _southWest.isValid() && _northEast.isValid()) {
-        return qRound((longitude - _southWest.longitude()) / (_northEast.longitude() - _southWest.longitude()) * (_gridSizeLon - 1));
+        return static_cast<int>(_gridIndex(longitude, _southWest.longitude(), _northEast.longitude(), _gridSizeLon));
     } else {
         qCWarning(TerrainTileLog) << "TerrainTile::_lonToDataIndex internal error" << isValid() << _southWest.isValid() << _northEast.isValid();
         return -1;
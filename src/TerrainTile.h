@@ -4,6 +4,7 @@
 #include "QGCLoggingCategory.h"
 
 #include <QGeoCoordinate>
+#include <QVector>
 
 Q_DECLARE_LOGGING_CATEGORY(TerrainTileLog)
 
@@ -17,7 +18,6 @@ class TerrainTile
 {
 public:
     TerrainTile();
-    ~TerrainTile();
 
     /**
     * Constructor from json doc with elevation data (either from file or web)
@@ -56,6 +56,28 @@ public:
     */
     double elevation(const QGeoCoordinate& coordinate) const;
 
+    /**
+    * Evaluates the elevation of a batch of points given as separate latitude and longitude arrays. Gives the same
+    * result as elevation() for each point and NaN for points outside the tile. There is no per point logging, this
+    * is the one to use for long paths.
+    *
+    * @param latitudes
+    * @param longitudes
+    * @param elevations filled with count values
+    * @param count
+    */
+    void elevations(const double* latitudes, const double* longitudes, double* elevations, int count) const;
+
+    /**
+    * Same as isIn without the logging, for batch lookups
+    *
+    * @return true if within
+    */
+    bool contains(double latitude, double longitude) const {
+        return _isValid && latitude >= _southWest.latitude() && longitude >= _southWest.longitude() &&
+                latitude <= _northEast.latitude() && longitude <= _northEast.longitude();
+    }
+
     /**
     * Accessor for the minimum elevation of the tile
     *
@@ -84,6 +106,13 @@ public:
     */
     QGeoCoordinate centerCoordinate(void) const;
 
+    /**
+    * Approximate memory used by the tile, for cache budgeting
+    *
+    * @return size in bytes
+    */
+    int memorySize(void) const { return static_cast<int>(sizeof(TerrainTile)) + _data.count() * static_cast<int>(sizeof(int16_t)); }
+
     /**
     * Serialize data
     *
@@ -104,6 +133,7 @@ private:
         int16_t gridSizeLon;
     } TileInfo_t;
 
+    static inline double _gridIndex(double value, double sw, double ne, int gridSize);
     inline int _latToDataIndex(double latitude) const;
     inline int _lonToDataIndex(double longitude) const;
 
@@ -114,7 +144,7 @@ private:
     int16_t             _maxElevation;                                  /// Maximum elevation in tile
     double              _avgElevation;                                  /// Average elevation of the tile
 
-    int16_t**           _data;                                          /// 2D elevation data array
+    QVector<int16_t>    _data;                                          /// Elevation data, row major (latitude rows of _gridSizeLon values)
     int16_t             _gridSizeLat;                                   /// data grid size in latitude direction
     int16_t             _gridSizeLon;                                   /// data grid size in longitude direction
     bool                _isValid;                                       /// data loaded is valid
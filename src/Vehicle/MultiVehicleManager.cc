@@ -389,10 +389,7 @@ void MultiVehicleManager::_sendGCSHeartbeat(void)
                                             0,                       // custom mode
                                             MAV_STATE_ACTIVE);       // MAV_STATE
 
-            uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-            int len = mavlink_msg_to_send_buffer(buffer, &message);
-
-            link->writeBytesSafe((const char*)buffer, len);
+            link->sendQueue()->enqueue(message, LinkSendQueue::PriorityControl);
         }
     }
 }
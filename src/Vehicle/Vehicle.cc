@@ -230,7 +230,16 @@ Vehicle::Vehicle(LinkInterface*             link,
     _mavlink = _toolbox->mavlinkProtocol();
     qCDebug(VehicleLog) << "Link started with Mavlink " << (_mavlink->getCurrentVersion() >= 200 ? "V2" : "V1");
 
-    connect(_mavlink, &MAVLinkProtocol::messageReceived,        this, &Vehicle::_mavlinkMessageReceived);
+    // Only messages from this vehicle, broadcasts and RADIO_STATUS from our links are of interest
+    QList<MAVLinkMessageFilter> messageFilters;
+    messageFilters << MAVLinkMessageFilter(_id)
+                   << MAVLinkMessageFilter(0)
+                   << MAVLinkMessageFilter(MAVLinkMessageFilter::anyValue, MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_RADIO_STATUS);
+    _mavlink->messageRouter()->subscribe(this, messageFilters, [this](LinkInterface* link, const MAVLinkMessageBatch& messages) {
+        for (const mavlink_message_t* message: messages) {
+            _mavlinkMessageReceived(link, *message);
+        }
+    });
     connect(_mavlink, &MAVLinkProtocol::mavlinkMessageStatus,   this, &Vehicle::_mavlinkMessageStatus);
 
     _addLink(link);
@@ -2086,11 +2095,7 @@ void Vehicle::_sendMessageOnLink(LinkInterface* link, mavlink_message_t message)
     // Give the plugin a chance to adjust
     _firmwarePlugin->adjustOutgoingMavlinkMessage(this, link, &message);
 
-    // Write message into buffer, prepending start sign
-    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
-    int len = mavlink_msg_to_send_buffer(buffer, &message);
-
-    link->writeBytesSafe((const char*)buffer, len);
+    link->sendQueue()->enqueue(message, LinkSendQueue::priorityForMessage(message.msgid));
     _messagesSent++;
     emit messagesSentChanged();
 }
@@ -3958,6 +3963,7 @@ void Vehicle::_handleADSBVehicle(const mavlink_message_t& message)
         ADSBVehicle::VehicleInfo_t vehicleInfo;
 
         vehicleInfo.availableFlags = 0;
+        vehicleInfo.icaoAddress = adsbVehicleMsg.ICAO_address;
 
         vehicleInfo.location.setLatitude(adsbVehicleMsg.lat / 1e7);
         vehicleInfo.location.setLongitude(adsbVehicleMsg.lon / 1e7);
@@ -3976,6 +3982,12 @@ void Vehicle::_handleADSBVehicle(const mavlink_message_t& message)
             vehicleInfo.availableFlags |= ADSBVehicle::HeadingAvailable;
         }
 
+        if (adsbVehicleMsg.flags & ADSB_FLAGS_VALID_VELOCITY) {
+            vehicleInfo.velocity = (double)adsbVehicleMsg.hor_velocity / 100.0;
+            vehicleInfo.verticalVelocity = (double)adsbVehicleMsg.ver_velocity / 100.0;
+            vehicleInfo.availableFlags |= ADSBVehicle::VelocityAvailable;
+        }
+
         _toolbox->adsbVehicleManager()->adsbVehicleUpdate(vehicleInfo);
     }
 }
@@ -153,7 +153,7 @@ Item {
         QGCTextField {
             text:               _activeJoystick.axisFrequency
             enabled:            advancedSettings.checked
-            validator:          DoubleValidator { bottom: 0.25; top: 50.0; }
+            validator:          DoubleValidator { bottom: 0.25; top: 250.0; }
             inputMethodHints:   Qt.ImhFormattedNumbersOnly
             Layout.alignment:   Qt.AlignVCenter
             onEditingFinished: {
@@ -162,6 +162,18 @@ Item {
             visible:            advancedSettings.checked
         }
         //-----------------------------------------------------------------
+        //-- Measured Axis Message Frequency
+        QGCLabel {
+            text:               qsTr("Measured frequency (Hz):")
+            Layout.alignment:   Qt.AlignVCenter
+            visible:            advancedSettings.checked
+        }
+        QGCLabel {
+            text:               _activeJoystick.sendRate.toFixed(1)
+            Layout.alignment:   Qt.AlignVCenter
+            visible:            advancedSettings.checked
+        }
+        //-----------------------------------------------------------------
         //-- Button Repeat Frequency
         QGCLabel {
             text:               qsTr("Button repeat frequency (Hz):")
@@ -46,6 +46,7 @@ LinkInterface::LinkInterface(SharedLinkConfigurationPointer& config, bool isPX4F
     : QThread                   (0)
     , _config                   (config)
     , _highLatency              (config->isHighLatency())
+    , _sendQueue                (new LinkSendQueue(this))
     , _mavlinkChannelSet        (false)
     , _enableRateCollection     (false)
     , _decodedFirstMavlinkPacket(false)
@@ -66,6 +67,8 @@ LinkInterface::LinkInterface(SharedLinkConfigurationPointer& config, bool isPX4F
     memset(_outDataWriteTimes,  0, sizeof(_outDataWriteTimes));
 
     QObject::connect(this, &LinkInterface::_invokeWriteBytes, this, &LinkInterface::_writeBytes);
+    // The queue is a child so it always lives in the same thread as the link
+    QObject::connect(_sendQueue, &LinkSendQueue::writeBytes, this, &LinkInterface::_writeBytes, Qt::DirectConnection);
     qRegisterMetaType<LinkInterface*>("LinkInterface*");
 }
 
@@ -21,6 +21,7 @@
 #include "QGCMAVLink.h"
 #include "LinkConfiguration.h"
 #include "MavlinkMessagesTimer.h"
+#include "LinkSendQueue.h"
 
 class LinkManager;
 
@@ -43,6 +44,7 @@ public:
 
     Q_PROPERTY(bool active      READ active     NOTIFY activeChanged)
     Q_PROPERTY(bool isPX4Flow   READ isPX4Flow  CONSTANT)
+    Q_PROPERTY(LinkSendQueue* sendQueue READ sendQueue CONSTANT)
 
     Q_INVOKABLE bool link_active(int vehicle_id) const;
     Q_INVOKABLE bool getHighLatency(void) const { return _highLatency; }
@@ -53,6 +55,10 @@ public:
 
     LinkConfiguration* getLinkConfiguration(void) { return _config.data(); }
 
+    /// Outbound MAVLink messages should be queued here rather than written with writeBytesSafe, so they are
+    /// prioritized, coalesced and rate limited along with all other traffic on the link.
+    LinkSendQueue* sendQueue(void) { return _sendQueue; }
+
     /* Connection management */
 
     /**
@@ -230,6 +236,7 @@ protected:
 
     SharedLinkConfigurationPointer _config;
     bool _highLatency;
+    LinkSendQueue* _sendQueue;
 
 private:
     /**
@@ -85,7 +85,9 @@ void LinkManager::setToolbox(QGCToolbox *toolbox)
     _autoConnectSettings = toolbox->settingsManager()->autoConnectSettings();
     _mavlinkProtocol = _toolbox->mavlinkProtocol();
 
-    connect(_mavlinkProtocol, &MAVLinkProtocol::messageReceived, this, &LinkManager::_mavlinkMessageReceived);
+    _mavlinkProtocol->messageRouter()->subscribe(this, MAVLinkMessageFilter(), [this](LinkInterface* link, const MAVLinkMessageBatch& messages) {
+        _mavlinkMessagesReceived(link, messages);
+    });
 
     connect(&_portListTimer, &QTimer::timeout, this, &LinkManager::_updateAutoConnectLinks);
     _portListTimer.start(_autoconnectUpdateTimerMSecs); // timeout must be long enough to get past bootloader on second pass
@@ -198,11 +200,12 @@ void LinkManager::_addLink(LinkInterface* link)
     }
 
     connect(link, &LinkInterface::communicationError,   _app,               &QGCApplication::criticalMessageBoxOnMainThread);
-    connect(link, &LinkInterface::bytesReceived,        _mavlinkProtocol,   &MAVLinkProtocol::receiveBytes);
     connect(link, &LinkInterface::bytesSent,            _mavlinkProtocol,   &MAVLinkProtocol::logSentBytes);
 
     _mavlinkProtocol->resetMetadataForLink(link);
     _mavlinkProtocol->setVersion(_mavlinkProtocol->getCurrentVersion());
+    // Incoming bytes are decoded on a per link worker thread
+    _mavlinkProtocol->attachLink(link);
 
     connect(link, &LinkInterface::connected,            this, &LinkManager::_linkConnected);
     connect(link, &LinkInterface::disconnected,         this, &LinkManager::_linkDisconnected);
@@ -264,6 +267,9 @@ void LinkManager::_deleteLink(LinkInterface* link)
         return;
     }
 
+    // Stop decoding before the mavlink channel can be handed out to another link
+    _mavlinkProtocol->detachLink(link);
+
     // Free up the mavlink channel associated with this link
     _freeMavlinkChannel(link->mavlinkChannel());
 
@@ -1009,8 +1015,16 @@ void LinkManager::_freeMavlinkChannel(int channel)
     _mavlinkChannelsUsedBitMask &= ~(1 << channel);
 }
 
-void LinkManager::_mavlinkMessageReceived(LinkInterface* link, mavlink_message_t message) {
-    link->startMavlinkMessagesTimer(message.sysid);
+void LinkManager::_mavlinkMessagesReceived(LinkInterface* link, const MAVLinkMessageBatch& messages)
+{
+    // Batches are usually a run of messages from the same vehicle, only restart the timer when the vehicle changes
+    int lastSysId = -1;
+    for (const mavlink_message_t* message: messages) {
+        if (message->sysid != lastSysId) {
+            lastSysId = message->sysid;
+            link->startMavlinkMessagesTimer(message->sysid);
+        }
+    }
 }
 
 LogReplayLink* LinkManager::startLogReplay(const QString& logFile)
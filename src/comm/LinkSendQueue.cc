@@ -0,0 +1,334 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "LinkSendQueue.h"
+#include "QGCLoggingCategory.h"
+
+#include <QtMath>
+
+QGC_LOGGING_CATEGORY(LinkSendQueueLog, "LinkSendQueueLog")
+
+LinkSendQueue::LinkSendQueue(QObject* parent)
+    : QObject                   (parent)
+    , _rateLimitTimer           (this)
+    , _statsTimer               (this)
+    , _flushPending             (false)
+    , _waitingForTokens         (false)
+    , _maxWriteSize             (defaultMaxWriteSize)
+    , _rateLimit                (0)
+    , _tokens                   (0)
+    , _tokensUpdatedNsecs       (0)
+    , _queueDepth               (0)
+    , _peakQueueDepth           (0)
+    , _messagesSent             (0)
+    , _messagesDropped          (0)
+    , _periodMessages           (0)
+    , _periodWrites             (0)
+    , _periodLatencyNsecs       (0)
+    , _periodMaxLatencyNsecs    (0)
+    , _averageLatencyMsecs      (0)
+    , _maxLatencyMsecs          (0)
+    , _messagesPerWrite         (0)
+{
+    for (PriorityQueue_t& queue: _queues) {
+        queue.bytes = 0;
+    }
+    memset(&_txStatus, 0, sizeof(_txStatus));
+    _txStatus.flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+    _clock.start();
+
+    // Timers are children so they follow the queue when the owning link moves itself to its own thread
+    _rateLimitTimer.setSingleShot(true);
+    _statsTimer.setInterval(_statsIntervalMsecs);
+    connect(&_rateLimitTimer,   &QTimer::timeout, this, &LinkSendQueue::_flush);
+    connect(&_statsTimer,       &QTimer::timeout, this, &LinkSendQueue::_updateStats);
+}
+
+LinkSendQueue::Priority LinkSendQueue::priorityForMessage(uint32_t msgid)
+{
+    switch (msgid) {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+    case MAVLINK_MSG_ID_MANUAL_CONTROL:
+    case MAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE:
+    case MAVLINK_MSG_ID_SET_ATTITUDE_TARGET:
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED:
+    case MAVLINK_MSG_ID_SET_POSITION_TARGET_GLOBAL_INT:
+        return PriorityControl;
+    // Only messages whose order relative to other traffic doesn't matter can go here. For example PARAM_SET stays
+    // normal so a command which follows it can't overtake it.
+    case MAVLINK_MSG_ID_MISSION_ITEM:
+    case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+    case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+    case MAVLINK_MSG_ID_PARAM_REQUEST_READ:
+    case MAVLINK_MSG_ID_LOG_REQUEST_DATA:
+    case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+        return PriorityBulk;
+    default:
+        return PriorityNormal;
+    }
+}
+
+/// Must be called with the mutex held
+int LinkSendQueue::_sendBufferLength(uint8_t payloadLength) const
+{
+    if (_txStatus.flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1) {
+        return MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + payloadLength + MAVLINK_NUM_CHECKSUM_BYTES;
+    }
+    return MAVLINK_NUM_NON_PAYLOAD_BYTES + payloadLength;
+}
+
+bool LinkSendQueue::enqueue(const mavlink_message_t& message, Priority priority)
+{
+    QMutexLocker locker(&_mutex);
+
+    // Payload length is settled when the message is written, until then the largest it can be is counted
+    const mavlink_msg_entry_t* msgEntry = mavlink_get_msg_entry(message.msgid);
+    int length = _sendBufferLength(msgEntry ? msgEntry->max_msg_len : message.len);
+
+    PriorityQueue_t& queue = _queues[priority];
+    if (queue.bytes + length > maxQueuedBytes) {
+        if (_messagesDropped++ == 0) {
+            qCWarning(LinkSendQueueLog) << "Send queue full, dropping messages. Priority:" << priority;
+        }
+        return false;
+    }
+
+    queue.bytes += length;
+    queue.entries.enqueue({ message, length, _clock.nsecsElapsed() });
+    _queueDepth++;
+    _peakQueueDepth = qMax(_peakQueueDepth, _queueDepth);
+
+    // While waiting on the rate limit the timer flushes, only control traffic needs to go out right away
+    if (!_waitingForTokens || priority == PriorityControl) {
+        _scheduleFlush();
+    }
+
+    return true;
+}
+
+void LinkSendQueue::clear(void)
+{
+    QMutexLocker locker(&_mutex);
+
+    for (PriorityQueue_t& queue: _queues) {
+        queue.bytes = 0;
+        queue.entries.clear();
+    }
+    _queueDepth = 0;
+}
+
+void LinkSendQueue::setOutboundMavlink1(bool mavlink1)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (mavlink1) {
+        _txStatus.flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+    } else {
+        _txStatus.flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+    }
+}
+
+void LinkSendQueue::setMaxWriteSize(int bytes)
+{
+    QMutexLocker locker(&_mutex);
+    _maxWriteSize = qMax(bytes, static_cast<int>(MAVLINK_MAX_PACKET_LEN));
+}
+
+void LinkSendQueue::setRateLimit(qint64 bytesPerSecond)
+{
+    QMutexLocker locker(&_mutex);
+
+    qCDebug(LinkSendQueueLog) << "Rate limit" << bytesPerSecond;
+    _rateLimit          = qMax(bytesPerSecond, static_cast<qint64>(0));
+    _tokens             = _maxWriteSize;
+    _tokensUpdatedNsecs = _clock.nsecsElapsed();
+    _scheduleFlush();
+}
+
+/// Must be called with the mutex held
+void LinkSendQueue::_scheduleFlush(void)
+{
+    if (!_flushPending) {
+        _flushPending = true;
+        QMetaObject::invokeMethod(this, &LinkSendQueue::_flush, Qt::QueuedConnection);
+    }
+}
+
+/// Must be called with the mutex held
+void LinkSendQueue::_refillTokens(qint64 nowNsecs)
+{
+    if (_rateLimit == 0) {
+        return;
+    }
+
+    // Allow a short burst after an idle period, but always at least one full write
+    double burst = qMax(static_cast<double>(_rateLimit) / 20.0, static_cast<double>(_maxWriteSize));
+
+    _tokens = qMin(_tokens + (static_cast<double>(nowNsecs - _tokensUpdatedNsecs) * _rateLimit / 1e9), burst);
+    _tokensUpdatedNsecs = nowNsecs;
+}
+
+void LinkSendQueue::_flush(void)
+{
+    QList<QByteArray> writes;
+    int waitMsecs = -1;
+
+    {
+        QMutexLocker locker(&_mutex);
+
+        _flushPending       = false;
+        _waitingForTokens   = false;
+
+        qint64 now = _clock.nsecsElapsed();
+        _refillTokens(now);
+
+        QByteArray write;
+        write.reserve(_maxWriteSize);
+
+        while (true) {
+            int priority = 0;
+            while (priority < PriorityCount && _queues[priority].entries.isEmpty()) {
+                priority++;
+            }
+            if (priority == PriorityCount) {
+                break;
+            }
+
+            PriorityQueue_t&    queue = _queues[priority];
+            Entry_t&            entry = queue.entries.head();
+
+            if (_rateLimit && priority != PriorityControl && _tokens < entry.length) {
+                // Lower priorities are empty or waiting too, so nothing else can go out now
+                waitMsecs = qCeil((entry.length - _tokens) * 1000.0 / _rateLimit);
+                _waitingForTokens = true;
+                break;
+            }
+
+            // This is the only place sequence numbers are assigned, so messages from every thread share one sequence
+            mavlink_message_t&          message     = entry.message;
+            const mavlink_msg_entry_t*  msgEntry    = mavlink_get_msg_entry(message.msgid);
+            if (msgEntry) {
+                mavlink_finalize_message_buffer(&message, message.sysid, message.compid, &_txStatus,
+                                                msgEntry->min_msg_len, msgEntry->max_msg_len, msgEntry->crc_extra);
+            } else {
+                qCWarning(LinkSendQueueLog) << "Unknown message id, sending as packed:" << message.msgid;
+            }
+
+            uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+            int length = mavlink_msg_to_send_buffer(buffer, &message);
+
+            if (write.size() + length > _maxWriteSize && !write.isEmpty()) {
+                writes.append(write);
+                write.clear();
+                write.reserve(_maxWriteSize);
+            }
+            write.append(reinterpret_cast<const char*>(buffer), length);
+
+            if (_rateLimit) {
+                // Control traffic can run the bucket into debt, which then holds back everything else
+                _tokens = qMax(_tokens - length, -static_cast<double>(_maxWriteSize));
+            }
+
+            qint64 latency = now - entry.queuedNsecs;
+            _periodLatencyNsecs     += latency;
+            _periodMaxLatencyNsecs  = qMax(_periodMaxLatencyNsecs, latency);
+            _periodMessages++;
+            _messagesSent++;
+            _queueDepth--;
+
+            queue.bytes -= entry.length;
+            queue.entries.dequeue();
+        }
+
+        if (!write.isEmpty()) {
+            writes.append(write);
+        }
+        _periodWrites += writes.count();
+    }
+
+    // Written outside the lock so other threads can keep queueing while the link is busy
+    for (const QByteArray& write: writes) {
+        emit writeBytes(write);
+    }
+
+    if (waitMsecs >= 0) {
+        _rateLimitTimer.start(waitMsecs);
+    }
+    if (!_statsTimer.isActive()) {
+        _statsTimer.start();
+    }
+}
+
+void LinkSendQueue::_updateStats(void)
+{
+    bool idle;
+
+    {
+        QMutexLocker locker(&_mutex);
+
+        _averageLatencyMsecs    = _periodMessages ? static_cast<double>(_periodLatencyNsecs) / _periodMessages / 1e6 : 0;
+        _maxLatencyMsecs        = static_cast<double>(_periodMaxLatencyNsecs) / 1e6;
+        _messagesPerWrite       = _periodWrites ? static_cast<double>(_periodMessages) / _periodWrites : 0;
+        idle                    = _periodMessages == 0 && _queueDepth == 0;
+
+        _periodMessages         = 0;
+        _periodWrites           = 0;
+        _periodLatencyNsecs     = 0;
+        _periodMaxLatencyNsecs  = 0;
+    }
+
+    if (idle) {
+        // Restarted by the next flush
+        _statsTimer.stop();
+    }
+
+    emit statsChanged();
+}
+
+int LinkSendQueue::queueDepth(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _queueDepth;
+}
+
+int LinkSendQueue::peakQueueDepth(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _peakQueueDepth;
+}
+
+double LinkSendQueue::averageLatencyMsecs(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _averageLatencyMsecs;
+}
+
+double LinkSendQueue::maxLatencyMsecs(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _maxLatencyMsecs;
+}
+
+double LinkSendQueue::messagesPerWrite(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _messagesPerWrite;
+}
+
+quint64 LinkSendQueue::messagesSent(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _messagesSent;
+}
+
+quint64 LinkSendQueue::messagesDropped(void) const
+{
+    QMutexLocker locker(&_mutex);
+    return _messagesDropped;
+}
@@ -0,0 +1,142 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QQueue>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include "QGCMAVLink.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LinkSendQueueLog)
+
+/// Outbound message scheduler for a single link. Messages can be queued from any thread and are written from the
+/// thread the queue lives in, which is the thread of the owning link.
+///
+/// Messages are sent in priority order and in queued order within a priority. Everything which is queued by the time
+/// the link thread gets to the queue is coalesced into as few writes as possible, each write at most maxWriteSize
+/// bytes, so a burst of small messages becomes one datagram instead of many. If a rate limit is set, normal and bulk
+/// traffic waits for the link to catch up. Control traffic is never held back but still counts against the limit.
+///
+/// Sequence numbers are assigned as messages are written out, so they always go out in sequence no matter which
+/// thread or priority they were queued from.
+class LinkSendQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    LinkSendQueue(QObject* parent = nullptr);
+
+    Q_PROPERTY(int      queueDepth          READ queueDepth         NOTIFY statsChanged)    ///< Messages waiting to be written
+    Q_PROPERTY(int      peakQueueDepth      READ peakQueueDepth     NOTIFY statsChanged)
+    Q_PROPERTY(double   averageLatencyMsecs READ averageLatencyMsecs NOTIFY statsChanged)   ///< Queued to written, over the last stats period
+    Q_PROPERTY(double   maxLatencyMsecs     READ maxLatencyMsecs    NOTIFY statsChanged)    ///< Queued to written, over the last stats period
+    Q_PROPERTY(double   messagesPerWrite    READ messagesPerWrite   NOTIFY statsChanged)    ///< Coalescing ratio over the last stats period
+    Q_PROPERTY(quint64  messagesSent        READ messagesSent       NOTIFY statsChanged)
+    Q_PROPERTY(quint64  messagesDropped     READ messagesDropped    NOTIFY statsChanged)
+
+    enum Priority {
+        PriorityControl = 0,    ///< Streamed vehicle control, stale as soon as the next one is ready
+        PriorityNormal,         ///< Commands and everything not listed elsewhere
+        PriorityBulk,           ///< Transfers which move a lot of data: mission items, parameter reads, logs, ftp
+        PriorityCount
+    };
+
+    /// Priority a message is queued at by default
+    static Priority priorityForMessage(uint32_t msgid);
+
+    /// Queues a message. Only the payload, msgid, sysid and compid are used, the rest of the header is filled in when
+    /// the message is written out. Thread safe.
+    ///     @return false: queue for this priority is full, message was dropped
+    bool enqueue(const mavlink_message_t& message, Priority priority);
+
+    /// Drops all queued messages. Thread safe.
+    void clear(void);
+
+    /// Sets the largest write coalesced messages are combined into. Thread safe.
+    void setMaxWriteSize(int bytes);
+
+    /// Sets the protocol version messages are written with. Queues start out on MAVLink 1, the same as link
+    /// channels do. Thread safe.
+    void setOutboundMavlink1(bool mavlink1);
+
+    /// Limits the rate messages are written at. Thread safe.
+    ///     @param bytesPerSecond 0 for no limit
+    void setRateLimit(qint64 bytesPerSecond);
+
+    int     queueDepth          (void) const;
+    int     peakQueueDepth      (void) const;
+    double  averageLatencyMsecs (void) const;
+    double  maxLatencyMsecs     (void) const;
+    double  messagesPerWrite    (void) const;
+    quint64 messagesSent        (void) const;
+    quint64 messagesDropped     (void) const;
+
+    static const int    defaultMaxWriteSize = 1200;         ///< Stays below a typical ethernet/wifi MTU
+    static const int    maxQueuedBytes      = 256 * 1024;   ///< Per priority
+
+signals:
+    /// Connected directly to the link write. Always emitted from the thread the queue lives in.
+    void writeBytes(const QByteArray bytes);
+
+    void statsChanged(void);
+
+private slots:
+    void _flush         (void);
+    void _updateStats   (void);
+
+private:
+    typedef struct {
+        mavlink_message_t   message;
+        int                 length;     ///< Bytes the message takes when written
+        qint64              queuedNsecs;
+    } Entry_t;
+
+    typedef struct {
+        int             bytes;
+        QQueue<Entry_t> entries;
+    } PriorityQueue_t;
+
+    int _sendBufferLength(uint8_t payloadLength) const;
+
+    void _scheduleFlush (void);
+    void _refillTokens  (qint64 nowNsecs);
+
+    mutable QMutex      _mutex;
+    PriorityQueue_t     _queues[PriorityCount];
+    mavlink_status_t    _txStatus;              ///< Sequence numbering and protocol version of written messages
+    QElapsedTimer       _clock;
+    QTimer              _rateLimitTimer;
+    QTimer              _statsTimer;
+    bool                _flushPending;
+    bool                _waitingForTokens;
+    int                 _maxWriteSize;
+    qint64              _rateLimit;             ///< Bytes per second, 0 for none
+    double              _tokens;                ///< Bytes which can be written before the limit is hit
+    qint64              _tokensUpdatedNsecs;
+
+    int                 _queueDepth;
+    int                 _peakQueueDepth;
+    quint64             _messagesSent;
+    quint64             _messagesDropped;
+    quint64             _periodMessages;        ///< Stats accumulated over the current stats period
+    quint64             _periodWrites;
+    qint64              _periodLatencyNsecs;
+    qint64              _periodMaxLatencyNsecs;
+    double              _averageLatencyMsecs;   ///< Stats from the last completed stats period
+    double              _maxLatencyMsecs;
+    double              _messagesPerWrite;
+
+    static const int    _statsIntervalMsecs = 1000;
+};
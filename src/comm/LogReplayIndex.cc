@@ -0,0 +1,326 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "LogReplayIndex.h"
+#include "QGCLoggingCategory.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <algorithm>
+
+QGC_LOGGING_CATEGORY(LogReplayIndexLog, "LogReplayIndexLog")
+
+const char* LogReplayIndex::_indexFileSuffix = ".qgcidx";
+
+LogReplayIndex::LogReplayIndex(void)
+    : _startTimeUSecs   (0)
+    , _endTimeUSecs     (0)
+    , _buildCanceled    (0)
+{
+
+}
+
+QString LogReplayIndex::indexFilename(const QString& logFilename)
+{
+    return logFilename + _indexFileSuffix;
+}
+
+quint64 LogReplayIndex::parseTimestamp(const char* bytes)
+{
+    quint64 timestamp = qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(bytes));
+    quint64 currentTimestamp = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000;
+
+    // Now if the parsed timestamp is in the future, it must be an old file where the timestamp was stored as
+    // little endian, so switch it.
+    if (timestamp > currentTimestamp) {
+        timestamp = qbswap(timestamp);
+    }
+
+    return timestamp;
+}
+
+bool LogReplayIndex::loadOrBuild(const QString& logFilename, QString& errorString)
+{
+    _entries.clear();
+    _events.clear();
+    _startTimeUSecs = 0;
+    _endTimeUSecs = 0;
+
+    if (_load(logFilename)) {
+        qCDebug(LogReplayIndexLog) << "Loaded index" << indexFilename(logFilename) << "entries" << _entries.count() << "events" << _events.count();
+        return true;
+    }
+
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    if (!_build(logFilename, errorString)) {
+        return false;
+    }
+    qCDebug(LogReplayIndexLog) << "Built index for" << logFilename << "in" << buildTimer.elapsed() << "msecs entries" << _entries.count() << "events" << _events.count();
+
+    _save(logFilename);
+
+    return true;
+}
+
+bool LogReplayIndex::_build(const QString& logFilename, QString& errorString)
+{
+    QFile logFile(logFilename);
+    if (!logFile.open(QFile::ReadOnly)) {
+        errorString = QObject::tr("Unable to open log file: '%1', error: %2").arg(logFilename).arg(logFile.errorString());
+        return false;
+    }
+
+    memset(_armed, 0, sizeof(_armed));
+    memset(_heardFrom, 0, sizeof(_heardFrom));
+    memset(_customMode, 0, sizeof(_customMode));
+
+    // Records are a timestamp followed by a mavlink packet. We read large blocks and run the parser over them
+    // instead of going through QFile a byte at a time. A record's timestamp is taken from the bytes in front of
+    // the packet's start marker, so a corrupt or truncated record doesn't shift the records which follow it.
+    // The parser state is our own since the link's channel status is shared with the main thread.
+    const qint64        blockSize           = 1024 * 1024;
+    qint64              readPos             = 0;
+    qint64              parsePos            = 0;    ///< Bytes before this only feed recentBytes
+    quint64             recentBytes         = 0;    ///< The cbTimestamp bytes before the current one, big endian
+    qint64              frameStartPos       = 0;    ///< Position of the start marker of the frame being parsed
+    quint64             frameTimestampBytes = 0;
+    quint64             lastEntryUSecs      = 0;
+    mavlink_message_t   rxMessage;
+    mavlink_status_t    rxStatus;
+    mavlink_message_t   message;
+    mavlink_status_t    status;
+
+    memset(&rxStatus, 0, sizeof(rxStatus));
+
+    while (true) {
+        if (_buildCanceled.loadAcquire()) {
+            errorString = QObject::tr("Loading of log file '%1' was canceled.").arg(logFilename);
+            return false;
+        }
+
+        if (!logFile.seek(readPos)) {
+            break;
+        }
+        QByteArray block = logFile.read(blockSize);
+        if (block.isEmpty()) {
+            break;
+        }
+        const char*     data        = block.constData();
+        const int       count       = block.count();
+        const qint64    blockStart  = readPos;
+        readPos += count;
+
+        for (int i=0; i<count; i++) {
+            const qint64    pos     = blockStart + i;
+            const uint8_t   c       = static_cast<uint8_t>(data[i]);
+            uint8_t         result  = MAVLINK_FRAMING_INCOMPLETE;
+
+            if (pos >= parsePos) {
+                result = mavlink_frame_char_buffer(&rxMessage, &rxStatus, c, &message, &status);
+                if (rxStatus.parse_state == MAVLINK_PARSE_STATE_GOT_STX) {
+                    frameStartPos       = pos;
+                    frameTimestampBytes = recentBytes;
+                }
+            }
+            recentBytes = (recentBytes << 8) | c;
+
+            if (result == MAVLINK_FRAMING_BAD_CRC || result == MAVLINK_FRAMING_BAD_SIGNATURE) {
+                // The start marker may have been a stray byte, or the frame may be cut short, either of which swallows
+                // the start of the next record. Resync by scanning again from just after the bad start marker.
+                memset(&rxStatus, 0, sizeof(rxStatus));
+                recentBytes = 0;
+                parsePos    = frameStartPos + 1;
+
+                qint64 rescanPos = qMax(parsePos - cbTimestamp, static_cast<qint64>(0));
+                if (rescanPos >= blockStart) {
+                    i = static_cast<int>(rescanPos - blockStart) - 1;
+                    continue;
+                }
+                readPos = rescanPos;
+                break;
+            }
+
+            if (result != MAVLINK_FRAMING_OK || frameStartPos < cbTimestamp) {
+                continue;
+            }
+
+            char timestampBytes[cbTimestamp];
+            qToBigEndian(frameTimestampBytes, timestampBytes);
+            const quint64   recordTimestamp = parseTimestamp(timestampBytes);
+            const qint64    recordOffset    = frameStartPos - cbTimestamp;
+
+            if (_entries.isEmpty()) {
+                _startTimeUSecs = recordTimestamp;
+            }
+            // Only keep entries in time order so a binary search over the index stays valid if the log clock jumps back
+            if (_entries.isEmpty() || recordTimestamp >= lastEntryUSecs + _entryIntervalUSecs) {
+                _entries.append({ recordTimestamp, recordOffset });
+                lastEntryUSecs = recordTimestamp;
+            }
+            _endTimeUSecs = recordTimestamp;
+
+            _handleMessage(message, recordTimestamp, recordOffset);
+        }
+    }
+
+    if (_entries.isEmpty() || _endTimeUSecs <= _startTimeUSecs) {
+        _entries.clear();
+        _events.clear();
+        errorString = QObject::tr("The log file '%1' is corrupt or empty.").arg(logFilename);
+        return false;
+    }
+
+    std::stable_sort(_events.begin(), _events.end(), [](const Event_t& a, const Event_t& b) { return a.timestampUSecs < b.timestampUSecs; });
+    _entries.squeeze();
+    _events.squeeze();
+
+    return true;
+}
+
+void LogReplayIndex::_handleMessage(const mavlink_message_t& message, quint64 timestampUSecs, qint64 offset)
+{
+    switch (message.msgid) {
+    case MAVLINK_MSG_ID_HEARTBEAT:
+    {
+        mavlink_heartbeat_t heartbeat;
+        mavlink_msg_heartbeat_decode(&message, &heartbeat);
+
+        // Only track vehicles, not other ground stations or non-autopilot components
+        if (heartbeat.type == MAV_TYPE_GCS || heartbeat.autopilot == MAV_AUTOPILOT_INVALID) {
+            return;
+        }
+
+        const int   sysid   = message.sysid;
+        const bool  armed   = heartbeat.base_mode & MAV_MODE_FLAG_SAFETY_ARMED;
+        if (_heardFrom[sysid]) {
+            if (armed != _armed[sysid]) {
+                _events.append({ timestampUSecs, offset, static_cast<quint8>(armed ? EventArmed : EventDisarmed), message.sysid });
+            }
+            if (heartbeat.custom_mode != _customMode[sysid]) {
+                _events.append({ timestampUSecs, offset, static_cast<quint8>(EventModeChange), message.sysid });
+            }
+        }
+        _heardFrom[sysid]   = true;
+        _armed[sysid]       = armed;
+        _customMode[sysid]  = heartbeat.custom_mode;
+        break;
+    }
+    case MAVLINK_MSG_ID_STATUSTEXT:
+        _events.append({ timestampUSecs, offset, static_cast<quint8>(EventStatusText), message.sysid });
+        break;
+    default:
+        break;
+    }
+}
+
+bool LogReplayIndex::_load(const QString& logFilename)
+{
+    QFileInfo logInfo(logFilename);
+    QFile indexFile(indexFilename(logFilename));
+
+    if (!indexFile.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&indexFile);
+    quint32 magic, version;
+    qint64  logSize, logModifiedMSecs;
+    stream >> magic >> version >> logSize >> logModifiedMSecs;
+    if (stream.status() != QDataStream::Ok || magic != _fileMagic || version != _fileVersion) {
+        qCDebug(LogReplayIndexLog) << "Ignoring index with bad header" << indexFile.fileName();
+        return false;
+    }
+    if (logSize != logInfo.size() || logModifiedMSecs != logInfo.lastModified().toMSecsSinceEpoch()) {
+        qCDebug(LogReplayIndexLog) << "Ignoring stale index" << indexFile.fileName();
+        return false;
+    }
+
+    quint32 entryCount, eventCount;
+    stream >> _startTimeUSecs >> _endTimeUSecs >> entryCount >> eventCount;
+    if (stream.status() != QDataStream::Ok || entryCount == 0 || _endTimeUSecs <= _startTimeUSecs) {
+        return false;
+    }
+
+    _entries.resize(static_cast<int>(entryCount));
+    for (Entry_t& entry: _entries) {
+        stream >> entry.timestampUSecs >> entry.offset;
+    }
+    _events.resize(static_cast<int>(eventCount));
+    for (Event_t& event: _events) {
+        stream >> event.timestampUSecs >> event.offset >> event.type >> event.sysid;
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qCDebug(LogReplayIndexLog) << "Ignoring truncated index" << indexFile.fileName();
+        _entries.clear();
+        _events.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void LogReplayIndex::_save(const QString& logFilename) const
+{
+    QFileInfo logInfo(logFilename);
+    QSaveFile indexFile(indexFilename(logFilename));
+
+    // The log may live on read-only media, in which case we just keep the index in memory
+    if (!indexFile.open(QFile::WriteOnly)) {
+        qCDebug(LogReplayIndexLog) << "Unable to save index" << indexFile.fileName() << indexFile.errorString();
+        return;
+    }
+
+    QDataStream stream(&indexFile);
+    stream << _fileMagic << _fileVersion << static_cast<qint64>(logInfo.size()) << static_cast<qint64>(logInfo.lastModified().toMSecsSinceEpoch());
+    stream << _startTimeUSecs << _endTimeUSecs << static_cast<quint32>(_entries.count()) << static_cast<quint32>(_events.count());
+    for (const Entry_t& entry: _entries) {
+        stream << entry.timestampUSecs << entry.offset;
+    }
+    for (const Event_t& event: _events) {
+        stream << event.timestampUSecs << event.offset << event.type << event.sysid;
+    }
+
+    if (!indexFile.commit()) {
+        qCDebug(LogReplayIndexLog) << "Unable to save index" << indexFile.fileName() << indexFile.errorString();
+    }
+}
+
+qint64 LogReplayIndex::offsetForTimestamp(quint64 timestampUSecs) const
+{
+    if (_entries.isEmpty()) {
+        return 0;
+    }
+
+    auto iter = std::upper_bound(_entries.constBegin(), _entries.constEnd(), timestampUSecs,
+                                 [](quint64 timestamp, const Entry_t& entry) { return timestamp < entry.timestampUSecs; });
+    if (iter != _entries.constBegin()) {
+        --iter;
+    }
+    return iter->offset;
+}
+
+const LogReplayIndex::Event_t* LogReplayIndex::nextEvent(quint64 afterUSecs, int eventTypeMask) const
+{
+    auto iter = std::upper_bound(_events.constBegin(), _events.constEnd(), afterUSecs,
+                                 [](quint64 timestamp, const Event_t& event) { return timestamp < event.timestampUSecs; });
+    for (; iter != _events.constEnd(); ++iter) {
+        if (iter->type & eventTypeMask) {
+            return &(*iter);
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QLoggingCategory>
+
+#include "QGCMAVLink.h"
+
+Q_DECLARE_LOGGING_CATEGORY(LogReplayIndexLog)
+
+/// Time to file offset index for a telemetry log (.tlog).
+///
+/// The index holds one entry for the first record of every _entryIntervalUSecs slice of the log, which keeps
+/// it small even for multi-GB logs while bounding the forward scan required after a seek. It also records
+/// the position of arm/disarm, flight mode change and STATUSTEXT events. The index is built with a single
+/// pass over the log and persisted to a sidecar file next to the log so later opens skip the scan.
+class LogReplayIndex
+{
+public:
+    LogReplayIndex(void);
+
+    typedef enum {
+        EventArmed          = 1 << 0,
+        EventDisarmed       = 1 << 1,
+        EventModeChange     = 1 << 2,
+        EventStatusText     = 1 << 3,
+        EventAll            = EventArmed | EventDisarmed | EventModeChange | EventStatusText,
+    } EventType_t;
+
+    typedef struct {
+        quint64 timestampUSecs;
+        qint64  offset;             ///< File offset of the record's timestamp
+    } Entry_t;
+
+    typedef struct {
+        quint64 timestampUSecs;
+        qint64  offset;             ///< File offset of the record's timestamp
+        quint8  type;               ///< EventType_t
+        quint8  sysid;
+    } Event_t;
+
+    /// Loads the sidecar index for the specified log if it exists and matches the log, otherwise builds the
+    /// index by scanning the log and then tries to save the sidecar. Can be called from any thread.
+    ///     @return false: log could not be read, contains no timestamped messages or the build was canceled
+    bool loadOrBuild(const QString& logFilename, QString& errorString);
+
+    /// Stops a build running on another thread. loadOrBuild returns false soon after.
+    void cancelBuild(void) { _buildCanceled.storeRelease(1); }
+
+    bool    isValid         (void) const { return !_entries.isEmpty(); }
+    quint64 startTimeUSecs  (void) const { return _startTimeUSecs; }
+    quint64 endTimeUSecs    (void) const { return _endTimeUSecs; }
+
+    /// @return File offset of the indexed record at or before the specified time. Records from that offset
+    /// forward need to be scanned to find the exact record.
+    qint64 offsetForTimestamp(quint64 timestampUSecs) const;
+
+    /// @return First event of one of the specified types strictly after the specified time, nullptr for none
+    const Event_t* nextEvent(quint64 afterUSecs, int eventTypeMask) const;
+
+    /// @return Sidecar file name used to persist the index for the specified log
+    static QString indexFilename(const QString& logFilename);
+
+    /// Parses a BigEndian quint64 timestamp
+    /// @return A Unix timestamp in microseconds UTC
+    static quint64 parseTimestamp(const char* bytes);
+
+    static const int cbTimestamp = sizeof(quint64);
+
+private:
+    bool _build (const QString& logFilename, QString& errorString);
+    bool _load  (const QString& logFilename);
+    void _save  (const QString& logFilename) const;
+    void _handleMessage(const mavlink_message_t& message, quint64 timestampUSecs, qint64 offset);
+
+    QVector<Entry_t>    _entries;
+    QVector<Event_t>    _events;
+    quint64             _startTimeUSecs;
+    quint64             _endTimeUSecs;
+    QAtomicInt          _buildCanceled;
+
+    // Per system state used while building
+    bool                _armed[256];
+    bool                _heardFrom[256];
+    quint32             _customMode[256];
+
+    static const quint64    _entryIntervalUSecs = 100000;
+    static const quint32    _fileMagic          = 0x51474358;   // "QGCX"
+    static const quint32    _fileVersion        = 1;
+    static const char*      _indexFileSuffix;
+};
@@ -13,8 +13,10 @@
 #include "QGCApplication.h"
 
 #include <QFileInfo>
-#include <QtEndian>
 #include <QSignalSpy>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <QFutureWatcher>
 
 const char*  LogReplayLinkConfiguration::_logFilenameKey = "logFilename";
 
@@ -67,16 +69,22 @@ QString LogReplayLinkConfiguration::logFilenameShort(void)
 }
 
 LogReplayLink::LogReplayLink(SharedLinkConfigurationPointer& config)
-    : LinkInterface     (config)
-    , _logReplayConfig  (qobject_cast<LogReplayLinkConfiguration*>(config.data()))
-    , _connected        (false)
-    , _playbackSpeed    (1)
+    : LinkInterface         (config)
+    , _logReplayConfig      (qobject_cast<LogReplayLinkConfiguration*>(config.data()))
+    , _connected            (false)
+    , _playbackSpeed        (1)
+    , _logData              (nullptr)
+    , _logPos               (0)
+    , _logFileSize          (0)
+    , _emittedMessageCount  (0)
 {
     if (!_logReplayConfig) {
         qWarning() << "Internal error";
     }
 
     _errorTitle = tr("Log Replay Error");
+
+    _resetParser();
     
     _readTickTimer.moveToThread(this);
     
@@ -117,9 +125,14 @@ bool LogReplayLink::_connect(void)
 
 void LogReplayLink::_disconnect(void)
 {
-    if (_connected) {
+    if (isRunning()) {
+        // Still loading if we aren't connected yet
+        _logIndex.cancelBuild();
         quit();
         wait();
+    }
+
+    if (_connected) {
         _connected = false;
 
         if (_mavlinkChannel != 0) {
@@ -132,21 +145,19 @@ void LogReplayLink::_disconnect(void)
 
 void LogReplayLink::run(void)
 {
-    // Load the log file
+    // Open the log file, playback starts once the index is ready
     if (!_loadLogFile()) {
         return;
     }
-    
-    _connected = true;
-    emit connected();
-    
-    // Start playback
-    _play();
 
     // Run normal event loop until exit
     exec();
     
     _readTickTimer.stop();
+
+    // Exit may have come in while the index was still being built
+    _logIndex.cancelBuild();
+    _logIndexBuild.waitForFinished();
 }
 
 void LogReplayLink::_replayError(const QString& errorMsg)
@@ -161,159 +172,170 @@ void LogReplayLink::_writeBytes(const QByteArray bytes)
     Q_UNUSED(bytes);
 }
 
-/// Parses a BigEndian quint64 timestamp
-/// @return A Unix timestamp in microseconds UTC for found message or 0 if parsing failed
-quint64 LogReplayLink::_parseTimestamp(const QByteArray& bytes)
+/// @return Pointer to count bytes of the log starting at pos, nullptr if the log doesn't contain that range. When
+/// the log is not memory mapped the pointer is only valid until the next call.
+const char* LogReplayLink::_logBytes(qint64 pos, int count)
 {
-    quint64 timestamp = qFromBigEndian(*((quint64*)(bytes.constData())));
-    quint64 currentTimestamp = ((quint64)QDateTime::currentMSecsSinceEpoch()) * 1000;
-    
-    // Now if the parsed timestamp is in the future, it must be an old file where the timestamp was stored as
-    // little endian, so switch it.
-    if (timestamp > currentTimestamp) {
-        timestamp = qbswap(timestamp);
+    if (pos < 0 || count < 0 || pos + count > _logFileSize) {
+        return nullptr;
     }
-    
-    return timestamp;
+    if (_logData) {
+        return reinterpret_cast<const char*>(_logData) + pos;
+    }
+
+    // Mapping failed, fall back to reading through the file
+    if (!_logFile.seek(pos)) {
+        return nullptr;
+    }
+    _logReadBuffer = _logFile.read(count);
+    return _logReadBuffer.count() == count ? _logReadBuffer.constData() : nullptr;
+}
+
+/// Reads the BigEndian quint64 timestamp at the current position and moves past it
+/// @return A Unix timestamp in microseconds UTC or 0 if there is no timestamp at the current position
+quint64 LogReplayLink::_readTimestamp(void)
+{
+    const char* bytes = _logBytes(_logPos, cbTimestamp);
+    if (!bytes) {
+        return 0;
+    }
+    _logPos += cbTimestamp;
+    return LogReplayIndex::parseTimestamp(bytes);
 }
 
 /// Reads the next mavlink message from the log
-///     @param bytes[output] Bytes for mavlink message
-/// @return Unix timestamp in microseconds UTC for NEXT mavlink message or 0 if no message found
+///     @param bytes[output] Bytes for mavlink message, empty if no message found. When the log is memory mapped
+///                          the bytes reference the mapping directly instead of being copied.
+/// @return Unix timestamp in microseconds UTC for NEXT mavlink message or 0 if no message follows
 quint64 LogReplayLink::_readNextMavlinkMessage(QByteArray& bytes)
 {
-    char                nextByte;
+    mavlink_message_t   message;
     mavlink_status_t    status;
+    qint64              messageStartPos = _logPos;
 
     bytes.clear();
 
-    while (_logFile.getChar(&nextByte)) { // Loop over every byte
-        mavlink_message_t message;
-        bool messageFound = mavlink_parse_char(_mavlinkChannel, nextByte, &message, &status);
-
-        if (status.parse_state == MAVLINK_PARSE_STATE_GOT_STX) {
-            // This is the possible beginning of a mavlink message, clear any partial bytes
-            bytes.clear();
+    while (_logPos < _logFileSize) {
+        // Parse in blocks so the unmapped fallback doesn't go back to the file for every byte
+        int         blockCount  = static_cast<int>(qMin(static_cast<qint64>(_parseBlockSize), _logFileSize - _logPos));
+        const char* block       = _logBytes(_logPos, blockCount);
+        if (!block) {
+            break;
         }
-        bytes.append(nextByte);
 
-        if (messageFound) {
-            // Return the timestamp for the next message
-            QByteArray rawTime = _logFile.read(cbTimestamp);
-            return _parseTimestamp(rawTime);
+        for (int i=0; i<blockCount; i++) {
+            // Parse on our own state rather than the channel status, which the main thread parses on as well
+            bool messageFound = mavlink_frame_char_buffer(&_rxMessage, &_rxStatus, static_cast<uint8_t>(block[i]), &message, &status) == MAVLINK_FRAMING_OK;
+
+            if (_rxStatus.parse_state == MAVLINK_PARSE_STATE_GOT_STX) {
+                // This is the possible beginning of a mavlink message, drop any partial bytes
+                messageStartPos = _logPos + i;
+            }
+
+            if (messageFound) {
+                int messageLength = static_cast<int>(_logPos + i + 1 - messageStartPos);
+                _logPos += i + 1;
+
+                const char* messageBytes = _logBytes(messageStartPos, messageLength);
+                if (_logData) {
+                    bytes = QByteArray::fromRawData(messageBytes, messageLength);
+                } else {
+                    bytes = QByteArray(messageBytes, messageLength);
+                }
+
+                // Return the timestamp for the next message
+                return _readTimestamp();
+            }
         }
+
+        _logPos += blockCount;
     }
 
     return 0;
 }
 
-/// Seeks to the beginning of the next successfully parsed mavlink message in the log file.
-///     @param nextMsg[output] Parsed next message that was found
-/// @return A Unix timestamp in microseconds UTC for found message or 0 if parsing failed
-quint64 LogReplayLink::_seekToNextMavlinkMessage(mavlink_message_t* nextMsg)
+bool LogReplayLink::_loadLogFile(void)
 {
-    char                nextByte;
-    mavlink_status_t    status;
-    qint64              messageStartPos = -1;
-
-    mavlink_reset_channel_status(_mavlinkChannel);
-
-    while (_logFile.getChar(&nextByte)) {
-        bool messageFound = mavlink_parse_char(_mavlinkChannel, nextByte, nextMsg, &status);
+    QString logFilename = _logReplayConfig->logFilename();
 
-        if (status.parse_state == MAVLINK_PARSE_STATE_GOT_STX) {
-            // This is the possible beginning of a mavlink message
-            messageStartPos = _logFile.pos() - 1;
-        }
-        
-        // If we've found a message, jump back to the start of the message, grab the timestamp,
-        // and go back to the end of this file.
-        if (messageFound && messageStartPos != -1) {
-            _logFile.seek(messageStartPos - cbTimestamp);
-            QByteArray rawTime = _logFile.read(cbTimestamp);
-            return _parseTimestamp(rawTime);
-        }
+    if (_logFile.isOpen()) {
+        _replayError(tr("Attempt to load new log while log being played"));
+        return false;
     }
     
-    return 0;
-}
-
-quint64 LogReplayLink::_findLastTimestamp(void)
-{
-    char                nextByte;
-    mavlink_status_t    status;
-    quint64             lastTimestamp = 0;
-    mavlink_message_t   msg;
-
-    // We read through the entire file looking for the last good timestamp. This can be somewhat slow, but trying to work from the
-    // end of the file can be way slower due to all the seeking back and forth required. So instead we take the simple reliable approach.
-
-    _logFile.reset();
-    mavlink_reset_channel_status(_mavlinkChannel);
-
-    while (_logFile.bytesAvailable() > cbTimestamp) {
-        lastTimestamp = _parseTimestamp(_logFile.read(cbTimestamp));
-
-        bool endOfMessage = false;
-        while (!endOfMessage && _logFile.getChar(&nextByte)) {
-            endOfMessage = mavlink_parse_char(_mavlinkChannel, nextByte, &msg, &status);
-        }
+    _logFile.setFileName(logFilename);
+    if (!_logFile.open(QFile::ReadOnly)) {
+        _replayError(tr("Unable to open log file: '%1', error: %2").arg(logFilename).arg(_logFile.errorString()));
+        return false;
     }
+    _logFileSize = QFileInfo(logFilename).size();
+
+    // A first time index build of a large log takes a while. It runs on a pool thread so the link thread keeps
+    // servicing its event loop, which lets a disconnect cancel the build instead of waiting it out. Later opens of
+    // the same log pick up the sidecar index instead.
+    auto watcher = new QFutureWatcher<bool>(this);
+    QObject::connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        _logIndexReady(watcher->result());
+    });
+    _logIndexBuild = QtConcurrent::run([this, logFilename]() {
+        return _logIndex.loadOrBuild(logFilename, _logIndexError);
+    });
+    watcher->setFuture(_logIndexBuild);
 
-    return lastTimestamp;
+    return true;
 }
 
-bool LogReplayLink::_loadLogFile(void)
+/// Finishes loading the log once the index is available and starts playback
+void LogReplayLink::_logIndexReady(bool indexValid)
 {
-    QString errorMsg;
     QString logFilename = _logReplayConfig->logFilename();
-    QFileInfo logFileInfo;
+    QString errorMsg;
     int logDurationSecondsTotal;
-    quint64 startTimeUSecs;
-    quint64 endTimeUSecs;
 
-    if (_logFile.isOpen()) {
-        errorMsg = tr("Attempt to load new log while log being played");
-        goto Error;
-    }
-    
-    _logFile.setFileName(logFilename);
-    if (!_logFile.open(QFile::ReadOnly)) {
-        errorMsg = tr("Unable to open log file: '%1', error: %2").arg(logFilename).arg(_logFile.errorString());
+    if (!indexValid) {
+        errorMsg = _logIndexError;
         goto Error;
     }
-    logFileInfo.setFile(logFilename);
-    _logFileSize = logFileInfo.size();
-    
-    startTimeUSecs = _parseTimestamp(_logFile.read(cbTimestamp));
-    endTimeUSecs = _findLastTimestamp();
 
-    if (endTimeUSecs <= startTimeUSecs) {
-        errorMsg = tr("The log file '%1' is corrupt or empty.").arg(logFilename);
-        goto Error;
+    // The mapping stays in place until the link is destroyed since messages handed out through bytesReceived
+    // point directly into it. If the log can't be mapped (e.g. a huge log on a 32 bit system) we fall back to
+    // reading through the file.
+    _logData = _logFile.map(0, _logFileSize);
+    if (!_logData) {
+        qWarning() << "Unable to memory map log file, falling back to file reads" << _logFile.errorString();
     }
 
     // Remember the start and end time so we can move around this _logFile with the slider.
-    _logEndTimeUSecs = endTimeUSecs;
-    _logStartTimeUSecs = startTimeUSecs;
-    _logDurationUSecs = endTimeUSecs - startTimeUSecs;
-    _logCurrentTimeUSecs = startTimeUSecs;
+    _logEndTimeUSecs = _logIndex.endTimeUSecs();
+    _logStartTimeUSecs = _logIndex.startTimeUSecs();
+    _logDurationUSecs = _logEndTimeUSecs - _logStartTimeUSecs;
 
-    // Reset our log file so when we go to read it for the first time, we start at the beginning.
-    _logFile.reset();
+    // Position at the first message so when we go to read it for the first time, we start at the beginning.
+    if (!_seekToRecord(_logIndex.offsetForTimestamp(_logStartTimeUSecs))) {
+        errorMsg = tr("The log file '%1' is corrupt or empty.").arg(logFilename);
+        goto Error;
+    }
 
     logDurationSecondsTotal = (_logDurationUSecs) / 1000000;
     
     emit logFileStats(logDurationSecondsTotal);
-    
-    return true;
+
+    _connected = true;
+    emit connected();
+
+    // Start playback
+    _play();
+
+    return;
     
 Error:
     if (_logFile.isOpen()) {
         _logFile.close();
     }
+    _logData = nullptr;
     _replayError(errorMsg);
-    return false;
+    quit();
 }
 
 /// This function will read the next available log entry. It will then start
@@ -322,6 +344,11 @@ Error:
 /// induce a static drift into the log file replay.
 void LogReplayLink::_readNextLogEntry(void)
 {
+    if (_bulkReplay()) {
+        _readNextBulkEntries();
+        return;
+    }
+
     QByteArray bytes;
 
     // Now parse MAVLink messages, grabbing their timestamps as we go. We stop once we
@@ -334,10 +361,14 @@ void LogReplayLink::_readNextLogEntry(void)
     while (timeToNextExecutionMSecs < 3) {
         // Read the next mavlink message from the log
         qint64 nextTimeUSecs = _readNextMavlinkMessage(bytes);
-        emit bytesReceived(this, bytes);
+        if (bytes.isEmpty()) {
+            _finishPlayback();
+            return;
+        }
+        _emitMessage(bytes);
         emit playbackPercentCompleteChanged(((float)(_logCurrentTimeUSecs - _logStartTimeUSecs) / (float)_logDurationUSecs) * 100);
 
-        if (_logFile.atEnd()) {
+        if (nextTimeUSecs == 0) {
             _finishPlayback();
             return;
         }
@@ -360,6 +391,50 @@ void LogReplayLink::_readNextLogEntry(void)
     _readTickTimer.start(timeToNextExecutionMSecs);
 }
 
+/// Pushes messages through as fast as the rest of the application can consume them. Work is done in time slices
+/// so pause and seek requests are still serviced, and the number of messages queued up between us and the main
+/// thread is bounded so a long log doesn't end up fully buffered in memory.
+void LogReplayLink::_readNextBulkEntries(void)
+{
+    QByteArray      bytes;
+    QElapsedTimer   sliceTimer;
+
+    sliceTimer.start();
+
+    // Messages not yet decoded by the decode worker plus those decoded but not yet taken by the main thread
+    MAVLinkDecodeStats stats = qgcApp()->toolbox()->mavlinkProtocol()->decodeStats(this);
+    qint64 inFlight = static_cast<qint64>(_emittedMessageCount - qMin(_emittedMessageCount, stats.decodedCount)) + stats.queueDepth;
+
+    while (inFlight < _bulkMaxInFlight && sliceTimer.elapsed() < _bulkSliceMSecs) {
+        qint64 nextTimeUSecs = _readNextMavlinkMessage(bytes);
+        if (bytes.isEmpty()) {
+            _signalPlayheadMoved();
+            _finishPlayback();
+            return;
+        }
+        _emitMessage(bytes);
+        inFlight++;
+
+        if (nextTimeUSecs == 0) {
+            _signalPlayheadMoved();
+            _finishPlayback();
+            return;
+        }
+        _logCurrentTimeUSecs = nextTimeUSecs;
+    }
+
+    _signalPlayheadMoved();
+
+    // Give the consumers a moment to catch up if we filled the window, otherwise keep going
+    _readTickTimer.start(inFlight < _bulkMaxInFlight ? 0 : 1);
+}
+
+void LogReplayLink::_emitMessage(const QByteArray& bytes)
+{
+    _emittedMessageCount++;
+    emit bytesReceived(this, bytes);
+}
+
 void LogReplayLink::_play(void)
 {
     qgcApp()->toolbox()->linkManager()->setConnectionsSuspended(tr("Connect not allowed during Flight Data replay."));
@@ -368,7 +443,7 @@ void LogReplayLink::_play(void)
 #endif
     
     // Make sure we aren't at the end of the file, if we are, reset to the beginning and play from there.
-    if (_logFile.atEnd()) {
+    if (_logPos >= _logFileSize) {
         _resetPlaybackToBeginning();
     }
     
@@ -394,7 +469,7 @@ void LogReplayLink::_pause(void)
 void LogReplayLink::_resetPlaybackToBeginning(void)
 {
     if (_logFile.isOpen()) {
-        _logFile.reset();
+        _seekToRecord(0);
     }
     
     // And since we haven't starting playback, clear the time of initial playback and the current timestamp.
@@ -403,16 +478,81 @@ void LogReplayLink::_resetPlaybackToBeginning(void)
     _logCurrentTimeUSecs = _logStartTimeUSecs;
 }
 
-void LogReplayLink::movePlayhead(qreal percentComplete)
+/// Pauses playback prior to moving the playhead from the ui thread
+/// @return false: playback could not be paused
+bool LogReplayLink::_pauseForSeek(void)
 {
     if (isPlaying()) {
         _pauseOnThread();
         QSignalSpy waitForPause(this, SIGNAL(playbackPaused()));
         waitForPause.wait();
         if (_readTickTimer.isActive()) {
-            return;
+            return false;
         }
     }
+    return true;
+}
+
+/// Positions the log at the mavlink message of the record at the specified offset
+/// @return false: seek failed
+bool LogReplayLink::_seekToRecord(qint64 recordOffset)
+{
+    _logPos = recordOffset;
+    quint64 timestampUSecs = _readTimestamp();
+    if (timestampUSecs == 0) {
+        _replayError(tr("Unable to seek to new position"));
+        return false;
+    }
+
+    _resetParser();
+    _logCurrentTimeUSecs = timestampUSecs;
+
+    return true;
+}
+
+/// Positions the log at the first mavlink message at or after the specified time
+/// @return false: seek failed
+bool LogReplayLink::_seekToTimestamp(quint64 timestampUSecs)
+{
+    // The index gets us within one index interval of the target, step forward through the remaining records
+    if (!_seekToRecord(_logIndex.offsetForTimestamp(timestampUSecs))) {
+        return false;
+    }
+
+    QByteArray bytes;
+    while (_logCurrentTimeUSecs < timestampUSecs) {
+        qint64 messagePos = _logPos;
+        quint64 nextTimeUSecs = _readNextMavlinkMessage(bytes);
+        if (nextTimeUSecs == 0) {
+            // Stay on the last message in the log
+            _logPos = messagePos;
+            _resetParser();
+            break;
+        }
+        _logCurrentTimeUSecs = nextTimeUSecs;
+    }
+
+    return true;
+}
+
+/// Drops any partially parsed message so parsing restarts cleanly at the current log position
+void LogReplayLink::_resetParser(void)
+{
+    memset(&_rxMessage, 0, sizeof(_rxMessage));
+    memset(&_rxStatus, 0, sizeof(_rxStatus));
+}
+
+void LogReplayLink::_signalPlayheadMoved(void)
+{
+    _signalCurrentLogTimeSecs();
+    emit playbackPercentCompleteChanged(((qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs) / (qreal)_logDurationUSecs) * 100);
+}
+
+void LogReplayLink::movePlayhead(qreal percentComplete)
+{
+    if (!_pauseForSeek()) {
+        return;
+    }
 
     if (percentComplete < 0) {
         percentComplete = 0;
@@ -420,48 +560,31 @@ void LogReplayLink::movePlayhead(qreal percentComplete)
     if (percentComplete > 100) {
         percentComplete = 100;
     }
-    
-    qreal percentCompleteMult = percentComplete / 100.0;
-    
-    // But if we have a timestamped MAVLink log, then actually aim to hit that percentage in terms of
-    // time through the file.
-    qint64 newFilePos = (qint64)(percentCompleteMult * (qreal)_logFile.size());
 
-    // Now seek to the appropriate position, failing gracefully if we can't.
-    if (!_logFile.seek(newFilePos)) {
-        _replayError(tr("Unable to seek to new position"));
-        return;
+    quint64 targetTimeUSecs = _logStartTimeUSecs + (quint64)((percentComplete / 100.0) * _logDurationUSecs);
+    if (_seekToTimestamp(targetTimeUSecs)) {
+        _signalPlayheadMoved();
     }
+}
 
-    // But we do align to the next MAVLink message for consistency.
-    mavlink_message_t dummy;
-    _logCurrentTimeUSecs = _seekToNextMavlinkMessage(&dummy);
-
-    // Now calculate the current file location based on time.
-    qreal newRelativeTimeUSecs = (qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs);
-
-    // Calculate the effective baud rate of the file in bytes/s.
-    qreal baudRate = _logFile.size() / (qreal)_logDurationUSecs / 1e6;
-
-    // And the desired time is:
-    qreal desiredTimeUSecs = percentCompleteMult * _logDurationUSecs;
+bool LogReplayLink::moveToNextEvent(int eventTypeMask)
+{
+    if (!_pauseForSeek()) {
+        return false;
+    }
 
-    // And now jump the necessary number of bytes in the proper direction
-    qint64 offset = (newRelativeTimeUSecs - desiredTimeUSecs) * baudRate;
-    if (!_logFile.seek(_logFile.pos() + offset)) {
-        _replayError(tr("Unable to seek to new position"));
-        return;
+    const LogReplayIndex::Event_t* event = _logIndex.nextEvent(_logCurrentTimeUSecs, eventTypeMask);
+    if (!event) {
+        return false;
     }
 
-    // And scan until we reach the start of a MAVLink message. We make sure to record this timestamp for
-    // smooth jumping around the file.
-    _logCurrentTimeUSecs = _seekToNextMavlinkMessage(&dummy);
-    _signalCurrentLogTimeSecs();
+    // Events know their exact record so there is no need to scan forward
+    if (!_seekToRecord(event->offset)) {
+        return false;
+    }
+    _signalPlayheadMoved();
 
-    // Now update the UI with our actual final position.
-    newRelativeTimeUSecs = (qreal)(_logCurrentTimeUSecs - _logStartTimeUSecs);
-    percentComplete = (newRelativeTimeUSecs / _logDurationUSecs) * 100;
-    emit playbackPercentCompleteChanged(percentComplete);
+    return true;
 }
 
 void LogReplayLink::_setPlaybackSpeed(qreal playbackSpeed)
@@ -544,6 +667,14 @@ void LogReplayLinkController::setPercentComplete(qreal percentComplete)
     _link->movePlayhead(percentComplete);
 }
 
+bool LogReplayLinkController::jumpToNextEvent(int eventTypes)
+{
+    if (!_link) {
+        return false;
+    }
+    return _link->moveToNextEvent(eventTypes);
+}
+
 void LogReplayLinkController::_logFileStats(int logDurationSecs)
 {
     _totalTime = _secondsToHMS(logDurationSecs);
@@ -11,9 +11,11 @@
 
 #include "LinkManager.h"
 #include "MAVLinkProtocol.h"
+#include "LogReplayIndex.h"
 
 #include <QTimer>
 #include <QFile>
+#include <QFuture>
 
 class LogReplayLinkConfiguration : public LinkConfiguration
 {
@@ -53,6 +55,7 @@ class LogReplayLink : public LinkInterface
     Q_OBJECT
 
     friend class LinkManager;
+    friend class LogReplayIndexTest;
 
 public:
     /// @return true: log is currently playing, false: log playback is paused
@@ -62,6 +65,10 @@ public:
     void pause          (void) { emit _pauseOnThread(); }
     void movePlayhead   (qreal percentComplete);
 
+    /// Moves the playhead to the next event of one of the specified LogReplayIndex::EventType_t types
+    /// @return false: no more matching events in the log
+    bool moveToNextEvent(int eventTypeMask);
+
     // Virtuals from LinkInterface
     virtual QString getName             (void) const { return _config->name(); }
     virtual void    requestReset        (void){ }
@@ -76,7 +83,7 @@ public:
     bool disconnect (void);
 
 public slots:
-    /// Sets the acceleration factor: -100: 0.01X, 0: 1.0X, 100: 100.0X
+    /// Sets the playback speed multiplier. 0 replays the log as fast as it can be processed.
     void setPlaybackSpeed(qreal playbackSpeed) { emit _setPlaybackSpeedOnThread(playbackSpeed); }
 
 private slots:
@@ -107,11 +114,19 @@ private:
     ~LogReplayLink();
 
     void    _replayError                (const QString& errorMsg);
-    quint64 _parseTimestamp             (const QByteArray& bytes);
-    quint64 _seekToNextMavlinkMessage   (mavlink_message_t* nextMsg);
-    quint64 _findLastTimestamp          (void);
+    const char* _logBytes               (qint64 pos, int count);
+    quint64 _readTimestamp              (void);
     quint64 _readNextMavlinkMessage     (QByteArray& bytes);
+    void    _readNextBulkEntries        (void);
+    void    _emitMessage                (const QByteArray& bytes);
+    bool    _bulkReplay                 (void) const { return _playbackSpeed <= 0; }
+    bool    _pauseForSeek               (void);
+    bool    _seekToRecord               (qint64 recordOffset);
+    bool    _seekToTimestamp            (quint64 timestampUSecs);
+    void    _resetParser                (void);
+    void    _signalPlayheadMoved        (void);
     bool    _loadLogFile                (void);
+    void    _logIndexReady              (bool indexValid);
     void    _finishPlayback             (void);
     void    _resetPlaybackToBeginning   (void);
     void    _signalCurrentLogTimeSecs   (void);
@@ -142,9 +157,21 @@ private:
 
     MAVLinkProtocol*    _mavlink;
     QFile               _logFile;
-    quint64             _logFileSize;
-
-    static const int cbTimestamp = sizeof(quint64);
+    uchar*              _logData;               ///< Memory mapped log, nullptr if mapping failed
+    QByteArray          _logReadBuffer;         ///< Used for reads when the log is not memory mapped
+    qint64              _logPos;                ///< Log position of the next mavlink message
+    qint64              _logFileSize;
+    LogReplayIndex      _logIndex;
+    QFuture<bool>       _logIndexBuild;
+    QString             _logIndexError;         ///< Set by the index build when it fails
+    quint64             _emittedMessageCount;
+    mavlink_message_t   _rxMessage;             ///< Parser state, private to the link thread
+    mavlink_status_t    _rxStatus;
+
+    static const int        cbTimestamp         = sizeof(quint64);
+    static const int        _parseBlockSize     = 512;
+    static const qint64     _bulkMaxInFlight    = 4096;     ///< Maximum messages emitted but not yet handled by the main thread in bulk mode
+    static const int        _bulkSliceMSecs     = 20;       ///< Longest time bulk mode holds the link thread before servicing events
 };
 
 class LogReplayLinkController : public QObject
@@ -161,6 +188,18 @@ public:
 
     LogReplayLinkController(void);
 
+    enum EventType {
+        EventArmDisarm  = LogReplayIndex::EventArmed | LogReplayIndex::EventDisarmed,
+        EventModeChange = LogReplayIndex::EventModeChange,
+        EventStatusText = LogReplayIndex::EventStatusText,
+        EventAny        = LogReplayIndex::EventAll,
+    };
+    Q_ENUM(EventType)
+
+    /// Moves the playhead to the next event of the specified EventType(s)
+    /// @return false: no more matching events
+    Q_INVOKABLE bool jumpToNextEvent(int eventTypes);
+
     LogReplayLink*  link            (void) { return _link; }
     bool            isPlaying       (void) { return _isPlaying; }
     qreal           percentComplete (void) { return _percentComplete; }
@@ -0,0 +1,196 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkDecodeWorker.h"
+#include "LinkInterface.h"
+#include "QGCLoggingCategory.h"
+
+#include <QThread>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+QGC_LOGGING_CATEGORY(MAVLinkDecodeWorkerLog, "MAVLinkDecodeWorkerLog")
+
+MAVLinkDecodeWorker::MAVLinkDecodeWorker(LinkInterface* link, int maxQueueDepth, DropPolicy_t dropPolicy)
+    : QObject               (nullptr)
+    , _link                 (link)
+    , _maxQueueDepth        (maxQueueDepth)
+    , _dropPolicy           (dropPolicy)
+    , _thread               (nullptr)
+    , _decodedFirstMessage  (false)
+    , _nonMavlinkCount      (0)
+    , _readySignalled       (false)
+{
+    memset(&_rxMessage, 0, sizeof(_rxMessage));
+    memset(&_rxStatus,  0, sizeof(_rxStatus));
+    memset(&_message,   0, sizeof(_message));
+    memset(&_status,    0, sizeof(_status));
+}
+
+MAVLinkDecodeWorker::~MAVLinkDecodeWorker()
+{
+    stop();
+}
+
+qint64 MAVLinkDecodeWorker::monotonicUsecs(void)
+{
+    static QElapsedTimer timer;
+    static bool started = (timer.start(), true);
+    Q_UNUSED(started);
+    return timer.nsecsElapsed() / 1000;
+}
+
+void MAVLinkDecodeWorker::start(void)
+{
+    if (_thread) {
+        return;
+    }
+
+    // Make sure the shared time base is initialized before the worker thread can touch it
+    monotonicUsecs();
+
+    _thread = new QThread();
+    _thread->setObjectName(QStringLiteral("MAVLinkDecodeWorker %1").arg(_link->getName()));
+    moveToThread(_thread);
+    // bytesReceived is emitted from the link thread, this makes the connection queued onto our worker thread
+    connect(_link, &LinkInterface::bytesReceived, this, &MAVLinkDecodeWorker::_receiveBytes);
+    _thread->start();
+
+    qCDebug(MAVLinkDecodeWorkerLog) << "Decode worker started" << _link->getName();
+}
+
+void MAVLinkDecodeWorker::stop(void)
+{
+    if (!_thread) {
+        return;
+    }
+
+    disconnect(_link, &LinkInterface::bytesReceived, this, &MAVLinkDecodeWorker::_receiveBytes);
+    _thread->quit();
+    _thread->wait();
+    delete _thread;
+    _thread = nullptr;
+
+    QMutexLocker locker(&_queueMutex);
+    _queue.clear();
+    _stats.queueDepth = 0;
+}
+
+void MAVLinkDecodeWorker::_receiveBytes(LinkInterface* link, QByteArray bytes)
+{
+    if (link != _link) {
+        return;
+    }
+
+    for (int position = 0; position < bytes.size(); position++) {
+        if (_parseChar(static_cast<uint8_t>(bytes[position]))) {
+            MAVLinkDecodedMessage decoded;
+            decoded.message         = _message;
+            decoded.timestampUsecs  = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000);
+            decoded.decodedUsecs    = monotonicUsecs();
+            _pendingBatch.append(decoded);
+
+            _decodedFirstMessage = true;
+            memset(&_status,  0, sizeof(_status));
+            memset(&_message, 0, sizeof(_message));
+        } else if (!_decodedFirstMessage) {
+            if (++_nonMavlinkCount > _nonMavlinkByteThreshold) {
+                _nonMavlinkCount = 0;
+                emit nonMavlinkData(_link);
+            }
+        }
+    }
+
+    // Everything decoded from this chunk of bytes is handed over as a single batch
+    if (_pendingBatch.count()) {
+        _queueMessages();
+    }
+}
+
+/// Same as mavlink_parse_char, but on the worker's own parser state instead of the channel's
+bool MAVLinkDecodeWorker::_parseChar(uint8_t c)
+{
+    uint8_t result = mavlink_frame_char_buffer(&_rxMessage, &_rxStatus, c, &_message, &_status);
+    if (result == MAVLINK_FRAMING_BAD_CRC || result == MAVLINK_FRAMING_BAD_SIGNATURE) {
+        // Treat as a parse failure and resync, a bad frame's STX may be the start of the next one
+        _rxStatus.parse_error++;
+        _rxStatus.msg_received  = MAVLINK_FRAMING_INCOMPLETE;
+        _rxStatus.parse_state   = MAVLINK_PARSE_STATE_IDLE;
+        if (c == MAVLINK_STX) {
+            _rxStatus.parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+            _rxMessage.len = 0;
+            mavlink_start_checksum(&_rxMessage);
+        }
+        return false;
+    }
+    return result == MAVLINK_FRAMING_OK;
+}
+
+void MAVLinkDecodeWorker::_queueMessages(void)
+{
+    bool signalReady = false;
+    {
+        QMutexLocker locker(&_queueMutex);
+
+        _stats.decodedCount += static_cast<quint64>(_pendingBatch.count());
+
+        if (_dropPolicy == DropNewest && _maxQueueDepth > 0) {
+            int room = qMax(0, _maxQueueDepth - _queue.count());
+            if (_pendingBatch.count() > room) {
+                _stats.droppedCount += static_cast<quint64>(_pendingBatch.count() - room);
+                _pendingBatch.resize(room);
+            }
+        }
+        _queue.append(_pendingBatch);
+        if (_dropPolicy == DropOldest && _maxQueueDepth > 0 && _queue.count() > _maxQueueDepth) {
+            int excess = _queue.count() - _maxQueueDepth;
+            _queue.erase(_queue.begin(), _queue.begin() + excess);
+            _stats.droppedCount += static_cast<quint64>(excess);
+        }
+
+        _stats.queueDepth       = _queue.count();
+        _stats.maxQueueDepth    = qMax(_stats.maxQueueDepth, _stats.queueDepth);
+
+        if (!_readySignalled && _queue.count()) {
+            _readySignalled = true;
+            signalReady = true;
+        }
+    }
+    _pendingBatch.clear();
+
+    if (signalReady) {
+        emit messagesReady(_link);
+    }
+}
+
+void MAVLinkDecodeWorker::takeMessages(MAVLinkDecodedMessageList& messages)
+{
+    QMutexLocker locker(&_queueMutex);
+
+    messages.clear();
+    messages.swap(_queue);
+    _readySignalled     = false;
+    _stats.queueDepth   = 0;
+}
+
+void MAVLinkDecodeWorker::recordLatency(qint64 latencyUsecs)
+{
+    QMutexLocker locker(&_queueMutex);
+
+    _stats.lastLatencyUsecs = latencyUsecs;
+    _stats.maxLatencyUsecs  = qMax(_stats.maxLatencyUsecs, latencyUsecs);
+    // Exponential moving average with a 1/16 weight for the newest sample
+    _stats.avgLatencyUsecs  = _stats.avgLatencyUsecs + ((latencyUsecs - _stats.avgLatencyUsecs) / 16);
+}
+
+MAVLinkDecodeStats MAVLinkDecodeWorker::stats(void) const
+{
+    QMutexLocker locker(&_queueMutex);
+    return _stats;
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <QByteArray>
+#include <QLoggingCategory>
+
+#include "QGCMAVLink.h"
+
+class LinkInterface;
+class QThread;
+
+Q_DECLARE_LOGGING_CATEGORY(MAVLinkDecodeWorkerLog)
+
+/// A single message framed and CRC checked by MAVLinkDecodeWorker
+struct MAVLinkDecodedMessage {
+    mavlink_message_t   message;
+    quint64             timestampUsecs;     ///< UTC receive time in microseconds, used for telemetry logging
+    qint64              decodedUsecs;       ///< Monotonic decode time, see MAVLinkDecodeWorker::monotonicUsecs
+};
+
+typedef QVector<MAVLinkDecodedMessage> MAVLinkDecodedMessageList;
+
+/// Per link decode pipeline statistics
+struct MAVLinkDecodeStats {
+    int         queueDepth          = 0;    ///< Messages currently waiting for the main thread
+    int         maxQueueDepth       = 0;    ///< High water mark of queueDepth
+    quint64     decodedCount        = 0;    ///< Total messages decoded on the link
+    quint64     droppedCount        = 0;    ///< Messages discarded due to queue overflow
+    qint64      lastLatencyUsecs    = 0;    ///< Decode to delivery latency of the most recent message
+    qint64      avgLatencyUsecs     = 0;    ///< Running average decode to delivery latency
+    qint64      maxLatencyUsecs     = 0;    ///< Worst decode to delivery latency seen
+};
+
+/// Frames, CRC checks and timestamps the incoming byte stream of a single link on its own worker thread.
+/// Decoded messages are queued and handed to the main thread in batches through takeMessages.
+///
+/// The worker keeps its own parser state rather than using the global status of the link's mavlink channel.
+/// The channel status also holds the outbound version flags, which are owned by the main thread.
+class MAVLinkDecodeWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// Policy applied when the queue of decoded messages reaches its maximum depth
+    typedef enum {
+        DropNone,       ///< Queue is unbounded
+        DropOldest,     ///< Discard the oldest queued messages to make room
+        DropNewest,     ///< Discard newly decoded messages until the queue drains
+    } DropPolicy_t;
+
+    /// @param link             Link to decode. Bytes are received through LinkInterface::bytesReceived.
+    /// @param maxQueueDepth    Maximum number of undelivered messages, ignored for DropNone
+    /// @param dropPolicy       Policy to apply on queue overflow
+    MAVLinkDecodeWorker(LinkInterface* link, int maxQueueDepth, DropPolicy_t dropPolicy);
+    ~MAVLinkDecodeWorker();
+
+    /// Starts the worker thread and begins decoding bytes from the link
+    void start(void);
+
+    /// Stops the worker thread. Any undelivered messages are discarded.
+    void stop(void);
+
+    /// Moves all queued messages into the specified list. Called from the main thread.
+    void takeMessages(MAVLinkDecodedMessageList& messages);
+
+    /// Records the decode to delivery latency for a delivered message. Called from the main thread.
+    void recordLatency(qint64 latencyUsecs);
+
+    MAVLinkDecodeStats stats(void) const;
+
+    /// @return Monotonic time in microseconds which is comparable across threads
+    static qint64 monotonicUsecs(void);
+
+signals:
+    /// Signalled when the queue transitions from empty to non-empty
+    void messagesReady(LinkInterface* link);
+
+    /// Signalled when a large amount of data has arrived without a single valid mavlink message
+    void nonMavlinkData(LinkInterface* link);
+
+private slots:
+    void _receiveBytes(LinkInterface* link, QByteArray bytes);
+
+private:
+    void _queueMessages (void);
+    bool _parseChar     (uint8_t c);
+
+    LinkInterface*              _link;
+    int                         _maxQueueDepth;
+    DropPolicy_t                _dropPolicy;
+    QThread*                    _thread;
+
+    // Only accessed from the worker thread
+    mavlink_message_t           _rxMessage;     ///< Message being framed
+    mavlink_status_t            _rxStatus;      ///< Parser state
+    mavlink_message_t           _message;
+    mavlink_status_t            _status;
+    MAVLinkDecodedMessageList   _pendingBatch;
+    bool                        _decodedFirstMessage;
+    int                         _nonMavlinkCount;
+
+    // Shared between worker and main thread, protected by _queueMutex
+    mutable QMutex              _queueMutex;
+    MAVLinkDecodedMessageList   _queue;
+    bool                        _readySignalled;
+    MAVLinkDecodeStats          _stats;
+
+    static const int _nonMavlinkByteThreshold = 1000;
+};
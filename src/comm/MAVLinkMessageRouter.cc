@@ -0,0 +1,161 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkMessageRouter.h"
+#include "QGCLoggingCategory.h"
+
+#include <algorithm>
+
+QGC_LOGGING_CATEGORY(MAVLinkMessageRouterLog, "MAVLinkMessageRouterLog")
+
+MAVLinkMessageRouter::MAVLinkMessageRouter(QObject* parent)
+    : QObject               (parent)
+    , _nextSubscriptionId   (1)
+{
+
+}
+
+MAVLinkMessageRouter::~MAVLinkMessageRouter()
+{
+    qDeleteAll(_subscriptions);
+}
+
+int MAVLinkMessageRouter::subscribe(QObject* context, const MAVLinkMessageFilter& filter, MAVLinkMessageHandler handler)
+{
+    return subscribe(context, QList<MAVLinkMessageFilter>() << filter, handler);
+}
+
+int MAVLinkMessageRouter::subscribe(QObject* context, const QList<MAVLinkMessageFilter>& filters, MAVLinkMessageHandler handler)
+{
+    int id = _nextSubscriptionId++;
+
+    Subscription_t* subscription = new Subscription_t;
+    subscription->context   = context;
+    subscription->handler   = handler;
+
+    _subscriptions[id]  = subscription;
+    _filters[id]        = filters;
+
+    if (context) {
+        // UniqueConnection since a single context may hold multiple subscriptions
+        connect(context, &QObject::destroyed, this, &MAVLinkMessageRouter::_contextDestroyed, Qt::UniqueConnection);
+    }
+
+    _rebuildIndex();
+    qCDebug(MAVLinkMessageRouterLog) << "subscribe" << id << context << "filter count" << filters.count();
+
+    return id;
+}
+
+void MAVLinkMessageRouter::unsubscribe(int subscriptionId)
+{
+    Subscription_t* subscription = _subscriptions.take(subscriptionId);
+    if (subscription) {
+        _filters.remove(subscriptionId);
+        delete subscription;
+        _rebuildIndex();
+    }
+}
+
+void MAVLinkMessageRouter::unsubscribeAll(QObject* context)
+{
+    bool removed = false;
+
+    QMutableMapIterator<int, Subscription_t*> iter(_subscriptions);
+    while (iter.hasNext()) {
+        iter.next();
+        if (iter.value()->context == context) {
+            _filters.remove(iter.key());
+            delete iter.value();
+            iter.remove();
+            removed = true;
+        }
+    }
+
+    if (removed) {
+        _rebuildIndex();
+    }
+}
+
+void MAVLinkMessageRouter::_contextDestroyed(QObject* context)
+{
+    unsubscribeAll(context);
+}
+
+void MAVLinkMessageRouter::_rebuildIndex(void)
+{
+    _msgIdIndex.clear();
+    _anyMsgIdIndex.clear();
+
+    for (auto iter = _filters.constBegin(); iter != _filters.constEnd(); ++iter) {
+        for (const MAVLinkMessageFilter& filter: iter.value()) {
+            IndexEntry_t entry;
+            entry.id            = iter.key();
+            entry.sysid         = filter.sysid;
+            entry.compid        = filter.compid;
+            if (filter.msgid == MAVLinkMessageFilter::anyValue) {
+                _anyMsgIdIndex.append(entry);
+            } else {
+                _msgIdIndex[filter.msgid].append(entry);
+            }
+        }
+    }
+}
+
+void MAVLinkMessageRouter::_matchEntries(const QVector<IndexEntry_t>& entries, const mavlink_message_t* message, QVector<Delivery_t>& deliveries, QHash<int, int>& deliveryIndex)
+{
+    for (const IndexEntry_t& entry: entries) {
+        if ((entry.sysid != MAVLinkMessageFilter::anyValue && entry.sysid != message->sysid) ||
+                (entry.compid != MAVLinkMessageFilter::anyValue && entry.compid != message->compid)) {
+            continue;
+        }
+        auto iter = deliveryIndex.constFind(entry.id);
+        if (iter == deliveryIndex.constEnd()) {
+            deliveryIndex.insert(entry.id, deliveries.count());
+            deliveries.append({ entry.id, MAVLinkMessageBatch({ message }) });
+            continue;
+        }
+        MAVLinkMessageBatch& batch = deliveries[iter.value()].batch;
+        if (batch.last() == message) {
+            // Already matched by another filter of the same subscription
+            continue;
+        }
+        batch.append(message);
+    }
+}
+
+void MAVLinkMessageRouter::route(LinkInterface* link, const MAVLinkDecodedMessageList& messages, int count)
+{
+    // All state is local so a handler which ends up in a nested route can't disturb this one
+    QVector<Delivery_t> deliveries;
+    QHash<int, int>     deliveryIndex;
+
+    // Match phase: no handlers are called so the index can't change underneath us
+    for (int i=0; i<count; i++) {
+        const mavlink_message_t* message = &messages[i].message;
+        auto iter = _msgIdIndex.constFind(static_cast<int>(message->msgid));
+        if (iter != _msgIdIndex.constEnd()) {
+            _matchEntries(iter.value(), message, deliveries, deliveryIndex);
+        }
+        _matchEntries(_anyMsgIdIndex, message, deliveries, deliveryIndex);
+    }
+
+    // Deliver in registration order
+    std::sort(deliveries.begin(), deliveries.end(), [](const Delivery_t& a, const Delivery_t& b) { return a.id < b.id; });
+
+    // Handlers may subscribe or unsubscribe while we deliver, so re-validate each subscription before calling it
+    for (const Delivery_t& delivery: deliveries) {
+        Subscription_t* subscription = _subscriptions.value(delivery.id, nullptr);
+        if (subscription) {
+            // Copy of the handler keeps it alive should the handler unsubscribe itself
+            MAVLinkMessageHandler handler = subscription->handler;
+            handler(link, delivery.batch);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QList>
+#include <QLoggingCategory>
+
+#include <functional>
+
+#include "QGCMAVLink.h"
+#include "MAVLinkDecodeWorker.h"
+
+class LinkInterface;
+
+Q_DECLARE_LOGGING_CATEGORY(MAVLinkMessageRouterLog)
+
+/// Messages delivered to a subscriber in a single call. The pointers are only valid for the duration of the call.
+typedef QVector<const mavlink_message_t*> MAVLinkMessageBatch;
+
+/// Called once per delivery tick with all messages matching the subscription
+typedef std::function<void(LinkInterface* link, const MAVLinkMessageBatch& messages)> MAVLinkMessageHandler;
+
+/// Selects messages by (sysid, compid, msgid). Each field can be left as a wildcard.
+struct MAVLinkMessageFilter {
+    static const int anyValue = -1;
+
+    MAVLinkMessageFilter(int sysid_ = anyValue, int compid_ = anyValue, int msgid_ = anyValue)
+        : sysid(sysid_), compid(compid_), msgid(msgid_) { }
+
+    int sysid;
+    int compid;
+    int msgid;
+};
+
+/// Delivers decoded messages to subscribers registered for specific (sysid, compid, msgid) keys. Messages are
+/// delivered in batches by const reference, subscribers which have no matching messages in a batch are not called.
+class MAVLinkMessageRouter : public QObject
+{
+    Q_OBJECT
+
+public:
+    MAVLinkMessageRouter(QObject* parent = nullptr);
+    ~MAVLinkMessageRouter();
+
+    /// Registers a handler for all messages matching any of the specified filters. A message which matches
+    /// more than one filter is only delivered once. The subscription is removed automatically when context
+    /// is destroyed.
+    ///     @return Subscription id for use with unsubscribe
+    int subscribe(QObject* context, const QList<MAVLinkMessageFilter>& filters, MAVLinkMessageHandler handler);
+    int subscribe(QObject* context, const MAVLinkMessageFilter& filter, MAVLinkMessageHandler handler);
+
+    void unsubscribe(int subscriptionId);
+
+    /// Removes all subscriptions for the specified context
+    void unsubscribeAll(QObject* context);
+
+    /// Delivers the first count messages of a decoded batch to all interested subscribers. Handlers may call
+    /// route again, for example by spinning an event loop, each call only delivers its own messages.
+    void route(LinkInterface* link, const MAVLinkDecodedMessageList& messages, int count);
+
+private slots:
+    void _contextDestroyed(QObject* context);
+
+private:
+    typedef struct {
+        QObject*                context;
+        MAVLinkMessageHandler   handler;
+    } Subscription_t;
+
+    typedef struct {
+        int             id;
+        int             sysid;
+        int             compid;
+    } IndexEntry_t;
+
+    /// Messages matched for a single subscription during a route call
+    typedef struct {
+        int                     id;
+        MAVLinkMessageBatch     batch;
+    } Delivery_t;
+
+    void _rebuildIndex  (void);
+    void _matchEntries  (const QVector<IndexEntry_t>& entries, const mavlink_message_t* message, QVector<Delivery_t>& deliveries, QHash<int, int>& deliveryIndex);
+
+    int                                 _nextSubscriptionId;
+    QMap<int, Subscription_t*>          _subscriptions;     ///< Ordered by subscription id so delivery follows registration order
+    QMap<int, QList<MAVLinkMessageFilter>> _filters;
+    QHash<int, QVector<IndexEntry_t>>   _msgIdIndex;        ///< Filters with a specific msgid
+    QVector<IndexEntry_t>               _anyMsgIdIndex;     ///< Filters with a wildcard msgid
+};
@@ -45,6 +45,9 @@ QGC_LOGGING_CATEGORY(MAVLinkProtocolLog, "MAVLinkProtocolLog")
 
 const char* MAVLinkProtocol::_tempLogFileTemplate = "FlightDataXXXXXX"; ///< Template for temporary log file
 const char* MAVLinkProtocol::_logFileExtension = "mavlink";             ///< Extension for log files
+const char* MAVLinkProtocol::_decodeQueueMaxKey =   "DECODE_QUEUE_MAX";
+const char* MAVLinkProtocol::_decodeDropPolicyKey = "DECODE_DROP_POLICY";
+const char* MAVLinkProtocol::_logFsyncIntervalKey = "TLOG_FSYNC_INTERVAL_MSECS";
 
 /**
  * The default constructor will create a new MAVLink object sending heartbeats at
@@ -53,8 +56,6 @@ const char* MAVLinkProtocol::_logFileExtension = "mavlink";             ///< Ext
 MAVLinkProtocol::MAVLinkProtocol(QGCApplication* app, QGCToolbox* toolbox)
     : QGCTool(app, toolbox)
     , m_enable_version_check(true)
-    , _message({})
-    , _status({})
     , versionMismatchIgnore(false)
     , systemId(255)
     , _current_version(100)
@@ -65,17 +66,24 @@ MAVLinkProtocol::MAVLinkProtocol(QGCApplication* app, QGCToolbox* toolbox)
     , _tempLogFile(QString("%2.%3").arg(_tempLogFileTemplate).arg(_logFileExtension))
     , _linkMgr(nullptr)
     , _multiVehicleManager(nullptr)
+    , _decodeQueueMax(0)
+    , _decodeDropPolicy(MAVLinkDecodeWorker::DropNone)
+    , _checkedUserNonMavlink(false)
+    , _warnedUserNonMavlink(false)
 {
     memset(totalReceiveCounter, 0, sizeof(totalReceiveCounter));
     memset(totalLossCounter,    0, sizeof(totalLossCounter));
     memset(runningLossPercent,  0, sizeof(runningLossPercent));
     memset(firstMessage,        1, sizeof(firstMessage));
-    memset(&_status,            0, sizeof(_status));
-    memset(&_message,           0, sizeof(_message));
 }
 
 MAVLinkProtocol::~MAVLinkProtocol()
 {
+    for (MAVLinkDecodeWorker* worker: _decodeWorkers) {
+        worker->stop();
+        delete worker;
+    }
+    _decodeWorkers.clear();
     storeSettings();
     _closeLogFile();
 }
@@ -93,6 +101,8 @@ void MAVLinkProtocol::setVersion(unsigned version)
         } else {
             mavlinkStatus->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
         }
+        // Queued messages are finalized with the version of the queue, not the channel
+        links[i]->sendQueue()->setOutboundMavlink1(version < 200);
     }
 
     _current_version = version;
@@ -115,6 +125,7 @@ void MAVLinkProtocol::setToolbox(QGCToolbox *toolbox)
    connect(this, &MAVLinkProtocol::protocolStatusMessage,   _app, &QGCApplication::criticalMessageBoxOnMainThread);
    connect(this, &MAVLinkProtocol::saveTelemetryLog,        _app, &QGCApplication::saveTelemetryLogOnMainThread);
    connect(this, &MAVLinkProtocol::checkTelemetrySavePath,  _app, &QGCApplication::checkTelemetrySavePathOnMainThread);
+   connect(&_logWriter, &TelemetryLogWriter::writeError,    this, &MAVLinkProtocol::_logWriteError, Qt::QueuedConnection);
 
    connect(_multiVehicleManager, &MultiVehicleManager::vehicleAdded, this, &MAVLinkProtocol::_vehicleCountChanged);
    connect(_multiVehicleManager, &MultiVehicleManager::vehicleRemoved, this, &MAVLinkProtocol::_vehicleCountChanged);
@@ -135,6 +146,17 @@ void MAVLinkProtocol::loadSettings()
     {
         systemId = temp;
     }
+
+    // Decode queue bounds only apply to links attached after the settings are loaded
+    _decodeQueueMax = qMax(0, settings.value(_decodeQueueMaxKey, _decodeQueueMax).toInt());
+    int dropPolicy = settings.value(_decodeDropPolicyKey, _decodeDropPolicy).toInt();
+    if (dropPolicy >= MAVLinkDecodeWorker::DropNone && dropPolicy <= MAVLinkDecodeWorker::DropNewest) {
+        _decodeDropPolicy = static_cast<MAVLinkDecodeWorker::DropPolicy_t>(dropPolicy);
+    }
+
+    if (!_logWriter.isWriting()) {
+        _logWriter.setFsyncInterval(settings.value(_logFsyncIntervalKey, TelemetryLogWriter::_defaultFsyncIntervalMSecs).toInt());
+    }
 }
 
 void MAVLinkProtocol::storeSettings()
@@ -144,6 +166,9 @@ void MAVLinkProtocol::storeSettings()
     settings.beginGroup("QGC_MAVLINK_PROTOCOL");
     settings.setValue("VERSION_CHECK_ENABLED", m_enable_version_check);
     settings.setValue("GCS_SYSTEM_ID", systemId);
+    settings.setValue(_decodeQueueMaxKey, _decodeQueueMax);
+    settings.setValue(_decodeDropPolicyKey, _decodeDropPolicy);
+    settings.setValue(_logFsyncIntervalKey, _logWriter.fsyncInterval());
     // Parameter interface settings
 }
 
@@ -165,216 +190,199 @@ void MAVLinkProtocol::resetMetadataForLink(LinkInterface *link)
  * @see LinkInterface
  **/
 
-void MAVLinkProtocol::logSentBytes(LinkInterface* link, QByteArray b){
-
-    uint8_t bytes_time[sizeof(quint64)];
-
+void MAVLinkProtocol::logSentBytes(LinkInterface* link, QByteArray b)
+{
     Q_UNUSED(link);
-    if (!_logSuspendError && !_logSuspendReplay && _tempLogFile.isOpen()) {
-
-        quint64 time = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000);
 
-        qToBigEndian(time,bytes_time);
+    if (!_logSuspendError && !_logSuspendReplay && _logWriter.isWriting()) {
+        // Records which don't fit in the writer buffer are counted as dropped by the writer
+        _logWriter.writeRecord(static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000), b.constData(), b.count());
+    }
+}
 
-        b.insert(0,QByteArray((const char*)bytes_time,sizeof(bytes_time)));
+void MAVLinkProtocol::attachLink(LinkInterface* link)
+{
+    if (_decodeWorkers.contains(link)) {
+        return;
+    }
 
-        int len = b.count();
+    MAVLinkDecodeWorker* worker = new MAVLinkDecodeWorker(link, _decodeQueueMax, _decodeDropPolicy);
+    connect(worker, &MAVLinkDecodeWorker::messagesReady,    this, &MAVLinkProtocol::_messagesReady,    Qt::QueuedConnection);
+    connect(worker, &MAVLinkDecodeWorker::nonMavlinkData,   this, &MAVLinkProtocol::_nonMavlinkData,   Qt::QueuedConnection);
+    _decodeWorkersMutex.lock();
+    _decodeWorkers[link] = worker;
+    _decodeWorkersMutex.unlock();
+    worker->start();
+}
 
-        if(_tempLogFile.write(b) != len)
-        {
-            // If there's an error logging data, raise an alert and stop logging.
-            emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
-            _stopLogging();
-            _logSuspendError = true;
-        }
+void MAVLinkProtocol::detachLink(LinkInterface* link)
+{
+    _decodeWorkersMutex.lock();
+    MAVLinkDecodeWorker* worker = _decodeWorkers.take(link);
+    _decodeWorkersMutex.unlock();
+    if (worker) {
+        worker->stop();
+        delete worker;
     }
+}
 
+MAVLinkDecodeStats MAVLinkProtocol::decodeStats(LinkInterface* link) const
+{
+    QMutexLocker locker(&_decodeWorkersMutex);
+    MAVLinkDecodeWorker* worker = _decodeWorkers.value(link, nullptr);
+    return worker ? worker->stats() : MAVLinkDecodeStats();
 }
 
 /**
- * This method parses all incoming bytes and constructs a MAVLink packet.
- * It can handle multiple links in parallel, as each link has it's own buffer/
- * parsing state machine.
- * @param link The interface to read from
- * @see LinkInterface
+ * Delivers all messages decoded by the link's worker thread since the last batch.
+ * @param link The interface the messages were received on
+ * @see MAVLinkDecodeWorker
  **/
 
-void MAVLinkProtocol::receiveBytes(LinkInterface* link, QByteArray b)
+void MAVLinkProtocol::_messagesReady(LinkInterface* link)
 {
-    // Since receiveBytes signals cross threads we can end up with signals in the queue
+    // Since messagesReady signals cross threads we can end up with signals in the queue
     // that come through after the link is disconnected. For these we just drop the data
     // since the link is closed.
-    if (!_linkMgr->containsLink(link)) {
+    MAVLinkDecodeWorker* worker = _decodeWorkers.value(link, nullptr);
+    if (!worker || !_linkMgr->containsLink(link)) {
         return;
     }
 
-    uint8_t mavlinkChannel = link->mavlinkChannel();
+    // Handlers may spin the event loop, so the batch must not be shared with a nested delivery
+    MAVLinkDecodedMessageList decodedBatch;
+    worker->takeMessages(decodedBatch);
+    if (decodedBatch.isEmpty()) {
+        return;
+    }
 
-    static int  nonmavlinkCount = 0;
-    static bool checkedUserNonMavlink = false;
-    static bool warnedUserNonMavlink  = false;
-
-    for (int position = 0; position < b.size(); position++) {
-        if (mavlink_parse_char(mavlinkChannel, static_cast<uint8_t>(b[position]), &_message, &_status)) {
-            // Got a valid message
-            if (!link->decodedFirstMavlinkPacket()) {
-                link->setDecodedFirstMavlinkPacket(true);
-                mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
-                if (!(mavlinkStatus->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1) && (mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
-                    qDebug() << "Switching outbound to mavlink 2.0 due to incoming mavlink 2.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
-                    mavlinkStatus->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
-                    // Set all links to v2
-                    setVersion(200);
-                }
-            }
+    // Latency is sampled once per batch, the oldest message in the batch has waited the longest
+    worker->recordLatency(MAVLinkDecodeWorker::monotonicUsecs() - decodedBatch.first().decodedUsecs);
 
-            //-----------------------------------------------------------------
-            // MAVLink Status
-            uint8_t lastSeq = lastIndex[_message.sysid][_message.compid];
-            uint8_t expectedSeq = lastSeq + 1;
-            // Increase receive counter
-            totalReceiveCounter[mavlinkChannel]++;
-            // Determine what the next expected sequence number is, accounting for
-            // never having seen a message for this system/component pair.
-            if(firstMessage[_message.sysid][_message.compid]) {
-                firstMessage[_message.sysid][_message.compid] = 0;
-                lastSeq     = _message.seq;
-                expectedSeq = _message.seq;
-            }
-            // And if we didn't encounter that sequence number, record the error
-            //int foo = 0;
-            if (_message.seq != expectedSeq)
-            {
-                //foo = 1;
-                int lostMessages = 0;
-                //-- Account for overflow during packet loss
-                if(_message.seq < expectedSeq) {
-                    lostMessages = (_message.seq + 255) - expectedSeq;
-                } else {
-                    lostMessages = _message.seq - expectedSeq;
-                }
-                // Log how many were lost
-                totalLossCounter[mavlinkChannel] += static_cast<uint64_t>(lostMessages);
-            }
+    int handledCount = 0;
+    for (const MAVLinkDecodedMessage& decoded: decodedBatch) {
+        _handleMessage(link, decoded);
+        handledCount++;
+        // Heartbeat handling may have caused the link to be removed
+        if (!_decodeWorkers.contains(link)) {
+            break;
+        }
+    }
 
-            // And update the last sequence number for this system/component pair
-            lastIndex[_message.sysid][_message.compid] = _message.seq;;
-            // Calculate new loss ratio
-            uint64_t totalSent = totalReceiveCounter[mavlinkChannel] + totalLossCounter[mavlinkChannel];
-            float receiveLossPercent = static_cast<float>(static_cast<double>(totalLossCounter[mavlinkChannel]) / static_cast<double>(totalSent));
-            receiveLossPercent *= 100.0f;
-            receiveLossPercent = (receiveLossPercent * 0.5f) + (runningLossPercent[mavlinkChannel] * 0.5f);
-            runningLossPercent[mavlinkChannel] = receiveLossPercent;
-
-            //qDebug() << foo << _message.seq << expectedSeq << lastSeq << totalLossCounter[mavlinkChannel] << totalReceiveCounter[mavlinkChannel] << totalSentCounter[mavlinkChannel] << "(" << _message.sysid << _message.compid << ")";
-
-            //-----------------------------------------------------------------
-            // Log data
-            if (!_logSuspendError && !_logSuspendReplay && _tempLogFile.isOpen()) {
-                uint8_t buf[MAVLINK_MAX_PACKET_LEN+sizeof(quint64)];
-
-                // Write the uint64 time in microseconds in big endian format before the message.
-                // This timestamp is saved in UTC time. We are only saving in ms precision because
-                // getting more than this isn't possible with Qt without a ton of extra code.
-                quint64 time = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch() * 1000);
-                qToBigEndian(time, buf);
-
-                // Then write the message to the buffer
-                int len = mavlink_msg_to_send_buffer(buf + sizeof(quint64), &_message);
-
-                // Determine how many bytes were written by adding the timestamp size to the message size
-                len += sizeof(quint64);
-
-                // Now write this timestamp/message pair to the log.
-                QByteArray b(reinterpret_cast<const char*>(buf), len);
-                if(_tempLogFile.write(b) != len)
-                {
-                    // If there's an error logging data, raise an alert and stop logging.
-                    emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
-                    _stopLogging();
-                    _logSuspendError = true;
-                }
-
-                // Check for the vehicle arming going by. This is used to trigger log save.
-                if (!_vehicleWasArmed && _message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                    mavlink_heartbeat_t state;
-                    mavlink_msg_heartbeat_decode(&_message, &state);
-                    if (state.base_mode & MAV_MODE_FLAG_DECODE_POSITION_SAFETY) {
-                        _vehicleWasArmed = true;
-                    }
-                }
-            }
+    // Subscribers see the whole batch after status accounting, this way a vehicle created from a heartbeat in
+    // this batch still receives that heartbeat.
+    _messageRouter.route(link, decodedBatch, handledCount);
+}
 
-            if (_message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
-                _startLogging();
-                mavlink_heartbeat_t heartbeat;
-                mavlink_msg_heartbeat_decode(&_message, &heartbeat);
-                emit vehicleHeartbeatInfo(link, _message.sysid, _message.compid, heartbeat.autopilot, heartbeat.type);
-            }
+void MAVLinkProtocol::_handleMessage(LinkInterface* link, const MAVLinkDecodedMessage& decoded)
+{
+    const mavlink_message_t& message = decoded.message;
+    uint8_t mavlinkChannel = link->mavlinkChannel();
 
-            if (_message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY2) {
-                _startLogging();
-                mavlink_high_latency2_t highLatency2;
-                mavlink_msg_high_latency2_decode(&_message, &highLatency2);
-                emit vehicleHeartbeatInfo(link, _message.sysid, _message.compid, highLatency2.autopilot, highLatency2.type);
-            }
+    if (!link->decodedFirstMavlinkPacket()) {
+        link->setDecodedFirstMavlinkPacket(true);
+        mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
+        if (message.magic != MAVLINK_STX_MAVLINK1 && (mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
+            qDebug() << "Switching outbound to mavlink 2.0 due to incoming mavlink 2.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
+            mavlinkStatus->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+            // Set all links to v2
+            setVersion(200);
+        }
+    }
 
-#if 0
-            // Given the current state of SiK Radio firmwares there is no way to make the code below work.
-            // The ArduPilot implementation of SiK Radio firmware always sends MAVLINK_MSG_ID_RADIO_STATUS as a mavlink 1
-            // packet even if the vehicle is sending Mavlink 2.
-
-            // Detect if we are talking to an old radio not supporting v2
-            mavlink_status_t* mavlinkStatus = mavlink_get_channel_status(mavlinkChannel);
-            if (_message.msgid == MAVLINK_MSG_ID_RADIO_STATUS && _radio_version_mismatch_count != -1) {
-                if ((mavlinkStatus->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1)
-                && !(mavlinkStatus->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
-                    _radio_version_mismatch_count++;
-                }
-            }
+    //-----------------------------------------------------------------
+    // MAVLink Status
+    uint8_t lastSeq = lastIndex[message.sysid][message.compid];
+    uint8_t expectedSeq = lastSeq + 1;
+    // Increase receive counter
+    totalReceiveCounter[mavlinkChannel]++;
+    // Determine what the next expected sequence number is, accounting for
+    // never having seen a message for this system/component pair.
+    if(firstMessage[message.sysid][message.compid]) {
+        firstMessage[message.sysid][message.compid] = 0;
+        lastSeq     = message.seq;
+        expectedSeq = message.seq;
+    }
+    // And if we didn't encounter that sequence number, record the error
+    if (message.seq != expectedSeq)
+    {
+        int lostMessages = 0;
+        //-- Account for overflow during packet loss
+        if(message.seq < expectedSeq) {
+            lostMessages = (message.seq + 255) - expectedSeq;
+        } else {
+            lostMessages = message.seq - expectedSeq;
+        }
+        // Log how many were lost
+        totalLossCounter[mavlinkChannel] += static_cast<uint64_t>(lostMessages);
+    }
 
-            if (_radio_version_mismatch_count == 5) {
-                // Warn the user if the radio continues to send v1 while the link uses v2
-                emit protocolStatusMessage(tr("MAVLink Protocol"), tr("Detected radio still using MAVLink v1.0 on a link with MAVLink v2.0 enabled. Please upgrade the radio firmware."));
-                // Set to flag warning already shown
-                _radio_version_mismatch_count = -1;
-                // Flick link back to v1
-                qDebug() << "Switching outbound to mavlink 1.0 due to incoming mavlink 1.0 packet:" << mavlinkStatus << mavlinkChannel << mavlinkStatus->flags;
-                mavlinkStatus->flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+    // And update the last sequence number for this system/component pair
+    lastIndex[message.sysid][message.compid] = message.seq;
+    // Calculate new loss ratio
+    uint64_t totalSent = totalReceiveCounter[mavlinkChannel] + totalLossCounter[mavlinkChannel];
+    float receiveLossPercent = static_cast<float>(static_cast<double>(totalLossCounter[mavlinkChannel]) / static_cast<double>(totalSent));
+    receiveLossPercent *= 100.0f;
+    receiveLossPercent = (receiveLossPercent * 0.5f) + (runningLossPercent[mavlinkChannel] * 0.5f);
+    runningLossPercent[mavlinkChannel] = receiveLossPercent;
+
+    //-----------------------------------------------------------------
+    // Log data
+    if (!_logSuspendError && !_logSuspendReplay && _logWriter.isWriting()) {
+        uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+
+        // The writer prefixes the message with the uint64 UTC time in microseconds in big endian format.
+        // This timestamp was captured by the decode worker when the message was framed.
+        int len = mavlink_msg_to_send_buffer(buf, &message);
+        _logWriter.writeRecord(decoded.timestampUsecs, reinterpret_cast<const char*>(buf), len);
+
+        // Check for the vehicle arming going by. This is used to trigger log save.
+        if (!_vehicleWasArmed && message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+            mavlink_heartbeat_t state;
+            mavlink_msg_heartbeat_decode(&message, &state);
+            if (state.base_mode & MAV_MODE_FLAG_DECODE_POSITION_SAFETY) {
+                _vehicleWasArmed = true;
             }
-#endif
+        }
+    }
 
-            // Update MAVLink status on every 32th packet
-            if ((totalReceiveCounter[mavlinkChannel] & 0x1F) == 0) {
-                emit mavlinkMessageStatus(_message.sysid, totalSent, totalReceiveCounter[mavlinkChannel], totalLossCounter[mavlinkChannel], receiveLossPercent);
-            }
+    if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+        _startLogging();
+        mavlink_heartbeat_t heartbeat;
+        mavlink_msg_heartbeat_decode(&message, &heartbeat);
+        emit vehicleHeartbeatInfo(link, message.sysid, message.compid, heartbeat.autopilot, heartbeat.type);
+    }
 
-            // The packet is emitted as a whole, as it is only 255 - 261 bytes short
-            // kind of inefficient, but no issue for a groundstation pc.
-            // It buys as reentrancy for the whole code over all threads
-            emit messageReceived(link, _message);
-            // Reset message parsing
-            memset(&_status,  0, sizeof(_status));
-            memset(&_message, 0, sizeof(_message));
-        } else if (!link->decodedFirstMavlinkPacket()) {
-            // No formed message yet
-            nonmavlinkCount++;
-            if (nonmavlinkCount > 1000 && !warnedUserNonMavlink) {
-                // 1000 bytes with no mavlink message. Are we connected to a mavlink capable device?
-                if (!checkedUserNonMavlink) {
-                    link->requestReset();
-                    checkedUserNonMavlink = true;
-                } else {
-                    warnedUserNonMavlink = true;
-                    // Disconnect the link since it's some other device and
-                    // QGC clinging on to it and feeding it data might have unintended
-                    // side effects (e.g. if its a modem)
-                    qDebug() << "disconnected link" << link->getName() << "as it contained no MAVLink data";
-                    QMetaObject::invokeMethod(_linkMgr, "disconnectLink", Q_ARG( LinkInterface*, link ) );
-                    return;
-                }
-            }
-        }
+    if (message.msgid == MAVLINK_MSG_ID_HIGH_LATENCY2) {
+        _startLogging();
+        mavlink_high_latency2_t highLatency2;
+        mavlink_msg_high_latency2_decode(&message, &highLatency2);
+        emit vehicleHeartbeatInfo(link, message.sysid, message.compid, highLatency2.autopilot, highLatency2.type);
+    }
+
+    // Update MAVLink status on every 32th packet
+    if ((totalReceiveCounter[mavlinkChannel] & 0x1F) == 0) {
+        emit mavlinkMessageStatus(message.sysid, totalSent, totalReceiveCounter[mavlinkChannel], totalLossCounter[mavlinkChannel], receiveLossPercent);
+    }
+}
+
+void MAVLinkProtocol::_nonMavlinkData(LinkInterface* link)
+{
+    if (!_decodeWorkers.contains(link) || link->decodedFirstMavlinkPacket() || _warnedUserNonMavlink) {
+        return;
+    }
+
+    // 1000 bytes with no mavlink message. Are we connected to a mavlink capable device?
+    if (!_checkedUserNonMavlink) {
+        link->requestReset();
+        _checkedUserNonMavlink = true;
+    } else {
+        _warnedUserNonMavlink = true;
+        // Disconnect the link since it's some other device and
+        // QGC clinging on to it and feeding it data might have unintended
+        // side effects (e.g. if its a modem)
+        qDebug() << "disconnected link" << link->getName() << "as it contained no MAVLink data";
+        QMetaObject::invokeMethod(_linkMgr, "disconnectLink", Q_ARG( LinkInterface*, link ) );
     }
 }
 
@@ -422,6 +430,9 @@ void MAVLinkProtocol::_vehicleCountChanged(void)
 /// @brief Closes the log file if it is open
 bool MAVLinkProtocol::_closeLogFile(void)
 {
+    // Drain everything still buffered before touching the file
+    _logWriter.stopWriting();
+
     if (_tempLogFile.isOpen()) {
         if (_tempLogFile.size() == 0) {
             // Don't save zero byte files
@@ -465,6 +476,7 @@ void MAVLinkProtocol::_startLogging(void)
             }
 
             qDebug() << "Temp log" << _tempLogFile.fileName();
+            _logWriter.startWriting(&_tempLogFile);
             emit checkTelemetrySavePath();
 
             _logSuspendError = false;
@@ -510,6 +522,19 @@ void MAVLinkProtocol::checkForLostLogFiles(void)
     }
 }
 
+void MAVLinkProtocol::_logWriteError(QString errorString)
+{
+    if (!_tempLogFile.isOpen()) {
+        return;
+    }
+
+    // If there's an error logging data, raise an alert and stop logging.
+    qCWarning(MAVLinkProtocolLog) << "Telemetry log write error" << errorString;
+    emit protocolStatusMessage(tr("MAVLink Protocol"), tr("MAVLink Logging failed. Could not write to file %1, logging disabled.").arg(_tempLogFile.fileName()));
+    _stopLogging();
+    _logSuspendError = true;
+}
+
 void MAVLinkProtocol::suspendLogForReplay(bool suspend)
 {
     _logSuspendReplay = suspend;
@@ -19,6 +19,9 @@
 #include <QLoggingCategory>
 
 #include "LinkInterface.h"
+#include "MAVLinkDecodeWorker.h"
+#include "MAVLinkMessageRouter.h"
+#include "TelemetryLogWriter.h"
 #include "QGCMAVLink.h"
 #include "QGC.h"
 #include "QGCTemporaryFile.h"
@@ -77,10 +80,23 @@ public:
     // Override from QGCTool
     virtual void setToolbox(QGCToolbox *toolbox);
 
-public slots:
-    /** @brief Receive bytes from a communication interface */
-    void receiveBytes(LinkInterface* link, QByteArray b);
+    /// Starts the decode worker thread for the specified link. Incoming bytes are framed and CRC checked on
+    /// the worker thread and handed back to the main thread in batches.
+    void attachLink(LinkInterface* link);
+
+    /// Stops the decode worker thread for the specified link. Undelivered messages are discarded.
+    void detachLink(LinkInterface* link);
+
+    /// @return Queue depth and decode latency statistics for the specified link. Can be called from any thread.
+    MAVLinkDecodeStats decodeStats(LinkInterface* link) const;
+
+    /// Decoded messages are delivered through subscriptions on the router
+    MAVLinkMessageRouter* messageRouter(void) { return &_messageRouter; }
+
+    /// @return Number of telemetry log records dropped because storage could not keep up
+    quint64 telemetryLogDroppedRecords(void) const { return _logWriter.droppedRecords(); }
 
+public slots:
     /** @brief Log bytes sent from a communication interface */
     void logSentBytes(LinkInterface* link, QByteArray b);
     
@@ -109,9 +125,6 @@ protected:
     uint64_t    totalLossCounter[MAVLINK_COMM_NUM_BUFFERS];     ///< Total messages lost during transmission.
     float       runningLossPercent[MAVLINK_COMM_NUM_BUFFERS];   ///< Loss rate
 
-    mavlink_message_t _message;
-    mavlink_status_t _status;
-
     bool        versionMismatchIgnore;
     int         systemId;
     unsigned    _current_version;
@@ -121,8 +134,6 @@ signals:
     /// Heartbeat received on link
     void vehicleHeartbeatInfo(LinkInterface* link, int vehicleId, int componentId, int vehicleFirmwareType, int vehicleType);
 
-    /** @brief Message received and directly copied via signal */
-    void messageReceived(LinkInterface* link, mavlink_message_t message);
     /** @brief Emitted if version check is enabled / disabled */
     void versionCheckChanged(bool enabled);
     /** @brief Emitted if a message from the protocol should reach the user */
@@ -154,8 +165,12 @@ signals:
 
 private slots:
     void _vehicleCountChanged(void);
-    
+    void _messagesReady(LinkInterface* link);
+    void _nonMavlinkData(LinkInterface* link);
+    void _logWriteError(QString errorString);
+
 private:
+    void _handleMessage(LinkInterface* link, const MAVLinkDecodedMessage& decoded);
     bool _closeLogFile(void);
     void _startLogging(void);
     void _stopLogging(void);
@@ -165,10 +180,23 @@ private:
     bool _vehicleWasArmed;      ///< true: Vehicle was armed during log sequence
 
     QGCTemporaryFile    _tempLogFile;            ///< File to log to
+    TelemetryLogWriter  _logWriter;              ///< Writes to _tempLogFile from its own thread
     static const char*  _tempLogFileTemplate;    ///< Template for temporary log file
     static const char*  _logFileExtension;       ///< Extension for log files
 
     LinkManager*            _linkMgr;
     MultiVehicleManager*    _multiVehicleManager;
+
+    MAVLinkMessageRouter                        _messageRouter;
+    QMap<LinkInterface*, MAVLinkDecodeWorker*>  _decodeWorkers;
+    mutable QMutex                              _decodeWorkersMutex;    ///< Protects _decodeWorkers writes and decodeStats reads from other threads
+    int                                         _decodeQueueMax;    ///< Maximum decoded messages queued per link, 0 for unbounded
+    MAVLinkDecodeWorker::DropPolicy_t           _decodeDropPolicy;
+    bool                                        _checkedUserNonMavlink;
+    bool                                        _warnedUserNonMavlink;
+
+    static const char*  _decodeQueueMaxKey;
+    static const char*  _decodeDropPolicyKey;
+    static const char*  _logFsyncIntervalKey;
 };
 
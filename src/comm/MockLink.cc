@@ -78,6 +78,10 @@ MockLink::MockLink(SharedLinkConfigurationPointer& config)
     , _sendGPSPositionDelayCount            (100)   // No gps lock for 5 seconds
     , _currentParamRequestListComponentIndex(-1)
     , _currentParamRequestListParamIndex    (-1)
+    , _logDownloadFileSize                  (1000)
+    , _logDownloadPacketsPerTick            (1)
+    , _logDownloadDropInterval              (0)
+    , _logDownloadPacketCount               (0)
     , _logDownloadCurrentOffset             (0)
     , _logDownloadBytesRemaining            (0)
     , _adsbAngle                            (0)
@@ -1385,6 +1389,11 @@ void MockLink::_handleLogRequestData(const mavlink_message_t& msg)
         return;
     }
 
+    {
+        QMutexLocker locker(&_logDownloadRequestsMutex);
+        _logDownloadRequests.append(qMakePair(request.ofs, request.count));
+    }
+
     if (request.ofs > _logDownloadFileSize - 1) {
         qWarning() << "MockLink::_handleLogRequestData offset past end of file request.ofs:size" << request.ofs << _logDownloadFileSize;
         return;
@@ -1398,32 +1407,55 @@ void MockLink::_handleLogRequestData(const mavlink_message_t& msg)
     _logDownloadBytesRemaining = request.count;
 }
 
+QList<QPair<uint32_t, uint32_t>> MockLink::logDownloadRequests(void)
+{
+    QMutexLocker locker(&_logDownloadRequestsMutex);
+    return _logDownloadRequests;
+}
+
+void MockLink::clearLogDownloadRequests(void)
+{
+    QMutexLocker locker(&_logDownloadRequestsMutex);
+    _logDownloadRequests.clear();
+}
+
 void MockLink::_logDownloadWorker(void)
 {
     if (_logDownloadBytesRemaining != 0) {
         QFile file(_logDownloadFilename);
         if (file.open(QIODevice::ReadOnly)) {
-            uint8_t buffer[MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN];
-
-            qint64 bytesToRead = qMin(_logDownloadBytesRemaining, (uint32_t)MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
-            Q_ASSERT(file.seek(_logDownloadCurrentOffset));
-            Q_ASSERT(file.read((char *)buffer, bytesToRead) == bytesToRead);
-
-            qDebug() << "MockLink::_logDownloadWorker" << _logDownloadCurrentOffset << _logDownloadBytesRemaining;
-
-            mavlink_message_t responseMsg;
-            mavlink_msg_log_data_pack_chan(_vehicleSystemId,
-                                           _vehicleComponentId,
-                                           _mavlinkChannel,
-                                           &responseMsg,
-                                           _logDownloadLogId,
-                                           _logDownloadCurrentOffset,
-                                           bytesToRead,
-                                           &buffer[0]);
-            respondWithMavlinkMessage(responseMsg);
-
-            _logDownloadCurrentOffset += bytesToRead;
-            _logDownloadBytesRemaining -= bytesToRead;
+            if (!file.seek(_logDownloadCurrentOffset)) {
+                qWarning() << "MockLink::_logDownloadWorker seek failed" << file.errorString();
+                return;
+            }
+
+            for (int i=0; i<_logDownloadPacketsPerTick && _logDownloadBytesRemaining != 0; i++) {
+                uint8_t buffer[MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN];
+
+                qint64 bytesToRead = qMin(_logDownloadBytesRemaining, (uint32_t)MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN);
+                if (file.read((char *)buffer, bytesToRead) != bytesToRead) {
+                    qWarning() << "MockLink::_logDownloadWorker read failed" << file.errorString();
+                    break;
+                }
+
+                qCDebug(MockLinkVerboseLog) << "MockLink::_logDownloadWorker" << _logDownloadCurrentOffset << _logDownloadBytesRemaining;
+
+                if (_logDownloadDropInterval == 0 || (++_logDownloadPacketCount % _logDownloadDropInterval) != 0) {
+                    mavlink_message_t responseMsg;
+                    mavlink_msg_log_data_pack_chan(_vehicleSystemId,
+                                                   _vehicleComponentId,
+                                                   _mavlinkChannel,
+                                                   &responseMsg,
+                                                   _logDownloadLogId,
+                                                   _logDownloadCurrentOffset,
+                                                   bytesToRead,
+                                                   &buffer[0]);
+                    respondWithMavlinkMessage(responseMsg);
+                }
+
+                _logDownloadCurrentOffset += bytesToRead;
+                _logDownloadBytesRemaining -= bytesToRead;
+            }
 
             file.close();
         } else {
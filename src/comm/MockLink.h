@@ -11,6 +11,7 @@
 #pragma once
 
 #include <QMap>
+#include <QMutex>
 #include <QLoggingCategory>
 #include <QGeoCoordinate>
 
@@ -152,6 +153,16 @@ public:
     /// Returns the filename for the simulated log file. Only available after a download is requested.
     QString logDownloadFile(void) { return _logDownloadFilename; }
 
+    /// Configures the simulated log file for log download testing. Must be called before the log list is requested.
+    ///     @param fileSize Size of the simulated log file
+    ///     @param packetsPerTick Number of LOG_DATA messages sent every 2 msecs
+    ///     @param dropInterval Every Nth LOG_DATA message is dropped, 0 for no drops
+    void setLogDownloadConfig(uint32_t fileSize, int packetsPerTick, int dropInterval) { _logDownloadFileSize = fileSize; _logDownloadPacketsPerTick = packetsPerTick; _logDownloadDropInterval = dropInterval; }
+
+    /// LOG_REQUEST_DATA requests received so far as (offset, count). Thread safe.
+    QList<QPair<uint32_t, uint32_t>> logDownloadRequests(void);
+    void clearLogDownloadRequests(void);
+
     static MockLink* startPX4MockLink            (bool sendStatusText, MockConfiguration::FailureMode_t failureMode = MockConfiguration::FailNone);
     static MockLink* startGenericMockLink        (bool sendStatusText, MockConfiguration::FailureMode_t failureMode = MockConfiguration::FailNone);
     static MockLink* startAPMArduCopterMockLink  (bool sendStatusText, MockConfiguration::FailureMode_t failureMode = MockConfiguration::FailNone);
@@ -252,11 +263,16 @@ private:
     int _currentParamRequestListParamIndex;     // Current parameter index for param request list workflow
 
     static const uint16_t _logDownloadLogId = 0;        ///< Id of siumulated log file
-    static const uint32_t _logDownloadFileSize = 1000;  ///< Size of simulated log file
 
+    uint32_t    _logDownloadFileSize;       ///< Size of simulated log file
+    int         _logDownloadPacketsPerTick; ///< Number of LOG_DATA messages sent per worker tick
+    int         _logDownloadDropInterval;   ///< Every Nth LOG_DATA message is dropped, 0 for no drops
+    uint32_t    _logDownloadPacketCount;    ///< Number of LOG_DATA messages generated, used for drops
     QString _logDownloadFilename;           ///< Filename for log download which is in progress
     uint32_t    _logDownloadCurrentOffset;  ///< Current offset we are sending from
     uint32_t    _logDownloadBytesRemaining; ///< Number of bytes still to send, 0 = send inactive
+    QMutex      _logDownloadRequestsMutex;
+    QList<QPair<uint32_t, uint32_t>> _logDownloadRequests;
 
     QGeoCoordinate  _adsbVehicleCoordinate;
     double          _adsbAngle;
@@ -10,6 +10,7 @@
 
 #include "MockLinkFileServer.h"
 #include "MockLink.h"
+#include "QGC.h"
 
 const MockLinkFileServer::ErrorMode_t MockLinkFileServer::rgFailureModes[] = {
     MockLinkFileServer::errModeNoResponse,
@@ -27,6 +28,8 @@ const MockLinkFileServer::FileTestCase MockLinkFileServer::rgFileTestCases[MockL
     { "exact.qgc",      sizeof(((FileManager::Request*)0)->data),         1,    true },
     // File is larger than a single Read Ack packets, requires multiple Reads
     { "multi.qgc",      sizeof(((FileManager::Request*)0)->data) + 1,     2,    false },
+    // Large enough for a burst download to drop packets from, last packet partially filled
+    { "burst.qgc",      sizeof(((FileManager::Request*)0)->data) * 20 - 100,   20,   false },
 };
 
 // We only support a single fixed session
@@ -39,7 +42,8 @@ MockLinkFileServer::MockLinkFileServer(uint8_t systemIdServer, uint8_t component
     _mockLink(mockLink),
     _lastReplyValid(false),
     _lastReplySequence(0),
-    _randomDropsEnabled(false)
+    _randomDropsEnabled(false),
+    _holdResponseCount(0)
 {
     srand(0); // make sure unit tests are deterministic
 }
@@ -111,34 +115,39 @@ void MockLinkFileServer::_listCommand(uint8_t senderSystemId, uint8_t senderComp
     }
 }
 
-/// @brief Handles Open command requests.
-void MockLinkFileServer::_openCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+/// @brief Returns the test case whose filename is the path in the request, nullptr if there is none
+const MockLinkFileServer::FileTestCase* MockLinkFileServer::_findFileTestCase(FileManager::Request* request)
 {
-    FileManager::Request  response;
-    QString                     path;
-    uint16_t                    outgoingSeqNumber = _nextSeqNumber(seqNumber);
-    
     ensureNullTemination(request);
 
     size_t cchPath = strnlen((char *)request->data, sizeof(request->data));
     Q_ASSERT(cchPath != sizeof(request->data));
     Q_UNUSED(cchPath); // Fix initialized-but-not-referenced warning on release builds
-    path = (char *)request->data;
+    QString path = (char *)request->data;
     
     // Check path against one of our known test cases
-
-    bool found = false;
     for (size_t i=0; i<cFileTestCases; i++) {
         if (path == rgFileTestCases[i].filename) {
-            found = true;
-            _readFileLength = rgFileTestCases[i].length;
-            break;
+            return &rgFileTestCases[i];
         }
     }
-    if (!found) {
+    return nullptr;
+}
+
+/// @brief Handles Open command requests.
+void MockLinkFileServer::_openCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request  response;
+    uint16_t                    outgoingSeqNumber = _nextSeqNumber(seqNumber);
+    
+    emit openCommandReceived();
+
+    const FileTestCase* testCase = _findFileTestCase(request);
+    if (!testCase) {
         _sendNak(senderSystemId, senderComponentId, FileManager::kErrFail, outgoingSeqNumber, FileManager::kCmdOpenFileRO);
         return;
     }
+    _readFileLength = testCase->length;
     
     response.hdr.opcode = FileManager::kRspAck;
 	response.hdr.req_opcode = FileManager::kCmdOpenFileRO;
@@ -163,6 +172,8 @@ void MockLinkFileServer::_readCommand(uint8_t senderSystemId, uint8_t senderComp
     
     uint32_t readOffset = request->hdr.offset;  // offset into file for reading
     uint8_t cDataBytes = 0;                     // current number of data bytes used
+
+    _readOffsets.append(readOffset);
     
     if (readOffset != 0) {
         // If we get here it means the client is requesting additional data past the first request
@@ -195,7 +206,7 @@ void MockLinkFileServer::_readCommand(uint8_t senderSystemId, uint8_t senderComp
     response.hdr.opcode = FileManager::kRspAck;
 	response.hdr.req_opcode = FileManager::kCmdReadFile;
 
-    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+    _sendWindowedResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber, false /* release */);
 }
 
 void MockLinkFileServer::_streamCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
@@ -211,6 +222,7 @@ void MockLinkFileServer::_streamCommand(uint8_t senderSystemId, uint8_t senderCo
     uint32_t readOffset = 0;	// offset into file for reading
     uint32_t ackOffset = 0;     // offset for ack
     uint8_t cDataAck;           // number of bytes in ack
+    int packetIndex = 0;        // index of this packet into the file
     
     while (readOffset < _readFileLength) {
         cDataAck = 0;
@@ -240,12 +252,17 @@ void MockLinkFileServer::_streamCommand(uint8_t senderSystemId, uint8_t senderCo
         response.hdr.offset = ackOffset;
         response.hdr.opcode = FileManager::kRspAck;
         response.hdr.req_opcode = FileManager::kCmdBurstReadFile;
+        response.hdr.burstComplete = 0;
         
-        _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+        if (!_dropBurstPackets.contains(packetIndex)) {
+            _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+        }
         
         outgoingSeqNumber = _nextSeqNumber(outgoingSeqNumber);
         ackOffset += cDataAck;
+        packetIndex++;
     }
+    _dropBurstPackets.clear();
 	
     _sendNak(senderSystemId, senderComponentId, FileManager::kErrEOF, outgoingSeqNumber, FileManager::kCmdBurstReadFile);
 }
@@ -273,6 +290,108 @@ void MockLinkFileServer::_resetCommand(uint8_t senderSystemId, uint8_t senderCom
     emit resetCommandReceived();
 }
 
+/// @brief Handles CalcFileCRC32 command requests. The checksum covers the same contents a download of the file returns.
+void MockLinkFileServer::_calcCRC32Command(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+
+    const FileTestCase* testCase = _findFileTestCase(request);
+    if (!testCase) {
+        _sendNak(senderSystemId, senderComponentId, FileManager::kErrFail, outgoingSeqNumber, FileManager::kCmdCalcFileCRC32);
+        return;
+    }
+
+    // File bytes are a repeating sequence of 0x00, 0x01, .. 0xFF
+    QByteArray bytes(static_cast<int>(testCase->length), Qt::Uninitialized);
+    for (int i=0; i<bytes.length(); i++) {
+        bytes[i] = static_cast<char>(i & 0xFF);
+    }
+
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdCalcFileCRC32;
+    response.hdr.session = 0;
+    response.hdr.size = sizeof(uint32_t);
+    response.crc32 = QGC::crc32(reinterpret_cast<const quint8*>(bytes.constData()), static_cast<unsigned>(bytes.length()), 0);
+
+    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+}
+
+/// @brief Handles Create command requests. Any path is accepted, the uploaded file starts out empty.
+void MockLinkFileServer::_createCommand(uint8_t senderSystemId, uint8_t senderComponentId, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+
+    _uploadedFile.clear();
+    _writeSeqNumbers.clear();
+
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdCreateFile;
+    response.hdr.session = _sessionId;
+    response.hdr.size = 0;
+
+    _sendResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber);
+}
+
+/// @brief Handles Write command requests. Data goes into the uploaded file at the requested offset.
+void MockLinkFileServer::_writeCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber)
+{
+    FileManager::Request    response;
+    uint16_t                outgoingSeqNumber = _nextSeqNumber(seqNumber);
+
+    if (request->hdr.session != _sessionId) {
+        _sendNak(senderSystemId, senderComponentId, FileManager::kErrInvalidSession, outgoingSeqNumber, FileManager::kCmdWriteFile);
+        return;
+    }
+
+    uint32_t writeOffset = request->hdr.offset;
+    uint8_t cDataBytes = request->hdr.size;
+
+    _writeSeqNumbers[writeOffset].append(seqNumber);
+    if (static_cast<uint32_t>(_uploadedFile.length()) < writeOffset + cDataBytes) {
+        _uploadedFile.resize(static_cast<int>(writeOffset + cDataBytes));
+    }
+    _uploadedFile.replace(static_cast<int>(writeOffset), cDataBytes, (const char*)request->data, cDataBytes);
+
+    if (_dropWriteResponseOffsets.remove(writeOffset)) {
+        return;
+    }
+
+    response.hdr.opcode = FileManager::kRspAck;
+    response.hdr.req_opcode = FileManager::kCmdWriteFile;
+    response.hdr.session = _sessionId;
+    response.hdr.offset = writeOffset;
+    response.hdr.size = sizeof(uint32_t);
+    response.writeFileLength = cDataBytes;
+
+    _sendWindowedResponse(senderSystemId, senderComponentId, &response, outgoingSeqNumber, cDataBytes < sizeof(request->data) /* release */);
+}
+
+/// @brief Sends the response to a Read or Write command, or holds it back as set up by holdResponses
+///     @param release true: send everything held now
+void MockLinkFileServer::_sendWindowedResponse(uint8_t targetSystemId, uint8_t targetComponentId, FileManager::Request* request, uint16_t seqNumber, bool release)
+{
+    if (_holdResponseCount <= 1) {
+        _sendResponse(targetSystemId, targetComponentId, request, seqNumber);
+        return;
+    }
+
+    HeldResponse_t held;
+    held.targetSystemId = targetSystemId;
+    held.targetComponentId = targetComponentId;
+    held.response = *request;
+    held.seqNumber = seqNumber;
+    _heldResponses.append(held);
+
+    if (release || _heldResponses.count() >= _holdResponseCount) {
+        while (!_heldResponses.isEmpty()) {
+            held = _heldResponses.takeLast();
+            _sendResponse(held.targetSystemId, held.targetComponentId, &held.response, held.seqNumber);
+        }
+    }
+}
+
 void MockLinkFileServer::handleFTPMessage(const mavlink_message_t& message)
 {
     if (message.msgid != MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL) {
@@ -348,6 +467,14 @@ void MockLinkFileServer::handleFTPMessage(const mavlink_message_t& message)
             _streamCommand(message.sysid, message.compid, request, incomingSeqNumber);
             break;
 
+        case FileManager::kCmdCreateFile:
+            _createCommand(message.sysid, message.compid, incomingSeqNumber);
+            break;
+
+        case FileManager::kCmdWriteFile:
+            _writeCommand(message.sysid, message.compid, request, incomingSeqNumber);
+            break;
+
         case FileManager::kCmdTerminateSession:
             _terminateCommand(message.sysid, message.compid, request, incomingSeqNumber);
             break;
@@ -355,6 +482,12 @@ void MockLinkFileServer::handleFTPMessage(const mavlink_message_t& message)
         case FileManager::kCmdResetSessions:
             _resetCommand(message.sysid, message.compid, incomingSeqNumber);
             break;
+
+        case FileManager::kCmdCalcFileCRC32:
+            if (_errMode != errModeNoCRC32Response) {
+                _calcCRC32Command(message.sysid, message.compid, request, incomingSeqNumber);
+            }
+            break;
             
         default:
             // nack for all NYI opcodes
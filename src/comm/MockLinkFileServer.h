@@ -16,6 +16,8 @@
 #include "FileManager.h"
 
 #include <QStringList>
+#include <QMap>
+#include <QSet>
 
 class MockLink;
 
@@ -38,7 +40,8 @@ public:
         errModeNakResponse,         ///< Nak all requests
         errModeNoSecondResponse,    ///< No response to subsequent request to initial command
         errModeNakSecondResponse,   ///< Nak subsequent request to initial command
-        errModeBadSequence          ///< Return response with bad sequence number
+        errModeBadSequence,         ///< Return response with bad sequence number
+        errModeNoCRC32Response      ///< No response to CalcFileCRC32, all other requests are answered normally
     } ErrorMode_t;
     
     /// @brief Sets the error mode for command responses. This allows you to simulate various server errors.
@@ -58,25 +61,48 @@ public:
     /// @brief Used to represent a single test case for download testing.
     struct FileTestCase {
         const char* filename;               ///< Filename to download
-        uint8_t     length;                 ///< Length of file in bytes
+        uint32_t    length;                 ///< Length of file in bytes
 		int			packetCount;			///< Number of packets required for data
         bool        exactFit;				///< true: last packet is exact fit, false: last packet is partially filled
     };
     
     /// @brief The numbers of test cases in the rgFileTestCases array.
-    static const size_t cFileTestCases = 3;
+    static const size_t cFileTestCases = 4;
     
     /// @brief The set of files supported by the mock server for testing purposes. Each one represents a different edge case for testing.
     static const FileTestCase rgFileTestCases[cFileTestCases];
     
     void enableRandromDrops(bool enable) { _randomDropsEnabled = enable; }
 
+    /// @brief Holds back responses to Read and Write commands until count of them are waiting, then sends them newest
+    /// first. A Write shorter than a full packet, the last one of a file, releases whatever is held. Only useful for
+    /// windowed requests, a sequential Read download stalls if count is more than 1.
+    void holdResponses(int count) { _holdResponseCount = count; }
+
+    /// @brief The packets at these indices into the file are not sent on the next burst download
+    void dropBurstPackets(const QSet<int>& packetIndices) { _dropBurstPackets = packetIndices; }
+
+    /// @brief The response to the next Write at this offset is not sent
+    void dropWriteResponse(uint32_t offset) { _dropWriteResponseOffsets.insert(offset); }
+
+    /// @return Contents of the file uploaded with Create/Write commands
+    QByteArray uploadedFile(void) const { return _uploadedFile; }
+
+    /// @return Sequence numbers of the Write commands received for each offset, in order received
+    QMap<uint32_t, QList<uint16_t>> writeSeqNumbers(void) const { return _writeSeqNumbers; }
+
+    /// @return Offsets of the Read commands received, in order received
+    QList<uint32_t> readOffsets(void) const { return _readOffsets; }
+
 signals:
     /// You can connect to this signal to be notified when the server receives a Terminate command.
     void terminateCommandReceived(void);
     
     /// You can connect to this signal to be notified when the server receives a Reset command.
     void resetCommandReceived(void);
+
+    /// You can connect to this signal to be notified when the server receives an Open command.
+    void openCommandReceived(void);
     
 private:
 	void _sendAck(uint8_t targetSystemId, uint8_t targetComponentId, uint16_t seqNumber, FileManager::Opcode reqOpcode);
@@ -88,6 +114,11 @@ private:
 	void _streamCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
     void _terminateCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
     void _resetCommand(uint8_t senderSystemId, uint8_t senderComponentId, uint16_t seqNumber);
+    void _calcCRC32Command(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
+    void _createCommand(uint8_t senderSystemId, uint8_t senderComponentId, uint16_t seqNumber);
+    void _writeCommand(uint8_t senderSystemId, uint8_t senderComponentId, FileManager::Request* request, uint16_t seqNumber);
+    void _sendWindowedResponse(uint8_t targetSystemId, uint8_t targetComponentId, FileManager::Request* request, uint16_t seqNumber, bool release);
+    const FileTestCase* _findFileTestCase(FileManager::Request* request);
     uint16_t _nextSeqNumber(uint16_t seqNumber);
     
     /// if request is a string, this ensures it's null-terminated
@@ -96,7 +127,7 @@ private:
     QStringList _fileList;  ///< List of files returned by List command
     
     static const uint8_t    _sessionId;
-    uint8_t                 _readFileLength;    ///< Length of active file being read
+    uint32_t                _readFileLength;    ///< Length of active file being read
     ErrorMode_t             _errMode;           ///< Currently set error mode, as specified by setErrorMode
     const uint8_t           _systemIdServer;    ///< System ID for server
     const uint8_t           _componentIdServer; ///< Component ID for server
@@ -107,5 +138,21 @@ private:
     mavlink_message_t _lastReply;
 
     bool _randomDropsEnabled;
+
+    /// Response held back by holdResponses
+    typedef struct {
+        uint8_t                 targetSystemId;
+        uint8_t                 targetComponentId;
+        FileManager::Request    response;
+        uint16_t                seqNumber;
+    } HeldResponse_t;
+
+    int                             _holdResponseCount;
+    QList<HeldResponse_t>           _heldResponses;
+    QSet<int>                       _dropBurstPackets;
+    QSet<uint32_t>                  _dropWriteResponseOffsets;
+    QByteArray                      _uploadedFile;
+    QMap<uint32_t, QList<uint16_t>> _writeSeqNumbers;
+    QList<uint32_t>                 _readOffsets;
 };
 
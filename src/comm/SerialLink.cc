@@ -142,6 +142,10 @@ bool SerialLink::_connect(void)
         _emitLinkError(tr("Error connecting: Could not create port. %1").arg(errorString));
         return false;
     }
+
+    // Don't queue up more than the port can move, 8N1 is 10 bits on the wire per byte
+    _sendQueue->setRateLimit(getConnectionSpeed() / 10);
+
     return true;
 }
 
@@ -0,0 +1,208 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TelemetryLogWriter.h"
+#include "QGCLoggingCategory.h"
+
+#include <QFile>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+QGC_LOGGING_CATEGORY(TelemetryLogWriterLog, "TelemetryLogWriterLog")
+
+TelemetryLogWriter::TelemetryLogWriter(int bufferSize, int fsyncIntervalMSecs)
+    : _file                 (nullptr)
+    , _mask                 (0)
+    , _fsyncIntervalMSecs   (fsyncIntervalMSecs)
+    , _writing              (false)
+    , _head                 (0)
+    , _tail                 (0)
+    , _stopRequested        (false)
+    , _droppedRecords       (0)
+    , _bytesWritten         (0)
+    , _syncCount            (0)
+{
+    // Power of two size lets the free running positions wrap with a simple mask
+    quint32 size = static_cast<quint32>(_writeBlockSize);
+    while (size < static_cast<quint32>(bufferSize)) {
+        size <<= 1;
+    }
+    _buffer.resize(static_cast<int>(size));
+    _mask = size - 1;
+}
+
+TelemetryLogWriter::~TelemetryLogWriter()
+{
+    stopWriting();
+}
+
+void TelemetryLogWriter::startWriting(QFile* file)
+{
+    if (_writing) {
+        qWarning() << "TelemetryLogWriter::startWriting called while already writing";
+        return;
+    }
+
+    _file = file;
+    _head.storeRelease(0);
+    _tail.storeRelease(0);
+    _stopRequested.storeRelease(false);
+    _droppedRecords.storeRelease(0);
+    _bytesWritten.storeRelease(0);
+    _syncCount.storeRelease(0);
+    _writing = true;
+
+    start();
+}
+
+void TelemetryLogWriter::stopWriting(void)
+{
+    if (!_writing) {
+        return;
+    }
+
+    _stopRequested.storeRelease(true);
+    _wakeMutex.lock();
+    _wakeCondition.wakeAll();
+    _wakeMutex.unlock();
+    wait();
+
+    _writing = false;
+    _file = nullptr;
+
+    if (_droppedRecords.load()) {
+        qCWarning(TelemetryLogWriterLog) << "Telemetry log dropped" << _droppedRecords.load() << "records due to slow storage";
+    }
+}
+
+bool TelemetryLogWriter::writeRecord(quint64 timestampUsecs, const char* data, int length)
+{
+    const quint32 recordLength = static_cast<quint32>(sizeof(quint64) + length);
+    const quint32 capacity = _mask + 1;
+
+    if (!_writing || _stopRequested.loadAcquire()) {
+        return false;
+    }
+
+    // Only this thread moves _head, so only the consumer can change free space underneath us and it can only grow
+    const quint32 head = _head.loadAcquire();
+    const quint32 used = head - _tail.loadAcquire();
+    if (capacity - used < recordLength) {
+        _droppedRecords.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    uchar timestamp[sizeof(quint64)];
+    qToBigEndian(timestampUsecs, timestamp);
+
+    char* buffer = _buffer.data();
+    quint32 position = head;
+    auto copyIn = [&](const char* src, quint32 count) {
+        quint32 offset = position & _mask;
+        quint32 firstPart = qMin(count, capacity - offset);
+        memcpy(buffer + offset, src, firstPart);
+        if (firstPart < count) {
+            memcpy(buffer, src + firstPart, count - firstPart);
+        }
+        position += count;
+    };
+    copyIn(reinterpret_cast<const char*>(timestamp), sizeof(timestamp));
+    copyIn(data, static_cast<quint32>(length));
+
+    _head.storeRelease(position);
+
+    // Only wake the writer for full blocks, otherwise it picks the data up on its own timeout
+    if (used < _writeBlockSize && used + recordLength >= _writeBlockSize) {
+        _wakeCondition.wakeOne();
+    }
+
+    return true;
+}
+
+void TelemetryLogWriter::run(void)
+{
+    QElapsedTimer syncTimer;
+    syncTimer.start();
+
+    while (true) {
+        bool stopping = _stopRequested.loadAcquire();
+
+        if (_used() < _writeBlockSize && !stopping) {
+            _wakeMutex.lock();
+            _wakeCondition.wait(&_wakeMutex, _maxWaitMSecs);
+            _wakeMutex.unlock();
+            stopping = _stopRequested.loadAcquire();
+        }
+
+        if (!_writeBuffered()) {
+            break;
+        }
+
+        if (_fsyncIntervalMSecs > 0 && syncTimer.elapsed() >= _fsyncIntervalMSecs) {
+            _sync();
+            syncTimer.restart();
+        }
+
+        if (stopping && _used() == 0) {
+            break;
+        }
+    }
+
+    _sync();
+}
+
+/// Writes everything currently in the ring buffer to the file
+///     @return false: file write failed
+bool TelemetryLogWriter::_writeBuffered(void)
+{
+    const quint32 capacity = _mask + 1;
+    quint32 tail = _tail.loadAcquire();
+    quint32 used = _head.loadAcquire() - tail;
+
+    while (used) {
+        // At most two contiguous blocks when the data wraps
+        quint32 offset = tail & _mask;
+        quint32 count = qMin(used, capacity - offset);
+        qint64 written = _file->write(_buffer.constData() + offset, count);
+        if (written != static_cast<qint64>(count)) {
+            QString errorString = _file->errorString();
+            qCWarning(TelemetryLogWriterLog) << "Telemetry log write failed" << errorString;
+            // Release the buffer so the producer sees the failure as dropped records rather than stale data
+            _tail.storeRelease(_head.loadAcquire());
+            _stopRequested.storeRelease(true);
+            emit writeError(errorString);
+            return false;
+        }
+        tail += count;
+        used -= count;
+        _tail.storeRelease(tail);
+        _bytesWritten.fetchAndAddRelaxed(static_cast<quint64>(count));
+    }
+
+    return true;
+}
+
+void TelemetryLogWriter::_sync(void)
+{
+    if (!_file->flush()) {
+        return;
+    }
+#ifdef Q_OS_WIN
+    _commit(_file->handle());
+#else
+    fsync(_file->handle());
+#endif
+    _syncCount.fetchAndAddRelaxed(1);
+}
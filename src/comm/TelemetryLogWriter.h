@@ -0,0 +1,93 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QLoggingCategory>
+
+class QFile;
+
+Q_DECLARE_LOGGING_CATEGORY(TelemetryLogWriterLog)
+
+/// Writes telemetry log (.tlog) records to disk from its own thread.
+///
+/// Records are a big endian uint64 UTC timestamp in microseconds followed by the raw mavlink packet, the same
+/// format LogReplayLink reads. Producers append records to a single producer/single consumer ring buffer
+/// without locking. The writer thread drains the buffer in large blocks and syncs the file to storage at a
+/// configurable interval. If storage stalls long enough for the buffer to fill, new records are counted as
+/// dropped instead of blocking the producer.
+class TelemetryLogWriter : public QThread
+{
+    Q_OBJECT
+
+public:
+    /// @param bufferSize           Ring buffer size in bytes, rounded up to a power of two
+    /// @param fsyncIntervalMSecs   Interval between syncs of the file to storage, 0 to only sync on stop
+    TelemetryLogWriter(int bufferSize = _defaultBufferSize, int fsyncIntervalMSecs = _defaultFsyncIntervalMSecs);
+    ~TelemetryLogWriter();
+
+    /// Starts the writer thread on an already opened file. The file must not be accessed until stopWriting returns.
+    void startWriting(QFile* file);
+
+    /// Writes any buffered records, syncs the file and stops the writer thread
+    void stopWriting(void);
+
+    /// Appends a single timestamp/packet record. Only a single thread may call this method.
+    ///     @return false: Record dropped since the ring buffer is full or the writer is not running
+    bool writeRecord(quint64 timestampUsecs, const char* data, int length);
+
+    /// Changes the sync interval. Must only be called while not writing.
+    void setFsyncInterval(int fsyncIntervalMSecs) { _fsyncIntervalMSecs = fsyncIntervalMSecs; }
+    int  fsyncInterval   (void) const { return _fsyncIntervalMSecs; }
+
+    bool    isWriting       (void) const { return _writing; }
+    quint64 droppedRecords  (void) const { return _droppedRecords.load(); }
+    quint64 bytesWritten    (void) const { return _bytesWritten.load(); }
+    quint32 syncCount       (void) const { return _syncCount.load(); }     ///< Syncs to storage since writing started
+
+    static const int _defaultBufferSize         = 4 * 1024 * 1024;
+    static const int _defaultFsyncIntervalMSecs = 2000;
+
+signals:
+    /// Signalled from the writer thread when the file can no longer be written to
+    void writeError(QString errorString);
+
+protected:
+    // Override from QThread
+    void run(void) final;
+
+private:
+    quint32 _used           (void) const { return _head.loadAcquire() - _tail.loadAcquire(); }
+    bool    _writeBuffered  (void);
+    void    _sync           (void);
+
+    QFile*                  _file;
+    QByteArray              _buffer;
+    quint32                 _mask;
+    int                     _fsyncIntervalMSecs;
+    bool                    _writing;
+
+    QAtomicInteger<quint32> _head;              ///< Free running producer position
+    QAtomicInteger<quint32> _tail;              ///< Free running consumer position
+    QAtomicInteger<bool>    _stopRequested;
+    QAtomicInteger<quint64> _droppedRecords;
+    QAtomicInteger<quint64> _bytesWritten;
+    QAtomicInteger<quint32> _syncCount;
+
+    QMutex                  _wakeMutex;
+    QWaitCondition          _wakeCondition;
+
+    static const quint32    _writeBlockSize     = 64 * 1024;    ///< Producer wakes the writer once this much is buffered
+    static const int        _maxWaitMSecs       = 250;          ///< Longest time a record sits in the buffer
+};
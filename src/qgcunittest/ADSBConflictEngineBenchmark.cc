@@ -0,0 +1,33 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBConflictEngineBenchmark.h"
+#include "ADSBConflictEngineTest.h"
+#include "ADSBTrafficGenerator.h"
+
+void ADSBConflictEngineBenchmark::_findConflicts_benchmark_data(void)
+{
+    QTest::addColumn<int>("targetCount");
+    QTest::newRow("100 targets")    << 100;
+    QTest::newRow("500 targets")    << 500;
+    QTest::newRow("2000 targets")   << 2000;
+}
+
+void ADSBConflictEngineBenchmark::_findConflicts_benchmark(void)
+{
+    QFETCH(int, targetCount);
+
+    ADSBTrafficGenerator                    generator(ADSBConflictEngineTest::center, 250000, targetCount);
+    QVector<ADSBConflictEngine::Track_t>    targets     = generator.tracks();
+    QVector<ADSBConflictEngine::Track_t>    vehicles    = ADSBConflictEngineTest::createVehicles(targets, 50);
+
+    QBENCHMARK {
+        ADSBConflictEngine::findConflicts(targets, vehicles, ADSBConflictEngine::defaultThresholds());
+    }
+}
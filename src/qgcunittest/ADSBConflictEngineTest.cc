@@ -0,0 +1,178 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBConflictEngineTest.h"
+#include "ADSBTrafficGenerator.h"
+#include "ADSBVehicleManager.h"
+
+#include <QtMath>
+
+const QGeoCoordinate ADSBConflictEngineTest::center(47.45, 8.56);
+
+ADSBConflictEngine::Track_t ADSBConflictEngineTest::_track(uint32_t id, const QGeoCoordinate& coordinate, double altitude, double heading, double velocity)
+{
+    return { id, coordinate.latitude(), coordinate.longitude(), altitude, heading, velocity, 0 };
+}
+
+QVector<ADSBConflictEngine::Track_t> ADSBConflictEngineTest::createVehicles(const QVector<ADSBConflictEngine::Track_t>& targets, int count)
+{
+    QVector<ADSBConflictEngine::Track_t> vehicles;
+
+    for (int i = 0; i < count; i++) {
+        if (i % 3 == 0 && i < targets.count()) {
+            // Hovering half a km ahead of a target at its altitude
+            const ADSBConflictEngine::Track_t& target = targets[i];
+            QGeoCoordinate coordinate = QGeoCoordinate(target.latitude, target.longitude).atDistanceAndAzimuth(500, target.heading);
+            vehicles.append(_track(static_cast<uint32_t>(i + 1), coordinate, target.altitude, 0, 0));
+        } else {
+            QGeoCoordinate coordinate = center.atDistanceAndAzimuth(1000.0 * i, (360.0 * i) / count);
+            vehicles.append(_track(static_cast<uint32_t>(i + 1), coordinate, 50.0 + (20 * i), (45.0 * i), 15));
+        }
+    }
+
+    return vehicles;
+}
+
+QSet<QPair<int, uint32_t>> ADSBConflictEngineTest::_bruteForceConflicts(const QVector<ADSBConflictEngine::Track_t>& targets, const QVector<ADSBConflictEngine::Track_t>& vehicles)
+{
+    QSet<QPair<int, uint32_t>> conflicts;
+
+    for (const ADSBConflictEngine::Track_t& vehicle: vehicles) {
+        for (const ADSBConflictEngine::Track_t& target: targets) {
+            ADSBConflictEngine::Conflict_t conflict;
+            if (ADSBConflictEngine::closestApproach(target, vehicle, ADSBConflictEngine::defaultThresholds(), conflict)) {
+                conflicts.insert(qMakePair(conflict.vehicleId, conflict.icaoAddress));
+            }
+        }
+    }
+
+    return conflicts;
+}
+
+void ADSBConflictEngineTest::_closestApproach_test(void)
+{
+    ADSBConflictEngine::Thresholds_t    thresholds  = ADSBConflictEngine::defaultThresholds();
+    ADSBConflictEngine::Track_t         vehicle     = _track(1, center, 100, 0, 0);
+    ADSBConflictEngine::Conflict_t      conflict;
+
+    // Head on from 5km north at 100m/s
+    QGeoCoordinate north = center.atDistanceAndAzimuth(5000, 0);
+    QVERIFY(ADSBConflictEngine::closestApproach(_track(0xABCDEF, north, 100, 180, 100), vehicle, thresholds, conflict));
+    QCOMPARE(conflict.icaoAddress, static_cast<uint32_t>(0xABCDEF));
+    QCOMPARE(conflict.vehicleId, 1);
+    QVERIFY(qAbs(conflict.timeToClosest - 50) < 1);
+    QVERIFY(conflict.closestDistance < 50);
+    QVERIFY(qAbs(conflict.altitudeDifference) < 1);
+
+    // Same track with vertical separation
+    QVERIFY(!ADSBConflictEngine::closestApproach(_track(0xABCDEF, north, 1000, 180, 100), vehicle, thresholds, conflict));
+
+    // Flying away
+    QVERIFY(!ADSBConflictEngine::closestApproach(_track(0xABCDEF, north, 100, 0, 100), vehicle, thresholds, conflict));
+
+    // Too far away to get there within the lookahead
+    QGeoCoordinate farNorth = center.atDistanceAndAzimuth(20000, 0);
+    QVERIFY(!ADSBConflictEngine::closestApproach(_track(0xABCDEF, farNorth, 100, 180, 100), vehicle, thresholds, conflict));
+
+    // Passing abeam 2km to the east
+    QGeoCoordinate northEast = north.atDistanceAndAzimuth(2000, 90);
+    QVERIFY(!ADSBConflictEngine::closestApproach(_track(0xABCDEF, northEast, 100, 180, 100), vehicle, thresholds, conflict));
+
+    // Unknown altitude can't be ruled out
+    QVERIFY(ADSBConflictEngine::closestApproach(_track(0xABCDEF, north, qQNaN(), 180, 100), vehicle, thresholds, conflict));
+    QVERIFY(qIsNaN(conflict.altitudeDifference));
+
+    // Across the antimeridian
+    ADSBConflictEngine::Track_t eastOfDateLine  = _track(2, QGeoCoordinate(0, 179.997), 100, 0, 0);
+    ADSBConflictEngine::Track_t westOfDateLine  = _track(0x123456, QGeoCoordinate(0, -179.997), 100, 0, 0);
+    QVERIFY(ADSBConflictEngine::closestApproach(westOfDateLine, eastOfDateLine, thresholds, conflict));
+    QVERIFY(qAbs(conflict.closestDistance - 668) < 5);
+}
+
+void ADSBConflictEngineTest::_findConflicts_test(void)
+{
+    ADSBTrafficGenerator generator(center, 150000, 500);
+
+    for (int i = 0; i < 5; i++) {
+        QVector<ADSBConflictEngine::Track_t> targets    = generator.tracks();
+        QVector<ADSBConflictEngine::Track_t> vehicles   = createVehicles(targets, 30);
+        QSet<QPair<int, uint32_t>>           expected   = _bruteForceConflicts(targets, vehicles);
+
+        int pairsChecked;
+        QSet<QPair<int, uint32_t>> found;
+        for (const ADSBConflictEngine::Conflict_t& conflict: ADSBConflictEngine::findConflicts(targets, vehicles, ADSBConflictEngine::defaultThresholds(), &pairsChecked)) {
+            found.insert(qMakePair(conflict.vehicleId, conflict.icaoAddress));
+        }
+
+        QVERIFY(expected.count() >= 10);
+        QCOMPARE(found, expected);
+        // The grid must rule out nearly every pair
+        QVERIFY(pairsChecked < (targets.count() * vehicles.count()) / 10);
+
+        generator.step(10);
+    }
+}
+
+void ADSBConflictEngineTest::_findConflictsHeavyTraffic_test(void)
+{
+    // Thousands of targets around a hub airport against a fleet of vehicles
+    ADSBTrafficGenerator generator(center, 250000, 2000);
+
+    for (int i = 0; i < 3; i++) {
+        QVector<ADSBConflictEngine::Track_t> targets    = generator.tracks();
+        QVector<ADSBConflictEngine::Track_t> vehicles   = createVehicles(targets, 50);
+        QSet<QPair<int, uint32_t>>           expected   = _bruteForceConflicts(targets, vehicles);
+
+        QSet<QPair<int, uint32_t>> found;
+        for (const ADSBConflictEngine::Conflict_t& conflict: ADSBConflictEngine::findConflicts(targets, vehicles, ADSBConflictEngine::defaultThresholds())) {
+            found.insert(qMakePair(conflict.vehicleId, conflict.icaoAddress));
+        }
+
+        QVERIFY(expected.count() > 0);
+        QCOMPARE(found, expected);
+
+        generator.step(1);
+    }
+}
+
+void ADSBConflictEngineTest::_parseSBS_test(void)
+{
+    ADSBTrafficGenerator                generator(center, 150000, 50);
+    QList<ADSBVehicle::VehicleInfo_t>   expected = generator.vehicleInfos();
+    QList<QByteArray>                   lines = generator.sbsMessages().split('\n');
+
+    lines.removeAll(QByteArray());
+    QCOMPARE(lines.count(), expected.count() * 2);
+
+    for (int i = 0; i < expected.count(); i++) {
+        ADSBVehicle::VehicleInfo_t position;
+        ADSBVehicle::VehicleInfo_t velocity;
+
+        QByteArray positionLine = lines[i * 2] + '\n';
+        QByteArray velocityLine = lines[(i * 2) + 1] + '\n';
+        QVERIFY(ADSBTCPLink::parseLine(positionLine.constData(), positionLine.length(), position));
+        QVERIFY(ADSBTCPLink::parseLine(velocityLine.constData(), velocityLine.length(), velocity));
+
+        QCOMPARE(position.icaoAddress, expected[i].icaoAddress);
+        QCOMPARE(position.callsign, expected[i].callsign);
+        QVERIFY(position.availableFlags & ADSBVehicle::LocationAvailable);
+        QVERIFY(position.location.distanceTo(expected[i].location) < 5);
+        QVERIFY(qAbs(position.altitude - expected[i].altitude) < 1);
+
+        QCOMPARE(velocity.icaoAddress, expected[i].icaoAddress);
+        QVERIFY(velocity.availableFlags & ADSBVehicle::VelocityAvailable);
+        QVERIFY(qAbs(velocity.heading - expected[i].heading) <= 0.5);
+        QVERIFY(qAbs(velocity.velocity - expected[i].velocity) < 1);
+        QVERIFY(qAbs(velocity.verticalVelocity - expected[i].verticalVelocity) < 0.01);
+    }
+
+    ADSBVehicle::VehicleInfo_t vehicleInfo;
+    QVERIFY(!ADSBTCPLink::parseLine("MSG,3,1,1,", 10, vehicleInfo));
+    QVERIFY(!ADSBTCPLink::parseLine("STA,,5,179,400AE7", 18, vehicleInfo));
+}
@@ -0,0 +1,40 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "ADSBConflictEngine.h"
+
+#include <QGeoCoordinate>
+#include <QSet>
+
+/// Unit test for ADSB conflict prediction, using synthetic traffic
+class ADSBConflictEngineTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    static const QGeoCoordinate center;    ///< Busy airspace around a hub airport
+
+    /// Our vehicles spread around the center, with some placed right in the path of targets so there are conflicts
+    static QVector<ADSBConflictEngine::Track_t> createVehicles(const QVector<ADSBConflictEngine::Track_t>& targets, int count);
+
+private slots:
+    void _closestApproach_test              (void);
+    void _findConflicts_test                (void);
+    void _findConflictsHeavyTraffic_test    (void);
+    void _parseSBS_test                     (void);
+
+private:
+    static ADSBConflictEngine::Track_t _track(uint32_t id, const QGeoCoordinate& coordinate, double altitude, double heading, double velocity);
+
+    /// Every pair checked without pruning, as (vehicle id, ICAO address)
+    QSet<QPair<int, uint32_t>> _bruteForceConflicts(const QVector<ADSBConflictEngine::Track_t>& targets, const QVector<ADSBConflictEngine::Track_t>& vehicles);
+};
@@ -0,0 +1,168 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "ADSBVehicleManagerTest.h"
+#include "ADSBVehicleManager.h"
+#include "QGCApplication.h"
+
+#include <algorithm>
+
+QList<uint32_t> ADSBVehicleManagerTest::_query(const ADSBSpatialIndex& index, const QGeoCoordinate& coordinate, double radiusMeters)
+{
+    QList<uint32_t> result = index.query(coordinate, radiusMeters);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void ADSBVehicleManagerTest::_spatialIndexAntimeridian_test(void)
+{
+    ADSBSpatialIndex index;
+
+    // 1 and 2 are about 2km apart across the antimeridian, 3 is 50km west of it
+    index.insert(1, QGeoCoordinate(10, 179.99));
+    index.insert(2, QGeoCoordinate(10, -179.99));
+    index.insert(3, QGeoCoordinate(10, 179.5));
+
+    QCOMPARE(_query(index, QGeoCoordinate(10, 179.995), 5000), QList<uint32_t>({ 1, 2 }));
+    QCOMPARE(_query(index, QGeoCoordinate(10, -179.995), 5000), QList<uint32_t>({ 1, 2 }));
+    QCOMPARE(_query(index, QGeoCoordinate(10, 180), 100000), QList<uint32_t>({ 1, 2, 3 }));
+
+    // Moving across the antimeridian changes cells
+    index.insert(3, QGeoCoordinate(10, -179.98));
+    QCOMPARE(index.count(), 3);
+    QCOMPARE(_query(index, QGeoCoordinate(10, -179.98), 100), QList<uint32_t>({ 3 }));
+    QCOMPARE(_query(index, QGeoCoordinate(10, 179.5), 5000), QList<uint32_t>());
+
+    index.remove(2);
+    QCOMPARE(_query(index, QGeoCoordinate(10, 179.995), 5000), QList<uint32_t>({ 1, 3 }));
+}
+
+void ADSBVehicleManagerTest::_spatialIndexPolar_test(void)
+{
+    ADSBSpatialIndex index;
+
+    // Spread around the north pole, 5.6km from it. 4 is a degree further south.
+    index.insert(1, QGeoCoordinate(89.95, 0));
+    index.insert(2, QGeoCoordinate(89.95, 90));
+    index.insert(3, QGeoCoordinate(89.95, 180));
+    index.insert(4, QGeoCoordinate(88.95, 0));
+    index.insert(5, QGeoCoordinate(-89.95, -170));
+
+    // Every longitude cell has to be covered near the pole, on both sides of it
+    QCOMPARE(_query(index, QGeoCoordinate(90, 0), 6000), QList<uint32_t>({ 1, 2, 3 }));
+    QCOMPARE(_query(index, QGeoCoordinate(89.99, 45), 10000), QList<uint32_t>({ 1, 2, 3 }));
+    QCOMPARE(_query(index, QGeoCoordinate(89.99, -135), 10000), QList<uint32_t>({ 1, 2, 3 }));
+    QCOMPARE(_query(index, QGeoCoordinate(89.5, 0), 200000), QList<uint32_t>({ 1, 2, 3, 4 }));
+
+    QCOMPARE(_query(index, QGeoCoordinate(-90, 0), 6000), QList<uint32_t>({ 5 }));
+    QCOMPARE(_query(index, QGeoCoordinate(-89.99, 10), 10000), QList<uint32_t>({ 5 }));
+}
+
+void ADSBVehicleManagerTest::_coalesceUpdates_test(void)
+{
+    // Without a toolbox there are no timers, the test flushes by hand
+    ADSBVehicleManager manager(qgcApp(), nullptr);
+
+    QGeoCoordinate firstLocation(47.0, 8.0);
+    QGeoCoordinate secondLocation(47.1, 8.1);
+
+    ADSBVehicle::VehicleInfo_t vehicleInfo;
+    vehicleInfo.icaoAddress     = 0xABCDEF;
+    vehicleInfo.location        = firstLocation;
+    vehicleInfo.altitude        = 100;
+    vehicleInfo.availableFlags  = ADSBVehicle::LocationAvailable | ADSBVehicle::AltitudeAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+
+    vehicleInfo.callsign        = QStringLiteral("QGC123");
+    vehicleInfo.altitude        = qQNaN();
+    vehicleInfo.availableFlags  = ADSBVehicle::CallsignAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+
+    vehicleInfo.location        = secondLocation;
+    vehicleInfo.availableFlags  = ADSBVehicle::LocationAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+
+    // Never had a location, so it can't be shown
+    ADSBVehicle::VehicleInfo_t callsignOnly;
+    callsignOnly.icaoAddress    = 0x123456;
+    callsignOnly.callsign       = QStringLiteral("NOPOS");
+    callsignOnly.availableFlags = ADSBVehicle::CallsignAvailable;
+    manager.adsbVehicleUpdate(callsignOnly);
+
+    QCOMPARE(manager._pendingUpdates.count(), 2);
+    QCOMPARE(manager.adsbVehicles()->count(), 0);
+
+    manager._flushPendingUpdates();
+    QCOMPARE(manager._pendingUpdates.count(), 0);
+    QCOMPARE(manager.adsbVehicles()->count(), 1);
+
+    // Newest value for each piece of information, older ones kept where later updates didn't carry them
+    ADSBVehicle* adsbVehicle = manager.adsbVehicles()->value<ADSBVehicle*>(0);
+    QCOMPARE(adsbVehicle->icaoAddress(), 0xABCDEF);
+    QCOMPARE(adsbVehicle->coordinate(), secondLocation);
+    QCOMPARE(adsbVehicle->altitude(), 100.0);
+    QCOMPARE(adsbVehicle->callsign(), QStringLiteral("QGC123"));
+
+    // Only the latest location is indexed
+    QCOMPARE(manager.vehiclesNear(secondLocation, 100).count(), 1);
+    QCOMPARE(manager.vehiclesNear(firstLocation, 100).count(), 0);
+
+    // Updates to a known target are coalesced the same way
+    vehicleInfo.location        = firstLocation;
+    vehicleInfo.availableFlags  = ADSBVehicle::LocationAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+    vehicleInfo.altitude        = 200;
+    vehicleInfo.availableFlags  = ADSBVehicle::AltitudeAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+    QCOMPARE(manager._pendingUpdates.count(), 1);
+
+    manager._flushPendingUpdates();
+    QCOMPARE(manager.adsbVehicles()->count(), 1);
+    QCOMPARE(adsbVehicle->coordinate(), firstLocation);
+    QCOMPARE(adsbVehicle->altitude(), 200.0);
+    QCOMPARE(manager.vehiclesNear(firstLocation, 100).count(), 1);
+}
+
+void ADSBVehicleManagerTest::_alertSources_test(void)
+{
+    ADSBVehicleManager manager(qgcApp(), nullptr);
+
+    ADSBVehicle::VehicleInfo_t vehicleInfo;
+    vehicleInfo.icaoAddress     = 0xABCDEF;
+    vehicleInfo.location        = QGeoCoordinate(47.0, 8.0);
+    vehicleInfo.alert           = true;
+    vehicleInfo.availableFlags  = ADSBVehicle::LocationAvailable | ADSBVehicle::AlertAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+    manager._flushPendingUpdates();
+
+    ADSBVehicle* adsbVehicle = manager.adsbVehicles()->value<ADSBVehicle*>(0);
+    QVERIFY(adsbVehicle->alert());
+
+    // No predicted conflicts must not clear the alert from the source
+    manager._applyConflicts(QList<ADSBConflictEngine::Conflict_t>());
+    QVERIFY(adsbVehicle->alert());
+
+    ADSBConflictEngine::Conflict_t conflict;
+    conflict.vehicleId          = 1;
+    conflict.icaoAddress        = 0xABCDEF;
+    conflict.timeToClosest      = 30;
+    conflict.closestDistance    = 100;
+    conflict.altitudeDifference = 0;
+    manager._applyConflicts({ conflict });
+
+    // The source clearing its alert leaves the predicted one
+    vehicleInfo.alert           = false;
+    vehicleInfo.availableFlags  = ADSBVehicle::AlertAvailable;
+    manager.adsbVehicleUpdate(vehicleInfo);
+    manager._flushPendingUpdates();
+    QVERIFY(adsbVehicle->alert());
+
+    manager._applyConflicts(QList<ADSBConflictEngine::Conflict_t>());
+    QVERIFY(!adsbVehicle->alert());
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "ADSBSpatialIndex.h"
+
+/// Unit test for the ADSB target spatial index and per target update coalescing
+class ADSBVehicleManagerTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _spatialIndexAntimeridian_test (void);
+    void _spatialIndexPolar_test        (void);
+    void _coalesceUpdates_test          (void);
+    void _alertSources_test             (void);
+
+private:
+    /// Sorted so results can be compared regardless of cell visit order
+    QList<uint32_t> _query(const ADSBSpatialIndex& index, const QGeoCoordinate& coordinate, double radiusMeters);
+};
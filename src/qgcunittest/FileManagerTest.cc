@@ -16,6 +16,8 @@
 #include "UAS.h"
 #include "QGCApplication.h"
 
+#include <QTemporaryDir>
+
 FileManagerTest::FileManagerTest(void)
     : _fileServer(NULL)
     , _fileManager(NULL)
@@ -36,6 +38,7 @@ void FileManagerTest::init(void)
     
     _fileManager = qgcApp()->toolbox()->multiVehicleManager()->activeVehicle()->uas()->getFileManager();
     QVERIFY(_fileManager != NULL);
+    _fileManager->_ackTimerTimeoutMsecs = _fileManagerAckTimeoutMsecs;
     
     Q_ASSERT(_multiSpy == NULL);
     
@@ -60,8 +63,6 @@ void FileManagerTest::cleanup(void)
     Q_ASSERT(_multiSpy);
     Q_ASSERT(_fileManager);
     
-    // Disconnecting the link will prompt for log file save
-    setExpectedFileDialog(getSaveFileName, QStringList());
     _disconnectMockLink();
 
     _fileServer = NULL;
@@ -199,6 +200,200 @@ void FileManagerTest::_listTest(void)
     _fileServer->enableRandromDrops(false);
 }
 
+void FileManagerTest::_crc32Test(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+
+    // Counting Open commands tells whether the file was downloaded. The Open is always handled before the
+    // FileManager hears back, so the count is settled by the time commandComplete is signalled.
+    QSignalSpy openSpy(_fileServer, SIGNAL(openCommandReceived()));
+
+    const MockLinkFileServer::FileTestCase* testCase = &MockLinkFileServer::rgFileTestCases[2];
+    QTemporaryDir downloadDir;
+    QString filePath = QDir(downloadDir.path()).absoluteFilePath(testCase->filename);
+
+    // No local copy, the file is downloaded without asking for a checksum
+    _fileManager->downloadPath(testCase->filename, QDir(downloadDir.path()));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QCOMPARE(openSpy.count(), 1);
+    _validateFileContents(filePath, testCase->length);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+    _multiSpy->clearAllSignals();
+    openSpy.clear();
+
+    // Local copy matches, the download is skipped
+    _fileManager->downloadPath(testCase->filename, QDir(downloadDir.path()));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QCOMPARE(openSpy.count(), 0);
+    _multiSpy->clearAllSignals();
+
+    // Local copy differs, the file is downloaded again
+    {
+        QFile file(filePath);
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.seek(1));
+        QCOMPARE(file.write("\xFF", 1), 1LL);
+    }
+    _fileManager->downloadPath(testCase->filename, QDir(downloadDir.path()));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QCOMPARE(openSpy.count(), 1);
+    _validateFileContents(filePath, testCase->length);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+    _multiSpy->clearAllSignals();
+    openSpy.clear();
+
+    // Server never answers the checksum request, the file is downloaded anyway
+    _fileServer->setErrorMode(MockLinkFileServer::errModeNoCRC32Response);
+    _fileManager->downloadPath(testCase->filename, QDir(downloadDir.path()));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs * 2));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QCOMPARE(openSpy.count(), 1);
+    _validateFileContents(filePath, testCase->length);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+    _multiSpy->clearAllSignals();
+    _fileServer->setErrorMode(MockLinkFileServer::errModeNone);
+}
+
+void FileManagerTest::_uploadTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+
+    // Full packets followed by a short one
+    const int cbPacket = sizeof(((FileManager::Request*)0)->data);
+    const int cPackets = 21;
+    QByteArray bytes = _uploadBytes((cPackets - 1) * cbPacket + 100);
+    QTemporaryDir uploadDir;
+    QString filePath = QDir(uploadDir.path()).absoluteFilePath("upload.bin");
+    QVERIFY(_writeUploadFile(filePath, bytes));
+
+    // The server holds write acks until a full window is waiting, then sends them back newest first. Anything less than
+    // a full window in flight stalls until the ack timeout, and the resend shows up as a second write to an offset.
+    _fileServer->holdResponses(FileManager::requestWindowSize);
+    _fileManager->uploadPath("/fs/microsd", QFileInfo(filePath));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+
+    QVERIFY(_fileServer->uploadedFile() == bytes);
+    QMap<uint32_t, QList<uint16_t>> writeSeqNumbers = _fileServer->writeSeqNumbers();
+    QCOMPARE(writeSeqNumbers.count(), cPackets);
+    for (int i=0; i<cPackets; i++) {
+        QCOMPARE(writeSeqNumbers[static_cast<uint32_t>(i * cbPacket)].count(), 1);
+    }
+    _multiSpy->clearAllSignals();
+}
+
+void FileManagerTest::_uploadTimeoutTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+
+    const int cbPacket = sizeof(((FileManager::Request*)0)->data);
+    const int cPackets = 13;
+    QByteArray bytes = _uploadBytes((cPackets - 1) * cbPacket + 100);
+    QTemporaryDir uploadDir;
+    QString filePath = QDir(uploadDir.path()).absoluteFilePath("upload.bin");
+    QVERIFY(_writeUploadFile(filePath, bytes));
+
+    // The writes with lost acks hold their place in the window while the rest of the file goes through, then time out
+    // and are sent again under new sequence numbers
+    const QList<uint32_t> lostOffsets = { 0, static_cast<uint32_t>(3 * cbPacket) };
+    for (uint32_t offset: lostOffsets) {
+        _fileServer->dropWriteResponse(offset);
+    }
+    _fileManager->uploadPath("/fs/microsd", QFileInfo(filePath));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+
+    QVERIFY(_fileServer->uploadedFile() == bytes);
+    QMap<uint32_t, QList<uint16_t>> writeSeqNumbers = _fileServer->writeSeqNumbers();
+    QCOMPARE(writeSeqNumbers.count(), cPackets);
+    for (int i=0; i<cPackets; i++) {
+        uint32_t offset = static_cast<uint32_t>(i * cbPacket);
+        const QList<uint16_t>& seqNumbers = writeSeqNumbers[offset];
+        if (lostOffsets.contains(offset)) {
+            QCOMPARE(seqNumbers.count(), 2);
+            QVERIFY(seqNumbers[1] != seqNumbers[0]);
+        } else {
+            QCOMPARE(seqNumbers.count(), 1);
+        }
+    }
+    _multiSpy->clearAllSignals();
+}
+
+void FileManagerTest::_burstMissingDataTest(void)
+{
+    Q_ASSERT(_fileManager);
+    Q_ASSERT(_multiSpy);
+    Q_ASSERT(_multiSpy->checkNoSignals() == true);
+
+    const MockLinkFileServer::FileTestCase* testCase = &MockLinkFileServer::rgFileTestCases[3];
+    const uint32_t cbPacket = sizeof(((FileManager::Request*)0)->data);
+    QTemporaryDir downloadDir;
+    QString filePath = QDir(downloadDir.path()).absoluteFilePath(testCase->filename);
+
+    // Leaves a two packet gap, two single packet gaps and the last packet missing, five reads to fill
+    _fileServer->dropBurstPackets({ 2, 3, 7, 12, testCase->packetCount - 1 });
+
+    // The server holds read responses until all five reads are waiting, which only happens if every gap is asked
+    // for in one pass. Responses come back newest first.
+    _fileServer->holdResponses(5);
+
+    _fileManager->streamPath(testCase->filename, QDir(downloadDir.path()));
+    QVERIFY(_multiSpy->waitForSignalByIndex(commandCompleteSignalIndex, _ackTimerTimeoutMsecs));
+    QCOMPARE(_multiSpy->checkOnlySignalByMask(commandCompleteSignalMask), true);
+    QTRY_VERIFY(!_fileManager->_ackTimer.isActive());   // Session Reset is acked before the next command can go
+
+    QList<uint32_t> expectedReadOffsets = { 2 * cbPacket, 3 * cbPacket, 7 * cbPacket, 12 * cbPacket, static_cast<uint32_t>(testCase->packetCount - 1) * cbPacket };
+    QCOMPARE(_fileServer->readOffsets(), expectedReadOffsets);
+    _validateFileContents(filePath, testCase->length);
+    _multiSpy->clearAllSignals();
+}
+
+/// @return File contents which don't repeat on packet boundaries, so data written at the wrong offset shows up
+QByteArray FileManagerTest::_uploadBytes(int length)
+{
+    QByteArray bytes(length, Qt::Uninitialized);
+    for (int i=0; i<length; i++) {
+        bytes[i] = static_cast<char>((i * 7 + i / 256) & 0xFF);
+    }
+    return bytes;
+}
+
+bool FileManagerTest::_writeUploadFile(const QString& filePath, const QByteArray& bytes)
+{
+    QFile file(filePath);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.length();
+}
+
+void FileManagerTest::_validateFileContents(const QString& filePath, uint32_t length)
+{
+	QFile file(filePath);
+	
+	// Make sure file size is correct
+	QCOMPARE(file.size(), (qint64)length);
+	
+	// Read data
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QByteArray bytes = file.readAll();
+	file.close();
+	
+	// Validate file contents:
+	//      Repeating 0x00, 0x01 .. 0xFF until file is full
+	for (int i=0; i<bytes.length(); i++) {
+		QCOMPARE((uint8_t)bytes[i], (uint8_t)(i & 0xFF));
+	}
+}
+
 #if 0
 // Trying to write test code for read and burst mode download as well as implement support in MockLineFileServer reached a point
 // of diminishing returns where the test code and mock server were generating more bugs in themselves than finding problems.
@@ -374,22 +569,4 @@ void FileManagerTest::_streamDownloadTest(void)
     }
 }
 
-void FileManagerTest::_validateFileContents(const QString& filePath, uint8_t length)
-{
-	QFile file(filePath);
-	
-	// Make sure file size is correct
-	QCOMPARE(file.size(), (qint64)length);
-	
-	// Read data
-	QVERIFY(file.open(QIODevice::ReadOnly));
-	QByteArray bytes = file.readAll();
-	file.close();
-	
-	// Validate file contents:
-	//      Repeating 0x00, 0x01 .. 0xFF until file is full
-	for (uint8_t i=0; i<bytes.length(); i++) {
-		QCOMPARE((uint8_t)bytes[i], (uint8_t)(i & 0xFF));
-	}
-}
 #endif
@@ -39,12 +39,19 @@ private slots:
     void _ackTest(void);
     void _noAckTest(void);
     void _listTest(void);
+    void _crc32Test(void);
+    void _uploadTest(void);
+    void _uploadTimeoutTest(void);
+    void _burstMissingDataTest(void);
 	
     // Connected to FileManager listEntry signal
     void listEntry(const QString& entry);
     
 private:
-    void _validateFileContents(const QString& filePath, uint8_t length);
+    void _validateFileContents(const QString& filePath, uint32_t length);
+
+    static QByteArray   _uploadBytes    (int length);
+    static bool         _writeUploadFile(const QString& filePath, const QByteArray& bytes);
 
     enum {
         listEntrySignalIndex = 0,
@@ -69,9 +76,12 @@ private:
     static const size_t _cSignals = maxSignalIndex;
     const char*         _rgSignals[_cSignals];
     
+    /// @brief Ack timeout the FileManager is set up with, shorter than normal so the timeout cases don't take minutes
+    static const int _fileManagerAckTimeoutMsecs = 100;
+
     /// @brief This is the amount of time to wait to allow the FileManager enough time to timeout waiting for an Ack.
     /// As such it must be larger than the Ack Timeout used by the FileManager.
-    static const int _ackTimerTimeoutMsecs = FileManager::ackTimerMaxRetries * FileManager::ackTimerTimeoutMsecs * 2;
+    static const int _ackTimerTimeoutMsecs = (FileManager::ackTimerMaxRetries + 1) * _fileManagerAckTimeoutMsecs * 2;
     
     QStringList _fileListReceived;
 };
@@ -0,0 +1,126 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "JoystickTest.h"
+#include "Joystick.h"
+#include "MultiVehicleManager.h"
+#include "MAVLinkProtocol.h"
+#include "LinkSendQueue.h"
+#include "QGCApplication.h"
+
+/// Joystick with no device behind it, only used to drive the MANUAL_CONTROL send path
+class JoystickTestJoystick : public Joystick
+{
+public:
+    JoystickTestJoystick(MultiVehicleManager* multiVehicleManager)
+        : Joystick(QStringLiteral("JoystickTest"), 4, 0, 0, multiVehicleManager)
+    {
+    }
+
+private:
+    bool _open      ()                  final { return true; }
+    void _close     ()                  final { }
+    bool _update    ()                  final { return true; }
+    bool _getButton (int)               final { return false; }
+    int  _getAxis   (int)               final { return 0; }
+    bool _getHat    (int, int)          final { return false; }
+};
+
+mavlink_message_t JoystickTest::_fillerMessage(void)
+{
+    mavlink_message_t   message;
+    mavlink_system_time_t systemTime;
+
+    memset(&message,    0, sizeof(message));
+    memset(&systemTime, 0, sizeof(systemTime));
+    memcpy(_MAV_PAYLOAD_NON_CONST(&message), &systemTime, MAVLINK_MSG_ID_SYSTEM_TIME_LEN);
+    message.msgid   = MAVLINK_MSG_ID_SYSTEM_TIME;
+    message.len     = MAVLINK_MSG_ID_SYSTEM_TIME_LEN;
+    message.sysid   = _fillerSystemId;
+    message.compid  = MAV_COMP_ID_MISSIONPLANNER;
+
+    return message;
+}
+
+QList<mavlink_message_t> JoystickTest::_parse(const QList<QByteArray>& writes, uint32_t msgid, uint8_t sysid)
+{
+    QList<mavlink_message_t>    messages;
+    mavlink_message_t           rxMessage;
+    mavlink_status_t            rxStatus;
+    mavlink_message_t           message;
+    mavlink_status_t            status;
+
+    // Parsed on a local status so the global channel status is left alone
+    memset(&rxMessage,  0, sizeof(rxMessage));
+    memset(&rxStatus,   0, sizeof(rxStatus));
+    for (const QByteArray& write: writes) {
+        for (char c: write) {
+            if (mavlink_frame_char_buffer(&rxMessage, &rxStatus, static_cast<uint8_t>(c), &message, &status) == MAVLINK_FRAMING_OK) {
+                if (message.msgid == msgid && message.sysid == sysid) {
+                    messages.append(message);
+                }
+            }
+        }
+    }
+
+    return messages;
+}
+
+void JoystickTest::_sendManualControl_test(void)
+{
+    _connectMockLink();
+
+    LinkInterface*  link    = _vehicle->priorityLink();
+    LinkSendQueue*  queue   = link->sendQueue();
+    uint8_t         gcsId   = static_cast<uint8_t>(qgcApp()->toolbox()->mavlinkProtocol()->getSystemId());
+    QList<QByteArray> writes;
+
+    // Written from the link thread, collected on this one
+    connect(queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    JoystickTestJoystick joystick(qgcApp()->toolbox()->multiVehicleManager());
+
+    // Nothing is sent without a link
+    QVERIFY(!joystick._sendManualControl(0, 0, 0, 0, 0));
+
+    joystick._setManualControlLink(_vehicle);
+    QVERIFY(joystick._manualControlLink.data() == link);
+
+    // Drain the rate limit bucket so normal traffic is held back, then only control traffic gets through
+    queue->setRateLimit(1);
+    const int fillerCount = 200;
+    for (int i=0; i<fillerCount; i++) {
+        QVERIFY(queue->enqueue(_fillerMessage(), LinkSendQueue::PriorityNormal));
+    }
+    QTRY_VERIFY(!_parse(writes, MAVLINK_MSG_ID_SYSTEM_TIME, _fillerSystemId).isEmpty());
+    QTest::qWait(100);
+    int fillersWritten = _parse(writes, MAVLINK_MSG_ID_SYSTEM_TIME, _fillerSystemId).count();
+    QVERIFY(fillersWritten < fillerCount);
+    QVERIFY(queue->queueDepth() > 0);
+
+    QVERIFY(joystick._sendManualControl(0.5f, -0.25f, 0.75f, 0.6f, 0x1234));
+    QTRY_COMPARE(_parse(writes, MAVLINK_MSG_ID_MANUAL_CONTROL, gcsId).count(), 1);
+
+    // Went ahead of the normal traffic still waiting
+    QCOMPARE(_parse(writes, MAVLINK_MSG_ID_SYSTEM_TIME, _fillerSystemId).count(), fillersWritten);
+
+    // Same scaling as UAS::setExternalControlSetpoint, pitch is negated
+    mavlink_message_t message = _parse(writes, MAVLINK_MSG_ID_MANUAL_CONTROL, gcsId).first();
+    mavlink_manual_control_t manualControl;
+    mavlink_msg_manual_control_decode(&message, &manualControl);
+    QCOMPARE(message.compid,                static_cast<uint8_t>(qgcApp()->toolbox()->mavlinkProtocol()->getComponentId()));
+    QCOMPARE(manualControl.target,          static_cast<uint8_t>(_vehicle->id()));
+    QCOMPARE(manualControl.x,               static_cast<int16_t>(250));
+    QCOMPARE(manualControl.y,               static_cast<int16_t>(500));
+    QCOMPARE(manualControl.z,               static_cast<int16_t>(600));
+    QCOMPARE(manualControl.r,               static_cast<int16_t>(750));
+    QCOMPARE(manualControl.buttons,         static_cast<uint16_t>(0x1234));
+
+    queue->setRateLimit(0);
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "QGCMAVLink.h"
+
+/// Unit test for Joystick sending MANUAL_CONTROL straight to the priority link's send queue
+class JoystickTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _sendManualControl_test(void);
+
+private:
+    /// Filler traffic, from a system id nothing else uses so it can be picked out of the link's writes
+    static mavlink_message_t        _fillerMessage  (void);
+    static QList<mavlink_message_t> _parse          (const QList<QByteArray>& writes, uint32_t msgid, uint8_t sysid);
+
+    static const uint8_t _fillerSystemId = 200;
+};
@@ -0,0 +1,226 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "LinkSendQueueTest.h"
+
+#include <QElapsedTimer>
+
+/// Only the payload and ids are filled in, the queue finalizes the message as it is written. The index is carried in
+/// param_index so the order messages come out in can be checked.
+mavlink_message_t LinkSendQueueTest::_message(uint16_t index)
+{
+    mavlink_message_t               message;
+    mavlink_param_request_read_t    paramRequestRead;
+
+    memset(&message,            0, sizeof(message));
+    memset(&paramRequestRead,   0, sizeof(paramRequestRead));
+    paramRequestRead.param_index        = static_cast<int16_t>(index);
+    paramRequestRead.target_system      = 1;
+    paramRequestRead.target_component   = MAV_COMP_ID_AUTOPILOT1;
+    memcpy(_MAV_PAYLOAD_NON_CONST(&message), &paramRequestRead, MAVLINK_MSG_ID_PARAM_REQUEST_READ_LEN);
+    message.msgid   = MAVLINK_MSG_ID_PARAM_REQUEST_READ;
+    message.len     = MAVLINK_MSG_ID_PARAM_REQUEST_READ_LEN;
+    message.sysid   = 255;
+    message.compid  = MAV_COMP_ID_MISSIONPLANNER;
+
+    return message;
+}
+
+QList<mavlink_message_t> LinkSendQueueTest::_parse(const QList<QByteArray>& writes)
+{
+    QList<mavlink_message_t>    messages;
+    mavlink_message_t           rxMessage;
+    mavlink_status_t            rxStatus;
+    mavlink_message_t           message;
+    mavlink_status_t            status;
+
+    // Parsed on a local status so the global channel status is left alone
+    memset(&rxMessage,  0, sizeof(rxMessage));
+    memset(&rxStatus,   0, sizeof(rxStatus));
+    for (const QByteArray& write: writes) {
+        for (char c: write) {
+            if (mavlink_frame_char_buffer(&rxMessage, &rxStatus, static_cast<uint8_t>(c), &message, &status) == MAVLINK_FRAMING_OK) {
+                messages.append(message);
+            }
+        }
+    }
+
+    return messages;
+}
+
+QList<int> LinkSendQueueTest::_indices(const QList<mavlink_message_t>& messages)
+{
+    QList<int> indices;
+    for (const mavlink_message_t& message: messages) {
+        indices.append(mavlink_msg_param_request_read_get_param_index(&message));
+    }
+    return indices;
+}
+
+/// Runs the queued flush right away, without giving the rate limit timer a chance to fire
+void LinkSendQueueTest::_flush(LinkSendQueue& queue)
+{
+    QCoreApplication::sendPostedEvents(&queue, QEvent::MetaCall);
+}
+
+void LinkSendQueueTest::_priorityOrder_test(void)
+{
+    LinkSendQueue       queue;
+    QList<QByteArray>   writes;
+
+    connect(&queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    QVERIFY(queue.enqueue(_message(0), LinkSendQueue::PriorityBulk));
+    QVERIFY(queue.enqueue(_message(1), LinkSendQueue::PriorityNormal));
+    QVERIFY(queue.enqueue(_message(2), LinkSendQueue::PriorityControl));
+    QVERIFY(queue.enqueue(_message(3), LinkSendQueue::PriorityBulk));
+    QVERIFY(queue.enqueue(_message(4), LinkSendQueue::PriorityNormal));
+    QVERIFY(queue.enqueue(_message(5), LinkSendQueue::PriorityControl));
+    QCOMPARE(queue.queueDepth(), 6);
+
+    _flush(queue);
+
+    QCOMPARE(queue.queueDepth(), 0);
+    QCOMPARE(_indices(_parse(writes)), QList<int>({ 2, 5, 1, 4, 0, 3 }));
+}
+
+void LinkSendQueueTest::_fifoWithinPriority_test(void)
+{
+    LinkSendQueue       queue;
+    QList<QByteArray>   writes;
+    QList<int>          expected;
+
+    connect(&queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    // Spread over several flushes and several writes
+    for (uint16_t i=0; i<200; i++) {
+        QVERIFY(queue.enqueue(_message(i), LinkSendQueue::PriorityNormal));
+        expected.append(i);
+        if (i % 70 == 0) {
+            _flush(queue);
+        }
+    }
+    _flush(queue);
+
+    QList<mavlink_message_t> messages = _parse(writes);
+    QCOMPARE(_indices(messages), expected);
+
+    // Sequence numbers are assigned as messages are written, so they follow the written order
+    for (int i=1; i<messages.count(); i++) {
+        QCOMPARE(messages[i].seq, static_cast<uint8_t>(messages[i-1].seq + 1));
+    }
+}
+
+void LinkSendQueueTest::_coalesce_test(void)
+{
+    LinkSendQueue       queue;
+    QList<QByteArray>   writes;
+    const int           messageCount = 100;
+
+    connect(&queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    for (uint16_t i=0; i<messageCount; i++) {
+        QVERIFY(queue.enqueue(_message(i), LinkSendQueue::PriorityNormal));
+    }
+    _flush(queue);
+
+    // Each write is filled as far as whole messages allow
+    const int messagesPerWrite = LinkSendQueue::defaultMaxWriteSize / _messageLength;
+    QCOMPARE(writes.count(), (messageCount + messagesPerWrite - 1) / messagesPerWrite);
+    for (int i=0; i<writes.count(); i++) {
+        QVERIFY(writes[i].size() <= LinkSendQueue::defaultMaxWriteSize);
+        if (i < writes.count() - 1) {
+            QCOMPARE(writes[i].size(), messagesPerWrite * _messageLength);
+        }
+    }
+    QCOMPARE(_parse(writes).count(), messageCount);
+
+    // A smaller write size splits the same traffic into more writes
+    writes.clear();
+    queue.setMaxWriteSize(MAVLINK_MAX_PACKET_LEN);
+    for (uint16_t i=0; i<messageCount; i++) {
+        QVERIFY(queue.enqueue(_message(i), LinkSendQueue::PriorityNormal));
+    }
+    _flush(queue);
+    for (const QByteArray& write: writes) {
+        QVERIFY(write.size() <= MAVLINK_MAX_PACKET_LEN);
+    }
+    QCOMPARE(_parse(writes).count(), messageCount);
+}
+
+void LinkSendQueueTest::_dropWhenFull_test(void)
+{
+    LinkSendQueue       queue;
+    QList<QByteArray>   writes;
+
+    connect(&queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    const int capacity = LinkSendQueue::maxQueuedBytes / _messageLength;
+    for (int i=0; i<capacity; i++) {
+        QVERIFY(queue.enqueue(_message(static_cast<uint16_t>(i)), LinkSendQueue::PriorityBulk));
+    }
+    QCOMPARE(queue.messagesDropped(), 0ULL);
+
+    QVERIFY(!queue.enqueue(_message(0), LinkSendQueue::PriorityBulk));
+    QVERIFY(!queue.enqueue(_message(0), LinkSendQueue::PriorityBulk));
+    QCOMPARE(queue.messagesDropped(), 2ULL);
+    QCOMPARE(queue.queueDepth(), capacity);
+
+    // Limit is per priority
+    QVERIFY(queue.enqueue(_message(0), LinkSendQueue::PriorityControl));
+
+    // Writing out the queue makes room again
+    _flush(queue);
+    QCOMPARE(queue.queueDepth(), 0);
+    QCOMPARE(_parse(writes).count(), capacity + 1);
+    QVERIFY(queue.enqueue(_message(0), LinkSendQueue::PriorityBulk));
+}
+
+void LinkSendQueueTest::_rateLimit_test(void)
+{
+    LinkSendQueue       queue;
+    QList<QByteArray>   writes;
+    QElapsedTimer       elapsed;
+    const int           messageCount    = 100;
+    const qint64        bytesPerSecond  = 2000;
+
+    connect(&queue, &LinkSendQueue::writeBytes, this, [&writes](const QByteArray bytes) { writes.append(bytes); });
+
+    // The bucket starts out holding one full write
+    elapsed.start();
+    queue.setRateLimit(bytesPerSecond);
+    for (uint16_t i=0; i<messageCount; i++) {
+        QVERIFY(queue.enqueue(_message(i), LinkSendQueue::PriorityNormal));
+    }
+    _flush(queue);
+
+    const int firstBurst = LinkSendQueue::defaultMaxWriteSize / _messageLength;
+    QCOMPARE(_parse(writes).count(), firstBurst);
+    QCOMPARE(queue.queueDepth(), messageCount - firstBurst);
+
+    // Control traffic is not held back by the empty bucket, it goes ahead of the normal traffic which is
+    QVERIFY(queue.enqueue(_message(1000), LinkSendQueue::PriorityControl));
+    _flush(queue);
+    QCOMPARE(_indices(_parse(writes)).value(firstBurst), 1000);
+
+    // The rest is released in order as the bucket refills
+    QTRY_COMPARE_WITH_TIMEOUT(queue.queueDepth(), 0, 5000);
+    QList<int> expected;
+    for (int i=0; i<messageCount; i++) {
+        if (i == firstBurst) {
+            expected.append(1000);
+        }
+        expected.append(i);
+    }
+    QCOMPARE(_indices(_parse(writes)), expected);
+
+    // Everything past the first burst, plus the control message, had to wait for tokens
+    const qint64 minMsecs = ((messageCount - firstBurst + 1) * _messageLength * 1000LL) / bytesPerSecond;
+    QVERIFY2(elapsed.elapsed() >= minMsecs * 9 / 10, qPrintable(QStringLiteral("%1 msecs").arg(elapsed.elapsed())));
+}
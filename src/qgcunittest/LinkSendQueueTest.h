@@ -0,0 +1,35 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "LinkSendQueue.h"
+
+/// Unit test for LinkSendQueue ordering, coalescing, queue limits and rate limiting
+class LinkSendQueueTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _priorityOrder_test    (void);
+    void _fifoWithinPriority_test(void);
+    void _coalesce_test         (void);
+    void _dropWhenFull_test     (void);
+    void _rateLimit_test        (void);
+
+private:
+    mavlink_message_t       _message    (uint16_t index);
+    QList<mavlink_message_t> _parse     (const QList<QByteArray>& writes);
+    QList<int>              _indices    (const QList<mavlink_message_t>& messages);
+    void                    _flush      (LinkSendQueue& queue);
+
+    /// PARAM_REQUEST_READ is used for every message, the queue starts out writing MAVLink 1
+    static const int _messageLength = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + MAVLINK_MSG_ID_PARAM_REQUEST_READ_LEN + MAVLINK_NUM_CHECKSUM_BYTES;
+};
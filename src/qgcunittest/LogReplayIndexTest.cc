@@ -0,0 +1,295 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "LogReplayIndexTest.h"
+#include "LogReplayLink.h"
+#include "LinkManager.h"
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QtEndian>
+
+static const quint64 _logStartUSecs = 1577836800000000ULL;  // 2020-01-01
+static const quint64 _secondUSecs   = 1000000;
+
+qint64 LogReplayIndexTest::_appendRecord(QByteArray& log, quint64 timestampUSecs, const mavlink_message_t& message)
+{
+    qint64 offset = log.count();
+
+    char timestampBytes[LogReplayIndex::cbTimestamp];
+    qToBigEndian(timestampUSecs, timestampBytes);
+    log.append(timestampBytes, LogReplayIndex::cbTimestamp);
+
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int len = mavlink_msg_to_send_buffer(buffer, &message);
+    log.append(reinterpret_cast<const char*>(buffer), len);
+
+    return offset;
+}
+
+void LogReplayIndexTest::_heartbeat(mavlink_message_t& message, bool armed)
+{
+    mavlink_heartbeat_t heartbeat;
+
+    memset(&heartbeat, 0, sizeof(heartbeat));
+    heartbeat.type      = MAV_TYPE_QUADROTOR;
+    heartbeat.autopilot = MAV_AUTOPILOT_PX4;
+    heartbeat.base_mode = armed ? MAV_MODE_FLAG_SAFETY_ARMED : 0;
+    mavlink_msg_heartbeat_encode(1, MAV_COMP_ID_AUTOPILOT1, &message, &heartbeat);
+}
+
+void LogReplayIndexTest::_statusText(mavlink_message_t& message)
+{
+    mavlink_statustext_t statusText;
+
+    memset(&statusText, 0, sizeof(statusText));
+    statusText.severity = MAV_SEVERITY_INFO;
+    strncpy(statusText.text, "Index test", sizeof(statusText.text));
+    mavlink_msg_statustext_encode(1, MAV_COMP_ID_AUTOPILOT1, &message, &statusText);
+}
+
+void LogReplayIndexTest::_attitude(mavlink_message_t& message, int index)
+{
+    mavlink_attitude_t attitude;
+
+    // Attitude rather than heartbeat so replay doesn't bring up a vehicle
+    memset(&attitude, 0, sizeof(attitude));
+    attitude.time_boot_ms   = static_cast<uint32_t>(index);
+    attitude.roll           = index * 0.001f;
+    mavlink_msg_attitude_encode(1, MAV_COMP_ID_AUTOPILOT1, &message, &attitude);
+}
+
+QList<QByteArray> LogReplayIndexTest::_appendAttitudes(QByteArray& log, int count, quint64 intervalUSecs, int corruptIndex)
+{
+    QList<QByteArray>   messages;
+    mavlink_message_t   message;
+
+    for (int i=0; i<count; i++) {
+        _attitude(message, i);
+        qint64 offset = _appendRecord(log, _logStartUSecs + i * intervalUSecs, message);
+        if (i == corruptIndex) {
+            log[log.count() - 1] = static_cast<char>(log[log.count() - 1] ^ 0xFF);
+        } else {
+            messages.append(log.mid(static_cast<int>(offset) + LogReplayIndex::cbTimestamp));
+        }
+    }
+
+    return messages;
+}
+
+QString LogReplayIndexTest::_writeLog(const QByteArray& log)
+{
+    QString logFilename = _logDir + QStringLiteral("/test.tlog");
+    QFile logFile(logFilename);
+    if (!logFile.open(QFile::WriteOnly) || logFile.write(log) != log.count()) {
+        return QString();
+    }
+    return logFilename;
+}
+
+void LogReplayIndexTest::_corruptRecords_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    _logDir = tempDir.path();
+
+    mavlink_message_t message;
+    QByteArray log;
+
+    _heartbeat(message, false);
+    qint64 firstOffset = _appendRecord(log, _logStartUSecs, message);
+
+    // Bad CRC
+    _statusText(message);
+    qint64 corruptOffset = _appendRecord(log, _logStartUSecs + 1 * _secondUSecs, message);
+    log[log.count() - 1] = static_cast<char>(log[log.count() - 1] ^ 0xFF);
+    Q_UNUSED(corruptOffset);
+
+    _statusText(message);
+    qint64 statusTextOffset = _appendRecord(log, _logStartUSecs + 2 * _secondUSecs, message);
+
+    _heartbeat(message, true);
+    qint64 armedOffset = _appendRecord(log, _logStartUSecs + 3 * _secondUSecs, message);
+
+    // Truncated record, the parser runs on into the next record
+    _heartbeat(message, true);
+    _appendRecord(log, _logStartUSecs + 4 * _secondUSecs, message);
+    log.chop(10);
+
+    _statusText(message);
+    qint64 afterTruncatedOffset = _appendRecord(log, _logStartUSecs + 5 * _secondUSecs, message);
+
+    _heartbeat(message, false);
+    qint64 disarmedOffset = _appendRecord(log, _logStartUSecs + 6 * _secondUSecs, message);
+
+    QString logFilename = _writeLog(log);
+    QVERIFY(!logFilename.isEmpty());
+
+    LogReplayIndex index;
+    QString errorString;
+    QVERIFY(index.loadOrBuild(logFilename, errorString));
+    QCOMPARE(index.startTimeUSecs(),    _logStartUSecs);
+    QCOMPARE(index.endTimeUSecs(),      _logStartUSecs + 6 * _secondUSecs);
+
+    // Records following a corrupt one keep their own timestamp and offset
+    QCOMPARE(index.offsetForTimestamp(_logStartUSecs),                      firstOffset);
+    QCOMPARE(index.offsetForTimestamp(_logStartUSecs + 2 * _secondUSecs),   statusTextOffset);
+    QCOMPARE(index.offsetForTimestamp(_logStartUSecs + 4 * _secondUSecs),   armedOffset);
+    QCOMPARE(index.offsetForTimestamp(_logStartUSecs + 5 * _secondUSecs),   afterTruncatedOffset);
+
+    const LogReplayIndex::Event_t* event = index.nextEvent(0, LogReplayIndex::EventAll);
+    QVERIFY(event);
+    QCOMPARE(event->type,           static_cast<quint8>(LogReplayIndex::EventStatusText));
+    QCOMPARE(event->timestampUSecs, _logStartUSecs + 2 * _secondUSecs);
+    QCOMPARE(event->offset,         statusTextOffset);
+
+    event = index.nextEvent(event->timestampUSecs, LogReplayIndex::EventAll);
+    QVERIFY(event);
+    QCOMPARE(event->type,   static_cast<quint8>(LogReplayIndex::EventArmed));
+    QCOMPARE(event->offset, armedOffset);
+
+    event = index.nextEvent(event->timestampUSecs, LogReplayIndex::EventAll);
+    QVERIFY(event);
+    QCOMPARE(event->type,   static_cast<quint8>(LogReplayIndex::EventStatusText));
+    QCOMPARE(event->offset, afterTruncatedOffset);
+
+    event = index.nextEvent(event->timestampUSecs, LogReplayIndex::EventAll);
+    QVERIFY(event);
+    QCOMPARE(event->type,   static_cast<quint8>(LogReplayIndex::EventDisarmed));
+    QCOMPARE(event->offset, disarmedOffset);
+
+    QVERIFY(!index.nextEvent(event->timestampUSecs, LogReplayIndex::EventAll));
+}
+
+void LogReplayIndexTest::_sidecar_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    _logDir = tempDir.path();
+
+    mavlink_message_t message;
+    QByteArray log;
+
+    for (int i=0; i<50; i++) {
+        _heartbeat(message, i >= 25);
+        _appendRecord(log, _logStartUSecs + i * _secondUSecs / 10, message);
+    }
+    QString logFilename = _writeLog(log);
+    QVERIFY(!logFilename.isEmpty());
+
+    QString errorString;
+    LogReplayIndex builtIndex;
+    QVERIFY(builtIndex.loadOrBuild(logFilename, errorString));
+    QVERIFY(QFile::exists(LogReplayIndex::indexFilename(logFilename)));
+
+    LogReplayIndex loadedIndex;
+    QVERIFY(loadedIndex.loadOrBuild(logFilename, errorString));
+    QCOMPARE(loadedIndex.startTimeUSecs(),  builtIndex.startTimeUSecs());
+    QCOMPARE(loadedIndex.endTimeUSecs(),    builtIndex.endTimeUSecs());
+    for (int i=0; i<50; i++) {
+        quint64 timestampUSecs = _logStartUSecs + i * _secondUSecs / 10;
+        QCOMPARE(loadedIndex.offsetForTimestamp(timestampUSecs), builtIndex.offsetForTimestamp(timestampUSecs));
+    }
+    const LogReplayIndex::Event_t* event = loadedIndex.nextEvent(0, LogReplayIndex::EventArmed);
+    QVERIFY(event);
+    QCOMPARE(event->timestampUSecs, _logStartUSecs + 25 * _secondUSecs / 10);
+
+    // A changed log makes the sidecar stale
+    _heartbeat(message, false);
+    _appendRecord(log, _logStartUSecs + 50 * _secondUSecs / 10, message);
+    QVERIFY(!_writeLog(log).isEmpty());
+
+    LogReplayIndex rebuiltIndex;
+    QVERIFY(rebuiltIndex.loadOrBuild(logFilename, errorString));
+    QCOMPARE(rebuiltIndex.endTimeUSecs(), _logStartUSecs + 50 * _secondUSecs / 10);
+}
+
+void LogReplayIndexTest::_cancel_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    _logDir = tempDir.path();
+
+    mavlink_message_t message;
+    QByteArray log;
+
+    _heartbeat(message, false);
+    _appendRecord(log, _logStartUSecs, message);
+    _appendRecord(log, _logStartUSecs + _secondUSecs, message);
+    QString logFilename = _writeLog(log);
+    QVERIFY(!logFilename.isEmpty());
+
+    LogReplayIndex index;
+    QString errorString;
+    index.cancelBuild();
+    QVERIFY(!index.loadOrBuild(logFilename, errorString));
+    QVERIFY(!errorString.isEmpty());
+    QVERIFY(!QFile::exists(LogReplayIndex::indexFilename(logFilename)));
+}
+
+void LogReplayIndexTest::_mappedPlayback_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    _logDir = tempDir.path();
+
+    // Short enough to play back in real time
+    QByteArray log;
+    QList<QByteArray> expectedMessages = _appendAttitudes(log, 200, 1000, -1);
+    QString logFilename = _writeLog(log);
+    QVERIFY(!logFilename.isEmpty());
+
+    QList<QByteArray> receivedMessages;
+    LogReplayLink* link = _linkManager->startLogReplay(logFilename);
+    QVERIFY(link);
+    connect(link, &LinkInterface::bytesReceived, this, [&receivedMessages](LinkInterface*, QByteArray bytes) { receivedMessages.append(bytes); });
+    QSignalSpy spyAtEnd(link, SIGNAL(playbackAtEnd()));
+
+    QTRY_VERIFY(link->isConnected());
+    QVERIFY(link->_logData);
+    QVERIFY(spyAtEnd.wait(10000));
+
+    QTRY_COMPARE(receivedMessages.count(), expectedMessages.count());
+    QCOMPARE(receivedMessages, expectedMessages);
+
+    _linkManager->removeConfiguration(link->getLinkConfiguration());
+}
+
+void LogReplayIndexTest::_bulkPlayback_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    _logDir = tempDir.path();
+
+    // Records are an hour apart so nothing past the first one plays before we switch to Max. There are more of them
+    // than bulk replay allows in flight so it has to wait on the decode worker along the way.
+    QByteArray log;
+    QList<QByteArray> expectedMessages = _appendAttitudes(log, 5000, 3600 * _secondUSecs, 2500);
+    QString logFilename = _writeLog(log);
+    QVERIFY(!logFilename.isEmpty());
+
+    QList<QByteArray> receivedMessages;
+    LogReplayLink* link = _linkManager->startLogReplay(logFilename);
+    QVERIFY(link);
+    connect(link, &LinkInterface::bytesReceived, this, [&receivedMessages](LinkInterface*, QByteArray bytes) { receivedMessages.append(bytes); });
+    QSignalSpy spyAtEnd(link, SIGNAL(playbackAtEnd()));
+
+    QTRY_VERIFY(link->isConnected());
+    QVERIFY(link->_logData);
+    QTRY_COMPARE(receivedMessages.count(), 1);
+
+    link->setPlaybackSpeed(0);
+    QVERIFY(spyAtEnd.wait(30000));
+
+    // The corrupt record is dropped and parsing picks up again with the one following it
+    QTRY_COMPARE(receivedMessages.count(), expectedMessages.count());
+    QCOMPARE(receivedMessages, expectedMessages);
+
+    _linkManager->removeConfiguration(link->getLinkConfiguration());
+}
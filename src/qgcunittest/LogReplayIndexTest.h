@@ -0,0 +1,40 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "LogReplayIndex.h"
+
+/// Unit test for LogReplayIndex building, resync after corrupt records and the sidecar file, as well as LogReplayLink
+/// playback from the memory mapped log
+class LogReplayIndexTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _corruptRecords_test   (void);
+    void _sidecar_test          (void);
+    void _cancel_test           (void);
+    void _mappedPlayback_test   (void);
+    void _bulkPlayback_test     (void);
+
+private:
+    /// Appends a log record and returns its offset
+    qint64  _appendRecord   (QByteArray& log, quint64 timestampUSecs, const mavlink_message_t& message);
+    void    _heartbeat      (mavlink_message_t& message, bool armed);
+    void    _statusText     (mavlink_message_t& message);
+    void    _attitude       (mavlink_message_t& message, int index);
+    /// Appends count attitude records to the log, skipping the record at corruptIndex
+    /// @return The mavlink bytes of the valid records in log order
+    QList<QByteArray> _appendAttitudes(QByteArray& log, int count, quint64 intervalUSecs, int corruptIndex);
+    QString _writeLog       (const QByteArray& log);
+
+    QString _logDir;
+};
@@ -0,0 +1,141 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkDecodeWorkerTest.h"
+#include "LinkInterface.h"
+#include "MockLink.h"
+
+#include <QThread>
+
+/// Link which only exists to emit bytesReceived for the worker
+class DecodeTestLink : public LinkInterface
+{
+public:
+    DecodeTestLink(SharedLinkConfigurationPointer& config)
+        : LinkInterface(config)
+    { }
+
+    void receive(const QByteArray& bytes) { emit bytesReceived(this, bytes); }
+
+    QString getName             (void) const override { return QStringLiteral("DecodeTestLink"); }
+    void    requestReset        (void) override { }
+    bool    isConnected         (void) const override { return true; }
+    qint64  getConnectionSpeed  (void) const override { return 0; }
+
+private:
+    void    _writeBytes         (const QByteArray) override { }
+    bool    _connect            (void) override { return true; }
+    void    _disconnect         (void) override { }
+};
+
+QByteArray MAVLinkDecodeWorkerTest::_heartbeatFrame(uint8_t seq)
+{
+    mavlink_message_t   message;
+    mavlink_status_t    status;
+
+    mavlink_heartbeat_t heartbeat;
+
+    // Packed by hand on a local status so the global channel status is left alone
+    memset(&status,     0, sizeof(status));
+    memset(&heartbeat,  0, sizeof(heartbeat));
+    status.current_tx_seq = seq;
+    memcpy(_MAV_PAYLOAD_NON_CONST(&message), &heartbeat, MAVLINK_MSG_ID_HEARTBEAT_LEN);
+    message.msgid = MAVLINK_MSG_ID_HEARTBEAT;
+    mavlink_finalize_message_buffer(&message, 1, MAV_COMP_ID_AUTOPILOT1, &status, MAVLINK_MSG_ID_HEARTBEAT_MIN_LEN, MAVLINK_MSG_ID_HEARTBEAT_LEN, MAVLINK_MSG_ID_HEARTBEAT_CRC);
+
+    uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+    int len = mavlink_msg_to_send_buffer(buffer, &message);
+    return QByteArray(reinterpret_cast<const char*>(buffer), len);
+}
+
+void MAVLinkDecodeWorkerTest::_decodeOnWorkerThread_test(void)
+{
+    SharedLinkConfigurationPointer config(new MockConfiguration(QStringLiteral("DecodeWorker")));
+    DecodeTestLink link(config);
+
+    // The worker must not touch the global channel state, the main thread owns it for outbound messages
+    QByteArray channelStatus(reinterpret_cast<const char*>(mavlink_get_channel_status(MAVLINK_COMM_0)), sizeof(mavlink_status_t) * MAVLINK_COMM_NUM_BUFFERS);
+
+    MAVLinkDecodeWorker worker(&link, 0, MAVLinkDecodeWorker::DropNone);
+
+    QThread* readyThread = nullptr;
+    connect(&worker, &MAVLinkDecodeWorker::messagesReady, this, [&readyThread](LinkInterface*) { readyThread = QThread::currentThread(); }, Qt::DirectConnection);
+    worker.start();
+
+    QByteArray corrupt = _heartbeatFrame(2);
+    corrupt[corrupt.count() - 1] = static_cast<char>(corrupt[corrupt.count() - 1] ^ 0xFF);
+
+    // Frame 1, a frame with a bad CRC, then frame 3 split across two reads
+    QByteArray bytes = _heartbeatFrame(1) + corrupt + _heartbeatFrame(3);
+    int split = bytes.count() - 5;
+    link.receive(bytes.left(split));
+    link.receive(bytes.mid(split));
+
+    QTRY_COMPARE(worker.stats().decodedCount, static_cast<quint64>(2));
+
+    MAVLinkDecodedMessageList messages;
+    worker.takeMessages(messages);
+    QCOMPARE(messages.count(), 2);
+    QCOMPARE(messages[0].message.seq, static_cast<uint8_t>(1));
+    QCOMPARE(messages[1].message.seq, static_cast<uint8_t>(3));
+    QCOMPARE(messages[1].message.msgid, static_cast<uint32_t>(MAVLINK_MSG_ID_HEARTBEAT));
+
+    QVERIFY(readyThread);
+    QVERIFY(readyThread != QThread::currentThread());
+
+    worker.stop();
+
+    QCOMPARE(QByteArray(reinterpret_cast<const char*>(mavlink_get_channel_status(MAVLINK_COMM_0)), channelStatus.count()), channelStatus);
+}
+
+void MAVLinkDecodeWorkerTest::_dropNewest_test(void)
+{
+    SharedLinkConfigurationPointer config(new MockConfiguration(QStringLiteral("DecodeWorker")));
+    DecodeTestLink link(config);
+    MAVLinkDecodeWorker worker(&link, 2, MAVLinkDecodeWorker::DropNewest);
+    worker.start();
+
+    QByteArray bytes;
+    for (uint8_t seq = 0; seq < 5; seq++) {
+        bytes += _heartbeatFrame(seq);
+    }
+    link.receive(bytes);
+
+    QTRY_COMPARE(worker.stats().decodedCount, static_cast<quint64>(5));
+    QCOMPARE(worker.stats().droppedCount, static_cast<quint64>(3));
+
+    MAVLinkDecodedMessageList messages;
+    worker.takeMessages(messages);
+    QCOMPARE(messages.count(), 2);
+    QCOMPARE(messages[0].message.seq, static_cast<uint8_t>(0));
+    QCOMPARE(messages[1].message.seq, static_cast<uint8_t>(1));
+}
+
+void MAVLinkDecodeWorkerTest::_dropOldest_test(void)
+{
+    SharedLinkConfigurationPointer config(new MockConfiguration(QStringLiteral("DecodeWorker")));
+    DecodeTestLink link(config);
+    MAVLinkDecodeWorker worker(&link, 2, MAVLinkDecodeWorker::DropOldest);
+    worker.start();
+
+    QByteArray bytes;
+    for (uint8_t seq = 0; seq < 5; seq++) {
+        bytes += _heartbeatFrame(seq);
+    }
+    link.receive(bytes);
+
+    QTRY_COMPARE(worker.stats().decodedCount, static_cast<quint64>(5));
+    QCOMPARE(worker.stats().droppedCount, static_cast<quint64>(3));
+
+    MAVLinkDecodedMessageList messages;
+    worker.takeMessages(messages);
+    QCOMPARE(messages.count(), 2);
+    QCOMPARE(messages[0].message.seq, static_cast<uint8_t>(3));
+    QCOMPARE(messages[1].message.seq, static_cast<uint8_t>(4));
+}
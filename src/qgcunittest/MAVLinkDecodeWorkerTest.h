@@ -0,0 +1,27 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "MAVLinkDecodeWorker.h"
+
+/// Unit test for MAVLinkDecodeWorker framing, threading and queue overflow handling
+class MAVLinkDecodeWorkerTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _decodeOnWorkerThread_test (void);
+    void _dropNewest_test           (void);
+    void _dropOldest_test           (void);
+
+private:
+    QByteArray _heartbeatFrame(uint8_t seq);
+};
@@ -0,0 +1,157 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "MAVLinkMessageRouterTest.h"
+
+void MAVLinkMessageRouterTest::_appendMessage(MAVLinkDecodedMessageList& messages, uint8_t sysid, uint8_t compid, uint32_t msgid)
+{
+    MAVLinkDecodedMessage decoded;
+    memset(&decoded, 0, sizeof(decoded));
+    decoded.message.sysid   = sysid;
+    decoded.message.compid  = compid;
+    decoded.message.msgid   = msgid;
+    messages.append(decoded);
+}
+
+void MAVLinkMessageRouterTest::_filterMatch_test(void)
+{
+    MAVLinkMessageRouter router;
+    int vehicleCount    = 0;
+    int ftpCount        = 0;
+    int allCount        = 0;
+    int allCalls        = 0;
+
+    router.subscribe(this, MAVLinkMessageFilter(1), [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        vehicleCount += messages.count();
+    });
+    router.subscribe(this, MAVLinkMessageFilter(2, MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL), [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        ftpCount += messages.count();
+    });
+    router.subscribe(this, MAVLinkMessageFilter(), [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        allCount += messages.count();
+        allCalls++;
+    });
+
+    MAVLinkDecodedMessageList messages;
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_HEARTBEAT);
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_ATTITUDE);
+    _appendMessage(messages, 2, 1, MAVLINK_MSG_ID_HEARTBEAT);
+    _appendMessage(messages, 2, 1, MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL);
+
+    router.route(nullptr, messages, messages.count());
+
+    QCOMPARE(vehicleCount,  2);
+    QCOMPARE(ftpCount,      1);
+    QCOMPARE(allCount,      4);
+    // The whole batch is delivered in a single call
+    QCOMPARE(allCalls,      1);
+
+    // Only the first count messages are routed
+    router.route(nullptr, messages, 1);
+    QCOMPARE(vehicleCount,  3);
+    QCOMPARE(ftpCount,      1);
+}
+
+void MAVLinkMessageRouterTest::_noDuplicateDelivery_test(void)
+{
+    MAVLinkMessageRouter router;
+    int count = 0;
+
+    QList<MAVLinkMessageFilter> filters;
+    filters << MAVLinkMessageFilter(1) << MAVLinkMessageFilter(MAVLinkMessageFilter::anyValue, MAVLinkMessageFilter::anyValue, MAVLINK_MSG_ID_RADIO_STATUS);
+    router.subscribe(this, filters, [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        count += messages.count();
+    });
+
+    MAVLinkDecodedMessageList messages;
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_RADIO_STATUS);
+    _appendMessage(messages, 3, 68, MAVLINK_MSG_ID_RADIO_STATUS);
+    _appendMessage(messages, 3, 1, MAVLINK_MSG_ID_HEARTBEAT);
+
+    router.route(nullptr, messages, messages.count());
+    QCOMPARE(count, 2);
+}
+
+void MAVLinkMessageRouterTest::_contextDestroyed_test(void)
+{
+    MAVLinkMessageRouter router;
+    int count = 0;
+
+    QObject* context = new QObject();
+    router.subscribe(context, MAVLinkMessageFilter(), [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        count += messages.count();
+    });
+
+    MAVLinkDecodedMessageList messages;
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_HEARTBEAT);
+
+    router.route(nullptr, messages, messages.count());
+    QCOMPARE(count, 1);
+
+    delete context;
+    router.route(nullptr, messages, messages.count());
+    QCOMPARE(count, 1);
+}
+
+void MAVLinkMessageRouterTest::_unsubscribeDuringRoute_test(void)
+{
+    MAVLinkMessageRouter router;
+    int secondId    = 0;
+    int secondCount = 0;
+
+    router.subscribe(this, MAVLinkMessageFilter(), [&](LinkInterface*, const MAVLinkMessageBatch&) {
+        router.unsubscribe(secondId);
+    });
+    secondId = router.subscribe(this, MAVLinkMessageFilter(), [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        secondCount += messages.count();
+    });
+
+    MAVLinkDecodedMessageList messages;
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_HEARTBEAT);
+
+    router.route(nullptr, messages, messages.count());
+    QCOMPARE(secondCount, 0);
+}
+
+void MAVLinkMessageRouterTest::_reentrantRoute_test(void)
+{
+    MAVLinkMessageRouter router;
+    QList<uint32_t> allMsgIds;
+    QList<int>      allBatchSizes;
+
+    MAVLinkDecodedMessageList nestedMessages;
+    _appendMessage(nestedMessages, 1, 1, MAVLINK_MSG_ID_ATTITUDE);
+
+    // First subscriber routes another batch from inside its handler, as happens when a handler spins an event loop
+    bool nested = false;
+    router.subscribe(this, MAVLinkMessageFilter(), [&](LinkInterface*, const MAVLinkMessageBatch&) {
+        if (!nested) {
+            nested = true;
+            router.route(nullptr, nestedMessages, nestedMessages.count());
+        }
+    });
+    QList<MAVLinkMessageFilter> filters;
+    filters << MAVLinkMessageFilter(1) << MAVLinkMessageFilter();
+    router.subscribe(this, filters, [&](LinkInterface*, const MAVLinkMessageBatch& messages) {
+        allBatchSizes.append(messages.count());
+        for (const mavlink_message_t* message: messages) {
+            allMsgIds.append(message->msgid);
+        }
+    });
+
+    MAVLinkDecodedMessageList messages;
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_HEARTBEAT);
+    _appendMessage(messages, 1, 1, MAVLINK_MSG_ID_SYS_STATUS);
+
+    router.route(nullptr, messages, messages.count());
+
+    // Nested batch is delivered on its own first, then the outer batch complete and without duplicates
+    QCOMPARE(allBatchSizes, QList<int>() << 1 << 2);
+    QCOMPARE(allMsgIds, QList<uint32_t>() << MAVLINK_MSG_ID_ATTITUDE << MAVLINK_MSG_ID_HEARTBEAT << MAVLINK_MSG_ID_SYS_STATUS);
+}
@@ -0,0 +1,29 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "MAVLinkMessageRouter.h"
+
+/// Unit test for MAVLinkMessageRouter subscription matching and batch delivery
+class MAVLinkMessageRouterTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _filterMatch_test          (void);
+    void _noDuplicateDelivery_test  (void);
+    void _contextDestroyed_test     (void);
+    void _unsubscribeDuringRoute_test(void);
+    void _reentrantRoute_test       (void);
+
+private:
+    void _appendMessage(MAVLinkDecodedMessageList& messages, uint8_t sysid, uint8_t compid, uint32_t msgid);
+};
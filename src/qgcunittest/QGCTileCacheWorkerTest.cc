@@ -0,0 +1,425 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "QGCTileCacheWorkerTest.h"
+#include "QGCMapEngine.h"
+#include "QGCMapEngineData.h"
+#include "QGCMapTileSet.h"
+
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlError>
+
+static const QString _mapType           = QStringLiteral("Google Street Map");
+static const QString _readerSession     = QStringLiteral("QGCTileCacheWorkerTestReader");
+
+bool QGCTileCacheWorkerTest::_openWorker(QGCCacheWorker& worker, const QString& databasePath)
+{
+    worker.setDatabaseFile(databasePath);
+    if (!worker._openDB() || !worker._createDB(worker._db)) {
+        return false;
+    }
+    worker._valid = true;
+    return true;
+}
+
+void QGCTileCacheWorkerTest::_saveTile(QGCCacheWorker& worker, const QString& hash, int size, qulonglong setID)
+{
+    _saveTile(worker, hash, QByteArray(size, 't'), setID);
+}
+
+void QGCTileCacheWorkerTest::_saveTile(QGCCacheWorker& worker, const QString& hash, const QByteArray& img, qulonglong setID)
+{
+    QGCSaveTileTask task(new QGCCacheTile(hash, img, QStringLiteral("png"), _mapType, setID));
+    worker._saveTile(&task);
+}
+
+QString QGCTileCacheWorkerTest::_tileQuery(const QString& hash, const QByteArray& img)
+{
+    return QStringLiteral("SELECT COUNT(*) FROM Tiles WHERE hash = '%1' AND tile = x'%2'").arg(hash).arg(QString(img.toHex()));
+}
+
+bool QGCTileCacheWorkerTest::_execute(const QString& databasePath, const QStringList& statements)
+{
+    bool success = true;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", _readerSession);
+        db.setDatabaseName(databasePath);
+        success = db.open() && db.transaction();
+        QSqlQuery query(db);
+        for (const QString& statement: statements) {
+            if (success && !query.exec(statement)) {
+                qWarning() << statement << query.lastError().text();
+                success = false;
+            }
+        }
+        query.finish();
+        success = success && db.commit();
+    }
+    QSqlDatabase::removeDatabase(_readerSession);
+    return success;
+}
+
+qint64 QGCTileCacheWorkerTest::_queryValue(const QString& databasePath, const QString& sql)
+{
+    qint64 value = -1;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", _readerSession);
+        db.setDatabaseName(databasePath);
+        if (db.open()) {
+            QSqlQuery query(db);
+            if (query.exec(sql) && query.next()) {
+                value = query.value(0).toLongLong();
+            }
+        }
+    }
+    QSqlDatabase::removeDatabase(_readerSession);
+    return value;
+}
+
+void QGCTileCacheWorkerTest::_batchedInserts_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString databasePath = tempDir.path() + QStringLiteral("/qgcMapCache.db");
+    QGCCacheWorker worker;
+    QVERIFY(_openWorker(worker, databasePath));
+
+    // Statements are shared by SQL text, not by where the string happens to live
+    const char* sql = "SELECT tileID FROM Tiles WHERE hash = ?";
+    QByteArray sqlCopy(sql);
+    QSqlQuery* query = worker._prepared(sql);
+    QCOMPARE(worker._prepared(sqlCopy.constData()), query);
+    QCOMPARE(worker._statements.count(), 1);
+
+    worker._beginBatch();
+    QVERIFY(worker._inBatch);
+    for (int i=0; i<50; i++) {
+        _saveTile(worker, QStringLiteral("batch%1").arg(i), 100);
+    }
+
+    // Saves within the batch are visible to the worker but not committed yet
+    QVERIFY(worker._findTile(QStringLiteral("batch49")) != 0);
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM Tiles")), static_cast<qint64>(0));
+
+    worker._commitBatch();
+    QVERIFY(!worker._inBatch);
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM Tiles")),     static_cast<qint64>(50));
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM SetTiles")),  static_cast<qint64>(50));
+
+    // Downloaded tiles for a set are saved and dropped from the download list in the same batch
+    int typeID = getQGCMapEngine()->urlFactory()->getIdFromType(_mapType);
+    quint64 setID = worker._insertTileSet(QStringLiteral("Batch"), _mapType, 0, 0, 0, 0, 1, 1, typeID, 2);
+    QSqlQuery* downloadQuery = worker._prepared("INSERT OR IGNORE INTO TilesDownload(setID, hash, type, x, y, z, state) VALUES(?, ?, ?, ?, ? ,? ,?)");
+    for (int i=0; i<2; i++) {
+        downloadQuery->addBindValue(setID);
+        downloadQuery->addBindValue(QStringLiteral("download%1").arg(i));
+        downloadQuery->addBindValue(typeID);
+        downloadQuery->addBindValue(i);
+        downloadQuery->addBindValue(0);
+        downloadQuery->addBindValue(1);
+        downloadQuery->addBindValue(0);
+        QVERIFY(downloadQuery->exec());
+    }
+
+    worker._beginBatch();
+    QList<QGCCacheTile*> tiles;
+    tiles.append(new QGCCacheTile(QStringLiteral("download0"), QByteArray(100, 'd'), QStringLiteral("png"), _mapType, setID));
+    tiles.append(new QGCCacheTile(QStringLiteral("download1"), QByteArray(100, 'd'), QStringLiteral("png"), _mapType, setID));
+    QGCSaveDownloadedTilesTask task(setID, tiles);
+    worker._saveDownloadedTiles(&task);
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM TilesDownload")), static_cast<qint64>(2));
+    worker._commitBatch();
+
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM TilesDownload")),                             static_cast<qint64>(0));
+    QCOMPARE(_queryValue(databasePath, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(setID)),      static_cast<qint64>(2));
+
+    worker._closeDB();
+}
+
+void QGCTileCacheWorkerTest::_incrementalTotals_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString databasePath = tempDir.path() + QStringLiteral("/qgcMapCache.db");
+    QGCCacheWorker worker;
+    QVERIFY(_openWorker(worker, databasePath));
+
+    worker._computeTotals();
+    QCOMPARE(worker._totalCount, 0u);
+
+    for (int i=0; i<10; i++) {
+        _saveTile(worker, QStringLiteral("default%1").arg(i), 100);
+    }
+    QVERIFY(worker._totalsValid);
+    QCOMPARE(worker._totalCount,    10u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(1000));
+    QCOMPARE(worker._defaultCount,  10u);
+    QCOMPARE(worker._defaultSize,   static_cast<quint64>(1000));
+
+    // Saving a tile which is already there changes nothing
+    _saveTile(worker, QStringLiteral("default0"), 100);
+    QCOMPARE(worker._totalCount,    10u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(1000));
+
+    // Tiles saved into another set count towards the total only
+    int typeID = getQGCMapEngine()->urlFactory()->getIdFromType(_mapType);
+    quint64 setID = worker._insertTileSet(QStringLiteral("Totals"), _mapType, 0, 0, 0, 0, 1, 1, typeID, 5);
+    for (int i=0; i<5; i++) {
+        _saveTile(worker, QStringLiteral("set%1").arg(i), 200, setID);
+    }
+    QCOMPARE(worker._totalCount,    15u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(2000));
+    QCOMPARE(worker._defaultCount,  10u);
+    QCOMPARE(worker._defaultSize,   static_cast<quint64>(1000));
+
+    // Incremental totals match a full recompute
+    worker._computeTotals();
+    QCOMPARE(worker._totalCount,    15u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(2000));
+    QCOMPARE(worker._defaultCount,  10u);
+    QCOMPARE(worker._defaultSize,   static_cast<quint64>(1000));
+
+    // A downloaded tile which is already cached for the default set is now shared, which can only be accounted
+    // for by a recompute
+    QList<QGCCacheTile*> tiles;
+    tiles.append(new QGCCacheTile(QStringLiteral("default0"), QByteArray(100, 't'), QStringLiteral("png"), _mapType, setID));
+    tiles.append(new QGCCacheTile(QStringLiteral("set5"), QByteArray(200, 't'), QStringLiteral("png"), _mapType, setID));
+    QGCSaveDownloadedTilesTask task(setID, tiles);
+    worker._saveDownloadedTiles(&task);
+    QVERIFY(!worker._totalsValid);
+    QCOMPARE(worker._totalCount,    16u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(2200));
+
+    QSignalSpy spyTotals(&worker, &QGCCacheWorker::updateTotals);
+    worker._updateTotals();
+    QVERIFY(worker._totalsValid);
+    QCOMPARE(spyTotals.count(), 1);
+    QList<QVariant> totals = spyTotals.takeFirst();
+    QCOMPARE(totals[0].toUInt(),        16u);
+    QCOMPARE(totals[1].toULongLong(),   static_cast<quint64>(2200));
+    QCOMPARE(totals[2].toUInt(),        9u);
+    QCOMPARE(totals[3].toULongLong(),   static_cast<quint64>(900));
+
+    // Pruning takes the oldest tiles unique to the default set and keeps the totals in step
+    QGCPruneCacheTask pruneTask(250);
+    worker._pruneCache(&pruneTask);
+    quint32 prunedCount = 9 - worker._defaultCount;
+    QCOMPARE(prunedCount, 3u);
+    QCOMPARE(worker._defaultSize,   static_cast<quint64>(600));
+    QCOMPARE(worker._totalCount,    13u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(1900));
+    QVERIFY(worker._findTile(QStringLiteral("default0")) != 0);
+
+    worker._computeTotals();
+    QCOMPARE(worker._totalCount,    13u);
+    QCOMPARE(worker._totalSize,     static_cast<quint64>(1900));
+    QCOMPARE(worker._defaultCount,  6u);
+    QCOMPARE(worker._defaultSize,   static_cast<quint64>(600));
+
+    worker._closeDB();
+}
+
+void QGCTileCacheWorkerTest::_qgcSetsRoundTrip_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString sourcePath  = tempDir.path() + QStringLiteral("/source.db");
+    QString exportPath  = tempDir.path() + QStringLiteral("/export.db");
+    QString targetPath  = tempDir.path() + QStringLiteral("/target.db");
+
+    // Default set holds d0-d2, the survey set s0-s3 and a download of d0 which it shares with the default set
+    QGCCacheWorker source;
+    QVERIFY(_openWorker(source, sourcePath));
+    for (int i=0; i<3; i++) {
+        _saveTile(source, QGCMapEngine::getTileHash(_mapType, i, 0, 10), QByteArray(100, static_cast<char>('a' + i)), UINT64_MAX);
+    }
+    int typeID = getQGCMapEngine()->urlFactory()->getIdFromType(_mapType);
+    quint64 surveyID = source._insertTileSet(QStringLiteral("Survey"), _mapType, 1, 0, 0, 1, 10, 10, typeID, 5);
+    for (int i=0; i<4; i++) {
+        _saveTile(source, QGCMapEngine::getTileHash(_mapType, i, 1, 10), QByteArray(100, static_cast<char>('m' + i)), surveyID);
+    }
+    QList<QGCCacheTile*> tiles;
+    tiles.append(new QGCCacheTile(QGCMapEngine::getTileHash(_mapType, 0, 0, 10), QByteArray(100, 'a'), QStringLiteral("png"), _mapType, surveyID));
+    QGCSaveDownloadedTilesTask downloadTask(surveyID, tiles);
+    source._saveDownloadedTiles(&downloadTask);
+
+    QGCCachedTileSet defaultSet(QStringLiteral("Default Tile Set"));
+    defaultSet.setId(source._getDefaultTileSet());
+    defaultSet.setDefaultSet(true);
+    defaultSet.setType(_mapType);
+    defaultSet.setTotalTileCount(3);
+    QGCCachedTileSet surveySet(QStringLiteral("Survey"));
+    surveySet.setId(surveyID);
+    surveySet.setType(_mapType);
+    surveySet.setMapTypeStr(_mapType);
+    surveySet.setTotalTileCount(5);
+    surveySet.setUniqueTileCount(4);
+
+    QGCExportTileTask exportTask({ &defaultSet, &surveySet }, exportPath);
+    QSignalSpy spyExportError(&exportTask, &QGCMapTask::error);
+    source._exportSets(&exportTask);
+    QCOMPARE(spyExportError.count(), 0);
+    source._closeDB();
+
+    // Shared tiles are only exported once
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM Tiles")),       static_cast<qint64>(7));
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM TileSets")),    static_cast<qint64>(2));
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM SetTiles")),    static_cast<qint64>(8));
+
+    // The target already has d1, which must not be duplicated
+    QGCCacheWorker target;
+    QVERIFY(_openWorker(target, targetPath));
+    _saveTile(target, QGCMapEngine::getTileHash(_mapType, 1, 0, 10), QByteArray(100, 'b'), UINT64_MAX);
+
+    QGCImportTileTask importTask(exportPath, false /* replace */);
+    QSignalSpy spyImportError(&importTask, &QGCMapTask::error);
+    target._importSets(&importTask);
+    QCOMPARE(spyImportError.count(), 0);
+
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM Tiles")), static_cast<qint64>(7));
+    for (int i=0; i<4; i++) {
+        QCOMPARE(_queryValue(targetPath, _tileQuery(QGCMapEngine::getTileHash(_mapType, i, 1, 10), QByteArray(100, static_cast<char>('m' + i)))), static_cast<qint64>(1));
+    }
+    quint64 importedID = 0;
+    QVERIFY(target._findTileSetID(QStringLiteral("Survey"), importedID));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(importedID)),                  static_cast<qint64>(5));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT numTiles FROM TileSets WHERE setID = %1").arg(importedID)),                  static_cast<qint64>(5));
+    // The default set picks up only the tiles which are new to it
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(target._getDefaultTileSet())), static_cast<qint64>(3));
+
+    target._closeDB();
+}
+
+void QGCTileCacheWorkerTest::_mbtilesRoundTrip_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString sourcePath  = tempDir.path() + QStringLiteral("/source.db");
+    QString exportPath  = tempDir.path() + QStringLiteral("/export.mbtiles");
+    QString targetPath  = tempDir.path() + QStringLiteral("/target.db");
+
+    typedef struct {
+        int x, y;
+    } XY_t;
+    const XY_t xy[] = { { 1, 0 }, { 2, 3 }, { 3, 1 } };
+    const int zoom = 2;
+
+    QGCCacheWorker source;
+    QVERIFY(_openWorker(source, sourcePath));
+    int typeID = getQGCMapEngine()->urlFactory()->getIdFromType(_mapType);
+    quint64 surveyID = source._insertTileSet(QStringLiteral("Survey"), _mapType, 10, 20, 5, 30, zoom, zoom, typeID, 3);
+    for (size_t i=0; i<sizeof(xy)/sizeof(xy[0]); i++) {
+        _saveTile(source, QGCMapEngine::getTileHash(_mapType, xy[i].x, xy[i].y, zoom), QByteArray(64, static_cast<char>('a' + i)), surveyID);
+    }
+    // Tiles of other map types in the default set are left out
+    QGCSaveTileTask otherTask(new QGCCacheTile(QGCMapEngine::getTileHash(QStringLiteral("Google Satellite"), 0, 0, zoom), QByteArray(64, 'z'), QStringLiteral("jpg"), QStringLiteral("Google Satellite")));
+    source._saveTile(&otherTask);
+
+    QGCCachedTileSet defaultSet(QStringLiteral("Default Tile Set"));
+    defaultSet.setId(source._getDefaultTileSet());
+    defaultSet.setDefaultSet(true);
+    QGCCachedTileSet surveySet(QStringLiteral("Survey"));
+    surveySet.setId(surveyID);
+    surveySet.setType(_mapType);
+    surveySet.setTopleftLat(10);
+    surveySet.setTopleftLon(20);
+    surveySet.setBottomRightLat(5);
+    surveySet.setBottomRightLon(30);
+    surveySet.setMinZoom(zoom);
+    surveySet.setMaxZoom(zoom);
+    surveySet.setUniqueTileCount(3);
+
+    QGCExportTileTask exportTask({ &defaultSet, &surveySet }, exportPath);
+    QSignalSpy spyExportError(&exportTask, &QGCMapTask::error);
+    source._exportSets(&exportTask);
+    QCOMPARE(spyExportError.count(), 0);
+    source._closeDB();
+
+    // Rows are TMS, y counts up from the bottom
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM tiles")), static_cast<qint64>(3));
+    for (size_t i=0; i<sizeof(xy)/sizeof(xy[0]); i++) {
+        QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT tile_row FROM tiles WHERE zoom_level = %1 AND tile_column = %2").arg(zoom).arg(xy[i].x)),
+                 static_cast<qint64>((1 << zoom) - 1 - xy[i].y));
+    }
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM metadata WHERE name = 'qgc_type' AND value = '%1'").arg(_mapType)),    static_cast<qint64>(1));
+    QCOMPARE(_queryValue(exportPath, QStringLiteral("SELECT COUNT(*) FROM metadata WHERE name = 'bounds' AND value = '20,5,30,10'")),             static_cast<qint64>(1));
+
+    QGCCacheWorker target;
+    QVERIFY(_openWorker(target, targetPath));
+    QGCImportTileTask importTask(exportPath, false /* replace */);
+    QSignalSpy spyImportError(&importTask, &QGCMapTask::error);
+    target._importSets(&importTask);
+    QCOMPARE(spyImportError.count(), 0);
+
+    // Importing flips the rows back, so the tiles come back under their original hashes
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM Tiles")), static_cast<qint64>(3));
+    for (size_t i=0; i<sizeof(xy)/sizeof(xy[0]); i++) {
+        QCOMPARE(_queryValue(targetPath, _tileQuery(QGCMapEngine::getTileHash(_mapType, xy[i].x, xy[i].y, zoom), QByteArray(64, static_cast<char>('a' + i)))), static_cast<qint64>(1));
+    }
+    quint64 importedID = 0;
+    QVERIFY(target._findTileSetID(QStringLiteral("Survey"), importedID));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(importedID)),  static_cast<qint64>(3));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT minZoom FROM TileSets WHERE setID = %1").arg(importedID)),   static_cast<qint64>(zoom));
+
+    // A second import has nothing new and leaves no empty set behind
+    QGCImportTileTask againTask(exportPath, false /* replace */);
+    QSignalSpy spyAgainError(&againTask, &QGCMapTask::error);
+    target._importSets(&againTask);
+    QVERIFY(spyAgainError.count() > 0);
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM TileSets")), static_cast<qint64>(2));
+
+    target._closeDB();
+}
+
+void QGCTileCacheWorkerTest::_mbtilesViewImport_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QString mbtilesPath = tempDir.path() + QStringLiteral("/view.mbtiles");
+    QString targetPath  = tempDir.path() + QStringLiteral("/target.db");
+
+    // Many MBTiles files deduplicate images behind a tiles view, which has no row IDs to walk. Use more tiles than
+    // fit in one import chunk.
+    const int tileCount = 5000;
+    const int zoom      = 7;
+    QString rows = QStringLiteral("WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n WHERE i < %1) ").arg(tileCount - 1);
+    QVERIFY(_execute(mbtilesPath, {
+        QStringLiteral("CREATE TABLE metadata (name TEXT, value TEXT)"),
+        QStringLiteral("CREATE TABLE map (zoom_level INTEGER, tile_column INTEGER, tile_row INTEGER, tile_id INTEGER)"),
+        QStringLiteral("CREATE UNIQUE INDEX map_index ON map (zoom_level, tile_column, tile_row)"),
+        QStringLiteral("CREATE TABLE images (tile_id INTEGER PRIMARY KEY, tile_data BLOB)"),
+        QStringLiteral("CREATE VIEW tiles AS SELECT map.zoom_level AS zoom_level, map.tile_column AS tile_column, map.tile_row AS tile_row, "
+                       "images.tile_data AS tile_data FROM map JOIN images ON images.tile_id = map.tile_id"),
+        QStringLiteral("INSERT INTO metadata(name, value) VALUES('name', '%1'), ('format', 'png')").arg(_mapType),
+        rows + QStringLiteral("INSERT INTO map SELECT %1, i % 128, i / 128, i FROM n").arg(zoom),
+        rows + QStringLiteral("INSERT INTO images SELECT i, CAST(printf('tile%d', i) AS BLOB) FROM n"),
+    }));
+
+    QGCCacheWorker target;
+    QVERIFY(_openWorker(target, targetPath));
+    QGCImportTileTask importTask(mbtilesPath, false /* replace */);
+    QSignalSpy spyProgress(&importTask, &QGCImportTileTask::actionProgress);
+    QSignalSpy spyImportError(&importTask, &QGCMapTask::error);
+    target._importSets(&importTask);
+    QCOMPARE(spyImportError.count(), 0);
+    QVERIFY(spyProgress.count() > 2);
+
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM Tiles")), static_cast<qint64>(tileCount));
+    QCOMPARE(_queryValue(targetPath, _tileQuery(QGCMapEngine::getTileHash(_mapType, 0, 127, zoom), QByteArray("tile0"))),        static_cast<qint64>(1));
+    QCOMPARE(_queryValue(targetPath, _tileQuery(QGCMapEngine::getTileHash(_mapType, 7, 127 - 39, zoom), QByteArray("tile4999"))), static_cast<qint64>(1));
+
+    // A file named after its map type gets the file name for a set name
+    quint64 importedID = 0;
+    QVERIFY(target._findTileSetID(QStringLiteral("view"), importedID));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT COUNT(*) FROM SetTiles WHERE setID = %1").arg(importedID)),  static_cast<qint64>(tileCount));
+    QCOMPARE(_queryValue(targetPath, QStringLiteral("SELECT numTiles FROM TileSets WHERE setID = %1").arg(importedID)),  static_cast<qint64>(tileCount));
+
+    target._closeDB();
+}
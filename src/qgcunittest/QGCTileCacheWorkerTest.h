@@ -0,0 +1,41 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "QGCTileCacheWorker.h"
+
+#include <QTemporaryDir>
+
+/// Unit test for the QGCCacheWorker tile database. Worker methods are called directly on the test thread, the worker
+/// thread itself is never started.
+class QGCTileCacheWorkerTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _batchedInserts_test       (void);
+    void _incrementalTotals_test    (void);
+    void _qgcSetsRoundTrip_test     (void);
+    void _mbtilesRoundTrip_test     (void);
+    void _mbtilesViewImport_test    (void);
+
+private:
+    bool    _openWorker     (QGCCacheWorker& worker, const QString& databasePath);
+    void    _saveTile       (QGCCacheWorker& worker, const QString& hash, int size, qulonglong setID = UINT64_MAX);
+    void    _saveTile       (QGCCacheWorker& worker, const QString& hash, const QByteArray& img, qulonglong setID);
+    /// Runs a single value query against a database on a connection of its own
+    /// @return -1 if the query failed
+    qint64  _queryValue     (const QString& databasePath, const QString& sql);
+    /// Runs statements against a database on a connection of its own, in a single transaction
+    bool    _execute        (const QString& databasePath, const QStringList& statements);
+    /// @return Query for a tile with the specified hash and image, for use with _queryValue
+    QString _tileQuery      (const QString& hash, const QByteArray& img);
+};
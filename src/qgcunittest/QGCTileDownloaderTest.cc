@@ -0,0 +1,192 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "QGCTileDownloaderTest.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QEventLoop>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <memory>
+
+/// Stand-in tile server. Answers every GET with the same tile after a fixed delay, on its own thread.
+class TileServer
+{
+public:
+    TileServer(int latencyMSecs, int statusCode = 200)
+        : _server(new QTcpServer)
+        , _latencyMSecs(latencyMSecs)
+        , _statusCode(statusCode)
+        , _requestCount(0)
+    {
+        _tile = QByteArray("\x89PNG\r\n\x1a\n", 8) + QByteArray(8 * 1024, 'x');
+        _server->moveToThread(&_thread);
+        QObject::connect(&_thread, &QThread::finished, _server, &QObject::deleteLater);
+        QObject::connect(_server, &QTcpServer::newConnection, _server, [this]() { _newConnection(); });
+        _thread.start();
+        QMetaObject::invokeMethod(_server, [this]() { _server->listen(QHostAddress::LocalHost); }, Qt::BlockingQueuedConnection);
+    }
+
+    ~TileServer()
+    {
+        _thread.quit();
+        _thread.wait();
+    }
+
+    quint16 port        () const { return _server->serverPort(); }
+    int     requestCount() const { return _requestCount; }
+
+private:
+    void _newConnection()
+    {
+        while (QTcpSocket* socket = _server->nextPendingConnection()) {
+            std::shared_ptr<QByteArray> buffer(new QByteArray);
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket, buffer]() {
+                buffer->append(socket->readAll());
+                int end;
+                while ((end = buffer->indexOf("\r\n\r\n")) >= 0) {
+                    buffer->remove(0, end + 4);
+                    _requestCount++;
+                    QTimer::singleShot(_latencyMSecs, socket, [this, socket]() { _respond(socket); });
+                }
+            });
+        }
+    }
+
+    void _respond(QTcpSocket* socket)
+    {
+        QByteArray body = _statusCode == 200 ? _tile : QByteArray();
+        QByteArray response = QString("HTTP/1.1 %1 %2\r\nContent-Type: image/png\r\nContent-Length: %3\r\n\r\n")
+                .arg(_statusCode).arg(_statusCode == 200 ? "OK" : "Service Unavailable").arg(body.size()).toLatin1();
+        socket->write(response + body);
+    }
+
+    QThread             _thread;
+    QTcpServer*         _server;
+    QByteArray          _tile;
+    int                 _latencyMSecs;
+    int                 _statusCode;
+    std::atomic<int>    _requestCount;
+};
+
+void QGCTileDownloaderTest::init(void)
+{
+    UnitTest::init();
+    // Each test starts from the configured concurrency
+    QGCTileDownloader::resetLearnedConcurrency();
+}
+
+int QGCTileDownloaderTest::_download(quint16 port, int tileCount, int initialConcurrency, int maxConcurrency, int* failed, double* tilesPerSec, int* finalConcurrency)
+{
+    QNetworkAccessManager networkManager;
+    QGCTileDownloader downloader("Test", initialConcurrency, maxConcurrency, &networkManager, [port](const QGCTile& tile) {
+        return QNetworkRequest(QUrl(QString("http://127.0.0.1:%1/%2/%3/%4.png").arg(port).arg(tile.z()).arg(tile.x()).arg(tile.y())));
+    });
+
+    int         delivered   = 0;
+    int         errors      = 0;
+    int         enqueued    = 0;
+    QEventLoop  loop;
+    QTimer      timeout;
+
+    auto refill = [&]() {
+        // Feed the downloader in batches, the way the tile set does
+        QList<QGCTile*> tiles;
+        while (enqueued < tileCount && tiles.count() < 256) {
+            QGCTile* tile = new QGCTile;
+            tile->setX(enqueued);
+            tile->setY(enqueued);
+            tile->setZ(18);
+            tile->setHash(QString::number(enqueued));
+            tiles.append(tile);
+            enqueued++;
+        }
+        if (!tiles.isEmpty()) {
+            downloader.enqueue(tiles);
+        }
+    };
+    auto checkDone = [&]() {
+        if (delivered + errors == tileCount) {
+            loop.quit();
+        }
+    };
+    connect(&downloader, &QGCTileDownloader::queueLow, &loop, [&]() { QTimer::singleShot(0, &loop, refill); });
+    connect(&downloader, &QGCTileDownloader::tileDownloaded, &loop, [&](const QString&, const QByteArray& data) {
+        if (!data.isEmpty()) {
+            delivered++;
+        }
+        checkDone();
+    });
+    connect(&downloader, &QGCTileDownloader::tileFailed, &loop, [&]() { errors++; checkDone(); });
+    timeout.setSingleShot(true);
+    connect(&timeout, &QTimer::timeout, &loop, [&]() { loop.exit(1); });
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    refill();
+    timeout.start(60 * 1000);
+    bool timedOut = loop.exec() != 0;
+
+    if (failed) {
+        *failed = errors;
+    }
+    if (tilesPerSec) {
+        *tilesPerSec = (delivered * 1000.0) / qMax(static_cast<qint64>(1), elapsed.elapsed());
+    }
+    if (finalConcurrency) {
+        *finalConcurrency = downloader.concurrency();
+    }
+    return timedOut ? -1 : delivered;
+}
+
+void QGCTileDownloaderTest::_downloadAll_test(void)
+{
+    TileServer server(5);
+    int failed;
+
+    QCOMPARE(_download(server.port(), 300, 4, 8, &failed, nullptr, nullptr), 300);
+    QCOMPARE(failed, 0);
+    QCOMPARE(server.requestCount(), 300);
+}
+
+void QGCTileDownloaderTest::_backoff_test(void)
+{
+    // A server that is out of capacity must drive concurrency all the way down
+    TileServer server(5, 503);
+    int failed;
+    int concurrency;
+
+    QCOMPARE(_download(server.port(), 100, 8, 8, &failed, nullptr, &concurrency), 0);
+    QCOMPARE(failed, 100);
+    QCOMPARE(concurrency, 1);
+}
+
+void QGCTileDownloaderTest::_throughput_test(void)
+{
+    // 20 msec per tile approximates a nearby CDN. With latency dominated by the server, parallel requests have to
+    // beat a single request at a time by a wide margin whatever machine runs the test. QNetworkAccessManager caps
+    // connections per host at 6, so that is the most parallelism either downloader can get here.
+    const int   tileCount = 500;
+    TileServer  server(20);
+    double      serialRate, fixedRate, adaptiveRate;
+
+    QCOMPARE(_download(server.port(), tileCount / 10, 1, 1, nullptr, &serialRate, nullptr), tileCount / 10);
+    QGCTileDownloader::resetLearnedConcurrency();
+    QCOMPARE(_download(server.port(), tileCount, 12, 12, nullptr, &fixedRate, nullptr), tileCount);
+    QGCTileDownloader::resetLearnedConcurrency();
+    QCOMPARE(_download(server.port(), tileCount, 12, 24, nullptr, &adaptiveRate, nullptr), tileCount);
+
+    QVERIFY2(fixedRate > serialRate * 3, qPrintable(QString("serial %1 fixed %2 tiles/sec").arg(serialRate).arg(fixedRate)));
+    QVERIFY2(adaptiveRate > serialRate * 3, qPrintable(QString("serial %1 adaptive %2 tiles/sec").arg(serialRate).arg(adaptiveRate)));
+}
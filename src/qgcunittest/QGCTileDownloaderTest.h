@@ -0,0 +1,30 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "QGCTileDownloader.h"
+
+/// Unit test for QGCTileDownloader against a local stand-in tile server
+class QGCTileDownloaderTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void init                   (void) override;
+
+    void _downloadAll_test      (void);
+    void _backoff_test          (void);
+    void _throughput_test       (void);
+
+private:
+    /// Downloads tileCount tiles, returns the number delivered or -1 on timeout
+    int _download(quint16 port, int tileCount, int initialConcurrency, int maxConcurrency, int* failed, double* tilesPerSec, int* finalConcurrency);
+};
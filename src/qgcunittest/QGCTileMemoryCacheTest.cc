@@ -0,0 +1,134 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "QGCTileMemoryCacheTest.h"
+
+static const QString    _format     = QStringLiteral("png");
+static const int        _tileSize   = 1000;
+static const quint64    _tileCost   = _tileSize + 3 * sizeof(QChar) + 128;    ///< Image, format and bookkeeping
+
+static QByteArray _tile(char fill, int size = _tileSize)
+{
+    return QByteArray(size, fill);
+}
+
+void QGCTileMemoryCacheTest::_costAccounting_test(void)
+{
+    QGCTileMemoryCache cache(1024 * 1024);
+
+    cache.insert(QStringLiteral("a"), _tile('a'), _format);
+    QGCTileMemoryCacheStats stats = cache.stats();
+    QCOMPARE(stats.count,   1);
+    QCOMPARE(stats.size,    _tileCost);
+    QCOMPARE(stats.maxSize, static_cast<quint64>(1024 * 1024));
+
+    // Replacing a tile charges the new image only
+    cache.insert(QStringLiteral("a"), _tile('b', _tileSize / 2), _format);
+    stats = cache.stats();
+    QCOMPARE(stats.count,   1);
+    QCOMPARE(stats.size,    _tileCost - _tileSize / 2);
+
+    // Empty images are never cached
+    cache.insert(QStringLiteral("empty"), QByteArray(), _format);
+    QCOMPARE(cache.stats().count, 1);
+
+    QByteArray  img;
+    QString     format;
+    QVERIFY(cache.find(QStringLiteral("a"), img, format));
+    QCOMPARE(img,       _tile('b', _tileSize / 2));
+    QCOMPARE(format,    _format);
+    QVERIFY(!cache.find(QStringLiteral("empty"), img, format));
+    QCOMPARE(img,       _tile('b', _tileSize / 2));
+
+    cache.remove(QStringLiteral("a"));
+    QVERIFY(!cache.find(QStringLiteral("a"), img, format));
+
+    stats = cache.stats();
+    QCOMPARE(stats.count,       0);
+    QCOMPARE(stats.size,        static_cast<quint64>(0));
+    QCOMPARE(stats.hits,        static_cast<quint64>(1));
+    QCOMPARE(stats.misses,      static_cast<quint64>(2));
+    QCOMPARE(stats.evictions,   static_cast<quint64>(0));
+}
+
+void QGCTileMemoryCacheTest::_eviction_test(void)
+{
+    QGCTileMemoryCache cache(3 * _tileCost);
+
+    cache.insert(QStringLiteral("0"), _tile('0'), _format);
+    cache.insert(QStringLiteral("1"), _tile('1'), _format);
+    cache.insert(QStringLiteral("2"), _tile('2'), _format);
+    QCOMPARE(cache.stats().count, 3);
+
+    // A lookup makes the tile most recently used, so the next insert pushes out the one after it
+    QByteArray  img;
+    QString     format;
+    QVERIFY(cache.find(QStringLiteral("0"), img, format));
+    cache.insert(QStringLiteral("3"), _tile('3'), _format);
+
+    QGCTileMemoryCacheStats stats = cache.stats();
+    QCOMPARE(stats.count,       3);
+    QCOMPARE(stats.size,        3 * _tileCost);
+    QCOMPARE(stats.evictions,   static_cast<quint64>(1));
+    QVERIFY(!cache.find(QStringLiteral("1"), img, format));
+    QVERIFY(cache.find(QStringLiteral("0"), img, format));
+    QVERIFY(cache.find(QStringLiteral("2"), img, format));
+    QVERIFY(cache.find(QStringLiteral("3"), img, format));
+
+    // A tile larger than the whole budget is dropped without disturbing what is cached
+    cache.insert(QStringLiteral("big"), _tile('b', static_cast<int>(3 * _tileCost)), _format);
+    stats = cache.stats();
+    QCOMPARE(stats.count,       3);
+    QCOMPARE(stats.evictions,   static_cast<quint64>(1));
+    QVERIFY(!cache.find(QStringLiteral("big"), img, format));
+
+    cache.clear();
+    QCOMPARE(cache.stats().count,   0);
+    QCOMPARE(cache.stats().size,    static_cast<quint64>(0));
+}
+
+void QGCTileMemoryCacheTest::_setMaxSize_test(void)
+{
+    QGCTileMemoryCache cache(4 * _tileCost);
+
+    for (int i=0; i<4; i++) {
+        cache.insert(QString::number(i), _tile(static_cast<char>('0' + i)), _format);
+    }
+    QCOMPARE(cache.stats().count, 4);
+
+    // Shrinking evicts least recently used tiles down to the new budget
+    cache.setMaxSize(2 * _tileCost);
+    QGCTileMemoryCacheStats stats = cache.stats();
+    QCOMPARE(stats.count,       2);
+    QCOMPARE(stats.size,        2 * _tileCost);
+    QCOMPARE(stats.maxSize,     2 * _tileCost);
+    QCOMPARE(stats.evictions,   static_cast<quint64>(2));
+
+    QByteArray  img;
+    QString     format;
+    QVERIFY(!cache.find(QStringLiteral("0"), img, format));
+    QVERIFY(!cache.find(QStringLiteral("1"), img, format));
+    QVERIFY(cache.find(QStringLiteral("2"), img, format));
+    QVERIFY(cache.find(QStringLiteral("3"), img, format));
+
+    // Growing keeps everything
+    cache.setMaxSize(8 * _tileCost);
+    QCOMPARE(cache.stats().count,       2);
+    QCOMPARE(cache.stats().evictions,   static_cast<quint64>(2));
+
+    // The budget is clamped to what QCache can represent
+    cache.setMaxSize(4ULL * 1024 * 1024 * 1024);
+    QCOMPARE(cache.stats().maxSize, static_cast<quint64>(1024 * 1024 * 1024));
+
+    // Zero disables the cache
+    cache.setMaxSize(0);
+    QCOMPARE(cache.stats().count, 0);
+    cache.insert(QStringLiteral("0"), _tile('0'), _format);
+    QCOMPARE(cache.stats().count, 0);
+}
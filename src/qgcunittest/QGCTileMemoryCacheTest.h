@@ -0,0 +1,24 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "QGCTileMemoryCache.h"
+
+/// Unit test for QGCTileMemoryCache cost accounting and LRU eviction
+class QGCTileMemoryCacheTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _costAccounting_test   (void);
+    void _eviction_test         (void);
+    void _setMaxSize_test       (void);
+};
@@ -0,0 +1,181 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TelemetryLogWriterTest.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QtEndian>
+
+namespace {
+
+/// Holds the writer thread inside its file write until the gate is unlocked
+class StalledFile : public QFile
+{
+public:
+    StalledFile(const QString& name) : QFile(name) { }
+
+    QMutex gate;
+
+protected:
+    qint64 writeData(const char* data, qint64 length) override
+    {
+        QMutexLocker locker(&gate);
+        return QFile::writeData(data, length);
+    }
+};
+
+/// Fails every write, the way a full disk does
+class FailingFile : public QFile
+{
+public:
+    FailingFile(const QString& name) : QFile(name) { }
+
+protected:
+    qint64 writeData(const char*, qint64) override
+    {
+        setErrorString(QStringLiteral("No space left on device"));
+        return -1;
+    }
+};
+
+}
+
+QByteArray TelemetryLogWriterTest::_record(quint64 timestampUsecs, const QByteArray& packet)
+{
+    QByteArray record(sizeof(quint64), Qt::Uninitialized);
+    qToBigEndian(timestampUsecs, reinterpret_cast<uchar*>(record.data()));
+    return record + packet;
+}
+
+void TelemetryLogWriterTest::_recordFraming_test(void)
+{
+    QTemporaryDir       dir;
+    QFile               file(dir.filePath(QStringLiteral("framing.tlog")));
+    TelemetryLogWriter  writer(256 * 1024, 0);
+    QByteArray          expected;
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    writer.startWriting(&file);
+
+    // Enough records of varying length that the ring buffer wraps several times
+    for (int i=0; i<5000; i++) {
+        QByteArray packet(1 + (i % 280), static_cast<char>(i));
+        quint64 timestamp = 1000000ULL * static_cast<quint64>(i) + 0x0102030405ULL;
+        while (!writer.writeRecord(timestamp, packet.constData(), packet.length())) {
+            // Buffer is full, give the writer a chance to catch up. Nothing is dropped from the expected output.
+            QThread::msleep(1);
+        }
+        expected += _record(timestamp, packet);
+    }
+
+    writer.stopWriting();
+    file.close();
+    QVERIFY(!writer.isWriting());
+    QCOMPARE(writer.bytesWritten(), static_cast<quint64>(expected.length()));
+
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray written = file.readAll();
+    QCOMPARE(written.length(), expected.length());
+    QVERIFY(written == expected);
+}
+
+void TelemetryLogWriterTest::_fsyncInterval_test(void)
+{
+    QTemporaryDir   dir;
+    const char      packet[] = { 1, 2, 3, 4 };
+
+    // Interval of 0 only syncs when writing stops
+    {
+        QFile               file(dir.filePath(QStringLiteral("nosync.tlog")));
+        TelemetryLogWriter  writer(0, 0);
+
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        writer.startWriting(&file);
+        QVERIFY(writer.writeRecord(1, packet, sizeof(packet)));
+        QTRY_COMPARE(writer.bytesWritten(), static_cast<quint64>(sizeof(quint64) + sizeof(packet)));
+        QTest::qWait(500);
+        QCOMPARE(writer.syncCount(), 0U);
+        writer.stopWriting();
+        QCOMPARE(writer.syncCount(), 1U);
+    }
+
+    // A short interval syncs repeatedly while writing
+    {
+        QFile               file(dir.filePath(QStringLiteral("sync.tlog")));
+        TelemetryLogWriter  writer(0, 50);
+
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        writer.startWriting(&file);
+        QVERIFY(writer.writeRecord(1, packet, sizeof(packet)));
+        QTRY_VERIFY(writer.syncCount() >= 2);
+        writer.stopWriting();
+    }
+}
+
+void TelemetryLogWriterTest::_droppedRecords_test(void)
+{
+    QTemporaryDir       dir;
+    StalledFile         file(dir.filePath(QStringLiteral("stalled.tlog")));
+    TelemetryLogWriter  writer(0, 0);
+    QByteArray          packet(100, 'x');
+    QByteArray          expected;
+    const int           recordLength = static_cast<int>(sizeof(quint64)) + packet.length();
+
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.gate.lock();
+    writer.startWriting(&file);
+
+    // Storage is stalled so the buffer fills and records are dropped instead of blocking
+    quint64 timestamp = 0;
+    while (writer.writeRecord(timestamp, packet.constData(), packet.length())) {
+        expected += _record(timestamp++, packet);
+    }
+    QCOMPARE(writer.droppedRecords(), 1ULL);
+    for (int i=0; i<10; i++) {
+        QVERIFY(!writer.writeRecord(timestamp, packet.constData(), packet.length()));
+    }
+    QCOMPARE(writer.droppedRecords(), 11ULL);
+
+    // Smallest buffer is a single write block
+    QVERIFY(expected.length() <= 64 * 1024);
+    QVERIFY(expected.length() > 64 * 1024 - recordLength);
+
+    // Once storage catches up everything which was accepted is written, in order
+    file.gate.unlock();
+    writer.stopWriting();
+    file.close();
+
+    QFile readFile(file.fileName());
+    QVERIFY(readFile.open(QIODevice::ReadOnly));
+    QVERIFY(readFile.readAll() == expected);
+}
+
+void TelemetryLogWriterTest::_writeError_test(void)
+{
+    QTemporaryDir       dir;
+    FailingFile         file(dir.filePath(QStringLiteral("failing.tlog")));
+    TelemetryLogWriter  writer(0, 0);
+    QSignalSpy          errorSpy(&writer, &TelemetryLogWriter::writeError);
+    QByteArray          packet(100, 'x');
+
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+    writer.startWriting(&file);
+    QVERIFY(writer.writeRecord(1, packet.constData(), packet.length()));
+
+    // The writer gives up after the first failed write and later records are refused
+    QTRY_COMPARE(errorSpy.count(), 1);
+    QCOMPARE(errorSpy[0][0].toString(), QStringLiteral("No space left on device"));
+    QVERIFY(!writer.writeRecord(2, packet.constData(), packet.length()));
+
+    writer.stopWriting();
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(writer.bytesWritten(), 0ULL);
+}
@@ -0,0 +1,28 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "TelemetryLogWriter.h"
+
+/// Unit test for TelemetryLogWriter record framing, syncing, overflow and write failures
+class TelemetryLogWriterTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _recordFraming_test    (void);
+    void _fsyncInterval_test    (void);
+    void _droppedRecords_test   (void);
+    void _writeError_test       (void);
+
+private:
+    QByteArray _record(quint64 timestampUsecs, const QByteArray& packet);
+};
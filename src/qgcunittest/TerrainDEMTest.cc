@@ -0,0 +1,195 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainDEMTest.h"
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QtEndian>
+
+bool TerrainDEMTest::_writeHGT(const QString& dir)
+{
+    const qint16 grid[9] = {
+        0,  10, 20,
+        30, 40, 50,
+        60, 70, -32768,
+    };
+
+    QByteArray bytes;
+    for (qint16 value: grid) {
+        char valueBytes[2];
+        qToBigEndian(value, valueBytes);
+        bytes.append(valueBytes, 2);
+    }
+
+    QFile file(dir + QStringLiteral("/N37W122.hgt"));
+    return file.open(QFile::WriteOnly) && file.write(bytes) == bytes.count();
+}
+
+bool TerrainDEMTest::_writeTIFF(const QString& path, int compression)
+{
+    const float     samples[6]      = { 100, 110, 120, 200, 210, -9999 };
+    const double    pixelScale[3]   = { 0.5, 0.5, 0 };
+    const double    tiepoint[6]     = { 0, 0, 0, 10, 46, 0 };
+    // Geographic model, pixel is point
+    const quint16   geoKeys[12]     = { 1, 1, 0, 2, 1024, 0, 1, 2, 1025, 0, 1, 2 };
+    const char      noData[]        = "-9999";
+
+    const int       entryCount      = 12;
+    const quint32   ifdOffset       = 8;
+    const quint32   extraOffset     = ifdOffset + 2 + (entryCount * 12) + 4;
+    const quint32   scaleOffset     = extraOffset;
+    const quint32   tiepointOffset  = scaleOffset + sizeof(pixelScale);
+    const quint32   geoKeysOffset   = tiepointOffset + sizeof(tiepoint);
+    const quint32   noDataOffset    = geoKeysOffset + sizeof(geoKeys);
+    const quint32   dataOffset      = noDataOffset + sizeof(noData) + 1;
+
+    QByteArray bytes(static_cast<int>(dataOffset + sizeof(samples)), 0);
+    uchar* data = reinterpret_cast<uchar*>(bytes.data());
+
+    memcpy(data, "II", 2);
+    qToLittleEndian<quint16>(42, data + 2);
+    qToLittleEndian<quint32>(ifdOffset, data + 4);
+    qToLittleEndian<quint16>(entryCount, data + ifdOffset);
+
+    int entry = 0;
+    auto addEntry = [&](quint16 tag, quint16 type, quint32 count, quint32 value) {
+        uchar* p = data + ifdOffset + 2 + (entry++ * 12);
+        qToLittleEndian<quint16>(tag, p);
+        qToLittleEndian<quint16>(type, p + 2);
+        qToLittleEndian<quint32>(count, p + 4);
+        if (type == 3 && count == 1) {
+            qToLittleEndian<quint16>(static_cast<quint16>(value), p + 8);
+        } else {
+            qToLittleEndian<quint32>(value, p + 8);
+        }
+    };
+    addEntry(256,   3,  1,  3);                         // ImageWidth
+    addEntry(257,   3,  1,  2);                         // ImageLength
+    addEntry(258,   3,  1,  32);                        // BitsPerSample
+    addEntry(259,   3,  1,  static_cast<quint32>(compression));
+    addEntry(273,   4,  1,  dataOffset);                // StripOffsets
+    addEntry(277,   3,  1,  1);                         // SamplesPerPixel
+    addEntry(278,   3,  1,  2);                         // RowsPerStrip
+    addEntry(339,   3,  1,  3);                         // SampleFormat: float
+    addEntry(33550, 12, 3,  scaleOffset);               // ModelPixelScale
+    addEntry(33922, 12, 6,  tiepointOffset);            // ModelTiepoint
+    addEntry(34735, 3,  12, geoKeysOffset);             // GeoKeyDirectory
+    addEntry(42113, 2,  sizeof(noData), noDataOffset);  // GDAL_NODATA
+
+    auto putDouble = [](double value, uchar* p) {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian(bits, p);
+    };
+    auto putFloat = [](float value, uchar* p) {
+        quint32 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        qToLittleEndian(bits, p);
+    };
+    for (int i = 0; i < 3; i++) {
+        putDouble(pixelScale[i], data + scaleOffset + (i * 8));
+    }
+    for (int i = 0; i < 6; i++) {
+        putDouble(tiepoint[i], data + tiepointOffset + (i * 8));
+    }
+    for (int i = 0; i < 12; i++) {
+        qToLittleEndian(geoKeys[i], data + geoKeysOffset + (i * 2));
+    }
+    // GDAL writes the nodata string with its terminating nul included in the count
+    memcpy(data + noDataOffset, noData, sizeof(noData));
+    for (int i = 0; i < 6; i++) {
+        putFloat(samples[i], data + dataOffset + (i * 4));
+    }
+
+    QFile file(path);
+    return file.open(QFile::WriteOnly) && file.write(bytes) == bytes.count();
+}
+
+void TerrainDEMTest::_compareHeights(const TerrainDEMStore& store, const QList<QGeoCoordinate>& coordinates, const QList<double>& expectedHeights)
+{
+    QList<double> heights;
+    QVERIFY(store.heights(coordinates, heights));
+    QCOMPARE(heights.count(), expectedHeights.count());
+    for (int i = 0; i < heights.count(); i++) {
+        QVERIFY2(qAbs(heights[i] - expectedHeights[i]) < 1e-6, qPrintable(QStringLiteral("%1: %2 != %3").arg(i).arg(heights[i]).arg(expectedHeights[i])));
+    }
+}
+
+void TerrainDEMTest::_hgt_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QVERIFY(_writeHGT(tempDir.path()));
+
+    TerrainDEMStore store;
+    store.setPath(tempDir.path());
+    QCOMPARE(store.fileCount(), 1);
+
+    QList<QGeoCoordinate> coordinates;
+    QList<double> expectedHeights;
+    coordinates << QGeoCoordinate(38, -122)         << QGeoCoordinate(37.5, -121.5)     << QGeoCoordinate(38, -121.75)
+                << QGeoCoordinate(37.75, -121.75)   << QGeoCoordinate(37, -122);
+    expectedHeights << 0 << 40 << 5 << 20 << 60;
+    _compareHeights(store, coordinates, expectedHeights);
+
+    // The void in the south east corner falls back to the nearest corner with data
+    coordinates.clear();
+    expectedHeights.clear();
+    coordinates << QGeoCoordinate(37, -121);
+    expectedHeights << 50;
+    _compareHeights(store, coordinates, expectedHeights);
+
+    // Any coordinate outside the files fails the whole request
+    QList<double> heights;
+    coordinates << QGeoCoordinate(36.5, -121.5);
+    QVERIFY(!store.heights(coordinates, heights));
+    QVERIFY(heights.isEmpty());
+}
+
+void TerrainDEMTest::_geoTiff_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    QVERIFY(_writeTIFF(tempDir.path() + QStringLiteral("/dem.tif"), 1));
+
+    TerrainDEMStore store;
+    store.setPath(tempDir.path());
+    QCOMPARE(store.fileCount(), 1);
+
+    QList<QGeoCoordinate> coordinates;
+    QList<double> expectedHeights;
+    coordinates << QGeoCoordinate(46, 10)       << QGeoCoordinate(46, 10.25)    << QGeoCoordinate(45.75, 10)
+                << QGeoCoordinate(45.75, 10.25);
+    expectedHeights << 100 << 105 << 150 << 155;
+    _compareHeights(store, coordinates, expectedHeights);
+
+    // Next to the nodata sample in the south east corner the nearest valid corner is used
+    coordinates.clear();
+    expectedHeights.clear();
+    coordinates << QGeoCoordinate(45.5, 10.5) << QGeoCoordinate(46, 11);
+    expectedHeights << 210 << 120;
+    _compareHeights(store, coordinates, expectedHeights);
+}
+
+void TerrainDEMTest::_unsupportedTiff_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+    // LZW compressed files are skipped, the rest of the directory is still used
+    QVERIFY(_writeTIFF(tempDir.path() + QStringLiteral("/compressed.tif"), 5));
+    QVERIFY(_writeHGT(tempDir.path()));
+
+    TerrainDEMStore store;
+    store.setPath(tempDir.path());
+    QCOMPARE(store.fileCount(), 1);
+
+    QList<double> heights;
+    QVERIFY(!store.heights(QList<QGeoCoordinate>() << QGeoCoordinate(46, 10), heights));
+}
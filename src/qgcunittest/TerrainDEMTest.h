@@ -0,0 +1,34 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "TerrainDEM.h"
+
+/// Unit test for sampling local HGT and GeoTIFF elevation files through TerrainDEMStore
+class TerrainDEMTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _hgt_test              (void);
+    void _geoTiff_test          (void);
+    void _unsupportedTiff_test  (void);
+
+private:
+    /// Writes a 3x3 SRTM grid covering N37-38 W121-122, with a void in the south east corner
+    bool _writeHGT(const QString& dir);
+
+    /// Writes a little endian float32 GeoTIFF, 3 columns by 2 rows at 0.5 degree spacing from N46 E10, with a
+    /// GDAL nodata value in the south east corner
+    bool _writeTIFF(const QString& path, int compression);
+
+    void _compareHeights(const TerrainDEMStore& store, const QList<QGeoCoordinate>& coordinates, const QList<double>& expectedHeights);
+};
@@ -0,0 +1,131 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainQueryTest.h"
+#include "TerrainQuery.h"
+#include "QGroundControlQmlGlobal.h"
+
+#include <QSignalSpy>
+
+namespace {
+
+/// Records group requests instead of sending them, the test answers them by emitting coordinateHeightsReceived
+class RecordedGroupQuery : public TerrainQueryInterface
+{
+public:
+    RecordedGroupQuery(QObject* parent, bool highPriority)
+        : TerrainQueryInterface (parent)
+        , highPriority          (highPriority)
+    { }
+
+    void requestCoordinateHeights   (const QList<QGeoCoordinate>& coordinates) final { this->coordinates = coordinates; }
+    void requestPathHeights         (const QGeoCoordinate&, const QGeoCoordinate&) final { }
+    void requestCarpetHeights       (const QGeoCoordinate&, const QGeoCoordinate&, bool) final { }
+
+    bool                    highPriority;
+    QList<QGeoCoordinate>   coordinates;
+};
+
+class RecordingScheduler : public TerrainAtCoordinateScheduler
+{
+public:
+    /// Group queries in the order they were sent
+    QList<QPointer<RecordedGroupQuery>> groupQueries;
+
+protected:
+    TerrainQueryInterface* _createGroupQuery(bool highPriority) final
+    {
+        RecordedGroupQuery* groupQuery = new RecordedGroupQuery(this, highPriority);
+        groupQueries.append(groupQuery);
+        return groupQuery;
+    }
+};
+
+}
+
+QGeoCoordinate TerrainQueryTest::_coordinateFromMapCenter(double meters)
+{
+    QGeoCoordinate mapCenter = QGroundControlQmlGlobal::flightMapPosition();
+    if (!mapCenter.isValid()) {
+        mapCenter = QGeoCoordinate(0, 0);
+    }
+    return mapCenter.atDistanceAndAzimuth(meters, 90);
+}
+
+void TerrainQueryTest::_coalesce_test(void)
+{
+    qRegisterMetaType<QList<double>>();
+
+    RecordingScheduler          scheduler;
+    TerrainAtCoordinateQuery    queryA;
+    TerrainAtCoordinateQuery    queryB;
+    TerrainAtCoordinateQuery    queryC;
+    QSignalSpy                  spyA(&queryA, &TerrainAtCoordinateQuery::terrainDataReceived);
+    QSignalSpy                  spyB(&queryB, &TerrainAtCoordinateQuery::terrainDataReceived);
+
+    // B only shares its second coordinate's tile with A, C shares nothing
+    QList<QGeoCoordinate> coordinatesA = { _coordinateFromMapCenter(2000), _coordinateFromMapCenter(20000) };
+    QList<QGeoCoordinate> coordinatesB = { _coordinateFromMapCenter(30000), _coordinateFromMapCenter(20000) };
+    QList<QGeoCoordinate> coordinatesC = { _coordinateFromMapCenter(40000) };
+
+    scheduler.addQuery(&queryA, coordinatesA, false);
+    scheduler.addQuery(&queryB, coordinatesB, false);
+    scheduler.addQuery(&queryC, coordinatesC, false);
+
+    QTRY_COMPARE(scheduler.groupQueries.count(), 2);
+    QCOMPARE(scheduler.stats().coalesced, static_cast<quint64>(1));
+    QCOMPARE(scheduler.stats().groupsSent, static_cast<quint64>(2));
+
+    RecordedGroupQuery* groupQuery = scheduler.groupQueries[0];
+    QVERIFY(groupQuery);
+    QVERIFY(groupQuery->coordinates == coordinatesA + coordinatesB);
+    QVERIFY(scheduler.groupQueries[1]->coordinates == coordinatesC);
+
+    // Each query gets back just its own slice of the group reply
+    emit groupQuery->coordinateHeightsReceived(true, { 1, 2, 3, 4 });
+    QCOMPARE(spyA.count(), 1);
+    QCOMPARE(spyB.count(), 1);
+    QCOMPARE(spyA[0][0].toBool(), true);
+    QCOMPARE(spyA[0][1].value<QList<double>>(), QList<double>({ 1, 2 }));
+    QCOMPARE(spyB[0][1].value<QList<double>>(), QList<double>({ 3, 4 }));
+}
+
+void TerrainQueryTest::_dispatchOrder_test(void)
+{
+    RecordingScheduler          scheduler;
+    TerrainAtCoordinateQuery    queries[6];
+
+    // Queued furthest first so sending in queued order would fail
+    const double distances[5] = { 10000, 8000, 6000, 4000, 2000 };
+    for (int i = 0; i < 5; i++) {
+        scheduler.addQuery(&queries[i], { _coordinateFromMapCenter(distances[i]) }, false);
+    }
+
+    QTRY_COMPARE(scheduler.groupQueries.count(), static_cast<int>(TerrainAtCoordinateScheduler::maxGroupsInFlight));
+    for (int i = 0; i < TerrainAtCoordinateScheduler::maxGroupsInFlight; i++) {
+        QVERIFY(scheduler.groupQueries[i]->coordinates == QList<QGeoCoordinate>({ _coordinateFromMapCenter(distances[4 - i]) }));
+    }
+
+    // Nothing more goes out while the in flight limit is reached, even high priority
+    QGeoCoordinate highPriorityCoordinate = _coordinateFromMapCenter(50000);
+    scheduler.addQuery(&queries[5], { highPriorityCoordinate }, true);
+    QTest::qWait(100);
+    QCOMPARE(scheduler.groupQueries.count(), static_cast<int>(TerrainAtCoordinateScheduler::maxGroupsInFlight));
+
+    // High priority beats the closer queued group
+    emit scheduler.groupQueries[0]->coordinateHeightsReceived(true, { 0 });
+    QTRY_COMPARE(scheduler.groupQueries.count(), TerrainAtCoordinateScheduler::maxGroupsInFlight + 1);
+    QVERIFY(scheduler.groupQueries[4]->highPriority);
+    QVERIFY(scheduler.groupQueries[4]->coordinates == QList<QGeoCoordinate>({ highPriorityCoordinate }));
+
+    emit scheduler.groupQueries[1]->coordinateHeightsReceived(true, { 0 });
+    QTRY_COMPARE(scheduler.groupQueries.count(), TerrainAtCoordinateScheduler::maxGroupsInFlight + 2);
+    QVERIFY(!scheduler.groupQueries[5]->highPriority);
+    QVERIFY(scheduler.groupQueries[5]->coordinates == QList<QGeoCoordinate>({ _coordinateFromMapCenter(distances[0]) }));
+}
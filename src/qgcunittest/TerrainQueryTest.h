@@ -0,0 +1,28 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+#include <QGeoCoordinate>
+
+/// Unit test for how TerrainAtCoordinateScheduler groups and orders queries
+class TerrainQueryTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _coalesce_test     (void);
+    void _dispatchOrder_test(void);
+
+private:
+    /// @return Coordinate the specified distance east of the map center, so each one falls in a different tile
+    QGeoCoordinate _coordinateFromMapCenter(double meters);
+};
@@ -0,0 +1,42 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileBenchmark.h"
+#include "TerrainTileTest.h"
+
+void TerrainTileBenchmark::initTestCase(void)
+{
+    // A transect sampled every few meters, the size of path and carpet queries over a survey
+    const int pointCount = 1000000;
+
+    _tile = TerrainTileTest::createTile();
+    TerrainTileTest::createPath(pointCount, _latitudes, _longitudes);
+    _coordinates.reserve(pointCount);
+    for (int i = 0; i < pointCount; i++) {
+        _coordinates.append(QGeoCoordinate(_latitudes[i], _longitudes[i]));
+    }
+}
+
+void TerrainTileBenchmark::_elevation_benchmark(void)
+{
+    QVector<double> heights(_coordinates.count());
+    QBENCHMARK {
+        for (int i = 0; i < _coordinates.count(); i++) {
+            heights[i] = _tile.elevation(_coordinates[i]);
+        }
+    }
+}
+
+void TerrainTileBenchmark::_elevations_benchmark(void)
+{
+    QVector<double> heights(_latitudes.count());
+    QBENCHMARK {
+        _tile.elevations(_latitudes.constData(), _longitudes.constData(), heights.data(), heights.count());
+    }
+}
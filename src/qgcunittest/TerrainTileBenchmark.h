@@ -0,0 +1,30 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "TerrainTile.h"
+
+/// Per point against batch TerrainTile elevation lookups along a long transect
+class TerrainTileBenchmark : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase               (void);
+    void _elevation_benchmark       (void);
+    void _elevations_benchmark      (void);
+
+private:
+    TerrainTile             _tile;
+    QVector<double>         _latitudes;
+    QVector<double>         _longitudes;
+    QList<QGeoCoordinate>   _coordinates;
+};
@@ -0,0 +1,207 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileStoreTest.h"
+#include "TerrainTileStore.h"
+#include "QGCApplication.h"
+#include "SettingsManager.h"
+#include "AppSettings.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTemporaryDir>
+#include <QSignalSpy>
+#include <QDir>
+#include <QFile>
+
+void TerrainTileStoreTest::_createTile(TerrainTile& tile, QByteArray& serialized)
+{
+    const int gridSize = 11;
+
+    QJsonArray carpet;
+    for (int row = 0; row < gridSize; row++) {
+        QJsonArray rowArray;
+        for (int col = 0; col < gridSize; col++) {
+            rowArray.append(100 + row + col);
+        }
+        carpet.append(rowArray);
+    }
+
+    QJsonObject bounds;
+    bounds["sw"] = QJsonArray({ 47.36, 8.54 });
+    bounds["ne"] = QJsonArray({ 47.37, 8.55 });
+    QJsonObject stats;
+    stats["min"] = 100;
+    stats["max"] = 100 + (gridSize - 1) * 2;
+    stats["avg"] = 100 + gridSize - 1;
+    QJsonObject data;
+    data["bounds"] = bounds;
+    data["stats"]  = stats;
+    data["carpet"] = carpet;
+    QJsonObject root;
+    root["status"] = "success";
+    root["data"]   = data;
+
+    serialized = TerrainTile::serialize(QJsonDocument(root).toJson());
+    tile = TerrainTile(serialized);
+}
+
+bool TerrainTileStoreTest::_load(TerrainTileStore& store, const QString& hash)
+{
+    QSignalSpy spyLoad(&store, &TerrainTileStore::diskLoadComplete);
+    store.load(hash);
+    if (!spyLoad.wait(5000) || spyLoad.count() != 1) {
+        return false;
+    }
+    QList<QVariant> args = spyLoad.takeFirst();
+    return args[0].toString() == hash && args[1].toBool();
+}
+
+void TerrainTileStoreTest::_roundTrip_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    TerrainTile tile;
+    QByteArray  serialized;
+    _createTile(tile, serialized);
+    QVERIFY(tile.isValid());
+
+    {
+        TerrainTileStore store(TerrainTileStore::defaultMaxMemoryBytes, TerrainTileStore::defaultMaxDiskBytes, tempDir.path());
+        store.insert(QStringLiteral("tile1"), tile, serialized);
+        QCOMPARE(store.memoryTiles(), 1);
+        QCOMPARE(store.memoryBytes(), tile.memorySize());
+        store.waitForDisk();
+        QVERIFY(QFile::exists(tempDir.filePath(QStringLiteral("tile1.bin"))));
+
+        store.clearMemory();
+        TerrainTile foundTile;
+        QVERIFY(!store.find(QStringLiteral("tile1"), foundTile));
+        QCOMPARE(store.memoryBytes(), 0);
+
+        // Reloading from disk puts it back in memory
+        QVERIFY(_load(store, QStringLiteral("tile1")));
+        QVERIFY(store.find(QStringLiteral("tile1"), foundTile));
+        QCOMPARE(foundTile.elevation(QGeoCoordinate(47.365, 8.545)), tile.elevation(QGeoCoordinate(47.365, 8.545)));
+    }
+
+    // A new store picks up what the previous one left on disk
+    TerrainTileStore store(TerrainTileStore::defaultMaxMemoryBytes, TerrainTileStore::defaultMaxDiskBytes, tempDir.path());
+    TerrainTile foundTile;
+    QVERIFY(!store.find(QStringLiteral("tile1"), foundTile));
+    QVERIFY(_load(store, QStringLiteral("tile1")));
+    QVERIFY(store.find(QStringLiteral("tile1"), foundTile));
+    QVERIFY(foundTile.isValid());
+
+    // An invalid file on disk is reported as missing and removed
+    QFile badFile(tempDir.filePath(QStringLiteral("bad.bin")));
+    QVERIFY(badFile.open(QIODevice::WriteOnly));
+    badFile.write("not a tile");
+    badFile.close();
+    QVERIFY(!_load(store, QStringLiteral("bad")));
+    QVERIFY(!QFile::exists(badFile.fileName()));
+}
+
+void TerrainTileStoreTest::_missingTile_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    TerrainTile tile;
+    QByteArray  serialized;
+    _createTile(tile, serialized);
+
+    TerrainTileStore store(TerrainTileStore::defaultMaxMemoryBytes, TerrainTileStore::defaultMaxDiskBytes, tempDir.path());
+    QVERIFY(!_load(store, QStringLiteral("missing")));
+    QVERIFY(store._notOnDisk.contains(QStringLiteral("missing")));
+    QVERIFY(store._loading.isEmpty());
+
+    // The second lookup is answered from the negative cache, even though the file now exists
+    QFile file(tempDir.filePath(QStringLiteral("missing.bin")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(serialized);
+    file.close();
+    QVERIFY(!_load(store, QStringLiteral("missing")));
+
+    // Concurrent loads for the same tile only queue one disk read
+    QSignalSpy spyLoad(&store, &TerrainTileStore::diskLoadComplete);
+    store.load(QStringLiteral("other"));
+    store.load(QStringLiteral("other"));
+    QCOMPARE(store._loading.count(), 1);
+    QVERIFY(spyLoad.wait(5000));
+    QCOMPARE(spyLoad.count(), 1);
+
+    // Inserting a tile clears its negative entry
+    store.insert(QStringLiteral("missing"), tile, serialized);
+    QVERIFY(!store._notOnDisk.contains(QStringLiteral("missing")));
+    store.waitForDisk();
+    store.clearMemory();
+    QVERIFY(_load(store, QStringLiteral("missing")));
+}
+
+void TerrainTileStoreTest::_pruneDisk_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    TerrainTile tile;
+    QByteArray  serialized;
+    _createTile(tile, serialized);
+
+    // Room for three and a half tiles, so the fourth write triggers a prune back down to 3/4 of the budget
+    const qint64 maxDiskBytes = serialized.size() * 3 + serialized.size() / 2;
+    TerrainTileStore store(TerrainTileStore::defaultMaxMemoryBytes, maxDiskBytes, tempDir.path());
+
+    const int tileCount = 10;
+    for (int i = 0; i < tileCount; i++) {
+        store.insert(QStringLiteral("tile%1").arg(i), tile, serialized);
+    }
+    store.waitForDisk();
+
+    QDir dir(tempDir.path());
+    QFileInfoList files = dir.entryInfoList(QStringList(QStringLiteral("*.bin")), QDir::Files);
+    qint64 diskBytes = 0;
+    for (const QFileInfo& info: files) {
+        diskBytes += info.size();
+    }
+    QVERIFY(files.count() > 0);
+    QVERIFY(files.count() < tileCount);
+    QVERIFY(diskBytes <= maxDiskBytes);
+    QCOMPARE(store._diskBytes, diskBytes);
+
+    // Memory is not affected by disk pruning
+    QCOMPARE(store.memoryTiles(), tileCount);
+}
+
+void TerrainTileStoreTest::_persistenceDisabled_test(void)
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    TerrainTile tile;
+    QByteArray  serialized;
+    _createTile(tile, serialized);
+
+    Fact* disableAllPersistence = qgcApp()->toolbox()->settingsManager()->appSettings()->disableAllPersistence();
+    QVariant savedValue = disableAllPersistence->rawValue();
+    disableAllPersistence->setRawValue(true);
+
+    TerrainTileStore store(TerrainTileStore::defaultMaxMemoryBytes, TerrainTileStore::defaultMaxDiskBytes, tempDir.path());
+    store.insert(QStringLiteral("tile1"), tile, serialized);
+    store.waitForDisk();
+
+    TerrainTile foundTile;
+    QVERIFY(store.find(QStringLiteral("tile1"), foundTile));
+    QVERIFY(!QFile::exists(tempDir.filePath(QStringLiteral("tile1.bin"))));
+    QVERIFY(QDir(tempDir.path()).entryList(QDir::Files).isEmpty());
+
+    disableAllPersistence->setRawValue(savedValue);
+}
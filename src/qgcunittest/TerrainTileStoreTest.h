@@ -0,0 +1,35 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "TerrainTile.h"
+
+class TerrainTileStore;
+
+/// Unit test for TerrainTileStore memory and disk caching
+class TerrainTileStoreTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _roundTrip_test            (void);
+    void _missingTile_test          (void);
+    void _pruneDisk_test            (void);
+    void _persistenceDisabled_test  (void);
+
+private:
+    /// Small valid tile along with its serialized form
+    void _createTile(TerrainTile& tile, QByteArray& serialized);
+
+    /// Runs a disk load and waits for diskLoadComplete
+    ///     @return found value signalled
+    bool _load(TerrainTileStore& store, const QString& hash);
+};
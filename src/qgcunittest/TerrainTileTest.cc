@@ -0,0 +1,109 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TerrainTileTest.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QtMath>
+
+static const double _swLat      = 47.36;
+static const double _swLon      = 8.54;
+static const double _neLat      = 47.40;
+static const double _neLon      = 8.58;
+static const int    _gridSize   = 151;
+
+TerrainTile TerrainTileTest::createTile(void)
+{
+    QJsonArray carpet;
+    for (int row = 0; row < _gridSize; row++) {
+        QJsonArray rowArray;
+        for (int col = 0; col < _gridSize; col++) {
+            rowArray.append(400 + row * 3 + col);
+        }
+        carpet.append(rowArray);
+    }
+
+    QJsonObject bounds;
+    bounds["sw"] = QJsonArray({ _swLat, _swLon });
+    bounds["ne"] = QJsonArray({ _neLat, _neLon });
+    QJsonObject stats;
+    stats["min"] = 400;
+    stats["max"] = 400 + (_gridSize - 1) * 4;
+    stats["avg"] = 400 + (_gridSize - 1) * 2;
+    QJsonObject data;
+    data["bounds"] = bounds;
+    data["stats"]  = stats;
+    data["carpet"] = carpet;
+    QJsonObject root;
+    root["status"] = "success";
+    root["data"]   = data;
+
+    return TerrainTile(TerrainTile::serialize(QJsonDocument(root).toJson()));
+}
+
+void TerrainTileTest::createPath(int count, QVector<double>& latitudes, QVector<double>& longitudes)
+{
+    latitudes.resize(count);
+    longitudes.resize(count);
+    for (int i = 0; i < count; i++) {
+        double fraction = static_cast<double>(i) / qMax(1, count - 1);
+        latitudes[i]  = _swLat + (_neLat - _swLat) * fraction;
+        // Wander back and forth in longitude so the samples don't all come from one diagonal
+        longitudes[i] = _swLon + (_neLon - _swLon) * (0.5 + 0.5 * qSin(fraction * 40.0));
+    }
+}
+
+void TerrainTileTest::_elevations_test(void)
+{
+    TerrainTile tile = createTile();
+    QVERIFY(tile.isValid());
+
+    QVector<double> latitudes, longitudes;
+    createPath(1000, latitudes, longitudes);
+    QVector<double> heights(latitudes.count());
+    tile.elevations(latitudes.constData(), longitudes.constData(), heights.data(), heights.count());
+
+    for (int i = 0; i < latitudes.count(); i++) {
+        QGeoCoordinate coordinate(latitudes[i], longitudes[i]);
+        QVERIFY(tile.contains(latitudes[i], longitudes[i]));
+        QCOMPARE(heights[i], tile.elevation(coordinate));
+    }
+
+    // Corners pick the corner samples
+    double cornerLats[] = { _swLat, _neLat };
+    double cornerLons[] = { _swLon, _neLon };
+    double cornerHeights[2];
+    tile.elevations(cornerLats, cornerLons, cornerHeights, 2);
+    QCOMPARE(cornerHeights[0], 400.0);
+    QCOMPARE(cornerHeights[1], 400.0 + (_gridSize - 1) * 4);
+}
+
+void TerrainTileTest::_elevationsOutside_test(void)
+{
+    TerrainTile tile = createTile();
+
+    double latitudes[]  = { _swLat - 0.01, _neLat + 0.01, (_swLat + _neLat) / 2, qQNaN() };
+    double longitudes[] = { _swLon,        _neLon,        _neLon + 0.01,         _swLon };
+    double heights[4];
+    tile.elevations(latitudes, longitudes, heights, 4);
+    for (int i = 0; i < 4; i++) {
+        QVERIFY(qIsNaN(heights[i]));
+        QVERIFY(!tile.contains(latitudes[i], longitudes[i]));
+    }
+
+    // An invalid tile answers NaN for everything
+    TerrainTile invalidTile;
+    double insideLat = (_swLat + _neLat) / 2;
+    double insideLon = (_swLon + _neLon) / 2;
+    double height = 0;
+    invalidTile.elevations(&insideLat, &insideLon, &height, 1);
+    QVERIFY(qIsNaN(height));
+}
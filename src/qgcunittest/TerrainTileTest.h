@@ -0,0 +1,30 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+#include "TerrainTile.h"
+
+/// Unit test for TerrainTile batch elevation sampling
+class TerrainTileTest : public UnitTest
+{
+    Q_OBJECT
+
+public:
+    /// Builds a tile with a synthetic elevation grid, elevation varies with both row and column
+    static TerrainTile createTile(void);
+
+    /// Points along a diagonal path through the tile, as the path and carpet queries generate them
+    static void createPath(int count, QVector<double>& latitudes, QVector<double>& longitudes);
+
+private slots:
+    void _elevations_test           (void);
+    void _elevationsOutside_test    (void);
+};
@@ -0,0 +1,122 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#include "TimingHistogramTest.h"
+#include "TimingHistogram.h"
+
+void TimingHistogramTest::_empty_test(void)
+{
+    TimingHistogram histogram;
+
+    QCOMPARE(histogram.count(), 0ULL);
+    QCOMPARE(histogram.max(), 0LL);
+    QCOMPARE(histogram.percentile(0.5), 0LL);
+    QCOMPARE(histogram.percentile(1.0), 0LL);
+
+    QVariantList counts = histogram.counts();
+    QCOMPARE(counts.count(), static_cast<int>(TimingHistogram::bucketCount));
+    for (const QVariant& count: counts) {
+        QCOMPARE(count.toULongLong(), 0ULL);
+    }
+
+    // Every bucket but the open ended last one has an upper limit, in increasing order
+    QVariantList limits = TimingHistogram::bucketLimits();
+    QCOMPARE(limits.count(), TimingHistogram::bucketCount - 1);
+    for (int i=1; i<limits.count(); i++) {
+        QVERIFY(limits[i].toLongLong() > limits[i - 1].toLongLong());
+    }
+}
+
+void TimingHistogramTest::_add_test(void)
+{
+    TimingHistogram histogram;
+    QVariantList    limits = TimingHistogram::bucketLimits();
+
+    // A sample on a limit goes in that limit's bucket, one past it in the next
+    histogram.add(0);
+    histogram.add(limits[0].toLongLong());
+    histogram.add(limits[0].toLongLong() + 1);
+    histogram.add(limits[5].toLongLong());
+    histogram.add(limits.last().toLongLong() + 1);
+    histogram.add(limits.last().toLongLong() * 10);
+
+    QList<quint64> expectedCounts;
+    for (int i=0; i<TimingHistogram::bucketCount; i++) {
+        expectedCounts.append(0);
+    }
+    expectedCounts[0] = 2;
+    expectedCounts[1] = 1;
+    expectedCounts[5] = 1;
+    expectedCounts[TimingHistogram::bucketCount - 1] = 2;
+
+    QVariantList counts = histogram.counts();
+    QCOMPARE(counts.count(), static_cast<int>(TimingHistogram::bucketCount));
+    for (int i=0; i<counts.count(); i++) {
+        QCOMPARE(counts[i].toULongLong(), expectedCounts[i]);
+    }
+    QCOMPARE(histogram.count(), 6ULL);
+    QCOMPARE(histogram.max(), limits.last().toLongLong() * 10);
+}
+
+void TimingHistogramTest::_percentile_test(void)
+{
+    TimingHistogram histogram;
+    QVariantList    limits = TimingHistogram::bucketLimits();
+
+    // Eight samples: two in the first bucket, four in the third, one in the sixth and one in the open ended last
+    const qint64 largest = limits.last().toLongLong() * 3;
+    histogram.add(limits[0].toLongLong() / 2);
+    histogram.add(limits[0].toLongLong());
+    for (int i=0; i<4; i++) {
+        histogram.add(limits[2].toLongLong() - i);
+    }
+    histogram.add(limits[5].toLongLong() - 1);
+    histogram.add(largest);
+
+    // The upper limit of the bucket the sample at or above the fraction falls in
+    QCOMPARE(histogram.percentile(0.125),   limits[0].toLongLong());
+    QCOMPARE(histogram.percentile(0.25),    limits[0].toLongLong());
+    QCOMPARE(histogram.percentile(0.375),   limits[2].toLongLong());
+    QCOMPARE(histogram.percentile(0.75),    limits[2].toLongLong());
+    QCOMPARE(histogram.percentile(0.875),   limits[5].toLongLong());
+
+    // The last bucket has no limit, it reports the largest sample
+    QCOMPARE(histogram.percentile(1.0),     largest);
+
+    // A bucket limit is never reported above the largest sample
+    TimingHistogram small;
+    small.add(limits[1].toLongLong() + 1);
+    small.add(limits[1].toLongLong() + 2);
+    QCOMPARE(small.percentile(0.5), limits[1].toLongLong() + 2);
+    QCOMPARE(small.percentile(1.0), limits[1].toLongLong() + 2);
+}
+
+void TimingHistogramTest::_reset_test(void)
+{
+    TimingHistogram histogram;
+
+    for (int i=0; i<100; i++) {
+        histogram.add(i * 1000);
+    }
+    QCOMPARE(histogram.count(), 100ULL);
+
+    histogram.reset();
+    QCOMPARE(histogram.count(), 0ULL);
+    QCOMPARE(histogram.max(), 0LL);
+    QCOMPARE(histogram.percentile(0.5), 0LL);
+    for (const QVariant& count: histogram.counts()) {
+        QCOMPARE(count.toULongLong(), 0ULL);
+    }
+
+    // Accumulates again from scratch
+    histogram.add(42);
+    QCOMPARE(histogram.count(), 1ULL);
+    QCOMPARE(histogram.max(), 42LL);
+    QCOMPARE(histogram.counts()[0].toULongLong(), 1ULL);
+}
@@ -0,0 +1,24 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "UnitTest.h"
+
+/// Unit test for TimingHistogram bucketing and percentiles
+class TimingHistogramTest : public UnitTest
+{
+    Q_OBJECT
+
+private slots:
+    void _empty_test        (void);
+    void _add_test          (void);
+    void _percentile_test   (void);
+    void _reset_test        (void);
+};
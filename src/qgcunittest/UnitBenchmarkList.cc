@@ -0,0 +1,20 @@
+/****************************************************************************
+ *
+ * (c) 2009-2020 QGROUNDCONTROL PROJECT <http://www.qgroundcontrol.org>
+ *
+ * QGroundControl is licensed according to the terms in the file
+ * COPYING.md in the root of the source code directory.
+ *
+ ****************************************************************************/
+
+
+// Benchmarks are kept apart from UnitTestList so a full --unittest run leaves them out. Run one
+// with --unittest:<name>.
+
+#include "ADSBConflictEngineBenchmark.h"
+#include "PolygonClipperBenchmark.h"
+#include "TerrainTileBenchmark.h"
+
+UT_REGISTER_BENCHMARK(ADSBConflictEngineBenchmark)
+UT_REGISTER_BENCHMARK(PolygonClipperBenchmark)
+UT_REGISTER_BENCHMARK(TerrainTileBenchmark)
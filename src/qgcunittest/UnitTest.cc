@@ -57,9 +57,9 @@ UnitTest::~UnitTest()
     }
 }
 
-void UnitTest::_addTest(QObject* test)
+void UnitTest::_addTest(QObject* test, bool benchmark)
 {
-	QList<QObject*>& tests = _testList();
+	QList<QObject*>& tests = benchmark ? _benchmarkList() : _testList();
 
     Q_ASSERT(!tests.contains(test));
     
@@ -78,6 +78,13 @@ QList<QObject*>& UnitTest::_testList(void)
 	return tests;
 }
 
+/// @brief Returns the list of benchmarks.
+QList<QObject*>& UnitTest::_benchmarkList(void)
+{
+	static QList<QObject*> benchmarks;
+	return benchmarks;
+}
+
 int UnitTest::run(QString& singleTest)
 {
     int ret = 0;
@@ -89,6 +96,11 @@ int UnitTest::run(QString& singleTest)
             ret += QTest::qExec(test, args);
         }
     }
+    for (QObject* benchmark: _benchmarkList()) {
+        if (singleTest == benchmark->objectName()) {
+            ret += QTest::qExec(benchmark, QStringList() << "*" << "-maxwarnings" << "0");
+        }
+    }
     
     return ret;
 }
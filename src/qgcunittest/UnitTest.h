@@ -27,6 +27,8 @@
 #include "MissionItem.h"
 
 #define UT_REGISTER_TEST(className) static UnitTestWrapper<className> className(#className);
+/// Benchmarks are left out of a full test run, they only run when named with --unittest:<className>
+#define UT_REGISTER_BENCHMARK(className) static UnitTestWrapper<className> className(#className, true);
 
 class QGCMessageBox;
 class QGCQFileDialog;
@@ -83,7 +85,8 @@ public:
     void checkExpectedFileDialog(int expectFailFlags = expectFailNoFailure);
 
     /// @brief Adds a unit test to the list. Should only be called by UnitTestWrapper.
-    static void _addTest(QObject* test);
+    ///     @param benchmark true: only run when asked for by name
+    static void _addTest(QObject* test, bool benchmark = false);
 
     /// Creates a file with random contents of the specified size.
     /// @return Fully qualified path to created file
@@ -185,6 +188,7 @@ private:
 
     void _unitTestCalled(void);
 	static QList<QObject*>& _testList(void);
+	static QList<QObject*>& _benchmarkList(void);
 
     // Catch QGCMessageBox calls
     static bool                         _messageBoxRespondedTo;     ///< Message box was responded to
@@ -207,11 +211,11 @@ private:
 template <class T>
 class UnitTestWrapper {
 public:
-    UnitTestWrapper(const QString& name) :
+    UnitTestWrapper(const QString& name, bool benchmark = false) :
         _unitTest(new T)
     {
         _unitTest->setObjectName(name);
-        UnitTest::_addTest(_unitTest.data());
+        UnitTest::_addTest(_unitTest.data(), benchmark);
     }
 
 private:
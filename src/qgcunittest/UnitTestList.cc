@@ -17,6 +17,12 @@
 //#include "FlightGearTest.h"
 #include "GeoTest.h"
 #include "LinkManagerTest.h"
+#include "LinkSendQueueTest.h"
+#include "JoystickTest.h"
+#include "TimingHistogramTest.h"
+#include "LogReplayIndexTest.h"
+#include "MAVLinkDecodeWorkerTest.h"
+#include "MAVLinkMessageRouterTest.h"
 //#include "MessageBoxTest.h"
 #include "MissionItemTest.h"
 #include "SimpleMissionItemTest.h"
@@ -26,11 +32,14 @@
 //#include "RadioConfigTest.h"
 #include "MavlinkLogTest.h"
 //#include "MainWindowTest.h"
-//#include "FileManagerTest.h"
+#include "FileManagerTest.h"
 #include "TCPLinkTest.h"
+#include "TelemetryLogWriterTest.h"
 #include "ParameterManagerTest.h"
 #include "MissionCommandTreeTest.h"
-//#include "LogDownloadTest.h"
+#include "LogDownloadTest.h"
+#include "GeoTagTest.h"
+#include "ULogReaderTest.h"
 #include "SendMavCommandTest.h"
 #include "VisualMissionItemTest.h"
 #include "CameraSectionTest.h"
@@ -45,6 +54,16 @@
 #include "TransectStyleComplexItemTest.h"
 #include "CameraCalcTest.h"
 #include "FWLandingPatternTest.h"
+#include "QGCTileDownloaderTest.h"
+#include "QGCTileCacheWorkerTest.h"
+#include "QGCTileMemoryCacheTest.h"
+#include "TerrainDEMTest.h"
+#include "TerrainQueryTest.h"
+#include "TerrainTileStoreTest.h"
+#include "TerrainTileTest.h"
+#include "PolygonClipperTest.h"
+#include "ADSBConflictEngineTest.h"
+#include "ADSBVehicleManagerTest.h"
 
 UT_REGISTER_TEST(FactSystemTestGeneric)
 UT_REGISTER_TEST(FactSystemTestPX4)
@@ -52,6 +71,12 @@ UT_REGISTER_TEST(FactSystemTestPX4)
 //UT_REGISTER_TEST(FlightGearUnitTest)
 UT_REGISTER_TEST(GeoTest)
 UT_REGISTER_TEST(LinkManagerTest)
+UT_REGISTER_TEST(LinkSendQueueTest)
+UT_REGISTER_TEST(JoystickTest)
+UT_REGISTER_TEST(TimingHistogramTest)
+UT_REGISTER_TEST(LogReplayIndexTest)
+UT_REGISTER_TEST(MAVLinkDecodeWorkerTest)
+UT_REGISTER_TEST(MAVLinkMessageRouterTest)
 //UT_REGISTER_TEST(MessageBoxTest)
 UT_REGISTER_TEST(MissionItemTest)
 UT_REGISTER_TEST(SimpleMissionItemTest)
@@ -59,10 +84,13 @@ UT_REGISTER_TEST(MissionControllerTest)
 UT_REGISTER_TEST(MissionManagerTest)
 //UT_REGISTER_TEST(RadioConfigTest)
 UT_REGISTER_TEST(TCPLinkTest)
-//UT_REGISTER_TEST(FileManagerTest)
+UT_REGISTER_TEST(TelemetryLogWriterTest)
+UT_REGISTER_TEST(FileManagerTest)
 UT_REGISTER_TEST(ParameterManagerTest)
 UT_REGISTER_TEST(MissionCommandTreeTest)
-//UT_REGISTER_TEST(LogDownloadTest)
+UT_REGISTER_TEST(LogDownloadTest)
+UT_REGISTER_TEST(GeoTagTest)
+UT_REGISTER_TEST(ULogReaderTest)
 UT_REGISTER_TEST(SendMavCommandTest)
 UT_REGISTER_TEST(SurveyComplexItemTest)
 UT_REGISTER_TEST(CameraSectionTest)
@@ -77,6 +105,16 @@ UT_REGISTER_TEST(TransectStyleComplexItemTest)
 UT_REGISTER_TEST(QGCMapPolylineTest)
 UT_REGISTER_TEST(CameraCalcTest)
 UT_REGISTER_TEST(FWLandingPatternTest)
+UT_REGISTER_TEST(QGCTileDownloaderTest)
+UT_REGISTER_TEST(QGCTileCacheWorkerTest)
+UT_REGISTER_TEST(QGCTileMemoryCacheTest)
+UT_REGISTER_TEST(TerrainDEMTest)
+UT_REGISTER_TEST(TerrainQueryTest)
+UT_REGISTER_TEST(TerrainTileStoreTest)
+UT_REGISTER_TEST(TerrainTileTest)
+UT_REGISTER_TEST(PolygonClipperTest)
+UT_REGISTER_TEST(ADSBConflictEngineTest)
+UT_REGISTER_TEST(ADSBVehicleManagerTest)
 
 // List of unit test which are currently disabled.
 // If disabling a new test, include reason in comment.
@@ -16,7 +16,9 @@
 
 #include <QFile>
 #include <QDir>
+#include <QtConcurrent>
 #include <string>
+#include <iterator>
 
 QGC_LOGGING_CATEGORY(FileManagerLog, "FileManagerLog")
 
@@ -26,11 +28,17 @@ FileManager::FileManager(QObject* parent, Vehicle* vehicle)
     , _vehicle(vehicle)
     , _dedicatedLink(nullptr)
     , _activeSession(0)
+    , _writeNextOffset(0)
+    , _writeAckedBytes(0)
     , _missingDownloadedBytes(0)
+    , _missingDataCursor(0)
     , _downloadingMissingParts(false)
+    , _readFileBurst(false)
+    , _remoteCRC32(0)
     , _systemIdQGC(0)
 {
     connect(&_ackTimer, &QTimer::timeout, this, &FileManager::_ackTimeout);
+    connect(&_localCRC32Watcher, &QFutureWatcher<LocalCRC32>::finished, this, &FileManager::_localCRC32Complete);
     
     _lastOutgoingRequest.hdr.seqNumber = 0;
 
@@ -60,6 +68,8 @@ void FileManager::_openAckResponse(Request* openAck)
     _missingDownloadedBytes = 0;
     _downloadingMissingParts = false;
     _missingData.clear();
+    _missingDataCursor = 0;
+    _requestsInFlight.clear();
 
     Request request;
     request.hdr.session = _activeSession;
@@ -71,35 +81,68 @@ void FileManager::_openAckResponse(Request* openAck)
     _sendRequest(&request);
 }
 
-/// request the next missing part of a (partially) downloaded file
+/// Requests every missing range of a burst downloaded file, with up to requestWindowSize reads in flight. Ranges
+/// which come back short are picked up again on the next pass over the gap map.
 void FileManager::_requestMissingData()
 {
-    if (_missingData.empty()) {
-        _downloadingMissingParts = false;
-        _missingDownloadedBytes = 0;
-        // there might be more data missing at the end
-        if ((uint32_t)_readFileAccumulator.length() != _downloadFileSize) {
-            _downloadOffset = _readFileAccumulator.length();
-            qCDebug(FileManagerLog) << QString("_requestMissingData: missing parts done, downloadOffset(%1) downloadFileSize(%2)")
-                    .arg(_downloadOffset).arg(_downloadFileSize);
-        } else {
+    if (_missingData.isEmpty()) {
+        if (_requestsInFlight.isEmpty()) {
+            _downloadingMissingParts = false;
             _closeDownloadSession(true);
-            return;
         }
-    } else {
-        qCDebug(FileManagerLog) << QString("_requestMissingData: offset(%1) size(%2)").arg(_missingData.head().offset).arg(_missingData.head().size);
+        return;
+    }
 
-        _downloadOffset = _missingData.head().offset;
+    while (_requestsInFlight.count() < requestWindowSize) {
+        // Find the range which holds the cursor, or the first one after it
+        auto gap = _missingData.lowerBound(_missingDataCursor);
+        if (gap != _missingData.begin()) {
+            auto previous = std::prev(gap);
+            if (previous.key() + previous.value() > _missingDataCursor) {
+                gap = previous;
+            }
+        }
+        if (gap == _missingData.end()) {
+            if (!_requestsInFlight.isEmpty()) {
+                // Wait for what is outstanding before starting another pass
+                break;
+            }
+            _missingDataCursor = 0;
+            continue;
+        }
+
+        uint32_t offset = qMax(gap.key(), _missingDataCursor);
+        uint32_t size = qMin(gap.key() + gap.value() - offset, static_cast<uint32_t>(sizeof(Request::data)));
+        qCDebug(FileManagerLog) << QString("_requestMissingData: offset(%1) size(%2)").arg(offset).arg(size);
+        _sendMissingDataRequest(offset, size);
+        _missingDataCursor = offset + size;
     }
+}
 
-    Request request;
-    _currentOperation = kCORead;
-    request.hdr.session = _activeSession;
-    request.hdr.opcode = kCmdReadFile;
-    request.hdr.offset = _downloadOffset;
-    request.hdr.size = sizeof(request.data);
+/// Removes a range which has been received from the gap map
+void FileManager::_removeMissingData(uint32_t offset, uint32_t size)
+{
+    uint32_t end = offset + size;
 
-    _sendRequest(&request);
+    auto gap = _missingData.lowerBound(offset);
+    if (gap != _missingData.begin() && std::prev(gap).key() + std::prev(gap).value() > offset) {
+        gap = std::prev(gap);
+    }
+    while (gap != _missingData.end() && gap.key() < end) {
+        uint32_t gapStart = gap.key();
+        uint32_t gapEnd = gap.key() + gap.value();
+        gap = _missingData.erase(gap);
+
+        uint32_t overlapStart = qMax(gapStart, offset);
+        uint32_t overlapEnd = qMin(gapEnd, end);
+        _missingDownloadedBytes -= overlapEnd - overlapStart;
+        if (gapStart < offset) {
+            _missingData.insert(gapStart, offset - gapStart);
+        }
+        if (gapEnd > end) {
+            gap = _missingData.insert(end, gapEnd - end);
+        }
+    }
 }
 
 /// Closes out a download session by writing the file and doing cleanup.
@@ -109,12 +152,21 @@ void FileManager::_closeDownloadSession(bool success)
     qCDebug(FileManagerLog) << QString("_closeDownloadSession: success(%1) missingBytes(%2)").arg(success).arg(_missingDownloadedBytes);
     
     _currentOperation = kCOIdle;
+    _requestsInFlight.clear();
     
     if (success) {
-        if (_missingDownloadedBytes > 0 || (uint32_t)_readFileAccumulator.length() < _downloadFileSize) {
-            // we're not done yet: request the missing parts individually (either we had missing parts or
-            // the last (few) packets right before the EOF got dropped)
+        if ((uint32_t)_readFileAccumulator.length() < _downloadFileSize) {
+            // the last (few) packets right before the EOF got dropped
+            uint32_t missingOffset = _readFileAccumulator.length();
+            _missingData.insert(missingOffset, _downloadFileSize - missingOffset);
+            _missingDownloadedBytes += _downloadFileSize - missingOffset;
+            _readFileAccumulator.resize(_downloadFileSize);
+        }
+        if (!_missingData.isEmpty()) {
+            // we're not done yet: request all the missing parts in one pass
+            _currentOperation = kCORead;
             _downloadingMissingParts = true;
+            _missingDataCursor = 0;
             _requestMissingData();
             return;
         }
@@ -151,6 +203,7 @@ void FileManager::_closeUploadSession(bool success)
     qCDebug(FileManagerLog) << QString("_closeUploadSession: success(%1)").arg(success);
     
     _currentOperation = kCOIdle;
+    _requestsInFlight.clear();
     _writeFileAccumulator.clear();
     _writeFileSize = 0;
     
@@ -183,12 +236,10 @@ void FileManager::_downloadAckResponse(Request* readAck, bool readFile)
                 return;
             }
             // keep track of missing data chunks
-            MissingData missingData;
-            missingData.offset = _downloadOffset;
-            missingData.size = readAck->hdr.offset - _downloadOffset;
-            _missingData.push_back(missingData);
-            _missingDownloadedBytes += readAck->hdr.offset - _downloadOffset;
-            qCDebug(FileManagerLog) << QString("_downloadAckResponse: missing data: offset(%1) size(%2)").arg(missingData.offset).arg(missingData.size);
+            uint32_t missingSize = readAck->hdr.offset - _downloadOffset;
+            _missingData.insert(_downloadOffset, missingSize);
+            _missingDownloadedBytes += missingSize;
+            qCDebug(FileManagerLog) << QString("_downloadAckResponse: missing data: offset(%1) size(%2)").arg(_downloadOffset).arg(missingSize);
             _downloadOffset = readAck->hdr.offset;
             _readFileAccumulator.resize(_downloadOffset); // placeholder for the missing data
         }
@@ -196,28 +247,14 @@ void FileManager::_downloadAckResponse(Request* readAck, bool readFile)
     
     qCDebug(FileManagerLog) << QString("_downloadAckResponse: offset(%1) size(%2) burstComplete(%3)").arg(readAck->hdr.offset).arg(readAck->hdr.size).arg(readAck->hdr.burstComplete);
 
-    if (_downloadingMissingParts) {
-        Q_ASSERT(_missingData.head().offset == _downloadOffset);
-        _missingDownloadedBytes -= readAck->hdr.size;
-        _readFileAccumulator.replace(_downloadOffset, readAck->hdr.size, (const char*)readAck->data, readAck->hdr.size);
-        if (_missingData.head().size <= readAck->hdr.size) {
-            _missingData.pop_front();
-        } else {
-            _missingData.head().size -= readAck->hdr.size;
-            _missingData.head().offset += readAck->hdr.size;
-        }
-    } else {
-        _downloadOffset += readAck->hdr.size;
-        _readFileAccumulator.append((const char*)readAck->data, readAck->hdr.size);
-    }
+    _downloadOffset += readAck->hdr.size;
+    _readFileAccumulator.append((const char*)readAck->data, readAck->hdr.size);
     
     if (_downloadFileSize != 0) {
         emit commandProgress(100 * ((float)(_readFileAccumulator.length() - _missingDownloadedBytes) / (float)_downloadFileSize));
     }
 
-    if (_downloadingMissingParts) {
-        _requestMissingData();
-    } else if (readFile || readAck->hdr.burstComplete) {
+    if (readFile || readAck->hdr.burstComplete) {
         // Possibly still more data to read, send next read request
 
         Request request;
@@ -303,29 +340,25 @@ void FileManager::_createAckResponse(Request* createAck)
 
     // Start the sequence of write commands from the beginning of the file
 
-    _writeOffset = 0;
-    _writeSize = 0;
+    _writeNextOffset = 0;
+    _writeAckedBytes = 0;
+    _requestsInFlight.clear();
     
-    _writeFileDatablock();
+    _fillWriteWindow();
 }
 
-/// @brief Respond to the Ack associated with the write command.
-void FileManager::_writeAckResponse(Request* writeAck)
+/// @brief Respond to the Ack associated with one of the write commands in flight.
+void FileManager::_writeAckResponse(Request* writeAck, const InFlightRequest& inFlight)
 {
-    if(_writeOffset + _writeSize >= _writeFileSize){
-        _closeUploadSession(true /* success */);
-        return;
-    }
-
     if (writeAck->hdr.session != _activeSession) {
         _closeUploadSession(false /* failure */);
         _emitErrorMessage(tr("Write: Incorrect session returned"));
         return;
     }
 
-    if (writeAck->hdr.offset != _writeOffset) {
+    if (writeAck->hdr.offset != inFlight.offset) {
         _closeUploadSession(false /* failure */);
-        _emitErrorMessage(tr("Write: Offset returned (%1) differs from offset requested (%2)").arg(writeAck->hdr.offset).arg(_writeOffset));
+        _emitErrorMessage(tr("Write: Offset returned (%1) differs from offset requested (%2)").arg(writeAck->hdr.offset).arg(inFlight.offset));
         return;
     }
 
@@ -336,40 +369,172 @@ void FileManager::_writeAckResponse(Request* writeAck)
     }
 
 
-    if( writeAck->writeFileLength !=_writeSize) {
+    if( writeAck->writeFileLength != inFlight.size) {
         _closeUploadSession(false /* failure */);
-        _emitErrorMessage(tr("Write: Size returned (%1) differs from size requested (%2)").arg(writeAck->writeFileLength).arg(_writeSize));
+        _emitErrorMessage(tr("Write: Size returned (%1) differs from size requested (%2)").arg(writeAck->writeFileLength).arg(inFlight.size));
         return;
     }
 
-    _writeFileDatablock();
+    _writeAckedBytes += inFlight.size;
+    emit commandProgress(100 * ((float)_writeAckedBytes / (float)_writeFileSize));
+
+    _fillWriteWindow();
 }
 
-/// @brief Send next write file data block.
-void FileManager::_writeFileDatablock(void)
+/// @brief Keeps requestWindowSize write commands in flight until the whole file has been sent, then closes the
+/// session once everything is acked.
+void FileManager::_fillWriteWindow(void)
 {
-    if (_writeOffset + _writeSize >= _writeFileSize){
-        _closeUploadSession(true /* success */);
-        return;
+    while (_requestsInFlight.count() < requestWindowSize && _writeNextOffset < _writeFileSize) {
+        uint32_t size = qMin(_writeFileSize - _writeNextOffset, static_cast<uint32_t>(sizeof(Request::data)));
+        _sendWriteRequest(_writeNextOffset, size);
+        _writeNextOffset += size;
     }
 
-    _writeOffset += _writeSize;
+    if (_requestsInFlight.isEmpty()) {
+        _closeUploadSession(true /* success */);
+    }
+}
 
+void FileManager::_sendWriteRequest(uint32_t offset, uint32_t size)
+{
     Request request;
     request.hdr.session = _activeSession;
     request.hdr.opcode = kCmdWriteFile;
-    request.hdr.offset = _writeOffset;
+    request.hdr.offset = offset;
+    request.hdr.size = static_cast<uint8_t>(size);
 
-    if(_writeFileSize -_writeOffset > sizeof(request.data) )
-        _writeSize = sizeof(request.data);
-    else
-        _writeSize = _writeFileSize - _writeOffset;
+    memcpy(request.data, &_writeFileAccumulator.data()[offset], size);
 
-    request.hdr.size = _writeSize;
+    _sendWindowedRequest(&request, offset, size);
+}
 
-    memcpy(request.data, &_writeFileAccumulator.data()[_writeOffset], _writeSize);
+void FileManager::_sendMissingDataRequest(uint32_t offset, uint32_t size)
+{
+    Request request;
+    request.hdr.session = _activeSession;
+    request.hdr.opcode = kCmdReadFile;
+    request.hdr.offset = offset;
+    request.hdr.size = static_cast<uint8_t>(size);
 
-    _sendRequest(&request);
+    _sendWindowedRequest(&request, offset, size);
+}
+
+/// @brief Respond to the Ack associated with one of the reads of missing burst data in flight.
+void FileManager::_missingDataAckResponse(Request* readAck, const InFlightRequest& inFlight)
+{
+    if (readAck->hdr.session != _activeSession) {
+        _closeDownloadSession(false /* failure */);
+        _emitErrorMessage(tr("Download: Incorrect session returned"));
+        return;
+    }
+
+    if (readAck->hdr.offset != inFlight.offset || readAck->hdr.size == 0) {
+        _closeDownloadSession(false /* failure */);
+        _emitErrorMessage(tr("Download: Offset returned (%1) differs from offset requested/expected (%2)").arg(readAck->hdr.offset).arg(inFlight.offset));
+        return;
+    }
+
+    // The server may send back more than was missing, that is still valid file data
+    uint32_t size = qMin(static_cast<uint32_t>(readAck->hdr.size), _downloadFileSize - inFlight.offset);
+    _readFileAccumulator.replace(inFlight.offset, size, (const char*)readAck->data, size);
+    _removeMissingData(inFlight.offset, size);
+
+    if (_downloadFileSize != 0) {
+        emit commandProgress(100 * ((float)(_readFileAccumulator.length() - _missingDownloadedBytes) / (float)_downloadFileSize));
+    }
+
+    _requestMissingData();
+}
+
+/// @brief Respond to the Ack associated with the CalcFileCRC32 command. The local copy is checksummed on a worker
+/// thread, _localCRC32Complete then skips the download if the two match.
+void FileManager::_crc32AckResponse(Request* crc32Ack)
+{
+    if (crc32Ack->hdr.size != sizeof(uint32_t)) {
+        _openDownloadSession();
+        return;
+    }
+
+    _remoteCRC32 = crc32Ack->crc32;
+    _localCRC32Watcher.setFuture(QtConcurrent::run(&FileManager::_calcLocalCRC32, _readFileDownloadDir.absoluteFilePath(_readFileDownloadFilename)));
+}
+
+/// @brief Runs on a worker thread
+FileManager::LocalCRC32 FileManager::_calcLocalCRC32(const QString& filePath)
+{
+    LocalCRC32 result = { false, 0 };
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+
+    char buffer[4096];
+    qint64 bytesRead;
+    while ((bytesRead = file.read(buffer, sizeof(buffer))) > 0) {
+        result.crc32 = QGC::crc32(reinterpret_cast<const quint8*>(buffer), static_cast<unsigned>(bytesRead), result.crc32);
+    }
+    result.valid = bytesRead == 0;
+
+    return result;
+}
+
+void FileManager::_localCRC32Complete(void)
+{
+    if (_currentOperation != kCOCalcCRC32) {
+        return;
+    }
+
+    LocalCRC32 local = _localCRC32Watcher.result();
+
+    qCDebug(FileManagerLog) << QString("_localCRC32Complete: remote(%1) local(%2) valid(%3)").arg(_remoteCRC32, 8, 16, QLatin1Char('0')).arg(local.crc32, 8, 16, QLatin1Char('0')).arg(local.valid);
+
+    if (local.valid && local.crc32 == _remoteCRC32) {
+        _currentOperation = kCOIdle;
+        emit commandProgress(100);
+        emit commandComplete();
+    } else {
+        _openDownloadSession();
+    }
+}
+
+/// @return true: several requests can be in flight, responses are matched by sequence number
+bool FileManager::_windowedOperation(void) const
+{
+    return _currentOperation == kCOWrite || (_currentOperation == kCORead && _downloadingMissingParts);
+}
+
+/// @brief Handles the response to one of the requests of a windowed operation.
+void FileManager::_windowedResponse(Request* response, const InFlightRequest& inFlight)
+{
+    _clearAckTimeout();
+
+    if (response->hdr.opcode == kRspAck) {
+        if (_currentOperation == kCOWrite) {
+            _writeAckResponse(response, inFlight);
+        } else {
+            _missingDataAckResponse(response, inFlight);
+        }
+    } else {
+        // The range this request covered is lost, so the transfer can't complete
+        if (_currentOperation == kCOWrite) {
+            _closeUploadSession(false /* failure */);
+        } else {
+            _closeDownloadSession(false /* failure */);
+        }
+        if (response->hdr.opcode == kRspNak) {
+            _emitErrorMessage(tr("Nak received, error: %1").arg(errorString(response->data[0])));
+        } else {
+            _emitErrorMessage(tr("Unknown opcode returned from server: %1").arg(response->hdr.opcode));
+        }
+        return;
+    }
+
+    // Any response shows the link is alive, so restart the timeout for whatever is still outstanding
+    if (_windowedOperation() && !_requestsInFlight.isEmpty() && !_ackTimer.isActive()) {
+        _setupAckTimeout();
+    }
 }
 
 void FileManager::receiveMessage(mavlink_message_t message)
@@ -391,6 +556,19 @@ void FileManager::receiveMessage(mavlink_message_t message)
     Request* request = (Request*)&data.payload[0];
 
     uint16_t incomingSeqNumber = request->hdr.seqNumber;
+
+    if (_windowedOperation()) {
+        // Several requests are in flight, each response carries the sequence number of its request plus one
+        auto inFlight = _requestsInFlight.find(static_cast<uint16_t>(incomingSeqNumber - 1));
+        if (inFlight == _requestsInFlight.end()) {
+            qCDebug(FileManagerLog) << "Ignoring response to request no longer in flight, seq:" << incomingSeqNumber;
+            return;
+        }
+        InFlightRequest inFlightRequest = inFlight.value();
+        _requestsInFlight.erase(inFlight);
+        _windowedResponse(request, inFlightRequest);
+        return;
+    }
     
     // Make sure we have a good sequence number
     uint16_t expectedSeqNumber = _lastOutgoingRequest.hdr.seqNumber + 1;
@@ -465,8 +643,8 @@ void FileManager::receiveMessage(mavlink_message_t message)
                 _createAckResponse(request);
                 break;
                 
-            case kCmdWriteFile:
-                _writeAckResponse(request);
+            case kCmdCalcFileCRC32:
+                _crc32AckResponse(request);
                 break;
                 
 			default:
@@ -490,6 +668,10 @@ void FileManager::receiveMessage(mavlink_message_t message)
             // This is not an error, just the end of the download loop
             _closeDownloadSession(true /* success */);
             return;
+        } else if (request->hdr.req_opcode == kCmdCalcFileCRC32) {
+            // Server can't checksum the file, download it anyway. A missing file will fail the open.
+            _openDownloadSession();
+            return;
         } else if (request->hdr.req_opcode == kCmdCreateFile) {
             _emitErrorMessage(tr("Nak received creating file, error: %1").arg(errorString(request->data[0])));
             return;
@@ -501,9 +683,6 @@ void FileManager::receiveMessage(mavlink_message_t message)
             if (request->hdr.req_opcode == kCmdReadFile || request->hdr.req_opcode == kCmdBurstReadFile) {
                 // Nak error during download loop, download failed
                 _closeDownloadSession(false /* failure */);
-            } else if (request->hdr.req_opcode == kCmdWriteFile) {
-                // Nak error during upload loop, upload failed
-                _closeUploadSession(false /* failure */);
             }
             _emitErrorMessage(tr("Nak received, error: %1").arg(errorString(request->data[0])));
         }
@@ -610,15 +789,36 @@ void FileManager::_downloadWorker(const QString& from, const QDir& downloadDir,
 	}
 	i++; // move past slash
 	_readFileDownloadFilename = from.right(from.size() - i);
+	_readFileRemotePath = from;
+	_readFileBurst = !readFile;
 	
-	_currentOperation = readFile ? kCOOpenRead : kCOOpenBurst;
+	if (_readFileDownloadDir.exists(_readFileDownloadFilename)) {
+		// We may already have this file, compare checksums before downloading it again
+		_currentOperation = kCOCalcCRC32;
+		
+		Request request;
+		request.hdr.session = 0;
+		request.hdr.opcode = kCmdCalcFileCRC32;
+		request.hdr.offset = 0;
+		request.hdr.size = 0;
+		_fillRequestWithString(&request, from);
+		_sendRequest(&request);
+	} else {
+		_openDownloadSession();
+	}
+}
+
+/// @brief Opens the file set up by _downloadWorker for the Read or Burst download
+void FileManager::_openDownloadSession(void)
+{
+	_currentOperation = _readFileBurst ? kCOOpenBurst : kCOOpenRead;
 	
 	Request request;
 	request.hdr.session = 0;
 	request.hdr.opcode = kCmdOpenFileRO;
 	request.hdr.offset = 0;
 	request.hdr.size = 0;
-	_fillRequestWithString(&request, from);
+	_fillRequestWithString(&request, _readFileRemotePath);
 	_sendRequest(&request);
 }
 
@@ -753,7 +953,7 @@ void FileManager::_setupAckTimeout(void)
 
     _ackNumTries = 0;
     _ackTimer.setSingleShot(false);
-    _ackTimer.start(ackTimerTimeoutMsecs);
+    _ackTimer.start(_ackTimerTimeoutMsecs);
 }
 
 /// @brief Clears the ack timeout timer
@@ -768,9 +968,11 @@ void FileManager::_ackTimeout(void)
 {
     qCDebug(FileManagerLog) << "_ackTimeout";
     
-    if (++_ackNumTries <= ackTimerMaxRetries) {
+    if (++_ackNumTries <= _ackTimerMaxRetries) {
         qCDebug(FileManagerLog) << "ack timeout - retrying";
-        if (_currentOperation == kCOBurst) {
+        if (_windowedOperation()) {
+            _resendRequestsInFlight();
+        } else if (_currentOperation == kCOBurst) {
             // for burst downloads try to initiate a new burst
             Request request;
             request.hdr.session = _activeSession;
@@ -806,6 +1008,11 @@ void FileManager::_ackTimeout(void)
             _sendResetCommand();
             break;
             
+        case kCOCalcCRC32:
+            // Server doesn't answer the checksum request, download the file anyway
+            _openDownloadSession();
+            break;
+            
         case kCOCreate:
             _currentOperation = kCOIdle;
             _emitErrorMessage(tr("Timeout waiting for ack: Upload failed"));
@@ -869,6 +1076,42 @@ void FileManager::_sendRequest(Request* request)
     _sendRequestNoAck(request);
 }
 
+/// @brief Sends one of the requests of a windowed operation. The request is tracked by sequence number until its
+/// response arrives, and the ack timer covers everything in flight.
+void FileManager::_sendWindowedRequest(Request* request, uint32_t offset, uint32_t size)
+{
+    request->hdr.seqNumber = ++_lastOutgoingRequest.hdr.seqNumber;
+    // Skip the number the response will use, so request and response numbers never collide on the server
+    ++_lastOutgoingRequest.hdr.seqNumber;
+    _requestsInFlight.insert(request->hdr.seqNumber, { offset, size });
+
+    if (!_ackTimer.isActive()) {
+        _setupAckTimeout();
+    }
+
+    qCDebug(FileManagerLog) << "_sendWindowedRequest opcode:" << request->hdr.opcode << "seqNumber:" << request->hdr.seqNumber << "offset:" << offset << "size:" << size;
+
+    if (_systemIdQGC == 0) {
+        _systemIdQGC = qgcApp()->toolbox()->mavlinkProtocol()->getSystemId();
+    }
+    _sendRequestNoAck(request);
+}
+
+/// @brief Sends everything in flight again with new sequence numbers. Late responses to the old ones are ignored.
+void FileManager::_resendRequestsInFlight(void)
+{
+    QList<InFlightRequest> requests = _requestsInFlight.values();
+    _requestsInFlight.clear();
+
+    for (const InFlightRequest& inFlight: requests) {
+        if (_currentOperation == kCOWrite) {
+            _sendWriteRequest(inFlight.offset, inFlight.size);
+        } else {
+            _sendMissingDataRequest(inFlight.offset, inFlight.size);
+        }
+    }
+}
+
 /// @brief Sends the specified Request out to the UAS, without ack timeout handling
 void FileManager::_sendRequestNoAck(Request* request)
 {
@@ -13,7 +13,8 @@
 #include <QObject>
 #include <QDir>
 #include <QTimer>
-#include <QQueue>
+#include <QMap>
+#include <QFutureWatcher>
 
 #include "UASInterface.h"
 #include "QGCLoggingCategory.h"
@@ -47,17 +48,22 @@ public:
 
     static const int ackTimerMaxRetries = 6;
 
+    /// Unit tests lower these so that waiting out a timeout doesn't take as long
     int _ackTimerTimeoutMsecs = ackTimerTimeoutMsecs;
 
     int _ackTimerMaxRetries = ackTimerMaxRetries;
 
+    /// Maximum number of write requests, or reads of missing burst data, in flight at the same time
+    static const int requestWindowSize = 8;
 
-	/// Downloads the specified file.
+
+	/// Downloads the specified file. If the file is already in downloadDir and its CRC32 matches the one on the
+	/// vehicle the download is skipped.
 	///     @param from File to download from UAS, fully qualified path
 	///     @param downloadDir Local directory to download file to
 	void downloadPath(const QString& from, const QDir& downloadDir);
 	
-	/// Stream downloads the specified file.
+	/// Stream downloads the specified file. Skipped like downloadPath if an identical copy is already local.
 	///     @param from File to download from UAS, fully qualified path
 	///     @param downloadDir Local directory to download file to
 	void streamPath(const QString& from, const QDir& downloadDir);
@@ -99,6 +105,7 @@ public slots:
 	
 private slots:
 	void _ackTimeout(void);
+    void _localCRC32Complete(void);
 
 private:
     /// @brief This is the fixed length portion of the protocol data.
@@ -133,6 +140,9 @@ private:
 
             // Length of file chunk written by write command
             uint32_t writeFileLength;
+
+            // CRC32 returned by CalcFileCRC32 command
+            uint32_t crc32;
         };
     }) Request;
 
@@ -189,7 +199,20 @@ private:
             kCOWrite,       // waiting for Write response
             kCOCreate,      // waiting for Create response
             kCOCreateDir,   // waiting for Create Directory response
+            kCOCalcCRC32,   // waiting for CRC32 response and the local checksum, followed by Read or Burst download if the local copy differs
         };
+
+    /// Write request, or read of missing burst data, which has been sent but not answered yet
+    typedef struct {
+        uint32_t offset;
+        uint32_t size;
+    } InFlightRequest;
+
+    /// CRC32 of the local copy of a file being downloaded
+    typedef struct {
+        bool     valid;     ///< false: local file could not be read
+        uint32_t crc32;
+    } LocalCRC32;
     
     bool _sendOpcodeOnlyCmd(uint8_t opcode, OperationState newOpState);
     void _setupAckTimeout(void);
@@ -204,8 +227,18 @@ private:
     void _downloadAckResponse(Request* readAck, bool readFile);
     void _listAckResponse(Request* listAck);
     void _createAckResponse(Request* createAck);
-    void _writeAckResponse(Request* writeAck);
-    void _writeFileDatablock(void);
+    void _writeAckResponse(Request* writeAck, const InFlightRequest& inFlight);
+    void _missingDataAckResponse(Request* readAck, const InFlightRequest& inFlight);
+    void _crc32AckResponse(Request* crc32Ack);
+    void _windowedResponse(Request* response, const InFlightRequest& inFlight);
+    bool _windowedOperation(void) const;
+    void _sendWindowedRequest(Request* request, uint32_t offset, uint32_t size);
+    void _sendWriteRequest(uint32_t offset, uint32_t size);
+    void _sendMissingDataRequest(uint32_t offset, uint32_t size);
+    void _resendRequestsInFlight(void);
+    void _fillWriteWindow(void);
+    void _removeMissingData(uint32_t offset, uint32_t size);
+    void _openDownloadSession(void);
     void _sendListCommand(void);
     void _sendResetCommand(void);
     void _closeDownloadSession(bool success);
@@ -214,6 +247,7 @@ private:
     void _requestMissingData();
     
     static QString errorString(uint8_t errorCode);
+    static LocalCRC32 _calcLocalCRC32(const QString& filePath);
 
     OperationState  _currentOperation;              ///< Current operation of state machine
     QTimer          _ackTimer;                      ///< Used to signal a timeout waiting for an ack
@@ -231,21 +265,24 @@ private:
     
     uint32_t    _readOffset;                ///< current read offset
     
-    uint32_t    _writeOffset;               ///< current write offset
-    uint32_t    _writeSize;                 ///< current write data size
+    QMap<uint16_t, InFlightRequest> _requestsInFlight;  ///< Outstanding windowed requests keyed by their sequence number
+
+    uint32_t    _writeNextOffset;           ///< offset of the next write request to send
+    uint32_t    _writeAckedBytes;           ///< number of bytes the server has acked as written
     uint32_t    _writeFileSize;             ///< Size of file being uploaded
     QByteArray  _writeFileAccumulator;      ///< Holds file being uploaded
     
-    struct MissingData {
-        uint32_t offset;
-        uint32_t size;
-    };
     uint32_t    _downloadOffset;            ///< current download offset
     uint32_t    _missingDownloadedBytes;    ///< number of missing bytes for burst download
-    QQueue<MissingData> _missingData;       ///< missing chunks of downloaded file (for burst downloads)
+    QMap<uint32_t, uint32_t> _missingData;  ///< missing ranges of burst downloaded file, offset to size
+    uint32_t    _missingDataCursor;         ///< offset the next missing data request starts from
     bool        _downloadingMissingParts;   ///< true if we are currently downloading missing parts
     QByteArray  _readFileAccumulator;       ///< Holds file being downloaded
+    QString     _readFileRemotePath;        ///< Fully qualified path of file being downloaded
+    bool        _readFileBurst;             ///< true: burst download, false: read download
     QDir        _readFileDownloadDir;       ///< Directory to download file to
+    uint32_t    _remoteCRC32;               ///< CRC32 the server returned for the file being downloaded
+    QFutureWatcher<LocalCRC32> _localCRC32Watcher;  ///< Checksums the local copy off the GUI thread
     QString     _readFileDownloadFilename;  ///< Filename (no path) for download file
     uint32_t    _downloadFileSize;          ///< Size of file being downloaded
 
@@ -255,5 +292,6 @@ private:
     // We give MockLinkFileServer friend access so that it can use the data structures and opcodes
     // to build a mock mavlink file server for testing.
     friend class MockLinkFileServer;
+    friend class FileManagerTest;
 };
 
@@ -42,7 +42,12 @@ MAVLinkDecoder::MAVLinkDecoder(MAVLinkProtocol* protocol) :
     textMessageFilter.insert(MAVLINK_MSG_ID_NAMED_VALUE_INT, false);
 //    textMessageFilter.insert(MAVLINK_MSG_ID_HIGHRES_IMU, false);
 
-    connect(protocol, &MAVLinkProtocol::messageReceived, this, &MAVLinkDecoder::receiveMessage);
+    // Messages are delivered on the main thread, decoding happens on our own thread
+    protocol->messageRouter()->subscribe(this, MAVLinkMessageFilter(), [this](LinkInterface* link, const MAVLinkMessageBatch& messages) {
+        for (const mavlink_message_t* message: messages) {
+            QMetaObject::invokeMethod(this, "receiveMessage", Qt::QueuedConnection, Q_ARG(LinkInterface*, link), Q_ARG(mavlink_message_t, *message));
+        }
+    });
     connect(this, &MAVLinkDecoder::finish, this, &QThread::quit);
 
     start(LowestPriority);
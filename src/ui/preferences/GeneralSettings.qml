@@ -41,6 +41,8 @@ Rectangle {
     property string _mapProvider:               QGroundControl.settingsManager.flightMapSettings.mapProvider.value
     property string _mapType:                   QGroundControl.settingsManager.flightMapSettings.mapType.value
     property Fact _followTarget:                QGroundControl.settingsManager.appSettings.followTarget
+    property Fact _terrainSource:               QGroundControl.settingsManager.appSettings.terrainSource
+    property Fact _terrainDEMPath:              QGroundControl.settingsManager.appSettings.terrainDEMPath
     property real _panelWidth:                  _root.width * _internalWidthRatio
     property real _margins:                     ScreenTools.defaultFontPixelWidth
     property var _planViewSettings:             QGroundControl.settingsManager.planViewSettings
@@ -197,6 +199,42 @@ Rectangle {
                                     }
                                 }
 
+                                QGCLabel {
+                                    text:                   qsTr("Terrain Source")
+                                    visible:                _terrainSource.visible
+                                }
+                                FactComboBox {
+                                    Layout.preferredWidth:  _comboFieldWidth
+                                    fact:                   _terrainSource
+                                    indexModel:             false
+                                    visible:                _terrainSource.visible
+                                }
+                                QGCLabel {
+                                    text:                   qsTr("Elevation Files")
+                                    visible:                _terrainSource.rawValue === 1
+                                }
+                                RowLayout {
+                                    Layout.preferredWidth:  _comboFieldWidth
+                                    visible:                _terrainSource.rawValue === 1
+                                    QGCTextField {
+                                        Layout.fillWidth:   true
+                                        readOnly:           true
+                                        text:               _terrainDEMPath.rawValue === "" ? qsTr("<not set>") : _terrainDEMPath.value
+                                    }
+                                    QGCButton {
+                                        text:       qsTr("Browse")
+                                        onClicked:  terrainDEMBrowseDialog.openForLoad()
+                                        QGCFileDialog {
+                                            id:             terrainDEMBrowseDialog
+                                            title:          qsTr("Choose the directory holding .hgt or GeoTIFF elevation files")
+                                            folder:         _terrainDEMPath.rawValue
+                                            selectExisting: true
+                                            selectFolder:   true
+                                            onAcceptedForLoad: _terrainDEMPath.rawValue = file
+                                        }
+                                    }
+                                }
+
                                 QGCLabel {
                                     text:                   qsTr("Stream GCS Position")
                                     visible:                _followTarget.visible